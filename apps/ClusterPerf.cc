@@ -43,9 +43,11 @@
 #include <boost/version.hpp>
 #include <algorithm>
 #include <iostream>
+#include <thread>
 #include <unordered_set>
 namespace po = boost::program_options;
 
+#include "AsyncClient.h"
 #include "BasicTransport.h"
 #include "btreeRamCloud/Btree.h"
 #include "ClientLeaseAgent.h"
@@ -62,6 +64,10 @@ Context *context;
 // Used to invoke RAMCloud operations.
 static RamCloud* cluster;
 
+// Options used to create "cluster"; tests that need additional RamCloud
+// objects (e.g. one per thread) create them from these.
+static CommandLineOptions* clientOptions;
+
 // Total number of clients that will be participating in this test.
 static int numClients;
 
@@ -6488,6 +6494,327 @@ writeAsyncSync()
     }
 }
 
+// This benchmark shows the tradeoff between throughput and latency for
+// group commit of durable writes. For each of several group commit windows
+// (set on the server with the SET_GROUP_COMMIT_WINDOW control), it keeps
+// 1, 8, or 64 writes of randomly chosen objects outstanding at once, as if
+// that many clients were writing concurrently, and measures the write rate,
+// the latency of individual writes, and how many writes shared each
+// replication of the log head.
+void
+writeGroupCommit()
+{
+    if (clientIndex != 0)
+        return;
+
+    const int numKeys = 100000;
+    const uint16_t keyLength = 30;
+    const int maxConcurrency = 64;
+    const uint32_t windows[] = {0, 5, 20, 50};
+    const int concurrencies[] = {1, 8, maxConcurrency};
+
+    fillTable(dataTable, numKeys, keyLength, objectSize);
+    char value[objectSize];
+    Util::genRandomString(value, objectSize);
+    char keys[maxConcurrency][keyLength];
+
+    printf("# RAMCloud durable write throughput and latency with group "
+            "commit, for\n"
+            "# various group commit windows and numbers of outstanding "
+            "writes of\n"
+            "# randomly chosen %d-byte objects with %d-byte keys.\n"
+            "# Generated by 'clusterperf.py writeGroupCommit'\n#\n"
+            "# window(us)  outstanding  throughput  median(us)  99%%(us)  "
+            "writes/sync\n"
+            "#              writes       (kops/sec)\n"
+            "#-------------------------------------------------------------"
+            "---------\n", objectSize, keyLength);
+    foreach (uint32_t window, windows) {
+        cluster->objectServerControl(dataTable, "abc", 3,
+                WireFormat::ControlOp::SET_GROUP_COMMIT_WINDOW,
+                &window, sizeof32(window));
+        foreach (int concurrency, concurrencies) {
+            Tub<WriteRpc> rpcs[maxConcurrency];
+            uint64_t startTimes[maxConcurrency];
+            std::vector<uint64_t> latencies;
+
+            Buffer statsBuffer;
+            cluster->objectServerControl(dataTable, "abc", 3,
+                    WireFormat::ControlOp::GET_PERF_STATS, NULL, 0,
+                    &statsBuffer);
+            PerfStats startStats = *statsBuffer.getStart<PerfStats>();
+
+            uint64_t start = Cycles::rdtsc();
+            uint64_t stop = start + Cycles::fromSeconds(2.0);
+            for (int i = 0; i < concurrency; i++) {
+                makeKey(downCast<int>(generateRandom() % numKeys),
+                        keyLength, keys[i]);
+                startTimes[i] = Cycles::rdtsc();
+                rpcs[i].construct(cluster, dataTable, keys[i], keyLength,
+                        &value[0], objectSize);
+            }
+            int active = concurrency;
+            while (active > 0) {
+                cluster->poll();
+                for (int i = 0; i < concurrency; i++) {
+                    if (!rpcs[i] || !rpcs[i]->isReady())
+                        continue;
+                    rpcs[i]->wait();
+                    uint64_t now = Cycles::rdtsc();
+                    latencies.push_back(now - startTimes[i]);
+                    if (now >= stop) {
+                        rpcs[i].destroy();
+                        active--;
+                        continue;
+                    }
+                    makeKey(downCast<int>(generateRandom() % numKeys),
+                            keyLength, keys[i]);
+                    startTimes[i] = Cycles::rdtsc();
+                    rpcs[i].construct(cluster, dataTable, keys[i], keyLength,
+                            &value[0], objectSize);
+                }
+            }
+            double elapsed = Cycles::toSeconds(Cycles::rdtsc() - start);
+
+            cluster->objectServerControl(dataTable, "abc", 3,
+                    WireFormat::ControlOp::GET_PERF_STATS, NULL, 0,
+                    &statsBuffer);
+            PerfStats finishStats = *statsBuffer.getStart<PerfStats>();
+            double writesPerSync = static_cast<double>(
+                    finishStats.logSyncBatchedRequests -
+                    startStats.logSyncBatchedRequests) /
+                    static_cast<double>(finishStats.logSyncBatches -
+                    startStats.logSyncBatches);
+
+            std::sort(latencies.begin(), latencies.end());
+            size_t numWrites = latencies.size();
+            printf("%8u  %10d  %12.1f  %10.1f  %9.1f  %10.2f\n",
+                    window, concurrency,
+                    static_cast<double>(numWrites) / elapsed / 1e03,
+                    Cycles::toSeconds(latencies[numWrites / 2]) * 1e06,
+                    Cycles::toSeconds(latencies[numWrites * 99 / 100]) * 1e06,
+                    writesPerSync);
+        }
+    }
+    uint32_t window = 0;
+    cluster->objectServerControl(dataTable, "abc", 3,
+            WireFormat::ControlOp::SET_GROUP_COMMIT_WINDOW,
+            &window, sizeof32(window));
+}
+
+// Context for one outstanding operation in asyncThroughput. Each time an
+// operation completes, its callback issues another one on a random key
+// (reusing the same context) until the test's stop time.
+struct AsyncThroughputOp {
+    AsyncThroughputOp()
+        : async(NULL)
+        , write(false)
+        , numKeys(0)
+        , keyLength(0)
+        , value(NULL)
+        , stopTime(0)
+        , completed(NULL)
+        , errors(NULL)
+        , readValue()
+    {}
+
+    AsyncClient* async;
+    bool write;
+    int numKeys;
+    uint16_t keyLength;
+    const char* value;
+    uint64_t stopTime;
+    uint64_t* completed;
+    uint64_t* errors;
+    Buffer readValue;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncThroughputOp);
+};
+
+static void
+asyncThroughputIssue(AsyncThroughputOp* op);
+
+static void
+asyncThroughputCallback(void* arg, Status status, uint64_t version)
+{
+    AsyncThroughputOp* op = static_cast<AsyncThroughputOp*>(arg);
+    (*op->completed)++;
+    if (status != STATUS_OK)
+        (*op->errors)++;
+    if (Cycles::rdtsc() < op->stopTime)
+        asyncThroughputIssue(op);
+}
+
+static void
+asyncThroughputIssue(AsyncThroughputOp* op)
+{
+    char key[op->keyLength];
+    makeKey(downCast<int>(generateRandom() % op->numKeys), op->keyLength,
+            key);
+    if (op->write) {
+        op->async->writeAsync(dataTable, key, op->keyLength, op->value,
+                objectSize, NULL, asyncThroughputCallback, op);
+    } else {
+        op->async->readAsync(dataTable, key, op->keyLength, &op->readValue,
+                NULL, asyncThroughputCallback, op);
+    }
+}
+
+// This benchmark measures how many reads and writes per second a single
+// client thread can drive through the AsyncClient API, for various numbers
+// of outstanding operations (up to 1024). Each completed operation's
+// callback issues a new operation on a randomly chosen object, so the
+// number outstanding stays constant; all progress is made by
+// AsyncClient::poll.
+void
+asyncThroughput()
+{
+    if (clientIndex != 0)
+        return;
+
+    const int numKeys = 100000;
+    const uint16_t keyLength = 30;
+    const int outstanding[] = {1, 16, 128, 1024};
+
+    fillTable(dataTable, numKeys, keyLength, objectSize);
+    char value[objectSize];
+    Util::genRandomString(value, objectSize);
+    AsyncClient async(cluster, 1024);
+
+    printf("# RAMCloud operations per second issued by one client thread "
+            "with the\n"
+            "# asynchronous client API, for various numbers of outstanding "
+            "operations\n"
+            "# on randomly chosen %d-byte objects with %d-byte keys.\n"
+            "# Generated by 'clusterperf.py asyncThroughput'\n#\n"
+            "# outstanding   reads       writes\n"
+            "#               (kops/sec)  (kops/sec)\n"
+            "#-------------------------------------\n",
+            objectSize, keyLength);
+    foreach (int count, outstanding) {
+        double rates[2];
+        for (int write = 0; write < 2; write++) {
+            uint64_t completed = 0;
+            uint64_t errors = 0;
+            std::vector<AsyncThroughputOp> ops(count);
+            uint64_t start = Cycles::rdtsc();
+            uint64_t stop = start + Cycles::fromSeconds(2.0);
+            foreach (AsyncThroughputOp& op, ops) {
+                op.async = &async;
+                op.write = (write != 0);
+                op.numKeys = numKeys;
+                op.keyLength = keyLength;
+                op.value = value;
+                op.stopTime = stop;
+                op.completed = &completed;
+                op.errors = &errors;
+                asyncThroughputIssue(&op);
+            }
+            async.waitAll();
+            double elapsed = Cycles::toSeconds(Cycles::rdtsc() - start);
+            if (errors != 0) {
+                RAMCLOUD_LOG(WARNING, "%lu of %lu operations failed",
+                        errors, completed);
+            }
+            rates[write] = static_cast<double>(completed) / elapsed;
+        }
+        printf("%8d  %11.1f  %10.1f\n", count, rates[0] / 1e03,
+                rates[1] / 1e03);
+    }
+}
+
+// Body of one thread in asyncBatching: creates a private RamCloud object
+// and AsyncClient, keeps "outstanding" operations of the given type active
+// until "stopTime", and returns the thread's throughput in *rate.
+static void
+asyncBatchingThread(bool write, int outstanding, uint32_t maxBatchSize,
+        const char* value, uint64_t stopTime, double* rate)
+{
+    const int numKeys = 100000;
+    RamCloud ramcloud(clientOptions);
+    AsyncClient async(&ramcloud, downCast<uint32_t>(outstanding));
+    async.setBatching(maxBatchSize, 5);
+
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    std::vector<AsyncThroughputOp> ops(outstanding);
+    uint64_t start = Cycles::rdtsc();
+    foreach (AsyncThroughputOp& op, ops) {
+        op.async = &async;
+        op.write = write;
+        op.numKeys = numKeys;
+        op.keyLength = 30;
+        op.value = value;
+        op.stopTime = stopTime;
+        op.completed = &completed;
+        op.errors = &errors;
+        asyncThroughputIssue(&op);
+    }
+    async.waitAll();
+    double elapsed = Cycles::toSeconds(Cycles::rdtsc() - start);
+    if (errors != 0) {
+        RAMCLOUD_LOG(WARNING, "%lu of %lu operations failed",
+                errors, completed);
+    }
+    *rate = static_cast<double>(completed) / elapsed;
+}
+
+// This benchmark measures the benefit of the AsyncClient's automatic
+// batching: several client threads, each with its own RamCloud object,
+// keep many independent single-object reads (or writes) outstanding on
+// random keys. Each configuration is run first with batching disabled
+// (one RPC per operation) and then with up to 16 operations per master
+// combined into a single multi-op RPC.
+void
+asyncBatching()
+{
+    if (clientIndex != 0)
+        return;
+
+    const int threadCounts[] = {1, 2, 4, 8};
+    const int outstanding = 64;
+    const uint32_t maxBatchSize = 16;
+
+    fillTable(dataTable, 100000, 30, objectSize);
+    char value[objectSize];
+    Util::genRandomString(value, objectSize);
+
+    printf("# Aggregate RAMCloud operations per second for client threads "
+            "that each\n"
+            "# keep %d single-object operations outstanding on random "
+            "%d-byte objects,\n"
+            "# without and with AsyncClient batching (at most %u "
+            "operations per RPC).\n"
+            "# Generated by 'clusterperf.py asyncBatching'\n#\n"
+            "# threads  reads (kops/sec)      writes (kops/sec)\n"
+            "#          unbatched  batched    unbatched  batched\n"
+            "#--------------------------------------------------\n",
+            outstanding, objectSize, maxBatchSize);
+    foreach (int numThreads, threadCounts) {
+        double rates[4];
+        for (int i = 0; i < 4; i++) {
+            bool write = (i >= 2);
+            uint32_t batchSize = (i % 2 == 1) ? maxBatchSize : 0;
+            std::vector<double> threadRates(numThreads);
+            std::vector<std::thread> threads;
+            uint64_t stop = Cycles::rdtsc() + Cycles::fromSeconds(2.0);
+            for (int t = 0; t < numThreads; t++) {
+                threads.emplace_back(asyncBatchingThread, write,
+                        outstanding, batchSize, &value[0], stop,
+                        &threadRates[t]);
+            }
+            rates[i] = 0;
+            for (int t = 0; t < numThreads; t++) {
+                threads[t].join();
+                rates[i] += threadRates[t];
+            }
+        }
+        printf("%8d  %9.1f  %9.1f  %9.1f  %9.1f\n", numThreads,
+                rates[0] / 1e03, rates[1] / 1e03, rates[2] / 1e03,
+                rates[3] / 1e03);
+    }
+}
+
 // Write or overwrite randomly-chosen objects from a large table (so that there
 // will be cache misses on the hash table and the object) and compute a
 // cumulative distribution of write times.
@@ -6846,6 +7173,8 @@ struct TestInfo {
 };
 
 TestInfo tests[] = {
+    {"asyncBatching", asyncBatching},
+    {"asyncThroughput", asyncThroughput},
     {"basic", basic},
     {"broadcast", broadcast},
     {"echo_basic", echo_basic},
@@ -6883,6 +7212,7 @@ TestInfo tests[] = {
     {"writeAsyncSync", writeAsyncSync},
     {"writeDistRandom", writeDistRandom},
     {"writeDistWorkload", writeDistWorkload},
+    {"writeGroupCommit", writeGroupCommit},
     {"writeInterference", writeInterference},
     {"writeThroughput", writeThroughput},
     {"workloadThroughput", workloadThroughput},
@@ -6957,7 +7287,8 @@ try
     dup2(Logger::get().getLogFile(), 1);
     dup2(Logger::get().getLogFile(), 2);
 
-    RamCloud r(&optionParser.options);
+    clientOptions = &optionParser.options;
+    RamCloud r(clientOptions);
     context = r.clientContext;
     cluster = &r;
     cluster->createTable("data");
@@ -56,6 +56,8 @@ static bool  USE_DECAY_FOR_COST_BENEFIT = false;                // If true, use
 static bool  USE_LIFETIMES_WHEN_REPLAYING = false;              // If true and we're replaying a script, use actual lifetimes rather than estimates based on age.
 static double ROOT_EXP = 0.5;                                   // If TAKE_ROOT_OF_AGE is true, this is what age will be raised to.
 static double LOG_BASE = 2;                                     // If TAKE_LOG_OF_AGE is true, this is the base of our log.
+static int    AGE_CLASSES = 1;                                  // Number of age classes survivors are segregated into. Each class
+                                                                // is written to its own survivor segments (see LogCleaner).
 
 // -Counters-
 static size_t segmentsCleaned = 0; 
@@ -65,6 +67,7 @@ static size_t emptySegmentsCleaned = 0;
 static size_t newObjectsWritten = 0;
 static size_t cleanerObjectsWritten = 0;
 static int    currentTimestamp = 0;
+static double averageSurvivorAge = 0;
 static size_t objectWriteCounts[TOTAL_LIVE_OBJECTS];
 
 double
@@ -143,7 +146,8 @@ class Segment {
           liveObjectCount(0),
           timestampSum(0),
           latestTimestamp(0),
-          createTimestamp(currentTimestamp)
+          createTimestamp(currentTimestamp),
+          ageClass(-1)
 	{
 		objects.reserve(OBJECTS_PER_SEGMENT);
 	}
@@ -235,6 +239,20 @@ class Segment {
         return createTimestamp;
     }
 
+    // Age class of the survivor objects in this segment, or -1 if it was not
+    // written by a cleaning pass that segregated objects into classes.
+    int
+    getAgeClass()
+    {
+        return ageClass;
+    }
+
+    void
+    setAgeClass(int newAgeClass)
+    {
+        ageClass = newAgeClass;
+    }
+
   private:
 	// Log order vector of objects written.
 	std::vector<Object> objects;
@@ -250,6 +268,9 @@ class Segment {
 
     // Timestamp when this segment was created.
     int createTimestamp;
+
+    // See getAgeClass().
+    int ageClass;
 };
 
 class Distribution {
@@ -604,8 +625,11 @@ class Strategy {
                 return (1.0 - u) / ((1 + u) * pow(decay, ROOT_EXP));
             }
 
+            // Like RAMCloud, segments segregated into age classes are aged
+            // by their data even when ordering by segment age, since the
+            // cleaner created them long after their objects were written.
             uint64_t age = currentTimestamp - segment->getTimestamp();
-            if (ORDER_SEGMENTS_BY_SEGMENT_AGE)
+            if (ORDER_SEGMENTS_BY_SEGMENT_AGE && segment->getAgeClass() == -1)
                 age = segmentAge;
 
             if (TAKE_ROOT_OF_AGE)
@@ -830,6 +854,64 @@ getLiveObjects(std::vector<Segment*>& segments, std::vector<Object>& liveObjects
     } 
 }
 
+// Map an object's age to its age class, 0 being the youngest. Boundaries
+// double from one class to the next and are centred on the average age of
+// recently cleaned objects. This mirrors LogCleaner::getAgeClass().
+int
+getAgeClass(int age, double averageAge, int ageClasses)
+{
+    double boundary = std::max(averageAge / (1 << ((ageClasses - 1) / 2)), 1.0);
+    int ageClass = 0;
+    while (ageClass < ageClasses - 1 && age >= boundary) {
+        ageClass++;
+        boundary *= 2;
+    }
+    return ageClass;
+}
+
+// Split the live objects of a cleaning pass into age classes, reordering them
+// so that each class is contiguous (oldest class first). Returns the class of
+// each object in the new order, or -1 for all objects if survivors are not
+// being segregated. Like RAMCloud (see LogCleaner::getAgeClassesForPass()),
+// survivors do not outlive the pass that created them, so every class boundary
+// may leave a partially-filled survivor behind and no more classes are used
+// than the segments being cleaned can absorb.
+std::vector<int>
+segregateLiveObjects(std::vector<Object>& liveObjects, size_t segmentsCleaned)
+{
+    std::vector<int> classes(liveObjects.size(), -1);
+    if (AGE_CLASSES == 1 || liveObjects.empty())
+        return classes;
+
+    size_t minimumSurvivors = (liveObjects.size() + OBJECTS_PER_SEGMENT - 1) / OBJECTS_PER_SEGMENT;
+    int passClasses = std::min<size_t>(AGE_CLASSES, segmentsCleaned - minimumSurvivors + 1);
+    if (passClasses == 1)
+        return classes;
+
+    double ageSum = 0;
+    for (size_t i = 0; i < liveObjects.size(); i++)
+        ageSum += currentTimestamp - liveObjects[i].getTimestamp();
+    double passAverage = ageSum / liveObjects.size();
+    if (averageSurvivorAge == 0)
+        averageSurvivorAge = passAverage;
+    else
+        averageSurvivorAge = (7 * averageSurvivorAge + passAverage) / 8;
+
+    std::vector<std::vector<Object>> buckets(passClasses);
+    for (size_t i = 0; i < liveObjects.size(); i++) {
+        int age = currentTimestamp - liveObjects[i].getTimestamp();
+        buckets[getAgeClass(age, averageSurvivorAge, passClasses)].push_back(liveObjects[i]);
+    }
+
+    liveObjects.clear();
+    classes.clear();
+    for (int c = passClasses - 1; c >= 0; c--) {
+        liveObjects.insert(liveObjects.end(), buckets[c].begin(), buckets[c].end());
+        classes.insert(classes.end(), buckets[c].size(), c);
+    }
+    return classes;
+}
+
 Segment*
 clean(std::vector<Segment*>& activeList, std::vector<Segment*>& freeList, std::vector<ObjectReference>& objectToSegment)
 {
@@ -852,18 +934,22 @@ clean(std::vector<Segment*>& activeList, std::vector<Segment*>& freeList, std::v
     getLiveObjects(segmentsToClean, liveObjects);
     cleanerObjectsWritten += liveObjects.size();
 
+    std::vector<int> ageClasses = segregateLiveObjects(liveObjects, segmentsToClean.size());
+
     int survivorsAllocated = 0;
 
     for (int i = 0; i < liveObjects.size(); i++) {
         assert(!liveObjects[i].isDead());
 
-        if (newHead != NULL && newHead->full()) {
+        // Never mix age classes within a survivor segment.
+        if (newHead != NULL && (newHead->full() || newHead->getAgeClass() != ageClasses[i])) {
             survivorList.push_back(newHead);
             newHead = NULL;
         }
 
         if (newHead == NULL) {
             newHead = new Segment();
+            newHead->setAgeClass(ageClasses[i]);
             survivorsAllocated++;
         }
 
@@ -1016,6 +1102,7 @@ usage()
     fprintf(stderr, "  -D                        (use segment decay rate in cost-benefit strategy)\n");
     fprintf(stderr, "  -o scriptFile             (dump the full list of object ids written here)\n");
     fprintf(stderr, "  -i scriptFile             (replay the given script of object writes)\n");
+    fprintf(stderr, "  -k ageClasses             (segregate survivors into this many age classes)\n");
     fprintf(stderr, "  -l                        (if replaying from script, use actual object lifetimes in cleaning)\n");
     fprintf(stderr, "  -L base                   (if using cost-benefit, take the log of age with given base)\n");
     fprintf(stderr, "  -r                        (do not reorder live objects by age when cleaning)\n");
@@ -1040,7 +1127,7 @@ main(int argc, char** argv)
 
     memset(objectWriteCounts, 0, sizeof(objectWriteCounts));
 
-    for (int ch; (ch = getopt(argc, argv, "aAd:Do:i:lL:rRs:S:tu:")) != -1;) {
+    for (int ch; (ch = getopt(argc, argv, "aAd:Do:i:k:lL:rRs:S:tu:")) != -1;) {
         switch (ch) {
         case 'a':
             ORDER_SEGMENTS_BY_MIN_AGE = false;
@@ -1078,6 +1165,11 @@ main(int argc, char** argv)
                 exit(1);
             }
             break;
+        case 'k':
+            AGE_CLASSES = atoi(optarg);
+            if (AGE_CLASSES < 1)
+                usage();
+            break;
         case 'l':
             USE_LIFETIMES_WHEN_REPLAYING = true;
             break;
@@ -1152,6 +1244,7 @@ main(int argc, char** argv)
     printf("# USE_RAMCLOUD_COST_BENEFIT = %s\n", (USE_RAMCLOUD_COST_BENEFIT) ? "true" : "false");
     printf("# USE_DECAY_FOR_COST_BENEFIT = %s\n", (USE_DECAY_FOR_COST_BENEFIT) ? "true" : "false");
     printf("# USE_LIFETIMES_WHEN_REPLAYING = %s\n", (USE_LIFETIMES_WHEN_REPLAYING) ? "true" : "false");
+    printf("# AGE_CLASSES = %d\n", AGE_CLASSES);
     printf("##################################\n");
 
 	const int liveDataSegments = TOTAL_LIVE_OBJECTS / OBJECTS_PER_SEGMENT;
@@ -1235,6 +1328,7 @@ main(int argc, char** argv)
     printf("# New object writes = %zd\n", newObjectsWritten);
     printf("# Survivor objects written by cleaner = %zd\n", cleanerObjectsWritten);
     printf("# LFS write cost = %.3f\n", lfsWriteCost());
+    printf("# RAMCloud write cost = %.3f\n", ramcloudWriteCost());
     printf("# Cleaning passes = %zd\n", cleaningPasses);
     printf("# Segments cleaned = %zd\n", segmentsCleaned);
     printf("# Average segments cleaned per pass = %.2f\n", (double)segmentsCleaned / cleaningPasses);
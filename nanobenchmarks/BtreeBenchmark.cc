@@ -0,0 +1,254 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// This program measures insert and lookup throughput of IndexBtree, and the
+// log space it uses per entry, for several kinds of secondary keys. Each
+// key set is run with and without prefix compression of leaf nodes, and
+// then inserted all at once with IndexBtree::bulkInsert (as when building
+// an index over existing objects).
+
+#include <algorithm>
+
+#include "btreeRamCloud/Btree.h"
+#include "Cycles.h"
+#include "Logger.h"
+#include "MasterTableMetadata.h"
+#include "ObjectManager.h"
+#include "Seglet.h"
+#include "TabletManager.h"
+
+namespace RAMCloud {
+
+class BtreeBenchmark {
+  public:
+    Context context;
+    ClusterClock clusterClock;
+    ClientLeaseValidator clientLeaseValidator;
+    ServerConfig config;
+    ServerList serverList;
+    TabletManager tabletManager;
+    MasterTableMetadata masterTableMetadata;
+    UnackedRpcResults unackedRpcResults;
+    TransactionManager transactionManager;
+    TxRecoveryManager txRecoveryManager;
+    ServerId serverId;
+    ObjectManager* objectManager;
+
+    /// Table holding the tree's nodes.
+    static const uint64_t treeTableId = 1;
+
+    explicit BtreeBenchmark(string logSize)
+        : context()
+        , clusterClock()
+        , clientLeaseValidator(&context, &clusterClock)
+        , config(ServerConfig::forTesting())
+        , serverList(&context)
+        , tabletManager()
+        , masterTableMetadata()
+        , unackedRpcResults(&context,
+                            NULL,
+                            &clientLeaseValidator,
+                            &tabletManager)
+        , transactionManager(&context, NULL, &unackedRpcResults, &tabletManager)
+        , txRecoveryManager(&context)
+        , serverId(1, 1)
+        , objectManager(NULL)
+    {
+        Logger::get().setLogLevels(WARNING);
+        config.localLocator = "bogus";
+        config.coordinatorLocator = "bogus";
+        config.setLogAndHashTableSize(logSize, "10%");
+        config.services = {};
+        config.master.numReplicas = 0;
+        config.master.disableLogCleaner = true;
+        config.segmentSize = Segment::DEFAULT_SEGMENT_SIZE;
+        config.segletSize = Seglet::DEFAULT_SEGLET_SIZE;
+        objectManager = new ObjectManager(&context,
+                                          &serverId,
+                                          &config,
+                                          &tabletManager,
+                                          &masterTableMetadata,
+                                          &unackedRpcResults,
+                                          &transactionManager,
+                                          &txRecoveryManager);
+        unackedRpcResults.resetFreer(objectManager);
+        tabletManager.addTablet(treeTableId, 0, ~0UL, TabletManager::NORMAL);
+        TableStats::addKeyHashRange(&masterTableMetadata, treeTableId,
+                                    0, ~0UL);
+    }
+
+    ~BtreeBenchmark()
+    {
+        delete objectManager;
+    }
+
+    /**
+     * Insert all of the given keys into a new tree in random order, then
+     * look each of them up (again in random order), and print the
+     * throughput of each phase along with the space used per entry.
+     *
+     * \param keys
+     *      Secondary keys to insert; the i-th key gets primary key hash i.
+     * \param compressLeaves
+     *      Passed to IndexBtree::setLeafCompression.
+     */
+    void
+    run(const std::vector<string>& keys, bool compressLeaves)
+    {
+        IndexBtree bt(treeTableId, objectManager);
+        bt.setLeafCompression(compressLeaves);
+
+        std::vector<uint32_t> order(keys.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::random_shuffle(order.begin(), order.end());
+
+        uint64_t start = Cycles::rdtsc();
+        foreach (uint32_t i, order) {
+            bt.insert(BtreeEntry(keys[i].c_str(),
+                    downCast<uint16_t>(keys[i].size()), i));
+        }
+        double insertSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+
+        std::random_shuffle(order.begin(), order.end());
+        start = Cycles::rdtsc();
+        uint32_t found = 0;
+        foreach (uint32_t i, order) {
+            if (bt.exists(BtreeEntry(keys[i].c_str(),
+                    downCast<uint16_t>(keys[i].size()), i)))
+                found++;
+        }
+        double lookupSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+        if (found != keys.size()) {
+            fprintf(stderr, "Only found %u of %lu keys!\n", found,
+                    keys.size());
+            exit(1);
+        }
+
+        uint64_t logBytes = 0;
+        MasterTableMetadata::Entry* entry =
+                masterTableMetadata.find(treeTableId);
+        if (entry != NULL)
+            logBytes = entry->stats.byteCount;
+        double numKeys = static_cast<double>(keys.size());
+
+        printf("  %-14s %8.0f inserts/s %8.0f lookups/s "
+               "%7.1f log bytes/entry %7.1f leaf bytes/entry\n",
+               compressLeaves ? "compressed:" : "uncompressed:",
+               numKeys / insertSeconds, numKeys / lookupSeconds,
+               static_cast<double>(logBytes) / numKeys,
+               bt.getStats().avgLeafBytesPerEntry());
+    }
+
+    /**
+     * Insert all of the given keys into a new (compressed) tree with a
+     * single call to IndexBtree::bulkInsert, and print the throughput
+     * along with the space used per entry.
+     *
+     * \param keys
+     *      Secondary keys to insert; the i-th key gets primary key hash i.
+     */
+    void
+    runBulk(const std::vector<string>& keys)
+    {
+        IndexBtree bt(treeTableId, objectManager);
+        bt.setLeafCompression(true);
+
+        std::vector<BtreeEntry> entries;
+        entries.reserve(keys.size());
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            entries.emplace_back(keys[i].c_str(),
+                    downCast<uint16_t>(keys[i].size()), i);
+        }
+        std::random_shuffle(entries.begin(), entries.end());
+
+        uint64_t start = Cycles::rdtsc();
+        bt.bulkInsert(&entries);
+        double insertSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+        if (bt.size() != keys.size()) {
+            fprintf(stderr, "Tree has %lu of %lu keys!\n", bt.size(),
+                    keys.size());
+            exit(1);
+        }
+
+        uint64_t logBytes = 0;
+        MasterTableMetadata::Entry* entry =
+                masterTableMetadata.find(treeTableId);
+        if (entry != NULL)
+            logBytes = entry->stats.byteCount;
+        double numKeys = static_cast<double>(keys.size());
+
+        printf("  %-14s %8.0f inserts/s %26.1f log bytes/entry "
+               "%7.1f leaf bytes/entry\n", "bulk:",
+               numKeys / insertSeconds,
+               static_cast<double>(logBytes) / numKeys,
+               bt.getStats().avgLeafBytesPerEntry());
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BtreeBenchmark);
+};
+
+}  // namespace RAMCloud
+
+using namespace RAMCloud;
+
+/**
+ * Generate a set of keys from a printf-style pattern containing two
+ * integer conversions, which are filled in with (i / perGroup) and
+ * (i % perGroup) for the i-th key.
+ */
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+static std::vector<string>
+generateKeys(const char* pattern, uint32_t numKeys, uint32_t perGroup)
+{
+    std::vector<string> keys;
+    keys.reserve(numKeys);
+    for (uint32_t i = 0; i < numKeys; i++)
+        keys.push_back(format(pattern, i / perGroup, i % perGroup));
+    return keys;
+}
+#pragma GCC diagnostic warning "-Wformat-nonliteral"
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t numKeys = (argc > 1) ? atoi(argv[1]) : 200000;
+
+    struct {
+        const char* name;
+        const char* format;
+        uint32_t perGroup;
+    } keySets[] = {
+        {"URLs", "https://www.example.com/catalog/department%05u/"
+                 "item%08u.html", 100},
+        {"Composite", "tenant0042:user%08u:ts%010u", 20},
+        {"Short", "%x.%x", 256},
+    };
+
+    for (uint32_t i = 0; i < sizeof(keySets) / sizeof(keySets[0]); i++) {
+        std::vector<string> keys = generateKeys(keySets[i].format, numKeys,
+                                                keySets[i].perGroup);
+        printf("======= %u %s keys (e.g. \"%s\") =======\n", numKeys,
+               keySets[i].name, keys[numKeys / 2].c_str());
+        for (int compress = 1; compress >= 0; compress--) {
+            BtreeBenchmark bb("2048");
+            bb.run(keys, compress);
+        }
+        BtreeBenchmark bb("2048");
+        bb.runBulk(keys);
+    }
+
+    return 0;
+}
@@ -43,6 +43,52 @@ class TestObject {
     uint64_t key;
 } __attribute__((aligned(64)));
 
+/**
+ * Look up a range of consecutive integer keys and return the number of
+ * lookups per second achieved.
+ *
+ * \param ht
+ *      The table to look the keys up in.
+ * \param firstKey
+ *      The first key to look up.
+ * \param count
+ *      The number of keys to look up.
+ * \param expectHit
+ *      True if every key should be found, false if none should be.
+ */
+double
+lookupRate(HashTable& ht, uint64_t firstKey, uint64_t count, bool expectHit)
+{
+    HashTable::Candidates c;
+
+    // don't use a CycleCounter, as we may want to run without PERF_COUNTERS
+    uint64_t lookupCycles = Cycles::rdtsc();
+    for (uint64_t i = firstKey; i < firstKey + count; i++) {
+        Key key(0, &i, sizeof(i));
+        uint64_t reference = 0;
+        bool success = false;
+        _unused(success);
+
+        ht.lookup(key.getHash(), c);
+        while (!c.isDone()) {
+            reference = c.getReference();
+            TestObject* candidateObject =
+                reinterpret_cast<TestObject*>(reference);
+            Key candidateKey(0,
+                             &candidateObject->key,
+                             sizeof(candidateObject->key));
+            if (candidateKey == key) {
+                success = true;
+                break;
+            }
+            c.next();
+        }
+        assert(success == expectHit);
+    }
+    uint64_t cycles = Cycles::rdtsc() - lookupCycles;
+    return static_cast<double>(count) / Cycles::toSeconds(cycles);
+}
+
 } // anonymous namespace
 
 void
@@ -103,8 +149,6 @@ hashTableBenchmark(uint64_t nkeys, uint64_t nlines)
     i = Cycles::rdtsc() - replaceCycles;
     printf("done!\n");
 
-    values = NULL;
-
     printf("== replace() took %.3f s ==\n", Cycles::toSeconds(i));
 
     printf("    external avg: %lu ticks, %lu nsec\n",
@@ -112,41 +156,30 @@ hashTableBenchmark(uint64_t nkeys, uint64_t nlines)
 
     printf("Starting lookups in 3 seconds (get your measurements ready!)\n");
     sleep(3);
-    printf("running lookup measurements...");
-    fflush(stdout);
 
-    // don't use a CycleCounter, as we may want to run without PERF_COUNTERS
-    uint64_t lookupCycles = Cycles::rdtsc();
+    // Keys [nkeys, 2 * nkeys) were never inserted, so they measure misses.
+    // The chained table holds the same keys in a quarter of the buckets,
+    // so most lookups have to follow at least one overflow cache line.
+    HashTable chained(std::max(nlines / 4, 1UL));
     for (i = 0; i < nkeys; i++) {
         Key key(0, &i, sizeof(i));
-        uint64_t reference = 0;
-        bool success = false;
-        _unused(success);
-
-        ht.lookup(key.getHash(), c);
-        while (!c.isDone()) {
-            reference = c.getReference();
-            TestObject* candidateObject =
-                reinterpret_cast<TestObject*>(reference);
-            Key candidateKey(0,
-                             &candidateObject->key,
-                             sizeof(candidateObject->key));
-            if (candidateKey == key) {
-                success = true;
-                break;
-            }
-            c.next();
-        }
-        assert(success);
-        assert(reinterpret_cast<TestObject*>(reference)->key == i);
+        chained.insert(key.getHash(), reinterpret_cast<uint64_t>(&values[i]));
     }
-    i = Cycles::rdtsc() - lookupCycles;
-    printf("done!\n");
-
-    printf("== lookup() took %.3f s ==\n", Cycles::toSeconds(i));
 
-    printf("    external avg: %lu ticks, %lu nsec\n", i / nkeys,
-        Cycles::toNanoseconds(i / nkeys));
+    printf("lookups per second:\n");
+    printf("%8s %12s %12s %12s\n", "mode", "hit", "miss", "chained");
+    for (int mode = HashTable::SCALAR_PROBE;
+            mode <= HashTable::bestProbeMode(); mode++) {
+        HashTable::ProbeMode probeMode =
+                static_cast<HashTable::ProbeMode>(mode);
+        ht.setProbeMode(probeMode);
+        chained.setProbeMode(probeMode);
+        printf("%8s %12.0f %12.0f %12.0f\n",
+               HashTable::probeModeName(probeMode),
+               lookupRate(ht, 0, nkeys, true),
+               lookupRate(ht, nkeys, nkeys, false),
+               lookupRate(chained, 0, nkeys, true));
+    }
 
     uint64_t *histogram = static_cast<uint64_t *>(
         Memory::xmalloc(HERE, nlines * sizeof(histogram[0])));
@@ -66,6 +66,8 @@ class Options {
           distributionName(),
           tableName(),
           outputFilesPrefix(),
+          scalingFile(),
+          writeCostFile(),
           doneWhenCleanerRuns(false)
     {
         for (int i = 0; i < argc; i++)
@@ -83,6 +85,8 @@ class Options {
     string distributionName;
     string tableName;
     string outputFilesPrefix;
+    string scalingFile;
+    string writeCostFile;
     bool doneWhenCleanerRuns;
 };
 
@@ -699,6 +703,8 @@ class Output {
     void dumpParameters(Options& options,
                         ProtoBuf::LogMetrics& logMetrics);
     void dump();
+    void appendScalingRecord(FILE* fp);
+    void appendWriteCostRecord(FILE* fp);
 
     static bool updateLiveLine(RamCloud& ramcloud,
                                string& masterLocator,
@@ -728,6 +734,11 @@ class Output {
     void dumpMemoryMetrics(FILE* fp, ProtoBuf::LogMetrics& metrics);
     void dumpLogMetrics(FILE* fp, ProtoBuf::LogMetrics& metrics);
     void dumpSpinLockMetrics(FILE* fp, ProtoBuf::ServerStatistics& serverStats);
+    void dumpScaling(FILE* fp, ProtoBuf::LogMetrics& metrics);
+    void dumpWriteCost(FILE* fp, ProtoBuf::LogMetrics& metrics);
+    double getAverageDiskCleaningThreads(ProtoBuf::LogMetrics& metrics);
+    double getDiskWriteCost(ProtoBuf::LogMetrics& metrics);
+    double getMemoryWriteCost(ProtoBuf::LogMetrics& metrics);
 
     RamCloud& ramcloud;
     string masterLocator;
@@ -1536,6 +1547,159 @@ Output::dumpSpinLockMetrics(FILE* fp, ProtoBuf::ServerStatistics& serverStats)
     }
 }
 
+/**
+ * Return the disk cleaner's write cost: the number of bytes written to
+ * backups, both new data and survivors, for each byte of new data. Returns 0
+ * if no disk space has been freed yet.
+ */
+double
+Output::getDiskWriteCost(ProtoBuf::LogMetrics& metrics)
+{
+    const ProtoBuf::LogMetrics_CleanerMetrics_OnDiskMetrics& onDiskMetrics =
+        metrics.cleaner_metrics().on_disk_metrics();
+    uint64_t freed = onDiskMetrics.total_disk_bytes_freed();
+    uint64_t wrote = onDiskMetrics.total_bytes_appended_to_survivors();
+    if (freed == 0)
+        return 0;
+    return d(freed + wrote) / d(freed);
+}
+
+/**
+ * Return the memory compactor's write cost, computed as in
+ * getDiskWriteCost(). Returns 0 if no memory has been compacted yet.
+ */
+double
+Output::getMemoryWriteCost(ProtoBuf::LogMetrics& metrics)
+{
+    const ProtoBuf::LogMetrics_CleanerMetrics_InMemoryMetrics&
+        inMemoryMetrics = metrics.cleaner_metrics().in_memory_metrics();
+    uint64_t freed = inMemoryMetrics.total_bytes_freed();
+    uint64_t wrote = inMemoryMetrics.total_bytes_appended_to_survivors();
+    if (freed == 0)
+        return 0;
+    return d(freed + wrote) / d(freed);
+}
+
+/**
+ * Return the average number of cleaner threads that were cleaning on disk
+ * while any disk cleaning was taking place at all.
+ */
+double
+Output::getAverageDiskCleaningThreads(ProtoBuf::LogMetrics& metrics)
+{
+    const ProtoBuf::LogMetrics_CleanerMetrics_ThreadMetrics& threadMetrics =
+        metrics.cleaner_metrics().thread_metrics();
+    double weighted = 0;
+    uint64_t busyTicks = 0;
+    for (int i = 1; i < threadMetrics.disk_cleaning_ticks_size(); i++) {
+        weighted += i * d(threadMetrics.disk_cleaning_ticks(i));
+        busyTicks += threadMetrics.disk_cleaning_ticks(i);
+    }
+    return (busyTicks == 0) ? 0 : weighted / d(busyTicks);
+}
+
+/**
+ * Summarize how write throughput relates to the number of cleaner threads
+ * the server ran with. Run the benchmark at several utilizations against
+ * servers started with different --logCleanerThreads values (see
+ * scripts/cleaner_scale.py) and compare these sections, or collect the
+ * one-line records written with --scalingFile.
+ */
+void
+Output::dumpScaling(FILE* fp, ProtoBuf::LogMetrics& metrics)
+{
+    double elapsed = Cycles::toSeconds(benchmark.stop - benchmark.start);
+
+    fprintf(fp, "===> CLEANER SCALING\n");
+
+    fprintf(fp, "  Cleaner Threads:               %u\n",
+        serverConfig.master().cleaner_thread_count());
+
+    fprintf(fp, "  Utilization:                   %d\n",
+        benchmark.options.utilization);
+
+    fprintf(fp, "  Write Throughput:              %.2f MB/sec  "
+        "(%.2f objs/sec)\n",
+        d(benchmark.totalBytesWritten) / elapsed / 1024 / 1024,
+        d(benchmark.totalObjectsWritten) / elapsed);
+
+    const ProtoBuf::LogMetrics_CleanerMetrics_OnDiskMetrics& onDiskMetrics =
+        metrics.cleaner_metrics().on_disk_metrics();
+    fprintf(fp, "  Disk Cleaning Passes:          %lu\n",
+        onDiskMetrics.total_runs());
+
+    fprintf(fp, "  Avg Concurrent Disk Cleaners:  %.2f\n",
+        getAverageDiskCleaningThreads(metrics));
+}
+
+/**
+ * Append a single line describing this run's cleaner thread count,
+ * utilization and write throughput to the given file. Repeated runs build up
+ * a table of throughput against cleaner thread count.
+ */
+void
+Output::appendScalingRecord(FILE* fp)
+{
+    double elapsed = Cycles::toSeconds(benchmark.stop - benchmark.start);
+    ProtoBuf::LogMetrics metrics;
+    ramcloud.getLogMetrics(masterLocator.c_str(), metrics);
+
+    fprintf(fp, "%u %d %.2f %.2f %.2f\n",
+        serverConfig.master().cleaner_thread_count(),
+        benchmark.options.utilization,
+        d(benchmark.totalBytesWritten) / elapsed / 1024 / 1024,
+        d(benchmark.totalObjectsWritten) / elapsed,
+        getAverageDiskCleaningThreads(metrics));
+}
+
+/**
+ * Summarize how much the cleaner had to write for this run's distribution.
+ * Run the benchmark with the zipfian and hotAndCold distributions against
+ * servers started with different --logCleanerAgeClasses values (see
+ * scripts/cleaner_age_classes.py) to see how well segregating survivors by
+ * age keeps long-lived data from being recleaned, or collect the one-line
+ * records written with --writeCostFile.
+ */
+void
+Output::dumpWriteCost(FILE* fp, ProtoBuf::LogMetrics& metrics)
+{
+    fprintf(fp, "===> CLEANER WRITE COST\n");
+
+    fprintf(fp, "  Distribution:                  %s\n",
+        benchmark.options.distributionName.c_str());
+
+    fprintf(fp, "  Utilization:                   %d\n",
+        benchmark.options.utilization);
+
+    fprintf(fp, "  Cleaner Age Classes:           %u\n",
+        serverConfig.master().cleaner_age_classes());
+
+    fprintf(fp, "  Disk Write Cost:               %.3f\n",
+        getDiskWriteCost(metrics));
+
+    fprintf(fp, "  Memory Write Cost:             %.3f\n",
+        getMemoryWriteCost(metrics));
+}
+
+/**
+ * Append a single line describing this run's distribution, utilization,
+ * cleaner age classes, and disk and memory write costs to the given file.
+ * Repeated runs build up a table of write cost against age classes.
+ */
+void
+Output::appendWriteCostRecord(FILE* fp)
+{
+    ProtoBuf::LogMetrics metrics;
+    ramcloud.getLogMetrics(masterLocator.c_str(), metrics);
+
+    fprintf(fp, "%s %d %u %.3f %.3f\n",
+        benchmark.options.distributionName.c_str(),
+        benchmark.options.utilization,
+        serverConfig.master().cleaner_age_classes(),
+        getDiskWriteCost(metrics),
+        getMemoryWriteCost(metrics));
+}
+
 void
 Output::dump()
 {
@@ -1552,6 +1716,8 @@ Output::dump()
         dumpMemoryMetrics(fp, metrics);
         dumpLogMetrics(fp, metrics);
         dumpSpinLockMetrics(fp, serverStats);
+        dumpScaling(fp, metrics);
+        dumpWriteCost(fp, metrics);
     }
 }
 
@@ -1693,6 +1859,19 @@ try
          "after the benchmark completes. This program will append \"-m.txt\" "
          ", \"-l.txt\", and \"-rp.txt/-rb.txt\" prefixes for metrics, latency, "
          "and raw prefill/benchmark files.")
+        ("scalingFile",
+         ProgramOptions::value<string>(&options.scalingFile)->
+           default_value(""),
+         "If given, append a line to this file once the benchmark completes "
+         "containing the server's cleaner thread count, the utilization, "
+         "write throughput in MB/sec and objects/sec, and the average number "
+         "of threads cleaning on disk at once.")
+        ("writeCostFile",
+         ProgramOptions::value<string>(&options.writeCostFile)->
+           default_value(""),
+         "If given, append a line to this file once the benchmark completes "
+         "containing the distribution, the utilization, the server's number "
+         "of cleaner age classes, and the disk and memory write costs.")
         ("objectsPerRpc,o",
          ProgramOptions::value<int>(&options.objectsPerRpc)->default_value(75),
          "Number of objects to write for each RPC sent to the server. If 1, "
@@ -1889,6 +2068,28 @@ try
     output.dump();
     output.dumpEnd();
 
+    if (options.scalingFile != "") {
+        FILE* scalingFile = fopen(options.scalingFile.c_str(), "a");
+        if (scalingFile == NULL) {
+            fprintf(stderr, "Couldn't open %s: %s\n",
+                options.scalingFile.c_str(), strerror(errno));
+        } else {
+            output.appendScalingRecord(scalingFile);
+            fclose(scalingFile);
+        }
+    }
+
+    if (options.writeCostFile != "") {
+        FILE* writeCostFile = fopen(options.writeCostFile.c_str(), "a");
+        if (writeCostFile == NULL) {
+            fprintf(stderr, "Couldn't open %s: %s\n",
+                options.writeCostFile.c_str(), strerror(errno));
+        } else {
+            output.appendWriteCostRecord(writeCostFile);
+            fclose(writeCostFile);
+        }
+    }
+
     if (latencyFile != NULL) {
         fprintf(latencyFile, "=== PREFILL LATENCIES ===\n");
         fprintf(latencyFile, "%s\n\n",
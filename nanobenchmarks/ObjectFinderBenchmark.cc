@@ -0,0 +1,192 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * A performance benchmark for client-side ObjectFinder lookups. It compares
+ * ObjectFinder::tryLookup, which searches the lock-free tablet directory,
+ * with ObjectFinder::lookupTablet, which searches tableMap under the
+ * ObjectFinder's lock, for various numbers of threads and tablets.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "Context.h"
+#include "Cycles.h"
+#include "FailSession.h"
+#include "ObjectFinder.h"
+#include "OptionParser.h"
+
+namespace RAMCloud {
+namespace {
+
+/// The table used for all lookups.
+const uint64_t TABLE_ID = 1;
+
+/// Tablets are spread round-robin across this many (fake) servers.
+const int NUM_SERVERS = 16;
+
+/**
+ * Supplies a table configuration with a given number of equal-sized
+ * tablets, all of which already have a session (so no transport is
+ * needed).
+ */
+class SplitTableFetcher : public ObjectFinder::TableConfigFetcher {
+  public:
+    explicit SplitTableFetcher(uint64_t numTablets)
+        : numTablets(numTablets)
+    {}
+
+    bool
+    tryGetTableConfig(uint64_t tableId,
+            std::map<TabletKey, TabletWithLocator>* tableMap,
+            std::multimap<std::pair<uint64_t, uint8_t>,
+                    IndexletWithLocator>* tableIndexMap)
+    {
+        uint64_t tabletSize = ~0lu / numTablets;
+        for (uint64_t i = 0; i < numTablets; i++) {
+            uint64_t start = i * tabletSize;
+            uint64_t end = (i == numTablets - 1) ? ~0lu
+                                                 : start + tabletSize - 1;
+            Tablet tablet(TABLE_ID, start, end, ServerId(), Tablet::NORMAL,
+                    LogPosition());
+            TabletWithLocator tabletWithLocator(tablet,
+                    format("fake:server=%lu", i % NUM_SERVERS));
+            tabletWithLocator.session = FailSession::get();
+            tableMap->emplace(TabletKey{TABLE_ID, start}, tabletWithLocator);
+        }
+        return true;
+    }
+
+    uint64_t numTablets;
+};
+
+/**
+ * Body of one benchmark thread: performs a number of lookups of random
+ * key hashes and returns the rate achieved.
+ *
+ * \param finder
+ *      ObjectFinder in which to look up the key hashes.
+ * \param locked
+ *      True means use lookupTablet (the locked path); false means use
+ *      tryLookup.
+ * \param count
+ *      Number of lookups to perform.
+ * \param[out] rate
+ *      Lookups per second achieved by this thread.
+ */
+void
+lookupThread(ObjectFinder* finder, bool locked, int count, double* rate)
+{
+    std::vector<KeyHash> hashes(count);
+    for (int i = 0; i < count; i++)
+        hashes[i] = generateRandom();
+
+    uint64_t start = Cycles::rdtsc();
+    if (locked) {
+        for (int i = 0; i < count; i++)
+            finder->lookupTablet(TABLE_ID, hashes[i]);
+    } else {
+        for (int i = 0; i < count; i++)
+            finder->tryLookup(TABLE_ID, hashes[i]);
+    }
+    *rate = count / Cycles::toSeconds(Cycles::rdtsc() - start);
+}
+
+/**
+ * Measure the aggregate lookup rate of a number of threads.
+ *
+ * \param finder
+ *      ObjectFinder to use; its tablets must already be cached.
+ * \param locked
+ *      See lookupThread.
+ * \param numThreads
+ *      Number of threads performing lookups concurrently.
+ * \param count
+ *      Number of lookups performed by each thread.
+ * \return
+ *      Total lookups per second across all threads.
+ */
+double
+lookupRate(ObjectFinder* finder, bool locked, int numThreads, int count)
+{
+    std::vector<double> rates(numThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++)
+        threads.emplace_back(lookupThread, finder, locked, count, &rates[i]);
+    double total = 0;
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+        total += rates[i];
+    }
+    return total;
+}
+
+void
+objectFinderBenchmark(Context* context, int maxThreads, int count)
+{
+    const uint64_t tabletCounts[] = {1, 16, 256, 4096};
+
+    printf("# Aggregate ObjectFinder lookups per second (millions), using "
+            "the lock-free\n"
+            "# tablet directory (tryLookup) and the locked tablet map "
+            "(lookupTablet).\n#\n");
+    printf("%8s %8s %12s %12s\n", "tablets", "threads", "lock-free",
+            "locked");
+    foreach (uint64_t numTablets, tabletCounts) {
+        ObjectFinder finder(context);
+        finder.setTableConfigFetcher(new SplitTableFetcher(numTablets));
+        finder.lookup(TABLE_ID, 0);
+
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            double lockFree = lookupRate(&finder, false, threads, count);
+            double locked = lookupRate(&finder, true, threads, count);
+            printf("%8lu %8d %12.2f %12.2f\n", numTablets, threads,
+                    lockFree / 1e06, locked / 1e06);
+        }
+    }
+}
+
+} // anonymous namespace
+} // namespace RAMCloud
+
+int
+main(int argc, char **argv)
+{
+    using namespace RAMCloud;
+
+    Context context(false);
+
+    int maxThreads, count;
+
+    OptionsDescription benchmarkOptions("ObjectFinderBenchmark");
+    benchmarkOptions.add_options()
+        ("maxThreads,t",
+         ProgramOptions::value<int>(&maxThreads)->
+            default_value(8),
+         "Largest number of concurrent threads to measure (the benchmark "
+         "doubles the count from 1 up to this)")
+        ("count,n",
+         ProgramOptions::value<int>(&count)->
+            default_value(1000000),
+         "Number of lookups performed by each thread");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    objectFinderBenchmark(&context, maxThreads, count);
+    return 0;
+}
@@ -13,8 +13,11 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "ClientException.h"
 #include "Cycles.h"
+#include "Enumeration.h"
 #include "Logger.h"
 #include "LogCleaner.h"
 #include "Memory.h"
@@ -42,7 +45,8 @@ class ObjectManagerBenchmark {
     ServerId serverId;
     ObjectManager* objectManager;
 
-    ObjectManagerBenchmark(string logSize, string hashTableSize)
+    ObjectManagerBenchmark(string logSize, string hashTableSize,
+                           bool tableObjectIndex = false)
         : context()
         , clusterClock()
         , clientLeaseValidator(&context, &clusterClock)
@@ -66,6 +70,7 @@ class ObjectManagerBenchmark {
         config.services = {};
         config.master.numReplicas = 0;
         config.master.disableLogCleaner = true;
+        config.master.tableObjectIndex = tableObjectIndex;
         config.segmentSize = Segment::DEFAULT_SEGMENT_SIZE;
         config.segletSize = Seglet::DEFAULT_SEGLET_SIZE;
         objectManager = new ObjectManager(&context,
@@ -105,15 +110,54 @@ class ObjectManagerBenchmark {
         (*stopCount)++;
     }
 
-    double
-    run(uint32_t numSegments, uint32_t dataBytes, uint32_t numThreads)
+    /**
+     * Phases of the resize benchmark; see #runResize().
+     */
+    enum ResizePhase { WAITING, BEFORE_RESIZE, DURING_RESIZE, DONE };
+
+    /**
+     * Reader thread for #runResize(): reads random objects until the
+     * benchmark is DONE, recording the latency of each read (in cycles) in
+     * \a before or \a during depending on the phase when it started.
+     */
+    static void
+    latencyReaderThreadEntry(ObjectManager* objectManager,
+                             uint64_t numKeys,
+                             std::atomic<int>* phase,
+                             std::vector<uint64_t>* before,
+                             std::vector<uint64_t>* during)
+    {
+        while (*phase == WAITING) {
+            // wait until master thread releases us
+        }
+
+        int currentPhase;
+        while ((currentPhase = *phase) != DONE) {
+            uint64_t keyInt = generateRandom() % numKeys;
+            Key key(0, &keyInt, sizeof(keyInt));
+            Buffer buffer;
+            uint64_t start = Cycles::rdtsc();
+            objectManager->readObject(key, &buffer, NULL, NULL);
+            uint64_t latency = Cycles::rdtsc() - start;
+            if (currentPhase == BEFORE_RESIZE)
+                before->push_back(latency);
+            else
+                during->push_back(latency);
+        }
+    }
+
+    /**
+     * Fill up 'numSegments' worth of segments in the log with objects of
+     * size 'dataBytes', with keys counting up from 0.
+     *
+     * \return
+     *      The number of objects written.
+     */
+    uint64_t
+    fill(uint32_t numSegments, uint32_t dataBytes)
     {
         tabletManager.addTablet(0, 0, ~0UL, TabletManager::NORMAL);
 
-        /*
-         * Fill up 'numSegments' worth of segments in the log with objects of
-         * size 'dataBytes'. These will be the objects that we will read.
-         */
         uint64_t nextKeyVal = 0;
         do {
             Key key(0, &nextKeyVal, sizeof(nextKeyVal));
@@ -128,6 +172,16 @@ class ObjectManagerBenchmark {
             }
             nextKeyVal++;
         } while (objectManager->log.head->id <= numSegments);
+        return nextKeyVal;
+    }
+
+    double
+    run(uint32_t numSegments, uint32_t dataBytes, uint32_t numThreads)
+    {
+        /*
+         * Fill the log with the objects that we will read.
+         */
+        uint64_t nextKeyVal = fill(numSegments, dataBytes);
 
         /*
          * Now "read" a bunch of random objects.
@@ -164,15 +218,262 @@ class ObjectManagerBenchmark {
                                    Cycles::toSeconds(stop - start));
     }
 
+    /**
+     * Measure read latency before and during an online resize of the hash
+     * table. Reader threads issue random reads for a short baseline period;
+     * then the calling thread doubles the hash table, migrating buckets the
+     * same way ObjectManager's HashTableResizer does, while the readers keep
+     * going. Prints latency percentiles for both periods.
+     */
+    void
+    runResize(uint32_t numSegments, uint32_t dataBytes, uint32_t numThreads)
+    {
+        uint64_t numKeys = fill(numSegments, dataBytes);
+        HashTable* objectMap = objectManager->getObjectMap();
+        uint64_t numBuckets = objectMap->getNumBuckets();
+        printf("%lu objects, %lu buckets, load factor %.3f\n",
+               numKeys, numBuckets, objectMap->getLoadFactor());
+
+        std::atomic<int> phase(WAITING);
+        std::vector<uint64_t> before[numThreads];
+        std::vector<uint64_t> during[numThreads];
+        std::thread* threads[numThreads];
+        for (uint32_t i = 0; i < numThreads; i++) {
+            threads[i] = new std::thread(latencyReaderThreadEntry,
+                                         objectManager,
+                                         numKeys,
+                                         &phase,
+                                         &before[i],
+                                         &during[i]);
+        }
+
+        phase = BEFORE_RESIZE;
+        usleep(500000);
+
+        uint64_t start = Cycles::rdtsc();
+        phase = DURING_RESIZE;
+        if (!objectManager->startHashTableResize(numBuckets * 2)) {
+            fprintf(stderr, "Failed to start hash table resize\n");
+            exit(1);
+        }
+        while (!objectManager->migrateHashTableBuckets(1000)) {
+            // keep going until the resize completes
+        }
+        uint64_t stop = Cycles::rdtsc();
+        phase = DONE;
+
+        for (uint32_t i = 0; i < numThreads; i++) {
+            threads[i]->join();
+            delete threads[i];
+        }
+
+        printf("resized to %lu buckets in %.1f ms, load factor %.3f\n",
+               objectMap->getNumBuckets(),
+               Cycles::toSeconds(stop - start) * 1e3,
+               objectMap->getLoadFactor());
+        printLatencies("before resize", before, numThreads);
+        printLatencies("during resize", during, numThreads);
+    }
+
+    /**
+     * Measure single-threaded read throughput for groups of random objects
+     * read the way multiRead does, with and without first prefetching each
+     * group's hash table buckets and log entries (see
+     * ObjectManager::prefetchObjects()).
+     *
+     * \param numSegments
+     *      Number of log segments to fill with objects.
+     * \param dataBytes
+     *      Size of each object's value.
+     * \param objectsPerRead
+     *      Number of objects in each simulated multiRead.
+     * \param prefetch
+     *      Whether to prefetch each group of objects before reading it.
+     * \return
+     *      Objects read per second.
+     */
+    double
+    runMultiRead(uint32_t numSegments, uint32_t dataBytes,
+                 uint32_t objectsPerRead, bool prefetch)
+    {
+        uint64_t numKeys = fill(numSegments, dataBytes);
+        const uint32_t batchSize = ObjectManager::READ_PREFETCH_BATCH;
+        const uint32_t numReads = 20000;
+        uint64_t keyInts[objectsPerRead];
+        const KeyLength keyLength = downCast<KeyLength>(sizeof(keyInts[0]));
+        Tub<Key> keys[objectsPerRead];
+        KeyHash keyHashes[objectsPerRead];
+        Buffer buffer;
+
+        uint64_t totalCycles = 0;
+        for (uint32_t r = 0; r < numReads; r++) {
+            for (uint32_t i = 0; i < objectsPerRead; i++)
+                keyInts[i] = generateRandom() % numKeys;
+            buffer.reset();
+
+            uint64_t start = Cycles::rdtsc();
+            for (uint32_t i = 0; i < objectsPerRead; i++) {
+                if (prefetch && i % batchSize == 0) {
+                    uint32_t n = std::min(batchSize, objectsPerRead - i);
+                    for (uint32_t j = i; j < i + n; j++) {
+                        keys[j].construct(0, &keyInts[j], keyLength);
+                        keyHashes[j] = keys[j]->getHash();
+                    }
+                    objectManager->prefetchObjects(&keyHashes[i], n);
+                } else if (!prefetch) {
+                    keys[i].construct(0, &keyInts[i], keyLength);
+                }
+                uint64_t version;
+                objectManager->readObject(*keys[i], &buffer, NULL, &version);
+            }
+            totalCycles += Cycles::rdtsc() - start;
+        }
+
+        return static_cast<double>(numReads) * objectsPerRead /
+               Cycles::toSeconds(totalCycles);
+    }
+
+    /**
+     * Measure how long it takes to enumerate, and then to drop, a small
+     * table on a master whose log is otherwise full of objects from a
+     * different table. Without the per-table index both operations scan
+     * the entire hash table; with it they only visit the small table's
+     * buckets.
+     *
+     * \param numSegments
+     *      Number of log segments to fill with objects from table 0.
+     * \param dataBytes
+     *      Size of each object's value.
+     * \param numSmallObjects
+     *      Number of objects to write to the small table (table 1).
+     */
+    void
+    runSmallTable(uint32_t numSegments, uint32_t dataBytes,
+                  uint32_t numSmallObjects)
+    {
+        fill(numSegments, dataBytes);
+        tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+        for (uint64_t i = 0; i < numSmallObjects; i++) {
+            Key key(1, &i, sizeof(i));
+            char objectData[dataBytes];
+            Buffer dataBuffer;
+            Object object(key, objectData, dataBytes, 0, 0, dataBuffer);
+            objectManager->writeObject(object, NULL, NULL);
+        }
+
+        uint64_t start = Cycles::rdtsc();
+        uint64_t numEnumerated = 0;
+        uint64_t nextTabletStartHash = 0;
+        Buffer iterBuffer;
+        Buffer payload;
+        do {
+            payload.reset();
+            EnumerationIterator iter(iterBuffer, 0, iterBuffer.size());
+            Enumeration enumeration(1, false, 0, 0, ~0UL,
+                                    &nextTabletStartHash, iter,
+                                    objectManager->log, *objectManager,
+                                    payload, 1024 * 1024);
+            enumeration.complete();
+            iterBuffer.reset();
+            iter.serialize(iterBuffer);
+            uint32_t offset = 0;
+            while (offset < payload.size()) {
+                offset += *payload.getOffset<uint32_t>(offset) +
+                          downCast<uint32_t>(sizeof(uint32_t));
+                numEnumerated++;
+            }
+        } while (payload.size() > 0);
+        uint64_t enumerateCycles = Cycles::rdtsc() - start;
+
+        tabletManager.deleteTablet(1, 0, ~0UL);
+        start = Cycles::rdtsc();
+        objectManager->removeOrphanedObjects(1, 0, ~0UL);
+        uint64_t dropCycles = Cycles::rdtsc() - start;
+
+        printf("  enumerated %lu objects in %.2f ms, dropped table in "
+               "%.2f ms\n", numEnumerated,
+               Cycles::toSeconds(enumerateCycles) * 1e3,
+               Cycles::toSeconds(dropCycles) * 1e3);
+    }
+
+    /**
+     * Print percentiles of the latencies collected by
+     * latencyReaderThreadEntry() for one phase of #runResize().
+     */
+    static void
+    printLatencies(const char* label, std::vector<uint64_t>* perThread,
+                   uint32_t numThreads)
+    {
+        std::vector<uint64_t> all;
+        for (uint32_t i = 0; i < numThreads; i++)
+            all.insert(all.end(), perThread[i].begin(), perThread[i].end());
+        if (all.empty()) {
+            printf("  %s: no reads\n", label);
+            return;
+        }
+        std::sort(all.begin(), all.end());
+        size_t n = all.size();
+        printf("  %s: %lu reads, median %.0f ns, 99%% %.0f ns, "
+               "99.9%% %.0f ns, max %.1f us\n", label, n,
+               Cycles::toSeconds(all[n / 2]) * 1e9,
+               Cycles::toSeconds(all[n * 99 / 100]) * 1e9,
+               Cycles::toSeconds(all[n * 999 / 1000]) * 1e9,
+               Cycles::toSeconds(all[n - 1]) * 1e6);
+    }
+
     DISALLOW_COPY_AND_ASSIGN(ObjectManagerBenchmark);
 };
 
 }  // namespace RAMCloud
 
 int
-main()
+main(int argc, char* argv[])
 {
     uint32_t numSegments = 600 / 8; // = 72.
+    std::string mode = (argc > 1) ? argv[1] : "read";
+
+    if (mode == "multiread") {
+        // Server-side cost of multiRead-style batches of random objects.
+        uint32_t batchSizes[] = { 1, 10, 100, 0 };
+        printf("======= multiRead batches, 100-byte Objects =======\n");
+        for (int i = 0; batchSizes[i] != 0; i++) {
+            double rates[2];
+            for (int prefetch = 0; prefetch < 2; prefetch++) {
+                RAMCloud::ObjectManagerBenchmark omb("2048", "10%");
+                rates[prefetch] = omb.runMultiRead(numSegments, 100,
+                                                   batchSizes[i], prefetch);
+            }
+            printf(" %3u objects/read: %.2f Mobjects/s without prefetch, "
+                   "%.2f Mobjects/s with prefetch (%.2fx)\n",
+                   batchSizes[i], rates[0] / 1e6, rates[1] / 1e6,
+                   rates[1] / rates[0]);
+        }
+        return 0;
+    } else if (mode == "resize") {
+        // Read latency while the hash table is grown underneath readers.
+        uint32_t resizeThreads[] = { 1, 4, 0 };
+        printf("======= Hash table resize, 100-byte Objects =======\n");
+        for (int i = 0; resizeThreads[i] != 0; i++) {
+            printf("%u reader thread(s):\n", resizeThreads[i]);
+            RAMCloud::ObjectManagerBenchmark omb("2048", "10%");
+            omb.runResize(numSegments, 100, resizeThreads[i]);
+        }
+        return 0;
+    } else if (mode == "smalltable") {
+        // Enumerate and drop a small table on a heavily loaded master.
+        printf("======= 1000-object table among 100-byte Objects =======\n");
+        for (int indexed = 0; indexed < 2; indexed++) {
+            printf("%s per-table index:\n", indexed ? "With" : "Without");
+            RAMCloud::ObjectManagerBenchmark omb("2048", "10%", indexed);
+            omb.runSmallTable(numSegments, 100, 1000);
+        }
+        return 0;
+    } else if (mode != "read") {
+        fprintf(stderr, "Usage: %s [read|multiread|resize|smalltable]\n",
+                argv[0]);
+        return 1;
+    }
+
     uint32_t threads[] = { 1, 2, 3, 4, 6, 8, 12, 16, 20, 24, 28, 32, 0 };
 
     printf("============ 100-byte Objects ==============\n");
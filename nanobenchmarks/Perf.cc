@@ -58,6 +58,7 @@
 #include "ClientException.h"
 #include "PerfHelper.h"
 #include "TimeTrace.h"
+#include "UdpDriver.h"
 #include "Util.h"
 
 using namespace RAMCloud;
@@ -1434,6 +1435,136 @@ double timeTrace()
     return Cycles::toSeconds(stop - start)/count;
 }
 
+/**
+ * Wait for packets to arrive on a UdpDriver and discard them.
+ *
+ * \param driver
+ *      Driver on which the packets will arrive.
+ * \param count
+ *      Number of packets to wait for.
+ * \param echo
+ *      If non-NULL, each packet is sent back to its sender using this
+ *      driver, with all of them in one transmit batch.
+ * \return
+ *      The number of packets received (less than count if some were lost).
+ */
+int udpReceive(UdpDriver* driver, int count, UdpDriver* echo = NULL)
+{
+    std::vector<Driver::Received> received;
+    int total = 0;
+    uint64_t deadline = Cycles::rdtsc() + Cycles::fromSeconds(0.1);
+    if (echo != NULL) {
+        echo->startTransmitBatch();
+    }
+    while ((total < count) && (Cycles::rdtsc() < deadline)) {
+        driver->receivePackets(count - total, &received);
+        if (echo != NULL) {
+            foreach (Driver::Received& packet, received) {
+                echo->sendPacket(packet.sender, packet.payload, packet.len,
+                        NULL);
+            }
+        }
+        total += downCast<int>(received.size());
+        received.clear();
+    }
+    if (echo != NULL) {
+        echo->flushTransmitBatch();
+    }
+    return total;
+}
+
+// Measure the cost per packet of sending bursts of 16 1400-byte packets
+// from one UdpDriver to another on this machine, as BasicTransport does
+// when it transmits a long message (packets/sec is the inverse). The
+// sender makes one kernel call per packet unless batch is true, in which
+// case each burst goes to the kernel in a single sendmmsg call.
+double udpSendShared(bool batch)
+{
+    Context context(false);
+    ServiceLocator receiverLocator("basic+udp:host=127.0.0.1,port=8198");
+    ServiceLocator senderLocator(format(
+            "basic+udp:host=127.0.0.1,port=8199,batch=%d", batch));
+    UdpDriver receiver(&context, &receiverLocator);
+    UdpDriver sender(&context, &senderLocator);
+    IpAddress receiverAddress(&receiverLocator);
+    char data[UdpDriver::MAX_PAYLOAD_SIZE - 8];
+    memset(data, 'x', sizeof(data));
+    Buffer payload;
+    payload.appendExternal(data, sizeof(data));
+
+    int count = 10000;
+    int burst = 16;
+    int packets = 0;
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        sender.startTransmitBatch();
+        for (int j = 0; j < burst; j++) {
+            Buffer::Iterator it(&payload);
+            sender.sendPacket(&receiverAddress, "header:", 8, &it);
+        }
+        sender.flushTransmitBatch();
+
+        // Wait for each burst to arrive so the socket buffer doesn't
+        // overflow.
+        packets += udpReceive(&receiver, burst);
+    }
+    uint64_t stop = Cycles::rdtsc();
+    return Cycles::toSeconds(stop - start)/packets;
+}
+
+double udpSend()
+{
+    return udpSendShared(false);
+}
+
+double udpSendBatch()
+{
+    return udpSendShared(true);
+}
+
+// Measure the round-trip time for a burst of 16 1400-byte packets between
+// two UdpDrivers on this machine, where the second driver echoes every
+// packet back to the first; batch determines whether both drivers pass
+// each burst to the kernel in a single sendmmsg call.
+double udpEchoShared(bool batch)
+{
+    Context context(false);
+    ServiceLocator serverLocator(format(
+            "basic+udp:host=127.0.0.1,port=8198,batch=%d", batch));
+    ServiceLocator clientLocator(format(
+            "basic+udp:host=127.0.0.1,port=8199,batch=%d", batch));
+    UdpDriver server(&context, &serverLocator);
+    UdpDriver client(&context, &clientLocator);
+    IpAddress serverAddress(&serverLocator);
+    char data[UdpDriver::MAX_PAYLOAD_SIZE];
+    memset(data, 'x', sizeof(data));
+
+    int count = 10000;
+    int burst = 16;
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        client.startTransmitBatch();
+        for (int j = 0; j < burst; j++) {
+            client.sendPacket(&serverAddress, data, sizeof(data), NULL);
+        }
+        client.flushTransmitBatch();
+        udpReceive(&server, burst, &server);
+        udpReceive(&client, burst);
+    }
+    uint64_t stop = Cycles::rdtsc();
+    return Cycles::toSeconds(stop - start)/count;
+}
+
+double udpEcho()
+{
+    return udpEchoShared(false);
+}
+
+double udpEchoBatch()
+{
+    return udpEchoShared(true);
+}
+
 // Measure the time to create and delete an entry in a small
 // unordered_map.
 double unorderedMapCreate()
@@ -1683,6 +1814,14 @@ TestInfo tests[] = {
      "Throw an Exception using ClientException::throwException"},
     {"timeTrace", timeTrace,
      "Record an event using TimeTrace"},
+    {"udpEcho", udpEcho,
+     "Echo 16 1400B packets over UdpDriver"},
+    {"udpEchoBatch", udpEchoBatch,
+     "Echo 16 1400B packets over UdpDriver, sendmmsg"},
+    {"udpSend", udpSend,
+     "Send 1400B packet over UdpDriver"},
+    {"udpSendBatch", udpSendBatch,
+     "Send 1400B packet over UdpDriver, sendmmsg"},
     {"unorderedMapCreate", unorderedMapCreate,
      "Create+delete entry in unordered_map"},
     {"unorderedMapLookup", unorderedMapLookup,
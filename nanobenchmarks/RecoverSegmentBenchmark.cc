@@ -18,6 +18,7 @@
 #include "Logger.h"
 #include "MasterService.h"
 #include "Memory.h"
+#include "RecoverySegmentBuilder.h"
 #include "SegmentIterator.h"
 #include "Seglet.h"
 #include "Tablets.pb.h"
@@ -28,6 +29,29 @@ namespace RAMCloud {
 class RecoverSegmentBenchmark {
 
   public:
+    /**
+     * A replica as seen by a backup during recovery, for partition().
+     * #data holds the replica as it is on storage; #loadBuffer is where
+     * doLoad() "reads" it to, publishing its progress in #loaded.
+     */
+    struct Replica {
+        Replica()
+            : data()
+            , length()
+            , certificate()
+            , loadBuffer()
+            , loaded()
+        {}
+
+        std::unique_ptr<char[]> data;
+        uint32_t length;
+        SegmentCertificate certificate;
+        std::unique_ptr<char[]> loadBuffer;
+        std::atomic<uint32_t> loaded;
+
+        DISALLOW_COPY_AND_ASSIGN(Replica);
+    };
+
     Context context;
     ServerConfig config;
     ServerList serverList;
@@ -38,6 +62,10 @@ class RecoverSegmentBenchmark {
     std::atomic<size_t> nReady;
     std::atomic<bool> go;
     std::atomic<size_t> nDone;
+    std::deque<Replica> replicas;
+    ProtoBuf::RecoveryPartition partitions;
+    std::atomic<size_t> nextReplica;
+    std::atomic<uint64_t> firstBuiltTicks;
 
     RecoverSegmentBenchmark(
         string logSize,
@@ -53,6 +81,10 @@ class RecoverSegmentBenchmark {
         , nReady{}
         , go{}
         , nDone{}
+        , replicas{}
+        , partitions{}
+        , nextReplica{}
+        , firstBuiltTicks{}
     {
         Logger::get().setLogLevels(WARNING);
         config.localLocator = "bogus";
@@ -253,6 +285,153 @@ if (metrics->temp.count##i.load()) { \
         DUMP_TEMP_COUNT(9);
     }
 
+    /**
+     * Act as the storage on a backup: copy each replica into its load
+     * buffer in 1 MB chunks, in order, no faster than \a storageMBps.
+     */
+    void
+    doLoad(double storageMBps)
+    {
+        const uint32_t chunkSize = 1024 * 1024;
+        uint64_t start = Cycles::rdtsc();
+        uint64_t bytesLoaded = 0;
+        for (Replica& replica : replicas) {
+            for (uint32_t offset = 0; offset < replica.length;
+                 offset += chunkSize) {
+                uint32_t bytes = std::min(chunkSize, replica.length - offset);
+                memcpy(replica.loadBuffer.get() + offset,
+                       replica.data.get() + offset, bytes);
+                bytesLoaded += bytes;
+                double due = static_cast<double>(bytesLoaded) /
+                             (storageMBps * 1024. * 1024.);
+                while (Cycles::toSeconds(Cycles::rdtsc() - start) < due)
+                    usleep(10);
+                replica.loaded = offset + bytes;
+            }
+        }
+    }
+
+    /**
+     * Build recovery segments for one replica; see partition().
+     */
+    void
+    buildReplica(Replica& replica, bool streaming)
+    {
+        std::unique_ptr<Segment[]> recoverySegments(
+                new Segment[partitions.tablet_size()]);
+        if (streaming) {
+            RecoverySegmentBuilder::buildStreaming(replica.loadBuffer.get(),
+                replica.length, replica.certificate,
+                partitions.tablet_size(), partitions, recoverySegments.get(),
+                [&replica] (uint32_t needed) {
+                    while (replica.loaded < needed)
+                        std::this_thread::yield();
+                    return replica.loaded.load();
+                });
+        } else {
+            while (replica.loaded < replica.length)
+                std::this_thread::yield();
+            RecoverySegmentBuilder::build(replica.loadBuffer.get(),
+                replica.length, replica.certificate,
+                partitions.tablet_size(), partitions, recoverySegments.get());
+        }
+        uint64_t unset = 0;
+        firstBuiltTicks.compare_exchange_strong(unset, Cycles::rdtsc());
+    }
+
+    void
+    doPartition(bool streaming)
+    {
+        size_t i;
+        while ((i = nextReplica++) < replicas.size())
+            buildReplica(replicas[i], streaming);
+    }
+
+    /**
+     * Time how long a backup takes to turn replicas of (some of) the
+     * segments built by run() into recovery segments while they are read
+     * from storage that delivers \a storageMBps. Compares the serial scheme
+     * (wait for a whole replica, then split it) with the pipelined one
+     * (\a nThreads threads each splitting a replica as it streams in; see
+     * BackupMasterRecovery) and reports, for each, when the first replica's
+     * recovery segments were ready and the overall partition throughput.
+     */
+    void
+    partition(size_t nThreads, size_t numReplicas, double storageMBps)
+    {
+        const int numPartitions = 4;
+        partitions.Clear();
+        uint64_t partitionSpan = ~0UL / numPartitions;
+        for (int p = 0; p < numPartitions; p++) {
+            ProtoBuf::Tablets::Tablet& tablet(*partitions.add_tablet());
+            tablet.set_table_id(0);
+            tablet.set_start_key_hash(p * partitionSpan);
+            tablet.set_end_key_hash(p == numPartitions - 1
+                                    ? ~0UL : (p + 1) * partitionSpan - 1);
+            tablet.set_state(ProtoBuf::Tablets::Tablet::NORMAL);
+            tablet.set_user_data(p);
+            tablet.set_ctime_log_head_id(0);
+            tablet.set_ctime_log_head_offset(0);
+        }
+
+        // Replicas on backups start with a segment header.
+        numReplicas = std::min(numReplicas, segments.size());
+        replicas.clear();
+        uint64_t totalBytes = 0;
+        for (size_t i = 0; i < numReplicas; i++) {
+            Segment segment;
+            SegmentHeader header(1, i, Segment::DEFAULT_SEGMENT_SIZE);
+            segment.append(LOG_ENTRY_TYPE_SEGHEADER, &header, sizeof(header));
+            for (SegmentIterator it(*segments[i]); !it.isDone(); it.next()) {
+                Buffer entry;
+                it.appendToBuffer(entry);
+                if (!segment.append(it.getType(), entry))
+                    break;
+            }
+
+            replicas.emplace_back();
+            Replica& replica = replicas.back();
+            Buffer buffer;
+            segment.appendToBuffer(buffer);
+            replica.length = segment.getAppendedLength(&replica.certificate);
+            replica.data.reset(new char[replica.length]);
+            buffer.copy(0, replica.length, replica.data.get());
+            replica.loadBuffer.reset(new char[replica.length]);
+            totalBytes += replica.length;
+        }
+
+        printf("Partitioning %lu replicas into %d recovery segments each, "
+               "read at %.0f MB/s\n", numReplicas, numPartitions, storageMBps);
+        for (int streaming = 0; streaming < 2; streaming++) {
+            size_t partitionThreads = streaming ? nThreads : 1;
+            for (Replica& replica : replicas)
+                replica.loaded = 0;
+            nextReplica = 0;
+            firstBuiltTicks = 0;
+
+            uint64_t before = Cycles::rdtsc();
+            std::thread loader(&RecoverSegmentBenchmark::doLoad, this,
+                               storageMBps);
+            std::deque<std::thread> threads{};
+            for (size_t i = 0; i < partitionThreads; ++i) {
+                threads.emplace_back(&RecoverSegmentBenchmark::doPartition,
+                                     this, streaming);
+            }
+            for (auto& thread : threads)
+                thread.join();
+            uint64_t ticks = Cycles::rdtsc() - before;
+            loader.join();
+
+            printf("%s (%lu threads): first recovery segments after %.1f ms, "
+                   "all after %.1f ms, %.2f MB/s\n",
+                   streaming ? "Pipelined" : "Serial", partitionThreads,
+                   Cycles::toSeconds(firstBuiltTicks - before) * 1000.,
+                   Cycles::toSeconds(ticks) * 1000.,
+                   static_cast<double>(totalBytes) /
+                   Cycles::toSeconds(ticks) / 1024. / 1024.);
+        }
+    }
+
     DISALLOW_COPY_AND_ASSIGN(RecoverSegmentBenchmark);
 };
 
@@ -270,6 +449,8 @@ main()
             printf("==========================\n");
             RAMCloud::RecoverSegmentBenchmark rsb("4096", "10%", numSegments);
             rsb.run(len, threads);
+            printf("\n");
+            rsb.partition(threads, 40, 500.);
         }
     }
 
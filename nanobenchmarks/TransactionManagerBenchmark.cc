@@ -0,0 +1,153 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * A performance benchmark for the prepared op tracking in TransactionManager.
+ * Each thread acts as a separate client: it buffers the prepared ops of a
+ * series of transactions, looks each one up again, and then removes them,
+ * which is the sequence of TransactionManager calls made by txPrepare and
+ * txDecision.  The aggregate rate is reported for various numbers of threads.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "Context.h"
+#include "Cycles.h"
+#include "OptionParser.h"
+#include "TransactionManager.h"
+#include "UnackedRpcResults.h"
+
+namespace RAMCloud {
+namespace {
+
+/**
+ * Body of one benchmark thread: prepares and then commits a number of
+ * transactions, and returns the rate achieved.
+ *
+ * \param manager
+ *      TransactionManager in which to track the prepared ops.
+ * \param leaseId
+ *      Lease id of the simulated client; each thread uses its own.
+ * \param count
+ *      Number of transactions to process.
+ * \param opsPerTx
+ *      Number of prepared ops in each transaction.
+ * \param[out] rate
+ *      Prepared ops per second achieved by this thread.
+ */
+void
+transactionThread(TransactionManager* manager, uint64_t leaseId, int count,
+        int opsPerTx, double* rate)
+{
+    uint64_t rpcId = 1;
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        TransactionId txId(leaseId, rpcId);
+        uint64_t firstRpcId = rpcId;
+        for (int j = 0; j < opsPerTx; j++, rpcId++)
+            manager->bufferOp(txId, rpcId, rpcId);
+        for (uint64_t id = firstRpcId; id < rpcId; id++)
+            manager->getOp(leaseId, id);
+        for (uint64_t id = firstRpcId; id < rpcId; id++)
+            manager->removeOp(leaseId, id);
+    }
+    *rate = static_cast<double>(count) * opsPerTx /
+            Cycles::toSeconds(Cycles::rdtsc() - start);
+}
+
+/**
+ * Measure the aggregate rate of a number of threads.
+ *
+ * \param context
+ *      Overall information about the (fake) server.
+ * \param numThreads
+ *      Number of threads processing transactions concurrently.
+ * \param count
+ *      Number of transactions processed by each thread.
+ * \param opsPerTx
+ *      Number of prepared ops in each transaction.
+ * \return
+ *      Total prepared ops per second across all threads.
+ */
+double
+transactionRate(Context* context, int numThreads, int count, int opsPerTx)
+{
+    UnackedRpcResults unackedRpcResults(context, NULL, NULL, NULL);
+    TransactionManager manager(context, NULL, &unackedRpcResults, NULL);
+
+    std::vector<double> rates(numThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(transactionThread, &manager, i + 1, count,
+                opsPerTx, &rates[i]);
+    }
+    double total = 0;
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+        total += rates[i];
+    }
+    return total;
+}
+
+void
+transactionManagerBenchmark(Context* context, int maxThreads, int count,
+        int opsPerTx)
+{
+    printf("# Aggregate prepared ops per second (millions) buffered, looked\n"
+            "# up, and removed by TransactionManager; %d ops per "
+            "transaction.\n#\n", opsPerTx);
+    printf("%8s %12s\n", "threads", "ops/sec");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double rate = transactionRate(context, threads, count, opsPerTx);
+        printf("%8d %12.2f\n", threads, rate / 1e06);
+    }
+}
+
+} // anonymous namespace
+} // namespace RAMCloud
+
+int
+main(int argc, char **argv)
+{
+    using namespace RAMCloud;
+
+    Context context(false);
+
+    int maxThreads, count, opsPerTx;
+
+    OptionsDescription benchmarkOptions("TransactionManagerBenchmark");
+    benchmarkOptions.add_options()
+        ("maxThreads,t",
+         ProgramOptions::value<int>(&maxThreads)->
+            default_value(8),
+         "Largest number of concurrent threads to measure (the benchmark "
+         "doubles the count from 1 up to this)")
+        ("count,n",
+         ProgramOptions::value<int>(&count)->
+            default_value(50000),
+         "Number of transactions processed by each thread")
+        ("opsPerTx,o",
+         ProgramOptions::value<int>(&opsPerTx)->
+            default_value(3),
+         "Number of prepared ops in each transaction");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    transactionManagerBenchmark(&context, maxThreads, count, opsPerTx);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * A performance benchmark for the duplicate detection in UnackedRpcResults.
+ * Each thread plays the part of a worker serving multiIncrement requests
+ * from its own set of clients: every increment in a request makes the
+ * checkDuplicate and recordCompletion calls issued by incrementObject, and
+ * acknowledges the client's previous RPC.  The aggregate rate is reported
+ * for various numbers of threads.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "ClientLeaseValidator.h"
+#include "ClusterClock.h"
+#include "Context.h"
+#include "Cycles.h"
+#include "OptionParser.h"
+#include "UnackedRpcResults.h"
+
+namespace RAMCloud {
+namespace {
+
+/**
+ * Discards the log references of acknowledged results; there is no log
+ * behind the benchmark.
+ */
+class NullFreer : public AbstractLog::ReferenceFreer {
+  public:
+    void freeLogEntry(AbstractLog::Reference ref) {}
+};
+
+/**
+ * Body of one benchmark thread: processes a number of multiIncrement
+ * requests, cycling through its clients, and returns the rate achieved.
+ *
+ * \param results
+ *      UnackedRpcResults in which to record the increments.
+ * \param firstClientId
+ *      Lease id of the first client served by this thread; the thread
+ *      uses the ids firstClientId to firstClientId + numClients - 1.
+ * \param numClients
+ *      Number of clients served by this thread.
+ * \param count
+ *      Number of multiIncrement requests to process.
+ * \param objectsPerRpc
+ *      Number of objects incremented by each request.
+ * \param[out] rate
+ *      Increments per second achieved by this thread.
+ */
+void
+incrementThread(UnackedRpcResults* results, uint64_t firstClientId,
+        int numClients, int count, int objectsPerRpc, double* rate)
+{
+    std::vector<uint64_t> nextRpcIds(numClients, 1);
+    WireFormat::ClientLease lease = {0, ~0lu, 0};
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        int client = i % numClients;
+        lease.leaseId = firstClientId + client;
+        for (int j = 0; j < objectsPerRpc; j++) {
+            uint64_t rpcId = nextRpcIds[client]++;
+            void* result;
+            results->checkDuplicate(lease, rpcId, rpcId - 1, &result);
+            results->recordCompletion(lease.leaseId, rpcId,
+                    reinterpret_cast<void*>(rpcId));
+        }
+    }
+    *rate = static_cast<double>(count) * objectsPerRpc /
+            Cycles::toSeconds(Cycles::rdtsc() - start);
+}
+
+/**
+ * Measure the aggregate rate of a number of threads.
+ *
+ * \param context
+ *      Overall information about the (fake) server.
+ * \param numThreads
+ *      Number of threads processing requests concurrently.
+ * \param clientsPerThread
+ *      Number of distinct clients served by each thread.
+ * \param count
+ *      Number of requests processed by each thread.
+ * \param objectsPerRpc
+ *      Number of objects incremented by each request.
+ * \return
+ *      Total increments per second across all threads.
+ */
+double
+incrementRate(Context* context, int numThreads, int clientsPerThread,
+        int count, int objectsPerRpc)
+{
+    ClusterClock clusterClock;
+    ClientLeaseValidator leaseValidator(context, &clusterClock);
+    NullFreer freer;
+    UnackedRpcResults results(context, &freer, &leaseValidator, NULL);
+
+    std::vector<double> rates(numThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(incrementThread, &results,
+                1 + i * clientsPerThread, clientsPerThread, count,
+                objectsPerRpc, &rates[i]);
+    }
+    double total = 0;
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+        total += rates[i];
+    }
+    return total;
+}
+
+void
+unackedRpcResultsBenchmark(Context* context, int maxThreads,
+        int clientsPerThread, int count, int objectsPerRpc)
+{
+    printf("# Aggregate increments per second (millions) checked and "
+            "recorded by\n# UnackedRpcResults; %d clients per thread, %d "
+            "objects per multiIncrement.\n#\n", clientsPerThread,
+            objectsPerRpc);
+    printf("%8s %12s\n", "threads", "incr/sec");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double rate = incrementRate(context, threads, clientsPerThread,
+                count, objectsPerRpc);
+        printf("%8d %12.2f\n", threads, rate / 1e06);
+    }
+}
+
+} // anonymous namespace
+} // namespace RAMCloud
+
+int
+main(int argc, char **argv)
+{
+    using namespace RAMCloud;
+
+    Context context(false);
+
+    int maxThreads, clientsPerThread, count, objectsPerRpc;
+
+    OptionsDescription benchmarkOptions("UnackedRpcResultsBenchmark");
+    benchmarkOptions.add_options()
+        ("maxThreads,t",
+         ProgramOptions::value<int>(&maxThreads)->
+            default_value(8),
+         "Largest number of concurrent threads to measure (the benchmark "
+         "doubles the count from 1 up to this)")
+        ("clients,c",
+         ProgramOptions::value<int>(&clientsPerThread)->
+            default_value(16),
+         "Number of distinct clients served by each thread")
+        ("count,n",
+         ProgramOptions::value<int>(&count)->
+            default_value(200000),
+         "Number of multiIncrement requests processed by each thread")
+        ("objectsPerRpc,o",
+         ProgramOptions::value<int>(&objectsPerRpc)->
+            default_value(4),
+         "Number of objects incremented by each multiIncrement");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    unackedRpcResultsBenchmark(&context, maxThreads, clientsPerThread, count,
+            objectsPerRpc);
+    return 0;
+}
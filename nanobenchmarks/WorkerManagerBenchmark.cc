@@ -0,0 +1,203 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * A performance benchmark for the way WorkerManager runs short RPCs. The
+ * benchmark thread acts as the dispatch thread of a server whose transport
+ * always has another READ request ready: it keeps a fixed number of
+ * requests outstanding, feeding them to WorkerManager::handleRpc, and polls
+ * the dispatcher for their replies. The (trivial) requests are run either
+ * by the worker threads or by stealing threads (see --stealingCores in
+ * ServerMain). For each configuration it prints the RPC rate and the
+ * dispatch thread's active time per RPC (in handleRpc or in polls that
+ * found work), which limits the rate a server can reach.
+ */
+
+#include <vector>
+
+#include "Common.h"
+#include "Context.h"
+#include "Cycles.h"
+#include "Dispatch.h"
+#include "OptionParser.h"
+#include "Service.h"
+#include "Transport.h"
+#include "WorkerManager.h"
+
+namespace RAMCloud {
+namespace {
+
+/**
+ * A master service that answers every request with an empty, successful
+ * response, so that only the cost of getting the request to a thread and
+ * the response back is measured.
+ */
+class NullService : public Service {
+  public:
+    NullService() {}
+    void dispatch(WireFormat::Opcode opcode, Rpc* rpc)
+    {
+        rpc->replyPayload->emplaceAppend<WireFormat::ResponseCommon>()->
+                status = STATUS_OK;
+    }
+    DISALLOW_COPY_AND_ASSIGN(NullService);
+};
+
+/**
+ * An incoming READ request. When its reply is sent, it is returned to the
+ * benchmark's list of free requests, to be issued again.
+ */
+class BenchmarkRpc : public Transport::ServerRpc {
+  public:
+    explicit BenchmarkRpc(std::vector<BenchmarkRpc*>* freeRpcs)
+        : freeRpcs(freeRpcs)
+    {
+        WireFormat::RequestCommon* header =
+                requestPayload.emplaceAppend<WireFormat::RequestCommon>();
+        header->opcode = WireFormat::READ;
+        header->service = WireFormat::MASTER_SERVICE;
+    }
+    void sendReply()
+    {
+        replyPayload.reset();
+        freeRpcs->push_back(this);
+    }
+    string getClientServiceLocator()
+    {
+        return "mock:";
+    }
+
+    /// Where this request goes once it has been answered.
+    std::vector<BenchmarkRpc*>* freeRpcs;
+
+    DISALLOW_COPY_AND_ASSIGN(BenchmarkRpc);
+};
+
+/**
+ * Run a number of requests through a WorkerManager and print the results.
+ *
+ * \param context
+ *      Overall information about the (fake) server; the calling thread
+ *      must be its dispatch thread.
+ * \param label
+ *      Describes the configuration in the output.
+ * \param maxCores
+ *      Passed to the WorkerManager constructor.
+ * \param stealingCores
+ *      Passed to the WorkerManager constructor.
+ * \param outstanding
+ *      Number of requests kept in progress at once.
+ * \param count
+ *      Total number of requests to run.
+ */
+void
+runRpcs(Context* context, const char* label, uint32_t maxCores,
+        uint32_t stealingCores, int outstanding, int count)
+{
+    WorkerManager* manager = new WorkerManager(context, maxCores,
+            stealingCores);
+    context->workerManager = manager;
+    Dispatch* dispatch = context->dispatch;
+
+    std::vector<BenchmarkRpc*> freeRpcs;
+    std::vector<BenchmarkRpc*> allRpcs;
+    for (int i = 0; i < outstanding; i++) {
+        allRpcs.push_back(new BenchmarkRpc(&freeRpcs));
+        freeRpcs.push_back(allRpcs.back());
+    }
+
+    uint64_t activeCycles = 0;
+    int issued = 0;
+    uint64_t start = Cycles::rdtsc();
+    while (issued < count || freeRpcs.size() < allRpcs.size()) {
+        uint64_t pollStart = Cycles::rdtsc();
+        if (dispatch->poll() != 0)
+            activeCycles += Cycles::rdtsc() - pollStart;
+        while (!freeRpcs.empty() && issued < count) {
+            BenchmarkRpc* rpc = freeRpcs.back();
+            freeRpcs.pop_back();
+            uint64_t handleStart = Cycles::rdtsc();
+            manager->handleRpc(rpc);
+            activeCycles += Cycles::rdtsc() - handleStart;
+            issued++;
+        }
+    }
+    double seconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+
+    printf("%-12s %6u %10.1f %12.2f\n", label,
+            (stealingCores != 0) ? stealingCores : maxCores,
+            count / seconds / 1e03,
+            Cycles::toSeconds(activeCycles) * 1e06 / count);
+
+    context->workerManager = NULL;
+    delete manager;
+    foreach (BenchmarkRpc* rpc, allRpcs)
+        delete rpc;
+}
+
+void
+workerManagerBenchmark(Context* context, uint32_t maxThreads,
+        int outstanding, int count)
+{
+    printf("# Trivial READ RPCs run by WorkerManager, with %d outstanding "
+            "at once.\n# Rate in thousands of RPCs per second; dispatch is "
+            "the dispatch\n# thread's active time per RPC in microseconds.\n"
+            "#\n", outstanding);
+    printf("%-12s %6s %10s %12s\n", "# mode", "cores", "Krpcs/sec",
+            "dispatch us");
+    for (uint32_t cores = 1; cores <= maxThreads; cores *= 2)
+        runRpcs(context, "workers", cores, 0, outstanding, count);
+    for (uint32_t cores = 1; cores <= maxThreads; cores *= 2)
+        runRpcs(context, "stealing", 1, cores, outstanding, count);
+}
+
+} // anonymous namespace
+} // namespace RAMCloud
+
+int
+main(int argc, char **argv)
+{
+    using namespace RAMCloud;
+
+    Context context(false);
+    NullService service;
+    context.services[WireFormat::MASTER_SERVICE] = &service;
+
+    uint32_t maxThreads;
+    int outstanding, count;
+
+    OptionsDescription benchmarkOptions("WorkerManagerBenchmark");
+    benchmarkOptions.add_options()
+        ("maxThreads,t",
+         ProgramOptions::value<uint32_t>(&maxThreads)->
+            default_value(4),
+         "Largest number of worker (or stealing) threads to measure (the "
+         "benchmark doubles the count from 1 up to this)")
+        ("outstanding,o",
+         ProgramOptions::value<int>(&outstanding)->
+            default_value(8),
+         "Number of requests in progress at once")
+        ("count,n",
+         ProgramOptions::value<int>(&count)->
+            default_value(200000),
+         "Number of requests run in each configuration");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    workerManagerBenchmark(&context, maxThreads, outstanding, count);
+    context.services[WireFormat::MASTER_SERVICE] = NULL;
+    return 0;
+}
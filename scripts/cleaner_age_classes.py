@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2016 Stanford University
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Generates data for a graph of cleaner write cost against the number of
+age classes the cleaner segregates survivors into.
+
+Runs LogCleanerBenchmark against a single master with the zipfian and
+hotAndCold (hot-spot) distributions at 80% and 90% memory utilization,
+restarting the cluster with a different --logCleanerAgeClasses for each
+run. Each run appends one line to the data file:
+distribution, utilization, age classes, disk write cost, memory write cost.
+"""
+
+from __future__ import division, print_function
+from common import *
+import cluster
+import config
+import os
+
+dataFile = '%s/logs/cleaner_age_classes.data' % top_path
+if os.path.exists(dataFile):
+    os.remove(dataFile)
+
+for distribution in ['zipfian', 'hotAndCold']:
+    for utilization in [80, 90]:
+        for ageClasses in [1, 2, 4]:
+            print('Running %s at %d%% utilization with %d age classes' %
+                  (distribution, utilization, ageClasses))
+            cluster.run(num_servers=4,
+                        master_args='--totalMasterMemory 4000 '
+                                    '--logCleanerAgeClasses %d' % ageClasses,
+                        client='%s/nanobenchmarks/LogCleanerBenchmark '
+                               '-d %s -u %d -m 120 --writeCostFile %s' %
+                               (config.hooks.get_remote_obj_path(),
+                                distribution, utilization, dataFile),
+                        timeout=1200)
+
+print(open(dataFile).read())
@@ -0,0 +1,49 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2016 Stanford University
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Generates data for a graph of write throughput against the number of
+log cleaner threads.
+
+Runs LogCleanerBenchmark against a single master at 80%, 90% and 95% memory
+utilization, restarting the cluster with a different --logCleanerThreads
+for each run. Each run appends one line to the data file:
+threads, utilization, MB/sec, objects/sec, average concurrent disk cleaners.
+"""
+
+from __future__ import division, print_function
+from common import *
+import cluster
+import config
+import os
+
+dataFile = '%s/logs/cleaner_scale.data' % top_path
+if os.path.exists(dataFile):
+    os.remove(dataFile)
+
+for utilization in [80, 90, 95]:
+    for threads in [1, 2, 4, 8]:
+        print('Running at %d%% utilization with %d cleaner threads' %
+              (utilization, threads))
+        cluster.run(num_servers=4,
+                    master_args='--totalMasterMemory 4000 '
+                                '--logCleanerThreads %d' % threads,
+                    client='%s/nanobenchmarks/LogCleanerBenchmark '
+                           '-u %d -m 120 --scalingFile %s' %
+                           (config.hooks.get_remote_obj_path(),
+                            utilization, dataFile),
+                    timeout=1200)
+
+print(open(dataFile).read())
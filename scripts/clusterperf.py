@@ -806,6 +806,8 @@ simple_tests = [
 ]
 
 graph_tests = [
+    Test("asyncBatching", default),
+    Test("asyncThroughput", default),
     Test("indexBasic", indexBasic),
     Test("indexRange", indexRange),
     Test("indexMultiple", indexMultiple),
@@ -836,6 +838,7 @@ graph_tests = [
     Test("writeDist", writeDist),
     Test("writeDistRandom", writeDist),
     Test("writeDistWorkload", workloadDist),
+    Test("writeGroupCommit", default),
     Test("writeInterference", default),
     Test("writeThroughput", readThroughput),
     Test("workloadThroughput", readThroughput),
@@ -46,6 +46,7 @@ callees = {
                              ["SPLIT_AND_MIGRATE_INDEXLET",
                               "TAKE_TABLET_OWNERSHIP",
                               "TAKE_INDEXLET_OWNERSHIP"],
+    "BUILD_INDEX":           ["INSERT_INDEX_ENTRIES"],
     "CREATE_INDEX":          ["TAKE_INDEXLET_OWNERSHIP",
                               "TAKE_TABLET_OWNERSHIP"],
     "CREATE_TABLE":          ["TAKE_TABLET_OWNERSHIP"],
@@ -55,6 +56,7 @@ callees = {
     "GET_HEAD_OF_LOG":       ["BACKUP_WRITE"],
     "HINT_SERVER_CRASHED":   ["PING"],
     "INCREMENT":             ["BACKUP_WRITE"],
+    "INSERT_INDEX_ENTRIES":  ["BACKUP_WRITE"],
     "INSERT_INDEX_ENTRY":    ["BACKUP_WRITE"],
     "MIGRATE_TABLET":        ["RECEIVE_MIGRATION_DATA",
                               "REASSIGN_TABLET_OWNERSHIP"],
@@ -64,6 +66,7 @@ callees = {
     "READ_HASHES":           ["BACKUP_WRITE"],
     "READ_KEYS_AND_VALUE":   ["BACKUP_WRITE"],
     "REASSIGN_TABLET_OWNERSHIP": ["TAKE_TABLET_OWNERSHIP"],
+    "RELAY_SERVER_LIST":     ["UPDATE_SERVER_LIST"],
     "RECEIVE_MIGRATION_DATA":["BACKUP_WRITE"],
     "RECOVER":               ["BACKUP_GETRECOVERYDATA", "BACKUP_WRITE"],
     "REMOVE":                ["BACKUP_WRITE", "REMOVE_INDEX_ENTRY"],
@@ -200,6 +200,56 @@ ProxyPingRpc::wait()
 }
 
 
+/**
+ * Constructor for ForwardServerListRpc: sends server list updates received
+ * in a RELAY_SERVER_LIST request on to another server (see
+ * AdminService::relayServerList). The RPC is initiated, but this method
+ * doesn't wait for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param serverId
+ *      Identifies the server to which the updates should be sent.
+ * \param updates
+ *      Buffer holding the updates to forward: a sequence of
+ *      UpdateServerList::Request::Part objects, each followed by its
+ *      serialized ProtoBuf::ServerList. Must not be modified or freed until
+ *      the RPC has completed.
+ * \param offset
+ *      Offset of the first Part in updates.
+ * \param length
+ *      Total number of bytes of Parts and server lists in updates.
+ */
+ForwardServerListRpc::ForwardServerListRpc(Context* context,
+        ServerId serverId, Buffer* updates, uint32_t offset, uint32_t length)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::UpdateServerList::Response))
+{
+    allocHeader<WireFormat::UpdateServerList>(serverId);
+    request.append(updates, offset, length);
+    send();
+}
+
+/**
+ * Wait for a ForwardServerListRpc to complete.
+ *
+ * \return
+ *      The server list version of the target server, after processing
+ *      the updates.
+ *
+ * \throw ServerNotUpException
+ *      The target server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+uint64_t
+ForwardServerListRpc::wait()
+{
+    waitAndCheckErrors();
+    const WireFormat::UpdateServerList::Response* respHdr(
+            getResponseHeader<WireFormat::UpdateServerList>());
+    return respHdr->currentVersion;
+}
+
 /**
  * This RPC is used to invoke a variety of miscellaneous operations on a server,
  * such as starting and stopping special timing mechanisms, dumping metrics, and
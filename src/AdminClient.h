@@ -98,6 +98,20 @@ class ProxyPingRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(ProxyPingRpc);
 };
 
+/**
+ * Used by a server that received a RELAY_SERVER_LIST request to forward
+ * its server list updates to one of the servers listed in the request.
+ */
+class ForwardServerListRpc : public ServerIdRpcWrapper {
+  public:
+    ForwardServerListRpc(Context* context, ServerId serverId,
+            Buffer* updates, uint32_t offset, uint32_t length);
+    ~ForwardServerListRpc() {}
+    uint64_t wait();
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ForwardServerListRpc);
+};
+
 /**
  * Encapsulates the state of a AdminClient::serverControl operation,
  * allowing it to execute asynchronously.
@@ -194,6 +194,65 @@ AdminService::proxyPing(const WireFormat::ProxyPing::Request* reqHdr,
     }
 }
 
+/**
+ * Top-level service method to handle the RELAY_SERVER_LIST request: applies
+ * the server list updates in the request, then forwards them with an
+ * UPDATE_SERVER_LIST RPC to each of the servers listed in the request and
+ * collects their results. The forwarded RPCs are of a lower level than this
+ * one, so waiting for them here can't cause a distributed deadlock.
+ *
+ * \copydetails Service::ping
+ */
+void
+AdminService::relayServerList(
+        const WireFormat::RelayServerList::Request* reqHdr,
+        WireFormat::RelayServerList::Response* respHdr,
+        Rpc* rpc)
+{
+    typedef WireFormat::RelayServerList::RelayResult RelayResult;
+    if (serverList == NULL) {
+        respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+        return;
+    }
+    uint32_t updatesStart = sizeof32(*reqHdr);
+    uint32_t reqLen = rpc->requestPayload->size();
+
+    // The ServerIds of the servers we must forward the updates to are at
+    // the very end of the request.
+    uint32_t count = reqHdr->relayCount;
+    uint64_t relayLength = uint64_t(count) * sizeof(uint64_t);
+    if (relayLength > reqLen - updatesStart) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+    uint32_t updatesEnd = reqLen - downCast<uint32_t>(relayLength);
+    applyServerLists(rpc->requestPayload, updatesStart, updatesEnd,
+            &respHdr->currentVersion);
+    if (count == 0)
+        return;
+    const uint64_t* ids = static_cast<const uint64_t*>(
+            rpc->requestPayload->getRange(updatesEnd,
+            downCast<uint32_t>(relayLength)));
+
+    // Start all of the forwarding RPCs before waiting for any of them.
+    std::vector<Tub<ForwardServerListRpc>> rpcs(count);
+    for (uint32_t i = 0; i < count; i++) {
+        rpcs[i].construct(context, ServerId(ids[i]), rpc->requestPayload,
+                updatesStart, updatesEnd - updatesStart);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        RelayResult result = {ids[i], 0};
+        try {
+            result.currentVersion = rpcs[i]->wait();
+        } catch (const ClientException& e) {
+            // The coordinator will send this server the update itself.
+            LOG(NOTICE, "Couldn't relay server list update to %s: %s",
+                    ServerId(ids[i]).toString().c_str(), e.toSymbol());
+        }
+        rpc->replyPayload->appendCopy(&result);
+    }
+}
+
 /**
  * Top-level service method to handle the SERVER_CONTROL request.
  *
@@ -321,6 +380,8 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
             PerfStats::collectStats(&stats);
             context->getMasterService()->objectManager.getLog()
                    ->getMemoryStats(&stats);
+            context->getMasterService()->objectManager
+                   .getHashTableStats(&stats);
             respHdr->outputLength = sizeof32(stats);
             rpc->replyPayload->appendCopy(&stats, respHdr->outputLength);
             break;
@@ -371,6 +432,24 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
             }
             break;
         }
+        case WireFormat::SET_GROUP_COMMIT_WINDOW:
+        {
+            if (reqHdr->inputLength < sizeof32(uint32_t)
+                    || inputData == NULL) {
+                respHdr->common.status = STATUS_MESSAGE_TOO_SHORT;
+                return;
+            }
+            if (context->getMasterService() == NULL) {
+                respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+                return;
+            }
+            const uint32_t* microseconds =
+                    static_cast<const uint32_t*>(inputData);
+            context->getMasterService()->objectManager.getLog()
+                   ->setGroupCommitWindow(*microseconds);
+            LOG(NOTICE, "Group commit window set to %u us", *microseconds);
+            break;
+        }
         case WireFormat::RESET_METRICS:
         {
             TimeTrace::reset();
@@ -407,19 +486,38 @@ AdminService::updateServerList(
         respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
         return;
     }
-    uint32_t reqOffset = sizeof32(*reqHdr);
-    uint32_t reqLen = rpc->requestPayload->size();
+    applyServerLists(rpc->requestPayload, sizeof32(*reqHdr),
+            rpc->requestPayload->size(), &respHdr->currentVersion);
+}
 
+/**
+ * Helper for updateServerList and relayServerList: applies each of the
+ * server lists in a request to our server list.
+ *
+ * \param request
+ *      The entire request.
+ * \param offset
+ *      Offset in request of the first UpdateServerList::Request::Part.
+ * \param end
+ *      Offset in request just past the last server list.
+ * \param[out] currentVersion
+ *      Set to the version of our server list after applying each update;
+ *      left unchanged if there are none.
+ */
+void
+AdminService::applyServerLists(Buffer* request, uint32_t offset,
+        uint32_t end, uint64_t* currentVersion)
+{
     // Repeatedly apply the server lists in the RPC while we haven't reached
     // the end of the RPC.
-    while (reqOffset < reqLen) {
+    while (offset < end) {
         ProtoBuf::ServerList list;
-        auto* part = rpc->requestPayload->getOffset<
-                    WireFormat::UpdateServerList::Request::Part>(reqOffset);
-        reqOffset += sizeof32(*part);
+        auto* part = request->getOffset<
+                    WireFormat::UpdateServerList::Request::Part>(offset);
+        offset += sizeof32(*part);
 
         // Bounds check on rpc size.
-        if (part == NULL || reqOffset + part->serverListLength > reqLen) {
+        if (part == NULL || offset + part->serverListLength > end) {
             LOG(WARNING, "A partial UpdateServerList request is detected. "
                     "Perhaps limit the number of ProtoBufs the Coordinator"
                     "ServerList can batch into one rpc.");
@@ -428,10 +526,10 @@ AdminService::updateServerList(
 
 
         // Check passed, parse server list and apply.
-        ProtoBuf::parseFromRequest(rpc->requestPayload, reqOffset,
-                                   part->serverListLength, &list);
-        reqOffset += part->serverListLength;
-        respHdr->currentVersion = serverList->applyServerList(list);
+        ProtoBuf::parseFromRequest(request, offset, part->serverListLength,
+                                   &list);
+        offset += part->serverListLength;
+        *currentVersion = serverList->applyServerList(list);
     }
 }
 
@@ -466,6 +564,10 @@ AdminService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::ProxyPing, AdminService,
                         &AdminService::proxyPing>(rpc);
             break;
+        case WireFormat::RelayServerList::opcode:
+            callHandler<WireFormat::RelayServerList, AdminService,
+                &AdminService::relayServerList>(rpc);
+            break;
         case WireFormat::ServerControl::opcode:
             callHandler<WireFormat::ServerControl, AdminService,
                         &AdminService::serverControl>(rpc);
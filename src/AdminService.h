@@ -52,12 +52,17 @@ class AdminService : public Service {
     void proxyPing(const WireFormat::ProxyPing::Request* reqHdr,
             WireFormat::ProxyPing::Response* respHdr,
             Rpc* rpc);
+    void relayServerList(const WireFormat::RelayServerList::Request* reqHdr,
+            WireFormat::RelayServerList::Response* respHdr,
+            Rpc* rpc);
     void serverControl(const WireFormat::ServerControl::Request* reqHdr,
             WireFormat::ServerControl::Response* respHdr,
             Rpc* rpc);
     void updateServerList(const WireFormat::UpdateServerList::Request* reqHdr,
                        WireFormat::UpdateServerList::Response* respHdr,
                        Rpc* rpc);
+    void applyServerLists(Buffer* request, uint32_t offset, uint32_t end,
+                       uint64_t* currentVersion);
 
     /// Shared RAMCloud information.
     Context* context;
@@ -273,6 +273,57 @@ TEST_F(AdminServiceTest, proxyPing_timeout) {
     EXPECT_LE(elapsedMicros, 2000.0);
 }
 
+TEST_F(AdminServiceTest, relayServerList) {
+    typedef WireFormat::RelayServerList::RelayResult RelayResult;
+    Lock lock(mutex); // Lock used to trick internal calls
+    Context context2;
+    context2.externalStorage = &storage;
+    CoordinatorService coordinatorService(&context2, 1000, true);
+    CoordinatorServerList* source(context2.coordinatorServerList);
+    source->haltUpdater();
+    ServerId id1 = source->enlistServer({WireFormat::MASTER_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 100, "mock:host=ping");
+    ProtoBuf::ServerList fullList;
+    source->serialize(&fullList, {WireFormat::MASTER_SERVICE,
+            WireFormat::BACKUP_SERVICE});
+
+    // Forward the update back to ourselves and to a server that doesn't
+    // exist.
+    CoordinatorServerList::UpdateServerListRpc
+        rpc(&context, serverId, &fullList, true);
+    rpc.relayTargets = {id1, ServerId(99)};
+    rpc.setRelayTargets();
+    rpc.send();
+    rpc.waitAndCheckErrors();
+    const WireFormat::RelayServerList::Response* respHdr(
+            rpc.getResponseHeader<WireFormat::RelayServerList>());
+    EXPECT_EQ(1lu, respHdr->currentVersion);
+    ASSERT_EQ(sizeof32(*respHdr) + 2 * sizeof32(RelayResult),
+            rpc.response->size());
+    const RelayResult* results = static_cast<const RelayResult*>(
+            rpc.response->getRange(sizeof32(*respHdr),
+            2 * sizeof32(RelayResult)));
+    EXPECT_EQ(id1.getId(), results[0].serverId);
+    EXPECT_EQ(1lu, results[0].currentVersion);
+    EXPECT_EQ(ServerId(99).getId(), results[1].serverId);
+    EXPECT_EQ(0lu, results[1].currentVersion);
+    EXPECT_NE(string::npos, TestLog::get().find(
+            "relayServerList: Couldn't relay server list update to 99.0"));
+}
+
+TEST_F(AdminServiceTest, relayServerList_badRelayCount) {
+    ProtoBuf::ServerList list;
+    list.set_version_number(1);
+    list.set_type(ProtoBuf::ServerList_Type_FULL_LIST);
+    CoordinatorServerList::UpdateServerListRpc
+        rpc(&context, serverId, &list, true);
+    rpc.setRelayTargets();
+    rpc.request.getStart<WireFormat::RelayServerList::Request>()
+            ->relayCount = 1000;
+    rpc.send();
+    EXPECT_THROW(rpc.waitAndCheckErrors(), RequestFormatError);
+}
+
 TEST_F(AdminServiceTest, serverControl_ObjectServerControl_Basic) {
     // Everything works EXPECT STATUS_UNIMPLEMENTED_REQUEST
     AdminServiceTest::addMasterService();
@@ -622,6 +673,22 @@ TEST_F(AdminServiceTest, serverControl_addLogMessage_bad) {
                 &output), ClientException);
 }
 
+TEST_F(AdminServiceTest, serverControl_setGroupCommitWindow) {
+    uint32_t window = 20;
+    EXPECT_THROW(AdminClient::serverControl(&context, serverId,
+            WireFormat::SET_GROUP_COMMIT_WINDOW, &window, sizeof32(window)),
+            ClientException);
+
+    addMasterService();
+    EXPECT_THROW(AdminClient::serverControl(&context, serverId,
+            WireFormat::SET_GROUP_COMMIT_WINDOW, &window, 2),
+            ClientException);
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::SET_GROUP_COMMIT_WINDOW, &window, sizeof32(window));
+    EXPECT_EQ(Cycles::fromMicroseconds(20), masterService->objectManager
+            .getLog()->groupCommitWindowCycles.load());
+}
+
 TEST_F(AdminServiceTest, serverControl_resetMetrics) {
     Buffer output;
 
@@ -0,0 +1,875 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <utility>
+
+#include "AsyncClient.h"
+#include "ClientException.h"
+#include "Cycles.h"
+#include "MultiRead.h"
+#include "MultiWrite.h"
+#include "ObjectFinder.h"
+
+namespace RAMCloud {
+
+/**
+ * An RPC of type T that also tells a Transport::RpcNotifier (an
+ * AsyncClient::Op::Notifier) whenever the transport reports that the RPC has
+ * completed or failed, so that AsyncClient::poll need only check RPCs that
+ * may have made progress. A transport that finishes the RPC while T's
+ * constructor is still sending it notifies T alone, so callers must check
+ * each new RPC once regardless (see AsyncClient::activate).
+ */
+template<typename T>
+class NotifyingRpc : public T {
+  public:
+    template<typename... Args>
+    explicit NotifyingRpc(Transport::RpcNotifier* notifier, Args&&... args)
+        : T(std::forward<Args>(args)...)
+        , notifier(notifier)
+    {}
+
+    void
+    completed()
+    {
+        T::completed();
+        notifier->completed();
+    }
+
+    void
+    failed()
+    {
+        T::failed();
+        notifier->failed();
+    }
+
+    /// Return true if the RPC has been sent and the transport hasn't yet
+    /// reported on it, so isReady can't make progress until it does.
+    bool
+    waitingForResponse()
+    {
+        return this->getState() == RpcWrapper::IN_PROGRESS;
+    }
+
+  PRIVATE:
+    /// Told about each completion or failure after T has recorded it.
+    Transport::RpcNotifier* notifier;
+
+    DISALLOW_COPY_AND_ASSIGN(NotifyingRpc);
+};
+
+/**
+ * State for one operation; a slot in the pool. Exactly one of the RPC Tubs
+ * holds an RPC while the operation is in progress, unless the operation is
+ * part of a batch. A slot may also hold a batch itself, in which case
+ * #members lists the operations in it. (This is defined here
+ * rather than in the header so that AsyncClient.h doesn't depend on
+ * MultiOp.h, whose class name collides with the MultiOp enum in
+ * CRamCloud.h.)
+ */
+struct AsyncClient::Op {
+    /**
+     * Invoked by an operation's RPCs when the transport reports that they
+     * have completed or failed; adds the operation's slot to
+     * AsyncClient::ready.
+     */
+    struct Notifier : public Transport::RpcNotifier {
+        Notifier(AsyncClient* client, uint32_t slot)
+            : client(client)
+            , slot(slot)
+        {}
+
+        void
+        completed()
+        {
+            client->markReady(slot);
+        }
+
+        void
+        failed()
+        {
+            client->markReady(slot);
+        }
+
+        /// The AsyncClient whose pool the slot belongs to.
+        AsyncClient* client;
+
+        /// Index of the slot in AsyncClient::ops.
+        uint32_t slot;
+
+        DISALLOW_COPY_AND_ASSIGN(Notifier);
+    };
+
+    Op(AsyncClient* client, uint32_t slot)
+        : notifier(client, slot)
+        , ready(false)
+        , readRpc()
+        , writeRpc()
+        , multiRead()
+        , multiWrite()
+        , callback(NULL)
+        , arg(NULL)
+        , generation(0)
+        , completed(false)
+        , status(STATUS_OK)
+        , version(0)
+        , isBatch(false)
+        , batched(false)
+        , batchDone(false)
+        , write(false)
+        , key()
+        , data()
+        , rejectRules()
+        , hasRejectRules(false)
+        , value(NULL)
+        , objectBuffer()
+        , readObject()
+        , writeObject()
+        , members()
+        , readRequests()
+        , writeRequests()
+    {}
+
+    /// Passed to this operation's RPCs.
+    Notifier notifier;
+
+    /// True if poll() should check this slot: it has an entry in
+    /// AsyncClient::ready or AsyncClient::recheck. Cleared when the slot
+    /// is freed, which makes any entry still in those lists stale.
+    bool ready;
+
+    Tub<NotifyingRpc<ReadRpc>> readRpc;
+    Tub<NotifyingRpc<WriteRpc>> writeRpc;
+    Tub<MultiRead> multiRead;
+    Tub<MultiWrite> multiWrite;
+
+    /// Invoked by poll() when the operation completes; may be NULL.
+    Callback callback;
+
+    /// Passed to #callback.
+    void* arg;
+
+    /// Incremented each time the slot is recycled.
+    uint32_t generation;
+
+    /// True once the operation has completed, until the slot is
+    /// recycled; #status and #version are then valid.
+    bool completed;
+
+    /// Outcome of the operation.
+    Status status;
+
+    /// Version of the object read or written.
+    uint64_t version;
+
+    /// True if this slot holds a batch rather than an operation issued by
+    /// the application.
+    bool isBatch;
+
+    /// True if this operation is part of a batch: its arguments are in
+    /// #readObject or #writeObject rather than an RPC.
+    bool batched;
+
+    /// True once the batch containing this operation has completed.
+    bool batchDone;
+
+    /// For batched operations and batches: true for writes, false for
+    /// reads.
+    bool write;
+
+    /// The following fields hold copies of a batched operation's
+    /// arguments, since the caller's need not remain valid until the batch
+    /// is sent. Their storage is reused along with the slot.
+    string key;
+    string data;
+    RejectRules rejectRules;
+    bool hasRejectRules;
+
+    /// Where to return the value of a batched read.
+    Buffer* value;
+
+    /// Receives the object for a batched read.
+    Tub<ObjectBuffer> objectBuffer;
+
+    /// Describes a batched read or write for the MultiOp.
+    MultiReadObject readObject;
+    MultiWriteObject writeObject;
+
+    /// For batches: slots of the operations in the batch, and the
+    /// corresponding request arrays passed to the MultiOp.
+    std::vector<uint32_t> members;
+    std::vector<MultiReadObject*> readRequests;
+    std::vector<MultiWriteObject*> writeRequests;
+
+    /**
+     * Save a copy of an operation's key and reject rules for batching.
+     */
+    void
+    saveArgs(const void* key, uint16_t keyLength,
+            const RejectRules* rejectRules)
+    {
+        this->key.assign(static_cast<const char*>(key), keyLength);
+        hasRejectRules = (rejectRules != NULL);
+        if (hasRejectRules)
+            this->rejectRules = *rejectRules;
+    }
+
+    /// Return the saved reject rules, or NULL if there were none.
+    const RejectRules*
+    savedRejectRules()
+    {
+        return hasRejectRules ? &rejectRules : NULL;
+    }
+
+    /**
+     * Return true if an operation that AsyncClient::finish found still in
+     * progress can't make progress until one of its RPCs is reported
+     * complete or failed (or, for a batched operation, until its batch
+     * completes); false if it must be checked again on the next poll.
+     */
+    bool
+    waitingForResponse()
+    {
+        if (batched)
+            return true;
+        if (readRpc)
+            return readRpc->waitingForResponse();
+        if (writeRpc)
+            return writeRpc->waitingForResponse();
+        if (multiRead)
+            return multiRead->responsesPending();
+        if (multiWrite)
+            return multiWrite->responsesPending();
+        return false;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(Op);
+};
+
+/**
+ * Construct an AsyncClient.
+ *
+ * \param ramcloud
+ *      The RAMCloud object used to issue operations. All operations and
+ *      calls to poll() must be made from the thread that owns it.
+ * \param initialSlots
+ *      Number of operation slots to allocate up front; typically the
+ *      maximum number of operations the application keeps outstanding.
+ *      More are allocated as needed.
+ */
+AsyncClient::AsyncClient(RamCloud* ramcloud, uint32_t initialSlots)
+    : ramcloud(ramcloud)
+    , ops()
+    , freeSlots()
+    , activeOps(0)
+    , ready()
+    , recheck()
+    , maxBatchSize(0)
+    , maxBatchDelay(0)
+    , pending()
+    , batchedOps(0)
+    , activeBatches(0)
+{
+    ops.reserve(initialSlots);
+    freeSlots.reserve(initialSlots);
+    ready.reserve(initialSlots);
+    for (uint32_t i = 0; i < initialSlots; i++)
+        ops.push_back(new Op(this, i));
+    for (uint32_t i = initialSlots; i > 0; i--)
+        freeSlots.push_back(i - 1);
+}
+
+/**
+ * Destroy an AsyncClient. Any operations still in progress are canceled
+ * without invoking their callbacks.
+ */
+AsyncClient::~AsyncClient()
+{
+    for (size_t i = 0; i < ops.size(); i++) {
+        Op* op = ops[i];
+        if (op->readRpc)
+            op->readRpc->cancel();
+        if (op->writeRpc)
+            op->writeRpc->cancel();
+        if (op->multiRead)
+            op->multiRead->cancel();
+        if (op->multiWrite)
+            op->multiWrite->cancel();
+    }
+    for (size_t i = 0; i < ops.size(); i++)
+        delete ops[i];
+}
+
+/**
+ * Start reading an object; the arguments are the same as for
+ * RamCloud::read, plus an optional callback.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId. Need not remain valid after this method returns.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After the operation completes successfully, this will hold the
+ *      contents of the object. Must remain valid until then.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read should be
+ *      aborted with an error.
+ * \param callback
+ *      If non-NULL, invoked from poll() once the read completes.
+ * \param arg
+ *      Passed to \a callback.
+ * \return
+ *      A Future for the result of the read.
+ */
+AsyncClient::Future
+AsyncClient::readAsync(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, const RejectRules* rejectRules,
+        Callback callback, void* arg)
+{
+    uint32_t slot = allocSlot(callback, arg);
+    Op* op = ops[slot];
+    if (maxBatchSize > 0) {
+        op->saveArgs(key, keyLength, rejectRules);
+        op->value = value;
+        op->readObject = MultiReadObject(tableId, op->key.data(), keyLength,
+                &op->objectBuffer, op->savedRejectRules());
+        if (addToBatch(slot, tableId, false))
+            return Future(this, slot, op->generation);
+    }
+    op->readRpc.construct(&op->notifier, ramcloud, tableId, key, keyLength,
+            value, rejectRules);
+    activate(slot);
+    return Future(this, slot, op->generation);
+}
+
+/**
+ * Start writing an object; the arguments are the same as for
+ * RamCloud::write, plus an optional callback.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId. Need not remain valid after this method returns.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Contents for the object. Need not remain valid after this method
+ *      returns.
+ * \param length
+ *      Size in bytes of the new contents for the object.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the write should be
+ *      aborted with an error.
+ * \param callback
+ *      If non-NULL, invoked from poll() once the write completes.
+ * \param arg
+ *      Passed to \a callback.
+ * \return
+ *      A Future for the result of the write.
+ */
+AsyncClient::Future
+AsyncClient::writeAsync(uint64_t tableId, const void* key, uint16_t keyLength,
+        const void* buf, uint32_t length, const RejectRules* rejectRules,
+        Callback callback, void* arg)
+{
+    uint32_t slot = allocSlot(callback, arg);
+    Op* op = ops[slot];
+    if (maxBatchSize > 0) {
+        op->saveArgs(key, keyLength, rejectRules);
+        op->data.assign(static_cast<const char*>(buf), length);
+        op->writeObject = MultiWriteObject(tableId, op->key.data(), keyLength,
+                op->data.data(), length, op->savedRejectRules());
+        if (addToBatch(slot, tableId, true))
+            return Future(this, slot, op->generation);
+    }
+    op->writeRpc.construct(&op->notifier, ramcloud, tableId, key, keyLength,
+            buf, length, rejectRules);
+    activate(slot);
+    return Future(this, slot, op->generation);
+}
+
+/**
+ * Start reading several objects at once; see RamCloud::multiRead.
+ *
+ * \param requests
+ *      Each element describes one object to read, and receives its
+ *      value and status. The array and its elements must remain valid
+ *      until the operation completes.
+ * \param numRequests
+ *      Number of elements in \a requests.
+ * \param callback
+ *      If non-NULL, invoked from poll() once all of the objects have
+ *      been read.
+ * \param arg
+ *      Passed to \a callback.
+ * \return
+ *      A Future for the completion of the operation.
+ */
+AsyncClient::Future
+AsyncClient::multiReadAsync(MultiReadObject* const requests[],
+        uint32_t numRequests, Callback callback, void* arg)
+{
+    uint32_t slot = allocSlot(callback, arg);
+    ops[slot]->multiRead.construct(ramcloud, requests, numRequests);
+    ops[slot]->multiRead->setNotifier(&ops[slot]->notifier);
+    activate(slot);
+    return Future(this, slot, ops[slot]->generation);
+}
+
+/**
+ * Make progress on outstanding operations: poll the dispatcher once, then
+ * complete any operations whose RPCs have finished, invoking their
+ * callbacks. Only operations in #ready (and #recheck) are examined, so
+ * the cost is proportional to the number of RPCs that made progress, not
+ * the number outstanding.
+ *
+ * \return
+ *      The number of operations that completed.
+ */
+uint32_t
+AsyncClient::poll()
+{
+    if (!pending.empty()) {
+        uint64_t now = Cycles::rdtsc();
+        for (size_t i = 0; i < pending.size(); ) {
+            if (now >= pending[i].deadline) {
+                startBatch(i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    ramcloud->poll();
+
+    // Slots set aside by the last call go to the end of ready; slots
+    // set aside during this call wait for the next one, so that an RPC
+    // waiting to be retried can't keep this loop spinning.
+    ready.insert(ready.end(), recheck.begin(), recheck.end());
+    recheck.clear();
+
+    // Slots may be added to ready during the loop (by batches that
+    // complete, by RPCs that finish while being retried, or by callbacks
+    // that issue new operations); they are handled in this pass too. An
+    // entry whose Op::ready flag is clear is stale (its slot was freed
+    // after being added) and is skipped.
+    uint32_t completed = 0;
+    for (size_t i = 0; i < ready.size(); i++) {
+        uint32_t slot = ready[i];
+        Op* op = ops[slot];
+        if (!op->ready)
+            continue;
+        op->ready = false;
+        if (!finish(op)) {
+            if (!op->ready && !op->waitingForResponse()) {
+                op->ready = true;
+                recheck.push_back(slot);
+            }
+            continue;
+        }
+
+        activeOps--;
+        if (op->isBatch) {
+            // finish() added the operations in the batch to ready.
+            activeBatches--;
+            freeSlot(slot);
+            continue;
+        }
+        completed++;
+        if (op->callback != NULL) {
+            // Recycle the slot before invoking the callback, so that the
+            // callback can issue a new operation that reuses it.
+            Callback callback = op->callback;
+            void* arg = op->arg;
+            Status status = op->status;
+            uint64_t version = op->version;
+            freeSlot(slot);
+            callback(arg, status, version);
+        }
+    }
+    ready.clear();
+    return completed;
+}
+
+/**
+ * Enable or disable batching of single-object operations. When enabled,
+ * each readAsync or writeAsync is added to a batch of operations of the
+ * same kind for the same master, rather than being sent immediately. A
+ * batch is sent, as a MultiRead or MultiWrite, once it holds
+ * \a maxBatchSize operations or the first operation in it has waited for
+ * \a maxDelayMicros (batches are only sent from within poll, so in
+ * practice this is "the first call to poll after that"). A batch that
+ * holds only one operation when it is sent is issued as an ordinary read
+ * or write.
+ *
+ * Batching only changes how operations are sent: their results, and the
+ * Futures and callbacks that deliver them, are the same as without it.
+ * Operations issued before the setting changes are not affected.
+ *
+ * \param maxBatchSize
+ *      Largest number of operations in a batch; 0 disables batching.
+ * \param maxDelayMicros
+ *      Longest time an operation may wait for its batch to fill.
+ */
+void
+AsyncClient::setBatching(uint32_t maxBatchSize, uint32_t maxDelayMicros)
+{
+    this->maxBatchSize = maxBatchSize;
+    maxBatchDelay = Cycles::fromMicroseconds(maxDelayMicros);
+    if (maxBatchSize == 0) {
+        while (!pending.empty())
+            startBatch(pending.size() - 1);
+    }
+}
+
+/**
+ * Wait for all outstanding operations to complete (invoking their
+ * callbacks).
+ */
+void
+AsyncClient::waitAll()
+{
+    while (activeOps > 0 || !pending.empty())
+        poll();
+}
+
+/**
+ * Record that an operation's RPC (or batch) has been started, and arrange
+ * for poll() to check it once, in case it finished while being sent.
+ *
+ * \param slot
+ *      Index in #ops of the operation.
+ */
+void
+AsyncClient::activate(uint32_t slot)
+{
+    activeOps++;
+    markReady(slot);
+}
+
+/**
+ * Add an operation to the pending batch for the master that stores its
+ * object, creating the batch if there isn't one yet, and send the batch
+ * if it is full.
+ *
+ * \param slot
+ *      Slot of the operation; its readObject or writeObject has been
+ *      filled in.
+ * \param tableId
+ *      Table containing the operation's object.
+ * \param write
+ *      True if the operation is a write, false for a read.
+ * \return
+ *      True if the operation was added to a batch; false if it could not
+ *      be (for example, because the table doesn't exist), in which case
+ *      the caller should issue it directly so that the error is reported
+ *      in the usual way.
+ */
+bool
+AsyncClient::addToBatch(uint32_t slot, uint64_t tableId, bool write)
+{
+    Op* op = ops[slot];
+    Transport::SessionRef session;
+    try {
+        session = ramcloud->clientContext->objectFinder->lookup(tableId,
+                op->key.data(), downCast<uint16_t>(op->key.size()));
+    } catch (ClientException& e) {
+        return false;
+    }
+
+    size_t index;
+    for (index = 0; index < pending.size(); index++) {
+        if (pending[index].session.get() == session.get() &&
+                pending[index].write == write)
+            break;
+    }
+    if (index == pending.size()) {
+        uint32_t batchSlot = allocSlot(NULL, NULL);
+        ops[batchSlot]->isBatch = true;
+        ops[batchSlot]->write = write;
+        pending.emplace_back(session, write, batchSlot,
+                Cycles::rdtsc() + maxBatchDelay);
+    }
+
+    Op* batch = ops[pending[index].slot];
+    op->batched = true;
+    op->write = write;
+    batch->members.push_back(slot);
+    batchedOps++;
+    if (batch->members.size() >= maxBatchSize)
+        startBatch(index);
+    return true;
+}
+
+/**
+ * Find a free operation slot (growing the pool if there are none) and
+ * prepare it for a new operation.
+ *
+ * \param callback
+ *      Callback for the new operation.
+ * \param arg
+ *      Argument for \a callback.
+ * \return
+ *      Index of the slot in #ops. The caller is responsible for calling
+ *      activate once its RPC has been started.
+ */
+uint32_t
+AsyncClient::allocSlot(Callback callback, void* arg)
+{
+    uint32_t slot;
+    if (freeSlots.empty()) {
+        slot = downCast<uint32_t>(ops.size());
+        ops.push_back(new Op(this, slot));
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    Op* op = ops[slot];
+    op->callback = callback;
+    op->arg = arg;
+    op->completed = false;
+    op->status = STATUS_OK;
+    op->version = 0;
+    op->isBatch = false;
+    op->batched = false;
+    op->batchDone = false;
+    op->write = false;
+    return slot;
+}
+
+/**
+ * Check whether an operation's RPC has completed and, if so, record its
+ * outcome in the Op and release the RPC.
+ *
+ * \param op
+ *      An operation in progress.
+ * \return
+ *      True if the operation has now completed.
+ */
+bool
+AsyncClient::finish(Op* op)
+{
+    if (op->batched) {
+        if (!op->batchDone)
+            return false;
+        op->batched = false;
+        op->batchDone = false;
+        // op->status already holds any error that caused the whole batch
+        // to fail.
+        if (op->status == STATUS_OK && op->write) {
+            op->status = op->writeObject.status;
+            op->version = op->writeObject.version;
+        } else if (op->status == STATUS_OK) {
+            op->status = op->readObject.status;
+            op->version = op->readObject.version;
+            op->value->reset();
+            if (op->status == STATUS_OK) {
+                uint32_t length;
+                const void* value = op->objectBuffer->getValue(&length);
+                op->value->appendCopy(value, length);
+            }
+        }
+        op->objectBuffer.destroy();
+        op->completed = true;
+        return true;
+    }
+
+    Status batchStatus = STATUS_OK;
+    try {
+        if (op->readRpc) {
+            if (!op->readRpc->isReady())
+                return false;
+            op->readRpc->wait(&op->version);
+        } else if (op->writeRpc) {
+            if (!op->writeRpc->isReady())
+                return false;
+            op->writeRpc->wait(&op->version);
+        } else if (op->multiRead) {
+            if (!op->multiRead->isReady())
+                return false;
+            op->multiRead->wait();
+        } else if (op->multiWrite) {
+            if (!op->multiWrite->isReady())
+                return false;
+            op->multiWrite->wait();
+        }
+    } catch (ClientException& e) {
+        op->status = e.status;
+        op->version = 0;
+        batchStatus = e.status;
+    }
+    op->readRpc.destroy();
+    op->writeRpc.destroy();
+    op->multiRead.destroy();
+    op->multiWrite.destroy();
+
+    if (op->isBatch) {
+        foreach (uint32_t member, op->members) {
+            ops[member]->status = batchStatus;
+            ops[member]->batchDone = true;
+            markReady(member);
+        }
+        op->members.clear();
+        op->readRequests.clear();
+        op->writeRequests.clear();
+    }
+    op->completed = true;
+    return true;
+}
+
+/**
+ * Send a pending batch. If it holds a single operation, that operation is
+ * sent as an ordinary read or write instead.
+ *
+ * \param index
+ *      Index of the batch in #pending; it is removed from #pending (which
+ *      may reorder the remaining batches).
+ */
+void
+AsyncClient::startBatch(size_t index)
+{
+    uint32_t batchSlot = pending[index].slot;
+    pending[index] = pending.back();
+    pending.pop_back();
+
+    Op* batch = ops[batchSlot];
+    batchedOps -= downCast<uint32_t>(batch->members.size());
+    if (batch->members.size() == 1) {
+        uint32_t slot = batch->members[0];
+        Op* op = ops[slot];
+        op->batched = false;
+        if (op->write) {
+            MultiWriteObject* w = &op->writeObject;
+            op->writeRpc.construct(&op->notifier, ramcloud, w->tableId,
+                    w->key, w->keyLength, w->value, w->valueLength,
+                    w->rejectRules);
+        } else {
+            MultiReadObject* r = &op->readObject;
+            op->readRpc.construct(&op->notifier, ramcloud, r->tableId,
+                    r->key, r->keyLength, op->value, r->rejectRules);
+        }
+        activate(slot);
+        batch->members.clear();
+        freeSlot(batchSlot);
+        return;
+    }
+
+    uint32_t count = downCast<uint32_t>(batch->members.size());
+    if (batch->write) {
+        foreach (uint32_t member, batch->members)
+            batch->writeRequests.push_back(&ops[member]->writeObject);
+        batch->multiWrite.construct(ramcloud, batch->writeRequests.data(),
+                count);
+        batch->multiWrite->setNotifier(&batch->notifier);
+    } else {
+        foreach (uint32_t member, batch->members)
+            batch->readRequests.push_back(&ops[member]->readObject);
+        batch->multiRead.construct(ramcloud, batch->readRequests.data(),
+                count);
+        batch->multiRead->setNotifier(&batch->notifier);
+    }
+    // The members are checked once the batch completes (see finish).
+    activeOps += count;
+    activate(batchSlot);
+    activeBatches++;
+}
+
+/**
+ * Return a slot to the free list, invalidating any Futures that refer to
+ * it.
+ *
+ * \param slot
+ *      Index of a completed operation's slot in #ops.
+ */
+void
+AsyncClient::freeSlot(uint32_t slot)
+{
+    ops[slot]->generation++;
+    ops[slot]->completed = false;
+    ops[slot]->ready = false;
+    freeSlots.push_back(slot);
+}
+
+/**
+ * Arrange for poll() to check an operation, unless it is already going to.
+ * Invoked when one of the operation's RPCs completes or fails.
+ *
+ * \param slot
+ *      Index in #ops of an operation in progress.
+ */
+void
+AsyncClient::markReady(uint32_t slot)
+{
+    Op* op = ops[slot];
+    if (op->ready)
+        return;
+    op->ready = true;
+    ready.push_back(slot);
+}
+
+/**
+ * Return true if the operation has completed (in which case wait() will
+ * return immediately), false if it is still in progress. This does not
+ * itself make progress; call AsyncClient::poll for that.
+ */
+bool
+AsyncClient::Future::isReady()
+{
+    if (client == NULL)
+        return true;
+    Op* op = client->ops[slot];
+    return op->generation != generation || op->completed;
+}
+
+/**
+ * Wait for the operation to complete, polling the AsyncClient (so other
+ * operations may complete, and their callbacks run, in the meantime).
+ * Once this method returns, the operation's slot is recycled; it must be
+ * called at most once per operation, and not at all for operations that
+ * have callbacks.
+ *
+ * \param[out] version
+ *      If non-NULL, the version of the object read or written is returned
+ *      here.
+ * \return
+ *      STATUS_OK if the operation succeeded; otherwise the status that the
+ *      corresponding blocking RamCloud method would have thrown.
+ */
+Status
+AsyncClient::Future::wait(uint64_t* version)
+{
+    if (client == NULL)
+        throw ClientException(HERE, STATUS_INTERNAL_ERROR);
+    Op* op = client->ops[slot];
+    if (op->generation != generation || op->callback != NULL) {
+        RAMCLOUD_DIE("AsyncClient::Future::wait called on an operation "
+                "that was already waited on or has a callback");
+    }
+    while (!op->completed)
+        client->poll();
+
+    Status status = op->status;
+    if (version != NULL)
+        *version = op->version;
+    client->freeSlot(slot);
+    client = NULL;
+    return status;
+}
+
+} // namespace RAMCloud
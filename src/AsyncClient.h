@@ -0,0 +1,232 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_ASYNCCLIENT_H
+#define RAMCLOUD_ASYNCCLIENT_H
+
+#include <vector>
+
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class MultiRead;
+
+/**
+ * This class provides a non-blocking interface for issuing large numbers of
+ * concurrent reads and writes from a single thread, without the caller
+ * having to manage ReadRpc/WriteRpc objects. Each operation returns a
+ * Future and may also name a callback; operations make progress, and
+ * callbacks are invoked, only from poll() (or from Future::wait, which
+ * calls poll).
+ *
+ * RPC state is kept in a pool of operation slots that grows as needed and
+ * is never freed until the AsyncClient is destroyed, so once the pool has
+ * reached the application's maximum number of outstanding operations,
+ * issuing an operation does no heap allocation.
+ *
+ * A slot is recycled once its operation has completed and either its
+ * callback has been invoked or its Future has been waited on. Operations
+ * issued without a callback must therefore have Future::wait called
+ * eventually, or their slots will never be reused.
+ *
+ * Optionally (see setBatching), single-object reads and writes destined
+ * for the same master can be accumulated for a short time and sent as a
+ * single MultiRead or MultiWrite RPC, with the results fanned back out to
+ * the individual operations. This trades a little latency for much lower
+ * per-operation RPC overhead on both the client and the server when many
+ * small operations are in flight.
+ *
+ * poll() only examines operations whose RPCs the transport has reported
+ * as completed or failed since the last call (plus the few waiting to be
+ * retried after a delay), so its cost doesn't grow with the number of
+ * operations outstanding.
+ *
+ * This class is not thread-safe: each thread should use its own
+ * AsyncClient (they may share a RamCloud object only if the RamCloud
+ * object is used from a single thread). The RamCloud object's dispatcher
+ * must not have a dedicated thread, since RPC completions are recorded
+ * from within it.
+ */
+class AsyncClient {
+  PRIVATE:
+    struct Op;
+
+  public:
+    /**
+     * Signature for completion callbacks.
+     *
+     * \param arg
+     *      The value passed along with the callback when the operation was
+     *      issued.
+     * \param status
+     *      STATUS_OK if the operation succeeded; otherwise the status that
+     *      the corresponding blocking RamCloud method would have thrown
+     *      as a ClientException. For multiReadAsync, this is STATUS_OK
+     *      unless the operation as a whole failed; the status of each
+     *      object is in its MultiReadObject.
+     * \param version
+     *      The version of the object read or written (0 for multiReadAsync
+     *      or if the operation failed).
+     */
+    typedef void (*Callback)(void* arg, Status status, uint64_t version);
+
+    /**
+     * A lightweight handle for the result of an operation issued through
+     * an AsyncClient. Futures may be copied freely, but only one copy
+     * should be waited on.
+     */
+    class Future {
+      public:
+        Future()
+            : client(NULL)
+            , slot(0)
+            , generation(0)
+        {}
+        bool isReady();
+        Status wait(uint64_t* version = NULL);
+
+      PRIVATE:
+        Future(AsyncClient* client, uint32_t slot, uint32_t generation)
+            : client(client)
+            , slot(slot)
+            , generation(generation)
+        {}
+
+        /// The AsyncClient that issued the operation; NULL means this
+        /// Future doesn't refer to any operation.
+        AsyncClient* client;
+
+        /// Index of the operation's slot in AsyncClient::ops.
+        uint32_t slot;
+
+        /// Value of the slot's generation when the operation was issued;
+        /// used to detect that this Future has already been waited on.
+        uint32_t generation;
+
+        friend class AsyncClient;
+    };
+
+    explicit AsyncClient(RamCloud* ramcloud, uint32_t initialSlots = 0);
+    ~AsyncClient();
+
+    Future readAsync(uint64_t tableId, const void* key, uint16_t keyLength,
+            Buffer* value, const RejectRules* rejectRules = NULL,
+            Callback callback = NULL, void* arg = NULL);
+    Future writeAsync(uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* buf, uint32_t length,
+            const RejectRules* rejectRules = NULL,
+            Callback callback = NULL, void* arg = NULL);
+    Future multiReadAsync(MultiReadObject* const requests[],
+            uint32_t numRequests, Callback callback = NULL, void* arg = NULL);
+    uint32_t poll();
+    void setBatching(uint32_t maxBatchSize, uint32_t maxDelayMicros);
+    void waitAll();
+
+    /// Return the number of operations issued that have not yet completed.
+    uint32_t outstanding()
+    {
+        return activeOps + batchedOps - activeBatches;
+    }
+
+  PRIVATE:
+    /**
+     * Describes a batch of reads or writes for one master that has not
+     * yet been sent.
+     */
+    struct PendingBatch {
+        PendingBatch(Transport::SessionRef session, bool write, uint32_t slot,
+                uint64_t deadline)
+            : session(session)
+            , write(write)
+            , slot(slot)
+            , deadline(deadline)
+        {}
+
+        /// Session for the master that stores all of the batch's objects.
+        Transport::SessionRef session;
+
+        /// True if the batch contains writes, false if it contains reads.
+        bool write;
+
+        /// Slot in #ops that will hold the batch's MultiOp; its members
+        /// list the slots of the operations in the batch.
+        uint32_t slot;
+
+        /// Cycles::rdtsc() time by which the batch must be sent.
+        uint64_t deadline;
+    };
+
+    bool addToBatch(uint32_t slot, uint64_t tableId, bool write);
+    void activate(uint32_t slot);
+    uint32_t allocSlot(Callback callback, void* arg);
+    bool finish(Op* op);
+    void freeSlot(uint32_t slot);
+    void markReady(uint32_t slot);
+    void startBatch(size_t index);
+
+    /// Used to issue RPCs and to poll the dispatcher.
+    RamCloud* ramcloud;
+
+    /// The pool of operation slots. Each is allocated the first time the
+    /// pool grows to need it and then reused until the AsyncClient is
+    /// destroyed; they are separate objects because RPCs in progress
+    /// refer to their own memory.
+    std::vector<Op*> ops;
+
+    /// Indexes of slots in #ops that are not in use.
+    std::vector<uint32_t> freeSlots;
+
+    /// Number of slots whose RPCs are in progress, including batches that
+    /// have been sent (the operations in those batches are counted here
+    /// too).
+    uint32_t activeOps;
+
+    /// Indexes of in-progress slots that poll() should check: those whose
+    /// RPCs the transport has reported as completed or failed, those just
+    /// started, and members of batches that have completed. Entries for
+    /// slots freed since they were added are ignored (see Op::ready).
+    std::vector<uint32_t> ready;
+
+    /// Indexes of slots that poll() found not yet done but able to make
+    /// progress without hearing from the transport, such as RPCs waiting
+    /// to be retried after a delay. They move to #ready on the next poll.
+    std::vector<uint32_t> recheck;
+
+    /// Maximum number of operations per batch; 0 means batching is
+    /// disabled. See setBatching.
+    uint32_t maxBatchSize;
+
+    /// Longest time an operation may wait in a batch before the batch is
+    /// sent, in Cycles::rdtsc() ticks.
+    uint64_t maxBatchDelay;
+
+    /// Batches that have been started but not yet sent.
+    std::vector<PendingBatch> pending;
+
+    /// Number of operations in #pending batches (these are not yet in
+    /// #active).
+    uint32_t batchedOps;
+
+    /// Number of slots in #active that hold batches rather than
+    /// operations issued by the application.
+    uint32_t activeBatches;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncClient);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_ASYNCCLIENT_H
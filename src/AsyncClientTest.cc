@@ -0,0 +1,306 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "AsyncClient.h"
+#include "MockCluster.h"
+#include "MultiRead.h"
+
+namespace RAMCloud {
+
+class AsyncClientTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Tub<AsyncClient> async;
+    uint64_t tableId1;
+
+  public:
+    AsyncClientTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , async()
+        , tableId1(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId1 = ramcloud->createTable("table1");
+        async.construct(ramcloud.get(), 2);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncClientTest);
+};
+
+/// Records the arguments of each callback invocation as a string in the
+/// std::string that arg points to.
+static void
+recordCallback(void* arg, Status status, uint64_t version)
+{
+    string* log = static_cast<string*>(arg);
+    if (!log->empty())
+        log->append(", ");
+    log->append(format("%s %lu", statusToSymbol(status), version));
+}
+
+TEST_F(AsyncClientTest, constructor) {
+    EXPECT_EQ(2U, async->ops.size());
+    EXPECT_EQ(2U, async->freeSlots.size());
+    EXPECT_EQ(0U, async->outstanding());
+}
+
+TEST_F(AsyncClientTest, writeAsync_and_readAsync_futures) {
+    AsyncClient::Future write = async->writeAsync(tableId1, "key", 3,
+            "value", 5);
+    EXPECT_EQ(1U, async->outstanding());
+    uint64_t version = 0;
+    EXPECT_EQ(STATUS_OK, write.wait(&version));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ(0U, async->outstanding());
+
+    Buffer value;
+    AsyncClient::Future read = async->readAsync(tableId1, "key", 3, &value);
+    Buffer missingValue;
+    AsyncClient::Future missing = async->readAsync(tableId1, "missing", 7,
+            &missingValue);
+    version = 0;
+    EXPECT_EQ(STATUS_OK, read.wait(&version));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ("value", TestUtil::toString(&value));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, missing.wait());
+}
+
+TEST_F(AsyncClientTest, readAsync_rejectRules) {
+    ramcloud->write(tableId1, "key", 3, "value", 5);
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.versionNeGiven = 1;
+    rules.givenVersion = 2;
+    Buffer value;
+    EXPECT_EQ(STATUS_WRONG_VERSION,
+            async->readAsync(tableId1, "key", 3, &value, &rules).wait());
+}
+
+TEST_F(AsyncClientTest, multiReadAsync) {
+    ramcloud->write(tableId1, "a", 1, "v1", 2);
+    ramcloud->write(tableId1, "b", 1, "v2", 2);
+    Tub<ObjectBuffer> values[3];
+    MultiReadObject objects[] = {
+        MultiReadObject(tableId1, "a", 1, &values[0]),
+        MultiReadObject(tableId1, "b", 1, &values[1]),
+        MultiReadObject(tableId1, "c", 1, &values[2]),
+    };
+    MultiReadObject* requests[] = {&objects[0], &objects[1], &objects[2]};
+    string log;
+    async->multiReadAsync(requests, 3, recordCallback, &log);
+    async->waitAll();
+    EXPECT_EQ("STATUS_OK 0", log);
+    EXPECT_EQ(STATUS_OK, objects[0].status);
+    EXPECT_EQ("v1", string(reinterpret_cast<const char*>(
+            values[0]->getValue()), 2));
+    EXPECT_EQ(STATUS_OK, objects[1].status);
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, objects[2].status);
+}
+
+TEST_F(AsyncClientTest, poll_callbacks) {
+    string log;
+    async->writeAsync(tableId1, "k1", 2, "v", 1, NULL, recordCallback, &log);
+    async->writeAsync(tableId1, "k2", 2, "v", 1, NULL, recordCallback, &log);
+    async->writeAsync(tableId1, "k3", 2, "v", 1, NULL, recordCallback, &log);
+    EXPECT_EQ(3U, async->outstanding());
+    EXPECT_EQ(3U, async->ops.size());
+
+    uint32_t completed = 0;
+    while (async->outstanding() > 0)
+        completed += async->poll();
+    EXPECT_EQ(3U, completed);
+    EXPECT_EQ("STATUS_OK 1, STATUS_OK 2, STATUS_OK 3", log);
+
+    // Slots with callbacks are recycled as soon as the callback runs.
+    EXPECT_EQ(3U, async->freeSlots.size());
+    async->writeAsync(tableId1, "key", 3, "v", 1, NULL, recordCallback, &log);
+    EXPECT_EQ(3U, async->ops.size());
+    async->waitAll();
+}
+
+TEST_F(AsyncClientTest, poll_error) {
+    string log;
+    Buffer value;
+    async->readAsync(101, "key", 3, &value, NULL, recordCallback, &log);
+    async->waitAll();
+    EXPECT_EQ("STATUS_TABLE_DOESNT_EXIST 0", log);
+}
+
+TEST_F(AsyncClientTest, poll_checksOnlyReadyOperations) {
+    Transport::SessionRef session =
+            ramcloud->clientContext->transportManager->getSession(
+            "mock:host=master1");
+    BindTransport::BindSession* session1 =
+            static_cast<BindTransport::BindSession*>(session.get());
+    session1->dontNotify = true;
+
+    string log;
+    async->writeAsync(tableId1, "k1", 2, "v", 1, NULL, recordCallback, &log);
+    EXPECT_EQ(1U, async->ready.size());
+    EXPECT_EQ(0U, async->poll());
+
+    // The write is waiting for its response, so poll no longer looks at it.
+    EXPECT_EQ(0U, async->ready.size());
+    EXPECT_EQ(0U, async->recheck.size());
+    EXPECT_EQ(0U, async->poll());
+    EXPECT_EQ(1U, async->outstanding());
+
+    session1->lastNotifier->completed();
+    EXPECT_EQ(1U, async->ready.size());
+    EXPECT_EQ(1U, async->poll());
+    EXPECT_EQ("STATUS_OK 1", log);
+    EXPECT_EQ(0U, async->outstanding());
+    EXPECT_EQ(0U, async->ready.size());
+}
+
+TEST_F(AsyncClientTest, markReady) {
+    AsyncClient::Future future = async->writeAsync(tableId1, "key", 3,
+            "value", 5);
+    EXPECT_EQ(1U, async->ready.size());
+    async->markReady(future.slot);
+    EXPECT_EQ(1U, async->ready.size());
+    EXPECT_EQ(1U, async->poll());
+    EXPECT_EQ(0U, async->ready.size());
+
+    // Freeing the slot makes any leftover entry for it stale.
+    async->markReady(future.slot);
+    EXPECT_EQ(STATUS_OK, future.wait());
+    EXPECT_EQ(1U, async->ready.size());
+    EXPECT_EQ(0U, async->poll());
+    EXPECT_EQ(0U, async->ready.size());
+}
+
+TEST_F(AsyncClientTest, setBatching_disableFlushes) {
+    async->setBatching(100, 1000000);
+    string log;
+    async->writeAsync(tableId1, "k1", 2, "v", 1, NULL, recordCallback, &log);
+    async->writeAsync(tableId1, "k2", 2, "v", 1, NULL, recordCallback, &log);
+    EXPECT_EQ(1U, async->pending.size());
+    EXPECT_EQ(2U, async->outstanding());
+    async->setBatching(0, 0);
+    EXPECT_EQ(0U, async->pending.size());
+    EXPECT_EQ(1U, async->activeBatches);
+    EXPECT_EQ(2U, async->outstanding());
+    async->waitAll();
+    EXPECT_EQ("STATUS_OK 2, STATUS_OK 1", log);
+    EXPECT_EQ(0U, async->activeBatches);
+}
+
+TEST_F(AsyncClientTest, addToBatch_fullBatch) {
+    async->setBatching(3, 1000000);
+    ramcloud->write(tableId1, "k1", 2, "value1", 6);
+    ramcloud->write(tableId1, "k2", 2, "value2", 6);
+    Buffer values[3];
+    AsyncClient::Future f1 = async->readAsync(tableId1, "k1", 2, &values[0]);
+    AsyncClient::Future f2 = async->readAsync(tableId1, "k2", 2, &values[1]);
+    EXPECT_EQ(1U, async->pending.size());
+    EXPECT_EQ(0U, async->activeOps);
+    AsyncClient::Future f3 = async->readAsync(tableId1, "k3", 2, &values[2]);
+    EXPECT_EQ(0U, async->pending.size());
+    EXPECT_EQ(1U, async->activeBatches);
+    EXPECT_EQ(3U, async->outstanding());
+
+    uint64_t version = 0;
+    EXPECT_EQ(STATUS_OK, f1.wait(&version));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ("value1", TestUtil::toString(&values[0]));
+    EXPECT_EQ(STATUS_OK, f2.wait());
+    EXPECT_EQ("value2", TestUtil::toString(&values[1]));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, f3.wait());
+    EXPECT_EQ(0U, values[2].size());
+    EXPECT_EQ(0U, async->outstanding());
+}
+
+TEST_F(AsyncClientTest, addToBatch_separateReadsAndWrites) {
+    async->setBatching(10, 1000000);
+    Buffer value;
+    async->readAsync(tableId1, "k1", 2, &value, NULL, recordCallback, NULL);
+    async->writeAsync(tableId1, "k1", 2, "v", 1, NULL, recordCallback, NULL);
+    EXPECT_EQ(2U, async->pending.size());
+    async->setBatching(0, 0);
+}
+
+TEST_F(AsyncClientTest, addToBatch_unknownTable) {
+    async->setBatching(10, 1000000);
+    Buffer value;
+    AsyncClient::Future future = async->readAsync(101, "k1", 2, &value);
+    EXPECT_EQ(0U, async->pending.size());
+    EXPECT_EQ(STATUS_TABLE_DOESNT_EXIST, future.wait());
+}
+
+TEST_F(AsyncClientTest, poll_sendsExpiredBatches) {
+    async->setBatching(10, 0);
+    async->writeAsync(tableId1, "k1", 2, "v", 1).wait();
+    EXPECT_EQ(0U, async->pending.size());
+    Buffer value;
+    ramcloud->read(tableId1, "k1", 2, &value);
+    EXPECT_EQ("v", TestUtil::toString(&value));
+}
+
+TEST_F(AsyncClientTest, startBatch_singleOperation) {
+    async->setBatching(10, 1000000);
+    ramcloud->write(tableId1, "k1", 2, "value1", 6);
+    Buffer value;
+    AsyncClient::Future future = async->readAsync(tableId1, "k1", 2, &value);
+    async->startBatch(0);
+    EXPECT_EQ(0U, async->pending.size());
+    EXPECT_EQ(1U, async->activeOps);
+    EXPECT_EQ(0U, async->activeBatches);
+    EXPECT_EQ(STATUS_OK, future.wait());
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+}
+
+TEST_F(AsyncClientTest, Future_isReady) {
+    AsyncClient::Future future;
+    EXPECT_TRUE(future.isReady());
+
+    future = async->writeAsync(tableId1, "key", 3, "value", 5);
+    EXPECT_FALSE(future.isReady());
+    async->waitAll();
+    EXPECT_TRUE(future.isReady());
+    EXPECT_EQ(STATUS_OK, future.wait());
+
+    // The slot has been recycled; a Future for its new operation isn't
+    // confused with the old one.
+    EXPECT_EQ(future.slot, async->freeSlots.back());
+    AsyncClient::Future next = async->writeAsync(tableId1, "key", 3, "v", 1);
+    EXPECT_EQ(future.slot, next.slot);
+    EXPECT_FALSE(next.isReady());
+    next.wait();
+}
+
+TEST_F(AsyncClientTest, Future_waitTwice) {
+    AsyncClient::Future future = async->writeAsync(tableId1, "key", 3,
+            "value", 5);
+    EXPECT_EQ(STATUS_OK, future.wait());
+    EXPECT_THROW(future.wait(), ClientException);
+}
+
+}  // namespace RAMCloud
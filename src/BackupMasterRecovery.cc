@@ -53,11 +53,17 @@ SpinLock BackupMasterRecovery::deletionMutex
  * \param segmentSize
  *      Size of the replicas on storage. Needed for bounds-checking on the
  *      SegmentIterators which walk the stored replicas.
+ * \param partitionThreads
+ *      If nonzero, this many threads filter primary replicas in parallel,
+ *      each starting on a replica as soon as its first bytes have been read
+ *      from storage. If 0, primary replicas are filtered one at a time on
+ *      \a taskQueue once fully loaded.
  */
 BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
                                            uint64_t recoveryId,
                                            ServerId crashedMasterId,
-                                           uint32_t segmentSize)
+                                           uint32_t segmentSize,
+                                           uint32_t partitionThreads)
     : Task(taskQueue)
     , recoveryId(recoveryId)
     , crashedMasterId(crashedMasterId)
@@ -66,6 +72,11 @@ BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
     , numPartitions()
     , replicas()
     , nextToBuild()
+    , numPartitionThreads(partitionThreads)
+    , partitionThreads()
+    , nextToPartition(0)
+    , numPartitioned(0)
+    , stopPartitioning(false)
     , firstSecondaryReplica()
     , numPrimaries(0)
     , segmentIdToReplica()
@@ -89,6 +100,9 @@ BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
  * distinct task to clean up the BackupMasterRecovery instance.
  */
 BackupMasterRecovery::~BackupMasterRecovery() {
+    stopPartitioning = true;
+    foreach (auto& thread, partitionThreads)
+        thread.join();
     LOG(NOTICE, "Freeing recovery state on backup for crashed master %s "
             "(recovery %lu), including %lu filtered replicas",
             crashedMasterId.toString().c_str(), recoveryId,
@@ -161,10 +175,13 @@ BackupMasterRecovery::start(const std::vector<BackupStorage::FrameRef>& frames,
     // (most recent replicas first). This improves recovery performance by
     // avoiding situations where old log entries get inserted in a
     // recovery master's log only to be overridden by newer ones.
+    // Partitioning threads filter replicas while they load (see
+    // buildRecoverySegments()), so only they need partial loads.
+    bool streaming = numPartitionThreads > 0 && !DISABLE_BACKGROUND_BUILDING;
     vector<BackupStorage::FrameRef>::reverse_iterator rit;
     for (rit = primaries.rbegin(); rit != primaries.rend(); ++rit) {
         replicas.emplace_back(*rit);
-        (*rit)->startLoading();
+        (*rit)->startLoading(streaming);
         auto& replica = replicas.back();
         segmentIdToReplica[replica.metadata->segmentId] = &replica;
     }
@@ -234,7 +251,8 @@ BackupMasterRecovery::setPartitionsAndSchedule(
 
     // idempotency
     if (this->partitions) {
-        schedule();
+        if (numPartitionThreads == 0)
+            schedule();
         return;
     }
 
@@ -255,7 +273,13 @@ BackupMasterRecovery::setPartitionsAndSchedule(
     LOG(DEBUG, "Kicked off building recovery segments");
     nextToBuild = replicas.begin();
     buildingStartTicks = Cycles::rdtsc();
-    schedule();
+    if (numPartitionThreads == 0 || DISABLE_BACKGROUND_BUILDING) {
+        schedule();
+        return;
+    }
+    for (uint32_t i = 0; i < numPartitionThreads; i++)
+        partitionThreads.emplace_back(
+                &BackupMasterRecovery::partitionReplicas, this);
 }
 
 /**
@@ -439,6 +463,77 @@ BackupMasterRecovery::performTask()
 
 // - private -
 
+/**
+ * Main loop of each partitioning thread (see #numPartitionThreads): claims
+ * primary replicas one at a time, in the same order performTask() would
+ * have filtered them, and filters each while it streams in from storage.
+ * Returns once there are no primary replicas left to claim or the
+ * recovery is being destroyed.
+ */
+void
+BackupMasterRecovery::partitionReplicas()
+{
+    while (!stopPartitioning) {
+        size_t i = nextToPartition++;
+        if (i >= numPrimaries)
+            return;
+        Replica& replica = replicas[i];
+        LOG(DEBUG, "Starting to build recovery segments for (<%s,%lu>)",
+            crashedMasterId.toString().c_str(), replica.metadata->segmentId);
+        buildRecoverySegments(replica, true);
+        if (stopPartitioning)
+            return;
+        LOG(DEBUG, "Done building recovery segments for (<%s,%lu>)",
+            crashedMasterId.toString().c_str(), replica.metadata->segmentId);
+        replica.frame->unload();
+
+        if (++numPartitioned == numPrimaries) {
+            readingDataTicks.destroy();
+            uint64_t ns =
+                Cycles::toNanoseconds(Cycles::rdtsc() - buildingStartTicks);
+            LOG(NOTICE, "Took %lu ms to filter %lu primary replicas with "
+                "%u threads", ns / 1000 / 1000, numPrimaries,
+                numPartitionThreads);
+        }
+    }
+}
+
+/**
+ * Wait until at least \a needed bytes at the start of a replica have been
+ * loaded from storage. Used to feed RecoverySegmentBuilder::buildStreaming().
+ *
+ * \param replica
+ *      Replica whose frame is being loaded.
+ * \param needed
+ *      Number of bytes to wait for; 0 means just wait for the load to start.
+ * \param[out] loadedLength
+ *      Set to the number of bytes loaded so far (at least \a needed).
+ * \return
+ *      The buffer the replica is being loaded into.
+ * \throw SegmentRecoveryFailedException
+ *      This recovery is being destroyed, so the caller should give up.
+ */
+const void*
+BackupMasterRecovery::waitForLoadedPrefix(Replica& replica, uint32_t needed,
+                                          uint32_t* loadedLength)
+{
+    while (true) {
+        size_t loaded = 0;
+        const void* data = replica.frame->getLoadedPrefix(&loaded);
+        if (data != NULL && loaded >= needed) {
+            *loadedLength = downCast<uint32_t>(
+                    std::min(loaded, size_t(segmentSize)));
+            return data;
+        }
+        if (stopPartitioning)
+            throw SegmentRecoveryFailedException(HERE);
+        // Storage reads arrive in chunks of a megabyte or so. Once the read
+        // has started getLoadedPrefix() only reads atomics, so polling
+        // doesn't hold up storage; just don't burn the core meanwhile.
+        usleep(50);
+    }
+}
+
 /**
  * Append replica information and the log digest (if any) to \a responseBuffer
  * and populate \a response with the corresponding details about the
@@ -519,15 +614,22 @@ BackupMasterRecovery::populateStartResponse(Buffer* responseBuffer,
  * thread serializes all rpcs secondary processing is serialized. Since the two
  * sets are disjoint it all works out.
  *
+ * Partitioning threads (see partitionReplicas()) each claim distinct
+ * primary replicas, so this still holds when they are used.
+ *
  * If we move to multiple worker threads then replicas will need to be locked
  * for this filtering.
  *
  * \param replica
  *      Replica whose data should be walked and bucketed into recovery segments
  *      according to #partitions.
+ * \param streaming
+ *      If true, start filtering as soon as the beginning of the replica has
+ *      been read from storage rather than waiting for all of it; used by
+ *      partitioning threads.
  */
 void
-BackupMasterRecovery::buildRecoverySegments(Replica& replica)
+BackupMasterRecovery::buildRecoverySegments(Replica& replica, bool streaming)
 {
     if (replica.built) {
         LOG(NOTICE, "Recovery segments already built for <%s,%lu>",
@@ -538,13 +640,25 @@ BackupMasterRecovery::buildRecoverySegments(Replica& replica)
     replica.recoveryException.reset();
     replica.recoverySegments.reset();
 
-    void* replicaData = replica.frame->load();
+    const void* replicaData = streaming ? NULL : replica.frame->load();
     CycleCounter<RawMetric> _(&metrics->backup.filterTicks);
 
     std::unique_ptr<Segment[]> recoverySegments(new Segment[numPartitions]);
     uint64_t start = Cycles::rdtsc();
     try {
-        if (!testingSkipBuild) {
+        if (!testingSkipBuild && streaming) {
+            assert(partitions);
+            uint32_t loaded = 0;
+            replicaData = waitForLoadedPrefix(replica, 0, &loaded);
+            RecoverySegmentBuilder::buildStreaming(replicaData, segmentSize,
+                    replica.metadata->certificate, numPartitions,
+                    *partitions, recoverySegments.get(),
+                    [this, &replica] (uint32_t needed) {
+                        uint32_t loaded = 0;
+                        waitForLoadedPrefix(replica, needed, &loaded);
+                        return loaded;
+                    });
+        } else if (!testingSkipBuild) {
             assert(partitions);
             RecoverySegmentBuilder::build(replicaData, segmentSize,
                                           replica.metadata->certificate,
@@ -16,6 +16,9 @@
 #ifndef RAMCLOUD_BACKUPMASTERRECOVERY_H
 #define RAMCLOUD_BACKUPMASTERRECOVERY_H
 
+#include <atomic>
+#include <thread>
+
 #include "Common.h"
 #include "BackupStorage.h"
 #include "Log.h"
@@ -73,13 +76,23 @@ class TaskKiller : public Task {
  * 2) Calls to performTask() are serialized.
  * 3) FrameRefs delivered to start() remain valid until destruction.
  *
- * Primary replicas are ONLY filtered by the task queue thread serially.
+ * Primary replicas are ONLY filtered by the task queue thread serially,
+ * or, if the recovery was created with partitioning threads, ONLY by those
+ * threads (each replica is claimed by exactly one of them).
  * Secondary replicas are ONLY filtered by the sole backup worked thread
  * (and, hence, serially, as well).
  * The only miniscule synchronization it to ensure that all built
  * recovery segment information is flushed to main memory before it is used
  * by getRecoverySegment().
  *
+ * With partitioning threads, recovery is pipelined: each thread claims the
+ * next primary replica and starts splitting it into recovery segments as
+ * soon as the first part of it has been read from storage, rather than
+ * waiting for the whole replica (see
+ * RecoverySegmentBuilder::buildStreaming()). Replicas are marked built one
+ * at a time as each finishes, so recovery masters can start fetching
+ * recovery segments while later replicas are still being read.
+ *
  * Destruction is non-trivial because the instance may become redundant while
  * it is filtering a replica. To solve this, users call free() which instructs
  * the recovery to cleanup at its earliest convenience.
@@ -91,7 +104,8 @@ class BackupMasterRecovery : public Task {
     BackupMasterRecovery(TaskQueue& taskQueue,
                          uint64_t recoveryId,
                          ServerId crashedMasterId,
-                         uint32_t segmentSize);
+                         uint32_t segmentSize,
+                         uint32_t partitionThreads = 0);
     ~BackupMasterRecovery();
     void start(const std::vector<BackupStorage::FrameRef>& frames,
                Buffer* buffer,
@@ -110,7 +124,10 @@ class BackupMasterRecovery : public Task {
     void populateStartResponse(Buffer* buffer,
                                StartResponse* response);
     struct Replica;
-    void buildRecoverySegments(Replica& replica);
+    void buildRecoverySegments(Replica& replica, bool streaming = false);
+    const void* waitForLoadedPrefix(Replica& replica, uint32_t needed,
+                                    uint32_t* loadedLength);
+    void partitionReplicas();
     bool getLogDigest(Replica& replica, Buffer* digestBuffer);
 
     /**
@@ -162,7 +179,8 @@ class BackupMasterRecovery : public Task {
      * an attempt to reduce surprises. Once the replica has been filtered
      * either #recoverySegments or #recoveryException is populated.
      * Concurrency on these replicas is hairy. Primary replicas are ALWAYS
-     * filtered by the task queue thread; secondary threads are ALWAYS
+     * filtered by the task queue thread (or by whichever partitioning
+     * thread claimed them); secondary threads are ALWAYS
      * filtered by the backup service worker thread. There is no
      * locking; once #built is set the backup worker thread can safely
      * check #recoverySegments and #recoveryException (after an lfence,
@@ -244,6 +262,35 @@ class BackupMasterRecovery : public Task {
      */
     std::deque<Replica>::iterator nextToBuild;
 
+    /**
+     * Number of threads to start in setPartitionsAndSchedule() to filter
+     * primary replicas as they stream in from storage; see
+     * partitionReplicas(). If 0, primary replicas are instead filtered one
+     * at a time by performTask() once each has been fully loaded.
+     */
+    const uint32_t numPartitionThreads;
+
+    /// Threads running partitionReplicas(); joined on destruction.
+    std::vector<std::thread> partitionThreads;
+
+    /**
+     * Index in #replicas of the next primary replica for a partitioning
+     * thread to claim.
+     */
+    std::atomic<size_t> nextToPartition;
+
+    /**
+     * Number of primary replicas the partitioning threads have finished
+     * filtering. Used to tell when the last one is done.
+     */
+    std::atomic<size_t> numPartitioned;
+
+    /**
+     * Set on destruction to make partitioning threads give up as soon as
+     * possible, even in the middle of a replica.
+     */
+    std::atomic<bool> stopPartitioning;
+
     /**
      * Points to the first secondary replica in #replicas. Lets background
      * filtering know where it should stop when pre-loading/filtering replicas.
@@ -345,6 +345,34 @@ TEST_F(BackupMasterRecoveryTest, performTask) {
         TestLog::get());
 }
 
+TEST_F(BackupMasterRecoveryTest, partitionReplicas) {
+    recovery.construct(taskQueue, 456lu, ServerId{99, 0}, segmentSize, 2);
+    mockMetadata(88, true, true);
+    mockMetadata(89, true, true);
+    mockMetadata(90, true, true);
+    mockMetadata(91, true, false);
+    recovery->testingSkipBuild = true;
+    recovery->start(frames, NULL, NULL);
+    recovery->setPartitionsAndSchedule(partitions);
+    EXPECT_FALSE(recovery->isScheduled());
+    ASSERT_EQ(2lu, recovery->partitionThreads.size());
+    foreach (auto& thread, recovery->partitionThreads)
+        thread.join();
+    recovery->partitionThreads.clear();
+
+    EXPECT_EQ(3lu, recovery->numPartitioned);
+    EXPECT_TRUE(recovery->replicas.at(0).built);
+    EXPECT_TRUE(recovery->replicas.at(1).built);
+    EXPECT_TRUE(recovery->replicas.at(2).built);
+    EXPECT_FALSE(recovery->replicas.at(3).built);
+    EXPECT_EQ(STATUS_OK, recovery->getRecoverySegment(456, 90, 0, NULL, NULL));
+
+    // Idempotent; doesn't start more threads.
+    recovery->setPartitionsAndSchedule(partitions);
+    EXPECT_EQ(0lu, recovery->partitionThreads.size());
+    EXPECT_FALSE(recovery->isScheduled());
+}
+
 namespace {
 bool buildRecoverySegmentsFilter(string s) {
     return s == "buildRecoverySegments";
@@ -384,4 +412,33 @@ TEST_F(BackupMasterRecoveryTest, buildRecoverySegments_buildThrows) {
     EXPECT_TRUE(recovery->replicas.at(0).built);
 }
 
+TEST_F(BackupMasterRecoveryTest, buildRecoverySegments_streamingThrows) {
+    mockMetadata(88, true, true);
+    recovery->start(frames, NULL, NULL);
+    recovery->setPartitionsAndSchedule(partitions);
+    TestLog::Enable _(buildRecoverySegmentsFilter);
+    recovery->buildRecoverySegments(recovery->replicas.at(0), true);
+    EXPECT_TRUE(StringUtil::startsWith(TestLog::get(),
+        "buildRecoverySegments: Couldn't build recovery segments for "
+        "<99.0,88>: RAMCloud::SegmentIteratorException: cannot iterate: "
+        "corrupt segment, thrown "));
+    EXPECT_TRUE(recovery->replicas.at(0).recoveryException);
+    EXPECT_FALSE(recovery->replicas.at(0).recoverySegments);
+    EXPECT_TRUE(recovery->replicas.at(0).built);
+}
+
+TEST_F(BackupMasterRecoveryTest, waitForLoadedPrefix_stopping) {
+    mockMetadata(88, true, true);
+    recovery->start(frames, NULL, NULL);
+    uint32_t loadedLength = 0;
+    EXPECT_TRUE(NULL != recovery->waitForLoadedPrefix(recovery->replicas.at(0),
+                                                      0, &loadedLength));
+
+    // Ask for more than the frame holds, so the data never arrives.
+    recovery->stopPartitioning = true;
+    EXPECT_THROW(recovery->waitForLoadedPrefix(recovery->replicas.at(0),
+                                               2048, &loadedLength),
+                 SegmentRecoveryFailedException);
+}
+
 } // namespace RAMCloud
@@ -73,12 +73,21 @@ BackupService::BackupService(Context* context,
             maxWriteBuffers = config->backup.numSegmentFrames;
         }
 
+        MultiFileStorage::IoEngine ioEngine = MultiFileStorage::AIO;
+        if (config->backup.ioEngine == "io_uring") {
+            ioEngine = MultiFileStorage::IO_URING;
+        } else if (config->backup.ioEngine != "aio") {
+            DIE("Unknown backup IO engine '%s'; must be \"aio\" or "
+                "\"io_uring\"", config->backup.ioEngine.c_str());
+        }
+
         storage.reset(new MultiFileStorage(config->segmentSize,
                                            config->backup.numSegmentFrames,
                                            config->backup.writeRateLimit,
                                            maxWriteBuffers,
                                            config->backup.file.c_str(),
-                                           O_DIRECT | O_SYNC));
+                                           O_DIRECT | O_SYNC,
+                                           ioEngine));
     }
     if (storage->getMetadataSize() < sizeof(BackupReplicaMetadata))
         DIE("Storage metadata block too small to hold BackupReplicaMetadata");
@@ -477,7 +486,8 @@ BackupService::startReadingData(
         recovery = new BackupMasterRecovery(taskQueue,
                                             reqHdr->recoveryId,
                                             crashedMasterId,
-                                            segmentSize);
+                                            segmentSize,
+                                            config->backup.partitionThreads);
         recoveries[crashedMasterId] = recovery;
     }
     recovery = recoveries[crashedMasterId];
@@ -193,8 +193,15 @@ class BackupStorage {
          * After this call the start of new appends to this frame are rejected
          * until this frame is recycled for use with another replica (via
          * BackupStorage::open()).
+         *
+         * \param streaming
+         *      True if the caller will use getLoadedPrefix() to work on the
+         *      start of the replica while the rest is loading; storage may
+         *      then read the replica in several smaller pieces. Otherwise
+         *      getLoadedPrefix() may report nothing until the whole replica
+         *      has been loaded.
          */
-        virtual void startLoading() = 0;
+        virtual void startLoading(bool streaming = false) = 0;
 
         /**
          * Returns true if calling load() would not block. Always returns
@@ -202,6 +209,23 @@ class BackupStorage {
          */
         virtual bool isLoaded() = 0;
 
+        /**
+         * Return a pointer to the buffer the replica is being loaded into
+         * and the number of bytes at its start that are already in memory
+         * (and durable), without blocking. Lets recovery start working on
+         * the beginning of a replica while the rest is still being read;
+         * see BackupMasterRecovery. The returned pointer is the same one
+         * load() will eventually return and remains valid until unload().
+         * Returns NULL and sets \a loadedLength to 0 if no data is
+         * available yet (including if startLoading() hasn't been called).
+         *
+         * \param[out] loadedLength
+         *      Set to the number of bytes at the start of the returned
+         *      buffer which hold replica data. Only grows across calls
+         *      while the frame is loading.
+         */
+        virtual const void* getLoadedPrefix(size_t* loadedLength) = 0;
+
         virtual void unload() = 0;
 
         /**
@@ -458,6 +458,10 @@ BasicTransport::tryToTransmitData()
             driver->getTransmitQueueSpace(context->dispatch->currentTime)));
     uint32_t maxBytes;
 
+    // Let the driver send all of the packets from this pass together
+    // (e.g. with a single kernel call).
+    driver->startTransmitBatch();
+
     // Each iteration of the following loop transmits data packets for
     // a single request or response.
     while (transmitQueueSpace >= maxDataPerPacket) {
@@ -562,6 +566,7 @@ BasicTransport::tryToTransmitData()
             break;
         }
     }
+    driver->flushTransmitBatch();
 
     return result;
 }
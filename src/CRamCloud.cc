@@ -18,7 +18,10 @@
  * This file provides a C wrapper around the RAMCloud client code.
  */
 
+#include <deque>
+
 #include "RamCloud.h"
+#include "AsyncClient.h"
 #include "CRamCloud.h"
 #include "ClientException.h"
 #include "Logger.h"
@@ -55,6 +58,59 @@ struct rc_multiReadHelper {
     DISALLOW_COPY_AND_ASSIGN(rc_multiReadHelper);
 };
 
+/**
+ * Holds the C-side state of one operation issued through an rc_async:
+ * where to copy results, and the user's callback. Like the RPC state in
+ * AsyncClient, these are pooled and reused.
+ */
+struct rc_asyncOp {
+    rc_asyncOp()
+        : owner(NULL)
+        , value()
+        , buf(NULL)
+        , maxLength(0)
+        , actualLength(NULL)
+        , requests(NULL)
+        , numRequests(0)
+        , callback(NULL)
+        , arg(NULL)
+    {}
+    struct rc_async* owner;   ///< The rc_async that issued the operation.
+    Buffer value;             ///< Receives the object for rc_readAsync.
+    void* buf;                ///< User buffer for rc_readAsync, else NULL.
+    uint32_t maxLength;       ///< The size of the buffer *buf in bytes.
+    uint32_t* actualLength;   ///< The actual size of the value in bytes.
+    void** requests;          ///< Requests for rc_multiReadAsync, else NULL.
+    uint32_t numRequests;     ///< The size of the requests array.
+    rc_asyncCallback callback;  ///< User callback; may be NULL.
+    void* arg;                ///< Passed to callback.
+
+    DISALLOW_COPY_AND_ASSIGN(rc_asyncOp);
+};
+
+/**
+ * Wrapper structure for asynchronous operations from C clients.
+ */
+struct rc_async {
+    rc_async(RamCloud* ramcloud, uint32_t initialSlots)
+        : ops(initialSlots)
+        , freeOps()
+        , client(ramcloud, initialSlots)
+    {
+        freeOps.reserve(initialSlots);
+        for (size_t i = 0; i < ops.size(); i++)
+            freeOps.push_back(&ops[i]);
+    }
+    std::deque<rc_asyncOp> ops;         ///< Pool of operation state.
+    std::vector<rc_asyncOp*> freeOps;   ///< Elements of ops not in use.
+
+    /// Issues the operations. Declared last so that it is destroyed (and
+    /// cancels any RPCs in progress) before the buffers in ops.
+    AsyncClient client;
+
+    DISALLOW_COPY_AND_ASSIGN(rc_async);
+};
+
 /**
  * Create a new client connection to a RAMCloud cluster.
  *
@@ -757,6 +813,47 @@ rc_multiIncrement(struct rc_client* client,
     }
 }
 
+/**
+ * After a multi-read has completed, copy the value of each object that
+ * was read successfully into the buffer supplied to rc_multiReadCreate.
+ *
+ * \param requests
+ *      An array of pointers to memory structures that have been each created
+ *      with rc_multiReadCreate.
+ * \param numRequests
+ *      The size of the requests array.
+ */
+static void
+copyMultiReadValues(void **requests, uint32_t numRequests)
+{
+    MultiReadObject **read_requests =
+        reinterpret_cast<MultiReadObject **>(requests);
+    for (uint32_t i = 0; i < numRequests; ++i) {
+        rc_multiReadHelper *mReadHelper =
+            reinterpret_cast<rc_multiReadHelper *>
+                (reinterpret_cast<char *>(requests[i]) +
+                sizeof(MultiReadObject));
+        *(mReadHelper->actualLength) = 0;
+        if (read_requests[i]->status != STATUS_OK) {
+            continue;
+        }
+
+        uint32_t value_offset;
+        bool retval = mReadHelper->value->getValueOffset(&value_offset);
+        if (!retval) {
+            read_requests[i]->status = STATUS_INVALID_OBJECT;
+            continue;
+        }
+        *(mReadHelper->actualLength) =
+            mReadHelper->value->size() - value_offset;
+        uint32_t nBytes = *(mReadHelper->actualLength) ;
+        if (nBytes > mReadHelper->maxLength) {
+            nBytes = mReadHelper->maxLength;
+        }
+        mReadHelper->value->copy(value_offset, nBytes, mReadHelper->buf);
+    }
+}
+
 /**
  * Issues a read on multiple objects.
  *
@@ -776,30 +873,7 @@ rc_multiRead(struct rc_client* client,
         reinterpret_cast<MultiReadObject **>(requests);
     try {
         client->client->multiRead(read_requests, numRequests);
-        for (uint32_t i = 0; i < numRequests; ++i) {
-            rc_multiReadHelper *mReadHelper =
-                reinterpret_cast<rc_multiReadHelper *>
-                    (reinterpret_cast<char *>(requests[i]) +
-                    sizeof(MultiReadObject));
-            *(mReadHelper->actualLength) = 0;
-            if (read_requests[i]->status != STATUS_OK) {
-                continue;
-            }
-
-            uint32_t value_offset;
-            bool retval = mReadHelper->value->getValueOffset(&value_offset);
-            if (!retval) {
-                read_requests[i]->status = STATUS_INVALID_OBJECT;
-                continue;
-            }
-            *(mReadHelper->actualLength) =
-                mReadHelper->value->size() - value_offset;
-            uint32_t nBytes = *(mReadHelper->actualLength) ;
-            if (nBytes > mReadHelper->maxLength) {
-                nBytes = mReadHelper->maxLength;
-            }
-            mReadHelper->value->copy(value_offset, nBytes, mReadHelper->buf);
-        }
+        copyMultiReadValues(requests, numRequests);
     }
     catch (std::exception& e) {
         RAMCLOUD_LOG(ERROR, "An unhandled C++ Exception occurred: %s",
@@ -865,6 +939,238 @@ rc_multiWrite(struct rc_client* client,
     }
 }
 
+/**
+ * Create a handle for issuing asynchronous operations on a client
+ * connection; see AsyncClient. The handle must only be used from one
+ * thread.
+ *
+ * \param client
+ *      Handle for the RAMCloud connection.
+ * \param initialSlots
+ *      Number of operations to preallocate state for; typically the
+ *      maximum number the caller keeps outstanding.
+ * \param[out] newAsync
+ *      The new handle is returned here if the return value is STATUS_OK.
+ *
+ * \return
+ *      STATUS_OK or STATUS_INTERNAL_ERROR.
+ */
+Status
+rc_asyncCreate(struct rc_client* client, uint32_t initialSlots,
+               struct rc_async** newAsync)
+{
+    try {
+        *newAsync = new rc_async(client->client, initialSlots);
+    } catch (std::exception& e) {
+        RAMCLOUD_LOG(ERROR, "An unhandled C++ Exception occurred: %s",
+                e.what());
+        return STATUS_INTERNAL_ERROR;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * Destroy a handle created by rc_asyncCreate. Any operations still in
+ * progress are abandoned without invoking their callbacks.
+ *
+ * \param async
+ *      Handle returned by rc_asyncCreate.
+ */
+void
+rc_asyncDestroy(struct rc_async* async)
+{
+    delete async;
+}
+
+/**
+ * Take an rc_asyncOp from an rc_async's pool, allocating a new one if the
+ * pool is empty.
+ */
+static rc_asyncOp*
+allocAsyncOp(struct rc_async* async, rc_asyncCallback callback, void* arg)
+{
+    rc_asyncOp* op;
+    if (async->freeOps.empty()) {
+        async->ops.emplace_back();
+        op = &async->ops.back();
+    } else {
+        op = async->freeOps.back();
+        async->freeOps.pop_back();
+    }
+    op->owner = async;
+    op->buf = NULL;
+    op->actualLength = NULL;
+    op->requests = NULL;
+    op->numRequests = 0;
+    op->callback = callback;
+    op->arg = arg;
+    return op;
+}
+
+/**
+ * AsyncClient callback for all operations issued through an rc_async:
+ * copies results into the caller's memory, returns the rc_asyncOp to its
+ * pool, then invokes the caller's callback.
+ */
+static void
+asyncComplete(void* arg, Status status, uint64_t version)
+{
+    rc_asyncOp* op = static_cast<rc_asyncOp*>(arg);
+    if (op->buf != NULL) {
+        *op->actualLength = 0;
+        if (status == STATUS_OK) {
+            *op->actualLength = op->value.size();
+            uint32_t bytesToCopy = *op->actualLength;
+            if (bytesToCopy > op->maxLength) {
+                bytesToCopy = op->maxLength;
+            }
+            op->value.copy(0, bytesToCopy, op->buf);
+        }
+        op->value.reset();
+    } else if (op->requests != NULL && status == STATUS_OK) {
+        copyMultiReadValues(op->requests, op->numRequests);
+    }
+
+    rc_asyncCallback callback = op->callback;
+    void* callbackArg = op->arg;
+    op->owner->freeOps.push_back(op);
+    if (callback != NULL)
+        callback(callbackArg, status, version);
+}
+
+/**
+ * Start reading an object; similar to rc_read, except that this returns
+ * immediately and the result is reported through a callback from
+ * rc_asyncPoll.
+ *
+ * \param async
+ *      Handle returned by rc_asyncCreate.
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      Need not remain valid after this function returns.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ * \param[out] buf
+ *      The contents of the desired object are copied to this location
+ *      before the callback is invoked. Must remain valid until then.
+ * \param maxLength
+ *      Number of bytes of space available at buf.
+ * \param[out] actualLength
+ *      The total size of the object is stored here; this may be
+ *      larger than maxLength.
+ * \param callback
+ *      If non-NULL, invoked from rc_asyncPoll when the read completes.
+ * \param arg
+ *      Passed to callback.
+ */
+void
+rc_readAsync(struct rc_async* async, uint64_t tableId,
+             const void* key, uint16_t keyLength,
+             const struct RejectRules* rejectRules,
+             void* buf, uint32_t maxLength, uint32_t* actualLength,
+             rc_asyncCallback callback, void* arg)
+{
+    rc_asyncOp* op = allocAsyncOp(async, callback, arg);
+    op->buf = buf;
+    op->maxLength = maxLength;
+    op->actualLength = actualLength;
+    async->client.readAsync(tableId, key, keyLength, &op->value, rejectRules,
+            asyncComplete, op);
+}
+
+/**
+ * Start writing an object; similar to rc_write, except that this returns
+ * immediately and the result is reported through a callback from
+ * rc_asyncPoll. The arguments are the same as for rc_write, except for:
+ *
+ * \param async
+ *      Handle returned by rc_asyncCreate.
+ * \param callback
+ *      If non-NULL, invoked from rc_asyncPoll when the write completes.
+ * \param arg
+ *      Passed to callback.
+ */
+void
+rc_writeAsync(struct rc_async* async, uint64_t tableId,
+              const void* key, uint16_t keyLength,
+              const void* buf, uint32_t length,
+              const struct RejectRules* rejectRules,
+              rc_asyncCallback callback, void* arg)
+{
+    rc_asyncOp* op = allocAsyncOp(async, callback, arg);
+    async->client.writeAsync(tableId, key, keyLength, buf, length,
+            rejectRules, asyncComplete, op);
+}
+
+/**
+ * Start a read of multiple objects; similar to rc_multiRead, except that
+ * this returns immediately. Values are copied out and the callback invoked
+ * from rc_asyncPoll once all of the objects have been read.
+ *
+ * \param async
+ *      Handle returned by rc_asyncCreate.
+ * \param requests
+ *      An array of pointers to memory structures that have been each created
+ *      with rc_multiReadCreate. Must remain valid until the callback.
+ * \param numRequests
+ *      The size of the requests array.
+ * \param callback
+ *      If non-NULL, invoked from rc_asyncPoll when the reads complete.
+ * \param arg
+ *      Passed to callback.
+ */
+void
+rc_multiReadAsync(struct rc_async* async,
+                  void **requests, uint32_t numRequests,
+                  rc_asyncCallback callback, void* arg)
+{
+    rc_asyncOp* op = allocAsyncOp(async, callback, arg);
+    op->requests = requests;
+    op->numRequests = numRequests;
+    async->client.multiReadAsync(
+            reinterpret_cast<MultiReadObject **>(requests), numRequests,
+            asyncComplete, op);
+}
+
+/**
+ * Make progress on the operations issued through an rc_async, invoking
+ * the callbacks of any that complete.
+ *
+ * \param async
+ *      Handle returned by rc_asyncCreate.
+ *
+ * \return
+ *      The number of operations that completed.
+ */
+uint32_t
+rc_asyncPoll(struct rc_async* async)
+{
+    try {
+        return async->client.poll();
+    } catch (std::exception& e) {
+        RAMCLOUD_LOG(ERROR, "An unhandled C++ Exception occurred: %s",
+                e.what());
+    } catch (...) {
+        RAMCLOUD_LOG(ERROR, "An unknown, unhandled C++ Exception occurred");
+    }
+    return 0;
+}
+
+/**
+ * Return the number of operations issued through an rc_async that have not
+ * yet completed.
+ */
+uint32_t
+rc_asyncOutstanding(struct rc_async* async)
+{
+    return async->client.outstanding();
+}
+
 Status
 rc_testing_kill(struct rc_client* client, uint64_t tableId,
                 const void* key, uint16_t keyLength)
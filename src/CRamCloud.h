@@ -34,6 +34,7 @@ using namespace RAMCloud;
 struct RamCloud;
 struct rc_client;
 #endif
+struct rc_async;
 
 typedef enum MultiOp {
   MULTI_OP_INCREMENT = 0,
@@ -42,6 +43,12 @@ typedef enum MultiOp {
   MULTI_OP_REMOVE
 } MultiOp;
 
+/**
+ * Completion callback for the rc_*Async functions; see
+ * AsyncClient::Callback.
+ */
+typedef void (*rc_asyncCallback)(void* arg, Status status, uint64_t version);
+
 Status    rc_connect(const char* serverLocator,
                             const char* clusterName,
                             struct rc_client** newClient);
@@ -128,6 +135,25 @@ void      rc_multiWrite(struct rc_client* client,
 void      rc_multiRemove(struct rc_client* client,
                               void **requests, uint32_t numRequests);
 
+Status    rc_asyncCreate(struct rc_client* client, uint32_t initialSlots,
+                         struct rc_async** newAsync);
+void      rc_asyncDestroy(struct rc_async* async);
+void      rc_readAsync(struct rc_async* async, uint64_t tableId,
+                       const void* key, uint16_t keyLength,
+                       const struct RejectRules* rejectRules,
+                       void* buf, uint32_t maxLength, uint32_t* actualLength,
+                       rc_asyncCallback callback, void* arg);
+void      rc_writeAsync(struct rc_async* async, uint64_t tableId,
+                        const void* key, uint16_t keyLength,
+                        const void* buf, uint32_t length,
+                        const struct RejectRules* rejectRules,
+                        rc_asyncCallback callback, void* arg);
+void      rc_multiReadAsync(struct rc_async* async,
+                            void **requests, uint32_t numRequests,
+                            rc_asyncCallback callback, void* arg);
+uint32_t  rc_asyncPoll(struct rc_async* async);
+uint32_t  rc_asyncOutstanding(struct rc_async* async);
+
 Status    rc_testing_kill(struct rc_client* client, uint64_t tableId,
                                     const void* key, uint16_t keyLength);
 Status    rc_testing_get_server_id(struct rc_client* client,
@@ -637,4 +637,99 @@ TEST_F(CRamCloudTest, rc_multiWrite) {
     }
 }
 
+/// Outcome of an operation in the rc_*Async tests; see asyncCallback.
+struct AsyncResult {
+    int calls;
+    Status status;
+    uint64_t version;
+};
+
+/// Callback for the rc_*Async tests: records the outcome in the
+/// AsyncResult that arg points to.
+static void
+asyncCallback(void* arg, Status status, uint64_t version)
+{
+    AsyncResult* result = static_cast<AsyncResult*>(arg);
+    result->calls++;
+    result->status = status;
+    result->version = version;
+}
+
+TEST_F(CRamCloudTest, rc_writeAsync_and_readAsync) {
+    rc_async* async = NULL;
+    EXPECT_EQ(STATUS_OK, rc_asyncCreate(client, 2, &async));
+
+    AsyncResult writeResult = {0, STATUS_MAX_VALUE, 0};
+    rc_writeAsync(async, tableId1, key.data(), keyLength,
+                  value.data(), valueLength, NULL,
+                  asyncCallback, &writeResult);
+    EXPECT_EQ(1U, rc_asyncOutstanding(async));
+    while (rc_asyncOutstanding(async) > 0)
+        rc_asyncPoll(async);
+    EXPECT_EQ(1, writeResult.calls);
+    EXPECT_EQ(STATUS_OK, writeResult.status);
+    EXPECT_GT(writeResult.version, uint64_t(0));
+
+    char buf[valueLength];
+    uint32_t actualLength = 0;
+    AsyncResult readResult = {0, STATUS_MAX_VALUE, 0};
+    AsyncResult missingResult = {0, STATUS_MAX_VALUE, 0};
+    uint32_t missingLength = 5;
+    rc_readAsync(async, tableId1, key.data(), keyLength, NULL,
+                 buf, valueLength, &actualLength,
+                 asyncCallback, &readResult);
+    rc_readAsync(async, tableId1, "missing", 7, NULL,
+                 buf, valueLength, &missingLength,
+                 asyncCallback, &missingResult);
+    while (rc_asyncOutstanding(async) > 0)
+        rc_asyncPoll(async);
+    EXPECT_EQ(1, readResult.calls);
+    EXPECT_EQ(STATUS_OK, readResult.status);
+    EXPECT_EQ(writeResult.version, readResult.version);
+    EXPECT_EQ(actualLength, valueLength);
+    EXPECT_EQ(std::string(buf, actualLength), value);
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, missingResult.status);
+    EXPECT_EQ(0U, missingLength);
+    rc_asyncDestroy(async);
+}
+
+TEST_F(CRamCloudTest, rc_multiReadAsync) {
+    unsigned char *mReadObjects = reinterpret_cast<unsigned char *>
+        (malloc(numMultiOps * szMultiOpRead));
+    void **pmReadObjects = reinterpret_cast<void **>
+        (malloc(numMultiOps * sizeof(pmReadObjects[0])));
+    char *buffers = reinterpret_cast<char *>(malloc(numMultiOps * valueLength));
+    uint32_t *actualSizes = reinterpret_cast<uint32_t *>
+        (malloc(numMultiOps * sizeof(actualSizes[0])));
+    for (unsigned i = 0; i < numMultiOps; ++i) {
+        pmReadObjects[i] = mReadObjects + (i * szMultiOpRead);
+        rc_multiReadCreate(tableId3,
+                           &(keys[i]), sizeof(keys[i]),
+                           buffers + (i * valueLength), valueLength,
+                           &(actualSizes[i]),
+                           pmReadObjects[i]);
+    }
+    rc_async* async = NULL;
+    EXPECT_EQ(STATUS_OK, rc_asyncCreate(client, 0, &async));
+    AsyncResult result = {0, STATUS_MAX_VALUE, 0};
+    rc_multiReadAsync(async, pmReadObjects, numMultiOps,
+                      asyncCallback, &result);
+    while (rc_asyncOutstanding(async) > 0)
+        rc_asyncPoll(async);
+    EXPECT_EQ(1, result.calls);
+    EXPECT_EQ(STATUS_OK, result.status);
+    for (unsigned i = 0; i < numMultiOps; ++i) {
+        Status thisStatus = rc_multiOpStatus(pmReadObjects[i], MULTI_OP_READ);
+        EXPECT_EQ(STATUS_OK, thisStatus);
+        EXPECT_EQ(actualSizes[i], valueLength);
+        EXPECT_EQ(std::string(buffers + i * valueLength, valueLength), value);
+        rc_multiOpDestroy(pmReadObjects[i], MULTI_OP_READ);
+    }
+    rc_asyncDestroy(async);
+    free(actualSizes);
+    free(buffers);
+    free(pmReadObjects);
+    free(mReadObjects);
+}
+
 }  // namespace RAMCloud
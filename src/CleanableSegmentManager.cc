@@ -329,6 +329,13 @@ CleanableSegmentManager::scanSegmentTombstones(const SpinLock::Guard& guard)
 
 /**
  * Calculate the cost-benefit ratio (benefit/cost) for the given segment.
+ *
+ * Segments are normally aged from their creation. Survivors that the cleaner
+ * segregated into age classes, however, are created long after the data in
+ * them was written, and their class is what tells us how long that data has
+ * lasted. These are aged from their youngest entry instead, so that a segment
+ * of cold data is recognized as such and cleaned once it has decayed a bit,
+ * rather than looking as young as the hottest survivors of the same pass.
  */
 uint64_t
 CleanableSegmentManager::computeCleaningCostBenefitScore(LogSegment* s)
@@ -340,6 +347,8 @@ CleanableSegmentManager::computeCleaningCostBenefitScore(LogSegment* s)
     if (utilization != 0) {
         uint32_t now = WallTime::secondsTimestamp();
         uint32_t timestamp = s->creationTimestamp;
+        if (s->ageClass != LogSegment::NO_AGE_CLASS)
+            timestamp = s->dataTimestamp;
 
         // This generally shouldn't happen, but is possible due to:
         //  1) Unsynchronized TSCs across cores (WallTime uses rdtsc).
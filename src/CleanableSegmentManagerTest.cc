@@ -26,6 +26,7 @@
 #include "LogCleaner.h"
 #include "ReplicaManager.h"
 #include "MasterTableMetadata.h"
+#include "WallTime.h"
 
 namespace RAMCloud {
 
@@ -152,4 +153,27 @@ TEST_F(CleanableSegmentManagerTest, update) {
               csm.toString());
 }
 
+TEST_F(CleanableSegmentManagerTest, computeCleaningCostBenefitScore) {
+    CleanableSegmentManager& csm = cleaner.cleanableSegments;
+    WallTime::mockWallTimeValue = 10000;
+    LogSegment* s = segmentManager.allocHeadSegment();
+    EXPECT_EQ(-1UL, csm.computeCleaningCostBenefitScore(s));
+
+    s->entryLengths[LOG_ENTRY_TYPE_OBJ] = serverConfig()->segmentSize / 4;
+    int utilization = s->getDiskUtilization();
+    ASSERT_NE(0, utilization);
+
+    WallTime::mockWallTimeValue = 10100;
+    EXPECT_EQ((100 - utilization) * 100UL / utilization,
+              csm.computeCleaningCostBenefitScore(s));
+
+    // Survivors segregated by age are aged by their youngest entry.
+    s->ageClass = 1;
+    s->dataTimestamp = 9100;
+    EXPECT_EQ((100 - utilization) * 1000UL / utilization,
+              csm.computeCleaningCostBenefitScore(s));
+
+    WallTime::mockWallTimeValue = 0;
+}
+
 }  // namespace RAMCloud
@@ -54,6 +54,7 @@ main(int argc, char *argv[])
     uint32_t maxCores;
     bool reset;
     bool neverKill;
+    uint32_t serverListFanout;
     try {
         OptionsDescription coordinatorOptions("Coordinator");
         coordinatorOptions.add_options()
@@ -82,7 +83,14 @@ main(int argc, char *argv[])
              ProgramOptions::bool_switch(&reset),
              "If specified, the coordinator will not attempt to recover "
              "any existing cluster state; it will start a new cluster "
-             "from scratch.");
+             "from scratch.")
+            ("serverListFanout",
+             ProgramOptions::value<uint32_t>(&serverListFanout)->
+                default_value(0),
+             "If nonzero, each server list update sent by the coordinator "
+             "is forwarded by its recipient to up to this many other "
+             "servers, instead of the coordinator sending every server its "
+             "own update.");
 
         OptionParser optionParser(coordinatorOptions, argc, argv);
 
@@ -144,6 +152,7 @@ main(int argc, char *argv[])
                                               deadServerTimeout,
                                               false,
                                               neverKill);
+        context.coordinatorServerList->setUpdateFanout(serverListFanout);
         AdminService adminService(&context, NULL, NULL);
         while (true) {
             context.dispatch->poll();
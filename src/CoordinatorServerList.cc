@@ -58,6 +58,8 @@ CoordinatorServerList::CoordinatorServerList(Context* context)
     , spareRpcs()
     , maxConfirmedVersion(0)
     , numUpdatingServers(0)
+    , updateFanout(0)
+    , numUpdateRpcs(0)
     , replicationGroupSize(3)
     , maxReplicationId(0)
 {
@@ -146,13 +148,21 @@ CoordinatorServerList::enlistServer(ServiceMask serviceMask,
     LOG(NOTICE, "Enlisting server at %s (server id %s) supporting "
         "services: %s", serviceLocator, id.toString().c_str(),
         serviceMask.toString().c_str());
+
+    // The new entry and any entries modified to form a new replication
+    // group are written to external storage together, with a single
+    // batch. It's OK to commit the batch after notifying trackers and
+    // queueing cluster updates: the updater can't send anything until we
+    // release the lock.
+    ExternalStorage::Batch batch(context->externalStorage);
     persistAndPropagate(lock, pair->entry.get(),
-            ServerChangeEvent::SERVER_ADDED);
+            ServerChangeEvent::SERVER_ADDED, &batch);
     if (serviceMask.has(WireFormat::BACKUP_SERVICE)) {
         LOG(DEBUG, "Backup at id %s has %u MB/s read",
             id.toString().c_str(), readSpeed);
-        createReplicationGroups(lock);
+        createReplicationGroups(lock, &batch);
     }
+    batch.commit();
     return id;
 }
 
@@ -249,6 +259,10 @@ CoordinatorServerList::recover(uint64_t lastCompletedUpdate)
     vector<ExternalStorage::Object> objects;
     context->externalStorage->getChildren("servers", &objects);
 
+    // Collects all of the entries we modify, so that they can be written
+    // back to external storage together.
+    ExternalStorage::Batch batch(context->externalStorage);
+
     // Each iteration through the following loop processes information
     // for one entry in the server list.
     foreach (ExternalStorage::Object& object, objects) {
@@ -363,12 +377,13 @@ CoordinatorServerList::recover(uint64_t lastCompletedUpdate)
             // of the new sequence numbers for updates (otherwise, another
             // coordinator crash before the updates are completed could
             // cause the updates never to be finished).
-            entry->sync(context->externalStorage);
+            entry->sync(&batch);
         }
     }
 
     // Repair inconsistencies in the replication groups.
-    repairReplicationGroups(lock);
+    repairReplicationGroups(lock, &batch);
+    batch.commit();
 
     // There used to be a consistency check here that scanned the
     // update list to ensure that the version numbers formed a contiguous
@@ -536,6 +551,23 @@ CoordinatorServerList::setMasterRecoveryInfo(
     }
 }
 
+/**
+ * Select how incremental server list updates are disseminated.
+ *
+ * \param fanout
+ *      Zero (the default) means the coordinator sends each update directly
+ *      to every server. Otherwise, a single RPC carries an update to one
+ *      server along with a list of up to this many other servers needing
+ *      the same update, to which the recipient forwards it. This reduces
+ *      the number of RPCs the coordinator must issue in large clusters.
+ */
+void
+CoordinatorServerList::setUpdateFanout(uint32_t fanout)
+{
+    Lock _(mutex);
+    updateFanout = fanout;
+}
+
 //////////////////////////////////////////////////////////////////////
 // CoordinatorServerList Private Methods
 //////////////////////////////////////////////////////////////////////
@@ -638,9 +670,9 @@ CoordinatorServerList::firstFreeIndex(const Lock& lock)
  * then propagates information about the modification to other interested
  * parties. This means notifying local ServerTrackers, and also notifying
  * all of the other servers in the cluster. At the time this method returns
- * the entry will be persistent and notification will have begun, but
- * notifications will not have completed yet (this happens in a separate
- * thread, running in the background).
+ * the entry will be persistent (unless batch is specified) and notification
+ * will have begun, but notifications will not have completed yet (this
+ * happens in a separate thread, running in the background).
  *
  * \param lock
  *      Make sure caller has acquired CoordinatorServerList lock.
@@ -650,10 +682,14 @@ CoordinatorServerList::firstFreeIndex(const Lock& lock)
  * \param event
  *      Indicates the nature of this change; used when notifying
  *      ServerTrackers.
+ * \param batch
+ *      If non-NULL, the entry is added to this batch rather than being
+ *      written immediately; the caller must commit the batch before
+ *      releasing the lock.
  */
 void
 CoordinatorServerList::persistAndPropagate(const Lock& lock, Entry* entry,
-        ServerChangeEvent event)
+        ServerChangeEvent event, ExternalStorage::Batch* batch)
 {
     TEST_LOG("Persisting %s", entry->serverId.toString().c_str());
 
@@ -667,7 +703,11 @@ CoordinatorServerList::persistAndPropagate(const Lock& lock, Entry* entry,
     update->set_version(version + 1);
     update->set_sequence_number(context->getCoordinatorService()
             ->updateManager.nextSequenceNumber());
-    entry->sync(context->externalStorage);
+    if (batch != NULL) {
+        entry->sync(batch);
+    } else {
+        entry->sync(context->externalStorage);
+    }
 
     // Notify local ServerTrackers about the change.
     foreach (ServerTrackerInterface* tracker, trackers)
@@ -744,9 +784,13 @@ CoordinatorServerList::serialize(const Lock& lock,
  *
  * \param lock
  *      Explicity needs CoordinatorServerList lock.
+ * \param batch
+ *      If non-NULL, modified entries are added to this batch rather
+ *      than being written to external storage immediately.
  */
 void
-CoordinatorServerList::createReplicationGroups(const Lock& lock)
+CoordinatorServerList::createReplicationGroups(const Lock& lock,
+        ExternalStorage::Batch* batch)
 {
     // Create a list of all servers that do not belong to a replication group
     // and are up. Note that this is a performance optimization and is not
@@ -767,7 +811,8 @@ CoordinatorServerList::createReplicationGroups(const Lock& lock)
             Entry* e = getEntry(freeBackups.back());
             freeBackups.pop_back();
             e->replicationId = maxReplicationId;
-            persistAndPropagate(lock, e, ServerChangeEvent::SERVER_ADDED);
+            persistAndPropagate(lock, e, ServerChangeEvent::SERVER_ADDED,
+                    batch);
             LOG(NOTICE, "Server %s is now in replication group %lu",
                     e->serverId.toString().c_str(), e->replicationId);
         }
@@ -782,10 +827,13 @@ CoordinatorServerList::createReplicationGroups(const Lock& lock)
  *      Explicity needs CoordinatorServerList lock.
  * \param groupId
  *      Replication group to delete.
+ * \param batch
+ *      If non-NULL, modified entries are added to this batch rather
+ *      than being written to external storage immediately.
  */
 void
 CoordinatorServerList::removeReplicationGroup(const Lock& lock,
-        uint64_t groupId)
+        uint64_t groupId, ExternalStorage::Batch* batch)
 {
     // Cannot remove groupId 0, since it is the default groupId.
     if (groupId == 0) {
@@ -799,7 +847,8 @@ CoordinatorServerList::removeReplicationGroup(const Lock& lock,
             LOG(NOTICE, "Removed server %s from replication group %lu",
                     e->serverId.toString().c_str(), e->replicationId);
             e->replicationId = 0;
-            persistAndPropagate(lock, e, ServerChangeEvent::SERVER_ADDED);
+            persistAndPropagate(lock, e, ServerChangeEvent::SERVER_ADDED,
+                    batch);
         }
     }
 }
@@ -813,9 +862,13 @@ CoordinatorServerList::removeReplicationGroup(const Lock& lock,
  * \param lock
  *      Ensures that the caller has required the monitor lock. Not
  *      actually used in this method.
+ * \param batch
+ *      If non-NULL, modified entries are added to this batch rather
+ *      than being written to external storage immediately.
  */
 void
-CoordinatorServerList::repairReplicationGroups(const Lock& lock)
+CoordinatorServerList::repairReplicationGroups(const Lock& lock,
+        ExternalStorage::Batch* batch)
 {
     // The following hash is indexed by replication group number; the value
     // holds the number of servers in that group.
@@ -842,12 +895,12 @@ CoordinatorServerList::repairReplicationGroups(const Lock& lock)
         if (it->second != replicationGroupSize) {
             LOG(NOTICE, "Removing replication group %lu (has %d members)",
                     it->first, it->second);
-            removeReplicationGroup(lock, it->first);
+            removeReplicationGroup(lock, it->first, batch);
         }
     }
 
     // Finally, make new groups if possible.
-    createReplicationGroups(lock);
+    createReplicationGroups(lock, batch);
 }
 
 /**
@@ -1156,8 +1209,10 @@ CoordinatorServerList::checkUpdates()
             rpc->wait();
             workSuccess(rpc->id, rpc->getResponseHeader<
                     WireFormat::UpdateServerList>()->currentVersion);
+            relayWorkDone(rpc, true);
         } catch (const ServerNotUpException& e) {
             workFailed(rpc->id);
+            relayWorkDone(rpc, false);
         }
         (*it)->destroy();
         spareRpcs.push_back(*it);
@@ -1172,6 +1227,7 @@ CoordinatorServerList::checkUpdates()
     Tub<UpdateServerListRpc>* rpcTub = spareRpcs.back();
     if (getWork(rpcTub)) {
         (*rpcTub)->send();
+        numUpdateRpcs++;
         activeRpcs.push_back(rpcTub);
         spareRpcs.pop_back();
     }
@@ -1262,7 +1318,7 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
                         }
                         if (updatesInRpc == 0) {
                             rpc->construct(context, server->serverId,
-                                    &update->incremental);
+                                    &update->incremental, updateFanout > 0);
                         } else {
                             (*rpc)->appendServerList(&update->incremental);
                         }
@@ -1272,6 +1328,9 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
                             break;
                         }
                     }
+                    if (updateFanout > 0) {
+                        addRelayTargets(lock, server, rpc->get());
+                    }
                 }
 
                 numUpdatingServers++;
@@ -1309,6 +1368,82 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
     return false;
 }
 
+/**
+ * Helper for getWork: when relaying is enabled, adds to an incremental
+ * update RPC other servers that need exactly the same update as its
+ * recipient (i.e., they have the same verifiedVersion), so that the
+ * recipient will forward the update to them. Servers are taken in server
+ * list order, so the choice is deterministic; each of them is marked as
+ * being updated, just as if it had been sent its own RPC. Only masters and
+ * backups can be relay targets, since other servers don't appear in the
+ * recipient's server list.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param root
+ *      The server to which rpc will be sent; its updateVersion must
+ *      already reflect the updates in rpc.
+ * \param rpc
+ *      Incremental update RPC that hasn't yet been sent; it must have
+ *      been constructed as a RELAY_SERVER_LIST request.
+ */
+void
+CoordinatorServerList::addRelayTargets(const Lock& lock, Entry* root,
+        UpdateServerListRpc* rpc)
+{
+    for (size_t i = 0; i < serverList.size(); i++) {
+        if (rpc->relayTargets.size() >= updateFanout)
+            break;
+        Entry* server = serverList[i].entry.get();
+        if (server == NULL || server == root ||
+                server->status != ServerStatus::UP ||
+                !server->services.has(WireFormat::ADMIN_SERVICE) ||
+                !server->services.hasAny({WireFormat::MASTER_SERVICE,
+                        WireFormat::BACKUP_SERVICE}) ||
+                server->verifiedVersion != root->verifiedVersion ||
+                server->updateVersion != server->verifiedVersion) {
+            continue;
+        }
+        server->updateVersion = root->updateVersion;
+        numUpdatingServers++;
+        rpc->relayTargets.push_back(server->serverId);
+    }
+    rpc->setRelayTargets();
+}
+
+/**
+ * Invoked when an update RPC has finished to record the outcome for each
+ * of the servers its recipient was asked to relay the update to (see
+ * addRelayTargets): calls workSuccess or workFailed for each of them.
+ *
+ * \param rpc
+ *      An update RPC that has completed.
+ * \param delivered
+ *      True means the recipient processed the RPC and its response holds
+ *      results for the relay targets; false means the RPC failed, so none
+ *      of the relay targets got the update.
+ */
+void
+CoordinatorServerList::relayWorkDone(UpdateServerListRpc* rpc,
+        bool delivered)
+{
+    typedef WireFormat::RelayServerList::RelayResult RelayResult;
+    uint32_t offset = sizeof32(WireFormat::RelayServerList::Response);
+    for (ServerId target : rpc->relayTargets) {
+        const RelayResult* result = NULL;
+        if (delivered) {
+            result = rpc->response->getOffset<RelayResult>(offset);
+            offset += sizeof32(RelayResult);
+        }
+        if (result != NULL && result->serverId == target.getId() &&
+                result->currentVersion != 0) {
+            workSuccess(target, result->currentVersion);
+        } else {
+            workFailed(target);
+        }
+    }
+}
+
 /**
  * Signals the success of updater to complete an update RPC. This
  * will update internal metadata to allow the target server to be
@@ -1438,15 +1573,27 @@ CoordinatorServerList::workFailed(ServerId id) {
  *      Identifies the server to which this update should be sent.
  * \param list
  *      The complete server list representing all cluster membership.
+ * \param relay
+ *      True means the RPC is sent as a RELAY_SERVER_LIST request, so that
+ *      the recipient can forward the update to other servers (see
+ *      setRelayTargets).
  */
 CoordinatorServerList::UpdateServerListRpc::UpdateServerListRpc(
             Context* context,
             ServerId serverId,
-            const ProtoBuf::ServerList* list)
+            const ProtoBuf::ServerList* list,
+            bool relay)
     : ServerIdRpcWrapper(context, serverId,
             sizeof(WireFormat::UpdateServerList::Response))
+    , relayTargets()
 {
-    allocHeader<WireFormat::UpdateServerList>(serverId);
+    // The two requests differ only in their headers, and RelayServerList's
+    // response starts with an UpdateServerList response.
+    if (relay) {
+        allocHeader<WireFormat::RelayServerList>(serverId);
+    } else {
+        allocHeader<WireFormat::UpdateServerList>(serverId);
+    }
 
     auto* part = request.emplaceAppend<
             WireFormat::UpdateServerList::Request::Part>();
@@ -1491,6 +1638,25 @@ CoordinatorServerList::UpdateServerListRpc::appendServerList(
 }
 
 
+/**
+ * Ask the recipient of this RPC to forward the server list updates it
+ * contains to the servers in relayTargets. Must be invoked after all of
+ * the updates have been added to the RPC, and before it is sent; the RPC
+ * must have been constructed with relay set.
+ */
+void
+CoordinatorServerList::UpdateServerListRpc::setRelayTargets()
+{
+    assert(this->getState() == NOT_STARTED);
+    WireFormat::RelayServerList::Request* reqHdr = request.getStart<
+            WireFormat::RelayServerList::Request>();
+    assert(reqHdr->common.opcode == WireFormat::RELAY_SERVER_LIST);
+    reqHdr->relayCount = downCast<uint32_t>(relayTargets.size());
+    for (ServerId target : relayTargets) {
+        request.emplaceAppend<uint64_t>(target.getId());
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 // CoordinatorServerList::Entry Methods
 //////////////////////////////////////////////////////////////////////
@@ -1563,6 +1729,22 @@ CoordinatorServerList::Entry::serialize(ProtoBuf::ServerList_Entry* dest) const
  */
 void
 CoordinatorServerList::Entry::sync(ExternalStorage* externalStorage)
+{
+    ExternalStorage::Batch batch(externalStorage);
+    sync(&batch);
+    batch.commit();
+}
+
+/**
+ * Add a persistent copy of a server list entry to a batch of writes for
+ * external storage; the entry won't be durable until the batch has been
+ * committed.
+ *
+ * \param batch
+ *      Batch to which the entry should be added.
+ */
+void
+CoordinatorServerList::Entry::sync(ExternalStorage::Batch* batch)
 {
     ProtoBuf::ServerListEntry externalInfo;
     externalInfo.set_services(services.serialize());
@@ -1588,7 +1770,7 @@ CoordinatorServerList::Entry::sync(ExternalStorage* externalStorage)
 
     string str;
     externalInfo.SerializeToString(&str);
-    externalStorage->set(ExternalStorage::UPDATE, objectName, str.c_str(),
+    batch->set(ExternalStorage::UPDATE, objectName, str.c_str(),
             downCast<int>(str.length()));
 }
 } // namespace RAMCloud
@@ -50,6 +50,9 @@ namespace RAMCloud {
  * Protobuf until pushUpdate() is called, which will finalize the update.
  * The updates are done asynchronously from the CoordinatorServerList call
  * thread. sync() can be called to force a synchronization point.
+ * Optionally (see setUpdateFanout), an incremental update is sent to just
+ * one server of each group of servers needing it, which forwards it to the
+ * rest of the group and reports back their results.
  *
  * CoordinatorServerList is thread-safe and supports ServerTrackers.
  *
@@ -87,6 +90,7 @@ class CoordinatorServerList : public AbstractServerList{
         Entry& operator=(const Entry& other) = default;
         void serialize(ProtoBuf::ServerList_Entry* dest) const;
         void sync(ExternalStorage* externalStorage);
+        void sync(ExternalStorage::Batch* batch);
 
         bool isMaster() const {
             return (status == ServerStatus::UP) &&
@@ -176,6 +180,7 @@ class CoordinatorServerList : public AbstractServerList{
     virtual void serverCrashed(ServerId serverId);
     bool setMasterRecoveryInfo(ServerId serverId,
                 const ProtoBuf::MasterRecoveryInfo* recoveryInfo);
+    void setUpdateFanout(uint32_t fanout);
     void startUpdater();
 
   PRIVATE:
@@ -211,7 +216,7 @@ class CoordinatorServerList : public AbstractServerList{
       friend class CoordinatorServerList;
       public:
         UpdateServerListRpc(Context* context, ServerId serverId,
-                const ProtoBuf::ServerList* list);
+                const ProtoBuf::ServerList* list, bool relay = false);
         ~UpdateServerListRpc() {}
         /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
         void wait() {waitAndCheckErrors();}
@@ -219,6 +224,13 @@ class CoordinatorServerList : public AbstractServerList{
 
       PRIVATE:
         bool appendServerList(const ProtoBuf::ServerList* list);
+        void setRelayTargets();
+
+        /// Servers to which the recipient is asked to relay this update,
+        /// in the order they appear in the request. Only used for
+        /// RELAY_SERVER_LIST requests.
+        std::vector<ServerId> relayTargets;
+
         DISALLOW_COPY_AND_ASSIGN(UpdateServerListRpc);
     };
 
@@ -308,7 +320,8 @@ class CoordinatorServerList : public AbstractServerList{
     CoordinatorServerList::Entry* getEntry(ServerId id) const;
     CoordinatorServerList::Entry* getEntry(size_t index) const;
     void persistAndPropagate(const Lock& lock, Entry* entry,
-                             ServerChangeEvent event);
+                             ServerChangeEvent event,
+                             ExternalStorage::Batch* batch = NULL);
     void recoveryCompleted(const Lock& lock, ServerId serverId);
     void serialize(const Lock& lock, ProtoBuf::ServerList* protoBuf) const;
     void serialize(const Lock& lock, ProtoBuf::ServerList* protoBuf,
@@ -317,9 +330,12 @@ class CoordinatorServerList : public AbstractServerList{
     /// Functions related to replication groups.
     bool assignReplicationGroup(const Lock& lock, uint64_t replicationId,
                                 const vector<ServerId>* replicationGroupIds);
-    void createReplicationGroups(const Lock& lock);
-    void removeReplicationGroup(const Lock& lock, uint64_t groupId);
-    void repairReplicationGroups(const Lock& lock);
+    void createReplicationGroups(const Lock& lock,
+                                 ExternalStorage::Batch* batch = NULL);
+    void removeReplicationGroup(const Lock& lock, uint64_t groupId,
+                                ExternalStorage::Batch* batch = NULL);
+    void repairReplicationGroups(const Lock& lock,
+                                 ExternalStorage::Batch* batch = NULL);
 
     /// Functions related to keeping the cluster up-to-date
     void pushUpdate(const Lock& lock, Entry* entry);
@@ -332,6 +348,9 @@ class CoordinatorServerList : public AbstractServerList{
     void pruneUpdates(const Lock& lock);
 
     bool getWork(Tub<UpdateServerListRpc>* rpc);
+    void addRelayTargets(const Lock& lock, Entry* root,
+                         UpdateServerListRpc* rpc);
+    void relayWorkDone(UpdateServerListRpc* rpc, bool delivered);
     void workSuccess(ServerId id, uint64_t currentVersion);
     void workFailed(ServerId id);
     void waitForWork();
@@ -415,6 +434,22 @@ class CoordinatorServerList : public AbstractServerList{
      */
     uint32_t numUpdatingServers;
 
+    /**
+     * If nonzero, each incremental update RPC from the coordinator is a
+     * RELAY_SERVER_LIST request whose recipient forwards the update to up
+     * to this many other servers, so it covers up to updateFanout + 1
+     * servers. Zero means the coordinator sends every server its own
+     * update RPC.
+     */
+    uint32_t updateFanout;
+
+    /**
+     * Total number of update RPCs the updater has started (not counting
+     * those sent by relaying servers). Used for performance
+     * measurements and testing.
+     */
+    uint64_t numUpdateRpcs;
+
     /**
      * The number of backups in a replication group. Currently there is
      * no way to set this value based on cluster configuration information
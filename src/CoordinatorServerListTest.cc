@@ -16,10 +16,12 @@
 #include <thread>
 #include <mutex>
 #include <queue>
+#include <set>
 
 #include "TestUtil.h"
 #include "AbstractServerList.h"
 #include "CoordinatorServerList.h"
+#include "Cycles.h"
 #include "MockCluster.h"
 #include "MockTransport.h"
 #include "RamCloud.h"
@@ -180,6 +182,23 @@ class CoordinatorServerListTest : public ::testing::Test {
         }
     }
 
+    // Enlist two servers and bring them up to date, then generate an
+    // incremental update and fill in rpc with an update RPC for one of
+    // them that the other will receive by relay.
+    void startRelayedUpdate() {
+        sl->enlistServer({WireFormat::BACKUP_SERVICE,
+                WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server1");
+        sl->enlistServer({WireFormat::BACKUP_SERVICE,
+                WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server2");
+        while (sl->getWork(&rpc)) {
+            sl->workSuccess(rpc->id, ~0lu);
+        }
+        sl->setUpdateFanout(1);
+        sl->enlistServer({}, 0, 0, "mock:host=server3");
+        ASSERT_TRUE(sl->getWork(&rpc));
+        ASSERT_EQ(1u, rpc->relayTargets.size());
+    }
+
     // This method is used to pre-initialize entries in the server list,
     // without persisting or propagating any of the information.
     CoordinatorServerList::Entry*
@@ -400,6 +419,25 @@ TEST_F(CoordinatorServerListTest, enlistServer_createReplicationGroup) {
             "replication group 1", TestLog::get());
 }
 
+TEST_F(CoordinatorServerListTest, enlistServer_batchStorageWrites) {
+    sl->enlistServer({WireFormat::BACKUP_SERVICE}, 0, 100,
+            "mock:host=backup1");
+    sl->enlistServer({WireFormat::BACKUP_SERVICE}, 0, 100,
+            "mock:host=backup2");
+
+    // The third backup completes a replication group, which modifies all
+    // three entries; these are written along with the new entry, in a
+    // single round trip.
+    storage->log.clear();
+    uint64_t roundTrips = storage->writeRoundTrips;
+    sl->enlistServer({WireFormat::BACKUP_SERVICE}, 0, 100,
+            "mock:host=backup3");
+    EXPECT_EQ(1u, storage->writeRoundTrips - roundTrips);
+    EXPECT_EQ("setMulti(UPDATE servers/3, UPDATE servers/2, "
+            "UPDATE servers/1)", storage->log);
+    EXPECT_EQ(1u, sl->getEntry({3, 0})->replicationId);
+}
+
 TEST_F(CoordinatorServerListTest, masterCount) {
     EXPECT_EQ(0U, sl->masterCount());
     sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0, "mock:host=node1");
@@ -1610,6 +1648,61 @@ TEST_F(CoordinatorServerListTest, getWork_noUpdatableServers) {
     EXPECT_EQ(0u, sl->updates.size());
 }
 
+TEST_F(CoordinatorServerListTest, getWork_relayTargets) {
+    ServerId id1 = sl->enlistServer({WireFormat::BACKUP_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server1");
+    ServerId id2 = sl->enlistServer({WireFormat::BACKUP_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server2");
+    ServerId id3 = sl->enlistServer({WireFormat::BACKUP_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server3");
+    sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0,
+            "mock:host=server4");
+    while (sl->getWork(&rpc)) {
+        sl->workSuccess(rpc->id, ~0lu);
+    }
+
+    // Full list updates are never relayed.
+    sl->setUpdateFanout(2);
+    ServerId id5 = sl->enlistServer({WireFormat::BACKUP_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server5");
+    while (sl->getWork(&rpc)) {
+        if (rpc->id == id5) {
+            EXPECT_EQ(0u, rpc->relayTargets.size());
+            EXPECT_EQ(WireFormat::UPDATE_SERVER_LIST, rpc->request.getStart<
+                    WireFormat::UpdateServerList::Request>()->common.opcode);
+        }
+        sl->workSuccess(rpc->id, ~0lu);
+        for (ServerId target : rpc->relayTargets) {
+            sl->workSuccess(target, ~0lu);
+        }
+    }
+
+    // An incremental update goes to one server, which forwards it to the
+    // other servers with the same version (but not server3, which crashed,
+    // or server4, which has no admin service).
+    sl->serverCrashed(id3);
+    ASSERT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(2u, rpc->relayTargets.size());
+    EXPECT_EQ(3u, sl->numUpdatingServers);
+    std::set<ServerId> recipients = {rpc->id};
+    for (ServerId target : rpc->relayTargets) {
+        recipients.insert(target);
+        EXPECT_EQ(sl->version, sl->getEntry(target)->updateVersion);
+    }
+    EXPECT_EQ((std::set<ServerId>{id1, id2, id5}), recipients);
+    WireFormat::RelayServerList::Request* reqHdr = rpc->request.getStart<
+            WireFormat::RelayServerList::Request>();
+    EXPECT_EQ(WireFormat::RELAY_SERVER_LIST, reqHdr->common.opcode);
+    EXPECT_EQ(2u, reqHdr->relayCount);
+    const uint64_t* ids = rpc->request.getOffset<uint64_t>(
+            rpc->request.size() - 2 * sizeof32(uint64_t));
+    EXPECT_EQ(rpc->relayTargets[0].getId(), ids[0]);
+    EXPECT_EQ(rpc->relayTargets[1].getId(), ids[1]);
+
+    // All three servers are being updated, so there is no more work.
+    EXPECT_FALSE(sl->getWork(&rpc));
+}
+
 static const uint64_t UNINITIALIZED_VERSION =
         CoordinatorServerList::UNINITIALIZED_VERSION;
 
@@ -1750,6 +1843,50 @@ TEST_F(CoordinatorServerListTest, workFailed_multipleInvokes) {
             TestLog::get().c_str());
 }
 
+TEST_F(CoordinatorServerListTest, relayWorkDone_delivered) {
+    startRelayedUpdate();
+    CoordinatorServerList::Entry* e = sl->getEntry(rpc->relayTargets[0]);
+    uint64_t oldVersion = e->verifiedVersion;
+    finishRpc(rpc.get(), format("0 %lu 0 %lu 0 %lu 0", sl->version,
+            rpc->relayTargets[0].getId(), sl->version).c_str());
+    sl->workSuccess(rpc->id, ~0lu);
+    TestLog::reset();
+    sl->relayWorkDone(rpc.get(), true);
+    EXPECT_EQ(format("workSuccess: ServerList Update Success: "
+            "%s update (%lu => %lu)",
+            rpc->relayTargets[0].toString().c_str(), oldVersion,
+            sl->version), TestLog::get());
+    EXPECT_EQ(sl->version, e->verifiedVersion);
+    EXPECT_EQ(sl->version, e->updateVersion);
+    EXPECT_EQ(0u, sl->numUpdatingServers);
+}
+
+TEST_F(CoordinatorServerListTest, relayWorkDone_notDelivered) {
+    startRelayedUpdate();
+    CoordinatorServerList::Entry* e = sl->getEntry(rpc->relayTargets[0]);
+    uint64_t oldVersion = e->verifiedVersion;
+
+    // The relaying server couldn't reach its target.
+    finishRpc(rpc.get(), format("0 %lu 0 %lu 0 0 0", sl->version,
+            rpc->relayTargets[0].getId()).c_str());
+    sl->workSuccess(rpc->id, ~0lu);
+    sl->relayWorkDone(rpc.get(), true);
+    EXPECT_EQ(oldVersion, e->verifiedVersion);
+    EXPECT_EQ(oldVersion, e->updateVersion);
+    EXPECT_EQ(0u, sl->numUpdatingServers);
+}
+
+TEST_F(CoordinatorServerListTest, relayWorkDone_rpcFailed) {
+    startRelayedUpdate();
+    CoordinatorServerList::Entry* e = sl->getEntry(rpc->relayTargets[0]);
+    uint64_t oldVersion = e->verifiedVersion;
+    sl->workFailed(rpc->id);
+    sl->relayWorkDone(rpc.get(), false);
+    EXPECT_EQ(oldVersion, e->verifiedVersion);
+    EXPECT_EQ(oldVersion, e->updateVersion);
+    EXPECT_EQ(0u, sl->numUpdatingServers);
+}
+
 TEST_F(CoordinatorServerListTest, appendServerList) {
     // Generate two updates, then manually stuff them into an RPC
     ProtoBuf::ServerList list1, list2, list;
@@ -1844,4 +1981,90 @@ TEST_F(CoordinatorServerListTest, Entry_sync) {
             entryPb.ShortDebugString());
 }
 
+// The following tests use a real (mock) cluster, since they need servers
+// that actually relay updates to each other; CoordinatorServerListTest
+// intercepts all of the coordinator's RPCs.
+
+/**
+ * Crash one server in a MockCluster and wait for the resulting update to
+ * reach all of the other servers.
+ *
+ * \param cluster
+ *      Cluster containing the server.
+ * \param id
+ *      Server to crash.
+ * \param fanout
+ *      Passed to CoordinatorServerList::setUpdateFanout before crashing
+ *      the server.
+ * \return
+ *      The number of update RPCs the coordinator issued to propagate the
+ *      update.
+ */
+static uint64_t
+propagateCrash(MockCluster* cluster, ServerId id, uint32_t fanout)
+{
+    CoordinatorServerList* sl =
+            cluster->coordinatorContext.coordinatorServerList;
+    sl->setUpdateFanout(fanout);
+    uint64_t rpcsBefore = sl->numUpdateRpcs;
+    uint64_t start = Cycles::rdtsc();
+    sl->serverCrashed(id);
+    sl->sync();
+    uint64_t rpcs = sl->numUpdateRpcs - rpcsBefore;
+    LOG(NOTICE, "Server list update reached %lu servers in %.2f ms "
+            "(fanout %u, %lu coordinator RPCs)", cluster->servers.size() - 1,
+            Cycles::toSeconds(Cycles::rdtsc() - start) * 1e03, fanout, rpcs);
+    return rpcs;
+}
+
+/**
+ * Create a MockCluster with a given number of servers that run only a
+ * backup and an admin service, and check that relaying server list
+ * updates both
+ * delivers them to every server and reduces the number of RPCs the
+ * coordinator issues.
+ */
+static void
+testRelayedPropagation(uint32_t numServers, uint32_t fanout)
+{
+    Context context;
+    MockCluster cluster(&context);
+    cluster.coordinatorContext.recoveryManager->doNotStartRecoveries = true;
+    CoordinatorServerList* sl =
+            cluster.coordinatorContext.coordinatorServerList;
+    sl->setUpdateFanout(fanout);
+    ServerConfig config = ServerConfig::forTesting();
+    config.services = {WireFormat::BACKUP_SERVICE,
+            WireFormat::ADMIN_SERVICE};
+    for (uint32_t i = 0; i < numServers; i++) {
+        cluster.addServer(config);
+    }
+
+    // Without relaying, every live server gets its own RPC.
+    EXPECT_EQ(numServers - 1, propagateCrash(&cluster,
+            cluster.servers[0]->serverId, 0));
+
+    // With relaying, each coordinator RPC covers fanout + 1 servers.
+    uint32_t perRpc = fanout + 1;
+    EXPECT_EQ((numServers - 2 + perRpc - 1) / perRpc, propagateCrash(
+            &cluster, cluster.servers[1]->serverId, fanout));
+    for (uint32_t i = 2; i < numServers; i++) {
+        EXPECT_EQ(sl->version, cluster.contexts[i]->serverList->getVersion());
+    }
+}
+
+TEST(CoordinatorServerListRelayTest, propagation) {
+    TestLog::Enable _;
+    testRelayedPropagation(20, 4);
+}
+
+// Reports time-to-full-propagation for a large cluster. It is too slow to
+// run routinely (each server has its own worker threads), so it is
+// disabled; run it by passing --gtest_also_run_disabled_tests and
+// --gtest_filter=CoordinatorServerListRelayTest.* to the test binary.
+TEST(CoordinatorServerListRelayTest, DISABLED_propagation_1000Servers) {
+    Logger::get().setLogLevels(NOTICE);
+    testRelayedPropagation(1000, 32);
+}
+
 } // namespace RAMCloud
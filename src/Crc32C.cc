@@ -15,6 +15,9 @@
 
 // RAMCloud pragma [CPPLINT=0]
 
+#include <wmmintrin.h>
+#include <nmmintrin.h>
+
 #include "Crc32C.h"
 #include "Logger.h"
 #include "ShortMacros.h"
@@ -36,14 +39,252 @@ haveSse42() {
         LOG(DEBUG, "Processor does not have SSE 4.2");
     return ret;
 }
+
+bool
+havePclmulqdq() {
+    uint32_t a, b, c, d;
+    CPUID(1, a, b, c, d);
+    bool ret = ((c & (1 << 1)) != 0);
+    if (ret)
+        LOG(DEBUG, "Processor has PCLMULQDQ");
+    else
+        LOG(DEBUG, "Processor does not have PCLMULQDQ");
+    return ret;
+}
+
+/// The CRC32C (Castagnoli) polynomial in bit-reflected form, as used by the
+/// crc32 instruction. Bit 31 is the coefficient of x^0.
+const uint32_t POLYNOMIAL = 0x82f63b78;
+
+/**
+ * Multiply two polynomials modulo the CRC32C polynomial. Both arguments and
+ * the result are in the same bit-reflected form as a raw CRC register.
+ */
+uint32_t
+multiplyModP(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+    // Consume a from its x^0 coefficient (bit 31) upwards, multiplying b
+    // by x at each step.
+    for (; a != 0; a <<= 1) {
+        if (a & (1u << 31))
+            product ^= b;
+        b = (b & 1) ? (b >> 1) ^ POLYNOMIAL : b >> 1;
+    }
+    return product;
+}
+
+/**
+ * Return x^n modulo the CRC32C polynomial in bit-reflected form.
+ * Multiplying a raw CRC register by x^(8*k) has the same effect as feeding
+ * k zero bytes through it.
+ */
+uint32_t
+xPowerModP(uint64_t n)
+{
+    // powers[i] holds x^(2^i). A function-local static, rather than a
+    // global, so that it is usable during static initialization.
+    static const struct Powers {
+        Powers() : value() {
+            value[0] = 1u << 30;      // x^1
+            for (int i = 1; i < 64; i++)
+                value[i] = multiplyModP(value[i - 1], value[i - 1]);
+        }
+        uint32_t value[64];
+    } powers;
+
+    uint32_t result = 1u << 31;       // x^0
+    for (int i = 0; n != 0; i++, n >>= 1) {
+        if (n & 1)
+            result = multiplyModP(powers.value[i], result);
+    }
+    return result;
+}
+
+/// Length in bytes of each of the three streams in the main loop of
+/// intelCrc32CInterleaved(). Large enough that the cost of merging the
+/// streams is negligible.
+const uint64_t LONG_BLOCK = 8192;
+
+/// Length in bytes of each of the three streams used to finish off what is
+/// left after the LONG_BLOCK loop.
+const uint64_t SHORT_BLOCK = 256;
+
+/**
+ * Precomputed constants for advancing a raw CRC register over LONG_BLOCK or
+ * SHORT_BLOCK zero bytes, which is how the three streams of
+ * intelCrc32CInterleaved() are merged.
+ */
+struct ShiftTables {
+    ShiftTables()
+        : longConstant(xPowerModP(8 * LONG_BLOCK - 33))
+        , shortConstant(xPowerModP(8 * SHORT_BLOCK - 33))
+        , longTable()
+        , shortTable()
+        , ready(false)
+    {
+        uint32_t longShift = xPowerModP(8 * LONG_BLOCK);
+        uint32_t shortShift = xPowerModP(8 * SHORT_BLOCK);
+        for (uint32_t i = 0; i < 4; i++) {
+            for (uint32_t b = 0; b < 256; b++) {
+                longTable[i][b] = multiplyModP(longShift, b << (8 * i));
+                shortTable[i][b] = multiplyModP(shortShift, b << (8 * i));
+            }
+        }
+        ready = true;
+    }
+
+    /// x^(8*LONG_BLOCK - 33) and x^(8*SHORT_BLOCK - 33) modulo the
+    /// polynomial: the extra x^33 is contributed by the carry-less multiply
+    /// and the crc32 instruction used to reduce its result.
+    uint32_t longConstant;
+    uint32_t shortConstant;
+
+    /// Byte-wise tables for shifting over LONG_BLOCK and SHORT_BLOCK zero
+    /// bytes on machines without PCLMULQDQ.
+    uint32_t longTable[4][256];
+    uint32_t shortTable[4][256];
+
+    /// False until the constructor has run. Checksums computed during static
+    /// initialization of other files fall back to the serial path.
+    bool ready;
+} shiftTables;
+
+/**
+ * Advance a raw CRC register over a block of zero bytes using a table from
+ * #shiftTables.
+ */
+inline uint32_t
+tableShift(const uint32_t (&table)[4][256], uint32_t crc)
+{
+    return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+           table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+#if __SSE4_2__
+/**
+ * Advance a raw CRC register over a block of zero bytes using one carry-less
+ * multiply by the block's constant from #shiftTables followed by a crc32
+ * instruction to reduce the 64-bit product.
+ */
+__attribute__((target("pclmul,sse4.2")))
+uint32_t
+carrylessShift(uint32_t constant, uint32_t crc)
+{
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc),
+                                           _mm_cvtsi32_si128(constant), 0);
+    return static_cast<uint32_t>(_mm_crc32_u64(0, _mm_cvtsi128_si64(product)));
+}
+
+/**
+ * Checksum three consecutive blocks of \a blockBytes each using three
+ * independent chains of crc32 instructions, then merge them.
+ */
+template<uint64_t blockBytes>
+inline uint32_t
+crc32CThreeWay(uint32_t crc, const uint64_t* p64, bool carryless,
+               uint32_t constant, const uint32_t (&table)[4][256])
+{
+    const uint64_t words = blockBytes / 8;
+    uint64_t crc0 = crc;
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (uint64_t i = 0; i < words; i++) {
+        crc0 = __builtin_ia32_crc32di(crc0, p64[i]);
+        crc1 = __builtin_ia32_crc32di(crc1, p64[i + words]);
+        crc2 = __builtin_ia32_crc32di(crc2, p64[i + 2 * words]);
+    }
+    uint32_t merged;
+    if (carryless) {
+        merged = carrylessShift(constant, static_cast<uint32_t>(crc0)) ^
+                 static_cast<uint32_t>(crc1);
+        merged = carrylessShift(constant, merged) ^
+                 static_cast<uint32_t>(crc2);
+    } else {
+        merged = tableShift(table, static_cast<uint32_t>(crc0)) ^
+                 static_cast<uint32_t>(crc1);
+        merged = tableShift(table, merged) ^ static_cast<uint32_t>(crc2);
+    }
+    return merged;
+}
+#endif /* __SSE4_2__ */
+
 } // anonymous namespace
 
 #if __SSE4_2__
 bool Crc32C::haveHardware = haveSse42();
+bool Crc32C::haveCarrylessMultiply = havePclmulqdq();
 #else
 bool Crc32C::haveHardware = false;
+bool Crc32C::haveCarrylessMultiply = false;
 #endif
 
+const uint32_t Crc32C::INTERLEAVE_THRESHOLD;
+
+/**
+ * Same as intelCrc32C(), but splits large buffers into three equal blocks
+ * whose checksums are computed with interleaved, independent chains of crc32
+ * instructions. Each crc32 instruction has a latency of 3 cycles but a
+ * throughput of one per cycle, so the serial chain in intelCrc32C() leaves
+ * two thirds of the unit idle. The per-block results are merged by advancing
+ * the earlier block's CRC over the length of the later one, using PCLMULQDQ
+ * when it is available and lookup tables otherwise.
+ */
+uint32_t
+intelCrc32CInterleaved(uint32_t crc, const void* buffer, uint64_t bytes)
+{
+#if __SSE4_2__
+    if (!shiftTables.ready)
+        return intelCrc32C(crc, buffer, bytes);
+
+    // Align to 8 bytes so that the streams below use aligned loads.
+    const uint8_t* p8 = static_cast<const uint8_t*>(buffer);
+    while (bytes > 0 && (reinterpret_cast<uintptr_t>(p8) & 7) != 0) {
+        crc = __builtin_ia32_crc32qi(crc, *p8);
+        p8++;
+        bytes--;
+    }
+
+    const uint64_t* p64 = reinterpret_cast<const uint64_t*>(p8);
+    bool carryless = Crc32C::haveCarrylessMultiply;
+    while (bytes >= 3 * LONG_BLOCK) {
+        crc = crc32CThreeWay<LONG_BLOCK>(crc, p64, carryless,
+                shiftTables.longConstant, shiftTables.longTable);
+        p64 += 3 * LONG_BLOCK / 8;
+        bytes -= 3 * LONG_BLOCK;
+    }
+    while (bytes >= 3 * SHORT_BLOCK) {
+        crc = crc32CThreeWay<SHORT_BLOCK>(crc, p64, carryless,
+                shiftTables.shortConstant, shiftTables.shortTable);
+        p64 += 3 * SHORT_BLOCK / 8;
+        bytes -= 3 * SHORT_BLOCK;
+    }
+    return intelCrc32C(crc, p64, bytes);
+#else
+    throw FatalError(HERE, "SSE 4.2 was not enabled at compile-time");
+#endif /* __SSE4_2__ */
+}
+
+/**
+ * Compute the checksum of the concatenation of two pieces of data from the
+ * checksums of the individual pieces, without looking at the data itself.
+ * Takes time logarithmic in \a lengthB.
+ * \param crcA
+ *      Result of a Crc32C over the first piece of data.
+ * \param crcB
+ *      Result of a Crc32C over the second piece of data.
+ * \param lengthB
+ *      Length in bytes of the second piece of data.
+ * \return
+ *      The value #getResult() would return after checksumming the first
+ *      piece of data followed by the second.
+ */
+Crc32C::ResultType
+Crc32C::combine(ResultType crcA, ResultType crcB, uint64_t lengthB)
+{
+    return multiplyModP(xPowerModP(8 * lengthB), crcA) ^ crcB;
+}
+
 } // namespace RAMCloud
 
 namespace Crc32CSlicingBy8 {
@@ -92,6 +92,9 @@ intelCrc32C(uint32_t crc, const void* buffer, uint64_t bytes)
     return crc;
 }
 
+uint32_t intelCrc32CInterleaved(uint32_t crc, const void* buffer,
+                                uint64_t bytes);
+
 /// See #Crc32C().
 static inline uint32_t
 softwareCrc32C(uint32_t crc, const void* data, uint64_t length)
@@ -163,6 +166,12 @@ softwareCrc32C(uint32_t crc, const void* data, uint64_t length)
  * processors. On processors without that instruction, it calculates the same
  * function much more slowly in software (just under 400 MB/sec in software vs
  * just under 2000 MB/sec in hardware on Westmere boxes).
+ *
+ * A single chain of crc32 instructions is limited by the instruction's
+ * 3-cycle latency, so buffers of at least #INTERLEAVE_THRESHOLD bytes are
+ * split into three blocks whose checksums are computed concurrently and then
+ * merged (see intelCrc32CInterleaved()); this roughly triples throughput on
+ * large buffers such as segments and recovery data.
  */
 class Crc32C {
   public:
@@ -172,6 +181,13 @@ class Crc32C {
      */
     typedef uint32_t ResultType;
 
+    /**
+     * Buffers at least this large are checksummed with three interleaved
+     * streams of crc32 instructions rather than a single serial stream.
+     * Below this size the cost of merging the streams outweighs the gain.
+     */
+    static const uint32_t INTERLEAVE_THRESHOLD = 768;
+
     Crc32C(bool forceSoftware=false)
         : useHardware(!forceSoftware && haveHardware)
         , result(-1)
@@ -200,8 +216,12 @@ class Crc32C {
     Crc32C&
     update(const void* buffer, uint32_t bytes)
     {
-        result = useHardware ? intelCrc32C(result, buffer, bytes)
-                             : softwareCrc32C(result, buffer, bytes);
+        if (!useHardware)
+            result = softwareCrc32C(result, buffer, bytes);
+        else if (bytes >= INTERLEAVE_THRESHOLD)
+            result = intelCrc32CInterleaved(result, buffer, bytes);
+        else
+            result = intelCrc32C(result, buffer, bytes);
         return *this;
     }
 
@@ -248,10 +268,48 @@ class Crc32C {
         return ~result;
     }
 
+    /**
+     * Return true if this machine has Intel's CRC32C instruction, in which
+     * case instances not constructed with forceSoftware use it.
+     */
+    static bool hardwareAvailable() {
+        return haveHardware;
+    }
+
+    static ResultType combine(ResultType crcA, ResultType crcB,
+                              uint64_t lengthB);
+
+    /**
+     * Extend the accumulated checksum as if the data checksummed by another
+     * instance had been passed to #update() on this one. This allows the
+     * pieces of a large region to be checksummed independently (for example,
+     * on different threads) and then stitched together.
+     * \param other
+     *      Checksum of the data that logically follows the data already
+     *      covered by this instance.
+     * \param otherBytes
+     *      The number of bytes covered by \a other.
+     * \return
+     *      A reference to this instance for chaining calls.
+     */
+    Crc32C&
+    combine(const Crc32C& other, uint64_t otherBytes)
+    {
+        result = ~combine(getResult(), other.getResult(), otherBytes);
+        return *this;
+    }
+
   PRIVATE:
     /// Whether this machine has Intel's CRC32C instruction.
     static bool haveHardware;
 
+    /// Whether this machine has the PCLMULQDQ carry-less multiply
+    /// instruction, which intelCrc32CInterleaved() uses to merge streams.
+    static bool haveCarrylessMultiply;
+
+    friend uint32_t intelCrc32CInterleaved(uint32_t crc, const void* buffer,
+                                           uint64_t bytes);
+
     /// Whether this checksum instance should use Intel's CRC32C instruction.
     bool useHardware;
 
@@ -133,4 +133,67 @@ TEST_P(Crc32CTest, assignmentOperator) {
     EXPECT_EQ(a.result, b.result);
 }
 
+TEST_P(Crc32CTest, combine_static) {
+    for (unsigned int total = 0; total <= sizeof(input); total += 8) {
+        for (unsigned int split = 0; split <= total; split++) {
+            uint32_t crcA = Crc32C(forceSoftware).update(input, split)
+                                                 .getResult();
+            uint32_t crcB = Crc32C(forceSoftware).update(&input[split],
+                                                         total - split)
+                                                 .getResult();
+            EXPECT_EQ(crcByLength[total],
+                      Crc32C::combine(crcA, crcB, total - split));
+        }
+    }
+}
+
+TEST_P(Crc32CTest, combine) {
+    for (unsigned int split = 0; split <= sizeof(input); split++) {
+        Crc32C a(forceSoftware);
+        Crc32C b(forceSoftware);
+        a.update(input, split);
+        b.update(&input[split], sizeof32(input) - split);
+        a.combine(b, sizeof(input) - split);
+        EXPECT_EQ(crcByLength[sizeof(input)], a.getResult());
+    }
+
+    // Updates after a combine continue the combined checksum.
+    Crc32C a(forceSoftware);
+    Crc32C b(forceSoftware);
+    a.update(input, 40);
+    b.update(&input[40], 20);
+    a.combine(b, 20).update(&input[60], 21);
+    EXPECT_EQ(crcByLength[sizeof(input)], a.getResult());
+}
+
+TEST(Crc32CInterleavedTest, matchesSerial) {
+    if (!Crc32C::haveHardware)
+        return;
+    std::vector<uint8_t> data(100000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(generateRandom());
+
+    // Lengths around each of the block boundaries in the interleaved loop.
+    std::vector<uint64_t> lengths = { 0, 1, 7, 8, 9, 767, 768, 769, 1535,
+                                      1536, 1543, 24575, 24576, 24577, 25343,
+                                      25344, 49152, 99000 };
+    // Only force the PCLMULQDQ merge on if cpuid reported it; otherwise the
+    // test would die with SIGILL.
+    bool savedCarryless = Crc32C::haveCarrylessMultiply;
+    for (int carryless = 0; carryless <= savedCarryless; carryless++) {
+        Crc32C::haveCarrylessMultiply = carryless;
+        for (uint64_t length : lengths) {
+            for (uint64_t offset = 0; offset < 8; offset += 3) {
+                uint32_t serial = intelCrc32C(~0U, &data[offset], length);
+                EXPECT_EQ(serial, intelCrc32CInterleaved(~0U, &data[offset],
+                                                         length))
+                    << "carryless " << carryless << ", length " << length
+                    << ", offset " << offset;
+                EXPECT_EQ(serial, softwareCrc32C(~0U, &data[offset], length));
+            }
+        }
+    }
+    Crc32C::haveCarrylessMultiply = savedCarryless;
+}
+
 } // namespace RAMCloud
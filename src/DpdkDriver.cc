@@ -29,9 +29,11 @@
 #pragma GCC diagnostic ignored "-Wall"
 #include <rte_config.h>
 #include <rte_common.h>
+#include <rte_dev.h>
 #include <rte_errno.h>
 #include <rte_ethdev.h>
 #include <rte_mbuf.h>
+#include <rte_memory.h>
 #include <rte_memcpy.h>
 #include <rte_ring.h>
 #include <rte_version.h>
@@ -47,6 +49,14 @@
 #include "TimeTrace.h"
 #include "Util.h"
 
+// Zero-copy transmit needs external mbuf buffers and the ability to
+// register memory that DPDK didn't allocate for DMA.
+#if RTE_VERSION >= RTE_VERSION_NUM(19, 5, 0, 0)
+#define ZERO_COPY_TX 1
+#else
+#define ZERO_COPY_TX 0
+#endif
+
 namespace RAMCloud
 {
 
@@ -91,6 +101,11 @@ DpdkDriver::DpdkDriver(Context* context, int port)
     , queueEstimator(0)
     , maxTransmitQueueSize(0)
     , fileLogger(NOTICE, "DPDK: ")
+    , externalPool(NULL)
+    , zeroCopyBase(NULL)
+    , zeroCopyBytes(0)
+    , transmitTracker()
+    , zeroCopyPool()
 {
     struct ether_addr mac;
     uint8_t numPorts;
@@ -153,6 +168,22 @@ DpdkDriver::DpdkDriver(Context* context, int port)
     memset(&portConf, 0, sizeof(portConf));
     portConf.rxmode.max_rx_pkt_len = MAX_PAYLOAD_SIZE +
             static_cast<uint32_t>(sizeof(NetUtil::EthernetHeader));
+#if ZERO_COPY_TX
+    // Zero-copy transmits chain mbufs attached to external memory (see
+    // registerMemory), so the NIC must accept multi-segment packets.
+    struct rte_eth_dev_info devInfo;
+    rte_eth_dev_info_get(portId, &devInfo);
+    if ((devInfo.tx_offload_capa & DEV_TX_OFFLOAD_MULTI_SEGS) &&
+            rte_eal_iova_mode() == RTE_IOVA_VA) {
+        portConf.txmode.offloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+        externalPool = rte_pktmbuf_pool_create("extbuf_pool", NB_MBUF, 32,
+                0, 0, rte_socket_id());
+    }
+    if (externalPool == NULL) {
+        LOG(NOTICE, "Zero-copy transmit is not supported on port %u; "
+                "payloads will be copied", portId);
+    }
+#endif
     rte_eth_dev_configure(portId, 1, 1, &portConf);
 
     // Set up a NIC/HW-based filter on the ethernet type so that only
@@ -381,6 +412,16 @@ DpdkDriver::sendPacket(const Address *addr,
         return;
     }
 
+    // Packets sent to ourselves go through the loopback ring, and the
+    // receive path expects them in a single mbuf.
+    bool loopback = !memcmp(static_cast<const MacAddress*>(addr)->address,
+            localMac->address, 6);
+    if (zeroCopyBase != NULL && !loopback && payload != NULL &&
+            payload->size() >= ZERO_COPY_THRESHOLD) {
+        sendZeroCopy(mbuf, addr, header, headerLen, payload);
+        return;
+    }
+
     data = rte_pktmbuf_append(mbuf, downCast<uint16_t>(datagramLength));
 
     char *p = data;
@@ -411,8 +452,7 @@ DpdkDriver::sendPacket(const Address *addr,
     timeTrace("about to enqueue outgoing packet");
 
     // loopback if src mac == dst mac
-    if (!memcmp(static_cast<const MacAddress*>(addr)->address,
-            localMac->address, 6)) {
+    if (loopback) {
         rte_ring_enqueue(loopbackRing, mbuf);
     } else {
         uint32_t ret = rte_eth_tx_burst(portId, 0, &mbuf, 1);
@@ -425,6 +465,157 @@ DpdkDriver::sendPacket(const Address *addr,
     queueEstimator.packetQueued(totalLength, Cycles::rdtsc());
 }
 
+/**
+ * Finish sending a packet whose payload may include chunks of registered
+ * memory; these are attached to the packet as external buffers instead of
+ * being copied. The arguments are the same as for sendPacket, except:
+ *
+ * \param mbuf
+ *      Freshly allocated mbuf for the start of the packet; this method
+ *      takes ownership of it.
+ */
+void
+DpdkDriver::sendZeroCopy(struct rte_mbuf* mbuf, const Address *addr,
+        const void *header, uint32_t headerLen, Buffer::Iterator *payload)
+{
+#if ZERO_COPY_TX
+    uint32_t totalLength = headerLen + payload->size();
+    char* p = rte_pktmbuf_append(mbuf, downCast<uint16_t>(
+            sizeof(NetUtil::EthernetHeader) + headerLen));
+    NetUtil::EthernetHeader* ethHdr =
+            reinterpret_cast<NetUtil::EthernetHeader*>(p);
+    rte_memcpy(&ethHdr->destAddress,
+            static_cast<const MacAddress*>(addr)->address, 6);
+    rte_memcpy(&ethHdr->srcAddress, localMac->address, 6);
+    ethHdr->etherType = HTONS(NetUtil::EthPayloadType::RAMCLOUD);
+    rte_memcpy(p + sizeof(*ethHdr), header, headerLen);
+
+    // All of the external buffers in this packet share one
+    // ZeroCopyTransmit; DPDK invokes zeroCopyDone when it frees the last
+    // mbuf that refers to one of them.
+    ZeroCopyTransmit* transmit = NULL;
+    struct rte_mbuf_ext_shared_info* sharedInfo = NULL;
+    bool allocFailed = false;
+    for (; !payload->isDone(); payload->next()) {
+        char* chunk = static_cast<char*>(const_cast<void*>(
+                payload->getData()));
+        uint16_t length = downCast<uint16_t>(payload->getLength());
+        struct rte_mbuf* last = rte_pktmbuf_lastseg(mbuf);
+
+        // Leave room for a segment to hold any bytes copied afterwards.
+        if (length >= ZERO_COPY_THRESHOLD && chunk >= zeroCopyBase &&
+                chunk + length <= zeroCopyBase + zeroCopyBytes &&
+                mbuf->nb_segs + 2 <= MAX_TX_SEGMENTS) {
+            struct rte_mbuf* segment = rte_pktmbuf_alloc(externalPool);
+            if (segment == NULL) {
+                allocFailed = true;
+                break;
+            }
+            if (transmit == NULL) {
+                transmit = zeroCopyPool.construct(this,
+                        transmitTracker.pin());
+                static_assert(sizeof(transmit->sharedInfo) >=
+                        sizeof(struct rte_mbuf_ext_shared_info),
+                        "ZeroCopyTransmit::sharedInfo is too small");
+                sharedInfo = reinterpret_cast<
+                        struct rte_mbuf_ext_shared_info*>(
+                        transmit->sharedInfo);
+                sharedInfo->free_cb = zeroCopyDone;
+                sharedInfo->fcb_opaque = transmit;
+                rte_mbuf_ext_refcnt_set(sharedInfo, 0);
+            }
+            rte_mbuf_ext_refcnt_update(sharedInfo, 1);
+            rte_pktmbuf_attach_extbuf(segment, chunk,
+                    reinterpret_cast<rte_iova_t>(chunk), length, sharedInfo);
+            segment->data_off = 0;
+            segment->data_len = length;
+            segment->pkt_len = length;
+            rte_pktmbuf_chain(mbuf, segment);
+            continue;
+        }
+
+        // Copy the chunk, starting a new segment if the last one refers
+        // to external memory.
+        if (rte_pktmbuf_tailroom(last) < length) {
+            struct rte_mbuf* segment = rte_pktmbuf_alloc(packetPool);
+            if (segment == NULL) {
+                allocFailed = true;
+                break;
+            }
+            rte_pktmbuf_chain(mbuf, segment);
+        }
+        rte_memcpy(rte_pktmbuf_append(mbuf, length), chunk, length);
+    }
+    if (allocFailed) {
+        // Freeing the chain also releases any ZeroCopyTransmit.
+        RAMCLOUD_CLOG(NOTICE,
+                "Failed to allocate a packet buffer; dropping packet");
+        rte_pktmbuf_free(mbuf);
+        return;
+    }
+    timeTrace("about to enqueue outgoing zero-copy packet");
+
+    if (rte_eth_tx_burst(portId, 0, &mbuf, 1) != 1) {
+        LOG(WARNING, "rte_eth_tx_burst failed to queue zero-copy packet; "
+                "dropping packet");
+        rte_pktmbuf_free(mbuf);
+    }
+    timeTrace("outgoing zero-copy packet enqueued");
+    queueEstimator.packetQueued(totalLength, Cycles::rdtsc());
+#endif
+}
+
+/**
+ * Invoked by DPDK when the last mbuf referring to the external buffers of
+ * a zero-copy packet is freed (normally after the NIC has transmitted it).
+ *
+ * \param addr
+ *      Address of the external buffer (not used).
+ * \param opaque
+ *      The ZeroCopyTransmit for the packet.
+ */
+void
+DpdkDriver::zeroCopyDone(void* addr, void* opaque)
+{
+    ZeroCopyTransmit* transmit = static_cast<ZeroCopyTransmit*>(opaque);
+    DpdkDriver* driver = transmit->driver;
+    driver->transmitTracker.unpin(transmit->pinnedEpoch);
+    driver->zeroCopyPool.destroy(transmit);
+}
+
+/**
+ * Register a region of memory (usually the log) for DMA by the NIC, so that
+ * sendPacket can attach large payload chunks in it to outgoing packets
+ * rather than copying them. See docs in Driver class.
+ */
+void
+DpdkDriver::registerMemory(void* base, size_t bytes)
+{
+#if ZERO_COPY_TX
+    if (externalPool == NULL) {
+        return;
+    }
+    if (zeroCopyBase != NULL) {
+        LOG(WARNING, "Only one memory region can be registered for zero-copy "
+                "transmit; ignoring region of %lu bytes at %p", bytes, base);
+        return;
+    }
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    struct rte_eth_dev_info devInfo;
+    rte_eth_dev_info_get(portId, &devInfo);
+    if (rte_extmem_register(base, bytes, NULL, 0, pageSize) != 0 ||
+            rte_dev_dma_map(devInfo.device, base,
+            reinterpret_cast<uint64_t>(base), bytes) != 0) {
+        LOG(WARNING, "Failed to register %lu bytes at %p for DMA (%s); "
+                "payloads will be copied", bytes, base,
+                rte_strerror(rte_errno));
+        return;
+    }
+    zeroCopyBase = static_cast<char*>(base);
+    zeroCopyBytes = bytes;
+#endif
+}
+
 // See docs in Driver class.
 string
 DpdkDriver::getServiceLocator()
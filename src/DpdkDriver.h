@@ -23,6 +23,7 @@
 #include "Dispatch.h"
 #include "Driver.h"
 #include "FileLogger.h"
+#include "LogProtector.h"
 #include "MacAddress.h"
 #include "NetUtil.h"
 #include "ObjectPool.h"
@@ -39,6 +40,7 @@
                    + RTE_PKTMBUF_HEADROOM)
 
 // Forward declarations, so we don't have to include DPDK headers here.
+struct rte_mbuf;
 struct rte_mempool;
 struct rte_ring;
 
@@ -69,6 +71,16 @@ class DpdkDriver : public Driver
                             uint32_t headerLen,
                             Buffer::Iterator *payload);
     virtual string getServiceLocator();
+    virtual void registerMemory(void* base, size_t bytes);
+
+    /// Payload chunks at least this long that lie in memory registered with
+    /// registerMemory are attached to outgoing packets as external buffers
+    /// rather than being copied. For shorter chunks the copy is cheaper than
+    /// the extra mbuf.
+    static const uint32_t ZERO_COPY_THRESHOLD = 1024;
+
+    /// Maximum number of mbufs chained together for a single packet.
+    static const uint32_t MAX_TX_SEGMENTS = 8;
 
     typedef Driver::PacketBuf<MacAddress, MAX_PAYLOAD_SIZE> PacketBuf;
 
@@ -128,6 +140,57 @@ class DpdkDriver : public Driver
     /// Used to redirect log entries from the DPDK log into the RAMCloud log.
     FileLogger fileLogger;
 
+    /**
+     * One of these exists for each outgoing packet that refers to registered
+     * memory; it is released (and its epoch unpinned) when DPDK frees the
+     * last mbuf attached to that memory, i.e. once the NIC is done with it.
+     */
+    struct ZeroCopyTransmit {
+        ZeroCopyTransmit(DpdkDriver* driver, uint64_t pinnedEpoch)
+            : sharedInfo()
+            , driver(driver)
+            , pinnedEpoch(pinnedEpoch)
+        {}
+
+        /// Storage for the rte_mbuf_ext_shared_info that DPDK uses to count
+        /// the mbufs attached to this packet's external buffers (DPDK
+        /// headers aren't included here).
+        uint64_t sharedInfo[4];
+
+        /// Driver that sent the packet.
+        DpdkDriver* driver;
+
+        /// Epoch pinned in driver->transmitTracker for this packet.
+        uint64_t pinnedEpoch;
+
+        DISALLOW_COPY_AND_ASSIGN(ZeroCopyTransmit);
+    };
+
+    void sendZeroCopy(struct rte_mbuf* mbuf, const Address *addr,
+            const void *header, uint32_t headerLen,
+            Buffer::Iterator *payload);
+    static void zeroCopyDone(void* addr, void* opaque);
+
+    /// Holds mbufs without data rooms; they are attached to registered
+    /// memory for zero-copy transmits. NULL means zero-copy transmit isn't
+    /// supported by this DPDK version or NIC.
+    struct rte_mempool *externalPool;
+
+    /// First byte of the memory passed to registerMemory, or NULL if
+    /// no memory is registered for zero-copy transmits.
+    char* zeroCopyBase;
+
+    /// Number of bytes of registered memory starting at zeroCopyBase.
+    size_t zeroCopyBytes;
+
+    /// Keeps the log cleaner from freeing memory that packets queued on the
+    /// NIC still refer to.
+    LogProtector::TransmitTracker transmitTracker;
+
+    /// Holds a ZeroCopyTransmit for every packet in flight that refers to
+    /// registered memory.
+    ObjectPool<ZeroCopyTransmit> zeroCopyPool;
+
     DISALLOW_COPY_AND_ASSIGN(DpdkDriver);
 };
 
@@ -304,7 +304,10 @@ class Driver {
      * addresses within that region become direct memory accessible (DMA) for
      * the NIC. This method must be implemented in the driver code if
      * the NIC needs to do zero copy transmit of buffers within that region of
-     * memory.
+     * memory. Drivers that transmit straight out of registered memory must
+     * keep it protected (see LogProtector::TransmitTracker) until the NIC
+     * has finished with each packet, since the memory may belong to the
+     * log and the RPC that referred to it may be gone by then.
      * \param base
      *     pointer to the beginning of the memory region that is to be
      *     registered to the NIC.
@@ -345,6 +348,24 @@ class Driver {
                             uint32_t headerLen,
                             Buffer::Iterator *payload) = 0;
 
+    /**
+     * Transports invoke this method before passing a burst of packets to
+     * sendPacket (for example, all of the data packets sent in one pass
+     * over outgoing messages). Until the matching call to
+     * #flushTransmitBatch, the driver may hold onto those packets so that
+     * it can hand them to the NIC or kernel together. Drivers that hold
+     * packets must copy them, since callers may free the payload as soon
+     * as sendPacket returns.
+     */
+    virtual void startTransmitBatch() {}
+
+    /**
+     * Transmits any packets held since the last call to
+     * #startTransmitBatch; packets passed to sendPacket after this method
+     * returns are sent immediately.
+     */
+    virtual void flushTransmitBatch() {}
+
     /**
      * Alternate form of sendPacket.
      *
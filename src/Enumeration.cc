@@ -15,6 +15,7 @@
 
 #include "Enumeration.h"
 #include "Object.h"
+#include "ObjectManager.h"
 
 namespace RAMCloud {
 
@@ -228,8 +229,8 @@ class ObjectHashComparator {
  *      be modified with state that should be returned to the client.
  * \param log
  *      The log containing the objects referenced in the objectMap.
- * \param objectMap
- *      The hash table of objects living on this server.
+ * \param objectManager
+ *      Owns the hash table of objects living on this server.
  * \param[out] payload
  *      A Buffer to hold the resulting objects.
  * \param maxPayloadBytes
@@ -243,7 +244,7 @@ Enumeration::Enumeration(uint64_t tableId,
                          uint64_t* nextTabletStartHash,
                          EnumerationIterator& iter,
                          Log& log,
-                         HashTable& objectMap,
+                         ObjectManager& objectManager,
                          Buffer& payload, uint32_t maxPayloadBytes)
     : tableId(tableId)
     , keysOnly(keysOnly)
@@ -253,7 +254,7 @@ Enumeration::Enumeration(uint64_t tableId,
     , nextTabletStartHash(nextTabletStartHash)
     , iter(iter)
     , log(log)
-    , objectMap(objectMap)
+    , objectManager(objectManager)
     , payload(payload)
     , maxPayloadBytes(maxPayloadBytes)
 {
@@ -269,8 +270,11 @@ Enumeration::Enumeration(uint64_t tableId,
 void
 Enumeration::complete()
 {
+    HashTable& objectMap = *objectManager.getObjectMap();
+
     // Check iterator state to see if the tablet configuration has
     // changed since the last call to enumerateTablet().
+    bool restart = false;
     if (iter.size() == 0 ||
         iter.top().tabletStartHash != actualTabletStartHash ||
         iter.top().tabletEndHash != actualTabletEndHash ||
@@ -280,6 +284,7 @@ Enumeration::complete()
             actualTabletStartHash, actualTabletEndHash,
             objectMap.getNumBuckets(), 0, 0);
         iter.push(frame);
+        restart = true;
     }
 
     uint64_t bucketIndex = iter.top().bucketIndex;
@@ -295,17 +300,48 @@ Enumeration::complete()
     args.iter = &iter;
     args.objectReferences = &objectRefs;
     void* cookie = static_cast<void*>(&args);
+
+    // If the ObjectManager keeps an index of each table's key hashes, visit
+    // only the buckets holding entries from this tablet rather than every
+    // bucket in the hash table. The list is computed when the enumeration
+    // of the tablet starts and reused by later calls.
+    std::shared_ptr<const std::vector<uint64_t>> tableBuckets =
+            objectManager.getEnumerationBuckets(tableId,
+                    actualTabletStartHash, actualTabletEndHash, numBuckets,
+                    restart);
+    bool indexed = (tableBuckets != NULL);
+    std::vector<uint64_t>::const_iterator nextTableBucket;
+    if (indexed) {
+        nextTableBucket = std::lower_bound(tableBuckets->begin(),
+                tableBuckets->end(), bucketIndex);
+        bucketIndex = (nextTableBucket == tableBuckets->end()) ?
+                numBuckets : *nextTableBucket;
+    }
+    uint64_t firstBucket = bucketIndex;
+
     while (bucketIndex < numBuckets) {
         objectRefs.clear();
         bucketStart = payload.size();
-        objectMap.forEachInBucket(enumerateBucket, cookie, bucketIndex);
+        if (!objectManager.forEachInHashTableBucket(enumerateBucket, cookie,
+                                                    numBuckets, bucketIndex)) {
+            // The hash table was resized, so bucket numbers have changed
+            // meaning. Return what we have; the next call will push a new
+            // iterator frame for the new size.
+            break;
+        }
         int64_t overflow = appendObjectsToBuffer(log, &payload, objectRefs,
                                                  maxPayloadBytes, keysOnly);
         payloadFull = overflow >= 0;
         if (payloadFull) {
             break;
         }
-        bucketIndex++;
+        if (indexed) {
+            ++nextTableBucket;
+            bucketIndex = (nextTableBucket == tableBuckets->end()) ?
+                    numBuckets : *nextTableBucket;
+        } else {
+            bucketIndex++;
+        }
     }
 
     // Clean up if last bucket is incomplete.
@@ -315,7 +351,7 @@ Enumeration::complete()
         // If we failed to enumerate at least one entire bucket, then
         // sort the current bucket and fill the buffer with whatever
         // objects can fit.
-        if (iter.top().bucketIndex == bucketIndex) {
+        if (firstBucket == bucketIndex) {
             ObjectHashComparator comparator(log);
             std::sort(objectRefs.begin(), objectRefs.end(), comparator);
 
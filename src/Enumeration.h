@@ -23,6 +23,8 @@
 
 namespace RAMCloud {
 
+class ObjectManager;
+
 /**
  * The Enumeration class encapsulates the server-side logic for
  * servicing an EnumerationRPC. This class is intended to be
@@ -44,7 +46,7 @@ class Enumeration {
                 uint64_t* nextTabletStartHash,
                 EnumerationIterator& iter,
                 Log& log,
-                HashTable& objectMap,
+                ObjectManager& objectManager,
                 Buffer& payload, uint32_t maxPayloadBytes);
     void complete();
 
@@ -76,8 +78,9 @@ class Enumeration {
     /// The log we're enumerating over. Needed to look up hash table references.
     Log& log;
 
-    /// The hash table of objects living on this server.
-    HashTable& objectMap;
+    /// Owns the hash table of objects living on this server; the table is
+    /// scanned through it so that bucket locks are held.
+    ObjectManager& objectManager;
 
     /// A Buffer to hold the resulting objects.
     Buffer& payload;
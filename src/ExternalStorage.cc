@@ -81,6 +81,28 @@ ExternalStorage::getWorkspace()
     return workspace.c_str();
 }
 
+/**
+ * Set the values of several objects in external storage. The effect is
+ * the same as invoking set for each of the writes, in order, but some
+ * storage systems can perform all of the writes with a single round trip
+ * (and atomically). The default implementation simply invokes set for each
+ * write, so it provides neither of these benefits.
+ *
+ * \param writes
+ *      Describes the objects to write; see set for details on the
+ *      individual fields.
+ *
+ * \throws LostLeadershipException
+ */
+void
+ExternalStorage::setMulti(const vector<Write>& writes)
+{
+    foreach (const Write& write, writes) {
+        set(write.flavor, write.name.c_str(), write.value.data(),
+                downCast<int>(write.value.size()));
+    }
+}
+
 // See header file for documentation.
 void
 ExternalStorage::setWorkspace(const char* pathPrefix)
@@ -198,6 +220,90 @@ ExternalStorage::Object::Object(const char* name, const char* value, int length)
     }
 }
 
+/**
+ * Construct a Write.
+ *
+ * \param flavor
+ *      Same as the corresponding argument to ExternalStorage::set.
+ * \param name
+ *      Same as the corresponding argument to ExternalStorage::set.
+ *      A local copy will be made in this Write.
+ * \param value
+ *      Same as the corresponding argument to ExternalStorage::set.
+ *      A local copy will be made in this Write.
+ * \param valueLength
+ *      Same as the corresponding argument to ExternalStorage::set.
+ */
+ExternalStorage::Write::Write(Hint flavor, const char* name,
+        const char* value, int valueLength)
+    : flavor(flavor)
+    , name(name)
+    , value(value, (valueLength < 0) ? strlen(value) + 1
+            : downCast<size_t>(valueLength))
+{}
+
+/**
+ * Construct an empty Batch.
+ *
+ * \param storage
+ *      External storage system to which the batch will be committed.
+ */
+ExternalStorage::Batch::Batch(ExternalStorage* storage)
+    : storage(storage)
+    , writes()
+{}
+
+/**
+ * Make all of the writes in the batch durable, using as few round trips
+ * to external storage as possible. When this method returns, the batch
+ * is empty and may be reused.
+ *
+ * \throws LostLeadershipException
+ */
+void
+ExternalStorage::Batch::commit()
+{
+    if (writes.size() == 1) {
+        const Write& write = writes.front();
+        storage->set(write.flavor, write.name.c_str(), write.value.data(),
+                downCast<int>(write.value.size()));
+    } else if (writes.size() > 1) {
+        storage->setMulti(writes);
+    }
+    writes.clear();
+}
+
+/**
+ * Add a write to the batch; it won't actually be performed until commit
+ * is invoked. If the batch already contains a write for the same object,
+ * that write is dropped: only the most recent value will be written.
+ *
+ * \param flavor
+ *      Same as the corresponding argument to ExternalStorage::set.
+ * \param name
+ *      Same as the corresponding argument to ExternalStorage::set.
+ * \param value
+ *      Same as the corresponding argument to ExternalStorage::set.
+ * \param valueLength
+ *      Same as the corresponding argument to ExternalStorage::set.
+ */
+void
+ExternalStorage::Batch::set(Hint flavor, const char* name, const char* value,
+        int valueLength)
+{
+    for (vector<Write>::iterator it = writes.begin(); it != writes.end();
+            it++) {
+        if (it->name == name) {
+            // Keep the object's original hint: if it didn't exist before
+            // the batch, it doesn't exist now either.
+            flavor = it->flavor;
+            writes.erase(it);
+            break;
+        }
+    }
+    writes.emplace_back(flavor, name, value, valueLength);
+}
+
 /**
  * Destructor for Objects (must free storage).
  */
@@ -134,6 +134,55 @@ class ExternalStorage {
         UPDATE                     // An existing object is being overwritten.
     };
 
+    /**
+     * Describes one of the writes passed to setMulti: the arguments
+     * of a single call to set.
+     */
+    struct Write {
+        Write(Hint flavor, const char* name, const char* value,
+                int valueLength);
+
+        /// Same as the corresponding argument to set.
+        Hint flavor;
+
+        /// Name of the object to write (relative or absolute).
+        string name;
+
+        /// New value for the object.
+        string value;
+    };
+
+    /**
+     * A Batch collects the writes that make up one logical operation (such
+     * as all of the server list entries modified when a server enlists) so
+     * that they can be sent to external storage together, with a single
+     * call to setMulti. Writes are not durable until commit has returned;
+     * if the Batch is destroyed without being committed, its writes are
+     * discarded.
+     */
+    class Batch {
+      public:
+        explicit Batch(ExternalStorage* storage);
+        void commit();
+        void set(Hint flavor, const char* name, const char* value,
+                int valueLength = -1);
+
+        /// Returns the number of writes waiting for commit.
+        size_t size() const
+        {
+            return writes.size();
+        }
+
+      PRIVATE:
+        /// Where the writes will go when committed.
+        ExternalStorage* storage;
+
+        /// Writes that have been requested but not yet committed, in order.
+        vector<Write> writes;
+
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+    };
+
     ExternalStorage();
     virtual ~ExternalStorage() {}
 
@@ -281,6 +330,8 @@ class ExternalStorage {
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1) = 0;
 
+    virtual void setMulti(const vector<Write>& writes);
+
     /**
      * Specify the current workspace for the application. This is
      * equivalent to a working directory: if a node name specified to
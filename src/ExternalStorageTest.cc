@@ -84,6 +84,54 @@ TEST_F(ExternalStorageTest, get_templated_formatError) {
             "RAMCloud.ProtoBuf.TableManager", message);
 }
 
+TEST_F(ExternalStorageTest, setMulti) {
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::CREATE, "/a", "xyzzy", 5);
+    writes.emplace_back(ExternalStorage::UPDATE, "/b", "99", 2);
+    storage.ExternalStorage::setMulti(writes);
+    EXPECT_EQ("set(CREATE, /a); set(UPDATE, /b)", storage.log);
+    EXPECT_EQ("99", storage.setData);
+}
+
+TEST_F(ExternalStorageTest, Write_constructor) {
+    ExternalStorage::Write write(ExternalStorage::UPDATE, "/a", "xyz", -1);
+    EXPECT_EQ("/a", write.name);
+    EXPECT_EQ(4u, write.value.size());
+    ExternalStorage::Write write2(ExternalStorage::UPDATE, "/a", "xyz", 2);
+    EXPECT_EQ("xy", write2.value);
+}
+
+TEST_F(ExternalStorageTest, Batch_commit) {
+    ExternalStorage::Batch batch(&storage);
+    batch.commit();
+    EXPECT_EQ("", storage.log);
+
+    // A single write doesn't need setMulti.
+    batch.set(ExternalStorage::UPDATE, "/a", "value1", 6);
+    batch.commit();
+    EXPECT_EQ("set(UPDATE, /a)", storage.log);
+    EXPECT_EQ(0u, batch.size());
+
+    storage.log.clear();
+    batch.set(ExternalStorage::UPDATE, "/a", "value1", 6);
+    batch.set(ExternalStorage::CREATE, "/b", "value2", 6);
+    EXPECT_EQ("", storage.log);
+    batch.commit();
+    EXPECT_EQ("setMulti(UPDATE /a, CREATE /b)", storage.log);
+    EXPECT_EQ(2u, storage.writeRoundTrips);
+}
+
+TEST_F(ExternalStorageTest, Batch_set_sameObject) {
+    ExternalStorage::Batch batch(&storage);
+    batch.set(ExternalStorage::CREATE, "/a", "value1", 6);
+    batch.set(ExternalStorage::UPDATE, "/b", "value2", 6);
+    batch.set(ExternalStorage::UPDATE, "/a", "value3", 6);
+    EXPECT_EQ(2u, batch.size());
+    batch.commit();
+    EXPECT_EQ("setMulti(UPDATE /b, CREATE /a)", storage.log);
+    EXPECT_EQ("value3", storage.setData);
+}
+
 TEST_F(ExternalStorageTest, open_unknown) {
     EXPECT_TRUE(ExternalStorage::open("bogus:", NULL) == NULL);
 }
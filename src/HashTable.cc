@@ -13,11 +13,94 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#if __SSE2__
+#include <immintrin.h>
+#endif
+
 #include "Common.h"
 #include "HashTable.h"
 
 namespace RAMCloud {
 
+HashTable::ProbeMode HashTable::supportedProbeMode =
+    HashTable::detectProbeMode();
+
+namespace {
+
+/**
+ * Bits of a packed Entry that must equal those of the key being looked up
+ * for the Entry to be a candidate: the secondary hash and the chain bit
+ * (which must be clear). See HashTable::Entry::value.
+ */
+const uint64_t TAG_MASK = 0xffff800000000000UL;
+
+#if __SSE2__
+/**
+ * SSE2 version of HashTable::findMatches(); see that method for
+ * documentation. Handles two entries per vector.
+ */
+uint32_t
+sse2FindMatches(const uint64_t* entries, uint32_t numEntries,
+                uint64_t secondaryHash)
+{
+    const __m128i tagMask = _mm_set1_epi64x(static_cast<int64_t>(TAG_MASK));
+    const __m128i tag = _mm_set1_epi64x(
+            static_cast<int64_t>(secondaryHash << 48));
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t matches = 0;
+
+    for (uint32_t i = 0; i < numEntries; i += 2) {
+        __m128i v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(&entries[i]));
+
+        // SSE2 has no 64-bit compare, so compare 32-bit halves and require
+        // both halves of an entry to agree.
+        __m128i hit = _mm_cmpeq_epi32(_mm_and_si128(v, tagMask), tag);
+        hit = _mm_and_si128(hit, _mm_shuffle_epi32(hit, 0xb1));
+        __m128i empty = _mm_cmpeq_epi32(v, zero);
+        empty = _mm_and_si128(empty, _mm_shuffle_epi32(empty, 0xb1));
+
+        // An unused entry looks like a reference whose secondary hash is 0.
+        hit = _mm_andnot_si128(empty, hit);
+        matches |= static_cast<uint32_t>(
+                _mm_movemask_pd(_mm_castsi128_pd(hit))) << i;
+    }
+    return matches;
+}
+
+/**
+ * AVX2 version of HashTable::findMatches(); see that method for
+ * documentation. Handles four entries per vector. This is compiled for
+ * AVX2 regardless of the build flags and is only called after
+ * HashTable::detectProbeMode() has found AVX2 support at runtime.
+ */
+__attribute__((target("avx2")))
+uint32_t
+avx2FindMatches(const uint64_t* entries, uint32_t numEntries,
+                uint64_t secondaryHash)
+{
+    const __m256i tagMask = _mm256_set1_epi64x(
+            static_cast<int64_t>(TAG_MASK));
+    const __m256i tag = _mm256_set1_epi64x(
+            static_cast<int64_t>(secondaryHash << 48));
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t matches = 0;
+
+    for (uint32_t i = 0; i < numEntries; i += 4) {
+        __m256i v = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(&entries[i]));
+        __m256i hit = _mm256_cmpeq_epi64(_mm256_and_si256(v, tagMask), tag);
+        __m256i empty = _mm256_cmpeq_epi64(v, zero);
+        hit = _mm256_andnot_si256(empty, hit);
+        matches |= static_cast<uint32_t>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(hit))) << i;
+    }
+    return matches;
+}
+#endif // __SSE2__
+
+} // anonymous namespace
+
 /**
  * Reinitialize a hash table entry as unused.
  */
@@ -154,7 +237,9 @@ HashTable::Entry::pack(uint64_t hash, bool chain, uint64_t ptr)
 HashTable::Candidates::Candidates()
     : bucket(NULL)
     , index()
+    , matches()
     , secondaryHash()
+    , table(NULL)
 {
 }
 
@@ -164,11 +249,14 @@ HashTable::Candidates::Candidates()
  * given secondaryHash.
  */
 void
-HashTable::Candidates::init(CacheLine* cl, uint64_t secondaryHash)
+HashTable::Candidates::init(HashTable* table, CacheLine* cl,
+                            uint64_t secondaryHash)
 {
     bucket = cl;
     index = -1;
     this->secondaryHash = secondaryHash;
+    this->table = table;
+    matches = findMatches(bucket, secondaryHash, table->probeMode);
     next();
 }
 
@@ -202,8 +290,10 @@ HashTable::Candidates::setReference(uint64_t reference)
 void
 HashTable::Candidates::remove()
 {
-    if (bucket != NULL)
+    if (bucket != NULL) {
         bucket->entries[index].clear();
+        table->numEntries--;
+    }
 }
 
 /**
@@ -212,33 +302,25 @@ HashTable::Candidates::remove()
 void
 HashTable::Candidates::next()
 {
-    while (true) {
-        // Not found in the cache line, see if there's a chain to
-        // another cache line.
-        if (index == ENTRIES_PER_CACHE_LINE && bucket != NULL) {
-            Entry* entry = &bucket->entries[ENTRIES_PER_CACHE_LINE - 1];
-            bucket = entry->getChainPointer();
-            index = -1;
-        }
-
-        if (bucket == NULL)
+    while (bucket != NULL) {
+        if (matches != 0) {
+            // The hash within the hash table entry matches, so with
+            // high probability this is the pointer we're looking
+            // for. We'll report this index to the user of this
+            // class in the next getReference() call so that they
+            // can verify the match.
+            index = BitOps::findFirstSet(matches) - 1;
+            matches &= matches - 1;
             return;
-
-        // Resume in the current cache line.
-        index++;
-        Entry* candidate = &bucket->entries[index];
-        while (index < ENTRIES_PER_CACHE_LINE) {
-            if (candidate->hashMatches(secondaryHash)) {
-                // The hash within the hash table entry matches, so with
-                // high probability this is the pointer we're looking
-                // for. We'll report this index to the user of this
-                // class in the next getReference() call so that they
-                // can verify the match.
-                return;
-            }
-            candidate++;
-            index++;
         }
+
+        // Not found in the cache line, see if there's a chain to
+        // another cache line.
+        Entry* entry = &bucket->entries[ENTRIES_PER_CACHE_LINE - 1];
+        bucket = entry->getChainPointer();
+        index = -1;
+        if (bucket != NULL)
+            matches = findMatches(bucket, secondaryHash, table->probeMode);
     }
 }
 
@@ -263,6 +345,11 @@ HashTable::Candidates::isDone()
 HashTable::HashTable(uint64_t numBuckets)
     : numBuckets(BitOps::powerOfTwoLessOrEqual(numBuckets))
     , buckets(this->numBuckets * sizeof(CacheLine))
+    , newBuckets()
+    , newNumBuckets(0)
+    , numBucketsMigrated(0)
+    , numEntries(0)
+    , probeMode(supportedProbeMode)
 {
     if (numBuckets != this->numBuckets) {
         RAMCLOUD_LOG(DEBUG,
@@ -280,23 +367,10 @@ HashTable::HashTable(uint64_t numBuckets)
  */
 HashTable::~HashTable()
 {
-    uint32_t lastEntryIndex = ENTRIES_PER_CACHE_LINE - 1;
-
-    for (uint64_t i = 0; i < numBuckets; ++i) {
-        CacheLine* currBucket = &buckets.get()[i];
-
-        // Skip the first bucket and break the chain
-        Entry* last = &currBucket->entries[lastEntryIndex];
-        currBucket = last->getChainPointer();
-        last->clear();
-
-        while (currBucket != NULL) {
-            CacheLine *nextBucket
-                        = currBucket->entries[lastEntryIndex].getChainPointer();
-            free(currBucket);
-            currBucket = nextBucket;
-        }
-    }
+    for (uint64_t i = 0; i < numBuckets; ++i)
+        freeOverflowLines(&buckets.get()[i]);
+    for (uint64_t i = 0; i < newNumBuckets; ++i)
+        freeOverflowLines(&newBuckets->get()[i]);
 }
 
 /**
@@ -320,7 +394,7 @@ HashTable::lookup(KeyHash keyHash, Candidates& candidates)
     // caller as it examines possible candidates.
     uint64_t secondaryHash;
     CacheLine *bucket = findBucket(keyHash, &secondaryHash);
-    candidates.init(bucket, secondaryHash);
+    candidates.init(this, bucket, secondaryHash);
 }
 
 /**
@@ -339,37 +413,9 @@ void
 HashTable::insert(KeyHash keyHash, uint64_t reference)
 {
     uint64_t secondaryHash;
-    int overflowBuckets = 0;
     CacheLine* bucket = findBucket(keyHash, &secondaryHash);
-    while (true) {
-        Entry* entry = bucket->entries;
-        for (size_t i = 0; i < ENTRIES_PER_CACHE_LINE; i++) {
-            if (entry->isAvailable()) {
-                entry->setReference(secondaryHash, reference);
-                return;
-            }
-            entry++;
-        }
-
-        // No free space in the current bucket; see if there is an
-        // overflow bucket chained onto this one.
-        ++overflowBuckets;
-        Entry* last = &bucket->entries[ENTRIES_PER_CACHE_LINE - 1];
-        bucket = last->getChainPointer();
-        if (bucket == NULL) {
-            // no empty space found, allocate a new cache line
-            RAMCLOUD_CLOG(NOTICE, "Allocating overflow bucket %d for index %lu",
-                    overflowBuckets,
-                    findBucketIndex(numBuckets, keyHash, &secondaryHash));
-            void *buf = Memory::xmemalign(HERE, sizeof(CacheLine),
-                                          sizeof(CacheLine));
-            bucket = static_cast<CacheLine *>(buf);
-            bucket->entries[0] = *last;
-            for (size_t i = 1; i < ENTRIES_PER_CACHE_LINE; i++)
-                bucket->entries[i].clear();
-            last->setChainPointer(bucket);
-        }
-    }
+    insertInBucket(bucket, secondaryHash, reference);
+    numEntries++;
 }
 
 /**
@@ -380,7 +426,7 @@ HashTable::insert(KeyHash keyHash, uint64_t reference)
  * \param cookie
  *      An opaque parameter to pass to the callback function.
  * \param bucket
- *      An index into the HashTable's buckets.  Must be < #numBuckets.
+ *      An index into the HashTable's buckets.  Must be < #getNumBuckets().
  * \return
  *      The total number of callbacks fired (i.e. the number of elements
  *      in the HashTable).
@@ -390,21 +436,21 @@ HashTable::forEachInBucket(void (*callback)(uint64_t, void *),
                            void *cookie,
                            uint64_t bucket)
 {
+    if (newNumBuckets == 0)
+        return forEachInChain(&buckets.get()[bucket], callback, cookie);
+
+    // During a resize this bucket is spread over every getNumBuckets()'th
+    // bucket of whichever array currently holds it.
+    uint64_t stride = getNumBuckets();
     uint64_t numCalls = 0;
-    CacheLine *cl = &buckets.get()[bucket];
-    while (1) {
-        for (uint32_t j = 0; j < ENTRIES_PER_CACHE_LINE; j++) {
-            Entry *e = &cl->entries[j];
-            if (!e->isAvailable() && e->getChainPointer() == NULL) {
-                callback(e->getReference(), cookie);
-                numCalls++;
-            }
+    if (bucket < numBucketsMigrated) {
+        for (uint64_t i = bucket; i < newNumBuckets; i += stride) {
+            numCalls += forEachInChain(&newBuckets->get()[i],
+                                       callback, cookie);
         }
-
-        Entry *entry = &cl->entries[ENTRIES_PER_CACHE_LINE - 1];
-        cl = entry->getChainPointer();
-        if (cl == NULL)
-            break;
+    } else {
+        for (uint64_t i = bucket; i < numBuckets; i += stride)
+            numCalls += forEachInChain(&buckets.get()[i], callback, cookie);
     }
     return numCalls;
 }
@@ -425,7 +471,7 @@ HashTable::forEach(void (*callback)(uint64_t, void *), void *cookie)
 {
     uint64_t numCalls = 0;
 
-    for (uint64_t i = 0; i < numBuckets; i++)
+    for (uint64_t i = 0; i < getNumBuckets(); i++)
         numCalls += forEachInBucket(callback, cookie, i);
 
     return numCalls;
@@ -433,12 +479,50 @@ HashTable::forEach(void (*callback)(uint64_t, void *), void *cookie)
 
 /**
  * Prefetch the cacheline associated with the given key hash.
+ *
+ * Unlike the other methods, this may be called without serializing with
+ * operations on the key's bucket (ObjectManager prefetches before taking
+ * bucket locks). It therefore does nothing during a resize, when the
+ * bucket may be moving, and at worst prefetches an unrelated line if a
+ * resize finishes concurrently.
  */
 void
 HashTable::prefetchBucket(KeyHash keyHash)
 {
+    if (newNumBuckets != 0)
+        return;
     uint64_t dummy;
-    prefetch(findBucket(keyHash, &dummy));
+    prefetch(&buckets.get()[findBucketIndex(numBuckets, keyHash, &dummy)]);
+}
+
+/**
+ * Prefetch the log entries referenced by the given key hash's bucket whose
+ * secondary hashes match. Like #prefetchBucket(), this is only a hint and
+ * may be called without serializing with operations on the bucket: it
+ * works on a private copy of the bucket's first cache line, so a concurrent
+ * change can at worst cause a stale reference to be prefetched. Overflow
+ * cache lines aren't followed, since they may be freed concurrently, and
+ * nothing is done during a resize.
+ *
+ * Because the old array of buckets is released by #finishResize(), a caller
+ * that doesn't serialize with the resize must make sure that no call which
+ * could have missed the start of the resize is still running when it
+ * finishes (ObjectManager does this with LogProtector epochs).
+ */
+void
+HashTable::prefetchReferences(KeyHash keyHash)
+{
+    if (newNumBuckets != 0)
+        return;
+    uint64_t secondaryHash;
+    CacheLine line = buckets.get()[findBucketIndex(numBuckets, keyHash,
+                                                   &secondaryHash)];
+    for (uint32_t i = 0; i < ENTRIES_PER_CACHE_LINE; i++) {
+        if (line.entries[i].hashMatches(secondaryHash)) {
+            prefetch(reinterpret_cast<const void*>(
+                    line.entries[i].getReference()), 128);
+        }
+    }
 }
 
 /**
@@ -461,14 +545,271 @@ HashTable::entriesPerCacheLine()
 }
 
 /**
- * Returns the number of buckets allocated to the table.
+ * Returns the number of buckets that may be passed to #forEachInBucket().
+ * This is the number of buckets allocated to the table, except during a
+ * resize, when it is the smaller of the old and new sizes.
  */
 uint64_t
 HashTable::getNumBuckets() const
 {
+    if (newNumBuckets != 0)
+        return std::min(numBuckets, newNumBuckets);
     return numBuckets;
 }
 
+/**
+ * Return the number of references currently stored in the table.
+ */
+uint64_t
+HashTable::getNumEntries() const
+{
+    return numEntries;
+}
+
+/**
+ * Return the average number of references stored per primary cache line
+ * entry, i.e. the number of references divided by the number of entries
+ * in the bucket array (not counting overflow cache lines). During a resize
+ * this is computed against the target size.
+ */
+double
+HashTable::getLoadFactor() const
+{
+    uint64_t size = (newNumBuckets != 0) ? newNumBuckets : numBuckets;
+    return static_cast<double>(numEntries) /
+           static_cast<double>(size * ENTRIES_PER_CACHE_LINE);
+}
+
+/**
+ * Begin moving the table into a new array of buckets. After this returns,
+ * the caller must invoke #migrateBucket() for every bucket from 0 up to
+ * #getNumBuckets() - 1, in order, and then #finishResize(). The table may
+ * be used normally in between (lookups, inserts, removals, and
+ * #forEachInBucket() all work), but none of these may run concurrently with
+ * this method or #finishResize(), and none may run concurrently on the
+ * same bucket as #migrateBucket().
+ *
+ * \param newNumBuckets
+ *      The size of the new table. Rounded down to a power of two.
+ * \throw Exception
+ *      A resize is already in progress, or \a newNumBuckets is 0.
+ */
+void
+HashTable::startResize(uint64_t newNumBuckets)
+{
+    if (this->newNumBuckets != 0)
+        throw Exception(HERE, "HashTable resize already in progress");
+    newNumBuckets = BitOps::powerOfTwoLessOrEqual(newNumBuckets);
+    if (newNumBuckets == 0)
+        throw Exception(HERE, "HashTable newNumBuckets == 0?!");
+
+    newBuckets.construct(newNumBuckets * sizeof(CacheLine));
+    numBucketsMigrated = 0;
+    this->newNumBuckets = newNumBuckets;
+    RAMCLOUD_LOG(NOTICE, "Resizing HashTable from %lu to %lu buckets "
+                 "(%lu entries)", numBuckets, newNumBuckets,
+                 numEntries.load());
+}
+
+/**
+ * Move one bucket (as numbered by #getNumBuckets()) from the old array of
+ * buckets into the new one during a resize. See #startResize().
+ *
+ * \param bucket
+ *      The bucket to migrate. Must equal #getNumBucketsMigrated().
+ * \param getKeyHash
+ *      Returns the key hash of each reference in the bucket; needed because
+ *      the table only stores part of it.
+ * \param cookie
+ *      Opaque value passed to \a getKeyHash.
+ */
+void
+HashTable::migrateBucket(uint64_t bucket, KeyHashFunction getKeyHash,
+                         void* cookie)
+{
+    assert(newNumBuckets != 0);
+    assert(bucket == numBucketsMigrated);
+    assert(bucket < getNumBuckets());
+
+    uint64_t stride = getNumBuckets();
+    for (uint64_t i = bucket; i < numBuckets; i += stride) {
+        CacheLine* cl = &buckets.get()[i];
+        while (cl != NULL) {
+            for (uint32_t j = 0; j < ENTRIES_PER_CACHE_LINE; j++) {
+                Entry* e = &cl->entries[j];
+                if (e->isAvailable() || e->getChainPointer() != NULL)
+                    continue;
+                uint64_t reference = e->getReference();
+                uint64_t secondaryHash;
+                uint64_t index = findBucketIndex(newNumBuckets,
+                        getKeyHash(reference, cookie), &secondaryHash);
+                insertInBucket(&newBuckets->get()[index], secondaryHash,
+                               reference);
+            }
+            cl = cl->entries[ENTRIES_PER_CACHE_LINE - 1].getChainPointer();
+        }
+
+        freeOverflowLines(&buckets.get()[i]);
+        memset(&buckets.get()[i], 0, sizeof(CacheLine));
+    }
+
+    numBucketsMigrated = bucket + 1;
+}
+
+/**
+ * Complete a resize once every bucket has been migrated, releasing the old
+ * array of buckets. See #startResize().
+ */
+void
+HashTable::finishResize()
+{
+    assert(newNumBuckets != 0);
+    assert(numBucketsMigrated == getNumBuckets());
+
+    buckets.swap(*newBuckets);
+    numBuckets = newNumBuckets;
+    newBuckets.destroy();
+    newNumBuckets = 0;
+    numBucketsMigrated = 0;
+    RAMCLOUD_LOG(NOTICE, "HashTable resized to %lu buckets", numBuckets);
+}
+
+/**
+ * Return true if #startResize() has been called but #finishResize() has
+ * not.
+ */
+bool
+HashTable::isResizing() const
+{
+    return newNumBuckets != 0;
+}
+
+/**
+ * Return the number of buckets the table is being resized to, or 0 if no
+ * resize is in progress.
+ */
+uint64_t
+HashTable::getResizeTarget() const
+{
+    return newNumBuckets;
+}
+
+/**
+ * Return the number of buckets moved so far by the current resize (0 if
+ * no resize is in progress).
+ */
+uint64_t
+HashTable::getNumBucketsMigrated() const
+{
+    return numBucketsMigrated;
+}
+
+/**
+ * Apply a callback to every reference in a bucket's chain of cache lines.
+ * Helper for #forEachInBucket().
+ *
+ * \param cl
+ *      The first cache line of the chain.
+ * \param callback
+ *      The callback to fire on each reference.
+ * \param cookie
+ *      An opaque parameter to pass to the callback function.
+ * \return
+ *      The number of callbacks fired.
+ */
+uint64_t
+HashTable::forEachInChain(CacheLine* cl, void (*callback)(uint64_t, void *),
+                          void *cookie)
+{
+    uint64_t numCalls = 0;
+    while (1) {
+        for (uint32_t j = 0; j < ENTRIES_PER_CACHE_LINE; j++) {
+            Entry *e = &cl->entries[j];
+            if (!e->isAvailable() && e->getChainPointer() == NULL) {
+                callback(e->getReference(), cookie);
+                numCalls++;
+            }
+        }
+
+        Entry *entry = &cl->entries[ENTRIES_PER_CACHE_LINE - 1];
+        cl = entry->getChainPointer();
+        if (cl == NULL)
+            break;
+    }
+    return numCalls;
+}
+
+/**
+ * Free any overflow cache lines chained onto a bucket and break the chain.
+ * The entries in the bucket's own cache line are left alone.
+ */
+void
+HashTable::freeOverflowLines(CacheLine* bucket)
+{
+    uint32_t lastEntryIndex = ENTRIES_PER_CACHE_LINE - 1;
+
+    // Skip the first bucket and break the chain
+    Entry* last = &bucket->entries[lastEntryIndex];
+    CacheLine* currBucket = last->getChainPointer();
+    if (currBucket == NULL)
+        return;
+    last->clear();
+
+    while (currBucket != NULL) {
+        CacheLine *nextBucket
+                    = currBucket->entries[lastEntryIndex].getChainPointer();
+        free(currBucket);
+        currBucket = nextBucket;
+    }
+}
+
+/**
+ * Store a reference in the first free entry of a bucket, chaining a new
+ * overflow cache line onto the bucket if it is full. Does not update
+ * #numEntries.
+ *
+ * \param bucket
+ *      The bucket to insert into.
+ * \param secondaryHash
+ *      The secondary hash bits (16 bits) of the reference's key.
+ * \param reference
+ *      The reference to insert.
+ */
+void
+HashTable::insertInBucket(CacheLine* bucket, uint64_t secondaryHash,
+                          uint64_t reference)
+{
+    int overflowBuckets = 0;
+    while (true) {
+        Entry* entry = bucket->entries;
+        for (size_t i = 0; i < ENTRIES_PER_CACHE_LINE; i++) {
+            if (entry->isAvailable()) {
+                entry->setReference(secondaryHash, reference);
+                return;
+            }
+            entry++;
+        }
+
+        // No free space in the current bucket; see if there is an
+        // overflow bucket chained onto this one.
+        ++overflowBuckets;
+        Entry* last = &bucket->entries[ENTRIES_PER_CACHE_LINE - 1];
+        bucket = last->getChainPointer();
+        if (bucket == NULL) {
+            // no empty space found, allocate a new cache line
+            RAMCLOUD_CLOG(NOTICE, "Allocating overflow bucket %d",
+                    overflowBuckets);
+            void *buf = Memory::xmemalign(HERE, sizeof(CacheLine),
+                                          sizeof(CacheLine));
+            bucket = static_cast<CacheLine *>(buf);
+            bucket->entries[0] = *last;
+            for (size_t i = 1; i < ENTRIES_PER_CACHE_LINE; i++)
+                bucket->entries[i].clear();
+            last->setChainPointer(bucket);
+        }
+    }
+}
+
 /**
  * Find the bucket index corresponding to a particular key.
  * This also calculates the secondary hash bits used to disambiguate entries
@@ -511,8 +852,123 @@ HashTable::findBucketIndex(uint64_t numBuckets,
 HashTable::CacheLine*
 HashTable::findBucket(KeyHash keyHash, uint64_t *secondaryHash) //const
 {
+    if (newNumBuckets != 0) {
+        uint64_t bucket = findBucketIndex(getNumBuckets(), keyHash,
+                                          secondaryHash);
+        if (bucket < numBucketsMigrated) {
+            return &newBuckets->get()[findBucketIndex(newNumBuckets, keyHash,
+                                                      secondaryHash)];
+        }
+    }
     uint64_t bucketIndex = findBucketIndex(numBuckets, keyHash, secondaryHash);
     return &buckets.get()[bucketIndex];
 }
 
+/**
+ * Return the ProbeMode lookups on this table currently use.
+ */
+HashTable::ProbeMode
+HashTable::getProbeMode() const
+{
+    return probeMode;
+}
+
+/**
+ * Change how lookups on this table compare secondary hashes. This exists
+ * so that benchmarks and tests can compare the different implementations;
+ * normally the table uses #bestProbeMode().
+ *
+ * \param mode
+ *      The ProbeMode to use for subsequent lookups.
+ * \throw Exception
+ *      This machine doesn't support \a mode.
+ */
+void
+HashTable::setProbeMode(ProbeMode mode)
+{
+    if (mode > supportedProbeMode) {
+        throw Exception(HERE, format(
+            "HashTable probe mode %s is not supported on this machine",
+            probeModeName(mode)));
+    }
+    probeMode = mode;
+}
+
+/**
+ * Return the fastest ProbeMode this machine supports. This is the mode
+ * new HashTables use.
+ */
+HashTable::ProbeMode
+HashTable::bestProbeMode()
+{
+    return supportedProbeMode;
+}
+
+/**
+ * Return a human-readable name for a ProbeMode (for use in log messages
+ * and benchmark output).
+ */
+const char*
+HashTable::probeModeName(ProbeMode mode)
+{
+    switch (mode) {
+        case SCALAR_PROBE:  return "scalar";
+        case SSE2_PROBE:    return "sse2";
+        case AVX2_PROBE:    return "avx2";
+    }
+    return "unknown";
+}
+
+/**
+ * Compute which entries in a single cache line are candidates for a key with
+ * the given secondary hash: entries holding a reference (i.e. not unused and
+ * not a chain pointer) whose stored secondary hash equals \a secondaryHash.
+ *
+ * \param cl
+ *      The cache line to scan. Chained cache lines are not examined.
+ * \param secondaryHash
+ *      The secondary hash bits (16 bits) of the key being looked up.
+ * \param probeMode
+ *      Selects the implementation used to do the comparisons. Must be
+ *      supported by this machine.
+ * \return
+ *      A bitmask in which bit i is set if entry i of \a cl is a candidate.
+ */
+uint32_t
+HashTable::findMatches(const CacheLine* cl, uint64_t secondaryHash,
+                       ProbeMode probeMode)
+{
+#if __SSE2__
+    const uint64_t* entries = reinterpret_cast<const uint64_t*>(cl->entries);
+    if (probeMode == AVX2_PROBE)
+        return avx2FindMatches(entries, ENTRIES_PER_CACHE_LINE, secondaryHash);
+    if (probeMode == SSE2_PROBE)
+        return sse2FindMatches(entries, ENTRIES_PER_CACHE_LINE, secondaryHash);
+#endif
+
+    uint32_t matches = 0;
+    for (uint32_t i = 0; i < ENTRIES_PER_CACHE_LINE; i++) {
+        if (cl->entries[i].hashMatches(secondaryHash))
+            matches |= (1u << i);
+    }
+    return matches;
+}
+
+/**
+ * Determine the fastest ProbeMode that this machine supports. This is
+ * invoked once during static initialization to set #supportedProbeMode.
+ */
+HashTable::ProbeMode
+HashTable::detectProbeMode()
+{
+#if __SSE2__
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2_PROBE;
+    return SSE2_PROBE;
+#else
+    return SCALAR_PROBE;
+#endif
+}
+
 } // namespace RAMCloud
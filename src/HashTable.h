@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_HASHTABLE_H
 #define RAMCLOUD_HASHTABLE_H
 
+#include <atomic>
+
 #include "Common.h"
 #include "BitOps.h"
 #include "CycleCounter.h"
@@ -23,6 +25,7 @@
 #include "Memory.h"
 #include "MurmurHash3.h"
 #include "Key.h"
+#include "Tub.h"
 
 namespace RAMCloud {
 
@@ -39,6 +42,12 @@ namespace RAMCloud {
  *
  * This code is not thread-safe.
  *
+ * The table can be resized while it is in use (see #startResize()). A resize
+ * moves the contents of the table into a new array of buckets one bucket at
+ * a time, so a caller that serializes operations on each bucket (such as
+ * ObjectManager with its HashTableBucketLocks) can keep using the table
+ * while the resize proceeds.
+ *
  * \section impl Implementation Details
  *
  * The HashTable is an array of #buckets, indexed by the hash of the two
@@ -52,6 +61,13 @@ namespace RAMCloud {
  * buckets). In this case, the last hash table entry in each of the
  * non-terminal cache lines has a pointer to the next cache line instead of a
  * log reference.
+ *
+ * While a resize is in progress, both the old and new bucket arrays exist.
+ * Buckets are numbered in the smaller of the two arrays (see
+ * #getNumBuckets()); bucket i corresponds to every bucket in either array
+ * whose index is congruent to i modulo that size, and therefore to the
+ * same set of keys in both arrays. Buckets below #numBucketsMigrated live
+ * in the new array and the rest live in the old one.
  */
 class HashTable {
   PRIVATE:
@@ -170,6 +186,24 @@ class HashTable {
                   "HashTable entries don't fit evenly into a cacheline");
 
   public:
+    /**
+     * Selects how the Entries of a CacheLine are compared against the
+     * secondary hash of a key during a lookup. The vector modes compare
+     * every Entry in a cache line with a handful of instructions and produce
+     * a bitmask of the matching slots; the scalar mode checks one Entry at a
+     * time and is used on processors without the needed instructions.
+     */
+    enum ProbeMode {
+        /// Compare one Entry at a time using Entry::hashMatches().
+        SCALAR_PROBE = 0,
+
+        /// Compare two Entries per 128-bit SSE2 operation.
+        SSE2_PROBE,
+
+        /// Compare four Entries per 256-bit AVX2 operation.
+        AVX2_PROBE,
+    };
+
     /**
      * This class is essentially an iterator for potential matches found during
      * a lookup operation. This exists because the HashTable::lookup() method
@@ -200,7 +234,7 @@ class HashTable {
         bool isDone();
 
       PRIVATE:
-        void init(CacheLine* cl, uint64_t secondaryHash);
+        void init(HashTable* table, CacheLine* cl, uint64_t secondaryHash);
 
         /// Pointer to the hash table bucket we're currently iterating over.
         CacheLine* bucket;
@@ -208,15 +242,37 @@ class HashTable {
         /// Index into bucket we're currently iterating over.
         uint32_t index;
 
+        /// Bitmask of the entries in #bucket (bit i corresponds to entry i)
+        /// whose secondary hash matched and that haven't been returned yet.
+        uint32_t matches;
+
         /// This iterator only returns references to entries that share this
         /// secondaryHash. All others cannot possibly be matches. This helps
         /// to reduce the number of candidates whose keys are extracted from
         /// the log and compared.
         uint64_t secondaryHash;
 
+        /// The table that was searched; it determines how cache lines are
+        /// scanned and tracks the number of entries it holds.
+        HashTable* table;
+
         friend class HashTable;
     };
 
+    /**
+     * Used while resizing to recover the full key hash of an element from
+     * its reference, since an Entry only stores 16 bits of it. See
+     * #migrateBucket().
+     *
+     * \param reference
+     *      A reference previously passed to #insert().
+     * \param cookie
+     *      The opaque value passed to #migrateBucket().
+     * \return
+     *      The key hash the reference was inserted with.
+     */
+    typedef KeyHash (*KeyHashFunction)(uint64_t reference, void* cookie);
+
     explicit HashTable(uint64_t numBuckets);
     ~HashTable();
     void lookup(KeyHash keyHash, Candidates& candidates);
@@ -226,12 +282,26 @@ class HashTable {
                              uint64_t bucket);
     uint64_t forEach(void (*callback)(uint64_t, void *), void *cookie);
     void prefetchBucket(KeyHash keyHash);
+    void prefetchReferences(KeyHash keyHash);
     static uint32_t bytesPerCacheLine();
     static uint32_t entriesPerCacheLine();
     uint64_t getNumBuckets() const;
     static uint64_t findBucketIndex(uint64_t numBuckets,
                                     KeyHash keyHash,
                                     uint64_t *secondaryHash);
+    uint64_t getNumEntries() const;
+    double getLoadFactor() const;
+    void startResize(uint64_t newNumBuckets);
+    void migrateBucket(uint64_t bucket, KeyHashFunction getKeyHash,
+                       void* cookie);
+    void finishResize();
+    bool isResizing() const;
+    uint64_t getResizeTarget() const;
+    uint64_t getNumBucketsMigrated() const;
+    ProbeMode getProbeMode() const;
+    void setProbeMode(ProbeMode mode);
+    static ProbeMode bestProbeMode();
+    static const char* probeModeName(ProbeMode mode);
 
   PRIVATE:
 
@@ -240,11 +310,21 @@ class HashTable {
     struct CacheLine;
 
     CacheLine * findBucket(KeyHash keyHash, uint64_t *secondaryHash);
+    static uint64_t forEachInChain(CacheLine* cl,
+                                   void (*callback)(uint64_t, void *),
+                                   void *cookie);
+    static void freeOverflowLines(CacheLine* bucket);
+    static void insertInBucket(CacheLine* bucket, uint64_t secondaryHash,
+                               uint64_t reference);
+    static uint32_t findMatches(const CacheLine* cl, uint64_t secondaryHash,
+                                ProbeMode probeMode);
+    static ProbeMode detectProbeMode();
 
     /**
-     * The number of buckets allocated to the table.
+     * The number of buckets allocated to the table. During a resize, this
+     * is the size of the old array (#buckets).
      */
-    const uint64_t numBuckets;
+    uint64_t numBuckets;
 
     /**
      * The array of buckets.
@@ -252,6 +332,44 @@ class HashTable {
      */
     LargeBlockOfMemory<CacheLine> buckets;
 
+    /**
+     * The array of buckets that the table is being resized into. Only
+     * constructed while a resize is in progress.
+     */
+    Tub<LargeBlockOfMemory<CacheLine>> newBuckets;
+
+    /**
+     * The number of buckets in #newBuckets, or 0 if no resize is in
+     * progress.
+     */
+    uint64_t newNumBuckets;
+
+    /**
+     * During a resize, buckets (as numbered by #getNumBuckets()) below this
+     * value have been moved to #newBuckets. Atomic because operations on
+     * other buckets read it while a bucket is being migrated.
+     */
+    std::atomic<uint64_t> numBucketsMigrated;
+
+    /**
+     * The number of references currently stored in the table. Updated
+     * atomically because callers may operate on different buckets in
+     * parallel.
+     */
+    std::atomic<uint64_t> numEntries;
+
+    /**
+     * How lookups on this table compare secondary hashes. Initialized to
+     * #bestProbeMode() and only changed by benchmarks and tests.
+     */
+    ProbeMode probeMode;
+
+    /**
+     * The fastest ProbeMode supported by this machine. Determined once when
+     * the process starts (see #detectProbeMode()).
+     */
+    static ProbeMode supportedProbeMode;
+
     friend void hashTableBenchmark(uint64_t nkeys, uint64_t nlines);
     DISALLOW_COPY_AND_ASSIGN(HashTable);
 };
@@ -341,6 +341,7 @@ class HashTableTest : public ::testing::Test {
         }
 
         ht->buckets.swap(*cacheLines);
+        ht->numEntries = numEnt;
         dummy.swap(*cacheLines);
         dummyHasOrigCacheLines = true;
     }
@@ -672,6 +673,59 @@ TEST_F(HashTableTest, lookup) {
     EXPECT_EQ(outRef, vRef);
 }
 
+TEST_F(HashTableTest, lookup_allProbeModes) {
+    setup(0, HashTable::ENTRIES_PER_CACHE_LINE * 5);
+    for (int mode = HashTable::SCALAR_PROBE;
+            mode <= HashTable::bestProbeMode(); mode++) {
+        ht.setProbeMode(static_cast<HashTable::ProbeMode>(mode));
+        for (uint64_t i = 0; i < numEnt; i++) {
+            string key = format("%lu", i);
+            Key k(0, key.c_str(), downCast<uint16_t>(key.length()));
+            uint64_t outRef;
+            EXPECT_TRUE(lookup(&ht, k, outRef));
+            EXPECT_EQ(values[i]->u64Address(), outRef);
+        }
+        string key = format("%lu", numEnt + 1);
+        Key k(0, key.c_str(), downCast<uint16_t>(key.length()));
+        uint64_t outRef;
+        EXPECT_FALSE(lookup(&ht, k, outRef));
+    }
+}
+
+TEST_F(HashTableTest, findMatches) {
+    HashTable::CacheLine cl;
+    for (uint32_t i = 0; i < HashTable::ENTRIES_PER_CACHE_LINE; i++)
+        cl.entries[i].clear();
+    cl.entries[0].setReference(0x1234, 0x100);
+    cl.entries[2].setReference(0, 0x200);
+    cl.entries[3].setReference(0x1234, 0x300);
+    cl.entries[5].setReference(0x4321, 0x400);
+    cl.entries[seven].setChainPointer(&cl);
+
+    for (int mode = HashTable::SCALAR_PROBE;
+            mode <= HashTable::bestProbeMode(); mode++) {
+        HashTable::ProbeMode probeMode =
+                static_cast<HashTable::ProbeMode>(mode);
+        EXPECT_EQ(0x9U, HashTable::findMatches(&cl, 0x1234, probeMode));
+        EXPECT_EQ(0x20U, HashTable::findMatches(&cl, 0x4321, probeMode));
+        EXPECT_EQ(0U, HashTable::findMatches(&cl, 0x5555, probeMode));
+
+        // Neither unused entries nor the chain pointer may match a
+        // secondary hash of 0.
+        EXPECT_EQ(0x4U, HashTable::findMatches(&cl, 0, probeMode));
+    }
+}
+
+TEST_F(HashTableTest, setProbeMode) {
+    ht.setProbeMode(HashTable::SCALAR_PROBE);
+    EXPECT_EQ(HashTable::SCALAR_PROBE, ht.getProbeMode());
+    ht.setProbeMode(HashTable::bestProbeMode());
+    EXPECT_EQ(HashTable::bestProbeMode(), ht.getProbeMode());
+    if (HashTable::bestProbeMode() != HashTable::AVX2_PROBE) {
+        EXPECT_THROW(ht.setProbeMode(HashTable::AVX2_PROBE), Exception);
+    }
+}
+
 #if 0
 TEST_F(HashTableTest, remove) {
     HashTable ht(1);
@@ -821,4 +875,139 @@ TEST_F(HashTableTest, forEach) {
         EXPECT_EQ(1U, checkoff[i].count);
 }
 
+/**
+ * KeyHashFunction used by the resize tests: references are TestObjects.
+ */
+static KeyHash
+test_resize_keyHash(uint64_t ref, void *cookie)
+{
+    TestObject* obj = reinterpret_cast<TestObject*>(ref);
+    Key key(obj->tableId, obj->stringKeyPtr, obj->stringKeyLength);
+    return key.getHash();
+}
+
+/**
+ * Resize \a ht to \a newNumBuckets, checking halfway through and at the
+ * end that every object in \a objects can still be found and is visited
+ * exactly once by forEach(). \a objects must all have been inserted.
+ */
+static void
+resizeAndCheck(HashTableTest* test, HashTable* ht, TestObject* objects,
+               uint32_t numObjects, uint64_t newNumBuckets)
+{
+    ht->startResize(newNumBuckets);
+    EXPECT_TRUE(ht->isResizing());
+    uint64_t numBuckets = ht->getNumBuckets();
+    for (uint64_t i = 0; i <= numBuckets; i++) {
+        if (i == numBuckets / 2 || i == numBuckets) {
+            for (uint32_t j = 0; j < numObjects; j++) {
+                Key key(objects[j].tableId, objects[j].stringKeyPtr,
+                        objects[j].stringKeyLength);
+                uint64_t outRef = 0;
+                EXPECT_TRUE(test->lookup(ht, key, outRef));
+                EXPECT_EQ(objects[j].u64Address(), outRef);
+                objects[j].count = 0;
+            }
+            EXPECT_EQ(numObjects, ht->forEach(test_forEach_callback,
+                                             reinterpret_cast<void *>(57)));
+            for (uint32_t j = 0; j < numObjects; j++)
+                EXPECT_EQ(1U, objects[j].count);
+        }
+        if (i < numBuckets)
+            ht->migrateBucket(i, test_resize_keyHash, NULL);
+    }
+    EXPECT_EQ(numBuckets, ht->getNumBucketsMigrated());
+    ht->finishResize();
+    EXPECT_FALSE(ht->isResizing());
+    EXPECT_EQ(newNumBuckets, ht->getNumBuckets());
+    EXPECT_EQ(numObjects, ht->getNumEntries());
+}
+
+TEST_F(HashTableTest, resize_grow) {
+    HashTable ht(2);
+    uint32_t arrayLen = 256;
+    TestObject objects[arrayLen] = {};
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        objects[i].setKey(format("%u", i));
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        replace(&ht, key, objects[i].u64Address());
+    }
+    EXPECT_EQ(arrayLen, ht.getNumEntries());
+    EXPECT_DOUBLE_EQ(16.0, ht.getLoadFactor());
+
+    resizeAndCheck(this, &ht, objects, arrayLen, 64);
+    EXPECT_DOUBLE_EQ(0.5, ht.getLoadFactor());
+
+    // The table must still accept new entries and removals after a resize.
+    TestObject extra(0, "extra");
+    Key extraKey(extra.tableId, extra.stringKeyPtr, extra.stringKeyLength);
+    replace(&ht, extraKey, extra.u64Address());
+    EXPECT_EQ(arrayLen + 1, ht.getNumEntries());
+    HashTable::Candidates candidates;
+    ht.lookup(extraKey.getHash(), candidates);
+    while (candidates.getReference() != extra.u64Address())
+        candidates.next();
+    candidates.remove();
+    EXPECT_EQ(arrayLen, ht.getNumEntries());
+}
+
+TEST_F(HashTableTest, resize_shrink) {
+    HashTable ht(64);
+    uint32_t arrayLen = 256;
+    TestObject objects[arrayLen] = {};
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        objects[i].setKey(format("%u", i));
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        replace(&ht, key, objects[i].u64Address());
+    }
+
+    // Shrinking to a single bucket chains many overflow cache lines.
+    resizeAndCheck(this, &ht, objects, arrayLen, 1);
+    EXPECT_EQ(1U, ht.getNumBuckets());
+}
+
+TEST_F(HashTableTest, resize_insertDuringResize) {
+    HashTable ht(4);
+    uint32_t arrayLen = 64;
+    TestObject objects[arrayLen] = {};
+    for (uint32_t i = 0; i < arrayLen; i++)
+        objects[i].setKey(format("%u", i));
+
+    ht.startResize(16);
+    EXPECT_EQ(4U, ht.getNumBuckets());
+    EXPECT_EQ(16U, ht.getResizeTarget());
+    ht.migrateBucket(0, test_resize_keyHash, NULL);
+    ht.migrateBucket(1, test_resize_keyHash, NULL);
+
+    // Objects go to whichever array currently holds their bucket and must
+    // survive migration of the rest.
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        replace(&ht, key, objects[i].u64Address());
+    }
+    ht.migrateBucket(2, test_resize_keyHash, NULL);
+    ht.migrateBucket(3, test_resize_keyHash, NULL);
+    ht.finishResize();
+
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        uint64_t outRef = 0;
+        EXPECT_TRUE(lookup(&ht, key, outRef));
+        EXPECT_EQ(objects[i].u64Address(), outRef);
+    }
+    EXPECT_EQ(arrayLen, ht.forEach(test_forEach_callback,
+                                   reinterpret_cast<void *>(57)));
+}
+
+TEST_F(HashTableTest, startResize_errors) {
+    HashTable ht(4);
+    EXPECT_THROW(ht.startResize(0), Exception);
+    ht.startResize(8);
+    EXPECT_THROW(ht.startResize(16), Exception);
+}
+
 } // namespace RAMCloud
@@ -84,7 +84,7 @@ InMemoryStorage::Frame::getMetadata()
  * calls from being accepted.
  */
 void
-InMemoryStorage::Frame::startLoading()
+InMemoryStorage::Frame::startLoading(bool streaming)
 {
     Lock lock(storage->mutex);
     loadRequested = true;
@@ -100,6 +100,17 @@ InMemoryStorage::Frame::isLoaded()
     return true;
 }
 
+/**
+ * Return a pointer to the replica data; with InMemoryStorage the whole
+ * replica is always in memory. See BackupStorage::Frame::getLoadedPrefix().
+ */
+const void*
+InMemoryStorage::Frame::getLoadedPrefix(size_t* loadedLength)
+{
+    *loadedLength = buffer ? storage->segmentSize : 0;
+    return buffer.get();
+}
+
 /**
  * Return a pointer to the replica data for recovery.
  * load() never blocks for InMemoryStorage; prevents any further append()
@@ -56,8 +56,9 @@ class InMemoryStorage : public BackupStorage {
         void loadMetadata();
         const void* getMetadata();
 
-        void startLoading();
+        void startLoading(bool streaming = false);
         bool isLoaded();
+        const void* getLoadedPrefix(size_t* loadedLength);
         bool currentlyOpen() {return isOpen;}
         void* load();
         void unload();
@@ -27,6 +27,7 @@ IndexletManager::IndexletManager(Context* context, ObjectManager* objectManager)
     , indexletMap()
     , mutex("IndexletManager")
     , objectManager(objectManager)
+    , leafCompression(false)
 {
 }
 
@@ -104,6 +105,7 @@ IndexletManager::addIndexlet(
             bt = new IndexBtree(backingTableId, objectManager);
         else
             bt = new IndexBtree(backingTableId, objectManager, nextNodeId);
+        bt->setLeafCompression(leafCompression);
 
         indexletMap.insert(std::make_pair(TableAndIndexId{tableId, indexId},
                 Indexlet(firstKey, firstKeyLength, firstNotOwnedKey,
@@ -258,6 +260,47 @@ IndexletManager::getNumIndexlets()
     return indexletMap.size();
 }
 
+/**
+ * Add statistics about the space used by each indexlet on this master
+ * to a ServerStatistics message.
+ *
+ * \param serverStatistics
+ *      One IndexletEntry is appended to this for each indexlet.
+ * \param masterTableMetadata
+ *      Table statistics for this master; used to find the space used by
+ *      each indexlet's backing table.
+ */
+void
+IndexletManager::getStatistics(ProtoBuf::ServerStatistics* serverStatistics,
+        MasterTableMetadata* masterTableMetadata)
+{
+    Lock indexletMapLock(mutex);
+    for (IndexletMap::iterator it = indexletMap.begin();
+            it != indexletMap.end(); it++) {
+        Indexlet* indexlet = &it->second;
+        Lock indexletLock(indexlet->indexletMutex);
+        ProtoBuf::ServerStatistics_IndexletEntry* entry =
+                serverStatistics->add_indexletentry();
+        uint64_t backingTableId = indexlet->bt->getTreeTableId();
+        entry->set_table_id(it->first.tableId);
+        entry->set_index_id(it->first.indexId);
+        entry->set_backing_table_id(backingTableId);
+
+        uint64_t bytes = 0;
+        MasterTableMetadata::Entry* tableEntry =
+                masterTableMetadata->find(backingTableId);
+        if (tableEntry != NULL) {
+            SpinLock::Guard _(tableEntry->stats.lock);
+            bytes = tableEntry->stats.byteCount;
+        }
+        entry->set_backing_table_bytes(bytes);
+
+        const IndexBtree::tree_stats& stats = indexlet->bt->getStats();
+        entry->set_leaf_bytes_per_entry(stats.avgLeafBytesPerEntry());
+        entry->set_prefix_bytes_saved(stats.prefixBytesSaved);
+    }
+}
+
 /**
  * Given a secondary key, check if an indexlet containing it exists.
  * This function is used to determine whether the indexlet is owned by this
@@ -317,6 +360,30 @@ IndexletManager::isGreaterOrEqual(Buffer* nodeObjectValue,
             BtreeEntry{compareKey, compareKeyLength, 0UL});
 }
 
+/**
+ * Rewrite each leaf of an indexlet's tree that has changes logged as deltas
+ * as a single object (see IndexBtree::foldLeafDeltas). This must be done
+ * before migrating part of the indexlet, since only whole nodes are
+ * migrated.
+ *
+ * \param backingTableId
+ *      Id of the backing table of the indexlet's tree. Nothing is done if
+ *      this master has no such indexlet.
+ */
+void
+IndexletManager::foldLeafDeltas(uint64_t backingTableId)
+{
+    Lock indexletMapLock(mutex);
+    for (IndexletMap::iterator it = indexletMap.begin();
+            it != indexletMap.end(); it++) {
+        Indexlet* indexlet = &it->second;
+        if (indexlet->bt->getTreeTableId() != backingTableId)
+            continue;
+        Lock indexletLock(indexlet->indexletMutex);
+        indexlet->bt->foldLeafDeltas();
+    }
+}
+
 /**
  * For the indexlet containing truncateKey, modify metadata such that the
  * firstNotOwnedKey of that indexlet is truncateKey.
@@ -353,6 +420,22 @@ IndexletManager::truncateIndexlet(uint64_t tableId, uint8_t indexId,
     memcpy(indexlet->firstNotOwnedKey, truncateKey, truncateKeyLength);
 }
 
+/**
+ * Select whether the trees of indexlets added from now on write their
+ * leaves prefix-compressed (see IndexBtree::setLeafCompression). Indexlets
+ * that already exist are unaffected.
+ *
+ * \param enabled
+ *      True means new trees compress their leaves; false (the default)
+ *      means they write them uncompressed.
+ */
+void
+IndexletManager::setLeafCompression(bool enabled)
+{
+    Lock indexletMapLock(mutex);
+    leafCompression = enabled;
+}
+
 /**
  * Given a secondary key, find the indexlet that contains it and set its
  * nextNodeId to the given nextNodeId if the given nextNodeId is higher than
@@ -603,6 +686,71 @@ IndexletManager::insertEntry(uint64_t tableId, uint8_t indexId,
     return STATUS_OK;
 }
 
+/**
+ * Insert many index entries for a given index id at once. The entries
+ * that fall in the same indexlet as the first one are sorted and added to
+ * that indexlet's tree with IndexBtree::bulkInsert, which builds new parts
+ * of the tree bottom-up rather than one entry at a time.
+ *
+ * \param tableId
+ *      Id for a particular table.
+ * \param indexId
+ *      Id for a particular secondary index associated with tableId.
+ * \param entries
+ *      Entries to insert, sorted by index key.
+ * \param[out] numInserted
+ *      Set to the number of entries, from the start of \a entries, that
+ *      were inserted. The remaining entries belong to other indexlets.
+ * \return
+ *      Returns STATUS_OK if the insert succeeded.
+ *      Returns STATUS_UNKNOWN_INDEXLET if the server does not own an indexlet
+ *      that could contain the first entry.
+ */
+Status
+IndexletManager::insertEntries(uint64_t tableId, uint8_t indexId,
+        const std::vector<BtreeEntry>& entries, uint32_t* numInserted)
+{
+    *numInserted = 0;
+    if (entries.empty())
+        return STATUS_OK;
+
+    Lock indexletMapLock(mutex);
+    const BtreeEntry& first = entries.front();
+    IndexletMap::iterator it = findIndexlet(tableId, indexId,
+            first.key, first.keyLength, indexletMapLock);
+    if (it == indexletMap.end()) {
+        RAMCLOUD_LOG(DEBUG, "Unknown indexlet: tableId %lu, indexId %u, "
+                            "%lu entries,\nfirst key: %s", tableId, indexId,
+                            entries.size(),
+                            Util::hexDump(first.key, first.keyLength).c_str());
+        return STATUS_UNKNOWN_INDEXLET;
+    }
+    Indexlet* indexlet = &it->second;
+
+    Lock indexletLock(indexlet->indexletMutex);
+    indexletMapLock.unlock();
+
+    size_t count = entries.size();
+    if (indexlet->firstNotOwnedKey != NULL) {
+        for (count = 0; count < entries.size(); count++) {
+            const BtreeEntry& entry = entries[count];
+            if (IndexKey::keyCompare(entry.key, entry.keyLength,
+                    indexlet->firstNotOwnedKey,
+                    indexlet->firstNotOwnedKeyLength) >= 0) {
+                break;
+            }
+        }
+    }
+    RAMCLOUD_LOG(DEBUG, "Inserting %lu entries: tableId %lu, indexId %u",
+                 count, tableId, indexId);
+
+    std::vector<BtreeEntry> owned(entries.begin(), entries.begin() + count);
+    indexlet->bt->bulkInsert(&owned);
+    *numInserted = downCast<uint32_t>(count);
+
+    return STATUS_OK;
+}
+
 /**
  * Handle LOOKUP_INDEX_KEYS request.
  * 
@@ -24,6 +24,7 @@
 #include "SpinLock.h"
 #include "Object.h"
 #include "Indexlet.h"
+#include "MasterTableMetadata.h"
 #include "IndexKey.h"
 #include "ObjectManager.h"
 #include "Service.h"
@@ -135,12 +136,16 @@ class IndexletManager {
     IndexletManager::Indexlet* findIndexlet(uint64_t tableId, uint8_t indexId,
             const void *key, uint16_t keyLength);
     size_t getNumIndexlets();
+    void getStatistics(ProtoBuf::ServerStatistics* serverStatistics,
+            MasterTableMetadata* masterTableMetadata);
     bool hasIndexlet(uint64_t tableId, uint8_t indexId,
             const void *key, uint16_t keyLength);
     bool isGreaterOrEqual(Buffer* nodeObjectValue,
             const void* compareKey, uint16_t compareKeyLength);
     void truncateIndexlet(uint64_t tableId, uint8_t indexId,
             const void* truncateKey, uint16_t truncateKeyLength);
+    void foldLeafDeltas(uint64_t backingTableId);
+    void setLeafCompression(bool enabled);
     void setNextNodeIdIfHigher(uint64_t tableId, uint8_t indexId,
             const void *key, uint16_t keyLength, uint64_t nextNodeId);
 
@@ -149,6 +154,8 @@ class IndexletManager {
     Status insertEntry(uint64_t tableId, uint8_t indexId,
             const void* key, KeyLength keyLength,
             uint64_t pKHash);
+    Status insertEntries(uint64_t tableId, uint8_t indexId,
+            const std::vector<BtreeEntry>& entries, uint32_t* numInserted);
     void lookupIndexKeys(const WireFormat::LookupIndexKeys::Request* reqHdr,
             WireFormat::LookupIndexKeys::Response* respHdr,
             Service::Rpc* rpc);
@@ -217,6 +224,10 @@ class IndexletManager {
     /// Object Manager to handle mapping of index as objects
     ObjectManager* objectManager;
 
+    /// Passed to IndexBtree::setLeafCompression for every tree created by
+    /// addIndexlet. Set from ServerConfig::Master::indexLeafCompression.
+    bool leafCompression;
+
     /////////////////////////// Meta-data related functions //////////////////
 
     IndexletManager::IndexletMap::iterator findIndexlet(
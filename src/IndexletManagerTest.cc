@@ -290,6 +290,35 @@ TEST_F(IndexletManagerTest, deleteIndexlet) {
     TestLog::reset();
 }
 
+TEST_F(IndexletManagerTest, getStatistics) {
+    im->setLeafCompression(true);
+    im->addIndexlet(dataTableId, 1, backingTableId, "a", 1, "k", 1);
+    uint64_t numEntries = IndexBtree::maxLeafDeltas + 2;
+    for (uint64_t i = 1; i <= numEntries; i++) {
+        string key = format("apple%lu", i);
+        EXPECT_EQ(STATUS_OK, im->insertEntry(dataTableId, 1, key.c_str(),
+                downCast<uint16_t>(key.length()), i));
+    }
+
+    ProtoBuf::ServerStatistics stats;
+    im->getStatistics(&stats,
+            &cluster.contexts[0]->getMasterService()->masterTableMetadata);
+    ASSERT_EQ(1, stats.indexletentry_size());
+    const ProtoBuf::ServerStatistics_IndexletEntry& entry =
+            stats.indexletentry(0);
+    EXPECT_EQ(dataTableId, entry.table_id());
+    EXPECT_EQ(1U, entry.index_id());
+    EXPECT_EQ(backingTableId, entry.backing_table_id());
+    EXPECT_LT(0U, entry.backing_table_bytes());
+    EXPECT_LT(0, entry.leaf_bytes_per_entry());
+
+    // The root leaf was logged in full for the first entry, then as deltas
+    // until it had IndexBtree::maxLeafDeltas of them, then in full again.
+    // That time the prefix "apple" was stored once rather than for each
+    // entry.
+    EXPECT_EQ(5 * (numEntries - 1), entry.prefix_bytes_saved());
+}
+
 TEST_F(IndexletManagerTest, hasIndexlet) {
     string key1 = "a";
     string key2 = "c";
@@ -371,6 +400,61 @@ TEST_F(IndexletManagerTest, truncateIndexlet_doesntExist) {
             "to be truncated doesn't exist anymore.", TestLog::get());
 }
 
+TEST_F(IndexletManagerTest, foldLeafDeltas) {
+    string key1 = "a";
+    string key2 = "c";
+
+    im->addIndexlet(dataTableId, 1, backingTableId, key1.c_str(),
+            (uint16_t)key1.length(), key2.c_str(), (uint16_t)key2.length());
+    im->insertEntry(dataTableId, 1, "air", 3, 1U);
+    im->insertEntry(dataTableId, 1, "ant", 3, 2U);
+    IndexBtree* bt = im->findIndexlet(dataTableId, 1, key1.c_str(),
+            (uint16_t)key1.length())->bt;
+    EXPECT_EQ(1U, bt->leafDeltaCounts[ROOT_ID]);
+
+    im->foldLeafDeltas(backingTableId + 1);
+    EXPECT_EQ(1U, bt->leafDeltaCounts[ROOT_ID]);
+    im->foldLeafDeltas(backingTableId);
+    EXPECT_EQ(0U, bt->leafDeltaCounts[ROOT_ID]);
+    EXPECT_EQ(2U, bt->size());
+}
+
+TEST_F(IndexletManagerTest, setLeafCompression) {
+    string key1 = "a";
+    string key2 = "c";
+    string key3 = "f";
+
+    EXPECT_FALSE(im->leafCompression);
+    im->addIndexlet(dataTableId, 1, backingTableId, key1.c_str(),
+            (uint16_t)key1.length(), key2.c_str(), (uint16_t)key2.length());
+    im->setLeafCompression(true);
+    im->addIndexlet(dataTableId, 1, backingTableId, key2.c_str(),
+            (uint16_t)key2.length(), key3.c_str(), (uint16_t)key3.length());
+
+    EXPECT_FALSE(im->findIndexlet(dataTableId, 1, key1.c_str(),
+            (uint16_t)key1.length())->bt->compressLeaves);
+    EXPECT_TRUE(im->findIndexlet(dataTableId, 1, key2.c_str(),
+            (uint16_t)key2.length())->bt->compressLeaves);
+}
+
+TEST_F(IndexletManagerTest, setLeafCompression_fromServerConfig) {
+    ServerConfig config = ServerConfig::forTesting();
+    config.services = {WireFormat::MASTER_SERVICE};
+    config.localLocator = "mock:host=master2";
+    config.master.indexLeafCompression = true;
+    Server* server = cluster.addServer(config);
+    IndexletManager* im2 =
+            &server->context->getMasterService()->indexletManager;
+    EXPECT_TRUE(im2->leafCompression);
+
+    string key1 = "a";
+    string key2 = "c";
+    im2->addIndexlet(dataTableId, 1, backingTableId, key1.c_str(),
+            (uint16_t)key1.length(), key2.c_str(), (uint16_t)key2.length());
+    EXPECT_TRUE(im2->findIndexlet(dataTableId, 1, key1.c_str(),
+            (uint16_t)key1.length())->bt->compressLeaves);
+}
+
 TEST_F(IndexletManagerTest, setNextNodeIdIfHigher) {
     string key1 = "a";
     string key2 = "c";
@@ -592,6 +676,43 @@ TEST_F(IndexletManagerTest, insertEntry_unknownIndexlet) {
     EXPECT_EQ(STATUS_UNKNOWN_INDEXLET, insertStatus);
 }
 
+TEST_F(IndexletManagerTest, insertEntries) {
+    im->addIndexlet(dataTableId, 1, backingTableId, "a", 1, "k", 1);
+    std::vector<BtreeEntry> entries;
+    entries.emplace_back("air", 3, 1);
+    entries.emplace_back("earth", 5, 2);
+    entries.emplace_back("fire", 4, 3);
+    entries.emplace_back("water", 5, 4);
+
+    uint32_t numInserted;
+    EXPECT_EQ(STATUS_OK, im->insertEntries(dataTableId, 1, entries,
+            &numInserted));
+    EXPECT_EQ(3U, numInserted);
+
+    IndexletManager::Indexlet* indexlet = im->findIndexlet(dataTableId, 1,
+            "air", 3);
+    ASSERT_TRUE(indexlet != NULL);
+    EXPECT_EQ(3U, indexlet->bt->size());
+    EXPECT_TRUE(indexlet->bt->exists(entries[2]));
+    EXPECT_FALSE(indexlet->bt->exists(entries[3]));
+
+    entries.clear();
+    EXPECT_EQ(STATUS_OK, im->insertEntries(dataTableId, 1, entries,
+            &numInserted));
+    EXPECT_EQ(0U, numInserted);
+}
+
+TEST_F(IndexletManagerTest, insertEntries_unknownIndexlet) {
+    im->addIndexlet(dataTableId, 1, backingTableId, "a", 1, "k", 1);
+    std::vector<BtreeEntry> entries;
+    entries.emplace_back("water", 5, 1234);
+
+    uint32_t numInserted;
+    EXPECT_EQ(STATUS_UNKNOWN_INDEXLET, im->insertEntries(dataTableId, 1,
+            entries, &numInserted));
+    EXPECT_EQ(0U, numInserted);
+}
+
 TEST_F(IndexletManagerTest, insertIndexEntry_duplicate) {
     im->addIndexlet(dataTableId, 1, backingTableId, "a", 1, "k", 1);
 
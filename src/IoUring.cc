@@ -0,0 +1,412 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+#include "IoUring.h"
+
+namespace RAMCloud {
+
+#ifdef HAVE_IO_URING
+
+namespace {
+/// Load a value which the kernel updates concurrently.
+inline uint32_t
+loadAcquire(const uint32_t* p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+/// Publish a value which the kernel reads concurrently.
+inline void
+storeRelease(uint32_t* p, uint32_t value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+}
+
+/**
+ * Create an io_uring instance and map its queues into this process.
+ *
+ * \param entries
+ *      Maximum number of operations which may be prepared between calls
+ *      to submitAndWait(). The kernel rounds this up to a power of two.
+ * \throw IoUringException
+ *      The kernel doesn't support io_uring or the ring couldn't be set up.
+ */
+IoUring::IoUring(uint32_t entries)
+    : ringFd(-1)
+    , sqEntries(0)
+    , sqRing(MAP_FAILED)
+    , sqRingBytes(0)
+    , cqRing(MAP_FAILED)
+    , cqRingBytes(0)
+    , sqes(NULL)
+    , sqesBytes(0)
+    , sqHead(NULL)
+    , sqTail(NULL)
+    , sqMask(0)
+    , sqArray(NULL)
+    , cqHead(NULL)
+    , cqTail(NULL)
+    , cqMask(0)
+    , cqes(NULL)
+    , prepared(0)
+    , buffersRegistered(false)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+        throw IoUringException(HERE, "io_uring_setup failed", errno);
+    }
+    ringFd = fd;
+    sqEntries = params.sq_entries;
+
+    sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqRingBytes = params.cq_off.cqes +
+                  params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+    }
+
+    sqRing = mmap(NULL, sqRingBytes, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        int e = errno;
+        close(ringFd);
+        throw IoUringException(HERE, "couldn't map io_uring submission queue",
+                               e);
+    }
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(NULL, cqRingBytes, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            int e = errno;
+            munmap(sqRing, sqRingBytes);
+            close(ringFd);
+            throw IoUringException(HERE,
+                    "couldn't map io_uring completion queue", e);
+        }
+    }
+    sqesBytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqesMap = mmap(NULL, sqesBytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqesMap == MAP_FAILED) {
+        int e = errno;
+        if (cqRing != sqRing)
+            munmap(cqRing, cqRingBytes);
+        munmap(sqRing, sqRingBytes);
+        close(ringFd);
+        throw IoUringException(HERE,
+                "couldn't map io_uring submission entries", e);
+    }
+    sqes = static_cast<struct io_uring_sqe*>(sqesMap);
+
+    char* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+/**
+ * Unmap the queues and release the ring (and any buffers registered
+ * with it).
+ */
+IoUring::~IoUring()
+{
+    munmap(sqes, sqesBytes);
+    if (cqRing != sqRing)
+        munmap(cqRing, cqRingBytes);
+    munmap(sqRing, sqRingBytes);
+    close(ringFd);
+}
+
+/**
+ * Return true if RAMCloud was compiled with io_uring support and the
+ * running kernel allows io_uring instances to be created.
+ */
+bool
+IoUring::isSupported()
+{
+    try {
+        IoUring ring(1);
+    } catch (IoUringException& e) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Register buffers with the kernel so that their pages are pinned once
+ * rather than on every operation that uses them. Can only be called once
+ * per ring.
+ *
+ * \param iovecs
+ *      Describes each buffer to register; the index of a buffer in this
+ *      array is the bufferIndex to pass when preparing operations on it.
+ * \param count
+ *      Number of entries in \a iovecs.
+ * \return
+ *      True if the buffers were registered. False if the kernel refused
+ *      (typically because the buffers exceed RLIMIT_MEMLOCK); in that case
+ *      operations must pass UNREGISTERED as their bufferIndex.
+ */
+bool
+IoUring::registerBuffers(const struct iovec* iovecs, uint32_t count)
+{
+    assert(!buffersRegistered);
+    long r = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS,
+                     iovecs, count);
+    buffersRegistered = (r == 0);
+    return buffersRegistered;
+}
+
+/**
+ * Return the next free submission queue entry, cleared.
+ */
+struct io_uring_sqe*
+IoUring::getSqe()
+{
+    uint32_t tail = *sqTail + prepared;
+    if (tail - loadAcquire(sqHead) >= sqEntries) {
+        throw IoUringException(HERE, format(
+                "too many io_uring operations prepared (limit %u)",
+                sqEntries));
+    }
+    uint32_t index = tail & sqMask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    ++prepared;
+    return sqe;
+}
+
+/**
+ * Prepare a read of a file into memory; it will be issued by the next call
+ * to submitAndWait().
+ *
+ * \param fd
+ *      File to read from.
+ * \param buf
+ *      Where to place the data read.
+ * \param length
+ *      Number of bytes to read.
+ * \param offset
+ *      Offset in the file at which to start reading.
+ * \param bufferIndex
+ *      Index of the registered buffer containing all of \a buf, or
+ *      UNREGISTERED.
+ * \param userData
+ *      Returned in the Completion for this operation.
+ * \param link
+ *      If true, the next operation prepared won't start until this one
+ *      completes, and will be cancelled if this one fails or is short.
+ */
+void
+IoUring::prepareRead(int fd, void* buf, uint32_t length, uint64_t offset,
+                     int bufferIndex, uint64_t userData, bool link)
+{
+    struct io_uring_sqe* sqe = getSqe();
+    sqe->opcode = (bufferIndex == UNREGISTERED) ? IORING_OP_READ
+                                                : IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = length;
+    if (bufferIndex != UNREGISTERED)
+        sqe->buf_index = downCast<uint16_t>(bufferIndex);
+    sqe->user_data = userData;
+    if (link)
+        sqe->flags |= IOSQE_IO_LINK;
+}
+
+/**
+ * Prepare a write of memory to a file; it will be issued by the next call
+ * to submitAndWait(). See prepareRead() for parameter details; \a buf holds
+ * the data to write.
+ */
+void
+IoUring::prepareWrite(int fd, const void* buf, uint32_t length,
+                      uint64_t offset, int bufferIndex, uint64_t userData,
+                      bool link)
+{
+    struct io_uring_sqe* sqe = getSqe();
+    sqe->opcode = (bufferIndex == UNREGISTERED) ? IORING_OP_WRITE
+                                                : IORING_OP_WRITE_FIXED;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = length;
+    if (bufferIndex != UNREGISTERED)
+        sqe->buf_index = downCast<uint16_t>(bufferIndex);
+    sqe->user_data = userData;
+    if (link)
+        sqe->flags |= IOSQE_IO_LINK;
+}
+
+/**
+ * Prepare an fdatasync of a file; it will be issued by the next call to
+ * submitAndWait(). Typically the writes that must be durable are prepared
+ * just before with \a link set, so that the sync starts only after they
+ * complete.
+ *
+ * \param fd
+ *      File to sync.
+ * \param userData
+ *      Returned in the Completion for this operation.
+ * \param link
+ *      See prepareRead().
+ */
+void
+IoUring::prepareFsync(int fd, uint64_t userData, bool link)
+{
+    struct io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->user_data = userData;
+    if (link)
+        sqe->flags |= IOSQE_IO_LINK;
+}
+
+/**
+ * Hand all prepared operations to the kernel with a single system call and
+ * block until every one of them has completed.
+ *
+ * \param[out] completions
+ *      Filled in with one entry per prepared operation (see pending()),
+ *      in the order in which they completed.
+ * \throw IoUringException
+ *      The kernel rejected the submission.
+ */
+void
+IoUring::submitAndWait(Completion* completions)
+{
+    uint32_t count = prepared;
+    storeRelease(sqTail, *sqTail + prepared);
+    prepared = 0;
+
+    uint32_t toSubmit = count;
+    uint32_t completed = 0;
+    while (completed < count) {
+        uint32_t head = *cqHead;
+        uint32_t tail = loadAcquire(cqTail);
+        while (head != tail && completed < count) {
+            struct io_uring_cqe* cqe = &cqes[head & cqMask];
+            completions[completed].userData = cqe->user_data;
+            completions[completed].result = cqe->res;
+            ++completed;
+            ++head;
+        }
+        storeRelease(cqHead, head);
+        if (completed == count)
+            break;
+
+        long r = syscall(__NR_io_uring_enter, ringFd, toSubmit,
+                         count - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            throw IoUringException(HERE, "io_uring_enter failed", errno);
+        }
+        toSubmit -= std::min(toSubmit, static_cast<uint32_t>(r));
+    }
+}
+
+#else // HAVE_IO_URING
+
+IoUring::IoUring(uint32_t entries)
+    : ringFd(-1)
+    , sqEntries(0)
+    , sqRing(NULL)
+    , sqRingBytes(0)
+    , cqRing(NULL)
+    , cqRingBytes(0)
+    , sqes(NULL)
+    , sqesBytes(0)
+    , sqHead(NULL)
+    , sqTail(NULL)
+    , sqMask(0)
+    , sqArray(NULL)
+    , cqHead(NULL)
+    , cqTail(NULL)
+    , cqMask(0)
+    , cqes(NULL)
+    , prepared(0)
+    , buffersRegistered(false)
+{
+    throw IoUringException(HERE, "RAMCloud was compiled without io_uring "
+            "support");
+}
+
+IoUring::~IoUring()
+{
+}
+
+bool
+IoUring::isSupported()
+{
+    return false;
+}
+
+bool
+IoUring::registerBuffers(const struct iovec* iovecs, uint32_t count)
+{
+    return false;
+}
+
+void
+IoUring::prepareRead(int fd, void* buf, uint32_t length, uint64_t offset,
+                     int bufferIndex, uint64_t userData, bool link)
+{
+}
+
+void
+IoUring::prepareWrite(int fd, const void* buf, uint32_t length,
+                      uint64_t offset, int bufferIndex, uint64_t userData,
+                      bool link)
+{
+}
+
+void
+IoUring::prepareFsync(int fd, uint64_t userData, bool link)
+{
+}
+
+void
+IoUring::submitAndWait(Completion* completions)
+{
+}
+
+#endif // HAVE_IO_URING
+
+} // namespace RAMCloud
@@ -0,0 +1,135 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_IOURING_H
+#define RAMCLOUD_IOURING_H
+
+#include <sys/uio.h>
+
+#include "Common.h"
+#include "Exception.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace RAMCloud {
+
+/**
+ * Thrown if a Linux io_uring instance cannot be created or used.
+ */
+struct IoUringException : public Exception {
+    IoUringException(const CodeLocation& where, std::string msg)
+        : Exception(where, msg) {}
+    IoUringException(const CodeLocation& where, std::string msg, int errNo)
+        : Exception(where, msg, errNo) {}
+};
+
+/**
+ * A thin wrapper around a Linux io_uring submission/completion queue pair,
+ * driven directly through the io_uring_setup/io_uring_enter/io_uring_register
+ * system calls (RAMCloud doesn't depend on liburing). It lets a caller
+ * prepare a batch of file reads, writes, and fsyncs, hand the whole batch to
+ * the kernel with a single system call, and then wait for all of the
+ * results.
+ *
+ * Buffers registered with registerBuffers() are pinned by the kernel once,
+ * rather than on every operation; operations on them should pass the
+ * index of the registered buffer.
+ *
+ * This class is not thread-safe: callers must ensure that only one thread
+ * uses an instance at a time.
+ */
+class IoUring {
+  PUBLIC:
+    /**
+     * Describes the outcome of a single operation; see submitAndWait().
+     */
+    struct Completion {
+        /// The value passed as userData when the operation was prepared.
+        uint64_t userData;
+
+        /// Result of the operation: number of bytes transferred for reads
+        /// and writes, 0 for fsync, or a negated errno value on failure.
+        /// Operations skipped because an earlier operation in their link
+        /// chain failed complete with -ECANCELED.
+        int32_t result;
+    };
+
+    /// Passed as bufferIndex for buffers that weren't registered.
+    static const int UNREGISTERED = -1;
+
+    explicit IoUring(uint32_t entries);
+    ~IoUring();
+    static bool isSupported();
+    bool registerBuffers(const struct iovec* iovecs, uint32_t count);
+    void prepareRead(int fd, void* buf, uint32_t length, uint64_t offset,
+                     int bufferIndex, uint64_t userData, bool link = false);
+    void prepareWrite(int fd, const void* buf, uint32_t length,
+                      uint64_t offset, int bufferIndex, uint64_t userData,
+                      bool link = false);
+    void prepareFsync(int fd, uint64_t userData, bool link = false);
+    void submitAndWait(Completion* completions);
+
+    /// Return the number of operations prepared but not yet submitted.
+    uint32_t pending() const { return prepared; }
+
+    /// Return true if registerBuffers() succeeded on this ring.
+    bool hasRegisteredBuffers() const { return buffersRegistered; }
+
+  PRIVATE:
+    struct io_uring_sqe* getSqe();
+
+    /// File descriptor returned by io_uring_setup().
+    int ringFd;
+
+    /// Number of entries in the submission queue.
+    uint32_t sqEntries;
+
+    /// Start and length of the mmapped submission queue ring (which
+    /// may also hold the completion queue ring; see #cqRing).
+    void* sqRing;
+    size_t sqRingBytes;
+
+    /// Start and length of the mmapped completion queue ring. Equal
+    /// to #sqRing when the kernel maps both rings together.
+    void* cqRing;
+    size_t cqRingBytes;
+
+    /// Start and length of the mmapped array of submission queue entries.
+    struct io_uring_sqe* sqes;
+    size_t sqesBytes;
+
+    /// Pointers into the mmapped rings which are shared with the kernel.
+    uint32_t* sqHead;
+    uint32_t* sqTail;
+    uint32_t sqMask;
+    uint32_t* sqArray;
+    uint32_t* cqHead;
+    uint32_t* cqTail;
+    uint32_t cqMask;
+    struct io_uring_cqe* cqes;
+
+    /// Number of operations prepared since the last submitAndWait().
+    uint32_t prepared;
+
+    /// Whether registerBuffers() succeeded.
+    bool buffersRegistered;
+
+    DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_IOURING_H
@@ -0,0 +1,110 @@
+/* Copyright (c) 2017 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fcntl.h>
+
+#include "TestUtil.h"
+#include "IoUring.h"
+#include "Memory.h"
+
+namespace RAMCloud {
+
+class IoUringTest : public ::testing::Test {
+  public:
+    const char* filePath;
+    int fd;
+    Memory::unique_ptr_free buffer;
+
+    IoUringTest()
+        : filePath("/tmp/ramcloud-io-uring-test-delete-this")
+        , fd(open(filePath, O_CREAT | O_RDWR | O_TRUNC, 0666))
+        , buffer(Memory::xmemalign(HERE, getpagesize(), 8192), std::free)
+    {
+        memset(buffer.get(), 'a', 8192);
+    }
+
+    ~IoUringTest()
+    {
+        close(fd);
+        unlink(filePath);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(IoUringTest);
+};
+
+TEST_F(IoUringTest, writeThenRead) {
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring(4);
+    struct iovec iov = {buffer.get(), 8192};
+    bool registered = ring.registerBuffers(&iov, 1);
+    int index = registered ? 0 : IoUring::UNREGISTERED;
+    char* buf = static_cast<char*>(buffer.get());
+
+    ring.prepareWrite(fd, buf, 4096, 0, index, 1, true);
+    ring.prepareWrite(fd, buf, 512, 4096, IoUring::UNREGISTERED, 2, true);
+    ring.prepareFsync(fd, 3);
+    EXPECT_EQ(3u, ring.pending());
+    IoUring::Completion completions[3];
+    ring.submitAndWait(completions);
+    EXPECT_EQ(0u, ring.pending());
+    // Linked operations complete in order.
+    EXPECT_EQ(1u, completions[0].userData);
+    EXPECT_EQ(4096, completions[0].result);
+    EXPECT_EQ(2u, completions[1].userData);
+    EXPECT_EQ(512, completions[1].result);
+    EXPECT_EQ(3u, completions[2].userData);
+    EXPECT_EQ(0, completions[2].result);
+
+    memset(buf, 0, 8192);
+    ring.prepareRead(fd, buf, 8192, 0, index, 4);
+    ring.submitAndWait(completions);
+    EXPECT_EQ(4u, completions[0].userData);
+    EXPECT_EQ(4608, completions[0].result);
+    EXPECT_EQ('a', buf[4607]);
+    EXPECT_EQ('\0', buf[4608]);
+}
+
+TEST_F(IoUringTest, submitAndWait_linkedFailure) {
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring(4);
+    ring.prepareWrite(-1, buffer.get(), 512, 0, IoUring::UNREGISTERED, 1,
+                      true);
+    ring.prepareFsync(fd, 2);
+    IoUring::Completion completions[2];
+    ring.submitAndWait(completions);
+    for (int i = 0; i < 2; i++) {
+        if (completions[i].userData == 1)
+            EXPECT_EQ(-EBADF, completions[i].result);
+        else
+            EXPECT_EQ(-ECANCELED, completions[i].result);
+    }
+}
+
+TEST_F(IoUringTest, getSqe_full) {
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring(2);
+    ring.prepareFsync(fd, 1);
+    ring.prepareFsync(fd, 2);
+    EXPECT_THROW(ring.prepareFsync(fd, 3), IoUringException);
+    IoUring::Completion completions[2];
+    ring.submitAndWait(completions);
+    ring.prepareFsync(fd, 3);
+    EXPECT_EQ(1u, ring.pending());
+}
+
+} // namespace RAMCloud
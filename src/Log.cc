@@ -16,11 +16,13 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include "Cycles.h"
 #include "Log.h"
 #include "LogCleaner.h"
 #include "PerfStats.h"
 #include "ServerConfig.h"
 #include "ShortMacros.h"
+#include "WorkerManager.h"
 
 namespace RAMCloud {
 
@@ -67,8 +69,12 @@ Log::Log(Context* context,
       context(context),
       cleaner(NULL),
       syncLock("Log::syncLock"),
+      groupCommitWindowCycles(0),
+      syncRequests(0),
+      syncRequestsAtLastBatch(0),
       metrics()
 {
+    setGroupCommitWindow(config->master.groupCommitMicros);
     cleaner = new LogCleaner(context,
                              config,
                              *segmentManager,
@@ -115,6 +121,9 @@ Log::getMetrics(ProtoBuf::LogMetrics& m)
     AbstractLog::getMetrics(m);
     m.set_total_sync_calls(metrics.totalSyncCalls);
     m.set_total_sync_ticks(metrics.totalSyncTicks);
+    // Not taken under syncLock, which may be held across a replication
+    // round trip; the histogram may be slightly stale.
+    metrics.syncBatchHistogram.serialize(*m.mutable_sync_batch_histogram());
     cleaner->getMetrics(*m.mutable_cleaner_metrics());
 }
 
@@ -187,16 +196,25 @@ Log::sync()
     // log while we wait. Once we grab the sync lock, take the append lock again
     // to ensure our new view of the head is consistent.
     lock.destroy();
+    if (appendedLength > originalHead->syncedLength)
+        syncRequests++;
     SpinLock::Guard _(syncLock);
     lock.construct(appendLock);
 
     // See if we still have work to do. It's possible that another thread
     // already did the syncing we needed for us.
     if (appendedLength > originalHead->syncedLength) {
+        if (groupCommitWindowCycles.load(std::memory_order_relaxed) != 0) {
+            lock.destroy();
+            waitForGroupCommit();
+            lock.construct(appendLock);
+        }
+
         // Get the latest segment length and certificate. This allows us to
         // batch up other appends that came in while we were waiting.
         SegmentCertificate certificate;
         appendedLength = originalHead->getAppendedLength(&certificate);
+        recordSyncBatch();
 
         // Drop the append lock. We don't want to block other appending threads
         // while we sync.
@@ -239,11 +257,19 @@ Log::syncTo(Log::Reference reference)
     segment->getEntry(offset, NULL, &lengthWithMetadata);
     uint32_t desiredSyncedLength = offset + lengthWithMetadata;
 
+    if (!WorkerManager::runningInline &&
+            desiredSyncedLength > segment->syncedLength) {
+        syncRequests++;
+    }
     SpinLock::Guard _(syncLock);
 
     // See if we still have work to do. It's possible that another thread
     // already did the syncing we needed for us.
     if (desiredSyncedLength > segment->syncedLength) {
+        if (WorkerManager::runningInline)
+            throw LogSyncDisallowedException(HERE);
+        if (groupCommitWindowCycles.load(std::memory_order_relaxed) != 0)
+            waitForGroupCommit();
         Tub<SpinLock::Guard> lock;
         lock.construct(appendLock);
 
@@ -254,6 +280,7 @@ Log::syncTo(Log::Reference reference)
         // is queued already. Forcing sync of head segment will also make sure
         // that the closed segment is fully replicated.
         uint32_t appendedLength = head->getAppendedLength(&certificate);
+        recordSyncBatch();
 
         // Drop the append lock. We don't want to block other appending
         // threads while we sync.
@@ -267,6 +294,22 @@ Log::syncTo(Log::Reference reference)
     TEST_LOG("sync not needed: entry is already replicated");
 }
 
+/**
+ * Set the group commit window: how long a thread that is about to replicate
+ * the log head waits first, so that durable writes from other threads can
+ * join the same backup write. A longer window means fewer, larger backup
+ * writes (and higher throughput under concurrent load) at the cost of extra
+ * latency for each sync. This may be changed while the log is in use.
+ *
+ * \param microseconds
+ *      Length of the window; 0 means replicate as soon as possible.
+ */
+void
+Log::setGroupCommitWindow(uint32_t microseconds)
+{
+    groupCommitWindowCycles = Cycles::fromMicroseconds(microseconds);
+}
+
 /**
  * Force the log to roll over to a new head and return the new log position.
  * At the instant of the new head segment's creation, it will have the highest
@@ -329,4 +372,36 @@ Log::allocNextSegment(bool mustNotFail)
         return segmentManager->allocHeadSegment();
 }
 
+/**
+ * Called by a thread about to replicate the log head (with syncLock held but
+ * not the appendLock) to wait out the group commit window. Other threads keep
+ * appending meanwhile and then queue on syncLock; their appends are included
+ * in the replication that follows, and they find nothing left to do once
+ * they get the lock.
+ */
+void
+Log::waitForGroupCommit()
+{
+    uint64_t deadline = Cycles::rdtsc() +
+            groupCommitWindowCycles.load(std::memory_order_relaxed);
+    while (Cycles::rdtsc() < deadline) {
+        // Spin; the window is expected to be a few microseconds.
+    }
+}
+
+/**
+ * Record the number of sync requests that will be covered by the replication
+ * about to be performed. Must be called with syncLock held.
+ */
+void
+Log::recordSyncBatch()
+{
+    uint64_t requests = syncRequests.load();
+    uint64_t batch = requests - syncRequestsAtLastBatch;
+    syncRequestsAtLastBatch = requests;
+    metrics.syncBatchHistogram.storeSample(batch);
+    PerfStats::threadStats.logSyncBatches++;
+    PerfStats::threadStats.logSyncBatchedRequests += batch;
+}
+
 } // namespace
@@ -17,11 +17,13 @@
 #define RAMCLOUD_LOG_H
 
 #include <stdint.h>
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 
 #include "AbstractLog.h"
 #include "BoostIntrusive.h"
+#include "Exception.h"
 #include "LogEntryTypes.h"
 #include "LogEntryHandlers.h"
 #include "Segment.h"
@@ -30,6 +32,7 @@
 #include "SpinLock.h"
 #include "ReplicaManager.h"
 #include "HashTable.h"
+#include "Histogram.h"
 
 #include "LogMetrics.pb.h"
 
@@ -39,6 +42,15 @@ namespace RAMCloud {
 class LogCleaner;
 class ServerConfig;
 
+/**
+ * Thrown by Log::syncTo() when the calling thread may not wait for
+ * replication; see WorkerManager::runningInline.
+ */
+struct LogSyncDisallowedException : public Exception {
+    explicit LogSyncDisallowedException(const CodeLocation& where)
+        : Exception(where) {}
+};
+
 /**
  * The log provides a replicated store for immutable and relocatable data in
  * a master server's memory. Data is stored by appending typed "entries" to the
@@ -66,7 +78,9 @@ class ServerConfig;
  * This class is thread-safe. Multiple threads may invoke append() in parallel,
  * but all appends are serialized by a single SpinLock. The sync() method will
  * batch multiple append operations to backups to improve throughput, especially
- * when individual entries are small.
+ * when individual entries are small. If a group commit window is set (see
+ * setGroupCommitWindow()), a thread about to replicate first waits for that
+ * long so that more concurrent appends can join the same backup write.
  */
 class Log : public AbstractLog {
   public:
@@ -81,12 +95,15 @@ class Log : public AbstractLog {
     void disableCleaner();
     LogPosition getHead();
     void getMetrics(ProtoBuf::LogMetrics& m);
+    void setGroupCommitWindow(uint32_t microseconds);
     void sync();
     void syncTo(Log::Reference reference);
     LogPosition rollHeadOver();
 
   PRIVATE:
     LogSegment* allocNextSegment(bool mustNotFail);
+    void waitForGroupCommit();
+    void recordSyncBatch();
 
     INTRUSIVE_LIST_TYPEDEF(LogSegment, listEntries) SegmentList;
 
@@ -109,6 +126,24 @@ class Log : public AbstractLog {
     /// this one must be acquired first to avoid deadlock.
     SpinLock syncLock;
 
+    /// How long (in cycles) a thread that is about to replicate the log waits
+    /// first, so that appends from other threads arriving in the meantime
+    /// are sent to backups in the same write (group commit). 0 means
+    /// replicate immediately; appends made while a previous sync was in
+    /// flight are still batched together.
+    std::atomic<uint64_t> groupCommitWindowCycles;
+
+    /// Number of calls to sync() or syncTo() that found, before queuing on
+    /// #syncLock, that their data was not yet known to be replicated. Each
+    /// of these either leads a replication or waits for one that covers
+    /// it; calls with nothing to sync aren't counted, so they don't
+    /// inflate the batch sizes recorded by recordSyncBatch().
+    std::atomic<uint64_t> syncRequests;
+
+    /// Value of #syncRequests when the log was last replicated; used to
+    /// compute the size of each batch. Protected by #syncLock.
+    uint64_t syncRequestsAtLastBatch;
+
     /// Various event counters and performance measurements taken during log
     /// operation.
     class Metrics {
@@ -116,6 +151,7 @@ class Log : public AbstractLog {
         Metrics()
             : totalSyncCalls(0)
             , totalSyncTicks(0)
+            , syncBatchHistogram(101, 1)
         {
         }
 
@@ -124,6 +160,11 @@ class Log : public AbstractLog {
 
         /// Total number of cpu cycles spent syncing appended log entries.
         uint64_t totalSyncTicks;
+
+        /// Distribution of the number of sync requests (roughly, durable
+        /// writes) covered by each replication of the log head. Protected
+        /// by Log::syncLock.
+        Histogram syncBatchHistogram;
     } metrics;
 
     friend class LogIterator;
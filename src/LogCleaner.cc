@@ -61,6 +61,9 @@ LogCleaner::LogCleaner(Context* context,
       writeCostThreshold(config->master.cleanerWriteCostThreshold),
       disableInMemoryCleaning(config->master.disableInMemoryCleaning),
       numThreads(config->master.cleanerThreadCount),
+      numAgeClasses(std::min(std::max(config->master.cleanerAgeClasses, 1U),
+                             static_cast<uint32_t>(MAX_AGE_CLASSES))),
+      averageSurvivorAge(0),
       segletSize(config->segletSize),
       segmentSize(config->segmentSize),
       activeThreads(0),
@@ -71,13 +74,21 @@ LogCleaner::LogCleaner(Context* context,
       doWorkSleepTicks(0),
       inMemoryMetrics(),
       onDiskMetrics(),
+      onDiskHistogramLock("LogCleaner::onDiskHistogramLock"),
       threadMetrics(numThreads),
       threadsShouldExit(false),
       threads(),
       balancer(NULL)
 {
+    if (config->master.cleanerAgeClasses > MAX_AGE_CLASSES) {
+        LOG(WARNING, "%u cleaner age classes requested; using %u",
+            config->master.cleanerAgeClasses, numAgeClasses);
+    }
+
+    uint32_t reservePerThread = SURVIVOR_SEGMENTS_TO_RESERVE +
+                                numAgeClasses - 1;
     if (!segmentManager.initializeSurvivorReserve(numThreads *
-                                                  SURVIVOR_SEGMENTS_TO_RESERVE))
+                                                  reservePerThread))
         throw FatalError(HERE, "Could not reserve survivor segments");
 
     // This can probably be gotten rid of.
@@ -131,8 +142,10 @@ void
 LogCleaner::start()
 {
     for (int i = 0; i < numThreads; i++) {
-        if (threads[i] == NULL)
-            threads[i] = new std::thread(cleanerThreadEntry, this, context);
+        if (threads[i] == NULL) {
+            threads[i] = new std::thread(cleanerThreadEntry, this, context,
+                                         downCast<uint32_t>(i));
+        }
     }
 }
 
@@ -158,8 +171,6 @@ LogCleaner::stop()
     }
 
     threadsShouldExit = false;
-
-    /// XXX- should set threadCnt to 0 so we can clean on disk again!
 }
 
 /**
@@ -178,7 +189,10 @@ LogCleaner::getMetrics(ProtoBuf::LogMetrics_CleanerMetrics& m)
     m.set_do_work_ticks(doWorkTicks);
     m.set_do_work_sleep_ticks(doWorkSleepTicks);
     inMemoryMetrics.serialize(*m.mutable_in_memory_metrics());
-    onDiskMetrics.serialize(*m.mutable_on_disk_metrics());
+    {
+        SpinLock::Guard guard(onDiskHistogramLock);
+        onDiskMetrics.serialize(*m.mutable_on_disk_metrics());
+    }
     threadMetrics.serialize(*m.mutable_thread_metrics());
 }
 
@@ -186,21 +200,29 @@ LogCleaner::getMetrics(ProtoBuf::LogMetrics_CleanerMetrics& m)
  * PRIVATE METHODS
  ******************************************************************************/
 
-static volatile uint32_t threadCnt;
-
 /**
  * Static entry point for the cleaner thread. This is invoked via the
  * std::thread() constructor. This thread performs continuous cleaning on an
  * as-needed basis.
+ *
+ * \param logCleaner
+ *      The cleaner this thread works for.
+ * \param context
+ *      Overall information about the RAMCloud server.
+ * \param threadNumber
+ *      Index of this thread among the cleaner's threads. Thread 0 is the
+ *      first to be put to work; higher-numbered threads join in only as
+ *      memory gets tighter (see Balancer::isMemoryLow()).
  */
 void
-LogCleaner::cleanerThreadEntry(LogCleaner* logCleaner, Context* context)
+LogCleaner::cleanerThreadEntry(LogCleaner* logCleaner, Context* context,
+                               uint32_t threadNumber)
 {
     LOG(NOTICE, "LogCleaner thread started");
     PerfStats::registerStats(&PerfStats::threadStats);
 
     CleanerThreadState state;
-    state.threadNumber = __sync_fetch_and_add(&threadCnt, 1);
+    state.threadNumber = threadNumber;
     try {
         while (1) {
             Fence::lfence();
@@ -255,7 +277,9 @@ LogCleaner::doWork(CleanerThreadState* state)
         case Balancer::CLEAN_DISK:
           {
             CycleCounter<uint64_t> __(&state->diskCleaningTicks);
+            threadMetrics.noteDiskCleaningStart();
             doDiskCleaning();
+            threadMetrics.noteDiskCleaningStop();
             break;
           }
 
@@ -413,6 +437,12 @@ LogCleaner::doMemoryCleaning()
  * Perform a disk cleaning pass if possible. Doing so involves choosing segments
  * to clean, extracting entries from those segments, writing them out into new
  * "survivor" segments, and alerting the segment manager upon completion.
+ *
+ * Several cleaner threads may run this concurrently. Each pass removes the
+ * segments it chose from the CleanableSegmentManager, so concurrent passes
+ * work on disjoint partitions of the candidates, allocate their own survivors
+ * from the cleaner's reserve, and commit through
+ * SegmentManager::cleaningComplete() independently of one another.
  */
 void
 LogCleaner::doDiskCleaning()
@@ -453,8 +483,10 @@ LogCleaner::doDiskCleaning()
     // counters and merge them into our global metrics afterwards to avoid
     // cache line ping-ponging in the hot path.
     LogSegmentVector survivors;
+    uint32_t ageClasses = getAgeClassesForPass(segmentsToClean.size(),
+                                               maxLiveBytes);
     uint64_t entryBytesAppended = relocateLiveEntries(entries, survivors,
-            &localMetrics);
+            &localMetrics, ageClasses);
 
     uint32_t segmentsAfter = downCast<uint32_t>(survivors.size());
     uint32_t segletsAfter = 0;
@@ -590,6 +622,7 @@ LogCleaner::getSortedEntries(LogSegmentVector& segmentsToClean,
         localMetrics->totalMemoryBytesInCleanedSegments +=
             segment->getSegletsAllocated() * segletSize;
         localMetrics->totalDiskBytesInCleanedSegments += segmentSize;
+        SpinLock::Guard guard(onDiskHistogramLock);
         onDiskMetrics.cleanedSegmentMemoryHistogram.storeSample(
             segment->getMemoryUtilization());
         onDiskMetrics.cleanedSegmentDiskHistogram.storeSample(
@@ -600,11 +633,111 @@ LogCleaner::getSortedEntries(LogSegmentVector& segmentsToClean,
         outEntries.size(), segmentsToClean.size());
 }
 
+/**
+ * Decide how many age classes a disk cleaning pass may segregate its survivors
+ * into. Every class boundary can leave a partially-filled survivor behind, and
+ * a pass must never produce more survivors than the segments it cleans, so
+ * passes over nearly-full segments fall back to fewer classes (or to a single
+ * survivor stream).
+ *
+ * \param segmentsCleaned
+ *      Number of segments being cleaned in this pass.
+ * \param liveBytes
+ *      Upper bound on the number of bytes that will be relocated.
+ * \return
+ *      The number of age classes to use, between 1 and #numAgeClasses.
+ */
+uint32_t
+LogCleaner::getAgeClassesForPass(size_t segmentsCleaned, uint64_t liveBytes)
+{
+    if (numAgeClasses == 1)
+        return 1;
+
+    // Keep one segment of slack for fragmentation at the ends of survivors,
+    // just as with a single survivor stream.
+    uint64_t minimumSurvivors = (liveBytes + segmentSize - 1) / segmentSize;
+    if (segmentsCleaned <= minimumSurvivors + 1)
+        return 1;
+
+    uint64_t spareSurvivors = segmentsCleaned - minimumSurvivors - 1;
+    return downCast<uint32_t>(std::min<uint64_t>(numAgeClasses,
+                                                 spareSurvivors + 1));
+}
+
+/**
+ * Map the age of an entry to its age class. Class 0 holds the youngest
+ * entries; class boundaries double from one class to the next and are centred
+ * on the average age of recently cleaned data, so with two classes an entry
+ * older than the average is class 1, with four classes the boundaries are at
+ * half, one and two times the average.
+ *
+ * \param age
+ *      Age of the entry in seconds.
+ * \param averageAge
+ *      Average age of recently cleaned entries in seconds (see
+ *      #averageSurvivorAge).
+ * \param ageClasses
+ *      Number of age classes in use.
+ * \return
+ *      The entry's age class, in the range [0, ageClasses).
+ */
+uint32_t
+LogCleaner::getAgeClass(uint32_t age, uint32_t averageAge, uint32_t ageClasses)
+{
+    uint64_t boundary = std::max(averageAge >> ((ageClasses - 1) / 2), 1U);
+    uint32_t ageClass = 0;
+    while (ageClass < ageClasses - 1 && age >= boundary) {
+        ageClass++;
+        boundary <<= 1;
+    }
+    return ageClass;
+}
+
+/**
+ * Fold the ages of the entries examined by a disk cleaning pass into
+ * #averageSurvivorAge and return the new average.
+ *
+ * \param entries
+ *      The entries being cleaned in this pass.
+ * \param now
+ *      Current WallTime seconds timestamp.
+ */
+uint32_t
+LogCleaner::updateAverageSurvivorAge(EntryVector& entries, uint32_t now)
+{
+    if (entries.empty())
+        return averageSurvivorAge;
+
+    uint64_t ageSum = 0;
+    foreach (Entry& entry, entries) {
+        if (entry.timestamp < now)
+            ageSum += now - entry.timestamp;
+    }
+    uint32_t passAverage = downCast<uint32_t>(ageSum / entries.size());
+
+    // Concurrent passes may race here; losing one of their samples is
+    // harmless.
+    uint32_t average = averageSurvivorAge;
+    if (average == 0)
+        average = passAverage;
+    else
+        average = downCast<uint32_t>((7UL * average + passAverage) / 8);
+    averageSurvivorAge = average;
+    return average;
+}
+
 /**
  * Given a vector of entries from segments being cleaned, write them out to
  * survivor segments in order and alert their owning module (MasterService,
  * usually), that they've been relocated.
  *
+ * If more than one age class is requested, entries of different age classes
+ * (see getAgeClass()) are written to different survivors. Since the entries
+ * are sorted by timestamp, each class forms a contiguous run, so this simply
+ * amounts to closing the current survivor whenever the class changes. Each
+ * such survivor is tagged with its class and the timestamp of its youngest
+ * entry, which the cost-benefit formula uses to age it.
+ *
  * \param entries
  *      Vector the entries from segments being cleaned that may need to be
  *      relocated.
@@ -613,6 +746,9 @@ LogCleaner::getSortedEntries(LogSegmentVector& segmentsToClean,
  *      returned here.
  * \param[out] localMetrics
  *      Contains various performance counters that are incremented here.
+ * \param ageClasses
+ *      Number of age classes to segregate survivors into (see
+ *      getAgeClassesForPass()). 1 writes all entries in a single stream.
  * \return
  *      The number of live bytes appended to survivors is returned. This value
  *      includes any segment metadata overhead. This makes it directly
@@ -622,7 +758,8 @@ LogCleaner::getSortedEntries(LogSegmentVector& segmentsToClean,
 uint64_t
 LogCleaner::relocateLiveEntries(EntryVector& entries,
                             LogSegmentVector& outSurvivors,
-                            LogCleanerMetrics::OnDisk<uint64_t>* localMetrics)
+                            LogCleanerMetrics::OnDisk<uint64_t>* localMetrics,
+                            uint32_t ageClasses)
 {
     CycleCounter<uint64_t> _(&localMetrics->relocateLiveEntriesTicks);
 
@@ -631,7 +768,33 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
     uint32_t currentLiveEntries[TOTAL_LOG_ENTRY_TYPES] = { 0 };
     uint32_t currentLiveEntryLengths[TOTAL_LOG_ENTRY_TYPES] = { 0 };
 
+    uint32_t now = WallTime::secondsTimestamp();
+    uint32_t averageAge = 0;
+    if (ageClasses > 1)
+        averageAge = updateAverageSurvivorAge(entries, now);
+
     foreach (Entry& entry, entries) {
+        uint32_t ageClass = LogSegment::NO_AGE_CLASS;
+        if (ageClasses > 1) {
+            uint32_t age = (entry.timestamp < now) ? now - entry.timestamp : 0;
+            ageClass = getAgeClass(age, averageAge, ageClasses);
+        }
+
+        // Never mix age classes in one survivor. Forgetting the survivor
+        // here makes the append below fail and start a fresh one.
+        if (survivor != NULL && survivor->ageClass != ageClass) {
+            for (size_t i = 0; i < TOTAL_LOG_ENTRY_TYPES; i++) {
+                survivor->trackNewEntries(static_cast<LogEntryType>(i),
+                                          currentLiveEntries[i],
+                                          currentLiveEntryLengths[i]);
+            }
+            memset(currentLiveEntries, 0, sizeof(currentLiveEntries));
+            memset(currentLiveEntryLengths, 0,
+                   sizeof(currentLiveEntryLengths));
+            closeSurvivor(survivor);
+            survivor = NULL;
+        }
+
         Buffer buffer;
         LogEntryType type = entry.reference.getEntry(
             &segmentManager.getAllocator(), &buffer);
@@ -666,6 +829,7 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
                 NULL);
             assert(survivor != NULL);
             waitTicks.stop();
+            survivor->ageClass = ageClass;
             outSurvivors.push_back(survivor);
 
             s = relocateEntry(type,
@@ -686,6 +850,10 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
                 buffer.size();
             currentLiveEntries[type]++;
             currentLiveEntryLengths[type] += bytesAppended;
+            if (ageClass != LogSegment::NO_AGE_CLASS) {
+                survivor->dataTimestamp = std::max(survivor->dataTimestamp,
+                                                   entry.timestamp);
+            }
         }
 
         totalEntryBytesAppended += bytesAppended;
@@ -743,6 +911,32 @@ LogCleaner::closeSurvivor(LogSegment* survivor)
     assert(r);
 }
 
+/**
+ * Decide whether the given thread is permitted to clean on disk right now.
+ * Thread 0 always is. Our disk cleaner is fast enough to chew up considerable
+ * backup bandwidth with just one thread, so when compaction is enabled
+ * additional threads are only added once every lower-numbered thread is
+ * already busy cleaning on disk and memory keeps getting tighter anyway (the
+ * same escalation isMemoryLow() uses), or when we are about to run out of disk
+ * space. If compaction is disabled, disk cleaning is the only way to free
+ * memory, so every thread may participate.
+ */
+bool
+LogCleaner::Balancer::mayCleanDisk(CleanerThreadState* thread)
+{
+    if (thread->threadNumber == 0 || cleaner->disableInMemoryCleaning)
+        return true;
+
+    uint32_t busy = cleaner->threadMetrics.getDiskCleaningThreads();
+    if (busy < thread->threadNumber)
+        return false;
+
+    if (cleaner->segmentManager.getSegmentUtilization() >= MIN_DISK_UTILIZATION)
+        return true;
+
+    return isMemoryLow(thread);
+}
+
 bool
 LogCleaner::Balancer::isMemoryLow(CleanerThreadState* thread)
 {
@@ -808,10 +1002,8 @@ bool
 LogCleaner::TombstoneRatioBalancer::isDiskCleaningNeeded(
                                                     CleanerThreadState* thread)
 {
-    // Our disk cleaner is fast enough to chew up considerable backup bandwidth
-    // with just one thread. If we're running with backups, then only permit
-    // one thread to clean on disk.
-    if (thread->threadNumber != 0 && !cleaner->disableInMemoryCleaning)
+    // Additional threads only clean on disk once the first can't keep up.
+    if (!mayCleanDisk(thread))
         return false;
 
     // If we're running out of disk space, we need to run the disk cleaner.
@@ -875,7 +1067,7 @@ LogCleaner::FixedBalancer::isDiskCleaningNeeded(CleanerThreadState* thread)
 {
     // See TombstoneRatioBalancer::isDiskCleaningNeeded for comments on this
     // first handful of conditions.
-    if (thread->threadNumber != 0)
+    if (!mayCleanDisk(thread))
         return false;
 
     if (cleaner->segmentManager.getSegmentUtilization() >= MIN_DISK_UTILIZATION)
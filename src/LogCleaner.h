@@ -27,6 +27,7 @@
 #include "LogEntryRelocator.h"
 #include "LogSegment.h"
 #include "SegmentManager.h"
+#include "SpinLock.h"
 #include "ReplicaManager.h"
 
 #include "LogMetrics.pb.h"
@@ -39,7 +40,10 @@ class ServerConfig;
  * The LogCleaner defragments a Log's closed segments, writing out any live
  * data to new "survivor" segments and reclaiming space used by dead log
  * entries. The cleaner runs in parallel with regular log operations in its
- * own thread.
+ * own threads. When a single thread cannot keep up, several threads may clean
+ * on disk at once: each takes a disjoint set of candidate segments from the
+ * CleanableSegmentManager, relocates their live entries into its own survivor
+ * segments, and reports its pass to the SegmentManager independently.
  *
  * The cleaner employs some heuristics to aid efficiency. For instance, it
  * tries to minimise the cost of cleaning by choosing segments that have a
@@ -104,13 +108,21 @@ class LogCleaner {
     /// this many microseconds before checking again.
     enum { POLL_USEC = 10000 };
 
-    /// The number of full survivor segments to reserve with the SegmentManager.
-    /// Must be large enough to ensure that if we get the worst possible
-    /// fragmentation during cleaning, we'll still have enough space to fit in
-    /// MAX_LIVE_SEGMENTS_PER_DISK_PASS of live data before freeing unused
-    /// seglets at the ends of survivor segments.
+    /// The number of full survivor segments to reserve with the SegmentManager
+    /// for each cleaner thread. Must be large enough to ensure that if we get
+    /// the worst possible fragmentation during cleaning, we'll still have
+    /// enough space to fit in MAX_LIVE_SEGMENTS_PER_DISK_PASS of live data
+    /// before freeing unused seglets at the ends of survivor segments. Since
+    /// every thread may be in a disk cleaning pass at once, the total reserve
+    /// is this many segments times #numThreads.
     enum { SURVIVOR_SEGMENTS_TO_RESERVE = 15 };
 
+    /// The largest number of age classes the disk cleaner will segregate
+    /// survivors into (see #numAgeClasses). Each class beyond the first may
+    /// leave one more partially-filled survivor per pass, so the survivor
+    /// reserve is grown by one segment per extra class.
+    enum { MAX_AGE_CLASSES = 4 };
+
     /// The minimum amount of memory utilization we will begin cleaning at using
     /// the in-memory cleaner.
     enum { MIN_MEMORY_UTILIZATION = 90 };
@@ -191,6 +203,7 @@ class LogCleaner {
 
       PROTECTED:
         bool isMemoryLow(CleanerThreadState* thread);
+        bool mayCleanDisk(CleanerThreadState* thread);
         virtual bool isDiskCleaningNeeded(CleanerThreadState* thread) = 0;
         LogCleaner* cleaner;
         std::atomic<uint64_t> compactionFailures;
@@ -220,7 +233,8 @@ class LogCleaner {
         const uint32_t cleaningPercentage;
     };
 
-    static void cleanerThreadEntry(LogCleaner* logCleaner, Context* context);
+    static void cleanerThreadEntry(LogCleaner* logCleaner, Context* context,
+                                   uint32_t threadNumber);
     int getLiveObjectUtilization();
     int getUndeadTombstoneUtilization();
     bool checkIfCleaningNeeded(CleanerThreadState* thread);
@@ -236,9 +250,15 @@ class LogCleaner {
     void getSortedEntries(LogSegmentVector& segmentsToClean,
                           EntryVector& outEntries,
                           LogCleanerMetrics::OnDisk<uint64_t>* localMetrics);
+    uint32_t getAgeClassesForPass(size_t segmentsCleaned,
+                                  uint64_t liveBytes);
+    static uint32_t getAgeClass(uint32_t age, uint32_t averageAge,
+                                uint32_t ageClasses);
+    uint32_t updateAverageSurvivorAge(EntryVector& entries, uint32_t now);
     uint64_t relocateLiveEntries(EntryVector& entries,
                             LogSegmentVector& outSurvivors,
-                            LogCleanerMetrics::OnDisk<uint64_t>* localMetrics);
+                            LogCleanerMetrics::OnDisk<uint64_t>* localMetrics,
+                            uint32_t ageClasses = 1);
     void closeSurvivor(LogSegment* survivor);
     void waitForAvailableSurvivors(size_t count, uint64_t& outTicks);
 
@@ -369,6 +389,19 @@ class LogCleaner {
     /// keep up with higher write rates and memory utilizations.
     const int numThreads;
 
+    /// Number of age classes that disk cleaning segregates survivor data into
+    /// (between 1 and MAX_AGE_CLASSES). Entries of different classes are never
+    /// written to the same survivor segment, which keeps long-lived data from
+    /// being mixed with (and recleaned alongside) data that will soon die. If
+    /// 1, survivors are only sorted by age.
+    uint32_t numAgeClasses;
+
+    /// Exponentially-weighted moving average of the age, in seconds, of the
+    /// entries examined by recent disk cleaning passes. Age class boundaries
+    /// are powers of two multiples of this, so that a class means the same
+    /// thing from one pass to the next. 0 until the first segregating pass.
+    std::atomic<uint32_t> averageSurvivorAge;
+
     /// Size of each seglet in bytes. Used to calculate the best segment for in-
     /// memory cleaning.
     uint32_t segletSize;
@@ -415,6 +448,11 @@ class LogCleaner {
     /// LogCleanerMetrics::OnDisk<>::merge().
     LogCleanerMetrics::OnDisk<> onDiskMetrics;
 
+    /// Serializes updates to the histograms in #onDiskMetrics that are
+    /// recorded for each cleaned segment (Histogram isn't thread-safe, and
+    /// several threads may be cleaning on disk at once).
+    SpinLock onDiskHistogramLock;
+
     /// Metrics kept for measuring how many threads the cleaner is using.
     LogCleanerMetrics::Threads threadMetrics;
 
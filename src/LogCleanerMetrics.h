@@ -552,9 +552,14 @@ class Threads {
         , activeTicks()
         , activeThreads(0)
         , cycleCounter()
+        , diskCleaningTicks()
+        , diskCleaningThreads(0)
+        , diskCleaningCycleCounter()
     {
         activeTicks.resize(maxThreads + 1, 0);
         cycleCounter.construct();
+        diskCleaningTicks.resize(maxThreads + 1, 0);
+        diskCleaningCycleCounter.construct();
     }
 
     /**
@@ -587,6 +592,48 @@ class Threads {
         lock.unlock();
     }
 
+    /**
+     * Note that a cleaner thread has started a disk cleaning pass. Several
+     * threads may clean on disk at once; this maintains a distribution of
+     * how much time is spent with various numbers of them doing so.
+     */
+    void
+    noteDiskCleaningStart()
+    {
+        lock.lock();
+        diskCleaningTicks[diskCleaningThreads] +=
+            diskCleaningCycleCounter->stop();
+        diskCleaningCycleCounter.construct();
+        diskCleaningThreads++;
+        lock.unlock();
+    }
+
+    /**
+     * Note that a cleaner thread has finished a disk cleaning pass.
+     */
+    void
+    noteDiskCleaningStop()
+    {
+        lock.lock();
+        diskCleaningTicks[diskCleaningThreads] +=
+            diskCleaningCycleCounter->stop();
+        diskCleaningCycleCounter.construct();
+        diskCleaningThreads--;
+        lock.unlock();
+    }
+
+    /**
+     * Return the number of threads currently in a disk cleaning pass.
+     */
+    uint32_t
+    getDiskCleaningThreads()
+    {
+        lock.lock();
+        uint32_t threads = diskCleaningThreads;
+        lock.unlock();
+        return threads;
+    }
+
     /**
      * Serialize the metrics in this class to the given protocol buffer so we
      * can ship it to another machine.
@@ -600,6 +647,8 @@ class Threads {
         lock.lock();
         foreach (uint64_t ticks, activeTicks)
             m.add_active_ticks(ticks);
+        foreach (uint64_t ticks, diskCleaningTicks)
+            m.add_disk_cleaning_ticks(ticks);
         lock.unlock();
     }
 
@@ -617,6 +666,17 @@ class Threads {
 
     /// Number of cycles expended since the last change to 'activeThreads'.
     Tub<CycleCounter<uint64_t>> cycleCounter;
+
+    /// Number of ticks the cleaner has spent with varying numbers of threads
+    /// cleaning on disk simultaneously.
+    vector<uint64_t> diskCleaningTicks;
+
+    /// Count of the number of threads currently cleaning on disk.
+    uint32_t diskCleaningThreads;
+
+    /// Number of cycles expended since the last change to
+    /// 'diskCleaningThreads'.
+    Tub<CycleCounter<uint64_t>> diskCleaningCycleCounter;
 };
 
 } // namespace LogCleanerMetrics
@@ -623,6 +623,86 @@ TEST_F(LogCleanerTest, relocateEntry) {
 }
 #endif
 
+TEST_F(LogCleanerTest, Balancer_mayCleanDisk) {
+    cleaner.disableInMemoryCleaning = false;
+    LogCleaner::CleanerThreadState thread1;
+    thread1.threadNumber = 1;
+    SegmentManager::mockMemoryUtilization = 99;
+    CleanableSegmentManager::mockLiveObjectUtilization = 1;
+
+    // Thread 0 may always clean on disk.
+    EXPECT_TRUE(cleaner.balancer->mayCleanDisk(&threadState));
+
+    // Thread 1 waits until thread 0 is already cleaning on disk.
+    EXPECT_FALSE(cleaner.balancer->mayCleanDisk(&thread1));
+    cleaner.threadMetrics.noteDiskCleaningStart();
+    EXPECT_TRUE(cleaner.balancer->mayCleanDisk(&thread1));
+
+    // ...and memory has passed its escalated threshold.
+    SegmentManager::mockMemoryUtilization = 91;
+    EXPECT_FALSE(cleaner.balancer->mayCleanDisk(&thread1));
+
+    // ...or backup disks are nearly full.
+    SegmentManager::mockSegmentUtilization = 99;
+    EXPECT_TRUE(cleaner.balancer->mayCleanDisk(&thread1));
+    cleaner.threadMetrics.noteDiskCleaningStop();
+
+    // Without compaction every thread may clean on disk.
+    cleaner.disableInMemoryCleaning = true;
+    EXPECT_TRUE(cleaner.balancer->mayCleanDisk(&thread1));
+
+    SegmentManager::mockMemoryUtilization = 0;
+    SegmentManager::mockSegmentUtilization = 0;
+    CleanableSegmentManager::mockLiveObjectUtilization = 0;
+}
+
+TEST_F(LogCleanerTest, getAgeClassesForPass) {
+    uint64_t segmentSize = cleaner.segmentSize;
+    EXPECT_EQ(1U, cleaner.getAgeClassesForPass(10, 0));
+
+    cleaner.numAgeClasses = 4;
+    EXPECT_EQ(4U, cleaner.getAgeClassesForPass(10, 0));
+    EXPECT_EQ(4U, cleaner.getAgeClassesForPass(10, 6 * segmentSize));
+    EXPECT_EQ(3U, cleaner.getAgeClassesForPass(10, 7 * segmentSize));
+    EXPECT_EQ(2U, cleaner.getAgeClassesForPass(10, 7 * segmentSize + 1));
+    EXPECT_EQ(1U, cleaner.getAgeClassesForPass(10, 9 * segmentSize));
+    EXPECT_EQ(1U, cleaner.getAgeClassesForPass(1, 0));
+}
+
+TEST_F(LogCleanerTest, getAgeClass) {
+    EXPECT_EQ(0U, LogCleaner::getAgeClass(1000, 100, 1));
+
+    EXPECT_EQ(0U, LogCleaner::getAgeClass(99, 100, 2));
+    EXPECT_EQ(1U, LogCleaner::getAgeClass(100, 100, 2));
+    EXPECT_EQ(1U, LogCleaner::getAgeClass(1000, 100, 2));
+
+    EXPECT_EQ(0U, LogCleaner::getAgeClass(49, 100, 4));
+    EXPECT_EQ(1U, LogCleaner::getAgeClass(50, 100, 4));
+    EXPECT_EQ(2U, LogCleaner::getAgeClass(100, 100, 4));
+    EXPECT_EQ(2U, LogCleaner::getAgeClass(199, 100, 4));
+    EXPECT_EQ(3U, LogCleaner::getAgeClass(200, 100, 4));
+    EXPECT_EQ(3U, LogCleaner::getAgeClass(100000, 100, 4));
+
+    // With no history everything but brand new data is old.
+    EXPECT_EQ(0U, LogCleaner::getAgeClass(0, 0, 2));
+    EXPECT_EQ(1U, LogCleaner::getAgeClass(1, 0, 2));
+}
+
+TEST_F(LogCleanerTest, updateAverageSurvivorAge) {
+    LogCleaner::EntryVector entries;
+    EXPECT_EQ(0U, cleaner.updateAverageSurvivorAge(entries, 1000));
+
+    entries.push_back({ {}, 900 });
+    entries.push_back({ {}, 700 });
+    EXPECT_EQ(200U, cleaner.updateAverageSurvivorAge(entries, 1000));
+    EXPECT_EQ(200U, cleaner.averageSurvivorAge);
+
+    // Entries from the future count as age 0.
+    entries.push_back({ {}, 2000 });
+    entries.push_back({ {}, 1000 });
+    EXPECT_EQ(187U, cleaner.updateAverageSurvivorAge(entries, 1000));
+}
+
 TEST_F(LogCleanerTest, Disabler_basics) {
     TestLog::Enable _;
     Tub<LogCleaner::Disabler> disabler1, disabler2;
@@ -114,6 +114,9 @@ LogMetricsStringer::getServerParameters()
     s += ls + format("  Cleaner Threads:               %u\n",
         serverConfig->master().cleaner_thread_count());
 
+    s += ls + format("  Cleaner Age Classes:           %u\n",
+        serverConfig->master().cleaner_age_classes());
+
     s += ls + format("  Cleaner Balancer:              %s\n",
         serverConfig->master().cleaner_balancer().c_str());
 
@@ -170,6 +173,16 @@ LogMetricsStringer::getGenericCleanerMetrics()
             i++, d(ticks) / d(totalTicks) * 100);
     }
 
+    uint64_t diskTicks = 0;
+    foreach (uint64_t ticks, threadMetrics.disk_cleaning_ticks())
+        diskTicks += ticks;
+    s += ls + format("  Disk Cleaning Thread Distribution:\n");
+    i = 0;
+    foreach (uint64_t ticks, threadMetrics.disk_cleaning_ticks()) {
+        s += ls + format("    %3d simultaneous:            %.3f%% of time\n",
+            i++, d(ticks) / d(diskTicks) * 100);
+    }
+
     return s;
 }
 
@@ -500,6 +513,12 @@ LogMetricsStringer::getLogMetrics()
     s += ls + format("    Avg Per Operation (RPC):     %.2f us\n",
         syncTime * 1.0e6 / d(logMetrics->total_sync_calls()));
 
+    Histogram syncBatches(logMetrics->sync_batch_histogram());
+    s += ls + format("    Syncs Per Backup Write:      %lu avg, %lu median, "
+        "%lu max\n",
+        syncBatches.getAverage(), syncBatches.getMedian(),
+        syncBatches.getMax());
+
     double noMemTime = Cycles::toSeconds(logMetrics->total_no_space_ticks(),
                                          serverHz);
     s += ls + format("  Time Out of Memory:            %.3f sec (%.2f%%)\n",
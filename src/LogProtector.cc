@@ -16,6 +16,7 @@
 #include "Common.h"
 #include "Dispatch.h"
 #include "LogProtector.h"
+#include "Transport.h"
 
 namespace RAMCloud {
 
@@ -89,6 +90,89 @@ LogProtector::Activity::getEarliestEpoch(int activityMask)
     }
 }
 
+/**
+ * Default constructor.
+ */
+LogProtector::TransmitTracker::TransmitTracker()
+    : EpochProvider()
+    , pinned()
+    , earliestPinned(~0lu)
+    , floor(0)
+    , pinsSinceRefresh(0)
+{
+}
+
+/**
+ * Invoked by a driver just before it hands the NIC a packet that refers
+ * to caller memory rather than a copy of it.
+ *
+ * \return
+ *      The epoch that was pinned; it must be passed to #unpin once the
+ *      NIC has finished reading the packet.
+ */
+uint64_t
+LogProtector::TransmitTracker::pin()
+{
+    // Recompute the floor when nothing is pinned (so an idle tracker never
+    // holds back the cleaner) and every so often under load (so that it
+    // advances along with the current epoch).
+    if (pinned.empty() || ++pinsSinceRefresh >= REFRESH_INTERVAL) {
+        refreshFloor();
+    }
+    pinned[floor]++;
+    earliestPinned = pinned.begin()->first;
+    return floor;
+}
+
+/**
+ * Invoked by a driver once the NIC has finished transmitting a packet
+ * for which #pin was called.
+ *
+ * \param epoch
+ *      The value returned by the corresponding call to #pin.
+ */
+void
+LogProtector::TransmitTracker::unpin(uint64_t epoch)
+{
+    std::map<uint64_t, uint32_t>::iterator it = pinned.find(epoch);
+    assert(it != pinned.end());
+    if (--it->second == 0) {
+        pinned.erase(it);
+        earliestPinned = pinned.empty() ? ~0lu : pinned.begin()->first;
+    }
+}
+
+// See EpochProvider for documentation.
+uint64_t
+LogProtector::TransmitTracker::getEarliestEpoch(int activityMask)
+{
+    // Only replies to reads carry log memory to the NIC.
+    if ((activityMask & Transport::ServerRpc::READ_ACTIVITY) == 0)
+        return ~0;
+    return earliestPinned;
+}
+
+/**
+ * Recompute #floor from the epochs of all activities that are currently
+ * using the log. Any data in a packet came from one of them (it is still
+ * running, since drivers are invoked before the RPC is deleted), and any
+ * activity that starts later will have an epoch no earlier than the
+ * current one. The current epoch alone isn't enough: a segment cleaned
+ * while the RPC was running has an earlier epoch, and once the RPC has been
+ * deleted only the pin protects it. This tracker's own pins are left out,
+ * or the floor could never advance while transmits are continuously in
+ * flight.
+ */
+void
+LogProtector::TransmitTracker::refreshFloor()
+{
+    uint64_t current = LogProtector::getCurrentEpoch();
+    uint64_t earliest = LogProtector::getEarliestOutstandingEpoch(
+            Transport::ServerRpc::READ_ACTIVITY, this);
+    floor = std::min(current, earliest);
+    pinsSinceRefresh = 0;
+}
+
 //////////////////////////////////////////////////////
 /// Static members
 //////////////////////////////////////////////////////
@@ -101,16 +185,23 @@ LogProtector::Activity::getEarliestEpoch(int activityMask)
  * \param activityMask
  *      A bit mask of flags such as Transport::READ_ACTIVITY. Only
  *      matching activities will be considered.
+ * \param exclude
+ *      If non-NULL, this provider is ignored (used by TransmitTracker to
+ *      leave out its own pinned epochs).
  */
 uint64_t
-LogProtector::getEarliestOutstandingEpoch(int activityMask)
+LogProtector::getEarliestOutstandingEpoch(int activityMask,
+                                          const EpochProvider* exclude)
 {
     Lock listLock(epochProvidersMutex);
     uint64_t earliest = ~0;
 
     EpochList::iterator it = epochProviders.begin();
     while (it != epochProviders.end()) {
-        earliest = std::min((*it)->getEarliestEpoch(activityMask), earliest);
+        if (*it != exclude) {
+            earliest = std::min((*it)->getEarliestEpoch(activityMask),
+                                earliest);
+        }
         it++;
     }
 
@@ -16,7 +16,9 @@
 #ifndef RAMCLOUD_LOGPROTECTOR_H
 #define RAMCLOUD_LOGPROTECTOR_H
 
+#include <atomic>
 #include <list>
+#include <map>
 #include "Common.h"
 
 namespace RAMCloud {
@@ -113,11 +115,58 @@ class LogProtector {
         DISALLOW_COPY_AND_ASSIGN(Guard);
     };
 
+    /**
+     * Used by drivers that transmit packets directly out of caller memory
+     * (zero-copy). Such memory may belong to the log, and the NIC can still
+     * be reading it after the RPC that produced it has been deleted, so the
+     * driver pins an epoch for every such transmit until the NIC reports
+     * completion. While any transmit is pinned, segments cleaned at or after
+     * the pinned epoch will not be freed.
+     *
+     * The pinned epoch is a lower bound on the epochs of all RPCs that could
+     * have placed data in the packet; it is recomputed periodically rather
+     * than for every packet. #pin and #unpin must be invoked in the dispatch
+     * thread (or with the dispatch lock held); #getEarliestEpoch may be
+     * invoked concurrently from any thread.
+     */
+    class TransmitTracker : public EpochProvider {
+      public:
+        TransmitTracker();
+        uint64_t pin();
+        void unpin(uint64_t epoch);
+        virtual uint64_t getEarliestEpoch(int activityMask);
+
+      PRIVATE:
+        void refreshFloor();
+
+        /// Recompute #floor after this many calls to pin.
+        enum { REFRESH_INTERVAL = 64 };
+
+        /// For each epoch with transmits in flight, the number of them.
+        /// Only accessed in the dispatch thread.
+        std::map<uint64_t, uint32_t> pinned;
+
+        /// The smallest epoch in #pinned, or ~0 if nothing is pinned. This
+        /// is what #getEarliestEpoch returns, so cleaner threads never look
+        /// at #pinned itself.
+        std::atomic<uint64_t> earliestPinned;
+
+        /// Epoch returned by pin: no RPC that is currently executing
+        /// or starts later can have an epoch earlier than this.
+        uint64_t floor;
+
+        /// Number of calls to pin since #floor was last recomputed.
+        uint32_t pinsSinceRefresh;
+
+        DISALLOW_COPY_AND_ASSIGN(TransmitTracker);
+    };
+
     //////////////////////////////////////////////////////
     /// Static members
     //////////////////////////////////////////////////////
   public:
-    static uint64_t getEarliestOutstandingEpoch(int activityMask);
+    static uint64_t getEarliestOutstandingEpoch(int activityMask,
+            const EpochProvider* exclude = NULL);
     static uint64_t getCurrentEpoch();
     static uint64_t incrementCurrentEpoch();
     static void wait(Context* context, int activityMask);
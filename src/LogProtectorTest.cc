@@ -138,6 +138,77 @@ TEST_F(LogProtectorTest, guard) {
     EXPECT_EQ(0, activity.activityMask);
 }
 
+TEST_F(LogProtectorTest, transmitTracker_pin) {
+    LogProtector::TransmitTracker tracker;
+    LogProtector::Activity activity;
+    LogProtector::currentSystemEpoch = 7;
+    activity.start(Transport::ServerRpc::READ_ACTIVITY);
+    LogProtector::currentSystemEpoch = 12;
+
+    // The first pin computes a floor from the running activity.
+    EXPECT_EQ(7U, tracker.pin());
+    EXPECT_EQ(7U, tracker.floor);
+
+    // Later pins reuse the floor until the refresh interval expires,
+    // and the tracker's own pins don't hold the floor back.
+    activity.stop();
+    EXPECT_EQ(7U, tracker.pin());
+    tracker.pinsSinceRefresh =
+            LogProtector::TransmitTracker::REFRESH_INTERVAL - 1;
+    EXPECT_EQ(12U, tracker.pin());
+    EXPECT_EQ(0U, tracker.pinsSinceRefresh);
+    EXPECT_EQ(2U, tracker.pinned.size());
+    EXPECT_EQ(2U, tracker.pinned[7]);
+}
+
+TEST_F(LogProtectorTest, transmitTracker_unpin) {
+    LogProtector::TransmitTracker tracker;
+    LogProtector::currentSystemEpoch = 5;
+    uint64_t e1 = tracker.pin();
+    uint64_t e2 = tracker.pin();
+    EXPECT_EQ(5U, LogProtector::getEarliestOutstandingEpoch(~0));
+    tracker.unpin(e1);
+    EXPECT_EQ(5U, LogProtector::getEarliestOutstandingEpoch(~0));
+    tracker.unpin(e2);
+    EXPECT_EQ(0U, tracker.pinned.size());
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
+}
+
+TEST_F(LogProtectorTest, transmitTracker_getEarliestEpoch) {
+    LogProtector::TransmitTracker tracker;
+    LogProtector::currentSystemEpoch = 9;
+    EXPECT_EQ(-1UL, tracker.getEarliestEpoch(~0));
+    uint64_t e1 = tracker.pin();
+    LogProtector::currentSystemEpoch = 15;
+    tracker.pinsSinceRefresh =
+            LogProtector::TransmitTracker::REFRESH_INTERVAL - 1;
+    uint64_t e2 = tracker.pin();
+    EXPECT_EQ(15U, e2);
+    EXPECT_EQ(9U, tracker.getEarliestEpoch(~0));
+    EXPECT_EQ(9U, tracker.getEarliestEpoch(
+            Transport::ServerRpc::READ_ACTIVITY));
+    EXPECT_EQ(-1UL, tracker.getEarliestEpoch(
+            Transport::ServerRpc::APPEND_ACTIVITY));
+    tracker.unpin(e1);
+    EXPECT_EQ(15U, tracker.getEarliestEpoch(~0));
+    tracker.unpin(e2);
+    EXPECT_EQ(-1UL, tracker.getEarliestEpoch(~0));
+}
+
+TEST_F(LogProtectorTest, transmitTracker_refreshFloor) {
+    // Other threads scanning the providers must always see our pins,
+    // including while a refresh is in progress.
+    LogProtector::TransmitTracker tracker;
+    LogProtector::currentSystemEpoch = 4;
+    tracker.pin();
+    LogProtector::currentSystemEpoch = 20;
+    tracker.refreshFloor();
+    EXPECT_EQ(20U, tracker.floor);
+    EXPECT_EQ(4U, LogProtector::getEarliestOutstandingEpoch(~0));
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0,
+            &tracker));
+}
+
 TEST_F(LogProtectorTest, getCurrentEpoch) {
     LogProtector::currentSystemEpoch = 28;
     EXPECT_EQ(28U, LogProtector::getCurrentEpoch());
@@ -84,6 +84,8 @@ class LogSegment : public Segment {
           segmentSize(segmentSize),
           creationTimestamp(creationTimestamp),
           isEmergencyHead(isEmergencyHead),
+          ageClass(NO_AGE_CLASS),
+          dataTimestamp(0),
           cleanedEpoch(0),
           cachedCleaningCostBenefitScore(0),
           cachedCompactionCostBenefitScore(0),
@@ -247,6 +249,22 @@ class LogSegment : public Segment {
     /// that is expected to live longer.
     const bool isEmergencyHead;
 
+    /// Value of #ageClass for segments that were not written by a disk
+    /// cleaning pass that segregates survivors by age.
+    enum : uint32_t { NO_AGE_CLASS = ~0U };
+
+    /// If this is a survivor written by a disk cleaning pass with more than
+    /// one age class, the class (0 being the youngest data) that all of its
+    /// entries belong to. Otherwise NO_AGE_CLASS. Preserved across in-memory
+    /// compaction.
+    uint32_t ageClass;
+
+    /// If #ageClass is set, the WallTime seconds timestamp of the youngest
+    /// entry relocated into this segment. The cleaner's cost-benefit formula
+    /// uses this rather than #creationTimestamp to age segregated survivors,
+    /// since they are created long after the data they hold was written.
+    uint32_t dataTimestamp;
+
     /// The epoch value when cleaning was completed on this segment. Once no
     /// more RPCs in the system exist with epochs less than or equal to this,
     /// there can be no more outstanding references into the segment and its
@@ -24,6 +24,7 @@
 #include "RamCloud.h"
 #include "ServerConfig.h"
 #include "StringUtil.h"
+#include "WorkerManager.h"
 #include "Transport.h"
 #include "MasterTableMetadata.h"
 
@@ -278,6 +279,51 @@ TEST_F(LogSyncTest, syncTo) {
     EXPECT_EQ(5U, l->metrics.totalSyncCalls);
 }
 
+TEST_F(LogSyncTest, syncTo_runningInline) {
+    Log::Reference reference;
+    l->sync();
+    l->append(LOG_ENTRY_TYPE_OBJ, "hi", 2, &reference);
+    WorkerManager::runningInline = true;
+    EXPECT_THROW(l->syncTo(reference), LogSyncDisallowedException);
+    WorkerManager::runningInline = false;
+    EXPECT_NE(l->head->syncedLength, l->head->getAppendedLength());
+
+    // Entries that are already durable don't need the sync.
+    l->syncTo(reference);
+    WorkerManager::runningInline = true;
+    EXPECT_NO_THROW(l->syncTo(reference));
+    WorkerManager::runningInline = false;
+}
+
+TEST_F(LogSyncTest, syncTo_groupCommit) {
+    Histogram& batches = l->metrics.syncBatchHistogram;
+    l->sync();
+    batches.reset();
+    l->syncRequestsAtLastBatch = l->syncRequests;
+
+    // Pretend another thread is queued behind us: both requests are
+    // covered by a single replication, after the window has passed.
+    Log::Reference reference;
+    l->append(LOG_ENTRY_TYPE_OBJ, "hi", 2, &reference);
+    l->syncRequests++;
+    l->setGroupCommitWindow(10);
+    uint64_t start = Cycles::rdtsc();
+    l->syncTo(reference);
+    EXPECT_GE(Cycles::rdtsc() - start, Cycles::fromMicroseconds(10));
+    EXPECT_EQ(l->head->syncedLength, l->head->getAppendedLength());
+    EXPECT_EQ(1U, batches.getTotalSamples());
+    EXPECT_EQ(2U, batches.getMax());
+
+    // No replication, so no batch, if the entry is already durable; nor
+    // are those calls counted towards the next batch.
+    uint64_t requests = l->syncRequests;
+    l->syncTo(reference);
+    l->sync();
+    EXPECT_EQ(1U, batches.getTotalSamples());
+    EXPECT_EQ(requests, l->syncRequests);
+    l->setGroupCommitWindow(0);
+}
+
 TEST_F(LogTest, rollHeadOver) {
     LogPosition oldPos = LogPosition(0, 0);
     LogSegment* oldHead = l.head;
@@ -14,6 +14,7 @@
  */
 
 #include "MasterClient.h"
+#include "btreeRamCloud/Btree.h"
 #include "TransportManager.h"
 #include "ProtoBuf.h"
 #include "Log.h"
@@ -287,6 +288,100 @@ InsertIndexEntryRpc::handleIndexDoesntExist()
     response->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
 }
 
+/**
+ * This RPC is sent to an index server to request that it insert many index
+ * entries at once. The index server inserts the entries that belong to the
+ * indexlet containing the first entry; the caller must send the rest again.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param tableId
+ *      Id of the table containing the objects that the entries point to.
+ * \param indexId
+ *      Id of the index to which the entries belong.
+ * \param entries
+ *      Entries to insert, sorted by index key.
+ * \param numEntries
+ *      Number of entries in \a entries.
+ * \return
+ *      The number of entries, from the start of \a entries, that were
+ *      inserted (or that were dropped because the index doesn't exist).
+ *      This may be less than \a numEntries if the entries span indexlets
+ *      or don't fit in one request.
+ */
+uint32_t
+MasterClient::insertIndexEntries(
+        Context* context, uint64_t tableId, uint8_t indexId,
+        const BtreeEntry* entries, uint32_t numEntries)
+{
+    InsertIndexEntriesRpc rpc(context, tableId, indexId, entries, numEntries);
+    return rpc.wait();
+}
+
+/**
+ * Constructor for InsertIndexEntriesRpc: initiates an RPC in the same way as
+ * #MasterClient::insertIndexEntries, but returns once the RPC has been
+ * initiated, without waiting for it to complete. The RPC is routed to the
+ * indexlet containing the first entry.
+ *
+ * \copydetails MasterClient::insertIndexEntries
+ */
+InsertIndexEntriesRpc::InsertIndexEntriesRpc(
+        Context* context, uint64_t tableId, uint8_t indexId,
+        const BtreeEntry* entries, uint32_t numEntries)
+    : IndexRpcWrapper(context, tableId, indexId, entries[0].key,
+            entries[0].keyLength,
+            sizeof(WireFormat::InsertIndexEntries::Response))
+    , numEntriesSent(0)
+{
+    WireFormat::InsertIndexEntries::Request* reqHdr(
+            allocHeader<WireFormat::InsertIndexEntries>());
+    reqHdr->tableId = tableId;
+    reqHdr->indexId = indexId;
+    while (numEntriesSent < numEntries) {
+        const BtreeEntry& entry = entries[numEntriesSent];
+        uint32_t length = sizeof32(WireFormat::InsertIndexEntries::Entry) +
+                entry.keyLength;
+        if (numEntriesSent > 0 && request.size() + length > MAX_REQUEST_BYTES)
+            break;
+        WireFormat::InsertIndexEntries::Entry* header =
+                request.emplaceAppend<WireFormat::InsertIndexEntries::Entry>();
+        header->primaryKeyHash = entry.pKHash;
+        header->indexKeyLength = entry.keyLength;
+        request.append(entry.key, entry.keyLength);
+        numEntriesSent++;
+    }
+    reqHdr->numEntries = numEntriesSent;
+    send();
+}
+
+// See IndexRpcWrapper for documentation.
+void
+InsertIndexEntriesRpc::handleIndexDoesntExist()
+{
+    response->reset();
+    WireFormat::InsertIndexEntries::Response* respHdr =
+            response->emplaceAppend<WireFormat::InsertIndexEntries::Response>();
+    respHdr->common.status = STATUS_OK;
+    respHdr->numInserted = numEntriesSent;
+}
+
+/**
+ * Wait for an insertIndexEntries RPC to complete.
+ *
+ * \return
+ *      The number of entries, from the start of those passed to the
+ *      constructor, that were inserted.
+ */
+uint32_t
+InsertIndexEntriesRpc::wait()
+{
+    simpleWait(context);
+    const WireFormat::InsertIndexEntries::Response* respHdr(
+            getResponseHeader<WireFormat::InsertIndexEntries>());
+    return respHdr->numInserted;
+}
+
 /**
  * Return whether a replica for a segment created by a given master may still
  * be needed for recovery. Backups use this when restarting after a failure
@@ -33,6 +33,7 @@ namespace RAMCloud {
 
 // forward declaration
 class Segment;
+struct BtreeEntry;
 
 /**
  * Provides methods for invoking RPCs to RAMCloud masters.  The invoking
@@ -54,6 +55,9 @@ class MasterClient {
             uint64_t tableId, uint8_t indexId,
             const void* indexKey, KeyLength indexKeyLength,
             uint64_t primaryKeyHash);
+    static uint32_t insertIndexEntries(Context* context,
+            uint64_t tableId, uint8_t indexId,
+            const BtreeEntry* entries, uint32_t numEntries);
     static bool isReplicaNeeded(Context* context, ServerId serverId,
             ServerId backupServerId, uint64_t segmentId);
     static void prepForIndexletMigration(Context* context, ServerId serverId,
@@ -164,6 +168,29 @@ class InsertIndexEntryRpc : public IndexRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(InsertIndexEntryRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::insertIndexEntries
+ * request, allowing it to execute asynchronously.
+ */
+class InsertIndexEntriesRpc : public IndexRpcWrapper {
+  public:
+    InsertIndexEntriesRpc(Context* context,
+            uint64_t tableId, uint8_t indexId,
+            const BtreeEntry* entries, uint32_t numEntries);
+    ~InsertIndexEntriesRpc() {}
+    void handleIndexDoesntExist();
+    uint32_t wait();
+
+    /// Entries are added to a request only until it reaches this size.
+    static const uint32_t MAX_REQUEST_BYTES = 1024*1024;
+
+  PRIVATE:
+    /// Number of entries included in the request.
+    uint32_t numEntriesSent;
+
+    DISALLOW_COPY_AND_ASSIGN(InsertIndexEntriesRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::isReplicaNeeded
  * request, allowing it to execute asynchronously.
@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -104,8 +105,10 @@ MasterService::MasterService(Context* context, const ServerConfig* config)
     , logEverSynced(false)
     , masterTableMetadata()
     , maxResponseRpcLen(Transport::MAX_RPC_LEN)
+    , maxBuildIndexEntries(MAX_BUILD_INDEX_ENTRIES)
     , migrationMonitor(this)
 {
+    indexletManager.setLeafCompression(config->master.indexLeafCompression);
     context->services[WireFormat::MASTER_SERVICE] = this;
 }
 
@@ -133,7 +136,15 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
         return;
     }
 
+    // See abandonInlineRpc().
+    if (WorkerManager::runningInline)
+        TabletManager::resetInlineReadCounts();
+
     switch (opcode) {
+        case WireFormat::BuildIndex::opcode:
+            callHandler<WireFormat::BuildIndex, MasterService,
+                        &MasterService::buildIndex>(rpc);
+            break;
         case WireFormat::DropTabletOwnership::opcode:
             callHandler<WireFormat::DropTabletOwnership, MasterService,
                         &MasterService::dropTabletOwnership>(rpc);
@@ -174,6 +185,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::InsertIndexEntry, MasterService,
                         &MasterService::insertIndexEntry>(rpc);
             break;
+        case WireFormat::InsertIndexEntries::opcode:
+            callHandler<WireFormat::InsertIndexEntries, MasterService,
+                        &MasterService::insertIndexEntries>(rpc);
+            break;
         case WireFormat::IsReplicaNeeded::opcode:
             callHandler<WireFormat::IsReplicaNeeded, MasterService,
                         &MasterService::isReplicaNeeded>(rpc);
@@ -269,6 +284,13 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
     }
 }
 
+// See Service::abandonInlineRpc.
+void
+MasterService::abandonInlineRpc()
+{
+    tabletManager.undoInlineReadCounts();
+}
+
 /**
  * Construct a Disabler object (disable the associated master).
  *
@@ -313,6 +335,188 @@ volatile int MasterService::pauseIncrement = 0;
 volatile int MasterService::continueIncrement = 0;
 #endif
 
+/**
+ * Arguments to buildIndexBucket(), which is invoked through the void* cookie
+ * of ObjectManager::forEachInHashTableBucket.
+ */
+struct BuildIndexBucketArgs {
+    /// Log containing the objects being indexed.
+    Log* log;
+
+    /// Table containing the tablet being indexed.
+    uint64_t tableId;
+
+    /// Id of the index being built.
+    uint8_t indexId;
+
+    /// Smallest key hash in the tablet being indexed.
+    uint64_t firstKeyHash;
+
+    /// Largest key hash in the tablet being indexed.
+    uint64_t lastKeyHash;
+
+    /// Holds copies of the secondary keys referenced by #entries, since
+    /// the objects they came from may be cleaned while we wait on RPCs.
+    Buffer* keys;
+
+    /// Index entries for the objects found so far.
+    std::vector<BtreeEntry>* entries;
+};
+
+/**
+ * Helper for MasterService::buildIndex: adds an index entry for an object
+ * in a HashTable bucket, if the object is in the tablet being indexed and
+ * has a key for the index.
+ *
+ * \param reference
+ *      An entry in the HashTable bucket.
+ * \param cookie
+ *      A pointer to BuildIndexBucketArgs.
+ */
+static void
+buildIndexBucket(uint64_t reference, void* cookie)
+{
+    BuildIndexBucketArgs& args = *static_cast<BuildIndexBucketArgs*>(cookie);
+
+    Buffer buffer;
+    LogEntryType type = args.log->getEntry(Log::Reference(reference), buffer);
+    if (type != LOG_ENTRY_TYPE_OBJ)
+        return;
+
+    Key key(type, buffer);
+    KeyHash keyHash = key.getHash();
+    if (key.getTableId() != args.tableId || keyHash < args.firstKeyHash ||
+            args.lastKeyHash < keyHash) {
+        return;
+    }
+
+    Object object(buffer);
+    if (args.indexId >= object.getKeyCount())
+        return;
+    KeyLength indexKeyLength;
+    const void* indexKey = object.getKey(args.indexId, &indexKeyLength);
+    if (indexKey == NULL || indexKeyLength == 0)
+        return;
+
+    void* copy = args.keys->alloc(indexKeyLength);
+    memcpy(copy, indexKey, indexKeyLength);
+    args.entries->emplace_back(copy, indexKeyLength, keyHash);
+}
+
+/**
+ * Top-level server method to handle the BUILD_INDEX request.
+ *
+ * Creates index entries for the objects in one of this master's tablets
+ * that have a key for the given index. Rather than sending one
+ * INSERT_INDEX_ENTRY RPC per object, the entries are sorted by index key
+ * and sent in large batches (see MasterClient::insertIndexEntries), which
+ * lets the index servers build their trees bottom-up.
+ *
+ * The tablet's hash table buckets are scanned in increasing order, and the
+ * RPC returns once it has collected #maxBuildIndexEntries entries, telling
+ * the client which bucket to resume at. If the hash table is resized
+ * between RPCs, the bucket numbers change meaning, so the tablet is scanned
+ * again from the start; the index servers skip the entries they already
+ * have.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::buildIndex(
+        const WireFormat::BuildIndex::Request* reqHdr,
+        WireFormat::BuildIndex::Response* respHdr,
+        Rpc* rpc)
+{
+    TabletManager::Tablet tablet;
+    if (!tabletManager.getTablet(reqHdr->tableId, reqHdr->keyHash, &tablet)) {
+        respHdr->common.status = STATUS_UNKNOWN_TABLET;
+        return;
+    }
+
+    Buffer keys;
+    std::vector<BtreeEntry> entries;
+    BuildIndexBucketArgs args;
+    args.log = objectManager.getLog();
+    args.tableId = reqHdr->tableId;
+    args.indexId = reqHdr->indexId;
+    args.firstKeyHash = tablet.startKeyHash;
+    args.lastKeyHash = tablet.endKeyHash;
+    args.keys = &keys;
+    args.entries = &entries;
+
+    uint64_t numBuckets = objectManager.getObjectMap()->getNumBuckets();
+    uint64_t bucket = reqHdr->nextBucket;
+    if (reqHdr->numBuckets != numBuckets)
+        bucket = 0;
+
+    // Only some buckets need scanning if the tablet's objects are indexed.
+    // The list is computed once per scan of the tablet (see
+    // ObjectManager::getEnumerationBuckets).
+    std::shared_ptr<const std::vector<uint64_t>> buckets =
+            objectManager.getEnumerationBuckets(reqHdr->tableId,
+            tablet.startKeyHash, tablet.endKeyHash, numBuckets, bucket == 0);
+    size_t listed = 0;
+    if (buckets != NULL) {
+        listed = std::lower_bound(buckets->begin(), buckets->end(), bucket) -
+                buckets->begin();
+    }
+
+    // Collect entries for the objects in the tablet, starting at the given
+    // bucket, until there are enough for one RPC.
+    bool resized = false;
+    while (entries.size() < maxBuildIndexEntries) {
+        if (buckets != NULL) {
+            bucket = (listed < buckets->size()) ? (*buckets)[listed++]
+                                                : numBuckets;
+        }
+        if (bucket >= numBuckets)
+            break;
+        if (!objectManager.forEachInHashTableBucket(buildIndexBucket,
+                &args, numBuckets, bucket)) {
+            // The entries found so far are still good, but the rest of the
+            // tablet can't be found from here.
+            resized = true;
+            break;
+        }
+        bucket++;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+            [](const BtreeEntry& a, const BtreeEntry& b) {
+        int keyComparison = IndexKey::keyCompare(a.key, a.keyLength,
+                                                 b.key, b.keyLength);
+        return (keyComparison == 0) ? (a.pKHash < b.pKHash)
+                                    : keyComparison < 0;
+    });
+
+    // Each RPC inserts a prefix of the remaining entries: those that fit in
+    // one request and belong to the same indexlet.
+    uint32_t numEntries = downCast<uint32_t>(entries.size());
+    uint32_t numSent = 0;
+    while (numSent < numEntries) {
+        numSent += MasterClient::insertIndexEntries(context, reqHdr->tableId,
+                reqHdr->indexId, &entries[numSent], numEntries - numSent);
+    }
+
+    LOG(DEBUG, "Built index %u for %u objects in tablet [0x%lx,0x%lx] "
+            "of tableId %lu", reqHdr->indexId, numEntries,
+            tablet.startKeyHash, tablet.endKeyHash, reqHdr->tableId);
+    respHdr->numObjects = numEntries;
+    if (resized) {
+        respHdr->nextKeyHash = tablet.startKeyHash;
+        respHdr->nextBucket = 0;
+        respHdr->numBuckets = objectManager.getObjectMap()->getNumBuckets();
+    } else if (bucket < numBuckets) {
+        respHdr->nextKeyHash = tablet.startKeyHash;
+        respHdr->nextBucket = bucket;
+        respHdr->numBuckets = numBuckets;
+    } else {
+        respHdr->nextKeyHash = tablet.endKeyHash + 1;
+        respHdr->nextBucket = 0;
+        respHdr->numBuckets = 0;
+    }
+}
+
 /**
  * Top-level server method to handle the DROP_TABLET_OWNERSHIP request.
  *
@@ -338,7 +542,8 @@ MasterService::dropTabletOwnership(
 
     // Ensure that the ObjectManager never returns objects from this deleted
     // tablet again.
-    objectManager.removeOrphanedObjects();
+    objectManager.removeOrphanedObjects(reqHdr->tableId,
+            reqHdr->firstKeyHash, reqHdr->lastKeyHash);
 
     // Removed unnecessary prepared transaction operations.
     transactionManager.removeOrphanedOps();
@@ -453,7 +658,7 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
             actualTabletStartHash, actualTabletEndHash,
             &respHdr->tabletFirstHash, iter,
             *objectManager.getLog(),
-            *objectManager.getObjectMap(),
+            objectManager,
             *rpc->replyPayload, maxPayloadBytes);
     enumeration.complete();
     respHdr->payloadBytes = rpc->replyPayload->size()
@@ -506,6 +711,8 @@ MasterService::getServerStatistics(
 {
     ProtoBuf::ServerStatistics serverStats;
     tabletManager.getStatistics(&serverStats);
+    objectManager.getStatistics(&serverStats);
+    indexletManager.getStatistics(&serverStats, &masterTableMetadata);
     SpinLock::getStatistics(serverStats.mutable_spin_lock_stats());
     respHdr->serverStatsLength = serializeToResponse(
             rpc->replyPayload, &serverStats);
@@ -866,6 +1073,48 @@ MasterService::insertIndexEntry(
             indexKeyStr, reqHdr->indexKeyLength, reqHdr->primaryKeyHash);
 }
 
+/**
+ * Top-level server method to handle the INSERT_INDEX_ENTRIES request;
+ * As an index server, this function inserts a batch of entries, sorted by
+ * index key, into an index. The RPC requesting this is typically initiated
+ * by a data master building an index over its existing objects.
+ */
+void
+MasterService::insertIndexEntries(
+        const WireFormat::InsertIndexEntries::Request* reqHdr,
+        WireFormat::InsertIndexEntries::Response* respHdr,
+        Rpc* rpc)
+{
+    std::vector<BtreeEntry> entries;
+    entries.reserve(reqHdr->numEntries);
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    for (uint32_t i = 0; i < reqHdr->numEntries; i++) {
+        const WireFormat::InsertIndexEntries::Entry* entry =
+                rpc->requestPayload->getOffset<
+                        WireFormat::InsertIndexEntries::Entry>(reqOffset);
+        if (entry == NULL) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            rpc->sendReply();
+            return;
+        }
+        reqOffset += sizeof32(*entry);
+        const void* indexKeyStr = rpc->requestPayload->getRange(
+                reqOffset, entry->indexKeyLength);
+        if (indexKeyStr == NULL) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            rpc->sendReply();
+            return;
+        }
+        reqOffset += entry->indexKeyLength;
+        entries.emplace_back(indexKeyStr, entry->indexKeyLength,
+                entry->primaryKeyHash);
+    }
+
+    respHdr->common.status = indexletManager.insertEntries(
+            reqHdr->tableId, reqHdr->indexId, entries,
+            &respHdr->numInserted);
+}
+
 /**
  * RPC handler for IS_REPLICA_NEEDED; indicates to backup servers whether
  * a replica for a particular segment that this master generated is needed
@@ -1220,7 +1469,7 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
 
     // Ensure that the ObjectManager never returns objects from this deleted
     // tablet again.
-    objectManager.removeOrphanedObjects();
+    objectManager.removeOrphanedObjects(tableId, firstKeyHash, lastKeyHash);
 
     // Removed unnecessary prepared transaction operations.
     transactionManager.removeOrphanedOps();
@@ -1362,6 +1611,18 @@ MasterService::multiRead(const WireFormat::MultiOp::Request* reqHdr,
     respHdr->count = numRequests;
     uint32_t oldResponseLength = rpc->replyPayload->size();
 
+    // Requests are parsed in groups of ObjectManager::READ_PREFETCH_BATCH so
+    // that the objects in each group can be prefetched before any of them
+    // are read. These hold the current group; slot i % READ_PREFETCH_BATCH
+    // holds request i.
+    const uint32_t batchSize = ObjectManager::READ_PREFETCH_BATCH;
+    const WireFormat::MultiOp::Request::ReadPart* parts[batchSize];
+    Tub<Key> keys[batchSize];
+
+    // Index of the first request that could not be parsed (numRequests if
+    // there is no such request).
+    uint32_t badRequest = numRequests;
+
     // Each iteration extracts one request from request rpc, finds the
     // corresponding object, and appends the response to the response rpc.
     for (uint32_t i = 0; ; i++) {
@@ -1384,21 +1645,36 @@ MasterService::multiRead(const WireFormat::MultiOp::Request* reqHdr,
             break;
         }
 
-        const WireFormat::MultiOp::Request::ReadPart *currentReq =
-                rpc->requestPayload->getOffset<
-                WireFormat::MultiOp::Request::ReadPart>(reqOffset);
-        reqOffset += sizeof32(WireFormat::MultiOp::Request::ReadPart);
-
-        const void* stringKey = rpc->requestPayload->getRange(
-                reqOffset, currentReq->keyLength);
-        reqOffset += currentReq->keyLength;
+        if (i % batchSize == 0) {
+            KeyHash keyHashes[batchSize];
+            uint32_t n = 0;
+            for (; n < batchSize && i + n < numRequests; n++) {
+                parts[n] = rpc->requestPayload->getOffset<
+                        WireFormat::MultiOp::Request::ReadPart>(reqOffset);
+                reqOffset += sizeof32(WireFormat::MultiOp::Request::ReadPart);
+                const void* stringKey = (parts[n] == NULL) ? NULL :
+                        rpc->requestPayload->getRange(reqOffset,
+                                                      parts[n]->keyLength);
+                if (stringKey == NULL) {
+                    badRequest = i + n;
+                    break;
+                }
+                reqOffset += parts[n]->keyLength;
+                keys[n].construct(parts[n]->tableId, stringKey,
+                                  parts[n]->keyLength);
+                keyHashes[n] = keys[n]->getHash();
+            }
+            objectManager.prefetchObjects(keyHashes, n);
+        }
 
-        if (stringKey == NULL) {
+        if (i == badRequest) {
             respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
             break;
         }
 
-        Key key(currentReq->tableId, stringKey, currentReq->keyLength);
+        const WireFormat::MultiOp::Request::ReadPart *currentReq =
+                parts[i % batchSize];
+        Key& key = *keys[i % batchSize];
 
         WireFormat::MultiOp::Response::ReadPart* currentResp =
                rpc->replyPayload->emplaceAppend<
@@ -2178,6 +2454,13 @@ MasterService::migrateSingleIndexObject(
         // also send a tombstone, which will allow the object to be filtered at
         // the destination.
 
+        // Changes logged as leaf deltas needn't be sent: they've been
+        // folded into whole leaves (see splitAndMigrateIndexlet).
+        if (!IndexBtree::isNodeKey(indexNodeKey.getStringKeyLength())) {
+            LOG(DEBUG, "Found leaf delta. Continuing to the next.");
+            return 0;
+        }
+
         Object object(logEntryBuffer);
         Buffer nodeObjectValue;
         object.appendValueToBuffer(&nodeObjectValue);
@@ -2355,6 +2638,11 @@ MasterService::splitAndMigrateIndexlet(
 
         // Wait for the remainder of already running writes to finish.
         LogProtector::wait(context, Transport::ServerRpc::APPEND_ACTIVITY);
+
+        // Each object is sent or not according to its contents, so a leaf
+        // whose latest changes are logged as deltas must be written whole
+        // first. This appends to the log, to be scanned in phase 3.
+        indexletManager.foldLeafDeltas(currentBackingTableId);
     }
 
     // Phase 3: finish iterating over the remaining log entries.
@@ -2828,6 +3116,111 @@ MasterService::txHintFailed(
     txRecoveryManager.handleTxHintFailed(rpc->requestPayload);
 }
 
+/**
+ * Helper for txPrepare and txPrepareOnePhase: extracts the next operation
+ * from a TX_PREPARE request.
+ *
+ * \param requestPayload
+ *      Buffer holding the request.
+ * \param[in,out] reqOffset
+ *      Offset of the operation in requestPayload. On return it refers to
+ *      the next operation.
+ * \param txId
+ *      Identifies the transaction the operation belongs to.
+ * \param[out] op
+ *      The operation is constructed here. Its object has no valid version
+ *      or timestamp.
+ * \param[out] keyBuffer
+ *      Holds the key of an operation that carries no value; it must outlive
+ *      op.
+ * \param[out] rejectRules
+ *      The reject rules of the operation are copied here.
+ * \return
+ *      STATUS_OK, or STATUS_REQUEST_FORMAT_ERROR if the request is malformed.
+ */
+static Status
+parseTxPrepareOp(Buffer* requestPayload, uint32_t* reqOffset,
+        TransactionId txId, Tub<PreparedOp>* op, Buffer* keyBuffer,
+        RejectRules* rejectRules)
+{
+    const WireFormat::TxPrepare::OpType *type =
+            requestPayload->getOffset<WireFormat::TxPrepare::OpType>(
+            *reqOffset);
+    if (type == NULL)
+        return STATUS_REQUEST_FORMAT_ERROR;
+
+    if (*type == WireFormat::TxPrepare::WRITE) {
+        const WireFormat::TxPrepare::Request::WriteOp *currentReq =
+                requestPayload->getOffset<
+                WireFormat::TxPrepare::Request::WriteOp>(*reqOffset);
+
+        *reqOffset += sizeof32(WireFormat::TxPrepare::Request::WriteOp);
+
+        if (currentReq == NULL || requestPayload->size() <
+                                  *reqOffset + currentReq->length) {
+            return STATUS_REQUEST_FORMAT_ERROR;
+        }
+        *rejectRules = currentReq->rejectRules;
+        op->construct(*type, txId.clientLeaseId, txId.clientTransactionId,
+                      currentReq->rpcId,
+                      currentReq->tableId, 0, 0,
+                      *requestPayload, *reqOffset,
+                      currentReq->length);
+
+        *reqOffset += currentReq->length;
+        return STATUS_OK;
+    }
+
+    // The other operations carry just a key.
+    uint64_t tableId, rpcId;
+    uint16_t keyLength;
+    if (*type == WireFormat::TxPrepare::READ ||
+            *type == WireFormat::TxPrepare::READONLY) {
+        const WireFormat::TxPrepare::Request::ReadOp *currentReq =
+                requestPayload->getOffset<
+                WireFormat::TxPrepare::Request::ReadOp>(*reqOffset);
+
+        *reqOffset += sizeof32(WireFormat::TxPrepare::Request::ReadOp);
+
+        if (currentReq == NULL)
+            return STATUS_REQUEST_FORMAT_ERROR;
+        tableId = currentReq->tableId;
+        rpcId = currentReq->rpcId;
+        keyLength = currentReq->keyLength;
+        *rejectRules = currentReq->rejectRules;
+    } else if (*type == WireFormat::TxPrepare::REMOVE) {
+        const WireFormat::TxPrepare::Request::RemoveOp *currentReq =
+                requestPayload->getOffset<
+                WireFormat::TxPrepare::Request::RemoveOp>(*reqOffset);
+
+        *reqOffset += sizeof32(WireFormat::TxPrepare::Request::RemoveOp);
+
+        if (currentReq == NULL)
+            return STATUS_REQUEST_FORMAT_ERROR;
+        tableId = currentReq->tableId;
+        rpcId = currentReq->rpcId;
+        keyLength = currentReq->keyLength;
+        *rejectRules = currentReq->rejectRules;
+    } else {
+        return STATUS_REQUEST_FORMAT_ERROR;
+    }
+
+    if (requestPayload->size() < *reqOffset + keyLength)
+        return STATUS_REQUEST_FORMAT_ERROR;
+
+    keyBuffer->emplaceAppend<KeyCount>((unsigned char) 1);
+    keyBuffer->emplaceAppend<CumulativeKeyLength>(keyLength);
+    keyBuffer->appendExternal(requestPayload, *reqOffset, keyLength);
+
+    op->construct(*type, txId.clientLeaseId, txId.clientTransactionId,
+                  rpcId,
+                  tableId, 0, 0,
+                  *keyBuffer);
+
+    *reqOffset += keyLength;
+    return STATUS_OK;
+}
+
 /**
  * Top-level server method to handle the TX_PREPARE request.
  *
@@ -2863,6 +3256,20 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
         return;
     }
 
+    // If this request carries the whole transaction (so this is the only
+    // participant server) and the transaction isn't read-only, commit it in
+    // a single phase, as long as its log entries will fit in one segment
+    // and none of it has been prepared already.
+    const WireFormat::TxPrepare::OpType* firstType =
+            rpc->requestPayload->getOffset<WireFormat::TxPrepare::OpType>(
+            reqOffset);
+    if (reqHdr->opCount == participantCount && firstType != NULL &&
+            *firstType != WireFormat::TxPrepare::READONLY &&
+            rpc->requestPayload->size() <= config->segmentSize / 2 &&
+            txPrepareOnePhase(reqHdr, respHdr, rpc, reqOffset)) {
+        return;
+    }
+
     ParticipantList participantList(participants,
                                     participantCount,
                                     reqHdr->lease.leaseId,
@@ -2898,124 +3305,23 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
     // if possible, and appends a status and version to the response buffer.
     for (uint32_t i = 0; i < numRequests; i++) {
         Tub<PreparedOp> op;
-        uint64_t tableId, rpcId;
         RejectRules rejectRules;
 
         respHdr->common.status = STATUS_OK;
         respHdr->vote = WireFormat::TxPrepare::PREPARED;
 
         Buffer buffer;
-        const WireFormat::TxPrepare::OpType *type =
-                rpc->requestPayload->getOffset<
-                WireFormat::TxPrepare::OpType>(reqOffset);
-        if (*type == WireFormat::TxPrepare::READ) {
-            const WireFormat::TxPrepare::Request::ReadOp *currentReq =
-                    rpc->requestPayload->getOffset<
-                    WireFormat::TxPrepare::Request::ReadOp>(reqOffset);
-
-            reqOffset += sizeof32(WireFormat::TxPrepare::Request::ReadOp);
+        respHdr->common.status = parseTxPrepareOp(rpc->requestPayload,
+                &reqOffset, txId, &op, &buffer, &rejectRules);
+        if (respHdr->common.status != STATUS_OK) {
+            respHdr->vote = WireFormat::TxPrepare::ABORT;
+            break;
+        }
+        uint64_t tableId = op->object.getTableId();
+        uint64_t rpcId = op->header.rpcId;
 
-            if (currentReq == NULL || rpc->requestPayload->size() <
-                                      reqOffset + currentReq->keyLength) {
-                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-                respHdr->vote = WireFormat::TxPrepare::ABORT;
-                break;
-            }
-            tableId = currentReq->tableId;
-            rpcId = currentReq->rpcId;
-            rejectRules = currentReq->rejectRules;
-
-            buffer.emplaceAppend<KeyCount>((unsigned char) 1);
-            buffer.emplaceAppend<CumulativeKeyLength>(currentReq->keyLength);
-            buffer.appendExternal(rpc->requestPayload, reqOffset,
-                                  currentReq->keyLength);
-
-            op.construct(*type, txId.clientLeaseId, txId.clientTransactionId,
-                         rpcId,
-                         tableId, 0, 0,
-                         buffer);
-
-            reqOffset += currentReq->keyLength;
-        } else if (*type == WireFormat::TxPrepare::REMOVE) {
-            const WireFormat::TxPrepare::Request::RemoveOp *currentReq =
-                    rpc->requestPayload->getOffset<
-                    WireFormat::TxPrepare::Request::RemoveOp>(reqOffset);
-
-            reqOffset += sizeof32(WireFormat::TxPrepare::Request::RemoveOp);
-
-            if (currentReq == NULL || rpc->requestPayload->size() <
-                                      reqOffset + currentReq->keyLength) {
-                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-                respHdr->vote = WireFormat::TxPrepare::ABORT;
-                break;
-            }
-            tableId = currentReq->tableId;
-            rpcId = currentReq->rpcId;
-            rejectRules = currentReq->rejectRules;
-
-            buffer.emplaceAppend<KeyCount>((unsigned char) 1);
-            buffer.emplaceAppend<CumulativeKeyLength>(currentReq->keyLength);
-            buffer.appendExternal(rpc->requestPayload, reqOffset,
-                                  currentReq->keyLength);
-
-            op.construct(*type, txId.clientLeaseId, txId.clientTransactionId,
-                         rpcId,
-                         tableId, 0, 0,
-                         buffer);
-
-            reqOffset += currentReq->keyLength;
-        } else if (*type == WireFormat::TxPrepare::WRITE) {
-            const WireFormat::TxPrepare::Request::WriteOp *currentReq =
-                    rpc->requestPayload->getOffset<
-                    WireFormat::TxPrepare::Request::WriteOp>(reqOffset);
-
-            reqOffset += sizeof32(WireFormat::TxPrepare::Request::WriteOp);
-
-            if (currentReq == NULL || rpc->requestPayload->size() <
-                                      reqOffset + currentReq->length) {
-                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-                respHdr->vote = WireFormat::TxPrepare::ABORT;
-                break;
-            }
-            tableId = currentReq->tableId;
-            rpcId = currentReq->rpcId;
-            rejectRules = currentReq->rejectRules;
-            op.construct(*type, txId.clientLeaseId, txId.clientTransactionId,
-                         rpcId,
-                         tableId, 0, 0,
-                         *(rpc->requestPayload), reqOffset,
-                         currentReq->length);
-
-            reqOffset += currentReq->length;
-        } else if (*type == WireFormat::TxPrepare::READONLY) {
+        if (op->header.type == WireFormat::TxPrepare::READONLY) {
             numReadOnly++;
-            const WireFormat::TxPrepare::Request::ReadOp *currentReq =
-                    rpc->requestPayload->getOffset<
-                    WireFormat::TxPrepare::Request::ReadOp>(reqOffset);
-
-            reqOffset += sizeof32(WireFormat::TxPrepare::Request::ReadOp);
-
-            if (currentReq == NULL || rpc->requestPayload->size() <
-                                      reqOffset + currentReq->keyLength) {
-                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-                respHdr->vote = WireFormat::TxPrepare::ABORT;
-                break;
-            }
-            tableId = currentReq->tableId;
-            rpcId = currentReq->rpcId;
-            rejectRules = currentReq->rejectRules;
-
-            buffer.emplaceAppend<KeyCount>((unsigned char) 1);
-            buffer.emplaceAppend<CumulativeKeyLength>(currentReq->keyLength);
-            buffer.appendExternal(rpc->requestPayload, reqOffset,
-                                  currentReq->keyLength);
-
-            op.construct(*type, txId.clientLeaseId, txId.clientTransactionId,
-                         rpcId,
-                         tableId, 0, 0,
-                         buffer);
-
-            reqOffset += currentReq->keyLength;
 
             // Since we prepare not to write anything on log and sync with
             // backup and it is still safe without linearizability,
@@ -3029,9 +3335,6 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
             }
             respHdr->vote = WireFormat::TxPrepare::PREPARED;
             continue;
-        } else {
-            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-            break;
         }
 
         rpcHandles.emplace_back(&unackedRpcResults,
@@ -3044,7 +3347,10 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
             if (respHdr->vote == WireFormat::TxPrepare::PREPARED) {
                 continue;
             } else if (respHdr->vote == WireFormat::TxPrepare::ABORT ||
-                    respHdr->vote == WireFormat::TxPrepare::ABORT_REQUESTED) {
+                    respHdr->vote == WireFormat::TxPrepare::ABORT_REQUESTED ||
+                    respHdr->vote == WireFormat::TxPrepare::COMMITTED) {
+                // COMMITTED means this request was already handled by
+                // txPrepareOnePhase.
                 break;
             } else {
                 assert(false);
@@ -3144,6 +3450,121 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
     rpc->sendReply();
 }
 
+/**
+ * Helper for txPrepare: handles a TX_PREPARE request that carries a whole
+ * read-write transaction, all of whose objects are on this server. Rather
+ * than being registered and prepared (which logs a participant list and a
+ * PreparedOp per object, and arms a recovery timer), the transaction is
+ * committed or aborted right away by ObjectManager::commitTransaction, which
+ * logs just the new objects and tombstones plus an RpcResult per operation.
+ * The RpcResults keep the request linearizable: a retry gets the original
+ * vote back.
+ *
+ * \param reqHdr
+ *      Header from the incoming RPC request.
+ * \param[out] respHdr
+ *      Header for the response that will be returned to the client.
+ * \param[out] rpc
+ *      Complete information about the remote procedure call.
+ * \param reqOffset
+ *      Offset of the first operation in the request.
+ * \return
+ *      True if the request was handled. False if some of its operations
+ *      were already prepared by an earlier request of the same transaction
+ *      (which went through the normal prepare path); nothing has been done
+ *      and the caller must prepare the request as usual.
+ */
+bool
+MasterService::txPrepareOnePhase(const WireFormat::TxPrepare::Request* reqHdr,
+        WireFormat::TxPrepare::Response* respHdr,
+        Rpc* rpc, uint32_t reqOffset)
+{
+    uint32_t numOps = reqHdr->opCount;
+    TransactionId txId(reqHdr->lease.leaseId, reqHdr->clientTxId);
+
+    clusterClock.updateClock(ClusterTime(reqHdr->lease.timestamp));
+
+    // All of the RpcResults share this vote; commitTransaction sets it.
+    WireFormat::TxPrepare::Vote vote = WireFormat::TxPrepare::COMMITTED;
+
+    // log should be synced with backup before destruction of handles.
+    std::vector<UnackedRpcHandle> rpcHandles;
+    rpcHandles.reserve(numOps);
+    std::vector<ObjectManager::TransactionOp> ops(numOps);
+    UnackedRpcHandle* duplicate = NULL;
+    for (uint32_t i = 0; i < numOps; i++) {
+        ObjectManager::TransactionOp& op = ops[i];
+        respHdr->common.status = parseTxPrepareOp(rpc->requestPayload,
+                &reqOffset, txId, &op.op, &op.keyBuffer, &op.rejectRules);
+        if (respHdr->common.status == STATUS_OK &&
+                op.op->header.type == WireFormat::TxPrepare::READONLY) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        }
+        if (respHdr->common.status != STATUS_OK) {
+            respHdr->vote = WireFormat::TxPrepare::ABORT;
+            rpc->sendReply();
+            return true;
+        }
+
+        uint64_t tableId = op.op->object.getTableId();
+        uint64_t rpcId = op.op->header.rpcId;
+        rpcHandles.emplace_back(&unackedRpcResults,
+                                reqHdr->lease,
+                                rpcId,
+                                reqHdr->ackId);
+        if (rpcHandles.back().isDuplicate())
+            duplicate = &rpcHandles.back();
+
+        KeyLength keyLength;
+        const void* key = op.op->object.getKey(0, &keyLength);
+        op.rpcResult.construct(tableId,
+                Key::getHash(tableId, key, keyLength),
+                reqHdr->lease.leaseId, rpcId, reqHdr->ackId,
+                &vote, sizeof32(vote));
+    }
+
+    // The RpcResults of all the operations were logged together, so if
+    // any operation has been seen before, the whole request has. The
+    // exception is a PREPARED vote: that operation was prepared by txPrepare,
+    // which must then handle the rest of the transaction too.
+    if (duplicate != NULL) {
+        WireFormat::TxPrepare::Vote duplicateVote =
+                parsePrepRpcResult(duplicate->resultLoc());
+        if (duplicateVote == WireFormat::TxPrepare::PREPARED)
+            return false;
+        respHdr->vote = duplicateVote;
+        rpc->sendReply();
+        return true;
+    }
+
+    bool isCommitVote;
+    try {
+        respHdr->common.status = objectManager.commitTransaction(&ops[0],
+                numOps, &isCommitVote);
+    } catch (RetryException& e) {
+        objectManager.syncChanges();
+        throw;
+    }
+    if (respHdr->common.status != STATUS_OK) {
+        respHdr->vote = WireFormat::TxPrepare::ABORT;
+        rpc->sendReply();
+        return true;
+    }
+
+    for (uint32_t i = 0; i < numOps; i++)
+        rpcHandles[i].recordCompletion(ops[i].rpcResultPtr);
+    respHdr->vote = isCommitVote ? WireFormat::TxPrepare::COMMITTED
+                                 : WireFormat::TxPrepare::ABORT;
+
+    // By design, our response will be shorter than the request. This ensures
+    // that the response can go back in a single RPC.
+    assert(rpc->replyPayload->size() <= Transport::MAX_RPC_LEN);
+
+    objectManager.syncChanges();
+    rpc->sendReply();
+    return true;
+}
+
 /**
  * Top-level server method to handle the WRITE request.
  *
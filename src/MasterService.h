@@ -63,6 +63,7 @@ class MasterService : public Service {
     virtual ~MasterService();
 
     void dispatch(WireFormat::Opcode opcode, Rpc* rpc);
+    void abandonInlineRpc();
 
     /*
      * The following class is used to temporarily disable the servicing of
@@ -148,6 +149,9 @@ class MasterService : public Service {
 #endif
 
   PRIVATE:
+    void buildIndex(const WireFormat::BuildIndex::Request* reqHdr,
+                WireFormat::BuildIndex::Response* respHdr,
+                Rpc* rpc);
     void dropTabletOwnership(
                 const WireFormat::DropTabletOwnership::Request* reqHdr,
                 WireFormat::DropTabletOwnership::Response* respHdr,
@@ -195,6 +199,10 @@ class MasterService : public Service {
     void insertIndexEntry(const WireFormat::InsertIndexEntry::Request* reqHdr,
                 WireFormat::InsertIndexEntry::Response* respHdr,
                 Rpc* rpc);
+    void insertIndexEntries(
+                const WireFormat::InsertIndexEntries::Request* reqHdr,
+                WireFormat::InsertIndexEntries::Response* respHdr,
+                Rpc* rpc);
     void isReplicaNeeded(const WireFormat::IsReplicaNeeded::Request* reqHdr,
                 WireFormat::IsReplicaNeeded::Response* respHdr,
                 Rpc* rpc);
@@ -295,6 +303,10 @@ class MasterService : public Service {
                 const WireFormat::TxPrepare::Request* reqHdr,
                 WireFormat::TxPrepare::Response* respHdr,
                 Rpc* rpc);
+    bool txPrepareOnePhase(
+                const WireFormat::TxPrepare::Request* reqHdr,
+                WireFormat::TxPrepare::Response* respHdr,
+                Rpc* rpc, uint32_t reqOffset);
     void write(const WireFormat::Write::Request* reqHdr,
                 WireFormat::Write::Response* respHdr,
                 Rpc* rpc);
@@ -375,6 +387,15 @@ class MasterService : public Service {
      */
     uint32_t maxResponseRpcLen;
 
+    /**
+     * Once a BUILD_INDEX RPC has collected this many index entries, it
+     * stops scanning the tablet and leaves the rest to the next RPC.
+     * This bounds the memory and time taken by each RPC. Normally
+     * MAX_BUILD_INDEX_ENTRIES, but can be modified during tests.
+     */
+    uint32_t maxBuildIndexEntries;
+    static const uint32_t MAX_BUILD_INDEX_ENTRIES = 100000;
+
     /*
      * Used to identify tablets for which migration is underway.
      */
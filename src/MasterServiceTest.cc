@@ -623,6 +623,31 @@ TEST_F(MasterServiceTest, enumerate_mergeTablet) {
     EXPECT_EQ(0U, objects.size());
 }
 
+TEST_F(MasterServiceTest, enumerate_tableIndex) {
+    service->objectManager.tableIndexEnabled = true;
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    ramcloud->write(1, "1", 1, "ghijkl", 6);
+
+    // An object in another table on this master must not be returned.
+    service->tabletManager.addTablet(2, 0, ~0UL, TabletManager::NORMAL);
+    Key key(2, "2", 1);
+    Buffer buffer;
+    Object obj(key, "mnopqr", 6, 0, 0, buffer);
+    EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
+
+    Buffer iter, nextIter, finalIter, objects;
+    EnumerateTableRpc rpc(ramcloud.get(), 1, false, 0, iter, objects);
+    uint64_t nextTabletStartHash = rpc.wait(nextIter);
+    EXPECT_EQ(0U, nextTabletStartHash);
+    EXPECT_EQ(76U, objects.size());
+
+    EnumerateTableRpc rpc2(ramcloud.get(), 1, false, nextTabletStartHash,
+            nextIter, objects);
+    nextTabletStartHash = rpc2.wait(finalIter);
+    EXPECT_EQ(0U, nextTabletStartHash);
+    EXPECT_EQ(0U, objects.size());
+}
+
 TEST_F(MasterServiceTest, getHeadOfLog) {
     EXPECT_EQ(LogPosition(2, 88),
             MasterClient::getHeadOfLog(&context, masterServer->serverId));
@@ -1451,6 +1476,42 @@ TEST_F(MasterServiceTest, multiRead_basics) {
             value2.get()->getValue()), 9));
 }
 
+TEST_F(MasterServiceTest, multiRead_severalPrefetchBatches) {
+    // Enough objects that the request is processed in several groups (see
+    // ObjectManager::READ_PREFETCH_BATCH), including a partial one.
+    uint64_t tableId1 = ramcloud->createTable("table1");
+    const uint32_t numObjects = 2 * ObjectManager::READ_PREFETCH_BATCH + 3;
+    string keys[numObjects];
+    Tub<ObjectBuffer> values[numObjects];
+    Tub<MultiReadObject> objects[numObjects];
+    MultiReadObject* requests[numObjects];
+    for (uint32_t i = 0; i < numObjects; i++) {
+        keys[i] = format("%u", i);
+        uint16_t keyLength = downCast<uint16_t>(keys[i].size());
+        // Leave every fifth object unwritten.
+        if (i % 5 != 4) {
+            ramcloud->write(tableId1, keys[i].c_str(), keyLength,
+                            keys[i].c_str(), keyLength);
+        }
+        objects[i].construct(tableId1, keys[i].c_str(), keyLength,
+                             &values[i]);
+        requests[i] = objects[i].get();
+    }
+    ramcloud->multiRead(requests, numObjects);
+
+    for (uint32_t i = 0; i < numObjects; i++) {
+        if (i % 5 == 4) {
+            EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, objects[i]->status);
+            continue;
+        }
+        EXPECT_EQ(STATUS_OK, objects[i]->status);
+        uint32_t valueLength;
+        const char* value = reinterpret_cast<const char*>(
+                values[i]->getValue(&valueLength));
+        EXPECT_EQ(keys[i], string(value, valueLength));
+    }
+}
+
 TEST_F(MasterServiceTest, multiRead_bufferSizeExceeded) {
     uint64_t tableId1 = ramcloud->createTable("table1");
     service->maxResponseRpcLen = 78;
@@ -2608,12 +2669,14 @@ TEST_F(MasterServiceTest, splitAndMigrateIndexlet_moveData) {
             "( pKHash: 2581 keyLength: 4 key: abcd ). | "
             "migrateSingleIndexObject: Found entry that doesn't belong to the "
             "partition being migrated. Continuing to the next. | "
+            "migrateSingleIndexObject: Found leaf delta. "
+            "Continuing to the next. | "
             "isGreaterOrEqual: Checking leaf node entry  "
             "( pKHash: 9213 keyLength: 4 key: tuvw ). | "
             "migrateSingleIndexObject: Migrating an index entry. | "
             "splitAndMigrateIndexlet: Sending last migration segment | "
             "splitAndMigrateIndexlet: Sent 1 total objects, "
-            "1 total tombstones, 259 total bytes.",
+            "2 total tombstones, 307 total bytes.",
                     TestLog::get());
 }
 
@@ -2787,8 +2850,9 @@ TEST_F(MasterServiceTest, txDecision_markRecovered) {
 
     TransactionManager::TransactionRecord* transaction;
     {
-        TransactionManager::Lock lock(service->transactionManager.mutex);
         TransactionId txId(1, 10);
+        TransactionManager::Lock lock(
+                service->transactionManager.getTransactionShard(txId).mutex);
         transaction = service->transactionManager.getOrAddTransaction(txId,
                                                                       lock);
     }
@@ -2984,7 +3048,7 @@ TEST_F(MasterServiceTest, txDecision_abort) {
     EXPECT_EQ(STATUS_OK, respHdr.common.status);
 
     // 4. Check outcome of ABORT.
-    EXPECT_EQ(0U, service->transactionManager.items.size());
+    EXPECT_EQ(0U, service->transactionManager.getItemCount());
 
     // 5. check locks are released.
     EXPECT_FALSE(isObjectLocked(key1));
@@ -3142,7 +3206,7 @@ TEST_F(MasterServiceTest, txDecision_unknownTablet) {
     EXPECT_EQ(STATUS_UNKNOWN_TABLET, respHdr.common.status);
 
     // 4. Check outcome of ABORT. key1 is processed and key3 couldn't.
-    EXPECT_EQ(1U, service->transactionManager.items.size());
+    EXPECT_EQ(1U, service->transactionManager.getItemCount());
 
     // 5. check locks are released.
     EXPECT_FALSE(isObjectLocked(key1));
@@ -3251,12 +3315,13 @@ TEST_F(MasterServiceTest, txPrepare_basics) {
     EXPECT_EQ(TxPrepare::PREPARED, respHdr.vote);
 
     // 4. Check outcome of Prepare.
-    EXPECT_EQ(3U, service->transactionManager.items.size());
+    EXPECT_EQ(3U, service->transactionManager.getItemCount());
     EXPECT_TRUE(isObjectLocked(key1));
     EXPECT_TRUE(isObjectLocked(key2));
     EXPECT_TRUE(isObjectLocked(key3));
     {
-        TransactionManager::Lock lock(service->transactionManager.mutex);
+        TransactionManager::Lock lock(
+                service->transactionManager.getTransactionShard(txId).mutex);
         EXPECT_TRUE(service->transactionManager.getTransaction(txId,
                                                                lock) != NULL);
     }
@@ -3360,7 +3425,7 @@ TEST_F(MasterServiceTest, txPrepare_retriedPrepares) {
     EXPECT_EQ(TxPrepare::PREPARED, respHdr.vote);
 
     // 4. Check outcome of Prepare.
-    EXPECT_EQ(3U, service->transactionManager.items.size());
+    EXPECT_EQ(3U, service->transactionManager.getItemCount());
     EXPECT_TRUE(isObjectLocked(key1));
     EXPECT_TRUE(isObjectLocked(key2));
     EXPECT_TRUE(isObjectLocked(key3));
@@ -3370,7 +3435,7 @@ TEST_F(MasterServiceTest, txPrepare_retriedPrepares) {
     EXPECT_EQ(STATUS_OK, respHdr.common.status);
     EXPECT_EQ(TxPrepare::PREPARED, respHdr.vote);
 
-    EXPECT_EQ(3U, service->transactionManager.items.size());
+    EXPECT_EQ(3U, service->transactionManager.getItemCount());
     EXPECT_TRUE(isObjectLocked(key1));
     EXPECT_TRUE(isObjectLocked(key2));
     EXPECT_TRUE(isObjectLocked(key3));
@@ -3411,7 +3476,7 @@ TEST_F(MasterServiceTest, txPrepare_retriedPrepares) {
     EXPECT_EQ(STATUS_OK, respHdr.common.status);
     EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
 
-    EXPECT_EQ(3U, service->transactionManager.items.size());
+    EXPECT_EQ(3U, service->transactionManager.getItemCount());
     EXPECT_TRUE(isObjectLocked(key1));
     EXPECT_TRUE(isObjectLocked(key2));
     EXPECT_TRUE(isObjectLocked(key3));
@@ -3434,7 +3499,7 @@ TEST_F(MasterServiceTest, txPrepare_retriedPrepares) {
     EXPECT_EQ(STATUS_OK, respHdr.common.status);
     EXPECT_EQ(TxPrepare::PREPARED, respHdr.vote);
 
-    EXPECT_EQ(4U, service->transactionManager.items.size());
+    EXPECT_EQ(4U, service->transactionManager.getItemCount());
     EXPECT_TRUE(isObjectLocked(key1));
     EXPECT_TRUE(isObjectLocked(key2));
     EXPECT_TRUE(isObjectLocked(key3));
@@ -3537,7 +3602,7 @@ TEST_F(MasterServiceTest, txPrepare_singleRpcOptimization) {
     EXPECT_EQ(TxPrepare::COMMITTED, respHdr.vote);
 
     // 4. Check outcome of Prepare.
-    EXPECT_EQ(0U, service->transactionManager.items.size());
+    EXPECT_EQ(0U, service->transactionManager.getItemCount());
     EXPECT_FALSE(isObjectLocked(key1));
     EXPECT_FALSE(isObjectLocked(key2));
     EXPECT_FALSE(isObjectLocked(key3));
@@ -3559,6 +3624,149 @@ TEST_F(MasterServiceTest, txPrepare_singleRpcOptimization) {
                             value.size()));
 }
 
+TEST_F(MasterServiceTest, txPrepare_onePhaseRetried) {
+    ramcloud->write(1, "key1", 4, "item1", 5);
+    ramcloud->write(1, "key2", 4, "item2", 5);
+
+    // Fabricate a single-server TxPrepare rpc with 2 WRITEs.
+    using WireFormat::TxParticipant;
+    using WireFormat::TxPrepare;
+    Key key1(1, "key1", 4);
+    Key key2(1, "key2", 4);
+
+    WireFormat::TxParticipant participants[2];
+    participants[0] = TxParticipant(key1.getTableId(), key1.getHash(), 10U);
+    participants[1] = TxParticipant(key2.getTableId(), key2.getHash(), 11U);
+
+    WireFormat::TxPrepare::Request reqHdr;
+    WireFormat::TxPrepare::Response respHdr;
+    Buffer reqBuffer, respBuffer;
+    Service::Rpc rpc(NULL, &reqBuffer, &respBuffer);
+
+    reqHdr.common.opcode = WireFormat::Opcode::TX_PREPARE;
+    reqHdr.common.service = WireFormat::MASTER_SERVICE;
+    reqHdr.lease = {1, 10, 5};
+    reqHdr.clientTxId = 9;
+    reqHdr.ackId = 8;
+    reqHdr.participantCount = 2;
+    reqHdr.opCount = 2;
+    reqBuffer.appendCopy(&reqHdr, sizeof32(reqHdr));
+    reqBuffer.appendExternal(participants, sizeof32(TxParticipant) * 2);
+
+    RejectRules rejectRules;
+    rejectRules = {1UL, false, false, false, true};
+    Buffer keysAndValueBuf1, keysAndValueBuf2;
+    Object::appendKeysAndValueToBuffer(key1, "new1", 4, &keysAndValueBuf1);
+    TxPrepare::Request::WriteOp op1(key1.getTableId(), 10,
+                                    keysAndValueBuf1.size(), rejectRules);
+    reqBuffer.appendExternal(&op1, sizeof32(op1));
+    reqBuffer.appendExternal(&keysAndValueBuf1);
+    rejectRules = {2UL, false, false, false, true};
+    Object::appendKeysAndValueToBuffer(key2, "new2", 4, &keysAndValueBuf2);
+    TxPrepare::Request::WriteOp op2(key2.getTableId(), 11,
+                                    keysAndValueBuf2.size(), rejectRules);
+    reqBuffer.appendExternal(&op2, sizeof32(op2));
+    reqBuffer.appendExternal(&keysAndValueBuf2);
+
+    service->txPrepare(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::COMMITTED, respHdr.vote);
+
+    // The transaction was neither registered nor prepared.
+    EXPECT_EQ(0U, service->transactionManager.getItemCount());
+    {
+        TransactionId txId(1U, 9U);
+        TransactionManager::Lock lock(
+                service->transactionManager.getTransactionShard(txId).mutex);
+        EXPECT_TRUE(service->transactionManager.getTransaction(
+                txId, lock) == NULL);
+    }
+    EXPECT_FALSE(isObjectLocked(key1));
+    EXPECT_FALSE(isObjectLocked(key2));
+    EXPECT_TRUE(service->unackedRpcResults.hasRecord(1U, 10U));
+    EXPECT_TRUE(service->unackedRpcResults.hasRecord(1U, 11U));
+
+    // A retry gets the original vote back without executing again.
+    Buffer respBuffer2;
+    Service::Rpc rpc2(NULL, &reqBuffer, &respBuffer2);
+    respHdr.vote = TxPrepare::PREPARED;
+    service->txPrepare(&reqHdr, &respHdr, &rpc2);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::COMMITTED, respHdr.vote);
+
+    Buffer value;
+    uint64_t version;
+    ramcloud->read(1, "key1", 4, &value, NULL, &version);
+    EXPECT_EQ(2U, version);
+    EXPECT_EQ("new1", TestUtil::toString(&value));
+    value.reset();
+    ramcloud->read(1, "key2", 4, &value, NULL, &version);
+    EXPECT_EQ(3U, version);
+    EXPECT_EQ("new2", TestUtil::toString(&value));
+}
+
+TEST_F(MasterServiceTest, txPrepare_onePhaseAbort) {
+    ramcloud->write(1, "key1", 4, "item1", 5);
+    ramcloud->write(1, "key2", 4, "item2", 5);
+
+    // Fabricate a single-server TxPrepare rpc whose READ will be rejected.
+    using WireFormat::TxParticipant;
+    using WireFormat::TxPrepare;
+    Key key1(1, "key1", 4);
+    Key key2(1, "key2", 4);
+
+    WireFormat::TxParticipant participants[2];
+    participants[0] = TxParticipant(key1.getTableId(), key1.getHash(), 10U);
+    participants[1] = TxParticipant(key2.getTableId(), key2.getHash(), 11U);
+
+    WireFormat::TxPrepare::Request reqHdr;
+    WireFormat::TxPrepare::Response respHdr;
+    Buffer reqBuffer, respBuffer;
+    Service::Rpc rpc(NULL, &reqBuffer, &respBuffer);
+
+    reqHdr.common.opcode = WireFormat::Opcode::TX_PREPARE;
+    reqHdr.common.service = WireFormat::MASTER_SERVICE;
+    reqHdr.lease = {1, 10, 5};
+    reqHdr.clientTxId = 9;
+    reqHdr.ackId = 8;
+    reqHdr.participantCount = 2;
+    reqHdr.opCount = 2;
+    reqBuffer.appendCopy(&reqHdr, sizeof32(reqHdr));
+    reqBuffer.appendExternal(participants, sizeof32(TxParticipant) * 2);
+
+    RejectRules rejectRules;
+    rejectRules = {1UL, false, false, false, true};
+    Buffer keysAndValueBuf;
+    Object::appendKeysAndValueToBuffer(key1, "new1", 4, &keysAndValueBuf);
+    TxPrepare::Request::WriteOp op1(key1.getTableId(), 10,
+                                    keysAndValueBuf.size(), rejectRules);
+    reqBuffer.appendExternal(&op1, sizeof32(op1));
+    reqBuffer.appendExternal(&keysAndValueBuf);
+    rejectRules = {5UL, false, false, false, true};
+    TxPrepare::Request::ReadOp op2(key2.getTableId(), 11,
+                                   key2.getStringKeyLength(), rejectRules);
+    reqBuffer.appendExternal(&op2, sizeof32(op2));
+    reqBuffer.appendExternal(key2.getStringKey(), key2.getStringKeyLength());
+
+    service->txPrepare(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
+    EXPECT_EQ(0U, service->transactionManager.getItemCount());
+    EXPECT_FALSE(isObjectLocked(key1));
+
+    // The abort is recorded, so a retry gets the same answer.
+    Buffer respBuffer2;
+    Service::Rpc rpc2(NULL, &reqBuffer, &respBuffer2);
+    service->txPrepare(&reqHdr, &respHdr, &rpc2);
+    EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
+
+    Buffer value;
+    uint64_t version;
+    ramcloud->read(1, "key1", 4, &value, NULL, &version);
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ("item1", TestUtil::toString(&value));
+}
+
 TEST_F(MasterServiceTest, txPrepare_readOnly) {
     // 1. Test setup: Add objects to be used during experiment.
     uint64_t version;
@@ -3658,7 +3866,7 @@ TEST_F(MasterServiceTest, txPrepare_readOnly) {
     EXPECT_EQ(TxPrepare::PREPARED, respHdr.vote);
 
     // 4. Check outcome of Prepare.
-    EXPECT_EQ(0U, service->transactionManager.items.size());
+    EXPECT_EQ(0U, service->transactionManager.getItemCount());
     EXPECT_FALSE(isObjectLocked(key1));
     EXPECT_FALSE(isObjectLocked(key2));
     EXPECT_FALSE(isObjectLocked(key3));
@@ -3792,7 +4000,7 @@ TEST_F(MasterServiceTest, txPrepare_readOnly_failByLock) {
     EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
 
     // 4. Check outcome of Prepare.
-    EXPECT_EQ(1U, service->transactionManager.items.size());
+    EXPECT_EQ(1U, service->transactionManager.getItemCount());
     EXPECT_FALSE(isObjectLocked(key1));
     EXPECT_TRUE(isObjectLocked(key2));
     EXPECT_FALSE(isObjectLocked(key3));
@@ -3897,7 +4105,7 @@ TEST_F(MasterServiceTest, txPrepare_readOnly_failByVer) {
     EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
 
     // 4. Check outcome of Prepare.
-    EXPECT_EQ(0U, service->transactionManager.items.size());
+    EXPECT_EQ(0U, service->transactionManager.getItemCount());
     EXPECT_FALSE(isObjectLocked(key1));
     EXPECT_FALSE(isObjectLocked(key2));
     EXPECT_FALSE(isObjectLocked(key3));
@@ -35,6 +35,7 @@ MockExternalStorage::MockExternalStorage(bool generateLog)
     , getChildrenNames()
     , getChildrenValues()
     , setData()
+    , writeRoundTrips(0)
 {}
 
 /**
@@ -117,6 +118,30 @@ MockExternalStorage::set(Hint flavor, const char* name, const char* value,
     }
     setData.assign(value, (valueLength < 0) ? strlen(value)
             : downCast<size_t>(valueLength));
+    writeRoundTrips++;
+}
+
+// See documentation for ExternalStorage::setMulti.
+void
+MockExternalStorage::setMulti(const vector<Write>& writes)
+{
+    Lock lock(mutex);
+    if (generateLog) {
+        string names;
+        for (const Write& write : writes) {
+            if (!names.empty()) {
+                names.append(", ");
+            }
+            names.append(format("%s %s",
+                    (write.flavor == Hint::CREATE) ? "CREATE" : "UPDATE",
+                    write.name.c_str()));
+        }
+        logAppend(lock, format("setMulti(%s)", names.c_str()));
+    }
+    if (!writes.empty()) {
+        setData = writes.back().value;
+    }
+    writeRoundTrips++;
 }
 
 /**
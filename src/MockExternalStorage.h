@@ -40,6 +40,7 @@ class MockExternalStorage: public ExternalStorage {
     virtual void remove(const char* name);
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1);
+    virtual void setMulti(const vector<Write>& writes);
 
     /**
      * This method treats the most recent value from a "set" call as a
@@ -87,9 +88,14 @@ class MockExternalStorage: public ExternalStorage {
     std::queue<std::string> getChildrenNames;
     std::queue<std::string> getChildrenValues;
 
-    /// Holds the data from the last call to "set".
+    /// Holds the data from the last call to "set" (or the last write
+    /// in the last call to "setMulti").
     std::string setData;
 
+    /// Number of calls to "set" and "setMulti"; each of these would
+    /// require one round trip to a real storage system.
+    uint64_t writeRoundTrips;
+
     void logAppend(Lock& lock, const std::string& record);
 
     DISALLOW_COPY_AND_ASSIGN(MockExternalStorage);
@@ -99,6 +99,16 @@ TEST_F(MockExternalStorageTest, set) {
     EXPECT_EQ("99", storage.setData);
 }
 
+TEST_F(MockExternalStorageTest, setMulti) {
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::CREATE, "/a", "xyzzy", 5);
+    writes.emplace_back(ExternalStorage::UPDATE, "/b", "99", 2);
+    storage.setMulti(writes);
+    EXPECT_EQ("setMulti(CREATE /a, UPDATE /b)", storage.log);
+    EXPECT_EQ("99", storage.setData);
+    EXPECT_EQ(1u, storage.writeRoundTrips);
+}
+
 TEST_F(MockExternalStorageTest, logAppend) {
     MockExternalStorage::Lock lock(storage.mutex);
     storage.logAppend(lock, "x y z");
@@ -43,6 +43,7 @@ class MockSyscall : public Syscall {
                     ioctlRetriesToSuccess(0), listenErrno(0), pipeErrno(0),
                     recvErrno(0), recvEof(false), recvfromErrno(0),
                     recvfromEof(false), recvmmsgErrno(0),
+                    sendmmsgErrno(0), sendmmsgReturnCount(-1),
                     sendmsgErrno(0), sendmsgReturnCount(-1),
                     sendtoErrno(0), sendtoReturnCount(-1), setsockoptErrno(0),
                     socketErrno(0), writeErrno(0) {}
@@ -255,6 +256,22 @@ class MockSyscall : public Syscall {
 
     }
 
+    int sendmmsgErrno;
+    int sendmmsgReturnCount;
+    int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+            int flags) {
+        if (sendmmsgErrno != 0) {
+            errno = sendmmsgErrno;
+            return -1;
+        } else if (sendmmsgReturnCount >= 0) {
+            // Simulates sending only some of the messages.
+            int count = sendmmsgReturnCount;
+            sendmmsgReturnCount = -1;
+            return ::sendmmsg(sockfd, msgvec, count, flags);
+        }
+        return ::sendmmsg(sockfd, msgvec, vlen, flags);
+    }
+
     int sendmsgErrno;
     int sendmsgReturnCount;
     ssize_t sendmsg(int sockfd, const msghdr *msg, int flags) {
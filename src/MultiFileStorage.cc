@@ -76,6 +76,9 @@ MultiFileStorage::Frame::Frame(MultiFileStorage* storage, size_t frameIndex)
     , masterId()
     , segmentId(0)
     , buffer(NULL, storage->bufferDeleter)
+    , loadingBuffer(NULL)
+    , loadedLength(0)
+    , streamingLoad(false)
     , isOpen(false)
     , isClosed(false)
     , sync(false)
@@ -212,14 +215,20 @@ MultiFileStorage::Frame::getMetadata()
  *
  * After this call the start of new appends to this frame are rejected until
  * this frame is recycled for use with another replica (via open()).
+ *
+ * \param streaming
+ *      True means the caller will use getLoadedPrefix() to work on the
+ *      replica while it is loading, so it is read in rounds of
+ *      LOAD_CHUNK_SIZE. Otherwise the whole replica is read at once.
  */
 void
-MultiFileStorage::Frame::startLoading()
+MultiFileStorage::Frame::startLoading(bool streaming)
 {
     Lock lock(storage->mutex);
     if (loadRequested)
         return;
     loadRequested = true;
+    streamingLoad = streaming;
     if (buffer)
         return;
     schedule(lock, NORMAL);
@@ -236,6 +245,34 @@ MultiFileStorage::Frame::isLoaded()
     return loadRequested && buffer;
 }
 
+/**
+ * Return a pointer to the buffer the replica is being loaded into along
+ * with the number of bytes at its start that have already been read; see
+ * BackupStorage::Frame::getLoadedPrefix(). Like load(), no data is
+ * reported for a replica that is in memory but hasn't been flushed to
+ * storage yet, so recoveries only use durable data. Once the replica is
+ * being read from storage this doesn't take the storage mutex, so it is
+ * cheap to poll.
+ */
+const void*
+MultiFileStorage::Frame::getLoadedPrefix(size_t* loadedLength)
+{
+    // #loadedLength is reset before #loadingBuffer is set, so this never
+    // reports a stale length from an earlier load.
+    char* data = loadingBuffer.load();
+    if (data != NULL) {
+        *loadedLength = this->loadedLength.load();
+        return data;
+    }
+
+    Lock _(storage->mutex);
+    *loadedLength = 0;
+    if (!loadRequested || !buffer || !isSynced())
+        return NULL;
+    *loadedLength = storage->segmentSize;
+    return buffer.get();
+}
+
 /**
  * Return a pointer to the replica data for recovery. If needed, the replica is
  * loaded from storage into memory. If the replica is already in memory a load
@@ -274,6 +311,7 @@ MultiFileStorage::Frame::unload()
 {
     Lock lock(storage->mutex);
     assert(loadRequested);
+    loadingBuffer = NULL;
     buffer.reset();
     loadRequested = false;
 }
@@ -457,6 +495,7 @@ MultiFileStorage::Frame::free()
     // Must reset this before open(), because on startup after benchmark, the
     // frame may be loaded without open.
     loadRequested = false;
+    loadingBuffer = NULL;
 
     // Reset these to ensure we don't have a case where a freed frame still
     // appears to be !isSynced().
@@ -491,6 +530,7 @@ MultiFileStorage::Frame::reopen(size_t length)
     isOpen = true;
     isClosed = false;
     loadRequested = false;
+    loadingBuffer = NULL;
     if (!isWriteBuffer) {
         isWriteBuffer = true;
         storage->writeBuffersInUse++;
@@ -561,14 +601,74 @@ MultiFileStorage::Frame::open(bool sync, ServerId masterId, uint64_t segmentId)
  * \param usingDevNull
  *     If true, short reads will not be considered an error. If false, short
  *     reads cause the method to DIE.
+ * \param loadedLength
+ *     If non-NULL, the frame is read in rounds of LOAD_CHUNK_SIZE bytes per
+ *     framelet and this is updated after each round with the number of bytes
+ *     at the start of \a buf which have been read. If NULL, each framelet is
+ *     read with a single request.
  */
 void
 MultiFileStorage::unlockedRead(Frame::Lock& lock, void* buf, size_t frameIndex,
-                               bool usingDevNull)
+                               bool usingDevNull,
+                               std::atomic<size_t>* loadedLength)
 {
+    IoUring* ring = (ioEngine == IO_URING) ? getRing(lock) : NULL;
     lock.unlock();
     CycleCounter<RawMetric> _(&metrics->backup.storageReadTicks);
 
+    // The first framelet is the largest, so it determines the number of
+    // rounds; nobody looks at partial progress unless loadedLength is
+    // given, so otherwise a single round reads everything.
+    size_t chunkSize = loadedLength ? size_t(LOAD_CHUNK_SIZE)
+                                    : bytesInFramelet(0);
+    for (size_t chunkOffset = 0; chunkOffset < bytesInFramelet(0);
+         chunkOffset += chunkSize) {
+        if (ring) {
+            uringRead(ring, buf, frameIndex, chunkOffset, chunkSize,
+                      usingDevNull);
+        } else {
+            aioRead(buf, frameIndex, chunkOffset, chunkSize, usingDevNull);
+        }
+        if (loadedLength == NULL)
+            continue;
+
+        // Framelets are laid out one after another in #buf; the data read
+        // so far is contiguous up to the first framelet with bytes left.
+        size_t chunkEnd = chunkOffset + chunkSize;
+        size_t loaded = 0;
+        for (size_t fileIndex = 0; fileIndex < fds.size(); fileIndex++) {
+            size_t frameletSize = bytesInFramelet(fileIndex);
+            if (chunkEnd < frameletSize) {
+                loaded += chunkEnd;
+                break;
+            }
+            loaded += frameletSize;
+        }
+        loadedLength->store(loaded);
+    }
+
+    PerfStats::threadStats.backupReadActiveCycles += _.stop();
+    lock.lock();
+    if (ring)
+        idleRings.push_back(ring);
+}
+
+/**
+ * Read one round of a frame into memory using POSIX asynchronous IO: up to
+ * \a chunkSize bytes starting at \a chunkOffset within each framelet.
+ * See unlockedRead() for the other parameters. Must be called without
+ * holding #mutex.
+ *
+ * \param chunkOffset
+ *      Offset within each framelet of the bytes to read; a multiple of
+ *      \a chunkSize.
+ * \param chunkSize
+ *      Most bytes to read from each framelet; a multiple of BLOCK_SIZE.
+ */
+void
+MultiFileStorage::aioRead(void* buf, size_t frameIndex, size_t chunkOffset,
+                          size_t chunkSize, bool usingDevNull)
+{
     // Use asynchronous IO to initiate concurrent IO operations on all of the
     // storage files to read the replica in parallel.
     // Keep one control block for each file.
@@ -578,17 +678,22 @@ MultiFileStorage::unlockedRead(Frame::Lock& lock, void* buf, size_t frameIndex,
     size_t frameletStart = offsetOfFramelet(frameIndex);
     for (size_t fileIndex = 0; fileIndex < fds.size(); fileIndex++) {
         size_t frameletSize = bytesInFramelet(fileIndex);
+        if (chunkOffset >= frameletSize)
+            continue;
         struct aiocb* cb = &cbs[fileIndex];
         cb->aio_fildes = fds[fileIndex];
-        cb->aio_offset = frameletStart;
-        cb->aio_buf = static_cast<char*>(buf) + (frameletSize * fileIndex);
-        cb->aio_nbytes = frameletSize;
+        cb->aio_offset = frameletStart + chunkOffset;
+        cb->aio_buf = static_cast<char*>(buf) + (frameletSize * fileIndex) +
+                      chunkOffset;
+        cb->aio_nbytes = std::min(frameletSize - chunkOffset, chunkSize);
         aio_read(cb);
     }
 
     // Wait for all of the IO operations to complete.
     for (size_t i = 0; i < fds.size(); i++) {
         struct aiocb* cb = &cbs[i];
+        if (cb->aio_nbytes == 0)
+            continue;
         aio_suspend(&cb, 1, NULL);
         ssize_t r = aio_return(cb);
         if (r == -1) {
@@ -607,9 +712,56 @@ MultiFileStorage::unlockedRead(Frame::Lock& lock, void* buf, size_t frameIndex,
                 assert(aio_error(cb) == 0);
         }
     }
+}
 
-    PerfStats::threadStats.backupReadActiveCycles += _.stop();
-    lock.lock();
+/**
+ * Read one round of a frame into memory using io_uring; see aioRead() and
+ * unlockedRead() for parameter details. The reads from all of the
+ * framelets are submitted to the kernel with a single system call. Must be
+ * called without holding #mutex.
+ *
+ * \param ring
+ *      Ring obtained from getRing() for the exclusive use of this call.
+ */
+void
+MultiFileStorage::uringRead(IoUring* ring, void* buf, size_t frameIndex,
+                            size_t chunkOffset, size_t chunkSize,
+                            bool usingDevNull)
+{
+    size_t frameletStart = offsetOfFramelet(frameIndex);
+    for (size_t fileIndex = 0; fileIndex < fds.size(); fileIndex++) {
+        size_t frameletSize = bytesInFramelet(fileIndex);
+        if (chunkOffset >= frameletSize)
+            continue;
+        size_t readSize = std::min(frameletSize - chunkOffset, chunkSize);
+        char* chunkBuf = static_cast<char*>(buf) +
+                         (frameletSize * fileIndex) + chunkOffset;
+        ring->prepareRead(fds[fileIndex], chunkBuf,
+                          downCast<uint32_t>(readSize),
+                          frameletStart + chunkOffset,
+                          registeredBufferIndex(chunkBuf, readSize),
+                          fileIndex);
+    }
+
+    uint32_t count = ring->pending();
+    IoUring::Completion completions[count];
+    ring->submitAndWait(completions);
+    for (uint32_t i = 0; i < count; i++) {
+        size_t fileIndex = completions[i].userData;
+        int32_t r = completions[i].result;
+        size_t readSize = std::min(bytesInFramelet(fileIndex) - chunkOffset,
+                                   chunkSize);
+        if (r < 0) {
+            DIE("Failed to read replica: %s, "
+                "reading %lu bytes from backup file %lu at offset %lu.",
+                strerror(-r), readSize, fileIndex,
+                frameletStart + chunkOffset);
+        } else if (static_cast<size_t>(r) != readSize && !usingDevNull) {
+            DIE("Failure performing asynchronous IO (short read: "
+                "wanted %lu, got %d at offset %lu in file %lu)",
+                readSize, r, frameletStart + chunkOffset, fileIndex);
+        }
+    }
 }
 
 /**
@@ -642,8 +794,45 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
 {
     uint64_t start = Cycles::rdtsc();
     CycleCounter<RawMetric> writeTicks(&metrics->backup.storageWriteTicks);
+    IoUring* ring = (ioEngine == IO_URING) ? getRing(lock) : NULL;
     lock.unlock();
 
+    if (ring) {
+        uringWrite(ring, buf, count, frameIndex, offsetInFrame,
+                   metadataBuf, metadataCount);
+        double elapsedSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+        if (elapsedSeconds > 0.1) {
+            LOG(WARNING, "Slow write to replica storage: %.1f ms "
+                    "for %lu bytes", elapsedSeconds*1e03, count);
+        }
+    } else {
+        aioWrite(buf, count, frameIndex, offsetInFrame,
+                 metadataBuf, metadataCount, start);
+    }
+
+    // Reduce our bandwidth (if so configured) by delaying this operation.
+    sleepToThrottleWrites(count + metadataCount, Cycles::rdtsc() - start);
+
+    uint64_t elapsed = Cycles::rdtsc() - start;
+    metrics->backup.storageWriteTicks += elapsed;
+    PerfStats::threadStats.backupWriteActiveCycles += elapsed;
+    lock.lock();
+    if (ring)
+        idleRings.push_back(ring);
+}
+
+/**
+ * Write to a frame using POSIX asynchronous IO; see unlockedWrite() for
+ * parameter details. Must be called without holding #mutex.
+ *
+ * \param start
+ *      Cycles::rdtsc() when the write began; used to warn about slow IO.
+ */
+void
+MultiFileStorage::aioWrite(void* buf, size_t count, size_t frameIndex,
+                           off_t offsetInFrame, void* metadataBuf,
+                           size_t metadataCount, uint64_t start)
+{
     size_t remaining = count;
     off_t frameletStart = offsetOfFramelet(frameIndex);
     off_t offsetInFramelet = offsetInFrame;
@@ -723,14 +912,197 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
                     "for %lu bytes", i, elapsedSeconds*1e03, cb->aio_nbytes);
         }
     }
+}
 
-    // Reduce our bandwidth (if so configured) by delaying this operation.
-    sleepToThrottleWrites(count + metadataCount, Cycles::rdtsc() - start);
+/**
+ * Write to a frame using io_uring; see unlockedWrite() for parameter
+ * details. The framelet writes for every file and the metadata write are
+ * all submitted to the kernel with a single system call. If #syncWrites is
+ * set, the writes to each file are linked to an fdatasync of that file, so
+ * the data is durable when this method returns. Must be called without
+ * holding #mutex.
+ *
+ * \param ring
+ *      Ring obtained from getRing() for the exclusive use of this call.
+ */
+void
+MultiFileStorage::uringWrite(IoUring* ring, void* buf, size_t count,
+                             size_t frameIndex, off_t offsetInFrame,
+                             void* metadataBuf, size_t metadataCount)
+{
+    // One slot per file for its framelet write, one for metadata, and
+    // one per file for its sync.
+    const size_t metadataOp = fds.size();
+    const size_t firstSyncOp = fds.size() + 1;
+    size_t opLength[2 * fds.size() + 1];
+    off_t opOffset[2 * fds.size() + 1];
+    memset(opLength, 0, sizeof(opLength));
+    memset(opOffset, 0, sizeof(opOffset));
+
+    // Work out which part of the data goes to each file.
+    char* frameletBuf[fds.size()];
+    memset(frameletBuf, 0, sizeof(frameletBuf));
+    size_t remaining = count;
+    off_t frameletStart = offsetOfFramelet(frameIndex);
+    off_t offsetInFramelet = offsetInFrame;
+    for (size_t fileIndex = 0; remaining > 0; fileIndex++) {
+        size_t frameletSize = bytesInFramelet(fileIndex);
+        if (static_cast<size_t>(offsetInFramelet) > frameletSize) {
+            // The offset that we want to write is past this framelet.
+            offsetInFramelet -= frameletSize;
+            continue;
+        }
 
-    uint64_t elapsed = Cycles::rdtsc() - start;
-    metrics->backup.storageWriteTicks += elapsed;
-    PerfStats::threadStats.backupWriteActiveCycles += elapsed;
-    lock.lock();
+        size_t bytesToWrite = std::min(frameletSize - offsetInFramelet,
+                                       remaining);
+        frameletBuf[fileIndex] = static_cast<char*>(buf);
+        opOffset[fileIndex] = frameletStart + offsetInFramelet;
+        opLength[fileIndex] = bytesToWrite;
+
+        remaining -= bytesToWrite;
+        buf = static_cast<char*>(buf) + bytesToWrite;
+        offsetInFramelet = 0;
+    }
+    opOffset[metadataOp] = offsetOfFrameMetadata(frameIndex);
+    opLength[metadataOp] = metadataCount;
+
+    // Queue the writes for each file, followed (if needed) by a sync which
+    // is linked to them so that it only starts once they have finished.
+    for (size_t fileIndex = 0; fileIndex < fds.size(); fileIndex++) {
+        bool wroteFile = false;
+        if (opLength[fileIndex] > 0) {
+            ring->prepareWrite(fds[fileIndex], frameletBuf[fileIndex],
+                    downCast<uint32_t>(opLength[fileIndex]),
+                    opOffset[fileIndex],
+                    registeredBufferIndex(frameletBuf[fileIndex],
+                                          opLength[fileIndex]),
+                    fileIndex, syncWrites);
+            wroteFile = true;
+        }
+        if (fileIndex == 0) {
+            ring->prepareWrite(fds[0], metadataBuf,
+                    downCast<uint32_t>(metadataCount), opOffset[metadataOp],
+                    registeredBufferIndex(metadataBuf, metadataCount),
+                    metadataOp, syncWrites);
+            wroteFile = true;
+        }
+        if (syncWrites && wroteFile)
+            ring->prepareFsync(fds[fileIndex], firstSyncOp + fileIndex);
+    }
+
+    uint32_t opCount = ring->pending();
+    IoUring::Completion completions[opCount];
+    ring->submitAndWait(completions);
+    for (uint32_t i = 0; i < opCount; i++) {
+        size_t op = completions[i].userData;
+        int32_t r = completions[i].result;
+        if (op >= firstSyncOp) {
+            if (r < 0)
+                DIE("Failed to sync backup file %lu after writing replica: "
+                    "%s", op - firstSyncOp, strerror(-r));
+        } else if (r < 0) {
+            if (op == metadataOp)
+                DIE("Failed to write metadata for replica: %s, "
+                    "writing %lu bytes to backup file 0 at offset %lu.",
+                    strerror(-r), opLength[op], opOffset[op]);
+            else
+                DIE("Failed to write replica: %s, "
+                    "writing %lu bytes to backup file %lu at offset %lu.",
+                    strerror(-r), opLength[op], op, opOffset[op]);
+        } else if (static_cast<size_t>(r) != opLength[op]) {
+            if (op == metadataOp)
+                DIE("Unexpectedly short write to metadata for replica, "
+                    "file 0 at offset %lu, "
+                    "expected length %lu, actual write length %d",
+                    opOffset[op], opLength[op], r);
+            else
+                DIE("Unexpectedly short write to replica, "
+                    "file %lu at offset %lu, "
+                    "expected length %lu, actual write length %d",
+                    op, opOffset[op], opLength[op], r);
+        }
+    }
+}
+
+/**
+ * Return a ring for the exclusive use of the caller, creating one (and
+ * registering #registeredBuffers with it) if all existing rings are in use.
+ * The caller must return the ring to #idleRings while holding #mutex once it
+ * is done with it.
+ *
+ * \param lock
+ *      Lock on #mutex, which must be held.
+ */
+IoUring*
+MultiFileStorage::getRing(Frame::Lock& lock)
+{
+    if (!idleRings.empty()) {
+        IoUring* ring = idleRings.back();
+        idleRings.pop_back();
+        return ring;
+    }
+
+    // Enough entries for a write, its metadata, and a sync for every file.
+    rings.emplace_back(new IoUring(downCast<uint32_t>(2 * fds.size() + 1)));
+    IoUring* ring = rings.back().get();
+    if (!registeredBuffers.empty() &&
+        !ring->registerBuffers(&registeredBuffers[0],
+                               downCast<uint32_t>(registeredBuffers.size()))) {
+        RAMCLOUD_CLOG(WARNING, "Couldn't register replica buffers with "
+                "io_uring (check RLIMIT_MEMLOCK); IO will use unregistered "
+                "buffers");
+    }
+    return ring;
+}
+
+/**
+ * Return the index of the registered buffer which contains all of a given
+ * range of memory, or IoUring::UNREGISTERED if there isn't one.
+ *
+ * \param buf
+ *      Start of the range.
+ * \param length
+ *      Number of bytes in the range.
+ */
+int
+MultiFileStorage::registeredBufferIndex(const void* buf, size_t length) const
+{
+    const char* start = static_cast<const char*>(buf);
+    auto it = std::upper_bound(registeredBuffers.begin(),
+                               registeredBuffers.end(), start,
+            [](const char* p, const struct iovec& iov) {
+                return p < static_cast<const char*>(iov.iov_base);
+            });
+    if (it == registeredBuffers.begin())
+        return IoUring::UNREGISTERED;
+    --it;
+    const char* base = static_cast<const char*>(it->iov_base);
+    if (start + length > base + it->iov_len)
+        return IoUring::UNREGISTERED;
+    return downCast<int>(it - registeredBuffers.begin());
+}
+
+/**
+ * Record the buffers currently in the #buffers pool as the set to register
+ * with each io_uring instance, so the kernel doesn't have to pin and unpin
+ * their pages on every IO. Called once from the constructor.
+ */
+void
+MultiFileStorage::registerBuffers()
+{
+    std::vector<void*> pooled;
+    while (!buffers.empty()) {
+        pooled.push_back(buffers.top());
+        buffers.pop();
+    }
+    std::sort(pooled.begin(), pooled.end());
+    foreach (void* buffer, pooled) {
+        registeredBuffers.push_back({buffer, segmentSize + METADATA_SIZE});
+    }
+    std::reverse(pooled.begin(), pooled.end());
+    foreach (void* buffer, pooled) {
+        buffers.push(buffer);
+    }
 }
 
 namespace {
@@ -776,9 +1148,13 @@ MultiFileStorage::Frame::performRead(Lock& lock)
         metrics->backup.storageReadBytes += storage->segmentSize;
         ++PerfStats::threadStats.backupReadOps;
         PerfStats::threadStats.backupReadBytes += storage->segmentSize;
+        loadedLength = 0;
+        loadingBuffer = static_cast<char*>(buffer.get());
         // Lock released during this call; assume any field could have changed.
         storage->unlockedRead(lock, buffer.get(), frameIndex,
-                              storage->usingDevNull);
+                              storage->usingDevNull,
+                              streamingLoad ? &loadedLength : NULL);
+        loadedLength = storage->segmentSize;
     }
 
     assert(!this->buffer);
@@ -888,7 +1264,9 @@ void
 MultiFileStorage::BufferDeleter::operator()(void* buffer)
 {
     if (buffer) {
-        if (storage->buffers.size() >= MAX_POOLED_BUFFERS) {
+        if (storage->buffers.size() >= MAX_POOLED_BUFFERS &&
+            storage->registeredBufferIndex(buffer, 1) ==
+                IoUring::UNREGISTERED) {
             std::free(buffer);
         } else {
             storage->buffers.push(buffer);
@@ -920,13 +1298,17 @@ MultiFileStorage::BufferDeleter::operator()(void* buffer)
  * \param openFlags
  *      Extra flags for use while opening files in filePathsStr (default to 0,
  *      O_DIRECT may be used to disable the OS buffer cache.
+ * \param ioEngine
+ *      Kernel interface to use for replica IO. If IO_URING is requested but
+ *      isn't available, AIO is used instead.
  */
 MultiFileStorage::MultiFileStorage(size_t segmentSize,
                                    size_t frameCount,
                                    size_t writeRateLimit,
                                    size_t maxWriteBuffers,
                                    const char* filePathsStr,
-                                   int openFlags)
+                                   int openFlags,
+                                   IoEngine ioEngine)
     : BackupStorage(segmentSize, Type::DISK, writeRateLimit)
     , mutex()
     , ioQueue()
@@ -937,17 +1319,29 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
     , freeMap(frameCount)
     , lastAllocatedFrame(FreeMap::npos)
     , openFlags(openFlags)
+    , filePaths()
+    , ioEngine(ioEngine)
+    , syncWrites(false)
     , fds()
     , usingDevNull(filePathsStr != NULL && string(filePathsStr) == "/dev/null")
     , writeBuffersInUse(0)
     , maxWriteBuffers(maxWriteBuffers)
     , bufferDeleter(this)
     , buffers()
+    , registeredBuffers()
+    , rings()
+    , idleRings()
 {
     assert(filePathsStr);
 
     freeMap.set();
 
+    if (ioEngine == IO_URING && !IoUring::isSupported()) {
+        LOG(WARNING, "io_uring isn't available on this machine; backup "
+            "storage will use POSIX asynchronous IO instead");
+        this->ioEngine = AIO;
+    }
+
     // If we were given /dev/null (to take disk bandwidth out of the
     // equation during testing/benchmarking), don't supply the O_DIRECT
     // flag since it's not supported. Print an I-told-you-so while here.
@@ -957,6 +1351,14 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
             "know what you're doing!");
     }
 
+    // With io_uring, durability comes from fdatasyncs linked to each batch
+    // of writes rather than from making every write synchronous (there's
+    // nothing to sync for /dev/null, which rejects fdatasync anyway).
+    if (this->ioEngine == IO_URING && (openFlags & O_SYNC) && !usingDevNull) {
+        openFlags &= ~O_SYNC;
+        syncWrites = true;
+    }
+
     std::string filePathsCopy(filePathsStr);
     size_t filePathIndex = 0;
     bool doneParsing = false;
@@ -978,6 +1380,7 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
                        filePath.c_str()), e);
         }
         fds.push_back(fd);
+        filePaths.push_back(filePath);
 
         // If its a regular file reserve space, otherwise
         // assume its a device and we don't need to bother.
@@ -1010,6 +1413,8 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
         for (int i = 0; i < INIT_POOLED_BUFFERS; ++i)
             buffers.emplace_back(allocateBuffer());
     }
+    if (this->ioEngine == IO_URING)
+        registerBuffers();
 
     for (size_t frame = 0; frame < frameCount; ++frame)
         frames.emplace_back(this, frame);
@@ -1017,8 +1422,9 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
     ioQueue.start();
 
     LOG(NOTICE, "Backup storage opened with %lu bytes available; allocated %lu "
-            "frame(s) across %lu file(s) with %lu bytes per frame",
-            frameCount * segmentSize, frameCount, fds.size(), segmentSize);
+            "frame(s) across %lu file(s) with %lu bytes per frame using %s",
+            frameCount * segmentSize, frameCount, fds.size(), segmentSize,
+            ioEngineName(this->ioEngine));
 }
 
 /// Close the files.
@@ -1032,6 +1438,9 @@ MultiFileStorage::~MultiFileStorage()
             LOG(ERROR, "Couldn't close backup log");
     }
 
+    // Unregister buffers before they can be returned to the OS.
+    idleRings.clear();
+    rings.clear();
     while (!buffers.empty()) {
         std::free(buffers.top());
         buffers.pop();
@@ -1125,9 +1534,136 @@ MultiFileStorage::benchmark(BackupStrategy backupStrategy)
 {
     uint32_t r = BackupStorage::benchmark(backupStrategy);
     lastAllocatedFrame = FreeMap::npos;
+    benchmarkWrites();
     return r;
 }
 
+/**
+ * Log the write IOPS and bandwidth this storage achieves with each
+ * available IoEngine, for both small appends and whole replicas. The writes
+ * go through the normal write path (including syncs), but are directed at
+ * scratch files next to the storage files so that replicas left on storage
+ * by a previous backup aren't disturbed; the scratch files are removed
+ * afterwards. Skipped unless all of the storage files are regular files.
+ * Must not be called while any frames have IO outstanding.
+ */
+void
+MultiFileStorage::benchmarkWrites()
+{
+    if (usingDevNull)
+        return;
+    foreach (const string& path, filePaths) {
+        struct stat st;
+        if (stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+            LOG(NOTICE, "Skipping backup storage write benchmark; %s isn't "
+                "a regular file", path.c_str());
+            return;
+        }
+    }
+
+    // Number of writes of each size to time, and the frames they go to.
+    const uint32_t frameCount = 16;
+    const uint32_t smallWrites = 512;
+    const size_t smallWriteSize = std::min(size_t(8 * BLOCK_SIZE),
+                                           segmentSize);
+
+    const IoEngine savedEngine = ioEngine;
+    const bool savedSyncWrites = syncWrites;
+    std::vector<int> savedFds;
+    std::swap(fds, savedFds);
+
+    BufferPtr buffer(NULL, bufferDeleter);
+    {
+        Lock lock(mutex);
+        buffer = allocateBuffer();
+    }
+    memset(buffer.get(), 'w', segmentSize + METADATA_SIZE);
+    char* data = static_cast<char*>(buffer.get());
+    char* metadata = data + segmentSize;
+
+    for (IoEngine engine : {AIO, IO_URING}) {
+        if (engine == IO_URING && !IoUring::isSupported()) {
+            LOG(NOTICE, "Backup storage writes (%s): not available",
+                ioEngineName(engine));
+            continue;
+        }
+        int flags = openFlags;
+        ioEngine = engine;
+        syncWrites = false;
+        if (engine == IO_URING && (flags & O_SYNC)) {
+            flags &= ~O_SYNC;
+            syncWrites = true;
+        }
+        foreach (const string& path, filePaths) {
+            string scratchPath = path + ".benchmark";
+            int fd = ::open(scratchPath.c_str(), O_CREAT | O_RDWR | flags,
+                            0666);
+            if (fd == -1) {
+                LOG(WARNING, "Couldn't open %s to benchmark backup storage "
+                    "writes: %s", scratchPath.c_str(), strerror(errno));
+                break;
+            }
+            fds.push_back(fd);
+        }
+
+        if (fds.size() == filePaths.size()) {
+            struct { size_t size; uint32_t count; } runs[] = {
+                { segmentSize, frameCount },
+                { smallWriteSize, smallWrites },
+            };
+            for (auto& run : runs) {
+                size_t writesPerFrame = segmentSize / run.size;
+                CycleCounter<> counter;
+                for (uint32_t i = 0; i < run.count; i++) {
+                    size_t frameIndex = (i / writesPerFrame) % frameCount;
+                    off_t offset = (i % writesPerFrame) * run.size;
+                    Lock lock(mutex);
+                    unlockedWrite(lock, data + offset, run.size, frameIndex,
+                                  offset, metadata, METADATA_SIZE);
+                }
+                double seconds = Cycles::toSeconds(counter.stop());
+                LOG(NOTICE, "Backup storage writes (%s): %.0f IOPS, "
+                    "%.1f MB/s with %lu-byte writes", ioEngineName(engine),
+                    run.count / seconds,
+                    static_cast<double>(run.count * run.size) /
+                        (1 << 20) / seconds,
+                    run.size);
+            }
+        }
+
+        foreach (int fd, fds)
+            close(fd);
+        fds.clear();
+        foreach (const string& path, filePaths)
+            unlink((path + ".benchmark").c_str());
+    }
+
+    {
+        Lock lock(mutex);
+        buffer.reset();
+        if (savedEngine != IO_URING) {
+            idleRings.clear();
+            rings.clear();
+        }
+    }
+    std::swap(fds, savedFds);
+    ioEngine = savedEngine;
+    syncWrites = savedSyncWrites;
+}
+
+/**
+ * Return a human-readable name for an IoEngine, for log messages.
+ */
+const char*
+MultiFileStorage::ioEngineName(IoEngine ioEngine)
+{
+    switch (ioEngine) {
+        case AIO:       return "aio";
+        case IO_URING:  return "io_uring";
+    }
+    return "unknown";
+}
+
 /**
  * Returns the maximum number of bytes of metadata that can be stored
  * which each append(). Also, how many bytes of getMetadata() are safe
@@ -16,10 +16,12 @@
 #ifndef RAMCLOUD_MULTIFILESTORAGE_H
 #define RAMCLOUD_MULTIFILESTORAGE_H
 
+#include <atomic>
 #include <stack>
 
 #include "Common.h"
 #include "BackupStorage.h"
+#include "IoUring.h"
 #include "PriorityTaskQueue.h"
 
 namespace RAMCloud {
@@ -67,8 +69,9 @@ class MultiFileStorage : public BackupStorage {
         void loadMetadata();
         const void* getMetadata();
 
-        void startLoading();
+        void startLoading(bool streaming = false);
         bool isLoaded();
+        const void* getLoadedPrefix(size_t* loadedLength);
         bool currentlyOpen() { return isOpen;}
         void* load();
         void unload();
@@ -122,6 +125,31 @@ class MultiFileStorage : public BackupStorage {
          */
         BufferPtr buffer;
 
+        /**
+         * Once performRead() starts reading the replica from storage,
+         * points to the buffer it is reading into (which becomes #buffer
+         * once the read completes) until the frame is unloaded; NULL
+         * otherwise. Atomic so getLoadedPrefix() can poll it without
+         * taking the storage mutex.
+         */
+        std::atomic<char*> loadingBuffer;
+
+        /**
+         * Bytes at the start of #loadingBuffer that have already been read
+         * from storage. Advanced during performRead() without holding the
+         * storage mutex; only advanced before the read completes if
+         * #streamingLoad is set.
+         */
+        std::atomic<size_t> loadedLength;
+
+        /**
+         * Set by startLoading() if the caller will consume the replica
+         * with getLoadedPrefix() while it is loading, in which case
+         * performRead() reads it in rounds of LOAD_CHUNK_SIZE. Otherwise
+         * the replica is read with one request per file.
+         */
+        bool streamingLoad;
+
         /**
          * Tracks whether a replica has been opened (either initially or
          * since the time of the last free). False if #isClosed.
@@ -223,12 +251,28 @@ class MultiFileStorage : public BackupStorage {
         DISALLOW_COPY_AND_ASSIGN(Frame);
     };
 
+    /**
+     * Selects the kernel interface used to move replica data to and from
+     * the storage files.
+     */
+    enum IoEngine {
+        /// POSIX asynchronous IO (aio_read/aio_write), which glibc
+        /// implements with a pool of threads issuing blocking calls.
+        AIO,
+        /// Linux io_uring: all of the framelet IOs for an operation are
+        /// submitted with a single system call, replica buffers are
+        /// registered with the kernel, and syncs are linked to the
+        /// writes they cover. See IoUring.
+        IO_URING,
+    };
+
     MultiFileStorage(size_t segmentSize,
                      size_t frameCount,
                      size_t writeRateLimit,
                      size_t maxNonVolatileBuffers,
                      const char* filePaths,
-                     int openFlags = 0);
+                     int openFlags = 0,
+                     IoEngine ioEngine = AIO);
     ~MultiFileStorage();
 
     FrameRef open(bool sync, ServerId masterId, uint64_t segmentId);
@@ -259,16 +303,41 @@ class MultiFileStorage : public BackupStorage {
      */
     enum { METADATA_SIZE = BLOCK_SIZE };
 
+    /**
+     * Frames loaded with Frame::startLoading(true) are read from storage in
+     * rounds; each round reads this many bytes from every framelet. Reading
+     * in rounds lets callers of Frame::getLoadedPrefix() start on the
+     * beginning of a replica before all of it has arrived. Must be a
+     * multiple of BLOCK_SIZE.
+     */
+    enum { LOAD_CHUNK_SIZE = 1024 * 1024 };
+
   PRIVATE:
     size_t bytesInFramelet(size_t fileIndex) const;
     off_t offsetOfFramelet(size_t frameIndex) const;
     off_t offsetOfFrameMetadata(size_t frameIndex) const;
     off_t offsetOfSuperblockFrame(size_t superblockIndex) const;
     void unlockedRead(Frame::Lock& lock, void* buf, size_t frameIndex,
-                      bool usingDevNull);
+                      bool usingDevNull,
+                      std::atomic<size_t>* loadedLength = NULL);
+    void aioRead(void* buf, size_t frameIndex, size_t chunkOffset,
+                 size_t chunkSize, bool usingDevNull);
+    void uringRead(IoUring* ring, void* buf, size_t frameIndex,
+                   size_t chunkOffset, size_t chunkSize, bool usingDevNull);
     void unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
                        size_t frameIndex, off_t offsetInFrame,
                        void* metadataBuf, size_t metadataCount);
+    void aioWrite(void* buf, size_t count, size_t frameIndex,
+                  off_t offsetInFrame, void* metadataBuf,
+                  size_t metadataCount, uint64_t start);
+    void uringWrite(IoUring* ring, void* buf, size_t count,
+                    size_t frameIndex, off_t offsetInFrame,
+                    void* metadataBuf, size_t metadataCount);
+    IoUring* getRing(Frame::Lock& lock);
+    int registeredBufferIndex(const void* buf, size_t length) const;
+    void registerBuffers();
+    void benchmarkWrites();
+    static const char* ioEngineName(IoEngine ioEngine);
 
     void reserveSpace(int fd);
     Tub<Superblock> tryLoadSuperblock(uint32_t superblockFrame);
@@ -317,6 +386,20 @@ class MultiFileStorage : public BackupStorage {
     /// Extra flags for use while opening filePath (e.g. O_DIRECT | O_SYNC).
     int openFlags;
 
+    /// Paths of the storage files, in the same order as #fds.
+    std::vector<string> filePaths;
+
+    /// Which kernel interface is used for replica IO.
+    IoEngine ioEngine;
+
+    /**
+     * True if #openFlags asked for O_SYNC but the files were opened without
+     * it, because the IO_URING engine makes writes durable by linking an
+     * fdatasync after the writes to each file instead. This costs one
+     * flush per file per operation rather than one per write.
+     */
+    bool syncWrites;
+
     /**
      * The file descriptors of the storage files. See bytesInFramelet() for
      * details on how data is divided between files.
@@ -359,6 +442,22 @@ class MultiFileStorage : public BackupStorage {
      */
     std::stack<void*, std::vector<void*>> buffers;
 
+    /**
+     * Buffers from #buffers that are registered with every ring in #rings,
+     * sorted by address; an entry's position is its registered buffer index.
+     * Fixed after construction. Registered buffers are never returned to the
+     * OS by #bufferDeleter. Empty unless #ioEngine is IO_URING.
+     */
+    std::vector<struct iovec> registeredBuffers;
+
+    /**
+     * Every io_uring instance created by getRing(). Each ring is used by
+     * only one thread at a time; rings not currently in use are kept in
+     * #idleRings (protected by #mutex).
+     */
+    std::vector<std::unique_ptr<IoUring>> rings;
+    std::vector<IoUring*> idleRings;
+
     DISALLOW_COPY_AND_ASSIGN(MultiFileStorage);
 };
 
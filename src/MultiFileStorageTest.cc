@@ -153,7 +153,8 @@ TEST_F(MultiFileStorageTest, Frame_loadMetadata) {
 TEST_F(MultiFileStorageTest, Frame_startLoading) {
     BackupStorage::FrameRef frameRef = storage1->open(true, ServerId(), 0);
     Frame* frame = static_cast<Frame*>(frameRef.get());
-    frame->startLoading();
+    frame->startLoading(true);
+    EXPECT_TRUE(frame->streamingLoad);
     EXPECT_TRUE(frame->loadRequested);
     EXPECT_FALSE(frame->isScheduled());
     frame->deschedule();
@@ -211,6 +212,75 @@ TEST_F(MultiFileStorageTest, Frame_loadDirty) {
     EXPECT_STREQ(test, replica);
 }
 
+TEST_F(MultiFileStorageTest, Frame_getLoadedPrefix) {
+    BackupStorage::FrameRef frameRef = storage1->open(true, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->close();
+    size_t loadedLength = 1;
+    EXPECT_TRUE(NULL == frame->getLoadedPrefix(&loadedLength));
+    EXPECT_EQ(0lu, loadedLength);
+
+    frame->deschedule();
+    frame->buffer.reset();
+    char loading[BLOCK_SIZE];
+    {
+        Frame::Lock lock(frame->storage->mutex);
+        frame->loadRequested = true;
+        frame->loadingBuffer = loading;
+        frame->loadedLength = 7;
+    }
+    EXPECT_EQ(loading, frame->getLoadedPrefix(&loadedLength));
+    EXPECT_EQ(7lu, loadedLength);
+
+    {
+        Frame::Lock lock(frame->storage->mutex);
+        frame->loadingBuffer = NULL;
+        frame->performRead(lock);
+    }
+    EXPECT_EQ(frame->buffer.get(), frame->getLoadedPrefix(&loadedLength));
+    EXPECT_EQ(segmentSize, loadedLength);
+}
+
+TEST_F(MultiFileStorageTest, unlockedRead_loadedLength) {
+    Memory::unique_ptr_free data(
+        Memory::xmemalign(HERE, getpagesize(), segmentSize),
+        std::free);
+    memset(data.get(), 'x', segmentSize);
+    Buffer source;
+    source.appendExternal(data.get(), segmentSize);
+    Frame::testingSkipRealIo = false;
+
+    BackupStorage::FrameRef frameRef = storage3->open(true, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(source, 0, segmentSize, 0, NULL, 0);
+    frame->close();
+    frame->deschedule();
+
+    frame->buffer.reset();
+    {
+        Frame::Lock lock(frame->storage->mutex);
+        frame->loadRequested = true;
+        frame->streamingLoad = true;
+        frame->loadedLength = 0;
+        frame->performRead(lock);
+    }
+    EXPECT_EQ(segmentSize, frame->loadedLength);
+    EXPECT_EQ(frame->buffer.get(), frame->loadingBuffer.load());
+    EXPECT_EQ(0, memcmp(data.get(), frame->load(), segmentSize));
+
+    // Without streaming the whole frame is read at once.
+    frame->unload();
+    EXPECT_TRUE(NULL == frame->loadingBuffer);
+    {
+        Frame::Lock lock(frame->storage->mutex);
+        frame->loadRequested = true;
+        frame->streamingLoad = false;
+        frame->performRead(lock);
+    }
+    EXPECT_EQ(segmentSize, frame->loadedLength);
+    EXPECT_EQ(0, memcmp(data.get(), frame->load(), segmentSize));
+}
+
 TEST_F(MultiFileStorageTest, Frame_appendNotOpen) {
     BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
     Frame* frame = static_cast<Frame*>(frameRef.get());
@@ -538,6 +608,79 @@ TEST_F(MultiFileStorageTest, unlockedWriteMiddleOfSegment) {
     }
 }
 
+TEST_F(MultiFileStorageTest, unlockedWrite_ioUring) {
+    // This test also implicitly tests uringRead.
+    if (!IoUring::isSupported())
+        return;
+    Memory::unique_ptr_free data(
+        Memory::xmemalign(HERE, getpagesize(), segmentSize),
+        std::free);
+    memset(data.get(), 'x', segmentSize - 1);
+    static_cast<char*>(data.get())[segmentSize - 1] = '\0';
+    Buffer source;
+    source.appendExternal(data.get(), segmentSize);
+
+    std::string threeFiles = std::string(filePath31) + "," + filePath32
+                             + "," + filePath33;
+    storage3.destroy();
+    storage3.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       threeFiles.c_str(), O_DIRECT | O_SYNC,
+                       MultiFileStorage::IO_URING);
+    Frame::testingSkipRealIo = false;
+
+    BackupStorage::FrameRef frameRef = storage3->open(false, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(source, 0, BLOCK_SIZE + 5, 0, test, testLength + 1);
+    storage3->quiesce();
+    frame->append(source, BLOCK_SIZE + 5, segmentSize - BLOCK_SIZE - 5,
+                  BLOCK_SIZE + 5, NULL, 0);
+    while (!frame->isSynced());
+    EXPECT_EQ(1u, storage3->rings.size());
+    EXPECT_EQ(1u, storage3->idleRings.size());
+
+    // Force a read from disk.
+    frame->buffer.reset();
+    {
+        Frame::Lock lock(frame->storage->mutex);
+        frame->loadRequested = true;
+        frame->performRead(lock);
+    }
+    char* replica = bytes(frame->load());
+    EXPECT_STREQ(bytes(data.get()), replica);
+    char* metadata = bytes(const_cast<void*>(frame->getMetadata()));
+    EXPECT_STREQ(test, metadata);
+}
+
+TEST_F(MultiFileStorageTest, registeredBufferIndex) {
+    if (!IoUring::isSupported())
+        return;
+    storage1.destroy();
+    storage1.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       filePath1, O_DIRECT | O_SYNC,
+                       MultiFileStorage::IO_URING);
+    ASSERT_LT(1u, storage1->registeredBuffers.size());
+    char* base = static_cast<char*>(
+            storage1->registeredBuffers[1].iov_base);
+    size_t size = segmentSize + METADATA_SIZE;
+    EXPECT_EQ(1, storage1->registeredBufferIndex(base, size));
+    EXPECT_EQ(1, storage1->registeredBufferIndex(base + size - 1, 1));
+    EXPECT_EQ(static_cast<int>(IoUring::UNREGISTERED),
+              storage1->registeredBufferIndex(base + 1, size));
+    char unregistered[1];
+    EXPECT_EQ(static_cast<int>(IoUring::UNREGISTERED),
+              storage1->registeredBufferIndex(unregistered, 1));
+
+    // Registered buffers go back to the pool even if it is full.
+    Frame::Lock lock(storage1->mutex);
+    MultiFileStorage::BufferPtr buffer = storage1->allocateBuffer();
+    EXPECT_NE(static_cast<int>(IoUring::UNREGISTERED),
+              storage1->registeredBufferIndex(buffer.get(), 1));
+    storage1->buffers.push(Memory::xmemalign(HERE, getpagesize(), size));
+    size_t pooled = storage1->buffers.size();
+    buffer.reset();
+    EXPECT_EQ(pooled + 1, storage1->buffers.size());
+}
+
 TEST_F(MultiFileStorageTest, Frame_performWrite) {
     storage1->ioQueue.halt();
     BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
@@ -678,6 +821,20 @@ TEST_F(MultiFileStorageTest, constructor) {
               uint32_t(s.st_size));
 }
 
+TEST_F(MultiFileStorageTest, constructor_ioUring) {
+    if (!IoUring::isSupported())
+        return;
+    storage1.destroy();
+    storage1.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       filePath1, O_DIRECT | O_SYNC,
+                       MultiFileStorage::IO_URING);
+    EXPECT_EQ(MultiFileStorage::IO_URING, storage1->ioEngine);
+    EXPECT_TRUE(storage1->syncWrites);
+    EXPECT_NE(O_SYNC, fcntl(storage1->fds[0], F_GETFL) & O_SYNC);
+    EXPECT_EQ(storage1->buffers.size(), storage1->registeredBuffers.size());
+    EXPECT_EQ(0u, storage1->rings.size());
+}
+
 TEST_F(MultiFileStorageTest, openFails) {
     TestLog::Enable _;
     EXPECT_THROW(MultiFileStorage(segmentSize,
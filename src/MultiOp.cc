@@ -85,6 +85,7 @@ MultiOp::MultiOp(RamCloud* ramcloud, WireFormat::MultiOp::OpType type,
     , rpcs()
     , startIndexIdleRpc(0)
     , canceled(false)
+    , notifier(NULL)
     , sessionQueues()
     , test_ignoreBufferOverflow(false)
 {
@@ -267,6 +268,7 @@ MultiOp::flushSessionQueue(Transport::SessionRef session, SessionQueue *queue) {
 
     Tub<PartRpc> *rpc = ptrRpcs[startIndexIdleRpc];
     rpc->construct(ramcloud, session, opType);
+    (*rpc)->notifier = notifier;
     startIndexIdleRpc++;
 
     size_t queueLen = queue->size();
@@ -338,6 +340,52 @@ MultiOp::isReady() {
     return startRpcs();
 }
 
+/**
+ * Indicates whether this operation is waiting only for responses to RPCs
+ * it has already sent. If so, isReady cannot make progress until the
+ * transport reports that one of those RPCs has completed or failed (see
+ * setNotifier). This is typically called after isReady returns false.
+ *
+ * \return
+ *      True means at least one RPC is outstanding and all of them are
+ *      waiting for a response. False means isReady has other work to do,
+ *      such as retrying an RPC after a delay, or that the operation is
+ *      done.
+ */
+bool
+MultiOp::responsesPending()
+{
+    if (startIndexIdleRpc == 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < startIndexIdleRpc; i++) {
+        if (!(*ptrRpcs[i])->inProgress()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Arrange for an object to be told whenever one of the RPCs issued by this
+ * operation completes or fails, including those already underway. This
+ * allows a caller with many operations outstanding to call isReady only
+ * on the ones that may have made progress.
+ *
+ * \param notifier
+ *      Its completed or failed method is invoked (from the dispatcher,
+ *      after that of the RPC itself) each time one of this operation's
+ *      RPCs completes or fails. NULL means no notifications.
+ */
+void
+MultiOp::setNotifier(Transport::RpcNotifier* notifier)
+{
+    this->notifier = notifier;
+    for (uint32_t i = 0; i < startIndexIdleRpc; i++) {
+        (*ptrRpcs[i])->notifier = notifier;
+    }
+}
+
 /**
  * Scan the list of objects and start RPCs if possible. When this method
  * is called, it's possible that some RPCS are already underway (left over
@@ -447,6 +495,7 @@ MultiOp::PartRpc::PartRpc(RamCloud* ramcloud,
         Transport::SessionRef session, WireFormat::MultiOp::OpType type)
     : RpcWrapper(sizeof(WireFormat::MultiOp::Response))
     , ramcloud(ramcloud)
+    , notifier(NULL)
     , session(session)
     , requests()
     , reqHdr(allocHeader<WireFormat::MultiOp>())
@@ -455,6 +504,26 @@ MultiOp::PartRpc::PartRpc(RamCloud* ramcloud,
     reqHdr->count = 0;
 }
 
+// See Transport::RpcNotifier for documentation.
+void
+MultiOp::PartRpc::completed()
+{
+    RpcWrapper::completed();
+    if (notifier != NULL) {
+        notifier->completed();
+    }
+}
+
+// See Transport::RpcNotifier for documentation.
+void
+MultiOp::PartRpc::failed()
+{
+    RpcWrapper::failed();
+    if (notifier != NULL) {
+        notifier->failed();
+    }
+}
+
 // See RpcWrapper for documentation.
 bool
 MultiOp::PartRpc::handleTransportError()
@@ -63,6 +63,8 @@ class MultiOp {
 
     void cancel();
     bool isReady();
+    bool responsesPending();
+    void setNotifier(Transport::RpcNotifier* notifier);
     void wait();
 
   PROTECTED:
@@ -80,12 +82,18 @@ class MultiOp {
                                 };
         bool isFinished() {return getState() == FINISHED;
                                 };
+        void completed();
+        void failed();
         bool handleTransportError();
         void send();
 
         /// Overall client state information.
         RamCloud* ramcloud;
 
+        /// If non-NULL, also told whenever this RPC completes or fails
+        /// (see MultiOp::setNotifier).
+        Transport::RpcNotifier* notifier;
+
         /// Session that will be used to transmit the RPC.
         Transport::SessionRef session;
 
@@ -185,6 +193,9 @@ class MultiOp {
     /// Set by \c cancel.
     bool canceled;
 
+    /// If non-NULL, passed on to each PartRpc; see setNotifier.
+    Transport::RpcNotifier* notifier;
+
     /**
      * Uses the pointer of the reference as a hash key.  Used by sessionQueues.
      */
@@ -281,6 +281,52 @@ TEST_F(MultiOpTest, isReady) {
     EXPECT_EQ(7UL, request.readCalls);
 }
 
+TEST_F(MultiOpTest, responsesPending) {
+    MultiOpObject* requests[] = {&objects[0], &objects[3]};
+    session1->dontNotify = true;
+
+    // The RPC to master2 has finished, so isReady has work to do.
+    MultiOpTester request(ramcloud.get(), requests, 2);
+    EXPECT_FALSE(request.responsesPending());
+    EXPECT_FALSE(request.isReady());
+    EXPECT_TRUE(request.responsesPending());
+
+    session1->lastNotifier->completed();
+    EXPECT_FALSE(request.responsesPending());
+    EXPECT_TRUE(request.isReady());
+    EXPECT_FALSE(request.responsesPending());
+}
+
+TEST_F(MultiOpTest, setNotifier) {
+    // Counts the notifications it receives.
+    struct CountingNotifier : public Transport::RpcNotifier {
+        CountingNotifier() : count(0) {}
+        void completed() { count++; }
+        void failed() { count++; }
+        int count;
+    } notifier;
+    MultiOpObject* requests[] = {&objects[0], &objects[1], &objects[2],
+                                 &objects[3], &objects[4], &objects[5],
+                                 &objects[6]};
+    session1->dontNotify = true;
+    session3->dontNotify = true;
+
+    MultiOpTester request(ramcloud.get(), requests, 7);
+    request.setNotifier(&notifier);
+    EXPECT_FALSE(request.isReady());
+    EXPECT_EQ("mock:host=master1(3) mock:host=master3(1)",
+            rpcStatus(request));
+    EXPECT_EQ(0, notifier.count);
+
+    // Both the RPC that was underway when the notifier was set and the
+    // one started afterwards report to it.
+    session1->lastNotifier->completed();
+    EXPECT_EQ(1, notifier.count);
+    session3->lastNotifier->completed();
+    EXPECT_EQ(2, notifier.count);
+    EXPECT_TRUE(request.isReady());
+}
+
 TEST_F(MultiOpTest, startRpcs_tooManyObjectsForOneRoundOfRpcs) {
     MultiOpObject* requests[] = {&objects[0], &objects[1], &objects[2],
                                  &objects[6], &objects[7], &objects[8],
@@ -18,6 +18,7 @@
 #include "IndexKey.h"
 #include "ObjectFinder.h"
 #include "FailSession.h"
+#include "ThreadId.h"
 
 namespace RAMCloud {
 
@@ -158,9 +159,87 @@ ObjectFinder::ObjectFinder(Context* context)
     , tableConfigFetcher(new RealTableConfigFetcher(context))
     , tableIndexMap()
     , tableMap()
+    , directory(NULL)
+    , epoch(0)
+    , retiredDirectories()
+    , readers()
 {
 }
 
+/**
+ * Destructor.
+ */
+ObjectFinder::~ObjectFinder()
+{
+    delete directory.load();
+    for (RetiredDirectory& retired : retiredDirectories) {
+        delete retired.directory;
+    }
+}
+
+/**
+ * Find the entry for the tablet containing a given key hash.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param keyHash
+ *      A hash value in the space of key hashes.
+ * \return
+ *      The entry for the tablet, or NULL if the directory doesn't contain
+ *      one.
+ */
+const ObjectFinder::TabletDirectory::Entry*
+ObjectFinder::TabletDirectory::find(uint64_t tableId, KeyHash keyHash) const
+{
+    // Find the first entry that starts after keyHash, then step back.
+    size_t low = 0;
+    size_t high = entries.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const Entry& entry = entries[middle];
+        if (entry.tableId < tableId || (entry.tableId == tableId &&
+                entry.startKeyHash <= keyHash)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0)
+        return NULL;
+    const Entry* entry = &entries[low - 1];
+    if (entry->tableId != tableId || keyHash > entry->endKeyHash)
+        return NULL;
+    return entry;
+}
+
+/**
+ * Constructor: announces that the current thread may be using the
+ * published TabletDirectory.
+ *
+ * \param objectFinder
+ *      The ObjectFinder whose directory will be read.
+ */
+ObjectFinder::DirectoryReader::DirectoryReader(ObjectFinder* objectFinder)
+    : slot(&objectFinder->readers[ThreadId::get() % NUM_READER_SLOTS])
+{
+    // The epoch must be read before the increment: a reader that joins a
+    // busy slot relies on the first reader's epoch being no newer than
+    // its own. The increment must be sequentially consistent, since
+    // reclaimDirectories relies on it being ordered before our load of
+    // the directory.
+    uint64_t epoch = objectFinder->epoch.load();
+    if (slot->count.fetch_add(1) == 0)
+        slot->epoch.store(epoch, std::memory_order_relaxed);
+}
+
+/**
+ * Destructor: the current thread no longer references the directory.
+ */
+ObjectFinder::DirectoryReader::~DirectoryReader()
+{
+    slot->count.fetch_sub(1, std::memory_order_release);
+}
+
 /**
  * Return a string representation of all the table id's presented
  * at the tableMap at any given moment. Used mainly for testing.
@@ -225,9 +304,16 @@ ObjectFinder::flushSession(uint64_t tableId, KeyHash keyHash)
     TabletKey key{tableId, keyHash};
     TabletWithLocator* tabletWithLocator = lookupTabletInCache(guard, &key);
     if (tabletWithLocator != NULL) {
-        context->transportManager->flushSession(
-                tabletWithLocator->serviceLocator);
-        tabletWithLocator->session = NULL;
+        string serviceLocator = tabletWithLocator->serviceLocator;
+        context->transportManager->flushSession(serviceLocator);
+
+        // publishDirectory shares sessions between tablets on the same
+        // server, so forget the session for all of them.
+        for (TabletIter it = tableMap.begin(); it != tableMap.end(); it++) {
+            if (it->second.serviceLocator == serviceLocator)
+                it->second.session = NULL;
+        }
+        publishDirectory(guard);
     }
 }
 
@@ -284,6 +370,8 @@ ObjectFinder::flushImpl(const SpinLock::Guard& guard, uint64_t tableId)
     IndexletIter indexUpper = tableIndexMap.upper_bound(
             std::make_pair(tableId, std::numeric_limits<uint8_t>::max()));
     tableIndexMap.erase(indexLower, indexUpper);
+
+    publishDirectory(guard);
 }
 
 /**
@@ -454,6 +542,93 @@ ObjectFinder::lookupTabletInCache(const SpinLock::Guard& guard,
     return NULL;
 }
 
+/**
+ * Build a new TabletDirectory from the current contents of tableMap and
+ * make it visible to lock-free lookups. Must be invoked whenever tableMap
+ * changes, so that the directory never returns a tablet that tableMap no
+ * longer contains.
+ *
+ * Tablets without a session inherit the session of another tablet on the
+ * same server, if there is one; tablets that still have no session, or
+ * whose status isn't NORMAL, are left out of the directory (lookups for
+ * them take the slow path).
+ *
+ * \param guard
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+ObjectFinder::publishDirectory(const SpinLock::Guard& guard)
+{
+    std::map<string, Transport::SessionRef> sessions;
+    for (TabletIter it = tableMap.begin(); it != tableMap.end(); it++) {
+        if (it->second.session)
+            sessions[it->second.serviceLocator] = it->second.session;
+    }
+
+    TabletDirectory* fresh = new TabletDirectory;
+    fresh->entries.reserve(tableMap.size());
+    for (TabletIter it = tableMap.begin(); it != tableMap.end(); it++) {
+        TabletWithLocator* tabletWithLocator = &it->second;
+        if (!tabletWithLocator->session) {
+            auto session = sessions.find(tabletWithLocator->serviceLocator);
+            if (session != sessions.end())
+                tabletWithLocator->session = session->second;
+        }
+        const Tablet& tablet = tabletWithLocator->tablet;
+        if (tabletWithLocator->session &&
+                tablet.status == Tablet::Status::NORMAL) {
+            fresh->entries.push_back({tablet.tableId, tablet.startKeyHash,
+                    tablet.endKeyHash, tabletWithLocator->session});
+        }
+    }
+    if (fresh->entries.empty()) {
+        delete fresh;
+        fresh = NULL;
+    }
+
+    TabletDirectory* old = directory.exchange(fresh);
+    uint64_t retireEpoch = epoch.fetch_add(1) + 1;
+    if (old != NULL)
+        retiredDirectories.push_back({old, retireEpoch});
+    reclaimDirectories(guard);
+}
+
+/**
+ * Delete any retired TabletDirectories that are no longer in use. A
+ * directory is in use if some slot has an active reader whose epoch is
+ * older than the one at which the directory was retired, so a long
+ * lookup only holds back the directories retired while it was running.
+ * Directories that can't be freed now will be freed by a later call,
+ * either from publishDirectory or from the slow path of tryLookup.
+ *
+ * \param guard
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+ObjectFinder::reclaimDirectories(const SpinLock::Guard& guard)
+{
+    if (retiredDirectories.empty())
+        return;
+    // The retired directories were unpublished before this point, so any
+    // reader whose count isn't visible yet will see a newer directory.
+    uint64_t oldestEpoch = ~0lu;
+    for (int i = 0; i < NUM_READER_SLOTS; i++) {
+        if (readers[i].count.load() != 0) {
+            oldestEpoch = std::min(oldestEpoch,
+                    readers[i].epoch.load(std::memory_order_relaxed));
+        }
+    }
+    // A reader with epoch e can only hold directories retired after e.
+    size_t freed = 0;
+    while (freed < retiredDirectories.size() &&
+            retiredDirectories[freed].epoch <= oldestEpoch) {
+        delete retiredDirectories[freed].directory;
+        freed++;
+    }
+    retiredDirectories.erase(retiredDirectories.begin(),
+            retiredDirectories.begin() + freed);
+}
+
 /**
  * This method deletes all cached information, restoring the object
  * to its original pristine state. It's used primarily to force cached
@@ -463,10 +638,25 @@ ObjectFinder::lookupTabletInCache(const SpinLock::Guard& guard,
  */
 void ObjectFinder::reset()
 {
-    SpinLock::Guard _(mutex);
+    SpinLock::Guard guard(mutex);
     tableMap.clear();
     tableIndexMap.clear();
     tableConfigFetcher->clear();
+    publishDirectory(guard);
+}
+
+/**
+ * Replace the object used to fetch table configurations from the
+ * coordinator. Used by benchmarks that run without a coordinator.
+ *
+ * \param fetcher
+ *      The new fetcher; the ObjectFinder takes ownership of it.
+ */
+void
+ObjectFinder::setTableConfigFetcher(TableConfigFetcher* fetcher)
+{
+    SpinLock::Guard _(mutex);
+    tableConfigFetcher.reset(fetcher);
 }
 
 /**
@@ -515,17 +705,41 @@ ObjectFinder::tryLookup(uint64_t tableId, const void* key, KeyLength keyLength)
 Transport::SessionRef
 ObjectFinder::tryLookup(uint64_t tableId, KeyHash keyHash)
 {
-    // No lock needed: doesn't access ObjectFinder object.
+    // Fast path: no lock needed to search the published directory.
+    {
+        DirectoryReader reader(this);
+        const TabletDirectory* current = directory.load();
+        if (current != NULL) {
+            const TabletDirectory::Entry* entry =
+                    current->find(tableId, keyHash);
+            if (entry != NULL)
+                return entry->session;
+        }
+    }
+
     TabletWithLocator* tabletWithLocator = tryLookupTablet(tableId, keyHash);
     if (tabletWithLocator == NULL) {
         return Transport::SessionRef();
     }
+    if (tabletWithLocator->session) {
+        return tabletWithLocator->session;
+    }
 
-    if (!tabletWithLocator->session) {
-        tabletWithLocator->session = context->transportManager->getSession(
-                tabletWithLocator->serviceLocator);
+    // Open the session without holding the lock, then record it and make
+    // the tablet visible to the fast path.
+    string serviceLocator = tabletWithLocator->serviceLocator;
+    Transport::SessionRef session =
+            context->transportManager->getSession(serviceLocator);
+    SpinLock::Guard guard(mutex);
+    TabletKey key{tableId, keyHash};
+    tabletWithLocator = lookupTabletInCache(guard, &key);
+    if (tabletWithLocator != NULL &&
+            tabletWithLocator->serviceLocator == serviceLocator) {
+        if (!tabletWithLocator->session)
+            tabletWithLocator->session = session;
+        publishDirectory(guard);
     }
-    return tabletWithLocator->session;
+    return session;
 }
 
 /**
@@ -613,6 +827,7 @@ ObjectFinder::tryLookupIndexlet(uint64_t tableId, uint8_t indexId,
                 tableId, &tableMap, &tableIndexMap)) {
             return NULL;
         }
+        publishDirectory(guard);
     } catch (TableDoesntExistException& e) {
         *indexDoesntExist = true;
         return NULL;
@@ -651,6 +866,7 @@ TabletWithLocator*
 ObjectFinder::tryLookupTablet(uint64_t tableId, KeyHash keyHash)
 {
     SpinLock::Guard guard(mutex);
+    reclaimDirectories(guard);
     // First lookup the tablet in our local cache
     TabletKey key{tableId, keyHash};
     TabletWithLocator* tabletWithLocator = lookupTabletInCache(guard, &key);
@@ -671,6 +887,7 @@ ObjectFinder::tryLookupTablet(uint64_t tableId, KeyHash keyHash)
             tableId, &tableMap, &tableIndexMap)) {
         return NULL;
     }
+    publishDirectory(guard);
 
     // The response of our last RPC to the coordinator has come back; we can
     // finally throw a TableDoesntExistException for sure if needed
@@ -702,6 +919,7 @@ ObjectFinder::waitForTabletDown(uint64_t tableId)
                 tableId, &tableMap, &tableIndexMap)) {
             context->dispatch->poll();
         };
+        publishDirectory(guard);
         TabletKey start {tableId, 0U};
         TabletKey end {tableId, std::numeric_limits<KeyHash>::max()};
         TabletIter lower = tableMap.lower_bound(start);
@@ -736,6 +954,7 @@ ObjectFinder::waitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs)
                 tableId, &tableMap, &tableIndexMap)) {
             context->dispatch->poll();
         };
+        publishDirectory(guard);
         TabletKey start {tableId, 0U};
         TabletKey end {tableId, std::numeric_limits<KeyHash>::max()};
         TabletIter lower = tableMap.lower_bound(start);
@@ -17,7 +17,9 @@
 #define RAMCLOUD_OBJECTFINDER_H
 
 #include <boost/function.hpp>
+#include <atomic>
 #include <map>
+#include <vector>
 
 #include "Common.h"
 #include "CoordinatorClient.h"
@@ -114,12 +116,18 @@ struct TabletWithLocator {
  * that can be used to communicate with the master that stores the object.
  * It retrieves configuration information from the coordinator and caches it.
  * This class is thread-safe.
+ *
+ * The common case, tryLookup on a tablet whose session is already known, is
+ * lock-free: in addition to tableMap, the ObjectFinder publishes an immutable
+ * sorted copy of the tablets that are usable (see TabletDirectory), which is
+ * replaced as a whole, RCU-style, whenever tableMap changes.
  */
 class ObjectFinder {
   public:
     class TableConfigFetcher; // forward declaration, see full declaration below
 
     explicit ObjectFinder(Context* context);
+    ~ObjectFinder();
 
     /*
      * Used only for debug purposes. This function created a string
@@ -139,6 +147,7 @@ class ObjectFinder {
     TabletWithLocator* lookupTablet(uint64_t tableId, KeyHash keyHash);
 
     void reset();
+    void setTableConfigFetcher(TableConfigFetcher* fetcher);
 
     Transport::SessionRef tryLookup(uint64_t tableId, const void* key,
                                     KeyLength keyLength);
@@ -151,7 +160,76 @@ class ObjectFinder {
     void waitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs = ~0lu);
 
   PRIVATE:
+    /**
+     * An immutable snapshot of the tablets in tableMap that have NORMAL
+     * status and an open session, sorted by (tableId, startKeyHash). Lookups
+     * are binary searches that don't need the ObjectFinder's lock. Once
+     * published, a TabletDirectory is never modified; when tableMap changes
+     * a new one is built and swapped in, and the old one is freed once no
+     * reader can still be using it.
+     */
+    struct TabletDirectory {
+        struct Entry {
+            uint64_t tableId;
+            KeyHash startKeyHash;
+            KeyHash endKeyHash;
+            Transport::SessionRef session;
+        };
+
+        TabletDirectory() : entries() {}
+        const Entry* find(uint64_t tableId, KeyHash keyHash) const;
+
+        /// Usable tablets, in increasing order of (tableId, startKeyHash).
+        std::vector<Entry> entries;
+    };
+
+    /**
+     * One slot per group of threads, counting lookups in progress on the
+     * published TabletDirectory. Each slot fills a cache line so that
+     * threads using different slots don't interfere with each other.
+     */
+    struct ReaderSlot {
+        /// Number of active DirectoryReaders using this slot.
+        std::atomic<int> count;
+
+        /// Value of #epoch read by the reader that made count nonzero;
+        /// no reader in the slot can hold a directory retired after it.
+        std::atomic<uint64_t> epoch;
+
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<int>)
+                - sizeof(std::atomic<uint64_t>)];
+    };
+
+    /**
+     * A TabletDirectory that has been replaced, together with the value
+     * #epoch took when it was unpublished.
+     */
+    struct RetiredDirectory {
+        TabletDirectory* directory;
+        uint64_t epoch;
+    };
+
+    /// Number of entries in #readers; threads are assigned to slots by
+    /// their ThreadId.
+    enum { NUM_READER_SLOTS = 64 };
+
+    /**
+     * Marks the current thread as reading #directory for the lifetime of
+     * this object; a TabletDirectory that has been replaced is not freed
+     * while any reader that might have seen it is still active.
+     */
+    class DirectoryReader {
+      public:
+        explicit DirectoryReader(ObjectFinder* objectFinder);
+        ~DirectoryReader();
+      PRIVATE:
+        ReaderSlot* slot;
+        DISALLOW_COPY_AND_ASSIGN(DirectoryReader);
+    };
+
     void flushImpl(const SpinLock::Guard& guard, uint64_t tableId);
+    void publishDirectory(const SpinLock::Guard& guard);
+    void reclaimDirectories(const SpinLock::Guard& guard);
 
     IndexletWithLocator* lookupIndexletInCache(const SpinLock::Guard& guard,
                                                uint64_t tableId,
@@ -205,6 +283,28 @@ class ObjectFinder {
     std::map<TabletKey, TabletWithLocator> tableMap;
     typedef std::map<TabletKey, TabletWithLocator>::iterator TabletIter;
 
+    /**
+     * The most recently published TabletDirectory (NULL means empty). Read
+     * without holding the lock, but only replaced by publishDirectory.
+     */
+    std::atomic<TabletDirectory*> directory;
+
+    /**
+     * Incremented by publishDirectory each time #directory is replaced;
+     * used to tell which retired directories readers may still hold.
+     */
+    std::atomic<uint64_t> epoch;
+
+    /**
+     * TabletDirectories that have been replaced but may still be in use by
+     * readers, oldest first; they are deleted by reclaimDirectories.
+     * Protected by mutex.
+     */
+    std::vector<RetiredDirectory> retiredDirectories;
+
+    /// Counts of active DirectoryReaders; see ReaderSlot.
+    ReaderSlot readers[NUM_READER_SLOTS];
+
     DISALLOW_COPY_AND_ASSIGN(ObjectFinder);
 };
 
@@ -220,6 +220,117 @@ TEST_F(ObjectFinderTest, flush) {
     EXPECT_EQ(objectFinder->debugString(), "");
 }
 
+TEST_F(ObjectFinderTest, TabletDirectory_find) {
+    ObjectFinder::TabletDirectory directory;
+    directory.entries.push_back({1, 0, 99, NULL});
+    directory.entries.push_back({1, 200, 299, NULL});
+    directory.entries.push_back({3, 0, ~0lu, NULL});
+    EXPECT_EQ(&directory.entries[0], directory.find(1, 0));
+    EXPECT_EQ(&directory.entries[0], directory.find(1, 99));
+    EXPECT_TRUE(directory.find(1, 100) == NULL);
+    EXPECT_EQ(&directory.entries[1], directory.find(1, 250));
+    EXPECT_TRUE(directory.find(1, 300) == NULL);
+    EXPECT_TRUE(directory.find(0, 5) == NULL);
+    EXPECT_TRUE(directory.find(2, 5) == NULL);
+    EXPECT_EQ(&directory.entries[2], directory.find(3, ~0lu));
+    EXPECT_TRUE(directory.find(4, 0) == NULL);
+}
+
+TEST_F(ObjectFinderTest, publishDirectory) {
+    EXPECT_TRUE(objectFinder->directory.load() == NULL);
+    Transport::SessionRef session = objectFinder->tryLookup(3, 5lu);
+    ASSERT_TRUE(session != NULL);
+    EXPECT_EQ(1U, refresher->called);
+
+    // Both tablets of table 3 are on server3, so they share the session;
+    // other tablets have no session yet and are left out.
+    ObjectFinder::TabletDirectory* directory = objectFinder->directory;
+    ASSERT_TRUE(directory != NULL);
+    ASSERT_EQ(2U, directory->entries.size());
+    EXPECT_EQ(10000U, directory->entries[1].startKeyHash);
+    EXPECT_EQ(session, directory->entries[1].session);
+
+    // Later lookups are answered from the directory.
+    EXPECT_EQ(session, objectFinder->tryLookup(3, 20000lu));
+    EXPECT_EQ(1U, refresher->called);
+    EXPECT_EQ(directory, objectFinder->directory);
+
+    // Flushing the table removes it from the directory.
+    objectFinder->flush(3);
+    EXPECT_TRUE(objectFinder->directory.load() == NULL);
+    EXPECT_EQ(0U, objectFinder->retiredDirectories.size());
+}
+
+TEST_F(ObjectFinderTest, publishDirectory_skipsRecoveringTablets) {
+    objectFinder->lookup(1, 0);
+    objectFinder->tryLookup(2, 5lu);
+    SpinLock::Guard guard(objectFinder->mutex);
+    TabletKey key {2, 0};
+    objectFinder->lookupTabletInCache(guard, &key)->tablet.status =
+            Tablet::RECOVERING;
+    objectFinder->publishDirectory(guard);
+    ObjectFinder::TabletDirectory* directory = objectFinder->directory;
+    ASSERT_EQ(1U, directory->entries.size());
+    EXPECT_EQ(1U, directory->entries[0].tableId);
+}
+
+TEST_F(ObjectFinderTest, reclaimDirectories) {
+    objectFinder->tryLookup(3, 5lu);
+    {
+        ObjectFinder::DirectoryReader reader(objectFinder.get());
+        objectFinder->flush(3);
+        EXPECT_EQ(1U, objectFinder->retiredDirectories.size());
+        objectFinder->flush(3);
+        EXPECT_EQ(1U, objectFinder->retiredDirectories.size());
+    }
+    SpinLock::Guard guard(objectFinder->mutex);
+    objectFinder->reclaimDirectories(guard);
+    EXPECT_EQ(0U, objectFinder->retiredDirectories.size());
+}
+
+TEST_F(ObjectFinderTest, reclaimDirectories_onlyOlderThanReaders) {
+    objectFinder->tryLookup(3, 5lu);
+    objectFinder->tryLookup(2, 5lu);
+    SpinLock::Guard guard(objectFinder->mutex);
+    ObjectFinder::ReaderSlot* otherSlot = &objectFinder->readers[
+            (ThreadId::get() + 1) % ObjectFinder::NUM_READER_SLOTS];
+    ObjectFinder::TabletDirectory* second;
+    {
+        ObjectFinder::DirectoryReader reader(objectFinder.get());
+        objectFinder->publishDirectory(guard);
+        EXPECT_EQ(1U, objectFinder->retiredDirectories.size());
+
+        // A reader in another slot that started after the first retirement.
+        otherSlot->count = 1;
+        otherSlot->epoch = objectFinder->epoch.load();
+        second = objectFinder->directory;
+        objectFinder->publishDirectory(guard);
+        EXPECT_EQ(2U, objectFinder->retiredDirectories.size());
+
+        // Joining a busy slot doesn't make it look newer.
+        ObjectFinder::DirectoryReader reader2(objectFinder.get());
+        objectFinder->reclaimDirectories(guard);
+        EXPECT_EQ(2U, objectFinder->retiredDirectories.size());
+    }
+    objectFinder->reclaimDirectories(guard);
+    ASSERT_EQ(1U, objectFinder->retiredDirectories.size());
+    EXPECT_EQ(second, objectFinder->retiredDirectories[0].directory);
+    otherSlot->count = 0;
+    objectFinder->reclaimDirectories(guard);
+    EXPECT_EQ(0U, objectFinder->retiredDirectories.size());
+}
+
+TEST_F(ObjectFinderTest, reclaimDirectories_fromSlowPath) {
+    objectFinder->tryLookup(3, 5lu);
+    {
+        ObjectFinder::DirectoryReader reader(objectFinder.get());
+        objectFinder->flush(3);
+        EXPECT_EQ(1U, objectFinder->retiredDirectories.size());
+    }
+    objectFinder->tryLookupTablet(3, 5lu);
+    EXPECT_EQ(0U, objectFinder->retiredDirectories.size());
+}
+
 TEST_F(ObjectFinderTest, lookup) {
     uint64_t lastPollTime = objectFinder->context->dispatch->currentTime;
     Transport::SessionRef session = objectFinder->lookup(1, 0);
@@ -461,6 +572,21 @@ TEST_F(ObjectFinderTest, flushSession_tablet) {
     objectFinder->flushSession(99, 0);
 }
 
+TEST_F(ObjectFinderTest, flushSession_tablet_sharedSession) {
+    objectFinder->tryLookup(3, 5lu);
+    objectFinder->tryLookup(4, 5lu);
+    ASSERT_EQ(3U, objectFinder->directory.load()->entries.size());
+
+    objectFinder->flushSession(3, 5lu);
+    TabletKey key {3, 10000};
+    SpinLock::Guard guard(objectFinder->mutex);
+    EXPECT_TRUE(objectFinder->lookupTabletInCache(guard, &key)->session
+            == NULL);
+    ObjectFinder::TabletDirectory* directory = objectFinder->directory;
+    ASSERT_EQ(1U, directory->entries.size());
+    EXPECT_EQ(4U, directory->entries[0].tableId);
+}
+
 TEST_F(ObjectFinderTest, flushSession_index) {
     bool indexDoesntExist;
     objectFinder->tryLookup(1, 1, "abc", 3, &indexDoesntExist);
@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "Buffer.h"
 #include "Cycles.h"
 #include "Dispatch.h"
@@ -20,6 +22,7 @@
 #include "EnumerationIterator.h"
 #include "IndexletManager.h"
 #include "LogEntryRelocator.h"
+#include "LogProtector.h"
 #include "ObjectManager.h"
 #include "Object.h"
 #include "PerfStats.h"
@@ -91,12 +94,19 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                      allocator, replicaManager, masterTableMetadata)
     , log(context, config, this, &segmentManager, &replicaManager)
     , objectMap(config->master.hashTableBytes / HashTable::bytesPerCacheLine())
+    , tableIndexEnabled(config->master.tableObjectIndex)
+    , tableIndex()
+    , tableIndexLock("ObjectManager::tableIndexLock")
+    , enumerationBuckets()
+    , enumerationBucketsLock("ObjectManager::enumerationBucketsLock")
     , anyWrites(false)
     , hashTableBucketLocks()
     , lockTable(1000, log)
     , mutex("ObjectManager::mutex")
     , tombstoneRemover(this, &objectMap)
     , tombstoneProtectorCount(0)
+    , hashTableResizer(this)
+    , hashTableResizeEpoch(0)
 {
     for (size_t i = 0; i < arrayLength(hashTableBucketLocks); i++)
         hashTableBucketLocks[i].setName("hashTableBucketLock");
@@ -145,6 +155,9 @@ ObjectManager::initOnceEnlisted()
 
     if (!config->master.disableLogCleaner)
         log.enableCleaner();
+
+    if (config->master.hashTableMaxLoadFactor > 0)
+        hashTableResizer.start(0);
 }
 
 /**
@@ -200,6 +213,18 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
     for (*respNumHashes = 0; *respNumHashes < reqNumHashes;
             *respNumHashes += 1) {
 
+        // Prefetch the next group of objects before reading any of them.
+        if (*respNumHashes % READ_PREFETCH_BATCH == 0) {
+            KeyHash batch[READ_PREFETCH_BATCH];
+            uint32_t batchSize = std::min(READ_PREFETCH_BATCH,
+                                          reqNumHashes - *respNumHashes);
+            for (uint32_t i = 0; i < batchSize; i++) {
+                batch[i] = *(pKHashes->getOffset<uint64_t>(
+                        pKHashesOffset + i * sizeof32(KeyHash)));
+            }
+            prefetchObjects(batch, batchSize);
+        }
+
         pKHash = *(pKHashes->getOffset<uint64_t>(pKHashesOffset));
         pKHashesOffset += sizeof32(pKHash);
 
@@ -297,6 +322,41 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
     }
 }
 
+/**
+ * Prefetch the hash table buckets and log entries for a group of objects
+ * that the caller is about to read. Reading an object normally takes two
+ * dependent cache misses (the hash table bucket, then the log entry it
+ * points to); doing this first for a whole group lets those misses overlap
+ * instead of being paid one object at a time. This is purely a performance
+ * hint: the objects must still be read normally (e.g. with readObject()),
+ * which revalidates everything under the bucket lock.
+ *
+ * \param keyHashes
+ *      Primary key hashes of the objects that will be read.
+ * \param numHashes
+ *      Number of entries in \a keyHashes. Should not exceed
+ *      READ_PREFETCH_BATCH, or early lines may be evicted before they're
+ *      used.
+ */
+void
+ObjectManager::prefetchObjects(const KeyHash* keyHashes, uint32_t numHashes)
+{
+    // Stage 1: issue all of the bucket prefetches so the misses overlap.
+    for (uint32_t i = 0; i < numHashes; i++)
+        objectMap.prefetchBucket(keyHashes[i]);
+
+    // Stage 2: the buckets should be arriving; find the candidates in each
+    // and prefetch the start of their log entries (the entry header, object
+    // header, and the start of the key). Segment::Reference::getEntry()
+    // prefetches the rest of small entries once it has read the header.
+    // No bucket locks are taken: this is only a hint, and references are
+    // raw pointers into log memory, which is never unmapped, so a prefetch
+    // of a stale reference is harmless. migrateHashTableBuckets() keeps the
+    // old bucket array alive for as long as this could be reading it.
+    for (uint32_t i = 0; i < numHashes; i++)
+        objectMap.prefetchReferences(keyHashes[i]);
+}
+
 /**
  * Read an object previously written to this ObjectManager.
  *
@@ -496,11 +556,344 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
 void
 ObjectManager::removeOrphanedObjects()
 {
-    for (uint64_t i = 0; i < objectMap.getNumBuckets(); i++) {
-        HashTableBucketLock lock(*this, i);
+    cleanupHashTable(removeIfOrphanedObject);
+}
+
+/**
+ * Remove the objects in a range of key hashes of one table that no longer
+ * belong to a tablet owned by this master. Called after a tablet is dropped
+ * or migrated away. If the per-table index is enabled, only the buckets
+ * holding entries from that range are visited; otherwise this is the same
+ * as a full removeOrphanedObjects().
+ *
+ * \param tableId
+ *      Table the dropped tablet belonged to.
+ * \param firstKeyHash
+ *      Smallest key hash in the dropped tablet.
+ * \param lastKeyHash
+ *      Largest key hash in the dropped tablet.
+ */
+void
+ObjectManager::removeOrphanedObjects(uint64_t tableId, uint64_t firstKeyHash,
+                                     uint64_t lastKeyHash)
+{
+    std::vector<uint64_t> buckets;
+    uint64_t numBuckets = objectMap.getNumBuckets();
+    if (!findTableBuckets(tableId, firstKeyHash, lastKeyHash, numBuckets,
+                          &buckets)) {
+        removeOrphanedObjects();
+        return;
+    }
+
+    size_t i = 0;
+    while (i < buckets.size()) {
+        HashTableBucketLock lock(*this, buckets[i]);
+        if (objectMap.getNumBuckets() != numBuckets) {
+            // A resize renumbered the buckets; find them again.
+            numBuckets = objectMap.getNumBuckets();
+            findTableBuckets(tableId, firstKeyHash, lastKeyHash, numBuckets,
+                             &buckets);
+            i = 0;
+            continue;
+        }
         CleanupParameters params = { this , &lock };
-        objectMap.forEachInBucket(removeIfOrphanedObject, &params, i);
+        objectMap.forEachInBucket(removeIfOrphanedObject, &params, buckets[i]);
+        i++;
+    }
+}
+
+/**
+ * Find the hash table buckets that hold entries from a range of key hashes
+ * in one table, using the per-table index (see ServerConfig::Master::
+ * tableObjectIndex). This lets callers that scan a single tablet skip the
+ * rest of the hash table. Entries added after this returns may land in
+ * buckets that aren't listed. The index is walked in batches, releasing
+ * #tableIndexLock in between, so writers aren't held up for the whole walk.
+ *
+ * \param tableId
+ *      Table whose entries are wanted.
+ * \param firstKeyHash
+ *      Smallest key hash of interest.
+ * \param lastKeyHash
+ *      Largest key hash of interest.
+ * \param numBuckets
+ *      Bucket numbers are computed relative to a table of this many buckets
+ *      (normally the current value of HashTable::getNumBuckets()).
+ * \param[out] buckets
+ *      Filled with the indexes of the buckets, in increasing order and
+ *      without duplicates. Any previous contents are discarded.
+ * \return
+ *      False if the index isn't maintained, in which case \a buckets is
+ *      left empty and the caller must scan the entire hash table.
+ */
+bool
+ObjectManager::findTableBuckets(uint64_t tableId, uint64_t firstKeyHash,
+                                uint64_t lastKeyHash, uint64_t numBuckets,
+                                std::vector<uint64_t>* buckets)
+{
+    buckets->clear();
+    if (!tableIndexEnabled)
+        return false;
+
+    uint64_t nextKeyHash = firstKeyHash;
+    bool done = false;
+    while (!done) {
+        SpinLock::Guard _(tableIndexLock);
+        auto table = tableIndex.find(tableId);
+        if (table == tableIndex.end())
+            break;
+        const std::multiset<KeyHash>& hashes = table->second;
+        auto it = hashes.lower_bound(nextKeyHash);
+        auto end = hashes.upper_bound(lastKeyHash);
+        done = true;
+        for (int count = 0; it != end; it = hashes.upper_bound(*it)) {
+            if (count++ == TABLE_INDEX_BATCH) {
+                // Let writers in; the next batch resumes at this hash.
+                nextKeyHash = *it;
+                done = false;
+                break;
+            }
+            uint64_t unused;
+            buckets->push_back(HashTable::findBucketIndex(numBuckets, *it,
+                                                          &unused));
+        }
+    }
+
+    std::sort(buckets->begin(), buckets->end());
+    buckets->erase(std::unique(buckets->begin(), buckets->end()),
+                   buckets->end());
+    return true;
+}
+
+/**
+ * Return the hash table buckets holding entries from a tablet, for scans
+ * that span several RPCs (Enumeration and MasterService::buildIndex). This
+ * is findTableBuckets(), except that the list computed for the first RPC
+ * of a scan is reused by the RPCs that follow; computing it walks every
+ * entry of the tablet, which would make scanning a tablet quadratic in its
+ * size. Entries added after a scan starts may be in buckets that aren't
+ * listed and so may be missed, which both scans allow.
+ *
+ * \param tableId
+ *      Table being enumerated.
+ * \param firstKeyHash
+ *      Smallest key hash of interest.
+ * \param lastKeyHash
+ *      Largest key hash of interest.
+ * \param numBuckets
+ *      Bucket numbers are computed relative to a table of this many buckets
+ *      (normally the current value of HashTable::getNumBuckets()).
+ * \param restart
+ *      True means a scan of the tablet is starting, so a list computed for
+ *      an earlier scan mustn't be used: it could miss objects that the new
+ *      scan has to find.
+ * \return
+ *      The bucket indexes, in increasing order and without duplicates.
+ *      NULL if the per-table index isn't maintained, in which case the
+ *      caller must scan the entire hash table.
+ */
+std::shared_ptr<const std::vector<uint64_t>>
+ObjectManager::getEnumerationBuckets(uint64_t tableId, uint64_t firstKeyHash,
+                                     uint64_t lastKeyHash,
+                                     uint64_t numBuckets, bool restart)
+{
+    if (!tableIndexEnabled)
+        return NULL;
+
+    if (!restart) {
+        SpinLock::Guard _(enumerationBucketsLock);
+        foreach (const EnumerationBuckets& cached, enumerationBuckets) {
+            if (cached.tableId == tableId &&
+                    cached.firstKeyHash == firstKeyHash &&
+                    cached.lastKeyHash == lastKeyHash &&
+                    cached.numBuckets == numBuckets) {
+                return cached.buckets;
+            }
+        }
+    }
+
+    std::shared_ptr<std::vector<uint64_t>> buckets =
+            std::make_shared<std::vector<uint64_t>>();
+    findTableBuckets(tableId, firstKeyHash, lastKeyHash, numBuckets,
+                     buckets.get());
+
+    // A newer list also serves enumerations that started earlier, so it
+    // replaces any older one for the same tablet.
+    SpinLock::Guard _(enumerationBucketsLock);
+    for (auto it = enumerationBuckets.begin();
+            it != enumerationBuckets.end(); ++it) {
+        if (it->tableId == tableId && it->firstKeyHash == firstKeyHash &&
+                it->lastKeyHash == lastKeyHash &&
+                it->numBuckets == numBuckets) {
+            enumerationBuckets.erase(it);
+            break;
+        }
+    }
+    EnumerationBuckets cached = {tableId, firstKeyHash, lastKeyHash,
+                                 numBuckets, buckets};
+    enumerationBuckets.push_front(cached);
+    if (enumerationBuckets.size() > MAX_ENUMERATION_BUCKETS)
+        enumerationBuckets.pop_back();
+    return buckets;
+}
+
+/**
+ * Apply a callback to each reference in one bucket of the hash table while
+ * holding that bucket's lock. This is how code outside ObjectManager (such
+ * as Enumeration) should scan the hash table, since the table may be
+ * resized concurrently.
+ *
+ * \param callback
+ *      Invoked with each reference in the bucket, plus \a cookie.
+ * \param cookie
+ *      Opaque value passed to \a callback.
+ * \param numBuckets
+ *      The number of buckets the caller believes the table has (i.e. a
+ *      previous return value of HashTable::getNumBuckets()). Bucket numbers
+ *      are only meaningful relative to this.
+ * \param bucket
+ *      Index of the bucket to scan; less than \a numBuckets.
+ * \return
+ *      True if the bucket was scanned. False if the table no longer has
+ *      \a numBuckets buckets (because it was resized), in which case
+ *      \a callback was not invoked and the caller should start over with
+ *      the new bucket numbering.
+ */
+bool
+ObjectManager::forEachInHashTableBucket(void (*callback)(uint64_t, void *),
+                                        void *cookie,
+                                        uint64_t numBuckets,
+                                        uint64_t bucket)
+{
+    HashTableBucketLock lock(*this, bucket);
+    if (objectMap.getNumBuckets() != numBuckets)
+        return false;
+    objectMap.forEachInBucket(callback, cookie, bucket);
+    return true;
+}
+
+/**
+ * Begin resizing the hash table. The resize is carried out incrementally
+ * by subsequent calls to #migrateHashTableBuckets(); until then, the table
+ * continues to operate normally. This is normally invoked by the
+ * HashTableResizer, but is public so that benchmarks can drive resizes
+ * directly.
+ *
+ * \param numBuckets
+ *      The new size of the table. Rounded down to a power of two.
+ * \return
+ *      True if the resize was started. False if a resize is already in
+ *      progress or either the current or new size is smaller than
+ *      MIN_RESIZABLE_BUCKETS.
+ */
+bool
+ObjectManager::startHashTableResize(uint64_t numBuckets)
+{
+    numBuckets = BitOps::powerOfTwoLessOrEqual(numBuckets);
+    if (numBuckets < MIN_RESIZABLE_BUCKETS ||
+            objectMap.getNumBuckets() < MIN_RESIZABLE_BUCKETS ||
+            numBuckets == objectMap.getNumBuckets()) {
+        return false;
     }
+
+    lockAllHashTableBuckets();
+    bool started = !objectMap.isResizing();
+    if (started) {
+        objectMap.startResize(numBuckets);
+        // prefetchObjects() reads the old bucket array without locks; any
+        // call that could have missed the start of the resize belongs to
+        // an RPC in this epoch or earlier.
+        hashTableResizeEpoch = LogProtector::incrementCurrentEpoch() - 1;
+    }
+    unlockAllHashTableBuckets();
+    return started;
+}
+
+/**
+ * Make progress on a resize started by #startHashTableResize(), moving
+ * some buckets into the new table. Each bucket is moved while holding its
+ * lock, so operations on other buckets proceed in parallel. Once all
+ * buckets have moved, the old table is released.
+ *
+ * \param maxBuckets
+ *      Upper limit on the number of buckets to move in this call.
+ * \return
+ *      True if no resize is in progress any more (either it just
+ *      completed or there wasn't one); false if more calls are needed.
+ */
+bool
+ObjectManager::migrateHashTableBuckets(uint64_t maxBuckets)
+{
+    // Only the thread driving the resize changes the bucket numbering, so
+    // it is safe to read it here without holding a lock.
+    if (!objectMap.isResizing())
+        return true;
+
+    uint64_t numBuckets = objectMap.getNumBuckets();
+    for (uint64_t i = 0; i < maxBuckets; i++) {
+        uint64_t bucket = objectMap.getNumBucketsMigrated();
+        if (bucket >= numBuckets)
+            break;
+        HashTableBucketLock lock(*this, bucket);
+        objectMap.migrateBucket(bucket, getReferenceKeyHash, &log);
+    }
+
+    if (objectMap.getNumBucketsMigrated() < numBuckets)
+        return false;
+
+    // Don't release the old bucket array while an RPC that may still be
+    // prefetching from it without locks is running (see prefetchObjects()).
+    uint64_t earliestEpoch;
+    {
+        Dispatch::Lock lock(context->dispatch);
+        earliestEpoch = LogProtector::getEarliestOutstandingEpoch(
+                Transport::ServerRpc::READ_ACTIVITY);
+    }
+    if (earliestEpoch <= hashTableResizeEpoch)
+        return false;
+
+    lockAllHashTableBuckets();
+    objectMap.finishResize();
+    unlockAllHashTableBuckets();
+    return true;
+}
+
+/**
+ * Fill in the hash table fields of a PerfStats structure. Like
+ * AbstractLog::getMemoryStats(), these are not counters, so
+ * PerfStats::collectStats() does not fill them in.
+ *
+ * \param[out] stats
+ *      Structure whose hashTable* fields are overwritten.
+ */
+void
+ObjectManager::getHashTableStats(PerfStats* stats)
+{
+    stats->hashTableBuckets = objectMap.isResizing()
+            ? objectMap.getResizeTarget() : objectMap.getNumBuckets();
+    stats->hashTableEntries = objectMap.getNumEntries();
+    stats->hashTableResizeTargetBuckets = objectMap.getResizeTarget();
+    stats->hashTableBucketsMigrated = objectMap.getNumBucketsMigrated();
+}
+
+/**
+ * Add statistics about the hash table to the ServerStatistics returned by
+ * the GET_SERVER_STATISTICS RPC.
+ *
+ * \param[out] serverStatistics
+ *      Its hash_table_stats field is filled in.
+ */
+void
+ObjectManager::getStatistics(ProtoBuf::ServerStatistics* serverStatistics)
+{
+    ProtoBuf::ServerStatistics_HashTableStatistics* stats =
+            serverStatistics->mutable_hash_table_stats();
+    stats->set_num_buckets(objectMap.isResizing()
+            ? objectMap.getResizeTarget() : objectMap.getNumBuckets());
+    stats->set_num_entries(objectMap.getNumEntries());
+    stats->set_load_factor(objectMap.getLoadFactor());
+    stats->set_resize_target_buckets(objectMap.getResizeTarget());
+    stats->set_buckets_migrated(objectMap.getNumBucketsMigrated());
 }
 
 /**
@@ -1303,6 +1696,7 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
         log.free(currentReference);
     } else {
         objectMap.insert(key.getHash(), appends[0].reference.toInteger());
+        addToTableIndex(key);
     }
 
     if (rpcResult && rpcResultPtr)
@@ -1689,6 +2083,261 @@ ObjectManager::prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
     return STATUS_OK;
 }
 
+/**
+ * Commit a transaction that involves only this server in a single phase.
+ * Unlike prepareOp followed by commitRead/commitRemove/commitWrite, no
+ * PreparedOp records are logged and no transaction locks are taken: the
+ * hash table buckets of all the objects are locked at once, the reject
+ * rules of every operation are checked, and, if they all pass, the new
+ * objects and tombstones are appended to the log atomically together with
+ * an RpcResult for each operation. Either way, each operation's RpcResult
+ * records the outcome (COMMITTED or ABORT) so that retries of the request
+ * are answered without being executed again.
+ *
+ * As with writeObject, the changes aren't guaranteed to be on backups until
+ * syncChanges() is called.
+ *
+ * \param ops
+ *      The operations of the transaction, each with its reject rules and
+ *      an RpcResult whose response is the transaction's vote. The objects
+ *      of WRITE operations have no valid version and timestamp yet; this
+ *      method sets them. The keys must be distinct.
+ * \param numOps
+ *      Number of entries in ops.
+ * \param[out] isCommitVote
+ *      Set to true if the transaction committed, or false if a reject rule
+ *      or a transaction lock held by another transaction forced it to abort.
+ * \return
+ *      STATUS_OK if the outcome was logged. STATUS_UNKNOWN_TABLET if one of
+ *      the objects is not in a tablet owned by this server in the NORMAL
+ *      state; nothing is logged in that case.
+ */
+Status
+ObjectManager::commitTransaction(TransactionOp* ops, uint32_t numOps,
+                bool* isCommitVote)
+{
+    *isCommitVote = false;
+
+    // Lock every hash table bucket involved, in increasing order of lock
+    // index so that two transactions can't deadlock. The locks are held
+    // until all of the new entries are in the log and the hash table.
+    uint32_t numLocks = arrayLength(hashTableBucketLocks);
+    std::vector<uint64_t> lockIndexes;
+    lockIndexes.reserve(numOps);
+    for (uint32_t i = 0; i < numOps; i++) {
+        uint16_t keyLength = 0;
+        const void* keyString = ops[i].op->object.getKey(0, &keyLength);
+        Key key(ops[i].op->object.getTableId(), keyString, keyLength);
+        uint64_t unused;
+        uint64_t bucket = HashTable::findBucketIndex(objectMap.getNumBuckets(),
+                key.getHash(), &unused);
+        lockIndexes.push_back(bucket & (numLocks - 1));
+    }
+    std::vector<uint64_t> sortedIndexes(lockIndexes);
+    std::sort(sortedIndexes.begin(), sortedIndexes.end());
+    sortedIndexes.erase(std::unique(sortedIndexes.begin(), sortedIndexes.end()),
+            sortedIndexes.end());
+    std::vector<Tub<HashTableBucketLock>> locks(sortedIndexes.size());
+    for (size_t i = 0; i < sortedIndexes.size(); i++)
+        locks[i].construct(*this, sortedIndexes[i]);
+
+    // opLocks[i] is the lock held for the bucket of the i'th operation.
+    std::vector<HashTableBucketLock*> opLocks(numOps);
+    for (uint32_t i = 0; i < numOps; i++) {
+        size_t slot = std::lower_bound(sortedIndexes.begin(),
+                sortedIndexes.end(), lockIndexes[i]) - sortedIndexes.begin();
+        opLocks[i] = locks[slot].get();
+    }
+
+    // Validate every operation and compute the new versions of the objects
+    // being written.
+    bool abort = false;
+    for (uint32_t i = 0; i < numOps && !abort; i++) {
+        PreparedOp& op = *ops[i].op;
+        HashTableBucketLock& lock = *opLocks[i];
+        uint16_t keyLength = 0;
+        const void* keyString = op.object.getKey(0, &keyLength);
+        Key key(op.object.getTableId(), keyString, keyLength);
+
+        // If the tablet doesn't exist in the NORMAL state, we must plead
+        // ignorance.
+        TabletManager::Tablet tablet;
+        if (!tabletManager->getTablet(key, &tablet))
+            return STATUS_UNKNOWN_TABLET;
+        if (tablet.state != TabletManager::NORMAL)
+            return STATUS_UNKNOWN_TABLET;
+
+        // If the key is locked by a prepared transaction, abort.
+        if (lockTable.isLockAcquired(key)) {
+            RAMCLOUD_LOG(DEBUG,
+                    "One-phase commit fail. Key: %.*s, object is already "
+                    "locked", keyLength,
+                    reinterpret_cast<const char*>(keyString));
+            abort = true;
+            break;
+        }
+
+        LogEntryType currentType = LOG_ENTRY_TYPE_INVALID;
+        Buffer currentBuffer;
+        Log::Reference currentReference;
+        uint64_t currentVersion = VERSION_NONEXISTENT;
+        if (lookup(lock, key, currentType, currentBuffer, 0,
+                   &currentReference)) {
+            if (currentType == LOG_ENTRY_TYPE_OBJTOMB) {
+                CleanupParameters params = { this , &lock };
+                removeIfTombstone(currentReference.toInteger(), &params);
+            } else {
+                Object currentObject(currentBuffer);
+                currentVersion = currentObject.getVersion();
+            }
+        }
+
+        Status status = rejectOperation(&ops[i].rejectRules, currentVersion);
+        if (status != STATUS_OK) {
+            RAMCLOUD_LOG(DEBUG, "One-phase commit fail. Type: %d Key: %.*s, "
+                "RejectRule outcome: %s rejectRule.givenVersion %lu "
+                "currentVersion %lu",
+                    op.header.type,
+                    keyLength, reinterpret_cast<const char*>(keyString),
+                    statusToString(status),
+                    ops[i].rejectRules.givenVersion, currentVersion);
+            abort = true;
+            break;
+        }
+
+        if (op.header.type == WireFormat::TxPrepare::WRITE) {
+            // Existing objects get a bump in version, new objects start from
+            // the next version allocated in the table.
+            op.object.setVersion((currentVersion == VERSION_NONEXISTENT) ?
+                    segmentManager.allocateVersion() : currentVersion + 1);
+            op.object.setTimestamp(WallTime::secondsTimestamp());
+        }
+    }
+
+    WireFormat::TxPrepare::Vote vote = abort ? WireFormat::TxPrepare::ABORT
+                                             : WireFormat::TxPrepare::COMMITTED;
+
+    // Assemble the log entries: for each operation, the new object (WRITE)
+    // and a tombstone for the object it replaces or removes (WRITE and
+    // REMOVE), followed by the RpcResult. The log.append below writes all
+    // of them atomically, so recovery sees either the whole transaction or
+    // none of it.
+    std::vector<Log::AppendVector> appends(3 * numOps);
+    std::vector<uint32_t> firstAppends(numOps);
+    std::vector<Log::Reference> oldReferences(numOps);
+    std::vector<bool> replaced(numOps, false);
+    uint32_t numAppends = 0;
+    uint64_t objectBytes = 0;
+    for (uint32_t i = 0; i < numOps; i++) {
+        PreparedOp& op = *ops[i].op;
+        firstAppends[i] = numAppends;
+        if (!abort && op.header.type != WireFormat::TxPrepare::READ) {
+            uint16_t keyLength = 0;
+            const void* keyString = op.object.getKey(0, &keyLength);
+            Key key(op.object.getTableId(), keyString, keyLength);
+
+            if (op.header.type == WireFormat::TxPrepare::WRITE) {
+                op.object.assembleForLog(appends[numAppends].buffer);
+                appends[numAppends].type = LOG_ENTRY_TYPE_OBJ;
+                objectBytes += appends[numAppends].buffer.size();
+                numAppends++;
+            }
+
+            LogEntryType currentType;
+            Buffer currentBuffer;
+            if (lookup(*opLocks[i], key, currentType, currentBuffer, NULL,
+                       &oldReferences[i]) &&
+                    currentType == LOG_ENTRY_TYPE_OBJ) {
+                Object currentObject(currentBuffer);
+                ObjectTombstone tombstone(currentObject,
+                        log.getSegmentId(oldReferences[i]),
+                        WallTime::secondsTimestamp());
+                tombstone.assembleForLog(appends[numAppends].buffer);
+                appends[numAppends].type = LOG_ENTRY_TYPE_OBJTOMB;
+                numAppends++;
+                replaced[i] = true;
+            }
+        }
+
+        *(reinterpret_cast<WireFormat::TxPrepare::Vote*>(
+                const_cast<void*>(ops[i].rpcResult->getResp()))) = vote;
+        ops[i].rpcResult->assembleForLog(appends[numAppends].buffer);
+        appends[numAppends].type = LOG_ENTRY_TYPE_RPCRESULT;
+        numAppends++;
+    }
+
+    // Note: only check for enough space for the objects (tombstones
+    // don't get included in the limit, since they can be cleaned).
+    if (!log.hasSpaceFor(objectBytes)) {
+        throw RetryException(HERE, 1000, 2000, "Memory capacity exceeded");
+    }
+
+    if (!log.append(&appends[0], numAppends)) {
+        // The log is out of space. Tell the client to retry and hope
+        // that the cleaner makes space soon.
+        throw RetryException(HERE, 1000, 2000, "Must wait for cleaner");
+    }
+
+    // Point the hash table at the new objects and drop the old ones.
+    for (uint32_t i = 0; i < numOps; i++) {
+        PreparedOp& op = *ops[i].op;
+        uint32_t lastAppend = (i + 1 < numOps) ? firstAppends[i + 1] - 1
+                                               : numAppends - 1;
+        ops[i].rpcResultPtr = appends[lastAppend].reference.toInteger();
+
+        uint64_t byteCount = 0;
+        for (uint32_t j = firstAppends[i]; j <= lastAppend; j++)
+            byteCount += appends[j].buffer.size();
+        TableStats::increment(masterTableMetadata,
+                              op.object.getTableId(),
+                              byteCount,
+                              lastAppend - firstAppends[i] + 1);
+
+        if (abort || op.header.type == WireFormat::TxPrepare::READ)
+            continue;
+
+        HashTableBucketLock& lock = *opLocks[i];
+        uint16_t keyLength = 0;
+        const void* keyString = op.object.getKey(0, &keyLength);
+        Key key(op.object.getTableId(), keyString, keyLength);
+
+        if (op.header.type == WireFormat::TxPrepare::WRITE) {
+            uint64_t newReference =
+                    appends[firstAppends[i]].reference.toInteger();
+            if (replaced[i]) {
+                LogEntryType currentType;
+                Buffer currentBuffer;
+                HashTable::Candidates currentHashTableEntry;
+                lookup(lock, key, currentType, currentBuffer, NULL, NULL,
+                       &currentHashTableEntry);
+                currentHashTableEntry.setReference(newReference);
+                log.free(oldReferences[i]);
+            } else {
+                objectMap.insert(key.getHash(), newReference);
+                addToTableIndex(key);
+            }
+            tabletManager->incrementWriteCount(key);
+            ++PerfStats::threadStats.writeCount;
+            uint32_t valueLength = op.object.getValueLength();
+            PerfStats::threadStats.writeObjectBytes += valueLength;
+            PerfStats::threadStats.writeKeyBytes +=
+                    op.object.getKeysAndValueLength() - valueLength;
+        } else if (replaced[i]) {
+            // The object has been removed; its tombstone is in the log.
+            Buffer oldBuffer;
+            log.getEntry(oldReferences[i], oldBuffer);
+            Object oldObject(oldBuffer);
+            segmentManager.raiseSafeVersion(oldObject.getVersion() + 1);
+            log.free(oldReferences[i]);
+            remove(lock, key);
+        }
+    }
+
+    TEST_LOG("%u log entries appended", numAppends);
+    *isCommitVote = !abort;
+    return STATUS_OK;
+}
+
 /**
  * Try to acquire transaction lock for an object.
  * This function is used while finalizing recovery.
@@ -2068,6 +2717,7 @@ ObjectManager::commitWrite(PreparedOp& op,
         log.free(oldReference);
     } else {
         objectMap.insert(key.getHash(), appends[1].reference.toInteger());
+        addToTableIndex(key);
     }
     return STATUS_OK;
 }
@@ -2153,6 +2803,7 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
                     CleanupParameters params = { this , &lock };
                     removeIfTombstone(currentReference.toInteger(), &params);
                     objectMap.insert(key.getHash(), references[i].toInteger());
+                    addToTableIndex(key);
                 }
 
                 if (currentType == LOG_ENTRY_TYPE_OBJ) {
@@ -2162,6 +2813,7 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
                 }
             } else {
                 objectMap.insert(key.getHash(), references[i].toInteger());
+                addToTableIndex(key);
             }
 
             tabletManager->incrementWriteCount(key);
@@ -2455,6 +3107,7 @@ ObjectManager::TombstoneRemover::TombstoneRemover(
                 HashTable* objectMap)
     : WorkerTimer(objectManager->context->dispatch)
     , currentBucket(0)
+    , scanNumBuckets(objectMap->getNumBuckets())
     , objectManager(objectManager)
     , objectMap(objectMap)
 {
@@ -2467,6 +3120,13 @@ ObjectManager::TombstoneRemover::TombstoneRemover(
 void
 ObjectManager::TombstoneRemover::handleTimerEvent()
 {
+    // WorkerTimers run one at a time, so the HashTableResizer can't
+    // change the bucket numbering while this method is running.
+    if (scanNumBuckets != objectMap->getNumBuckets()) {
+        scanNumBuckets = objectMap->getNumBuckets();
+        currentBucket = 0;
+    }
+
     for (int i = 0; i < 100; i++) {
         if (currentBucket >= objectMap->getNumBuckets()) {
             LOG(NOTICE, "Tombstone cleanup complete");
@@ -2509,10 +3169,63 @@ ObjectManager::TombstoneProtector::~TombstoneProtector()
     --objectManager->tombstoneProtectorCount;
     if (objectManager->tombstoneProtectorCount == 0) {
         objectManager->tombstoneRemover.currentBucket = 0;
+        objectManager->tombstoneRemover.scanNumBuckets =
+                objectManager->objectMap.getNumBuckets();
         objectManager->tombstoneRemover.start(0);
     }
 }
 
+const uint64_t ObjectManager::HashTableResizer::BUCKETS_PER_EVENT;
+const uint64_t ObjectManager::MIN_RESIZABLE_BUCKETS;
+const uint32_t ObjectManager::READ_PREFETCH_BATCH;
+
+/**
+ * Construct a HashTableResizer. It does nothing until started.
+ *
+ * \param objectManager
+ *      The ObjectManager whose #objectMap is to be resized.
+ */
+ObjectManager::HashTableResizer::HashTableResizer(
+        ObjectManager* objectManager)
+    : WorkerTimer(objectManager->context->dispatch)
+    , objectManager(objectManager)
+{
+}
+
+/**
+ * Check whether the hash table needs to be resized and, if a resize is in
+ * progress, migrate a batch of buckets. Reschedules itself immediately
+ * while a resize is in progress and periodically otherwise.
+ */
+void
+ObjectManager::HashTableResizer::handleTimerEvent()
+{
+    HashTable& objectMap = objectManager->objectMap;
+    const ServerConfig::Master& config = objectManager->config->master;
+
+    if (!objectMap.isResizing()) {
+        double loadFactor = objectMap.getLoadFactor();
+        uint64_t numBuckets = objectMap.getNumBuckets();
+        if (loadFactor > config.hashTableMaxLoadFactor) {
+            objectManager->startHashTableResize(numBuckets * 2);
+        } else if (loadFactor < config.hashTableMinLoadFactor &&
+                   loadFactor * 2 < config.hashTableMaxLoadFactor &&
+                   numBuckets / 2 >= MIN_RESIZABLE_BUCKETS) {
+            // The second condition keeps a badly chosen pair of limits from
+            // making the table oscillate between two sizes.
+            objectManager->startHashTableResize(numBuckets / 2);
+        }
+    }
+
+    if (objectMap.isResizing() &&
+            !objectManager->migrateHashTableBuckets(BUCKETS_PER_EVENT)) {
+        start(0);
+        return;
+    }
+
+    start(Cycles::rdtsc() + Cycles::fromSeconds(POLL_INTERVAL));
+}
+
 /**
  * Produce a human-readable description of the contents of a segment.
  * Intended primarily for use in unit tests.
@@ -2738,6 +3451,47 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
     return false;
 }
 
+/**
+ * Record in #tableIndex that an entry with the given key was just added to
+ * #objectMap. Does nothing unless #tableIndexEnabled. The caller must hold
+ * the key's bucket lock.
+ *
+ * \param key
+ *      Key of the object or tombstone that was added.
+ */
+void
+ObjectManager::addToTableIndex(Key& key)
+{
+    if (!tableIndexEnabled)
+        return;
+    SpinLock::Guard _(tableIndexLock);
+    tableIndex[key.getTableId()].insert(key.getHash());
+}
+
+/**
+ * Record in #tableIndex that an entry with the given key was just removed
+ * from #objectMap. Does nothing unless #tableIndexEnabled. The caller must
+ * hold the key's bucket lock.
+ *
+ * \param key
+ *      Key of the object or tombstone that was removed.
+ */
+void
+ObjectManager::removeFromTableIndex(Key& key)
+{
+    if (!tableIndexEnabled)
+        return;
+    SpinLock::Guard _(tableIndexLock);
+    auto table = tableIndex.find(key.getTableId());
+    if (table == tableIndex.end())
+        return;
+    auto it = table->second.find(key.getHash());
+    if (it != table->second.end())
+        table->second.erase(it);
+    if (table->second.empty())
+        tableIndex.erase(table);
+}
+
 /**
  * Remove an object from the hash table, if it exists in it. Return whether or
  * not it was found and removed.
@@ -2764,6 +3518,7 @@ ObjectManager::remove(HashTableBucketLock& lock, Key& key)
         Key candidateKey(type, buffer);
         if (key == candidateKey) {
             candidates.remove();
+            removeFromTableIndex(key);
             return true;
         }
         candidates.next();
@@ -2861,13 +3616,81 @@ ObjectManager::removeIfTombstone(uint64_t maybeTomb, void *cookie)
 void
 ObjectManager::removeTombstones()
 {
-    for (uint64_t i = 0; i < objectMap.getNumBuckets(); i++) {
+    cleanupHashTable(removeIfTombstone);
+}
+
+/**
+ * Apply one of the cleanup callbacks (removeIfOrphanedObject or
+ * removeIfTombstone) to every reference in the hash table, holding each
+ * bucket's lock while it is processed. If a concurrent resize renumbers
+ * the buckets, the scan starts over, so \a callback may see some
+ * references more than once.
+ *
+ * \param callback
+ *      Invoked with each reference and a CleanupParameters describing the
+ *      lock that is held.
+ */
+void
+ObjectManager::cleanupHashTable(void (*callback)(uint64_t, void *))
+{
+    uint64_t numBuckets = objectMap.getNumBuckets();
+    uint64_t i = 0;
+    while (i < numBuckets) {
         HashTableBucketLock lock(*this, i);
+        if (objectMap.getNumBuckets() != numBuckets) {
+            numBuckets = objectMap.getNumBuckets();
+            i = 0;
+            continue;
+        }
         CleanupParameters params = { this , &lock };
-        objectMap.forEachInBucket(removeIfTombstone, &params, i);
+        objectMap.forEachInBucket(callback, &params, i);
+        i++;
     }
 }
 
+/**
+ * HashTable::KeyHashFunction used when resizing #objectMap: recomputes the
+ * key hash of a hash table entry from the log entry it refers to.
+ *
+ * \param reference
+ *      Log::Reference (as an integer) of an object or tombstone.
+ * \param cookie
+ *      The Log containing the entry.
+ * \return
+ *      The hash of the entry's primary key.
+ */
+KeyHash
+ObjectManager::getReferenceKeyHash(uint64_t reference, void* cookie)
+{
+    Log* log = static_cast<Log*>(cookie);
+    Buffer buffer;
+    LogEntryType type = log->getEntry(Log::Reference(reference), buffer);
+    Key key(type, buffer);
+    return key.getHash();
+}
+
+/**
+ * Acquire every lock in #hashTableBucketLocks, in order. Used to exclude
+ * all other hash table operations while the table's bucket numbering
+ * changes at the beginning and end of a resize.
+ */
+void
+ObjectManager::lockAllHashTableBuckets()
+{
+    for (size_t i = 0; i < arrayLength(hashTableBucketLocks); i++)
+        hashTableBucketLocks[i].lock();
+}
+
+/**
+ * Release the locks acquired by #lockAllHashTableBuckets().
+ */
+void
+ObjectManager::unlockAllHashTableBuckets()
+{
+    for (size_t i = 0; i < arrayLength(hashTableBucketLocks); i++)
+        hashTableBucketLocks[i].unlock();
+}
+
 /**
  * Check a set of RejectRules against the current state of an object
  * to decide whether an operation is allowed.
@@ -3290,6 +4113,7 @@ ObjectManager::replace(HashTableBucketLock& lock, Key& key,
     }
 
     objectMap.insert(key.getHash(), reference.toInteger());
+    addToTableIndex(key);
     return false;
 }
 
@@ -16,6 +16,9 @@
 #ifndef RAMCLOUD_OBJECTMANAGER_H
 #define RAMCLOUD_OBJECTMANAGER_H
 
+#include <deque>
+#include <set>
+
 #include "Common.h"
 #include "Log.h"
 #include "SideLog.h"
@@ -38,9 +41,12 @@
 #include "MasterTableMetadata.h"
 #include "UnackedRpcResults.h"
 #include "LockTable.h"
+#include "ServerStatistics.pb.h"
 
 namespace RAMCloud {
 
+class PerfStats;
+
 /**
  * The ObjectManager class is responsible for storing objects in a master
  * server. It is essentially the union of the Log, HashTable, TabletMap,
@@ -74,6 +80,7 @@ class ObjectManager : public LogEntryHandlers,
                 uint32_t maxLength, Buffer* response, uint32_t* respNumHashes,
                 uint32_t* numObjects);
     void prefetchHashTableBucket(SegmentIterator* it);
+    void prefetchObjects(const KeyHash* keyHashes, uint32_t numHashes);
     Status readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
                 bool valueOnly = false);
@@ -81,6 +88,20 @@ class ObjectManager : public LogEntryHandlers,
                 uint64_t* outVersion, Buffer* removedObjBuffer = NULL,
                 RpcResult* rpcResult = NULL, uint64_t* rpcResultPtr = NULL);
     void removeOrphanedObjects();
+    void removeOrphanedObjects(uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash);
+    bool findTableBuckets(uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash, uint64_t numBuckets,
+                std::vector<uint64_t>* buckets);
+    std::shared_ptr<const std::vector<uint64_t>> getEnumerationBuckets(
+                uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash, uint64_t numBuckets, bool restart);
+    bool forEachInHashTableBucket(void (*callback)(uint64_t, void *),
+                void *cookie, uint64_t numBuckets, uint64_t bucket);
+    bool startHashTableResize(uint64_t numBuckets);
+    bool migrateHashTableBuckets(uint64_t maxBuckets);
+    void getHashTableStats(PerfStats* stats);
+    void getStatistics(ProtoBuf::ServerStatistics* serverStatistics);
     void replaySegment(SideLog* sideLog, SegmentIterator& it,
                 std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap);
     void replaySegment(SideLog* sideLog, SegmentIterator& it);
@@ -96,6 +117,9 @@ class ObjectManager : public LogEntryHandlers,
                 RpcResult* rpcResult, uint64_t* rpcResultPtr);
     Status prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
                 bool* isCommitVote);
+    struct TransactionOp;
+    Status commitTransaction(TransactionOp* ops, uint32_t numOps,
+                bool* isCommitVote);
     Status tryGrabTxLock(Object& objToLock, Log::Reference& ref);
     Status writeTxDecisionRecord(TxDecisionRecord& record);
     Status commitRead(PreparedOp& op, Log::Reference& refToPreparedOp);
@@ -131,6 +155,15 @@ class ObjectManager : public LogEntryHandlers,
      * If you're considering using these methods, please think twice.
      */
     Log* getLog() { return &log; }
+
+    /**
+     * Callers that read many objects at once (multiRead, readHashes) pass
+     * keys to prefetchObjects() in groups of at most this many before
+     * reading them. Larger groups risk evicting prefetched lines before they
+     * are used.
+     */
+    static const uint32_t READ_PREFETCH_BATCH = 16;
+
     ReplicaManager* getReplicaManager() { return &replicaManager; }
     HashTable* getObjectMap() { return &objectMap; }
 
@@ -154,6 +187,39 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneProtector);
     };
 
+    /**
+     * Describes one operation of a transaction committed in a single phase
+     * by commitTransaction.
+     */
+    struct TransactionOp {
+        TransactionOp()
+            : op()
+            , keyBuffer()
+            , rejectRules()
+            , rpcResult()
+            , rpcResultPtr(0)
+        {}
+
+        /// The operation. The object of a WRITE has no valid version or
+        /// timestamp until commitTransaction sets them.
+        Tub<PreparedOp> op;
+
+        /// Holds the key of a READ or REMOVE operation; #op refers to it.
+        Buffer keyBuffer;
+
+        /// Conditions under which the transaction must abort.
+        RejectRules rejectRules;
+
+        /// Linearizability record for this operation. Its response is the
+        /// transaction's vote, which commitTransaction fills in.
+        Tub<RpcResult> rpcResult;
+
+        /// Set by commitTransaction to the location of #rpcResult in the log.
+        uint64_t rpcResultPtr;
+
+        DISALLOW_COPY_AND_ASSIGN(TransactionOp);
+    };
+
   PRIVATE:
     /**
      * An instance of this class locks the bucket of the hash table that a given
@@ -262,6 +328,10 @@ class ObjectManager : public LogEntryHandlers,
         /// Which bucket of #objectMap should be cleaned out next.
         uint64_t currentBucket;
 
+        /// The value of objectMap->getNumBuckets() when the current scan
+        /// began. If a resize renumbers the buckets, the scan starts over.
+        uint64_t scanNumBuckets;
+
         /// The ObjectManager that owns the hash table to remove tombstones
         /// from in the #recoveryCleanup callback.
         ObjectManager* objectManager;
@@ -274,10 +344,43 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneRemover);
     };
 
+    /**
+     * This object executes in the background (as a WorkerTimer) to resize
+     * #objectMap when its load factor leaves the range configured by
+     * ServerConfig::Master::hashTableMaxLoadFactor and
+     * hashTableMinLoadFactor. A resize is carried out a few buckets at a
+     * time, so reads and writes proceed normally while it is underway.
+     */
+    class HashTableResizer : public WorkerTimer {
+      public:
+        explicit HashTableResizer(ObjectManager* objectManager);
+        void handleTimerEvent();
+
+      PRIVATE:
+        /// The ObjectManager whose hash table is resized.
+        ObjectManager* objectManager;
+
+        /// How often (in seconds) to check the load factor when no resize
+        /// is in progress.
+        static constexpr double POLL_INTERVAL = 1.0;
+
+        /// Number of buckets to migrate in each timer event while a resize
+        /// is in progress; small enough not to hold up other WorkerTimers.
+        static const uint64_t BUCKETS_PER_EVENT = 1000;
+
+        DISALLOW_COPY_AND_ASSIGN(HashTableResizer);
+    };
+
     static string dumpSegment(Segment* segment);
+    static KeyHash getReferenceKeyHash(uint64_t reference, void* cookie);
+    void lockAllHashTableBuckets();
+    void unlockAllHashTableBuckets();
+    void cleanupHashTable(void (*callback)(uint64_t, void *));
     uint32_t getObjectTimestamp(Buffer& buffer);
     uint32_t getTombstoneTimestamp(Buffer& buffer);
     uint32_t getTxDecisionRecordTimestamp(Buffer& buffer);
+    void addToTableIndex(Key& key);
+    void removeFromTableIndex(Key& key);
     bool lookup(HashTableBucketLock& lock, Key& key,
                 LogEntryType& outType, Buffer& buffer,
                 uint64_t* outVersion = NULL,
@@ -378,6 +481,62 @@ class ObjectManager : public LogEntryHandlers,
      */
     HashTable objectMap;
 
+    /**
+     * If true, #tableIndex is maintained so that scans of a single tablet
+     * (enumeration, and dropping orphaned objects after a tablet is dropped
+     * or migrated away) visit only the hash table buckets holding that
+     * table's entries, rather than the entire #objectMap. This costs a
+     * tree node per entry, so it is off by default.
+     */
+    bool tableIndexEnabled;
+
+    /**
+     * The key hashes of every entry (object or tombstone) in #objectMap,
+     * grouped by table id and ordered by hash. Maintained alongside
+     * #objectMap whenever an entry is added or removed (relocating an entry
+     * doesn't change its key hash). Empty unless #tableIndexEnabled.
+     */
+    std::unordered_map<uint64_t, std::multiset<KeyHash>> tableIndex;
+
+    /**
+     * Protects #tableIndex. Callers modifying it also hold the bucket lock
+     * for the key involved, so the index and #objectMap agree for any
+     * bucket whose lock is held.
+     */
+    SpinLock tableIndexLock;
+
+    /**
+     * findTableBuckets() releases #tableIndexLock after looking at this many
+     * distinct key hashes, so large tablets don't stall writers.
+     */
+    enum { TABLE_INDEX_BATCH = 1000 };
+
+    /**
+     * A list of buckets computed by getEnumerationBuckets() for the tablet
+     * and hash table size it was computed for.
+     */
+    struct EnumerationBuckets {
+        uint64_t tableId;
+        uint64_t firstKeyHash;
+        uint64_t lastKeyHash;
+        uint64_t numBuckets;
+        std::shared_ptr<const std::vector<uint64_t>> buckets;
+    };
+
+    /**
+     * Bucket lists computed by getEnumerationBuckets(), most recent first,
+     * so that the successive RPCs of an enumeration don't each have to walk
+     * the tablet's entries in #tableIndex. Holds at most
+     * MAX_ENUMERATION_BUCKETS lists.
+     */
+    std::deque<EnumerationBuckets> enumerationBuckets;
+    enum { MAX_ENUMERATION_BUCKETS = 16 };
+
+    /**
+     * Protects #enumerationBuckets.
+     */
+    SpinLock enumerationBucketsLock;
+
     /**
      * Used to identify the first write request, so that we can initialize
      * connections to all backups at that time (this is a temporary kludge
@@ -394,6 +553,15 @@ class ObjectManager : public LogEntryHandlers,
      */
     UnnamedSpinLock hashTableBucketLocks[1024];
 
+    /**
+     * The smallest number of buckets #objectMap may be resized to or from.
+     * As long as the table has at least as many buckets as there are
+     * #hashTableBucketLocks, a key's lock does not depend on the table's
+     * size, so resizing never moves a key out from under the lock that
+     * protects it.
+     */
+    static const uint64_t MIN_RESIZABLE_BUCKETS = 1024;
+
     /**
      * Locks objects during transactions.
      */
@@ -416,6 +584,19 @@ class ObjectManager : public LogEntryHandlers,
      */
     int tombstoneProtectorCount;
 
+    /**
+     * Grows and shrinks #objectMap in the background. Only started if
+     * online resizing is enabled in the configuration.
+     */
+    HashTableResizer hashTableResizer;
+
+    /**
+     * The last LogProtector epoch that an RPC could have been in when the
+     * current (or most recent) hash table resize started. The old array of
+     * buckets isn't released until all such RPCs have finished.
+     */
+    uint64_t hashTableResizeEpoch;
+
     friend class CleanerCompactionBenchmark;
     friend class ObjectManagerBenchmark;
 
@@ -25,6 +25,7 @@
 #include "MasterService.h"
 #include "MultiRead.h"
 #include "MultiWrite.h"
+#include "PerfStats.h"
 #include "RamCloud.h"
 #include "ReplicaManager.h"
 #include "SegmentManager.h"
@@ -786,6 +787,302 @@ TEST_F(ObjectManagerTest, removeOrphanedObjects) {
     EXPECT_EQ(32lu, objectManager.log.totalLiveBytes);
 }
 
+TEST_F(ObjectManagerTest, removeOrphanedObjects_tablet) {
+    objectManager.tableIndexEnabled = true;
+    tabletManager.addTablet(97, 0, ~0UL, TabletManager::NORMAL);
+    Key key1(97, "1", 1);
+    Key key2(0, "2", 1);
+    Buffer value;
+    Object obj1(key1, "hi", 2, 0, 0, value);
+    Object obj2(key2, "hi", 2, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj1, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, NULL, NULL));
+    tabletManager.deleteTablet(97, 0, ~0UL);
+    tabletManager.deleteTablet(0, 0, ~0UL);
+
+    HashTable::Candidates c;
+    objectManager.objectMap.lookup(key1.getHash(), c);
+    uint64_t ref = c.getReference();
+
+    // Only the dropped range is scanned, so the orphan in table 0
+    // survives.
+    TestLog::Enable _("removeIfOrphanedObject");
+    objectManager.removeOrphanedObjects(97, 0, ~0UL);
+    EXPECT_EQ(1U, objectManager.objectMap.getNumEntries());
+    EXPECT_EQ(0U, objectManager.tableIndex.count(97));
+    EXPECT_EQ(1U, objectManager.tableIndex[0].size());
+    EXPECT_EQ(format("removeIfOrphanedObject: removing orphaned object at "
+                     "ref %lu", ref), TestLog::get());
+
+    // Without the index, the whole hash table is scanned.
+    objectManager.tableIndexEnabled = false;
+    objectManager.removeOrphanedObjects(97, 0, ~0UL);
+    EXPECT_EQ(0U, objectManager.objectMap.getNumEntries());
+}
+
+TEST_F(ObjectManagerTest, findTableBuckets) {
+    std::vector<uint64_t> buckets;
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_FALSE(objectManager.findTableBuckets(0, 0, ~0UL, numBuckets,
+                                                &buckets));
+
+    objectManager.tableIndexEnabled = true;
+    EXPECT_TRUE(objectManager.findTableBuckets(0, 0, ~0UL, numBuckets,
+                                               &buckets));
+    EXPECT_EQ(0U, buckets.size());
+
+    Buffer value;
+    uint64_t expected[3];
+    const char* keys[] = { "a", "b", "c" };
+    for (int i = 0; i < 3; i++) {
+        Key key(0, keys[i], 1);
+        Object obj(key, "hi", 2, 0, 0, value);
+        EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+        uint64_t unused;
+        expected[i] = HashTable::findBucketIndex(numBuckets, key.getHash(),
+                                                 &unused);
+    }
+    // Overwrites don't add a second index entry.
+    Key key(0, "a", 1);
+    Object obj(key, "ho", 2, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+    EXPECT_EQ(3U, objectManager.tableIndex[0].size());
+
+    EXPECT_TRUE(objectManager.findTableBuckets(0, 0, ~0UL, numBuckets,
+                                               &buckets));
+    std::sort(expected, expected + 3);
+    EXPECT_EQ(std::vector<uint64_t>(expected, expected + 3), buckets);
+
+    // Key hash range restricts the result.
+    EXPECT_TRUE(objectManager.findTableBuckets(0, key.getHash(),
+            key.getHash(), numBuckets, &buckets));
+    uint64_t unused;
+    EXPECT_EQ(std::vector<uint64_t>(1, HashTable::findBucketIndex(
+            numBuckets, key.getHash(), &unused)), buckets);
+
+    // Other tables have nothing.
+    EXPECT_TRUE(objectManager.findTableBuckets(1, 0, ~0UL, numBuckets,
+                                               &buckets));
+    EXPECT_EQ(0U, buckets.size());
+
+    // Removal drops the index entry.
+    EXPECT_EQ(STATUS_OK, objectManager.removeObject(key, NULL, NULL));
+    EXPECT_EQ(2U, objectManager.tableIndex[0].size());
+}
+
+TEST_F(ObjectManagerTest, findTableBuckets_batches) {
+    objectManager.tableIndexEnabled = true;
+    uint64_t numBuckets = 1UL << 20;
+    int count = ObjectManager::TABLE_INDEX_BATCH * 2 + 1;
+    for (int i = 0; i < count; i++) {
+        objectManager.tableIndex[0].insert(i);
+        objectManager.tableIndex[0].insert(i);
+    }
+    std::vector<uint64_t> buckets;
+    EXPECT_TRUE(objectManager.findTableBuckets(0, 0, ~0UL, numBuckets,
+                                               &buckets));
+    ASSERT_EQ(uint64_t(count), buckets.size());
+    for (int i = 0; i < count; i++)
+        EXPECT_EQ(uint64_t(i), buckets[i]);
+}
+
+TEST_F(ObjectManagerTest, getEnumerationBuckets) {
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_TRUE(NULL == objectManager.getEnumerationBuckets(0, 0, ~0UL,
+            numBuckets, true));
+
+    objectManager.tableIndexEnabled = true;
+    Key key1(0, "a", 1);
+    Key key2(0, "b", 1);
+    Buffer value;
+    Object obj1(key1, "hi", 2, 0, 0, value);
+    Object obj2(key2, "hi", 2, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj1, NULL, NULL));
+    auto first = objectManager.getEnumerationBuckets(0, 0, ~0UL, numBuckets,
+                                                     true);
+    EXPECT_EQ(1U, first->size());
+
+    // Later calls of the same enumeration reuse the list.
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, NULL, NULL));
+    EXPECT_EQ(first, objectManager.getEnumerationBuckets(0, 0, ~0UL,
+            numBuckets, false));
+
+    // A new enumeration recomputes it, and replaces the old list.
+    auto second = objectManager.getEnumerationBuckets(0, 0, ~0UL, numBuckets,
+                                                      true);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(2U, second->size());
+    EXPECT_EQ(1U, objectManager.enumerationBuckets.size());
+    EXPECT_EQ(second, objectManager.getEnumerationBuckets(0, 0, ~0UL,
+            numBuckets, false));
+
+    // Other tablets get their own lists, up to a limit.
+    for (uint64_t i = 1; i <= ObjectManager::MAX_ENUMERATION_BUCKETS; i++)
+        objectManager.getEnumerationBuckets(i, 0, ~0UL, numBuckets, false);
+    EXPECT_EQ(size_t(ObjectManager::MAX_ENUMERATION_BUCKETS),
+              objectManager.enumerationBuckets.size());
+    EXPECT_NE(second, objectManager.getEnumerationBuckets(0, 0, ~0UL,
+            numBuckets, false));
+}
+
+static void
+forEachInHashTableBucket_count(uint64_t reference, void* cookie)
+{
+    (*static_cast<int*>(cookie))++;
+}
+
+TEST_F(ObjectManagerTest, forEachInHashTableBucket) {
+    Key key(0, "1", 1);
+    Buffer value;
+    Object obj(key, "hi", 2, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    uint64_t secondaryHash;
+    uint64_t bucket = HashTable::findBucketIndex(numBuckets, key.getHash(),
+                                                 &secondaryHash);
+    int count = 0;
+    EXPECT_TRUE(objectManager.forEachInHashTableBucket(
+            forEachInHashTableBucket_count, &count, numBuckets, bucket));
+    EXPECT_EQ(1, count);
+
+    // Stale bucket numbering.
+    count = 0;
+    EXPECT_FALSE(objectManager.forEachInHashTableBucket(
+            forEachInHashTableBucket_count, &count, numBuckets * 2, bucket));
+    EXPECT_EQ(0, count);
+}
+
+TEST_F(ObjectManagerTest, startHashTableResize) {
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_FALSE(objectManager.startHashTableResize(numBuckets));
+    EXPECT_FALSE(objectManager.startHashTableResize(
+            ObjectManager::MIN_RESIZABLE_BUCKETS / 2));
+    EXPECT_TRUE(objectManager.startHashTableResize(numBuckets * 2));
+    EXPECT_TRUE(objectManager.objectMap.isResizing());
+    EXPECT_FALSE(objectManager.startHashTableResize(numBuckets / 2));
+    EXPECT_EQ(numBuckets * 2, objectManager.objectMap.getResizeTarget());
+}
+
+TEST_F(ObjectManagerTest, migrateHashTableBuckets) {
+    EXPECT_TRUE(objectManager.migrateHashTableBuckets(10));
+
+    // Mix objects and tombstones; both must move with the table.
+    for (int i = 0; i < 200; i++) {
+        string keyString = format("%d", i);
+        Key key(0, keyString.c_str(), downCast<uint16_t>(keyString.size()));
+        Buffer value;
+        Object obj(key, "hi", 2, 0, 0, value);
+        EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+    }
+    Key tombKey(0, "tomb", 4);
+    storeTombstone(tombKey);
+    EXPECT_EQ(201U, objectManager.objectMap.getNumEntries());
+
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_TRUE(objectManager.startHashTableResize(numBuckets / 2));
+    EXPECT_FALSE(objectManager.migrateHashTableBuckets(numBuckets / 4));
+    EXPECT_EQ(numBuckets / 4,
+              objectManager.objectMap.getNumBucketsMigrated());
+    for (int i = 0; i < 200; i++) {
+        string keyString = format("%d", i);
+        Key key(0, keyString.c_str(), downCast<uint16_t>(keyString.size()));
+        Buffer value;
+        EXPECT_EQ(STATUS_OK,
+                  objectManager.readObject(key, &value, NULL, NULL));
+    }
+
+    EXPECT_TRUE(objectManager.migrateHashTableBuckets(numBuckets));
+    EXPECT_FALSE(objectManager.objectMap.isResizing());
+    EXPECT_EQ(numBuckets / 2, objectManager.objectMap.getNumBuckets());
+    EXPECT_EQ(201U, objectManager.objectMap.getNumEntries());
+    for (int i = 0; i < 200; i++) {
+        string keyString = format("%d", i);
+        Key key(0, keyString.c_str(), downCast<uint16_t>(keyString.size()));
+        Buffer value;
+        EXPECT_EQ(STATUS_OK,
+                  objectManager.readObject(key, &value, NULL, NULL, true));
+        EXPECT_EQ("hi", TestUtil::toString(&value));
+    }
+    LogEntryType type;
+    Buffer buffer;
+    ObjectManager::HashTableBucketLock lock(objectManager, tombKey);
+    EXPECT_TRUE(objectManager.lookup(lock, tombKey, type, buffer, 0, 0));
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJTOMB, type);
+}
+
+TEST_F(ObjectManagerTest, migrateHashTableBuckets_waitForOlderRpcs) {
+    LogProtector::Activity activity;
+    activity.start();
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_TRUE(objectManager.startHashTableResize(numBuckets / 2));
+
+    // An RPC that started before the resize may still be reading the old
+    // buckets without locks, so they can't be released yet.
+    EXPECT_FALSE(objectManager.migrateHashTableBuckets(numBuckets));
+    EXPECT_EQ(numBuckets / 2, objectManager.objectMap.getNumBucketsMigrated());
+    EXPECT_TRUE(objectManager.objectMap.isResizing());
+
+    activity.stop();
+    EXPECT_TRUE(objectManager.migrateHashTableBuckets(numBuckets));
+    EXPECT_FALSE(objectManager.objectMap.isResizing());
+    EXPECT_EQ(numBuckets / 2, objectManager.objectMap.getNumBuckets());
+}
+
+TEST_F(ObjectManagerTest, getStatistics) {
+    Key key(0, "1", 1);
+    Buffer value;
+    Object obj(key, "hi", 2, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_TRUE(objectManager.startHashTableResize(numBuckets * 2));
+    ProtoBuf::ServerStatistics serverStats;
+    objectManager.getStatistics(&serverStats);
+    EXPECT_EQ(numBuckets * 2, serverStats.hash_table_stats().num_buckets());
+    EXPECT_EQ(1U, serverStats.hash_table_stats().num_entries());
+    EXPECT_EQ(numBuckets * 2,
+              serverStats.hash_table_stats().resize_target_buckets());
+    EXPECT_EQ(0U, serverStats.hash_table_stats().buckets_migrated());
+
+    PerfStats stats;
+    objectManager.getHashTableStats(&stats);
+    EXPECT_EQ(numBuckets * 2, stats.hashTableBuckets);
+    EXPECT_EQ(1U, stats.hashTableEntries);
+    EXPECT_EQ(numBuckets * 2, stats.hashTableResizeTargetBuckets);
+    EXPECT_EQ(0U, stats.hashTableBucketsMigrated);
+}
+
+TEST_F(ObjectManagerTest, HashTableResizer_handleTimerEvent) {
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+
+    // Nothing to do: the table is empty and shrinking is disabled.
+    masterConfig.master.hashTableMaxLoadFactor = 0.75;
+    objectManager.hashTableResizer.handleTimerEvent();
+    EXPECT_FALSE(objectManager.objectMap.isResizing());
+    EXPECT_EQ(numBuckets, objectManager.objectMap.getNumBuckets());
+
+    // Shrink: migration proceeds in batches until the resize completes.
+    masterConfig.master.hashTableMinLoadFactor = 0.1;
+    objectManager.hashTableResizer.handleTimerEvent();
+    EXPECT_TRUE(objectManager.objectMap.isResizing());
+    EXPECT_EQ(ObjectManager::HashTableResizer::BUCKETS_PER_EVENT,
+              objectManager.objectMap.getNumBucketsMigrated());
+    while (objectManager.objectMap.isResizing())
+        objectManager.hashTableResizer.handleTimerEvent();
+    EXPECT_EQ(numBuckets / 2, objectManager.objectMap.getNumBuckets());
+
+    // Grow once the load factor is exceeded.
+    masterConfig.master.hashTableMinLoadFactor = 0;
+    masterConfig.master.hashTableMaxLoadFactor = 1e-6;
+    Key key(0, "1", 1);
+    Buffer value;
+    Object obj(key, "hi", 2, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+    objectManager.hashTableResizer.handleTimerEvent();
+    EXPECT_EQ(numBuckets, objectManager.objectMap.getResizeTarget());
+}
+
 TEST_F(ObjectManagerTest, replaySegment_nextNodeIdMap) {
     ObjectManager::TombstoneProtector p(&objectManager);
     uint32_t segLen = 8192;
@@ -1287,8 +1584,9 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
     uint64_t deadRpcId = 3;
 
     UnackedRpcResults *unackedRpcResults = objectManager.unackedRpcResults;
-    EXPECT_EQ(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
+    UnackedRpcResults::ClientMap& clients =
+            unackedRpcResults->getShard(expectedLeaseId).clients;
+    EXPECT_EQ(clients.end(), clients.find(expectedLeaseId));
 
     {
         SegmentCertificate certificate;
@@ -1300,9 +1598,8 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
 
     objectManager.replaySegment(&sl, *it);
 
-    EXPECT_NE(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
-    EXPECT_EQ(1U, unackedRpcResults->clients.size());
+    EXPECT_NE(clients.end(), clients.find(expectedLeaseId));
+    EXPECT_EQ(1U, unackedRpcResults->getClientCount());
 
     // Test noop case.
 
@@ -1316,9 +1613,8 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
 
     objectManager.replaySegment(&sl, *it);
 
-    EXPECT_NE(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
-    EXPECT_EQ(1U, unackedRpcResults->clients.size());
+    EXPECT_NE(clients.end(), clients.find(expectedLeaseId));
+    EXPECT_EQ(1U, unackedRpcResults->getClientCount());
 }
 
 TEST_F(ObjectManagerTest, replaySegment_preparedOp_basics) {
@@ -1564,7 +1860,8 @@ TEST_F(ObjectManagerTest, replaySegment_ParticipantList) {
     TransactionId txId = record.getTransactionId();
 
     {
-        TransactionManager::Lock lock(transactionManager->mutex);
+        TransactionManager::Lock lock(
+                transactionManager->getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager->getTransaction(txId, lock) == NULL);
     }
 
@@ -1578,7 +1875,8 @@ TEST_F(ObjectManagerTest, replaySegment_ParticipantList) {
     objectManager.replaySegment(&sl, *it);
 
     {
-        TransactionManager::Lock lock(transactionManager->mutex);
+        TransactionManager::Lock lock(
+                transactionManager->getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager->getTransaction(txId, lock) != NULL);
     }
 
@@ -1751,6 +2049,175 @@ TEST_F(ObjectManagerTest, prepareOp) {
     objectManager.getLog()->totalLiveBytes = original;
 }
 
+// Fill in one operation of a transaction for commitTransaction.
+static void
+setTransactionOp(ObjectManager::TransactionOp* op,
+        WireFormat::TxPrepare::OpType type, Key& key, const char* value,
+        uint64_t rpcId, RejectRules rejectRules,
+        WireFormat::TxPrepare::Vote* vote)
+{
+    op->op.construct(type, 1, 10, rpcId, key, value, downCast<uint32_t>(
+            strlen(value)), 0, 0, op->keyBuffer);
+    op->rejectRules = rejectRules;
+    op->rpcResult.construct(key.getTableId(), key.getHash(), 1, rpcId, 9,
+            vote, sizeof32(*vote));
+}
+
+// Return the vote recorded in the RpcResult at a given log location.
+static WireFormat::TxPrepare::Vote
+getLoggedVote(ObjectManager* objectManager, uint64_t rpcResultPtr)
+{
+    Buffer buffer;
+    objectManager->getLog()->getEntry(Log::Reference(rpcResultPtr), buffer);
+    RpcResult rpcResult(buffer);
+    return *reinterpret_cast<const WireFormat::TxPrepare::Vote*>(
+            rpcResult.getResp());
+}
+
+TEST_F(ObjectManagerTest, commitTransaction_commit) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    Key key2(1, "2", 1);
+    Key key3(1, "3", 1);
+    Key key4(1, "4", 1);
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    storeObject(key1, "read", 1);
+    storeObject(key2, "remove", 2);
+    storeObject(key3, "old", 3);
+
+    RejectRules rejectRules;
+    memset(&rejectRules, 0, sizeof(rejectRules));
+    TxPrepare::Vote vote = TxPrepare::PREPARED;
+    ObjectManager::TransactionOp ops[4];
+    setTransactionOp(&ops[0], TxPrepare::READ, key1, "", 10, rejectRules,
+            &vote);
+    setTransactionOp(&ops[1], TxPrepare::REMOVE, key2, "", 11, rejectRules,
+            &vote);
+    setTransactionOp(&ops[2], TxPrepare::WRITE, key3, "new", 12,
+            rejectRules, &vote);
+    setTransactionOp(&ops[3], TxPrepare::WRITE, key4, "fresh", 13,
+            rejectRules, &vote);
+
+    TestLog::Enable _("commitTransaction");
+    bool isCommit = false;
+    EXPECT_EQ(STATUS_OK, objectManager.commitTransaction(ops, 4, &isCommit));
+    EXPECT_TRUE(isCommit);
+    // 2 new objects, 2 tombstones and 4 RpcResults, in one append.
+    EXPECT_EQ("commitTransaction: 8 log entries appended", TestLog::get());
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(TxPrepare::COMMITTED,
+                getLoggedVote(&objectManager, ops[i].rpcResultPtr));
+    }
+
+    Buffer value;
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key1, &value, 0, &version,
+            true));
+    EXPECT_EQ("read", TestUtil::toString(&value));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, objectManager.readObject(key2,
+            &value, 0, 0));
+    value.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key3, &value, 0, &version,
+            true));
+    EXPECT_EQ("new", TestUtil::toString(&value));
+    EXPECT_EQ(4U, version);
+    value.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key4, &value, 0, &version,
+            true));
+    EXPECT_EQ("fresh", TestUtil::toString(&value));
+
+    // Nothing is left locked.
+    EXPECT_FALSE(objectManager.lockTable.isLockAcquired(key3));
+    EXPECT_FALSE(objectManager.lockTable.isLockAcquired(key4));
+}
+
+TEST_F(ObjectManagerTest, commitTransaction_rejectRules) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    Key key2(1, "2", 1);
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    storeObject(key1, "old1", 1);
+    storeObject(key2, "old2", 2);
+
+    RejectRules rejectRules;
+    memset(&rejectRules, 0, sizeof(rejectRules));
+    TxPrepare::Vote vote = TxPrepare::PREPARED;
+    ObjectManager::TransactionOp ops[2];
+    setTransactionOp(&ops[0], TxPrepare::WRITE, key1, "new1", 10,
+            rejectRules, &vote);
+    rejectRules.givenVersion = 1;
+    rejectRules.versionNeGiven = true;
+    setTransactionOp(&ops[1], TxPrepare::WRITE, key2, "new2", 11,
+            rejectRules, &vote);
+
+    TestLog::Enable _("commitTransaction");
+    bool isCommit = true;
+    EXPECT_EQ(STATUS_OK, objectManager.commitTransaction(ops, 2, &isCommit));
+    EXPECT_FALSE(isCommit);
+    // Only the RpcResults are logged.
+    EXPECT_EQ("commitTransaction: One-phase commit fail. Type: 3 Key: 2, "
+            "RejectRule outcome: object has wrong version "
+            "rejectRule.givenVersion 1 currentVersion 2 | "
+            "commitTransaction: 2 log entries appended", TestLog::get());
+    EXPECT_EQ(TxPrepare::ABORT,
+            getLoggedVote(&objectManager, ops[0].rpcResultPtr));
+    EXPECT_EQ(TxPrepare::ABORT,
+            getLoggedVote(&objectManager, ops[1].rpcResultPtr));
+
+    Buffer value;
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key1, &value, 0, &version,
+            true));
+    EXPECT_EQ("old1", TestUtil::toString(&value));
+    EXPECT_EQ(1U, version);
+}
+
+TEST_F(ObjectManagerTest, commitTransaction_lockedObject) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    storeObject(key1, "old");
+    Log::Reference lockRef = storePreparedOp(key1);
+    EXPECT_TRUE(objectManager.lockTable.tryAcquireLock(key1, lockRef));
+
+    RejectRules rejectRules;
+    memset(&rejectRules, 0, sizeof(rejectRules));
+    TxPrepare::Vote vote = TxPrepare::PREPARED;
+    ObjectManager::TransactionOp ops[1];
+    setTransactionOp(&ops[0], TxPrepare::WRITE, key1, "new", 10,
+            rejectRules, &vote);
+    bool isCommit = true;
+    EXPECT_EQ(STATUS_OK, objectManager.commitTransaction(ops, 1, &isCommit));
+    EXPECT_FALSE(isCommit);
+    EXPECT_EQ(TxPrepare::ABORT,
+            getLoggedVote(&objectManager, ops[0].rpcResultPtr));
+}
+
+TEST_F(ObjectManagerTest, commitTransaction_unknownTablet) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    Key key2(2, "2", 1);
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+
+    RejectRules rejectRules;
+    memset(&rejectRules, 0, sizeof(rejectRules));
+    TxPrepare::Vote vote = TxPrepare::PREPARED;
+    ObjectManager::TransactionOp ops[2];
+    setTransactionOp(&ops[0], TxPrepare::WRITE, key1, "new", 10,
+            rejectRules, &vote);
+    setTransactionOp(&ops[1], TxPrepare::WRITE, key2, "new", 11,
+            rejectRules, &vote);
+    TestLog::Enable _("commitTransaction");
+    bool isCommit = true;
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET,
+            objectManager.commitTransaction(ops, 2, &isCommit));
+    EXPECT_FALSE(isCommit);
+    EXPECT_EQ("", TestLog::get());
+    Buffer value;
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, objectManager.readObject(key1,
+            &value, 0, 0));
+}
+
 TEST_F(ObjectManagerTest, writeTxDecisionRecord) {
     TxDecisionRecord record(1, 2, 21, 1, WireFormat::TxDecision::ABORT, 50);
     record.addParticipant(1, 2, 3);
@@ -3133,7 +3600,8 @@ TEST_F(ObjectManagerTest, relocateTxParticipantList) {
                                            objectManager.getLog());
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getTransaction(txId, lock);
         EXPECT_TRUE(transaction != NULL);
     }
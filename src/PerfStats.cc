@@ -90,10 +90,17 @@ PerfStats::collectStats(PerfStats* total)
         total->logBytesAppended += stats->logBytesAppended;
         total->replicationRpcs += stats->replicationRpcs;
         total->logSyncCycles += stats->logSyncCycles;
+        total->logSyncBatches += stats->logSyncBatches;
+        total->logSyncBatchedRequests += stats->logSyncBatchedRequests;
         total->segmentUnopenedCycles += stats->segmentUnopenedCycles;
         total->workerActiveCycles += stats->workerActiveCycles;
+        total->stolenRpcs += stats->stolenRpcs;
+        total->inlineRpcs += stats->inlineRpcs;
+        total->handedOffRpcs += stats->handedOffRpcs;
         total->btreeNodeReads += stats->btreeNodeReads;
+        total->btreeNodeCacheHits += stats->btreeNodeCacheHits;
         total->btreeNodeWrites += stats->btreeNodeWrites;
+        total->btreeLeafDeltaWrites += stats->btreeLeafDeltaWrites;
         total->btreeBytesRead += stats->btreeBytesRead;
         total->btreeBytesWritten += stats->btreeBytesWritten;
         total->btreeNodeSplits += stats->btreeNodeSplits;
@@ -173,6 +180,12 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "Worker load factor",
             formatMetricRatio(&diff, "workerActiveCycles", "collectionTime",
             " %8.3f").c_str()));
+    result.append(format("%-30s %s\n", "Stolen RPCs (K)",
+            formatMetric(&diff, "stolenRpcs", " %8.1f", 1e-3).c_str()));
+    result.append(format("%-30s %s\n", "Inline RPCs (K)",
+            formatMetric(&diff, "inlineRpcs", " %8.1f", 1e-3).c_str()));
+    result.append(format("%-30s %s\n", "Handed-off RPCs (K)",
+            formatMetric(&diff, "handedOffRpcs", " %8.1f", 1e-3).c_str()));
 
     result.append("\nReads:\n");
     result.append(format("%-30s %s\n", "  Objects read (K)",
@@ -218,6 +231,9 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "  Log sync load factor",
             formatMetricRatio(&diff, "logSyncCycles",
             "collectionTime", " %8.2f").c_str()));
+    result.append(format("%-30s %s\n", "  Writes per log sync batch",
+            formatMetricRatio(&diff, "logSyncBatchedRequests",
+            "logSyncBatches", " %8.2f").c_str()));
     result.append(format("%-30s %s\n", "  Segment unopened time (%)",
             formatMetricRatio(&diff, "segmentUnopenedCycles",
             "collectionTime", " %8.2f", 100).c_str()));
@@ -257,8 +273,12 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append("\nIndex B+ Tree Operations:\n");
     result.append(format("%-30s %s\n", "  Node reads",
             formatMetric(&diff, "btreeNodeReads", " %8.0f").c_str()));
+    result.append(format("%-30s %s\n", "  Node cache hits",
+            formatMetric(&diff, "btreeNodeCacheHits", " %8.0f").c_str()));
     result.append(format("%-30s %s\n", "  Node writes",
             formatMetric(&diff, "btreeNodeWrites", " %8.0f").c_str()));
+    result.append(format("%-30s %s\n", "  Leaf delta writes",
+            formatMetric(&diff, "btreeLeafDeltaWrites", " %8.0f").c_str()));
     result.append(format("%-30s %s\n", "  Bytes read for nodes (KB)",
             formatMetric(&diff, "btreeBytesRead", " %8.3f", 1e-3).c_str()));
     result.append(format("%-30s %s\n", "  Bytes written for nodes (KB)",
@@ -372,8 +392,13 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(writeKeyBytes);
         ADD_METRIC(dispatchActiveCycles);
         ADD_METRIC(workerActiveCycles);
+        ADD_METRIC(stolenRpcs);
+        ADD_METRIC(inlineRpcs);
+        ADD_METRIC(handedOffRpcs);
         ADD_METRIC(btreeNodeReads);
+        ADD_METRIC(btreeNodeCacheHits);
         ADD_METRIC(btreeNodeWrites);
+        ADD_METRIC(btreeLeafDeltaWrites);
         ADD_METRIC(btreeBytesRead);
         ADD_METRIC(btreeBytesWritten);
         ADD_METRIC(btreeNodeSplits);
@@ -382,6 +407,8 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(logBytesAppended);
         ADD_METRIC(replicationRpcs);
         ADD_METRIC(logSyncCycles);
+        ADD_METRIC(logSyncBatches);
+        ADD_METRIC(logSyncBatchedRequests);
         ADD_METRIC(segmentUnopenedCycles);
         ADD_METRIC(compactorInputBytes);
         ADD_METRIC(compactorSurvivorBytes);
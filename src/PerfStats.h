@@ -89,6 +89,18 @@ struct PerfStats {
     /// as a worker.
     uint64_t workerActiveCycles;
 
+    /// Total number of RPCs that a stealing thread took from another
+    /// stealing thread's queue (see WorkerManager::StealingCore).
+    uint64_t stolenRpcs;
+
+    /// Total number of RPCs executed directly by the dispatch thread
+    /// (see WorkerManager::inlineRpcs).
+    uint64_t inlineRpcs;
+
+    /// Total number of RPCs that the dispatch thread handed off to another
+    /// thread (worker or stealing thread) for execution.
+    uint64_t handedOffRpcs;
+
     //--------------------------------------------------------------------
     // Statistics for index operations. Only one copy of PerfStats is
     // kept for all indexing structures, so the numbers below are
@@ -98,10 +110,18 @@ struct PerfStats {
     /// nodes along the search/write paths) and split/join/re-balance operations
     uint64_t btreeNodeReads;
 
+    /// Number of btreeNodeReads satisfied from the B+ tree's cache of
+    /// decoded inner nodes, without an ObjectManager lookup.
+    uint64_t btreeNodeCacheHits;
+
     /// Total number of B+ Tree nodes written (includes leaf inserts and
     /// split/join/re-balance operations)
     uint64_t btreeNodeWrites;
 
+    /// Number of leaf changes logged as deltas (a single inserted or erased
+    /// entry) rather than as full node images; not part of btreeNodeWrites.
+    uint64_t btreeLeafDeltaWrites;
+
     /// Total number of bytes read by the B+ tree corresponding with nodeReads
     uint64_t btreeBytesRead;
 
@@ -138,6 +158,15 @@ struct PerfStats {
     /// at twice real time).
     uint64_t logSyncCycles;
 
+    /// Number of times the log head was replicated on behalf of log syncs
+    /// (each replication may cover durable writes from several threads;
+    /// see Log::setGroupCommitWindow).
+    uint64_t logSyncBatches;
+
+    /// Total number of sync requests covered by the replications counted
+    /// in logSyncBatches.
+    uint64_t logSyncBatchedRequests;
+
     /// Total time (in cycles) spent by segments in a state where they have
     /// at least one replica that has not yet been successfully opened. If
     /// this value is significant, it probably means that backups don't have
@@ -264,6 +293,26 @@ struct PerfStats {
     /// Backup disk spaces spent for holding replicas for data of this server.
     uint64_t logUsedBytesInBackups;
 
+    //--------------------------------------------------------------------
+    // Statistics for the master's object hash table. Like the log memory
+    // statistics above, these are not counters; they are filled in by
+    // ObjectManager::getHashTableStats().
+    //--------------------------------------------------------------------
+
+    /// Number of buckets in the hash table (the target size, if a resize
+    /// is in progress).
+    uint64_t hashTableBuckets;
+
+    /// Number of objects and tombstones referenced by the hash table.
+    uint64_t hashTableEntries;
+
+    /// If the hash table is being resized, the number of buckets it is
+    /// being resized to; otherwise 0.
+    uint64_t hashTableResizeTargetBuckets;
+
+    /// Number of buckets moved so far by the resize in progress, if any.
+    uint64_t hashTableBucketsMigrated;
+
     //--------------------------------------------------------------------
     // Temporary counters. The values below have no pre-defined use;
     // they are intended for temporary use during debugging or performance
@@ -335,8 +335,9 @@ DropTableRpc::DropTableRpc(RamCloud* ramcloud, const char* name)
  * contain secondary keys corresponding to the new index;
  * these objects will not automatically be indexed.
  * To make these objects accessible via the index, the application must
- * rewrite them (for example, by enumerating all of the objects in the table
- * and rewriting each object with a key for the new index).
+ * either call #buildIndex once the index has been created, or rewrite them
+ * (for example, by enumerating all of the objects in the table and rewriting
+ * each object with a key for the new index).
  *
  * \param tableId
  *      Id of the table to which the index belongs.
@@ -395,6 +396,113 @@ CreateIndexRpc::CreateIndexRpc(RamCloud* ramcloud, uint64_t tableId,
     send();
 }
 
+/**
+ * Add index entries for the objects already in a table. Each master
+ * that owns a tablet of the table scans its objects for keys belonging
+ * to the index and sends the resulting entries to the index servers in
+ * sorted batches, which is much faster than rewriting each object.
+ * Large tablets are scanned a part at a time, by successive RPCs.
+ *
+ * Objects written after the index was created are indexed as usual, and
+ * the entries for them are skipped when they turn up again here. However,
+ * the table's objects shouldn't be overwritten or removed while this
+ * method runs. The entries this method sends are copied from the objects
+ * as they were when scanned, so a racing overwrite or removal can leave
+ * the index with an entry for a key the object no longer has (lookups
+ * ignore it, but it is never reclaimed), or without the entry for the
+ * object's new key.
+ *
+ * \param tableId
+ *      Id of the table to which the index belongs.
+ * \param indexId
+ *      Id of the secondary keys corresponding to the index. The index must
+ *      already have been created with #createIndex.
+ * \return
+ *      The number of objects in the table that had a key for the index.
+ *      If a master's hash table was resized during the build, objects it
+ *      scanned twice are counted twice.
+ */
+uint64_t
+RamCloud::buildIndex(uint64_t tableId, uint8_t indexId)
+{
+    uint64_t numObjects = 0;
+    uint64_t keyHash = 0;
+    uint64_t nextBucket = 0;
+    uint64_t numBuckets = 0;
+    do {
+        BuildIndexRpc rpc(this, tableId, indexId, keyHash, nextBucket,
+                numBuckets);
+        numObjects += rpc.wait(&keyHash, &nextBucket, &numBuckets);
+    } while (keyHash != 0 || numBuckets != 0);
+    return numObjects;
+}
+
+/**
+ * Constructor for BuildIndexRpc: initiates an RPC that builds the index
+ * for a single tablet, or the next part of it, but returns once the RPC
+ * has been initiated, without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      Id of the table to which the index belongs.
+ * \param indexId
+ *      Id of the secondary keys corresponding to the index.
+ * \param keyHash
+ *      Any key hash in the tablet whose objects should be indexed.
+ * \param nextBucket
+ *      Where to resume indexing the tablet, as returned by the wait() of
+ *      the previous RPC; 0 to start at the beginning of the tablet.
+ * \param numBuckets
+ *      As returned by the wait() of the previous RPC; 0 to start at the
+ *      beginning of the tablet.
+ */
+BuildIndexRpc::BuildIndexRpc(RamCloud* ramcloud, uint64_t tableId,
+        uint8_t indexId, uint64_t keyHash, uint64_t nextBucket,
+        uint64_t numBuckets)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, keyHash,
+            sizeof(WireFormat::BuildIndex::Response))
+{
+    WireFormat::BuildIndex::Request* reqHdr(
+            allocHeader<WireFormat::BuildIndex>());
+    reqHdr->tableId = tableId;
+    reqHdr->indexId = indexId;
+    reqHdr->keyHash = keyHash;
+    reqHdr->nextBucket = nextBucket;
+    reqHdr->numBuckets = numBuckets;
+    send();
+}
+
+/**
+ * Wait for a buildIndex RPC to complete.
+ *
+ * \param[out] nextKeyHash
+ *      Set to the keyHash for the next RPC: a key hash in the same tablet
+ *      if \a numBuckets is nonzero, otherwise the first key hash of the
+ *      next tablet to index, or 0 if this tablet was the last one in the
+ *      table.
+ * \param[out] nextBucket
+ *      Set to the nextBucket for the next RPC.
+ * \param[out] numBuckets
+ *      Set to the numBuckets for the next RPC; 0 means the tablet has
+ *      been indexed completely.
+ * \return
+ *      The number of objects found by this RPC that had a key for the
+ *      index.
+ */
+uint64_t
+BuildIndexRpc::wait(uint64_t* nextKeyHash, uint64_t* nextBucket,
+        uint64_t* numBuckets)
+{
+    simpleWait(context);
+    const WireFormat::BuildIndex::Response* respHdr(
+            getResponseHeader<WireFormat::BuildIndex>());
+    *nextKeyHash = respHdr->nextKeyHash;
+    *nextBucket = respHdr->nextBucket;
+    *numBuckets = respHdr->numBuckets;
+    return respHdr->numObjects;
+}
+
 /**
  * Delete an index.
  *
@@ -73,6 +73,7 @@ class RamCloud {
     void dropTable(const char* name);
     void createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
             uint8_t numIndexlets = 1);
+    uint64_t buildIndex(uint64_t tableId, uint8_t indexId);
     void dropIndex(uint64_t tableId, uint8_t indexId);
     void echo(const char* serviceLocator, const void* message, uint32_t length,
          uint32_t echoLength, Buffer* echo);
@@ -265,6 +266,23 @@ class CreateIndexRpc : public CoordinatorRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(CreateIndexRpc);
 };
 
+/**
+ * Encapsulates the state of one step of a RamCloud::buildIndex operation,
+ * which indexes part or all of one tablet, allowing it to execute
+ * asynchronously.
+ */
+class BuildIndexRpc : public ObjectRpcWrapper {
+  public:
+    BuildIndexRpc(RamCloud* ramcloud, uint64_t tableId, uint8_t indexId,
+            uint64_t keyHash, uint64_t nextBucket, uint64_t numBuckets);
+    ~BuildIndexRpc() {}
+    uint64_t wait(uint64_t* nextKeyHash, uint64_t* nextBucket,
+            uint64_t* numBuckets);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(BuildIndexRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::dropIndex operation,
  * allowing it to execute asynchronously.
@@ -151,6 +151,84 @@ TEST_F(RamCloudTest, dropIndex) {
     EXPECT_EQ("dropIndex: Dropping index '1' from table '1'", TestLog::get());
 }
 
+TEST_F(RamCloudTest, buildIndex) {
+    uint64_t tableId = ramcloud->createTable("indexed", 2);
+
+    // Objects written before the index exists aren't indexed.
+    for (int i = 0; i < 20; i++) {
+        string primary = format("obj%02d", i);
+        string secondary = format("key%02d", 19 - i);
+        KeyInfo keyList[2];
+        keyList[0].key = primary.c_str();
+        keyList[0].keyLength = downCast<uint16_t>(primary.size());
+        keyList[1].key = secondary.c_str();
+        keyList[1].keyLength = downCast<uint16_t>(secondary.size());
+        ramcloud->write(tableId, 2, keyList, "value");
+    }
+    ramcloud->write(tableId, "noSecondaryKey", 14, "value");
+    ramcloud->createIndex(tableId, 1, 0);
+
+    Buffer lookupResp;
+    uint32_t numHashes;
+    uint16_t nextKeyLength;
+    uint64_t nextKeyHash;
+    ramcloud->lookupIndexKeys(tableId, 1, "key00", 5, 0, "key99", 5, 100,
+            &lookupResp, &numHashes, &nextKeyLength, &nextKeyHash);
+    EXPECT_EQ(0U, numHashes);
+
+    EXPECT_EQ(20U, ramcloud->buildIndex(tableId, 1));
+    ramcloud->lookupIndexKeys(tableId, 1, "key00", 5, 0, "key99", 5, 100,
+            &lookupResp, &numHashes, &nextKeyLength, &nextKeyHash);
+    EXPECT_EQ(20U, numHashes);
+    ramcloud->lookupIndexKeys(tableId, 1, "key19", 5, 0, "key19", 5, 100,
+            &lookupResp, &numHashes, &nextKeyLength, &nextKeyHash);
+    EXPECT_EQ(1U, numHashes);
+    EXPECT_EQ(Key(tableId, "obj00", 5).getHash(),
+            *lookupResp.getOffset<uint64_t>(
+            sizeof32(WireFormat::LookupIndexKeys::Response)));
+
+    // An index with no keys in the table.
+    ramcloud->createIndex(tableId, 2, 0);
+    EXPECT_EQ(0U, ramcloud->buildIndex(tableId, 2));
+}
+
+TEST_F(RamCloudTest, buildIndex_severalRpcsPerTablet) {
+    foreach (Server* server, cluster.servers) {
+        if (server->master)
+            server->master->maxBuildIndexEntries = 3;
+    }
+    uint64_t tableId = ramcloud->createTable("indexed", 2);
+    for (int i = 0; i < 20; i++) {
+        string primary = format("obj%02d", i);
+        string secondary = format("key%02d", i);
+        KeyInfo keyList[2];
+        keyList[0].key = primary.c_str();
+        keyList[0].keyLength = downCast<uint16_t>(primary.size());
+        keyList[1].key = secondary.c_str();
+        keyList[1].keyLength = downCast<uint16_t>(secondary.size());
+        ramcloud->write(tableId, 2, keyList, "value");
+    }
+    ramcloud->createIndex(tableId, 1, 0);
+
+    // An object written after the index was created is indexed as usual;
+    // the build doesn't index it again.
+    KeyInfo keyList[2];
+    keyList[0].key = "obj20";
+    keyList[0].keyLength = 5;
+    keyList[1].key = "key20";
+    keyList[1].keyLength = 5;
+    ramcloud->write(tableId, 2, keyList, "value");
+
+    EXPECT_EQ(21U, ramcloud->buildIndex(tableId, 1));
+    Buffer lookupResp;
+    uint32_t numHashes;
+    uint16_t nextKeyLength;
+    uint64_t nextKeyHash;
+    ramcloud->lookupIndexKeys(tableId, 1, "key00", 5, 0, "key99", 5, 100,
+            &lookupResp, &numHashes, &nextKeyLength, &nextKeyHash);
+    EXPECT_EQ(21U, numHashes);
+}
+
 TEST_F(RamCloudTest, concurrentAsyncRpc) {
     string message1("no exception");
     try {
@@ -71,133 +71,256 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
     // Buffer must be retained for iteration to provide storage for header.
     Buffer headerBuffer;
     const SegmentHeader* header = NULL;
-    for (; !it.isDone(); it.next()) {
-        LogEntryType type = it.getType();
+    for (; !it.isDone(); it.next())
+        partitionEntry(it, headerBuffer, header, numPartitions, partitions,
+                       recoverySegments);
+}
 
-        if (type == LOG_ENTRY_TYPE_SEGHEADER) {
-            it.appendToBuffer(headerBuffer);
-            header = headerBuffer.getStart<SegmentHeader>();
-            continue;
-        }
-        if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB
-            && type != LOG_ENTRY_TYPE_SAFEVERSION
-            && type != LOG_ENTRY_TYPE_RPCRESULT
-            && type != LOG_ENTRY_TYPE_PREP
-            && type != LOG_ENTRY_TYPE_PREPTOMB
-            && type != LOG_ENTRY_TYPE_TXDECISION
-            && type != LOG_ENTRY_TYPE_TXPLIST)
-            continue;
+/**
+ * Same as build(), except that partitioning starts before all of the
+ * replica has been loaded into \a buffer: entries are processed in order
+ * as the bytes holding them arrive, as reported by \a waitForData. The
+ * integrity of the replica metadata can only be checked once all of it has
+ * arrived, so callers must not use \a recoverySegments unless this returns
+ * without throwing.
+ *
+ * \param buffer
+ *      Region of \a length bytes into which the replica is being loaded.
+ * \param length
+ *      Bytes which will contain replica data starting at \a buffer once the
+ *      replica is fully loaded.
+ * \param certificate
+ *      See build().
+ * \param numPartitions
+ *      See build().
+ * \param partitions
+ *      See build().
+ * \param recoverySegments
+ *      See build().
+ * \param waitForData
+ *      Called with a byte count no larger than \a length; must block until
+ *      at least that many bytes at the start of \a buffer have been loaded
+ *      and return the number of bytes loaded so far. May throw to abandon
+ *      the build.
+ * \throw SegmentIteratorException
+ *      See build().
+ * \throw SegmentRecoveryFailedException
+ *      See build().
+ */
+void
+RecoverySegmentBuilder::buildStreaming(
+        const void* buffer, uint32_t length,
+        const SegmentCertificate& certificate,
+        int numPartitions,
+        const ProtoBuf::RecoveryPartition& partitions,
+        Segment* recoverySegments,
+        const WaitForData& waitForData)
+{
+    // Most bytes needed to decode the type and length of an entry.
+    const uint32_t maxEntryPrefix = sizeof32(Segment::EntryHeader) +
+                                    sizeof32(uint32_t);
+    const uint32_t segmentLength = certificate.segmentLength;
+    const uint32_t end = std::min(segmentLength, length);
+
+    // Once the whole replica is in memory its metadata is checked just like
+    // build() does; this is also done early if anything looks wrong, so
+    // that a corrupt replica is reported the same way in both cases.
+    bool verified = false;
+    auto verify = [&] () {
+        waitForData(end);
+        SegmentIterator(buffer, length, certificate).checkMetadataIntegrity();
+        verified = true;
+    };
+
+    uint32_t available = waitForData(std::min(end, maxEntryPrefix));
+    if (segmentLength > length)
+        verify();
+    SegmentIterator it(buffer, length, certificate);
 
-        if (header == NULL) {
-            DIE("Found log entry before header while "
-                "building recovery segments");
+    // Buffer must be retained for iteration to provide storage for header.
+    Buffer headerBuffer;
+    const SegmentHeader* header = NULL;
+    while (!it.isDone()) {
+        uint32_t offset = it.getOffset();
+        if (!verified) {
+            const Segment::EntryHeader* entryHeader =
+                reinterpret_cast<const Segment::EntryHeader*>(
+                    static_cast<const char*>(buffer) + offset);
+            uint64_t nextOffset = uint64_t(offset) +
+                                  sizeof32(Segment::EntryHeader) +
+                                  entryHeader->getLengthBytes() +
+                                  it.getLength();
+            if (nextOffset > segmentLength ||
+                (header == NULL &&
+                 it.getType() != LOG_ENTRY_TYPE_SEGHEADER)) {
+                verify();
+            } else {
+                // Wait for this entry along with the type and length of the
+                // next one, which it.next() reads.
+                uint32_t needed = downCast<uint32_t>(std::min(uint64_t(end),
+                        nextOffset + maxEntryPrefix));
+                if (available < needed)
+                    available = waitForData(needed);
+            }
         }
+        partitionEntry(it, headerBuffer, header, numPartitions, partitions,
+                       recoverySegments);
+        it.next();
+    }
+    if (!verified)
+        verify();
+}
 
-        Buffer entryBuffer;
-        it.appendToBuffer(entryBuffer);
+/**
+ * Append the entry at the current position of \a it to the recovery
+ * segments it belongs in, if any; the guts of build() and buildStreaming().
+ *
+ * \param it
+ *      Iterator positioned at the entry to partition.
+ * \param headerBuffer
+ *      Holds a copy of the replica's segment header once it has been found.
+ * \param header
+ *      Points into \a headerBuffer once the segment header has been found;
+ *      NULL before that.
+ * \param numPartitions
+ *      See build().
+ * \param partitions
+ *      See build().
+ * \param recoverySegments
+ *      See build().
+ */
+void
+RecoverySegmentBuilder::partitionEntry(
+        SegmentIterator& it, Buffer& headerBuffer,
+        const SegmentHeader*& header, int numPartitions,
+        const ProtoBuf::RecoveryPartition& partitions,
+        Segment* recoverySegments)
+{
+    LogEntryType type = it.getType();
 
-        uint64_t tableId = -1;
-        KeyHash keyHash = -1;
-        if (type == LOG_ENTRY_TYPE_SAFEVERSION)
-        {
-            // Copy SAFEVERSION to all the partitions for safeVersion recovery
-            // on all recovery masters
-            LogPosition position(header->segmentId, it.getOffset());
-            for (int i = 0; i < numPartitions; i++) {
-                if (!recoverySegments[i].append(type, entryBuffer)) {
-                    LOG(WARNING, "Failure appending to a recovery segment "
-                        "for a replica of <%s,%lu>",
-                        ServerId(header->logId).toString().c_str(),
-                        header->segmentId);
-                    throw SegmentRecoveryFailedException(HERE);
-                }
+    if (type == LOG_ENTRY_TYPE_SEGHEADER) {
+        it.appendToBuffer(headerBuffer);
+        header = headerBuffer.getStart<SegmentHeader>();
+        return;
+    }
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB
+        && type != LOG_ENTRY_TYPE_SAFEVERSION
+        && type != LOG_ENTRY_TYPE_RPCRESULT
+        && type != LOG_ENTRY_TYPE_PREP
+        && type != LOG_ENTRY_TYPE_PREPTOMB
+        && type != LOG_ENTRY_TYPE_TXDECISION
+        && type != LOG_ENTRY_TYPE_TXPLIST)
+        return;
+
+    if (header == NULL) {
+        DIE("Found log entry before header while "
+            "building recovery segments");
+    }
+
+    Buffer entryBuffer;
+    it.appendToBuffer(entryBuffer);
+
+    uint64_t tableId = -1;
+    KeyHash keyHash = -1;
+    if (type == LOG_ENTRY_TYPE_SAFEVERSION)
+    {
+        // Copy SAFEVERSION to all the partitions for safeVersion recovery
+        // on all recovery masters
+        LogPosition position(header->segmentId, it.getOffset());
+        for (int i = 0; i < numPartitions; i++) {
+            if (!recoverySegments[i].append(type, entryBuffer)) {
+                LOG(WARNING, "Failure appending to a recovery segment "
+                    "for a replica of <%s,%lu>",
+                    ServerId(header->logId).toString().c_str(),
+                    header->segmentId);
+                throw SegmentRecoveryFailedException(HERE);
             }
-            continue;
         }
+        return;
+    }
 
-        if (type == LOG_ENTRY_TYPE_TXPLIST) {
-            // Copy ParticipantLists all partitions that should own the entry.
-            ParticipantList plist(entryBuffer);
-            for (uint32_t i = 0; i < plist.getParticipantCount(); ++i) {
-                tableId = plist.participants[i].tableId;
-                keyHash = plist.participants[i].keyHash;
-                const auto* partition =
-                        whichPartition(tableId, keyHash, partitions);
-                if (partition) {
-                    uint64_t partitionId = partition->user_data();
+    if (type == LOG_ENTRY_TYPE_TXPLIST) {
+        // Copy ParticipantLists all partitions that should own the entry.
+        ParticipantList plist(entryBuffer);
+        for (uint32_t i = 0; i < plist.getParticipantCount(); ++i) {
+            tableId = plist.participants[i].tableId;
+            keyHash = plist.participants[i].keyHash;
+            const auto* partition =
+                    whichPartition(tableId, keyHash, partitions);
+            if (partition) {
+                uint64_t partitionId = partition->user_data();
 
-                    LogPosition position(header->segmentId, it.getOffset());
-                    if (!recoverySegments[partitionId].append(type,
-                                                              entryBuffer)) {
-                        LOG(WARNING, "Failure appending to a recovery segment "
-                                "for a replica of <%s,%lu>",
-                                ServerId(header->logId).toString().c_str(),
-                                header->segmentId);
-                        throw SegmentRecoveryFailedException(HERE);
-                    }
+                LogPosition position(header->segmentId, it.getOffset());
+                if (!recoverySegments[partitionId].append(type,
+                                                          entryBuffer)) {
+                    LOG(WARNING, "Failure appending to a recovery segment "
+                            "for a replica of <%s,%lu>",
+                            ServerId(header->logId).toString().c_str(),
+                            header->segmentId);
+                    throw SegmentRecoveryFailedException(HERE);
                 }
             }
-            continue;
         }
+        return;
+    }
 
-        if (type == LOG_ENTRY_TYPE_OBJ) {
-            Object object(entryBuffer);
-            tableId = object.getTableId();
-            keyHash = Key::getHash(tableId,
-                                   object.getKey(), object.getKeyLength());
-        } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
-            ObjectTombstone tomb(entryBuffer);
-            tableId = tomb.getTableId();
-            keyHash = Key::getHash(tableId,
-                                   tomb.getKey(), tomb.getKeyLength());
-        } else if (type == LOG_ENTRY_TYPE_RPCRESULT) {
-            RpcResult rpcResult(entryBuffer);
-            tableId = rpcResult.getTableId();
-            keyHash = rpcResult.getKeyHash();
-        } else if (type == LOG_ENTRY_TYPE_PREP) {
-            PreparedOp op(entryBuffer, 0, entryBuffer.size());
-            tableId = op.object.getTableId();
-            keyHash = Key::getHash(tableId,
-                                   op.object.getKey(),
-                                   op.object.getKeyLength());
-        } else if (type == LOG_ENTRY_TYPE_PREPTOMB) {
-            PreparedOpTombstone opTomb(entryBuffer, 0);
-            tableId = opTomb.header.tableId;
-            keyHash = opTomb.header.keyHash;
-        } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
-            TxDecisionRecord decisionRecord(entryBuffer);
-            tableId = decisionRecord.getTableId();
-            keyHash = decisionRecord.getKeyHash();
-        } else {
-            LOG(WARNING, "Unknown LogEntry (id=%u)", type);
-            throw SegmentRecoveryFailedException(HERE);
-        }
+    if (type == LOG_ENTRY_TYPE_OBJ) {
+        Object object(entryBuffer);
+        tableId = object.getTableId();
+        keyHash = Key::getHash(tableId,
+                               object.getKey(), object.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
+        ObjectTombstone tomb(entryBuffer);
+        tableId = tomb.getTableId();
+        keyHash = Key::getHash(tableId,
+                               tomb.getKey(), tomb.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_RPCRESULT) {
+        RpcResult rpcResult(entryBuffer);
+        tableId = rpcResult.getTableId();
+        keyHash = rpcResult.getKeyHash();
+    } else if (type == LOG_ENTRY_TYPE_PREP) {
+        PreparedOp op(entryBuffer, 0, entryBuffer.size());
+        tableId = op.object.getTableId();
+        keyHash = Key::getHash(tableId,
+                               op.object.getKey(),
+                               op.object.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_PREPTOMB) {
+        PreparedOpTombstone opTomb(entryBuffer, 0);
+        tableId = opTomb.header.tableId;
+        keyHash = opTomb.header.keyHash;
+    } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
+        TxDecisionRecord decisionRecord(entryBuffer);
+        tableId = decisionRecord.getTableId();
+        keyHash = decisionRecord.getKeyHash();
+    } else {
+        LOG(WARNING, "Unknown LogEntry (id=%u)", type);
+        throw SegmentRecoveryFailedException(HERE);
+    }
 
-        const auto* partition = whichPartition(tableId, keyHash, partitions);
-        if (!partition) {
-            // This log record doesn't belong to any of the current
-            // partitions. This can happen when it takes several passes
-            // to complete a recovery: each pass will recover only a subset
-            // of the data.
-            TEST_LOG("Couldn't place object");
-            continue;
-        }
-        uint64_t partitionId = partition->user_data();
+    const auto* partition = whichPartition(tableId, keyHash, partitions);
+    if (!partition) {
+        // This log record doesn't belong to any of the current
+        // partitions. This can happen when it takes several passes
+        // to complete a recovery: each pass will recover only a subset
+        // of the data.
+        TEST_LOG("Couldn't place object");
+        return;
+    }
+    uint64_t partitionId = partition->user_data();
 
-        LogPosition position(header->segmentId, it.getOffset());
-        if (!isEntryAlive(position, partition)) {
-            LOG(NOTICE, "Skipping object with <tableId, keyHash> of "
-                "<%lu,%lu> because it appears to have existed prior "
-                "to this tablet's creation.", tableId, keyHash);
-            continue;
-        }
+    LogPosition position(header->segmentId, it.getOffset());
+    if (!isEntryAlive(position, partition)) {
+        LOG(NOTICE, "Skipping object with <tableId, keyHash> of "
+            "<%lu,%lu> because it appears to have existed prior "
+            "to this tablet's creation.", tableId, keyHash);
+        return;
+    }
 
-        if (!recoverySegments[partitionId].append(type, entryBuffer)) {
-            LOG(WARNING, "Failure appending to a recovery segment "
-                "for a replica of <%s,%lu>",
-                ServerId(header->logId).toString().c_str(), header->segmentId);
-            throw SegmentRecoveryFailedException(HERE);
-        }
+    if (!recoverySegments[partitionId].append(type, entryBuffer)) {
+        LOG(WARNING, "Failure appending to a recovery segment "
+            "for a replica of <%s,%lu>",
+            ServerId(header->logId).toString().c_str(), header->segmentId);
+        throw SegmentRecoveryFailedException(HERE);
     }
 }
 
@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <functional>
+
 #include "Common.h"
 #include "Buffer.h"
 #include "Key.h"
@@ -25,6 +27,8 @@
 
 namespace RAMCloud {
 
+class SegmentIterator;
+
 /**
  * Collects all the logic that must understand the contents of replicas for
  * master recovery on the backups. All functions herein are logically part of
@@ -41,15 +45,33 @@ namespace RAMCloud {
  */
 class RecoverySegmentBuilder {
   PUBLIC:
+    /**
+     * Used by buildStreaming() to wait for more of a replica to be loaded;
+     * given a byte count, blocks until at least that many bytes have been
+     * loaded and returns the number of bytes loaded so far.
+     */
+    typedef std::function<uint32_t(uint32_t)> WaitForData;
+
     static void build(const void* buffer, uint32_t length,
                       const SegmentCertificate& certificate,
                       int numPartitions,
                       const ProtoBuf::RecoveryPartition& partitions,
                       Segment* recoverySegments);
+    static void buildStreaming(const void* buffer, uint32_t length,
+                               const SegmentCertificate& certificate,
+                               int numPartitions,
+                               const ProtoBuf::RecoveryPartition& partitions,
+                               Segment* recoverySegments,
+                               const WaitForData& waitForData);
     static bool extractDigest(const void* buffer, uint32_t length,
                               const SegmentCertificate& certificate,
                               Buffer* digestBuffer, Buffer* tableStatsBuffer);
   PRIVATE:
+    static void partitionEntry(SegmentIterator& it, Buffer& headerBuffer,
+                               const SegmentHeader*& header,
+                               int numPartitions,
+                               const ProtoBuf::RecoveryPartition& partitions,
+                               Segment* recoverySegments);
     static bool isEntryAlive(const LogPosition& position,
                              const ProtoBuf::Tablets::Tablet* tablet);
     static const ProtoBuf::Tablets::Tablet*
@@ -333,6 +333,77 @@ TEST_F(RecoverySegmentBuilderTest, build_participantList) {
             ObjectManager::dumpSegment(&recoverySegments[1]));
 }
 
+TEST_F(RecoverySegmentBuilderTest, buildStreaming) {
+    auto buildStreaming = RecoverySegmentBuilder::buildStreaming;
+    LogSegment* segment = segmentManager.allocHeadSegment();
+    for (int i = 0; i < 3; i++) {
+        Key key(1, (i % 2) ? "1" : "2", 1);
+        Buffer dataBuffer;
+        Object object(key, "hello", 6, 0, 0, dataBuffer);
+        Buffer buffer;
+        object.assembleForLog(buffer);
+        ASSERT_TRUE(segment->append(LOG_ENTRY_TYPE_OBJ, buffer));
+    }
+    SegmentCertificate certificate;
+    uint32_t length = segment->getAppendedLength(&certificate);
+    char buf[serverConfig.segmentSize];
+    ASSERT_TRUE(segment->copyOut(0, buf, length));
+
+    // Pretend the replica arrives 16 bytes at a time.
+    uint32_t loaded = 0;
+    uint32_t calls = 0;
+    uint32_t largestRequest = 0;
+    auto waitForData = [&] (uint32_t needed) {
+        ++calls;
+        largestRequest = std::max(largestRequest, needed);
+        loaded = std::min(length, std::max(needed, loaded + 16));
+        return loaded;
+    };
+
+    std::unique_ptr<Segment[]> recoverySegments(new Segment[2]);
+    buildStreaming(buf, length, certificate, 2, partitions,
+                   recoverySegments.get(), waitForData);
+    EXPECT_LT(2u, calls);
+    EXPECT_EQ(length, largestRequest);
+    EXPECT_EQ("safeVersion at offset 0, length 12 with version 1 | "
+            "object at offset 14, length 34 with tableId 1, key '2' | "
+            "object at offset 50, length 34 with tableId 1, key '2'",
+            ObjectManager::dumpSegment(&recoverySegments[0]));
+    EXPECT_EQ("safeVersion at offset 0, length 12 with version 1 | "
+            "object at offset 14, length 34 with tableId 1, key '1'",
+            ObjectManager::dumpSegment(&recoverySegments[1]));
+
+    loaded = 0;
+    certificate.checksum = 0;
+    recoverySegments.reset(new Segment[2]);
+    EXPECT_THROW(buildStreaming(buf, length, certificate, 2, partitions,
+                                recoverySegments.get(), waitForData),
+                 SegmentIteratorException);
+}
+
+TEST_F(RecoverySegmentBuilderTest, buildStreaming_entryPastEnd) {
+    auto buildStreaming = RecoverySegmentBuilder::buildStreaming;
+    LogSegment* segment = segmentManager.allocHeadSegment();
+    SegmentCertificate certificate;
+    uint32_t length = segment->getAppendedLength(&certificate);
+    char buf[serverConfig.segmentSize];
+    ASSERT_TRUE(segment->copyOut(0, buf, length));
+
+    // Cut the replica short in the middle of its last entry: the metadata
+    // must be checked before anything beyond the end is touched.
+    certificate.segmentLength = length - 1;
+    std::vector<uint32_t> requests;
+    auto waitForData = [&] (uint32_t needed) {
+        requests.push_back(needed);
+        return length;
+    };
+    std::unique_ptr<Segment[]> recoverySegments(new Segment[2]);
+    EXPECT_THROW(buildStreaming(buf, length, certificate, 2, partitions,
+                                recoverySegments.get(), waitForData),
+                 SegmentIteratorException);
+    EXPECT_EQ(length - 1, requests.back());
+}
+
 TEST_F(RecoverySegmentBuilderTest, extractDigest) {
     auto extractDigest = RecoverySegmentBuilder::extractDigest;
     LogSegment* segment = segmentManager.allocHeadSegment();
@@ -433,6 +433,7 @@ class Segment {
     /// is their responsibility. Used to generate SegmentCertificates.
     Crc32C checksum;
 
+    friend class RecoverySegmentBuilder;
     friend class SegmentIterator;
 
     DISALLOW_COPY_AND_ASSIGN(Segment);
@@ -289,7 +289,8 @@ SegmentManager::allocHeadSegment(uint32_t flags)
  * \param replacing
  *      If memory compaction is being performed, this must point to the current
  *      segment that is being compacted. The allocated segment will then be
- *      created with the same segment identifier and creation timestamp.
+ *      created with the same segment identifier, creation timestamp, and
+ *      age class.
  *
  *      If a survivor is being allocated for disk cleaning instead, this must be
  *      NULL (the default).
@@ -319,8 +320,13 @@ SegmentManager::allocSideSegment(uint32_t flags, LogSegment* replacing)
         else
             s = alloc(ALLOC_REGULAR_SIDELOG, id, creationTimestamp);
 
-        if (s != NULL)
+        if (s != NULL) {
+            if (replacing != NULL) {
+                s->ageClass = replacing->ageClass;
+                s->dataTimestamp = replacing->dataTimestamp;
+            }
             break;
+        }
 
         if ((flags & MUST_NOT_FAIL) == 0)
             return NULL;
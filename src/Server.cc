@@ -46,7 +46,9 @@ Server::Server(Context* context, const ServerConfig* config)
 {
     context->coordinatorSession->setLocation(
             config->coordinatorLocator.c_str(), config->clusterName.c_str());
-    context->workerManager = new WorkerManager(context, config->maxCores-1);
+    context->workerManager = new WorkerManager(context, config->maxCores-1,
+                                               config->stealingCores,
+                                               config->inlineRpcs);
 }
 
 /**
@@ -64,6 +64,8 @@ struct ServerConfig {
         , maxObjectDataSize(segmentSize / 4)
         , maxObjectKeySize((64 * 1024) - 1)
         , maxCores(2)
+        , stealingCores(0)
+        , inlineRpcs(false)
         , master(testing)
         , backup(testing)
     {}
@@ -88,6 +90,8 @@ struct ServerConfig {
         , maxObjectDataSize(segmentSize / 8)
         , maxObjectKeySize((64 * 1024) - 1)
         , maxCores(2)
+        , stealingCores(0)
+        , inlineRpcs(false)
         , master()
         , backup()
     {}
@@ -137,6 +141,8 @@ struct ServerConfig {
         config.set_max_object_data_size(maxObjectDataSize);
         config.set_max_object_key_size(maxObjectKeySize);
         config.set_max_cores(maxCores);
+        config.set_stealing_cores(stealingCores);
+        config.set_inline_rpcs(inlineRpcs);
 
         if (services.has(WireFormat::MASTER_SERVICE))
             master.serialize(*config.mutable_master());
@@ -217,6 +223,21 @@ struct ServerConfig {
      */
     uint32_t maxCores;
 
+    /**
+     * Number of additional threads that execute short object RPCs (such
+     * as reads and writes) straight from per-thread queues, stealing work
+     * from one another when idle, rather than through the worker thread
+     * pool. 0 disables this.
+     */
+    uint32_t stealingCores;
+
+    /**
+     * If true, short read RPCs are executed directly in the dispatch thread,
+     * rather than handed off to a worker thread, when the dispatch thread
+     * has no backlog.
+     */
+    bool inlineRpcs;
+
     /**
      * Configuration details specific to the MasterService on a server,
      * if any.  If !config.has(MASTER_SERVICE) then this field is ignored.
@@ -229,12 +250,18 @@ struct ServerConfig {
         Master(Testing) // NOLINT
             : logBytes(40 * 1024 * 1024)
             , hashTableBytes(1 * 1024 * 1024)
+            , hashTableMaxLoadFactor(0)
+            , hashTableMinLoadFactor(0)
             , disableLogCleaner(true)
             , disableInMemoryCleaning(true)
             , diskExpansionFactor(1.0)
             , cleanerBalancer("tombstoneRatio:0.40")
             , cleanerWriteCostThreshold(0)
             , cleanerThreadCount(1)
+            , cleanerAgeClasses(1)
+            , tableObjectIndex(false)
+            , groupCommitMicros(0)
+            , indexLeafCompression(false)
             , numReplicas(0)
             , useMinCopysets(false)
             , allowLocalBackup(false)
@@ -248,12 +275,18 @@ struct ServerConfig {
         Master()
             : logBytes()
             , hashTableBytes()
+            , hashTableMaxLoadFactor()
+            , hashTableMinLoadFactor()
             , disableLogCleaner()
             , disableInMemoryCleaning()
             , diskExpansionFactor()
             , cleanerBalancer()
             , cleanerWriteCostThreshold()
             , cleanerThreadCount()
+            , cleanerAgeClasses()
+            , tableObjectIndex()
+            , groupCommitMicros()
+            , indexLeafCompression()
             , numReplicas()
             , useMinCopysets()
             , allowLocalBackup()
@@ -273,9 +306,15 @@ struct ServerConfig {
             config.set_cleaner_balancer(cleanerBalancer);
             config.set_cleaner_write_cost_threshold(cleanerWriteCostThreshold);
             config.set_cleaner_thread_count(cleanerThreadCount);
+            config.set_cleaner_age_classes(cleanerAgeClasses);
+            config.set_table_object_index(tableObjectIndex);
+            config.set_group_commit_micros(groupCommitMicros);
+            config.set_index_leaf_compression(indexLeafCompression);
             config.set_num_replicas(numReplicas);
             config.set_use_mincopysets(useMinCopysets);
             config.set_use_local_backup(allowLocalBackup);
+            config.set_hash_table_max_load_factor(hashTableMaxLoadFactor);
+            config.set_hash_table_min_load_factor(hashTableMinLoadFactor);
         }
 
         /**
@@ -293,9 +332,15 @@ struct ServerConfig {
             cleanerBalancer = config.cleaner_balancer();
             cleanerWriteCostThreshold = config.cleaner_write_cost_threshold();
             cleanerThreadCount = config.cleaner_thread_count();
+            cleanerAgeClasses = config.cleaner_age_classes();
+            tableObjectIndex = config.table_object_index();
+            groupCommitMicros = config.group_commit_micros();
+            indexLeafCompression = config.index_leaf_compression();
             numReplicas = config.num_replicas();
             useMinCopysets = config.use_mincopysets();
             allowLocalBackup = config.use_local_backup();
+            hashTableMaxLoadFactor = config.hash_table_max_load_factor();
+            hashTableMinLoadFactor = config.hash_table_min_load_factor();
         }
 
         /// Total number bytes to use for the in-memory Log.
@@ -304,6 +349,17 @@ struct ServerConfig {
         /// Total number of bytes to use for the HashTable.
         uint64_t hashTableBytes;
 
+        /// If nonzero, the HashTable is grown in the background (doubling
+        /// its number of buckets) whenever its load factor (see
+        /// HashTable::getLoadFactor) exceeds this value. 0 disables online
+        /// resizing.
+        double hashTableMaxLoadFactor;
+
+        /// If nonzero (and #hashTableMaxLoadFactor is also nonzero), the
+        /// HashTable is shrunk in the background, halving its number of
+        /// buckets, whenever its load factor falls below this value.
+        double hashTableMinLoadFactor;
+
         /// If true, disable the log cleaner entirely.
         bool disableLogCleaner;
 
@@ -330,6 +386,29 @@ struct ServerConfig {
         /// at the expense of CPU cycles.
         uint32_t cleanerThreadCount;
 
+        /// Number of age classes the disk cleaner segregates survivor data
+        /// into. Each class is written to its own survivor segments, so that
+        /// long-lived data is not mixed with data that will soon die. 1
+        /// disables segregation beyond sorting survivors by age.
+        uint32_t cleanerAgeClasses;
+
+        /// If true, the ObjectManager keeps an index of the key hashes in
+        /// each table, so that enumerating a tablet or purging a dropped
+        /// one takes time proportional to the tablet's size rather than
+        /// the size of the whole hash table.
+        bool tableObjectIndex;
+
+        /// Number of microseconds a thread about to replicate the log head
+        /// waits first, so that durable writes from other threads can join
+        /// the same backup write (see Log::setGroupCommitWindow). 0 means
+        /// replicate immediately.
+        uint32_t groupCommitMicros;
+
+        /// If true, the IndexBtree of each indexlet this master creates
+        /// writes its leaves prefix-compressed (see
+        /// IndexBtree::setLeafCompression).
+        bool indexLeafCompression;
+
         /// Number of replicas to keep per segment stored on backups.
         uint32_t numReplicas;
 
@@ -357,9 +436,11 @@ struct ServerConfig {
             , numSegmentFrames(4)
             , maxNonVolatileBuffers(0)
             , file()
+            , ioEngine("aio")
             , strategy(1)
             , mockSpeed(100)
             , writeRateLimit(0)
+            , partitionThreads(0)
         {}
 
         /**
@@ -374,9 +455,11 @@ struct ServerConfig {
             , numSegmentFrames(512)
             , maxNonVolatileBuffers(0)
             , file("/var/tmp/backup.log")
+            , ioEngine("aio")
             , strategy(1)
             , mockSpeed(0)
             , writeRateLimit(0)
+            , partitionThreads(0)
         {}
 
         /**
@@ -389,11 +472,14 @@ struct ServerConfig {
             config.set_in_memory(inMemory);
             config.set_num_segment_frames(numSegmentFrames);
             config.set_max_non_volatile_buffers(maxNonVolatileBuffers);
-            if (!inMemory)
+            if (!inMemory) {
                 config.set_file(file);
+                config.set_io_engine(ioEngine);
+            }
             config.set_strategy(strategy);
             config.set_mock_speed(mockSpeed);
             config.set_write_rate_limit(writeRateLimit);
+            config.set_partition_threads(partitionThreads);
         }
 
         /**
@@ -407,11 +493,14 @@ struct ServerConfig {
             inMemory = config.in_memory();
             numSegmentFrames = config.num_segment_frames();
             maxNonVolatileBuffers = config.max_non_volatile_buffers();
-            if (!inMemory)
+            if (!inMemory) {
                 file = config.file();
+                ioEngine = config.io_engine();
+            }
             strategy = config.strategy();
             mockSpeed = config.mock_speed();
             writeRateLimit = config.write_rate_limit();
+            partitionThreads = config.partition_threads();
         }
 
         /**
@@ -452,6 +541,13 @@ struct ServerConfig {
         /// Path to a file to use for the backing store if inMemory is false.
         string file;
 
+        /**
+         * Kernel interface used for IO to #file if inMemory is false:
+         * "aio" (POSIX asynchronous IO) or "io_uring". See
+         * MultiFileStorage::IoEngine.
+         */
+        string ioEngine;
+
         /**
          * BackupStrategy to use for balancing replicas across backups.
          * Backups communicate this choice back to MasterServices.
@@ -470,6 +566,14 @@ struct ServerConfig {
          * If non-0, limit writes to backup to this many megabytes per second.
          */
         size_t writeRateLimit;
+
+        /**
+         * Number of threads each master recovery uses to split primary
+         * replicas into recovery segments while they stream in from storage.
+         * If 0, primary replicas are split one at a time, each once it has
+         * been read completely. See BackupMasterRecovery.
+         */
+        uint32_t partitionThreads;
     } backup;
 
   public:
@@ -114,11 +114,25 @@ main(int argc, char *argv[])
             ("backupOnly,B",
              ProgramOptions::bool_switch(&backupOnly),
              "The server should run the backup service only (no master)")
+            ("backupPartitionThreads",
+             ProgramOptions::value<uint32_t>(
+                &config.backup.partitionThreads)->default_value(0),
+             "Number of threads each recovery on this backup uses to split "
+             "primary replicas into recovery segments, starting on each "
+             "replica as soon as its first data has been read from storage. "
+             "If 0, replicas are split one at a time once fully read.")
             ("backupStrategy",
              ProgramOptions::value<int>(&config.backup.strategy)->
                default_value(RANDOM_REFINE_AVG),
              "0 random refine min, 1 random refine avg, 2 even distribution, "
              "3 uniform random")
+            ("backupIoEngine",
+             ProgramOptions::value<string>(&config.backup.ioEngine)->
+                default_value("aio"),
+             "Kernel interface the backup uses for IO to its storage files: "
+             "\"aio\" (POSIX asynchronous IO) or \"io_uring\" (batched "
+             "submission, registered buffers, and linked syncs; falls back "
+             "to aio if the kernel doesn't support it).")
             ("backupWriteRateLimit",
              ProgramOptions::value<size_t>(
                 &config.backup.writeRateLimit)->default_value(0),
@@ -161,11 +175,52 @@ main(int argc, char *argv[])
              ProgramOptions::value<string>(&config.backup.file)->
                 default_value("/var/tmp/backup.log"),
              "The file path to the backup storage.")
+            ("groupCommitMicros",
+             ProgramOptions::value<uint32_t>(
+                &config.master.groupCommitMicros)->default_value(0),
+             "Before replicating the log head for a durable write, wait this "
+             "many microseconds so that writes from other clients can share "
+             "the same backup write (group commit). Trades latency for "
+             "throughput under concurrent load; 0 replicates immediately. "
+             "Can also be changed at runtime with the "
+             "SET_GROUP_COMMIT_WINDOW server control.")
             ("hashTableMemory,h",
              ProgramOptions::value<string>(&hashTableMemory)->
                 default_value("10%"),
              "Percentage or megabytes of master memory allocated to "
              "the hash table")
+            ("hashTableMaxLoadFactor",
+             ProgramOptions::value<double>(
+                &config.master.hashTableMaxLoadFactor)->default_value(0.75),
+             "Grow the hash table in the background (doubling its size) "
+             "when the number of objects it holds exceeds this fraction of "
+             "its slots. The memory used beyond the hashTableMemory "
+             "allocation comes out of the server's spare memory, not the "
+             "log. 0 disables online resizing.")
+            ("hashTableMinLoadFactor",
+             ProgramOptions::value<double>(
+                &config.master.hashTableMinLoadFactor)->default_value(0),
+             "Shrink the hash table in the background (halving its size) "
+             "when the number of objects it holds falls below this fraction "
+             "of its slots. 0 disables shrinking.")
+            ("indexLeafCompression",
+             ProgramOptions::bool_switch(&config.master.indexLeafCompression),
+             "Write the leaves of secondary index trees prefix-compressed. "
+             "Shrinks index nodes in the log at the cost of decoding leaves "
+             "when they are read back.")
+            ("inlineRpcs",
+             ProgramOptions::bool_switch(&config.inlineRpcs),
+             "Execute short read requests directly in the dispatch thread, "
+             "instead of handing them off to a worker thread, whenever the "
+             "dispatch thread isn't backlogged. This saves a thread handoff "
+             "per read.")
+            ("logCleanerAgeClasses",
+             ProgramOptions::value<uint32_t>(
+                &config.master.cleanerAgeClasses)->default_value(1),
+             "Number of age classes (at most 4) that the disk cleaner sorts "
+             "live data into, writing each class to separate survivor "
+             "segments so that long-lived data is not repeatedly recleaned "
+             "alongside short-lived data. 1 disables segregation.")
             ("logCleanerThreads",
              ProgramOptions::value<uint32_t>(
                 &config.master.cleanerThreadCount)->default_value(1),
@@ -209,10 +264,23 @@ main(int argc, char *argv[])
              "2NR/8M (gives the backup 2NR bytes of space); any value lower "
              "than this may cause the cluster to eventually fail to service "
              "write requests.")
+            ("stealingCores",
+             ProgramOptions::value<uint32_t>(
+                &config.stealingCores)->default_value(0),
+             "Number of extra threads that execute short object RPCs (reads, "
+             "writes, removes, increments) directly from per-thread queues, "
+             "stealing from each other when idle, instead of handing each "
+             "one to a worker thread. These threads poll, so each one uses "
+             "a core while the server is busy. 0 disables this.")
             ("sync",
              ProgramOptions::bool_switch(&config.backup.sync),
              "Make all updates completely synchronous all the way down to "
              "stable storage.")
+            ("tableObjectIndex",
+             ProgramOptions::bool_switch(&config.master.tableObjectIndex),
+             "Keep an index of the key hashes in each table, so that "
+             "enumerating or dropping a small table doesn't scan the whole "
+             "hash table. Costs roughly 40 bytes of memory per object.")
             ("totalMasterMemory,t",
 
              // Note: we have tried changing the default value below to
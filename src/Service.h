@@ -81,6 +81,15 @@ class Service {
     virtual ~Service() {}
     virtual void dispatch(WireFormat::Opcode opcode,
                           Rpc* rpc);
+
+    /**
+     * Invoked when an RPC that was being executed inline in the dispatch
+     * thread had to be abandoned so that a worker can execute it again (see
+     * WorkerManager::executeInline). Services should take back statistics
+     * recorded by the abandoned attempt, so the RPC isn't counted twice.
+     */
+    virtual void abandonInlineRpc() { }
+
     static void prepareErrorResponse(Buffer* buffer, Status status);
     static void prepareRetryResponse(Buffer* replyPayload,
                                      uint32_t minDelayMicros,
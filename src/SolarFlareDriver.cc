@@ -72,6 +72,10 @@ SolarFlareDriver::SolarFlareDriver(Context* context,
     , bandwidthGbps(10)                   // Default bandwidth = 10 gbs
     , queueEstimator(0)
     , maxTransmitQueueSize(0)
+    , zeroCopyRegion()
+    , zeroCopyBase(NULL)
+    , zeroCopyBytes(0)
+    , transmitTracker()
 {
     if (localServiceLocator == NULL) {
 
@@ -277,6 +281,7 @@ SolarFlareDriver::RegisteredBuffs::RegisteredBuffs(int bufferSize,
             reinterpret_cast<PacketBuff*>(memoryChunk + i * bufferSize);
 
         packetBuff->id = i;
+        packetBuff->zeroCopy = false;
         packetBuff->dmaBufferAddress = ef_memreg_dma_addr(&registeredMemRegion,
                                         i * bufferSize);
         packetBuff->dmaBufferAddress += OFFSET_OF(struct PacketBuff,
@@ -376,6 +381,9 @@ SolarFlareDriver::~SolarFlareDriver() {
             buffsNotReleased);
     }
     ef_vi_free(&virtualInterface, driverHandle);
+    if (zeroCopyBase != NULL) {
+        ef_memreg_free(&zeroCopyRegion, driverHandle);
+    }
     ef_pd_free(&protectionDomain, driverHandle);
     ef_driver_close(driverHandle);
     rxBufferPool.destroy();
@@ -460,6 +468,11 @@ SolarFlareDriver::receivePackets(int maxPackets,
                 for (int j = 0; j < numCompleted; j++) {
                     PacketBuff* packetBuff =
                         driver->txBufferPool->getBufferById(packetIds[j]);
+                    if (packetBuff->zeroCopy) {
+                        driver->transmitTracker.unpin(
+                                packetBuff->pinnedEpoch);
+                        packetBuff->zeroCopy = false;
+                    }
                     driver->txBufferPool->freeBuffersVec.push_back(packetBuff);
                 }
                 break;
@@ -530,6 +543,35 @@ SolarFlareDriver::newAddress(const ServiceLocator& serviceLocator) {
     return new MacIpAddress(serviceLocator);
 }
 
+/**
+ * Register a region of memory (usually the log) with the NIC, so that
+ * sendPacket can transmit large payload chunks in it without copying
+ * them. See docs in the ``Driver'' class.
+ */
+void
+SolarFlareDriver::registerMemory(void* base, size_t bytes)
+{
+    if (zeroCopyBase != NULL) {
+        LOG(WARNING, "Only one memory region can be registered for zero-copy "
+            "transmit; ignoring region of %lu bytes at %p", bytes, base);
+        return;
+    }
+    if (reinterpret_cast<uintptr_t>(base) % NIC_PAGE_SIZE != 0) {
+        LOG(WARNING, "Memory at %p is not page-aligned; it can't be used "
+            "for zero-copy transmit", base);
+        return;
+    }
+    int rc = ef_memreg_alloc(&zeroCopyRegion, driverHandle,
+            &protectionDomain, driverHandle, base, bytes);
+    if (rc < 0) {
+        LOG(WARNING, "Failed to register %lu bytes at %p with SolarFlare NIC "
+            "(%s); payloads will be copied", bytes, base, strerror(-rc));
+        return;
+    }
+    zeroCopyBase = static_cast<char*>(base);
+    zeroCopyBytes = bytes;
+}
+
 /// See docs in the ``Driver'' class.
 void
 SolarFlareDriver::sendPacket(const Driver::Address* recipient,
@@ -603,10 +645,55 @@ SolarFlareDriver::sendPacket(const Driver::Address* recipient,
     // txRegisteredBuf.
     uint8_t* nextChunkStart = transportHdr + headerLen;
 
-    // Copy the payload to the transmit buffer.
+    // The packet is described to the NIC as a list of DMA regions. Bytes
+    // copied into txRegisteredBuf extend the last region that refers to it;
+    // large chunks of registered memory (i.e. object values in the log) get
+    // regions of their own so that they are not copied at all.
+    ef_iovec iov[MAX_TX_IOVECS];
+    uint32_t iovCount = 1;
+    iov[0].iov_base = txRegisteredBuf->dmaBufferAddress;
+    iov[0].iov_len = downCast<unsigned>(nextChunkStart -
+            txRegisteredBuf->dmaBuffer);
+    bool zeroCopy = false;
     while (payload && !payload->isDone()) {
-        memcpy(nextChunkStart, payload->getData(), payload->getLength());
-        nextChunkStart += payload->getLength();
+        const char* data = static_cast<const char*>(payload->getData());
+        uint32_t length = payload->getLength();
+        uint32_t pages = 0;
+        if (zeroCopyBase != NULL && length >= ZERO_COPY_THRESHOLD &&
+                data >= zeroCopyBase &&
+                data + length <= zeroCopyBase + zeroCopyBytes) {
+            size_t offset = data - zeroCopyBase;
+            pages = downCast<uint32_t>((offset + length - 1) / NIC_PAGE_SIZE
+                    - offset / NIC_PAGE_SIZE + 1);
+        }
+
+        // Leave room for one more region, for any bytes copied afterwards.
+        if (pages == 0 || iovCount + pages + 1 > MAX_TX_IOVECS) {
+            if (iov[iovCount - 1].iov_base + iov[iovCount - 1].iov_len !=
+                    txRegisteredBuf->dmaBufferAddress +
+                    (nextChunkStart - txRegisteredBuf->dmaBuffer)) {
+                iov[iovCount].iov_base = txRegisteredBuf->dmaBufferAddress +
+                        (nextChunkStart - txRegisteredBuf->dmaBuffer);
+                iov[iovCount].iov_len = 0;
+                iovCount++;
+            }
+            memcpy(nextChunkStart, data, length);
+            nextChunkStart += length;
+            iov[iovCount - 1].iov_len += length;
+        } else {
+            size_t offset = data - zeroCopyBase;
+            while (length > 0) {
+                uint32_t bytes = std::min(length, downCast<uint32_t>(
+                        NIC_PAGE_SIZE - offset % NIC_PAGE_SIZE));
+                iov[iovCount].iov_base =
+                        ef_memreg_dma_addr(&zeroCopyRegion, offset);
+                iov[iovCount].iov_len = bytes;
+                iovCount++;
+                offset += bytes;
+                length -= bytes;
+            }
+            zeroCopy = true;
+        }
         payload->next();
     }
 
@@ -619,9 +706,20 @@ SolarFlareDriver::sendPacket(const Driver::Address* recipient,
         // packet is queued in the transmit ring, and a doorbell is rung to
         // inform the adapter that the transmit ring is non-empty. Later on
         // in Poller::poll() we fetch notifications off of the event queue
-        // that implies which packet transmit is completed.
-        ef_vi_transmit(&virtualInterface, txRegisteredBuf->dmaBufferAddress
-                , downCast<int>(totalLen), txRegisteredBuf->id);
+        // that implies which packet transmit is completed. Packets that
+        // refer to log memory pin an epoch until that notification arrives,
+        // so the log cleaner can't free the memory while the NIC is still
+        // reading it.
+        if (zeroCopy) {
+            txRegisteredBuf->zeroCopy = true;
+            txRegisteredBuf->pinnedEpoch = transmitTracker.pin();
+            ef_vi_transmitv(&virtualInterface, iov, downCast<int>(iovCount),
+                    txRegisteredBuf->id);
+        } else {
+            ef_vi_transmit(&virtualInterface,
+                    txRegisteredBuf->dmaBufferAddress,
+                    downCast<int>(totalLen), txRegisteredBuf->id);
+        }
         //LOG(NOTICE, "%s", (ethernetHeaderToStr(ethHdr)).c_str());
         //LOG(NOTICE, "%s", (ipHeaderToStr(ipHdr)).c_str());
         //LOG(NOTICE, "%s", (udpHeaderToStr(udpHdr)).c_str())
@@ -25,6 +25,7 @@
 #include "Common.h"
 #include "Dispatch.h"
 #include "Driver.h"
+#include "LogProtector.h"
 #include "NetUtil.h"
 #include "ObjectPool.h"
 #include "MacIpAddress.h"
@@ -60,6 +61,7 @@ class SolarFlareDriver : public Driver {
                             Buffer::Iterator *payload);
     virtual string getServiceLocator();
     virtual Driver::Address* newAddress(const ServiceLocator& serviceLocator);
+    virtual void registerMemory(void* base, size_t bytes);
 
     /// Defines the total number of buffers that the driver is allowed to pack
     /// in TX ring. Large values increases the latency for small objects.
@@ -82,6 +84,19 @@ class SolarFlareDriver : public Driver {
     /// size equal to below constant.
     static const uint32_t RX_REFILL_BATCH_SIZE = 64;
 
+    /// Payload chunks at least this long that lie in memory registered with
+    /// registerMemory are transmitted directly from that memory rather than
+    /// being copied into a transmit buffer. For shorter chunks the copy is
+    /// cheaper than the extra DMA descriptors.
+    static const uint32_t ZERO_COPY_THRESHOLD = 1024;
+
+    /// Maximum number of DMA descriptors used for a single packet.
+    static const uint32_t MAX_TX_IOVECS = 8;
+
+    /// Granularity at which the NIC translates registered memory; a
+    /// zero-copy chunk must be split into descriptors at these boundaries.
+    static const uint32_t NIC_PAGE_SIZE = 4096;
+
     /// Offset of payload data portion of an Ethernet frame measured from first
     /// byte of Ethernet header. We assume the Ethernet frame contains IP header
     /// and UDP header right after Ethernet header and then comes the payload
@@ -103,6 +118,8 @@ class SolarFlareDriver : public Driver {
             : dmaBufferAddress()
             , id(0)
             , macIpAddress()
+            , pinnedEpoch(0)
+            , zeroCopy(false)
             , dmaBuffer()
         {}
 
@@ -120,6 +137,15 @@ class SolarFlareDriver : public Driver {
         /// This address will be used for sending replies back.
         Tub<MacIpAddress> macIpAddress;
 
+        /// For a TX buffer with #zeroCopy set, the epoch that was pinned in
+        /// the driver's transmitTracker when the packet was queued.
+        uint64_t pinnedEpoch;
+
+        /// True means the packet sent from this TX buffer also refers to
+        /// registered log memory, which must stay valid until the transmit
+        /// completes.
+        bool zeroCopy;
+
         /// The packet content starts at this address and it's cache aligned for
         /// performance optimization. N.B. In the receive path, SolarFlare NIC
         /// adds some prefix data at this start and the received Ethernet packet
@@ -252,6 +278,20 @@ class SolarFlareDriver : public Driver {
     /// at any given time.
     uint32_t maxTransmitQueueSize;
 
+    /// Registration of the memory passed to registerMemory (usually the
+    /// log), so that outgoing packets can refer to it directly.
+    ef_memreg zeroCopyRegion;
+
+    /// First byte of #zeroCopyRegion, or NULL if no memory is registered.
+    char* zeroCopyBase;
+
+    /// Size of #zeroCopyRegion, in bytes.
+    size_t zeroCopyBytes;
+
+    /// Keeps the log cleaner from freeing memory that packets queued on the
+    /// NIC still refer to.
+    LogProtector::TransmitTracker transmitTracker;
+
     void refillRxRing();
     void handleReceived(int packetId, int packetLen,
             std::vector<Received>* receivedPackets);
@@ -141,6 +141,11 @@ class Syscall {
         return ::select(nfds, readfds, writefds, errorfds, timeout);
     }
     VIRTUAL_FOR_TESTING
+    int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+            int flags) {
+        return ::sendmmsg(sockfd, msgvec, vlen, flags);
+    }
+    VIRTUAL_FOR_TESTING
     ssize_t sendmsg(int sockfd, const msghdr *msg, int flags) {
         return ::sendmsg(sockfd, msg, flags);
     }
@@ -232,6 +232,20 @@ TEST_F(TableManagerTest, createTable_noMastersInCluster) {
     EXPECT_THROW(tableManager->createTable("foo", 1), RetryException);
 }
 
+TEST_F(TableManagerTest, createTable_storageRoundTrips) {
+    // All of the information about a new table is written to external
+    // storage in a single round trip, no matter how many tablets it has.
+    cluster.addServer(masterConfig);
+    cluster.externalStorage.log.clear();
+    uint64_t roundTrips = cluster.externalStorage.writeRoundTrips;
+    tableManager->createTable("foo", 256);
+    EXPECT_EQ(1u, cluster.externalStorage.writeRoundTrips - roundTrips);
+    EXPECT_EQ("set(UPDATE, tables/foo)", cluster.externalStorage.log);
+    ProtoBuf::Table info;
+    EXPECT_TRUE(info.ParseFromString(cluster.externalStorage.setData));
+    EXPECT_EQ(256, info.tablet_size());
+}
+
 TEST_F(TableManagerTest, createTable_givenServerId) {
     MasterService* master1 = cluster.addServer(masterConfig)->master.get();
     MasterService* master2 = cluster.addServer(masterConfig)->master.get();
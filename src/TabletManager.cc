@@ -18,9 +18,14 @@
 #include "TabletManager.h"
 #include "TimeTrace.h"
 #include "Util.h"
+#include "WorkerManager.h"
 
 namespace RAMCloud {
 
+__thread TabletManager::InlineRead
+        TabletManager::inlineReads[TabletManager::MAX_INLINE_READS];
+__thread uint32_t TabletManager::numInlineReads = 0;
+
 TabletManager::TabletManager()
     : tabletMap()
     , lock("TabletManager::lock")
@@ -95,6 +100,7 @@ TabletManager::checkAndIncrementReadCount(Key& key) {
     }
 
     it->second.readCount++;
+    recordInlineRead(key.getTableId(), key.getHash());
     return true;
 }
 
@@ -380,8 +386,10 @@ TabletManager::incrementReadCount(uint64_t tableId, KeyHash keyHash)
 {
     SpinLock::Guard guard(lock);
     TabletMap::iterator it = lookup(tableId, keyHash, guard);
-    if (it != tabletMap.end())
+    if (it != tabletMap.end()) {
         it->second.readCount++;
+        recordInlineRead(tableId, keyHash);
+    }
 }
 
 /**
@@ -407,6 +415,56 @@ TabletManager::incrementWriteCount(uint64_t tableId, KeyHash keyHash)
         it->second.writeCount++;
 }
 
+/**
+ * Forget the read counts remembered for the inline RPC previously executed
+ * by this thread. Called when the dispatch thread starts executing a new
+ * RPC inline (see WorkerManager::executeInline).
+ */
+void
+TabletManager::resetInlineReadCounts()
+{
+    numInlineReads = 0;
+}
+
+/**
+ * Take back the read counts added by the inline RPC currently executing in
+ * this thread. Called when the RPC has to be abandoned and executed again
+ * by a worker, which will count its reads again.
+ */
+void
+TabletManager::undoInlineReadCounts()
+{
+    SpinLock::Guard guard(lock);
+    for (uint32_t i = 0; i < numInlineReads; i++) {
+        TabletMap::iterator it = lookup(inlineReads[i].tableId,
+                                        inlineReads[i].keyHash, guard);
+        if (it != tabletMap.end() && it->second.readCount > 0)
+            it->second.readCount--;
+    }
+    numInlineReads = 0;
+}
+
+/**
+ * Remember that a tablet's read count was incremented, if this thread is
+ * executing an RPC inline, so that undoInlineReadCounts() can take it
+ * back. Reads beyond MAX_INLINE_READS aren't remembered; WorkerManager
+ * never executes RPCs with that many reads inline.
+ *
+ * \param tableId
+ *      Table containing the object read.
+ * \param keyHash
+ *      Key hash of the object read.
+ */
+void
+TabletManager::recordInlineRead(uint64_t tableId, KeyHash keyHash)
+{
+    if (!WorkerManager::runningInline || numInlineReads >= MAX_INLINE_READS)
+        return;
+    inlineReads[numInlineReads].tableId = tableId;
+    inlineReads[numInlineReads].keyHash = keyHash;
+    numInlineReads++;
+}
+
 /**
  * Populate a ServerStatistics protocol buffer with read and write statistics
  * gathered for our tablets.
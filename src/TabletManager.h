@@ -178,6 +178,8 @@ class TabletManager {
     void incrementWriteCount(Key& key);
     void incrementWriteCount(uint64_t tableId,
                              KeyHash keyHash);
+    static void resetInlineReadCounts();
+    void undoInlineReadCounts();
     void getStatistics(ProtoBuf::ServerStatistics* serverStatistics);
     size_t getNumTablets();
     string toString();
@@ -190,6 +192,7 @@ class TabletManager {
 
     TabletMap::iterator lookup(uint64_t tableId, uint64_t keyHash,
                                const SpinLock::Guard& lock);
+    static void recordInlineRead(uint64_t tableId, KeyHash keyHash);
 
     /// This unordered_multimap is used to store and access all tablet data.
     TabletMap tabletMap;
@@ -204,6 +207,26 @@ class TabletManager {
     /// before corresponding transaction to complete.
     int numLoadingTablets;
 
+    /**
+     * Identifies a tablet read count added while executing an RPC inline in
+     * the dispatch thread; see recordInlineRead().
+     */
+    struct InlineRead {
+        uint64_t tableId;
+        KeyHash keyHash;
+    };
+
+    /// Most reads remembered by recordInlineRead(); no smaller than the
+    /// largest multi-read that WorkerManager executes inline.
+    enum { MAX_INLINE_READS = 8 };
+
+    /// Read counts added by the current inline RPC of this thread, so that
+    /// undoInlineReadCounts() can take them back.
+    static __thread InlineRead inlineReads[MAX_INLINE_READS];
+
+    /// Number of valid entries in #inlineReads.
+    static __thread uint32_t numInlineReads;
+
     DISALLOW_COPY_AND_ASSIGN(TabletManager);
 };
 
@@ -15,6 +15,7 @@
 
 #include "TestUtil.h"
 #include "TabletManager.h"
+#include "WorkerManager.h"
 
 namespace RAMCloud {
 
@@ -293,6 +294,29 @@ TEST_F(TabletManagerTest, getStatistics) {
     }
 }
 
+TEST_F(TabletManagerTest, undoInlineReadCounts) {
+    tm.addTablet(58, 0, ~0UL, TabletManager::NORMAL);
+    Key key(58, "1", 1);
+    SpinLock lock("TabletManagerTest");
+    SpinLock::Guard fakeGuard(lock);
+    TabletManager::Tablet* tablet = &tm.lookup(58, 0, fakeGuard)->second;
+
+    // Reads outside inline RPCs aren't remembered.
+    tm.incrementReadCount(key);
+    EXPECT_EQ(0U, TabletManager::numInlineReads);
+
+    WorkerManager::runningInline = true;
+    TabletManager::resetInlineReadCounts();
+    EXPECT_TRUE(tm.checkAndIncrementReadCount(key));
+    tm.incrementReadCount(key);
+    EXPECT_EQ(3U, tablet->readCount);
+    EXPECT_EQ(2U, TabletManager::numInlineReads);
+    tm.undoInlineReadCounts();
+    WorkerManager::runningInline = false;
+    EXPECT_EQ(1U, tablet->readCount);
+    EXPECT_EQ(0U, TabletManager::numInlineReads);
+}
+
 TEST_F(TabletManagerTest, getNumTablets) {
     EXPECT_EQ(0U, tm.getNumTablets());
     tm.addTablet(0, 0, 0, TabletManager::NORMAL);
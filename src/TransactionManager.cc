@@ -45,14 +45,12 @@ TransactionManager::TransactionManager(Context* context,
                                        AbstractLog* log,
                                        UnackedRpcResults* unackedRpcResults,
                                        TabletManager* tabletManager)
-    : mutex()
-    , context(context)
+    : context(context)
     , log(log)
     , unackedRpcResults(unackedRpcResults)
     , tabletManager(tabletManager)
-    , items()
-    , transactions()
-    , transactionIds()
+    , itemShards()
+    , transactionShards()
     , cleaner(this)
 {
 }
@@ -62,18 +60,25 @@ TransactionManager::TransactionManager(Context* context,
  */
 TransactionManager::~TransactionManager()
 {
-    Lock lock(mutex);
-
     cleaner.stop();
 
-    for (auto it = items.begin(); it != items.end(); ++it) {
-        PreparedItem* item = it->second;
-        delete item;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        ItemShard& shard = itemShards[i];
+        Lock lock(shard.mutex);
+        for (auto it = shard.items.begin(); it != shard.items.end(); ++it) {
+            PreparedItem* item = it->second;
+            delete item;
+        }
     }
 
-    for (auto it = transactions.begin(); it != transactions.end(); ++it) {
-        TransactionRecord* tx = it->second;
-        delete tx;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        TransactionShard& shard = transactionShards[i];
+        Lock lock(shard.mutex);
+        for (auto it = shard.transactions.begin();
+                it != shard.transactions.end(); ++it) {
+            TransactionRecord* tx = it->second;
+            delete tx;
+        }
     }
 }
 
@@ -83,7 +88,6 @@ TransactionManager::~TransactionManager()
 void
 TransactionManager::startCleaner()
 {
-    Lock lock(mutex);
     cleaner.start(0);
 }
 
@@ -115,9 +119,8 @@ TransactionManager::registerTransaction(ParticipantList& participantList,
                                         Buffer& assembledParticipantList,
                                         AbstractLog* log)
 {
-    Lock lock(mutex);
-
     TransactionId txId = participantList.getTransactionId();
+    Lock lock(getTransactionShard(txId).mutex);
     TransactionRecord* transaction = getOrAddTransaction(txId, lock);
 
     if (transaction->participantListLogRef == AbstractLog::Reference()) {
@@ -172,7 +175,7 @@ TransactionManager::registerTransaction(ParticipantList& participantList,
 void
 TransactionManager::markTransactionRecovered(TransactionId txId)
 {
-    Lock lock(mutex);
+    Lock lock(getTransactionShard(txId).mutex);
     TransactionRecord* transaction = getTransaction(txId, lock);
     if (transaction != NULL) {
         transaction->recovered = true;
@@ -207,10 +210,9 @@ TransactionManager::relocateParticipantList(Buffer& oldBuffer,
                                             Log::Reference oldReference,
                                             LogEntryRelocator& relocator)
 {
-    Lock lock(mutex);
-
     ParticipantList participantList(oldBuffer);
     TransactionId txId = participantList.getTransactionId();
+    Lock lock(getTransactionShard(txId).mutex);
     TransactionRecord* transaction = getTransaction(txId, lock);
 
     // See if this transaction is still going on and if the participant list
@@ -248,13 +250,21 @@ TransactionManager::bufferOp(TransactionId txId,
                              uint64_t rpcId,
                              uint64_t newOpPtr)
 {
-    Lock lock(mutex);
+    // The item is created under the transaction's shard lock so that the
+    // TransactionRegistryCleaner can't see a zero preparedOpCount and
+    // delete the record once we have found it.
+    PreparedItem* item;
+    {
+        Lock lock(getTransactionShard(txId).mutex);
+        TransactionRecord* transaction = getOrAddTransaction(txId, lock);
+        item = new PreparedItem(transaction, newOpPtr);
+    }
 
-    assert(items.find(std::make_pair(txId.clientLeaseId, rpcId))
-            == items.end());
-    TransactionRecord* transaction = getOrAddTransaction(txId, lock);
-    PreparedItem* item = new PreparedItem(transaction, newOpPtr);
-    items[std::make_pair(txId.clientLeaseId, rpcId)] = item;
+    ItemShard& shard = getItemShard(txId.clientLeaseId, rpcId);
+    Lock lock(shard.mutex);
+    assert(shard.items.find(std::make_pair(txId.clientLeaseId, rpcId))
+            == shard.items.end());
+    shard.items[std::make_pair(txId.clientLeaseId, rpcId)] = item;
 }
 
 /**
@@ -269,13 +279,12 @@ void
 TransactionManager::removeOp(uint64_t leaseId,
                              uint64_t rpcId)
 {
-    Lock lock(mutex);
-    std::map<std::pair<uint64_t, uint64_t>,
-        PreparedItem*>::iterator it;
-    it = items.find(std::make_pair(leaseId, rpcId));
-    if (it != items.end()) {
+    ItemShard& shard = getItemShard(leaseId, rpcId);
+    Lock lock(shard.mutex);
+    ItemsMap::iterator it = shard.items.find(std::make_pair(leaseId, rpcId));
+    if (it != shard.items.end()) {
         delete it->second;
-        items.erase(it);
+        shard.items.erase(it);
     }
 }
 
@@ -301,11 +310,10 @@ TransactionManager::removeOp(uint64_t leaseId,
 uint64_t
 TransactionManager::getOp(uint64_t leaseId, uint64_t rpcId)
 {
-    Lock lock(mutex);
-    std::map<std::pair<uint64_t, uint64_t>,
-        PreparedItem*>::iterator it;
-    it = items.find(std::make_pair(leaseId, rpcId));
-    if (it == items.end()) {
+    ItemShard& shard = getItemShard(leaseId, rpcId);
+    Lock lock(shard.mutex);
+    ItemsMap::iterator it = shard.items.find(std::make_pair(leaseId, rpcId));
+    if (it == shard.items.end()) {
         return 0;
     } else {
         // During recovery, must check isDeleted before using this method since
@@ -337,8 +345,9 @@ TransactionManager::updateOpPtr(uint64_t leaseId,
                                 uint64_t rpcId,
                                 uint64_t newOpPtr)
 {
-    Lock lock(mutex);
-    PreparedItem* item = items[std::make_pair(leaseId, rpcId)];
+    ItemShard& shard = getItemShard(leaseId, rpcId);
+    Lock lock(shard.mutex);
+    PreparedItem* item = shard.items[std::make_pair(leaseId, rpcId)];
     item->newOpPtr = newOpPtr;
 }
 
@@ -353,20 +362,23 @@ TransactionManager::updateOpPtr(uint64_t leaseId,
 void
 TransactionManager::regrabLocksAfterRecovery(ObjectManager* objectManager)
 {
-    Lock lock(mutex);
-    ItemsMap::iterator it = items.begin();
-    while (it != items.end()) {
-        PreparedItem *item = it->second;
-
-        if (item == NULL) { //Cleanup marks for deleted.
-            items.erase(it++);
-        } else {
-            Buffer buffer;
-            Log::Reference ref(item->newOpPtr);
-            objectManager->getLog()->getEntry(ref, buffer);
-            PreparedOp op(buffer, 0, buffer.size());
-            objectManager->tryGrabTxLock(op.object, ref);
-            ++it;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        ItemShard& shard = itemShards[i];
+        Lock lock(shard.mutex);
+        ItemsMap::iterator it = shard.items.begin();
+        while (it != shard.items.end()) {
+            PreparedItem *item = it->second;
+
+            if (item == NULL) { //Cleanup marks for deleted.
+                it = shard.items.erase(it);
+            } else {
+                Buffer buffer;
+                Log::Reference ref(item->newOpPtr);
+                objectManager->getLog()->getEntry(ref, buffer);
+                PreparedOp op(buffer, 0, buffer.size());
+                objectManager->tryGrabTxLock(op.object, ref);
+                ++it;
+            }
         }
     }
 }
@@ -385,10 +397,12 @@ void
 TransactionManager::markOpDeleted(uint64_t leaseId,
                                   uint64_t rpcId)
 {
-    Lock lock(mutex);
-    assert(items.find(std::make_pair(leaseId, rpcId)) == items.end() ||
-           items.find(std::make_pair(leaseId, rpcId))->second == NULL);
-    items[std::make_pair(leaseId, rpcId)] = NULL;
+    ItemShard& shard = getItemShard(leaseId, rpcId);
+    Lock lock(shard.mutex);
+    assert(shard.items.find(std::make_pair(leaseId, rpcId)) ==
+                   shard.items.end() ||
+           shard.items.find(std::make_pair(leaseId, rpcId))->second == NULL);
+    shard.items[std::make_pair(leaseId, rpcId)] = NULL;
 }
 
 /**
@@ -404,12 +418,11 @@ bool
 TransactionManager::isOpDeleted(uint64_t leaseId,
                                 uint64_t rpcId)
 {
-    Lock lock(mutex);
+    ItemShard& shard = getItemShard(leaseId, rpcId);
+    Lock lock(shard.mutex);
 
-    std::map<std::pair<uint64_t, uint64_t>,
-        PreparedItem*>::iterator it;
-    it = items.find(std::make_pair(leaseId, rpcId));
-    if (it == items.end()) {
+    ItemsMap::iterator it = shard.items.find(std::make_pair(leaseId, rpcId));
+    if (it == shard.items.end()) {
         return false;
     } else {
         if (it->second == NULL) {
@@ -429,29 +442,31 @@ TransactionManager::isOpDeleted(uint64_t leaseId,
 void
 TransactionManager::removeOrphanedOps()
 {
-    Lock lock(mutex);
-    std::map<std::pair<uint64_t, uint64_t>, PreparedItem*>::iterator it;
-    it = items.begin();
-    while (it != items.end()) {
-        // Unlock monitor to allow interleaving of other transaction operations.
-        {
-            Unlock<std::mutex> yield(mutex);
-        }
-        PreparedItem *item = it->second;
-        if (item != NULL) {
-            Buffer buffer;
-            Log::Reference ref(item->newOpPtr);
-            log->getEntry(ref, buffer);
-            PreparedOp op(buffer, 0, buffer.size());
-            if (!tabletManager->getTablet(op.object.getTableId(),
-                                          op.object.getPKHash())) {
-                log->free(ref);
-                delete item;
-                it = items.erase(it);
-                continue;
+    // Only one shard is locked at a time, which allows interleaving of other
+    // transaction operations.  (Unlike std::map iterators, ItemsMap iterators
+    // may be invalidated by concurrent inserts, so the lock can't be yielded
+    // in the middle of a shard.)
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        ItemShard& shard = itemShards[i];
+        Lock lock(shard.mutex);
+        ItemsMap::iterator it = shard.items.begin();
+        while (it != shard.items.end()) {
+            PreparedItem *item = it->second;
+            if (item != NULL) {
+                Buffer buffer;
+                Log::Reference ref(item->newOpPtr);
+                log->getEntry(ref, buffer);
+                PreparedOp op(buffer, 0, buffer.size());
+                if (!tabletManager->getTablet(op.object.getTableId(),
+                                              op.object.getPKHash())) {
+                    log->free(ref);
+                    delete item;
+                    it = shard.items.erase(it);
+                    continue;
+                }
             }
+            ++it;
         }
-        ++it;
     }
 }
 
@@ -470,7 +485,7 @@ TransactionManager::Protector::Protector(
     : transactionManager(transactionManager)
     , txId(txId)
 {
-    Lock lock(transactionManager->mutex);
+    Lock lock(transactionManager->getTransactionShard(txId).mutex);
     TransactionRecord* transaction =
             transactionManager->getOrAddTransaction(txId, lock);
     ++transaction->cleaningDisabled;
@@ -481,7 +496,7 @@ TransactionManager::Protector::Protector(
  */
 TransactionManager::Protector::~Protector()
 {
-    Lock lock(transactionManager->mutex);
+    Lock lock(transactionManager->getTransactionShard(txId).mutex);
     TransactionRecord* transaction =
             transactionManager->getTransaction(txId, lock);
     assert(transaction != NULL);
@@ -497,8 +512,8 @@ TransactionManager::Protector::~Protector()
  * \param txId
  *      The id of the transaction to be tracked.
  * \param lock
- *      Used to ensure that caller has acquired TransactionManager::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the
+ *      TransactionShard for txId.  Not actually used by the method.
  */
 TransactionManager::TransactionRecord::TransactionRecord(
         TransactionManager* transactionManager,
@@ -521,11 +536,12 @@ TransactionManager::TransactionRecord::TransactionRecord(
 /**
  * TransactionRecord destructor.
  *
- * NOTE: Should always be called with the TransactionManager::mutex acquired.
+ * NOTE: Should always be called with the mutex of the TransactionShard
+ * holding this record acquired.
  */
 TransactionManager::TransactionRecord::~TransactionRecord()
 {
-    assert(!transactionManager->mutex.try_lock());
+    assert(!transactionManager->getTransactionShard(txId).mutex.try_lock());
 
     TEST_LOG("TransactionRecord <%lu, %lu> destroyed",
             txId.clientLeaseId, txId.clientTransactionId);
@@ -551,10 +567,11 @@ TransactionManager::TransactionRecord::handleTimerEvent()
     // Note: This notification was previously done in synchronously, but holding
     // the thread and worker timer resources while waiting for the notification
     // to be acknowledge could caused deadlock when the notification is sent to
-    // the same server.  Furthermore, the transaction manager lock is held
+    // the same server.  Furthermore, the transaction shard lock is held
     // during this call so delaying this method would prevent other transactions
     // from being processed.
-    TransactionManager::Lock lock(transactionManager->mutex);
+    TransactionManager::Lock lock(
+            transactionManager->getTransactionShard(txId).mutex);
 
     // Construct and send the txHintFailedRpc if it has not been done.
     if (!txHintFailedRpc) {
@@ -618,8 +635,8 @@ TransactionManager::TransactionRecord::handleTimerEvent()
  * still needed.
  *
  * \param lock
- *      Used to ensure that caller has acquired the TransactionManager::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the
+ *      TransactionShard holding this record.  Not actually used by the method.
  * \param protector
  *      Used to ensure that caller has acquired the TabletManager::Protector.
  *      Not actually used by the method.
@@ -670,8 +687,8 @@ TransactionManager::TransactionRecord::inProgress(
  * registered transaction.
  *
  * \param lock
- *      Used to ensure that caller has acquired the TransactionManager::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the
+ *      TransactionShard holding this record.  Not actually used by the method.
  * \param protector
  *      Used to ensure that caller has acquired the TabletManager::Protector.
  *      Not actually used by the method.
@@ -710,68 +727,127 @@ TransactionManager::TransactionRecord::checkMasterParticipantion(
 void
 TransactionManager::TransactionRegistryCleaner::handleTimerEvent()
 {
-    TransactionManager::TransactionRegisteryList::iterator it;
+    // Set once recoveries or migrations are found to be in progress.
+    bool blocked = false;
 
-    {
-        TransactionManager::Lock lock(transactionManager->mutex);
-        it = transactionManager->transactionIds.begin();
-    }
+    for (uint32_t i = 0; i < NUM_SHARDS && !blocked; ++i) {
+        TransactionShard& shard = transactionManager->transactionShards[i];
+        TransactionManager::TransactionRegisteryList::iterator it;
 
-    while (true) {
-        TransactionManager::Lock lock(transactionManager->mutex);
-        TabletManager::Protector protector(transactionManager->tabletManager);
+        {
+            TransactionManager::Lock lock(shard.mutex);
+            it = shard.transactionIds.begin();
+        }
 
-        // There are recoveries or migrations in progress; don't clean.
-        if (protector.notReadyTabletExists())
-            break;
-        // Cleaning pass completed.
-        if (it == transactionManager->transactionIds.end())
-            break;
+        while (true) {
+            TransactionManager::Lock lock(shard.mutex);
+            TabletManager::Protector protector(
+                    transactionManager->tabletManager);
 
-        TransactionId txId = *it;
-        TransactionRecord* transaction =
-                transactionManager->getTransaction(txId, lock);
-        assert(transaction != NULL);
-        if (transaction->cleaningDisabled > 0) {
-            TEST_LOG("Cleaning disabled for TxId: <%lu, %lu>",
-                    transaction->txId.clientLeaseId,
-                    transaction->txId.clientTransactionId);
-            ++it;
-        } else if (!transaction->inProgress(lock, protector)) {;
-            transactionManager->transactions.erase(txId);
-            delete transaction;
-            it = transactionManager->transactionIds.erase(it);
-        } else {
-            ++it;
+            // There are recoveries or migrations in progress; don't clean.
+            if (protector.notReadyTabletExists()) {
+                blocked = true;
+                break;
+            }
+            // Cleaning pass of this shard completed.
+            if (it == shard.transactionIds.end())
+                break;
+
+            TransactionId txId = *it;
+            TransactionRecord* transaction =
+                    transactionManager->getTransaction(txId, lock);
+            assert(transaction != NULL);
+            if (transaction->cleaningDisabled > 0) {
+                TEST_LOG("Cleaning disabled for TxId: <%lu, %lu>",
+                        transaction->txId.clientLeaseId,
+                        transaction->txId.clientTransactionId);
+                ++it;
+            } else if (!transaction->inProgress(lock, protector)) {
+                shard.transactions.erase(txId);
+                delete transaction;
+                it = shard.transactionIds.erase(it);
+            } else {
+                ++it;
+            }
         }
     }
 
-    {
-        TransactionManager::Lock lock(transactionManager->mutex);
-        // Keep cleaning if there are still incomplete transactions.
-        if (transactionManager->transactionIds.size() > 0) {
+    // Keep cleaning if there are still incomplete transactions.
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        TransactionShard& shard = transactionManager->transactionShards[i];
+        TransactionManager::Lock lock(shard.mutex);
+        if (shard.transactionIds.size() > 0) {
             transactionManager->cleaner.start(0);
+            break;
         }
     }
 }
 
+/**
+ * Returns the total number of entries in the prepared op table, including
+ * those that only mark a prepared op as deleted.  Walks all of the shards,
+ * so it is intended for testing.
+ */
+size_t
+TransactionManager::getItemCount()
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        Lock lock(itemShards[i].mutex);
+        count += itemShards[i].items.size();
+    }
+    return count;
+}
+
+/**
+ * Returns the ItemShard that holds (or will hold) the PreparedItem for a
+ * given prepared op.
+ *
+ * \param leaseId
+ *      leaseId given for the preparedOp.
+ * \param rpcId
+ *      rpcId given for the preparedOp.
+ */
+TransactionManager::ItemShard&
+TransactionManager::getItemShard(uint64_t leaseId, uint64_t rpcId)
+{
+    // RpcIds issued by a client are consecutive, so the low-order bits of
+    // concurrently prepared ops spread evenly over the shards.
+    return itemShards[(leaseId ^ rpcId) & (NUM_SHARDS - 1)];
+}
+
+/**
+ * Returns the TransactionShard that holds (or will hold) the
+ * TransactionRecord for a given transaction.
+ *
+ * \param txId
+ *      Id of the transaction.
+ */
+TransactionManager::TransactionShard&
+TransactionManager::getTransactionShard(TransactionId txId)
+{
+    return transactionShards[
+            (txId.clientLeaseId ^ txId.clientTransactionId) & (NUM_SHARDS - 1)];
+}
+
 /**
  * Returns a pointer to a TransactionRecord object if it exists.
  *
  * \param txId
  *      Id of the transaction to be returned.
  * \param lock
- *      Used to ensure that caller has acquired TransactionManager::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the
+ *      TransactionShard for txId.  Not actually used by the method.
  * \return
  *      Pointer to a TransactionRecord if it exists.  NULL otherwise.
  */
 TransactionManager::TransactionRecord*
 TransactionManager::getTransaction(TransactionId txId, Lock& lock)
 {
+    TransactionShard& shard = getTransactionShard(txId);
     TransactionRecord* transaction = NULL;
-    TransactionRegistry::iterator it = transactions.find(txId);
-    if (it != transactions.end()) {
+    TransactionRegistry::iterator it = shard.transactions.find(txId);
+    if (it != shard.transactions.end()) {
         transaction = it->second;
     }
     return transaction;
@@ -785,22 +861,23 @@ TransactionManager::getTransaction(TransactionId txId, Lock& lock)
  *      Id of the transaction that is (or will be) in the transaction
  *      registry and returned.
  * \param lock
- *      Used to ensure that caller has acquired TransactionManager::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the
+ *      TransactionShard for txId.  Not actually used by the method.
  * \return
  *      Pointer to a TransactionRecord.
  */
 TransactionManager::TransactionRecord*
 TransactionManager::getOrAddTransaction(TransactionId txId, Lock& lock)
 {
+    TransactionShard& shard = getTransactionShard(txId);
     TransactionRecord* transaction = NULL;
-    TransactionRegistry::iterator it = transactions.find(txId);
-    if (it != transactions.end()) {
+    TransactionRegistry::iterator it = shard.transactions.find(txId);
+    if (it != shard.transactions.end()) {
         transaction = it->second;
     } else {
         transaction = new TransactionRecord(this, txId, lock);
-        transactions[txId] = transaction;
-        transactionIds.emplace_back(txId);
+        shard.transactions[txId] = transaction;
+        shard.transactionIds.emplace_back(txId);
         if (!cleaner.isRunning()) {
             cleaner.start(0);
         }
@@ -21,6 +21,7 @@
 #include <queue>
 #include <unordered_map>
 
+#include "Atomic.h"
 #include "Common.h"
 #include "Log.h"
 #include "MasterClient.h"
@@ -105,12 +106,19 @@ class TransactionManager {
 
   PRIVATE:
     /**
-     * Monitor-style lock. Any operation on internal data structure should
-     * hold this lock.
+     * Used to hold the mutex of an ItemShard or TransactionShard (see below);
+     * there is no lock covering the whole TransactionManager.
      */
-    std::mutex mutex;
     typedef std::lock_guard<std::mutex> Lock;
 
+    /**
+     * Number of shards into which both the prepared op table and the
+     * transaction registry are divided.  Must be a power of 2: as with
+     * LockTable buckets, a shard is selected by the low-order bits of
+     * its key.
+     */
+    static const uint32_t NUM_SHARDS = 64;
+
     /// RAMCloud context needed to support the used of WorkerTimers and RPCs.
     Context* context;
 
@@ -151,7 +159,10 @@ class TransactionManager {
         virtual void handleTimerEvent();
 
         /// Number of prepared but uncommitted ops for this transaction.
-        int preparedOpCount;
+        /// PreparedItems are deleted under their ItemShard's lock rather than
+        /// the lock of the TransactionShard holding this record, so this
+        /// must be atomic.
+        Atomic<int> preparedOpCount;
       PRIVATE:
         /// The manager that owns this transaction record.
         TransactionManager* transactionManager;
@@ -229,8 +240,9 @@ class TransactionManager {
         /**
          * Default constructor.
          *
-         * The TransactionManager monitor lock should be held while calling this
-         * constructor.
+         * The lock of the TransactionShard holding the transaction should be
+         * held while calling this constructor, so that the transaction cannot
+         * be cleaned up concurrently.
          *
          * \param transaction
          *      The transaction to which this prepared op belongs.
@@ -248,9 +260,6 @@ class TransactionManager {
 
         /**
          * Default destructor.
-         *
-         * The TransactionManager monitor lock should be held while calling this
-         * destructor.
          */
         ~PreparedItem() {
             transaction->preparedOpCount--;
@@ -265,34 +274,89 @@ class TransactionManager {
         DISALLOW_COPY_AND_ASSIGN(PreparedItem);
     };
 
+    /// Identifies a PreparedItem: <LeaseId, RpcId>.
+    typedef std::pair<uint64_t, uint64_t> ItemKey;
+
+    /// Hash function for ItemKeys.
+    struct ItemKeyHasher {
+        std::size_t operator()(const ItemKey& key) const {
+            std::size_t h1 = std::hash<uint64_t>()(key.first);
+            std::size_t h2 = std::hash<uint64_t>()(key.second);
+            return h1 ^ (h2 << 1);
+        }
+    };
+
     /// mapping from <LeaseId, RpcId> to PreparedItem.
-    std::map<std::pair<uint64_t, uint64_t>, PreparedItem*> items;
-    typedef std::map<std::pair<uint64_t, uint64_t>, PreparedItem*> ItemsMap;
+    typedef std::unordered_map<ItemKey, PreparedItem*, ItemKeyHasher> ItemsMap;
 
     /**
-     * Keeps track of all currently registered transactions; this map should
-     * contain a single entry for each transaction currently being processed by
-     * this master.
+     * One shard of the prepared op table.  Prepared ops are spread across
+     * shards by their <LeaseId, RpcId> so that concurrent prepares, commits,
+     * and log cleaner relocations of different ops rarely contend for the
+     * same lock.
+     */
+    struct ItemShard {
+        ItemShard() : mutex(), items(), pad() {}
+
+        /// Protects #items.
+        std::mutex mutex;
+
+        /// The PreparedItems whose keys map to this shard.
+        ItemsMap items;
+
+        /// Keeps neighboring shards' locks on different cache lines.
+        char pad[CACHE_LINE_SIZE];
+    };
+    ItemShard itemShards[NUM_SHARDS];
+
+    /**
+     * Keeps track of currently registered transactions; across all
+     * TransactionShards there should be a single entry for each transaction
+     * currently being processed by this master.
      */
     typedef std::unordered_map<TransactionId,
                                TransactionRecord*,
                                TransactionId::Hasher> TransactionRegistry;
-    TransactionRegistry transactions;
 
     /**
-     * Identifiers of the transactions currently in the registry.  Every entry
-     * in the TransactionRegistry must also have a corresponding entry in this
-     * TransactionRegisteryList.  Used to make the TransactionRegistryCleaner
-     * more efficient.
+     * Identifiers of the transactions currently in a TransactionRegistry.
+     * Every entry in the TransactionRegistry must also have a corresponding
+     * entry in this TransactionRegisteryList.  Used to make the
+     * TransactionRegistryCleaner more efficient.
      */
     typedef std::list<TransactionId> TransactionRegisteryList;
-    TransactionRegisteryList transactionIds;
+
+    /**
+     * One shard of the transaction registry.  Transactions are spread across
+     * shards by their TransactionId.
+     */
+    struct TransactionShard {
+        TransactionShard() : mutex(), transactions(), transactionIds(), pad() {}
+
+        /// Protects all of the fields of this shard, as well as the
+        /// TransactionRecords in #transactions (except their
+        /// preparedOpCount).
+        std::mutex mutex;
+
+        /// The registered transactions whose ids map to this shard.
+        TransactionRegistry transactions;
+
+        /// Ids of all the transactions in #transactions.
+        TransactionRegisteryList transactionIds;
+
+        /// Keeps neighboring shards' locks on different cache lines.
+        char pad[CACHE_LINE_SIZE];
+    };
+    TransactionShard transactionShards[NUM_SHARDS];
 
     /**
      * Cleans complete transactions from the TransactionRegistry.
      */
     TransactionRegistryCleaner cleaner;
 
+    size_t getItemCount();
+    ItemShard& getItemShard(uint64_t leaseId, uint64_t rpcId);
+    TransactionShard& getTransactionShard(TransactionId txId);
     TransactionRecord* getTransaction(TransactionId txId, Lock& lock);
     TransactionRecord* getOrAddTransaction(TransactionId txId, Lock& lock);
 
@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <set>
 #include <vector>
 
 #include "TestUtil.h"
@@ -84,6 +85,20 @@ class TransactionManagerTest : public ::testing::Test {
         WorkerTimer::disableTimerHandlers = false;
     }
 
+    /// Returns the number of registered transactions in all of the
+    /// TransactionShards of transactionManager.
+    size_t getTransactionCount()
+    {
+        size_t count = 0;
+        for (uint32_t i = 0; i < TransactionManager::NUM_SHARDS; i++) {
+            TransactionManager::TransactionShard& shard =
+                    transactionManager.transactionShards[i];
+            EXPECT_EQ(shard.transactions.size(), shard.transactionIds.size());
+            count += shard.transactions.size();
+        }
+        return count;
+    }
+
     DISALLOW_COPY_AND_ASSIGN(TransactionManagerTest);
 };
 
@@ -173,9 +188,10 @@ class TransactionRecordTest : public ::testing::Test {
                 buffer,
                 service1->objectManager.getLog());
         {
-            TransactionManager::Lock lock(service1->transactionManager.mutex);
-            transaction = service1->transactionManager.getTransaction(txId,
-                                                                      lock);
+            TransactionManager* manager = &service1->transactionManager;
+            TransactionManager::Lock lock(
+                    manager->getTransactionShard(txId).mutex);
+            transaction = manager->getTransaction(txId, lock);
         }
     }
 
@@ -208,7 +224,8 @@ TEST_F(TransactionManagerTest, registerTransaction_basic) {
     participantList.assembleForLog(inBuffer);
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager.getTransaction(txId, lock) == NULL);
     }
 
@@ -221,7 +238,8 @@ TEST_F(TransactionManagerTest, registerTransaction_basic) {
     EXPECT_EQ(STATUS_OK, status);
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getTransaction(txId, lock);
         EXPECT_TRUE(transaction != NULL);
     }
@@ -271,7 +289,8 @@ TEST_F(TransactionManagerTest, registerTransaction_duplicate) {
 
     // Pre-insert entry
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getOrAddTransaction(txId, lock);
         transaction->participantListLogRef = AbstractLog::Reference(100);
         transaction->timeoutCycles = 200;
@@ -324,7 +343,8 @@ TEST_F(TransactionManagerTest, registerTransaction_timerStart) {
                                            objectManager.getLog());
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getTransaction(txId, lock);
     }
 
@@ -364,17 +384,20 @@ TEST_F(TransactionManagerTest, markTransactionRecovered) {
     transactionManager.markTransactionRecovered(txId);
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager.getTransaction(txId, lock) == NULL);
     }
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getOrAddTransaction(txId, lock);
     }
 
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager.getTransaction(txId, lock)
                     == transaction);
     }
@@ -405,7 +428,8 @@ TEST_F(TransactionManagerTest, relocateParticipantList_relocate) {
 
     TransactionManager::TransactionRecord* transaction;
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getTransaction(txId, lock);
     }
     EXPECT_TRUE(transaction != NULL);
@@ -476,7 +500,8 @@ TEST_F(TransactionManagerTest, relocateParticipantList_clean_duplicate) {
 
     TransactionManager::TransactionRecord* transaction;
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getTransaction(txId, lock);
     }
     EXPECT_TRUE(transaction != NULL);
@@ -508,22 +533,27 @@ TEST_F(TransactionManagerTest, relocateParticipantList_clean_duplicate) {
 TEST_F(TransactionManagerTest, bufferWrite) {
     transactionManager.bufferOp(TransactionId(2, 1), 8, 1028);
     TransactionManager::PreparedItem* item =
-            transactionManager.items[std::make_pair(2UL, 8UL)];
+            transactionManager.getItemShard(2, 8).items[
+                    std::make_pair(2UL, 8UL)];
     EXPECT_EQ(1028UL, item->newOpPtr);
+    EXPECT_EQ(1, item->transaction->preparedOpCount);
 
     // Use during recovery. Should not set timer.
     transactionManager.bufferOp(TransactionId(2, 1), 9, 1029);
-    item = transactionManager.items[std::make_pair(2UL, 9UL)];
+    item = transactionManager.getItemShard(2, 9).items[
+            std::make_pair(2UL, 9UL)];
     EXPECT_EQ(1029UL, item->newOpPtr);
+    EXPECT_EQ(2, item->transaction->preparedOpCount);
+    EXPECT_EQ(2U, transactionManager.getItemCount());
 }
 
 TEST_F(TransactionManagerTest, removeOp) {
     transactionManager.bufferOp(TransactionId(1, 1), 10, 1011);
-    EXPECT_EQ(1011UL,
-              transactionManager.items[std::make_pair(1, 10)]->newOpPtr);
+    TransactionManager::ItemShard& shard =
+            transactionManager.getItemShard(1, 10);
+    EXPECT_EQ(1011UL, shard.items[std::make_pair(1, 10)]->newOpPtr);
     transactionManager.removeOp(1, 10);
-    EXPECT_EQ(transactionManager.items.end(),
-              transactionManager.items.find(std::make_pair(1, 10)));
+    EXPECT_EQ(shard.items.end(), shard.items.find(std::make_pair(1, 10)));
 }
 
 TEST_F(TransactionManagerTest, getOp) {
@@ -585,20 +615,14 @@ TEST_F(TransactionManagerTest, removeOrphanedOps) {
         uint64_t rpcId = 13;
         transactionManager.markOpDeleted(txId.clientLeaseId, rpcId);
     }
-    EXPECT_EQ(3U, transactionManager.items.size());
+    EXPECT_EQ(3U, transactionManager.getItemCount());
 
     transactionManager.removeOrphanedOps();
 
-    EXPECT_EQ(2U, transactionManager.items.size());
-    EXPECT_TRUE(transactionManager.items.end() ==
-                transactionManager.items.find(std::make_pair(txId.clientLeaseId,
-                                                             11)));
-    EXPECT_TRUE(transactionManager.items.end() !=
-                transactionManager.items.find(std::make_pair(txId.clientLeaseId,
-                                                             12)));
-    EXPECT_TRUE(transactionManager.items.end() !=
-                transactionManager.items.find(std::make_pair(txId.clientLeaseId,
-                                                             13)));
+    EXPECT_EQ(2U, transactionManager.getItemCount());
+    EXPECT_EQ(0UL, transactionManager.getOp(txId.clientLeaseId, 11));
+    EXPECT_NE(0UL, transactionManager.getOp(txId.clientLeaseId, 12));
+    EXPECT_TRUE(transactionManager.isOpDeleted(txId.clientLeaseId, 13));
 }
 
 TEST_F(TransactionManagerTest, Protector) {
@@ -607,7 +631,8 @@ TEST_F(TransactionManagerTest, Protector) {
     TransactionManager::Protector* p2;
     TransactionManager::TransactionRecord* transaction = NULL;
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         transaction = transactionManager.getTransaction(txId, lock);
     }
 
@@ -616,7 +641,8 @@ TEST_F(TransactionManagerTest, Protector) {
         TransactionManager::Protector p0(&transactionManager, txId);
         // p0 is live
         {
-            TransactionManager::Lock lock(transactionManager.mutex);
+            TransactionManager::Lock lock(
+                    transactionManager.getTransactionShard(txId).mutex);
             transaction = transactionManager.getTransaction(txId, lock);
         }
         EXPECT_TRUE(transaction != NULL);
@@ -644,12 +670,14 @@ TEST_F(TransactionManagerTest, Protector) {
 }
 
 TEST_F(TransactionManagerTest, TransactionRecord_destructor) {
-    TransactionManager::Lock lock(transactionManager.mutex);
+    TransactionId txId(42, 31);
+    TransactionManager::Lock lock(
+            transactionManager.getTransactionShard(txId).mutex);
 
     TestLog::Enable _("free");
     {
         TransactionManager::TransactionRecord transaction(
-                &transactionManager, TransactionId(42, 31), lock);
+                &transactionManager, txId, lock);
     }
     EXPECT_EQ("", TestLog::get());
 
@@ -659,7 +687,7 @@ TEST_F(TransactionManagerTest, TransactionRecord_destructor) {
     Log::Reference logRef;
     {
         TransactionManager::TransactionRecord transaction(
-                &transactionManager, TransactionId(42, 31), lock);
+                &transactionManager, txId, lock);
         WireFormat::TxParticipant participants[3];
         // construct participant list.
         participants[0] = WireFormat::TxParticipant(1, 2, 10);
@@ -742,12 +770,14 @@ TEST_F(TransactionRecordTest, handleTimerEvent_waiting) {
 
 TEST_F(TransactionRecordTest, inProgress_acked) {
     TestLog::Enable _("inProgress");
-    TransactionManager::Lock lock(service1->transactionManager.mutex);
+    TransactionManager::Lock lock(
+            service1->transactionManager.getTransactionShard(txId).mutex);
     TabletManager::Protector protector(
             service1->transactionManager.tabletManager);
 
     {
-        UnackedRpcResults::Lock lock(service1->unackedRpcResults.mutex);
+        UnackedRpcResults::Lock lock(
+                service1->unackedRpcResults.getShard(42).mutex);
         UnackedRpcResults::Client* client =
                 service1->unackedRpcResults.getOrInitClientRecord(42, lock);
         client->maxAckId = 12;
@@ -761,7 +791,8 @@ TEST_F(TransactionRecordTest, inProgress_acked) {
 
 TEST_F(TransactionRecordTest, inProgress_recovered) {
     TestLog::Enable _("inProgress");
-    TransactionManager::Lock lock(service1->transactionManager.mutex);
+    TransactionManager::Lock lock(
+            service1->transactionManager.getTransactionShard(txId).mutex);
     TabletManager::Protector protector(
             service1->transactionManager.tabletManager);
 
@@ -774,7 +805,8 @@ TEST_F(TransactionRecordTest, inProgress_recovered) {
 
 TEST_F(TransactionRecordTest, inProgress_noParticipantList) {
     TestLog::Enable _("inProgress");
-    TransactionManager::Lock lock(service1->transactionManager.mutex);
+    TransactionManager::Lock lock(
+            service1->transactionManager.getTransactionShard(txId).mutex);
     TabletManager::Protector protector(
             service1->transactionManager.tabletManager);
 
@@ -789,7 +821,8 @@ TEST_F(TransactionRecordTest, inProgress_noLongerAParticipant) {
     TestLog::Enable _("inProgress");
     ramcloud->dropTable("table1");
 
-    TransactionManager::Lock lock(service1->transactionManager.mutex);
+    TransactionManager::Lock lock(
+            service1->transactionManager.getTransactionShard(txId).mutex);
     TabletManager::Protector protector(
             service1->transactionManager.tabletManager);
 
@@ -800,7 +833,8 @@ TEST_F(TransactionRecordTest, inProgress_noLongerAParticipant) {
 
 TEST_F(TransactionRecordTest, inProgress_stillInProgress) {
     TestLog::Enable _("inProgress");
-    TransactionManager::Lock lock(service1->transactionManager.mutex);
+    TransactionManager::Lock lock(
+            service1->transactionManager.getTransactionShard(txId).mutex);
     TabletManager::Protector protector(
             service1->transactionManager.tabletManager);
 
@@ -810,7 +844,8 @@ TEST_F(TransactionRecordTest, inProgress_stillInProgress) {
 
 TEST_F(TransactionRecordTest, inProgress_positivePreparedOpCount) {
     TestLog::Enable _("inProgress");
-    TransactionManager::Lock lock(service1->transactionManager.mutex);
+    TransactionManager::Lock lock(
+            service1->transactionManager.getTransactionShard(txId).mutex);
     TabletManager::Protector protector(
             service1->transactionManager.tabletManager);
 
@@ -823,7 +858,8 @@ TEST_F(TransactionRecordTest, inProgress_positivePreparedOpCount) {
 TEST_F(TransactionRecordTest, inProgress_checkMasterParticipantion) {
     TestLog::Enable _("checkMasterParticipantion");
     {
-        TransactionManager::Lock lock(service1->transactionManager.mutex);
+        TransactionManager::Lock lock(
+                service1->transactionManager.getTransactionShard(txId).mutex);
         TabletManager::Protector protector(
                 service1->transactionManager.tabletManager);
         EXPECT_TRUE(transaction->checkMasterParticipantion(lock, protector));
@@ -835,7 +871,8 @@ TEST_F(TransactionRecordTest, inProgress_checkMasterParticipantion) {
     ramcloud->dropTable("table1");
 
     {
-        TransactionManager::Lock lock(service1->transactionManager.mutex);
+        TransactionManager::Lock lock(
+                service1->transactionManager.getTransactionShard(txId).mutex);
         TabletManager::Protector protector(
                 service1->transactionManager.tabletManager);
         EXPECT_FALSE(transaction->checkMasterParticipantion(lock, protector));
@@ -845,38 +882,42 @@ TEST_F(TransactionRecordTest, inProgress_checkMasterParticipantion) {
 
 TEST_F(TransactionManagerTest, TransactionRegistryCleaner_handleTimerEvent) {
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
-        {
-            TransactionId txId(42, 1);
-            transactionManager.getOrAddTransaction(txId, lock);
-            transactionManager.getTransaction(txId, lock)->recovered = true;
-            transactionManager.cleaner.stop();
-        }
-        {
-            TransactionId txId(42, 2);
-            transactionManager.getOrAddTransaction(txId, lock);
-            transactionManager.getTransaction(txId, lock)->recovered = true;
-            // Disable cleaning on this on.
-            transactionManager.getTransaction(txId, lock)->cleaningDisabled = 1;
-            transactionManager.cleaner.stop();
-        }
-        {
-            TransactionId txId(42, 3);
-            transactionManager.getOrAddTransaction(txId, lock);
-            // This one's not complete
-            transactionManager.getTransaction(txId, lock)->preparedOpCount = 1;
-            transactionManager.cleaner.stop();
-        }
-        {
-            TransactionId txId(43, 1);
-            transactionManager.getOrAddTransaction(txId, lock);
-            transactionManager.getTransaction(txId, lock)->recovered = true;
-            transactionManager.cleaner.stop();
-        }
+        TransactionId txId(42, 1);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
+        transactionManager.getOrAddTransaction(txId, lock);
+        transactionManager.getTransaction(txId, lock)->recovered = true;
+        transactionManager.cleaner.stop();
+    }
+    {
+        TransactionId txId(42, 2);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
+        transactionManager.getOrAddTransaction(txId, lock);
+        transactionManager.getTransaction(txId, lock)->recovered = true;
+        // Disable cleaning on this on.
+        transactionManager.getTransaction(txId, lock)->cleaningDisabled = 1;
+        transactionManager.cleaner.stop();
+    }
+    {
+        TransactionId txId(42, 3);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
+        transactionManager.getOrAddTransaction(txId, lock);
+        // This one's not complete
+        transactionManager.getTransaction(txId, lock)->preparedOpCount = 1;
+        transactionManager.cleaner.stop();
+    }
+    {
+        TransactionId txId(43, 1);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
+        transactionManager.getOrAddTransaction(txId, lock);
+        transactionManager.getTransaction(txId, lock)->recovered = true;
+        transactionManager.cleaner.stop();
     }
 
-    EXPECT_EQ(4U, transactionManager.transactions.size());
-    EXPECT_EQ(4U, transactionManager.transactionIds.size());
+    EXPECT_EQ(4U, getTransactionCount());
     EXPECT_FALSE(transactionManager.cleaner.isRunning());
     TestLog::Enable _("~TransactionRecord", "handleTimerEvent", NULL);
 
@@ -885,32 +926,33 @@ TEST_F(TransactionManagerTest, TransactionRegistryCleaner_handleTimerEvent) {
     // Cleaner blocked by recovering tablet
     transactionManager.cleaner.handleTimerEvent();
 
-    EXPECT_EQ(4U, transactionManager.transactions.size());
-    EXPECT_EQ(4U, transactionManager.transactionIds.size());
+    EXPECT_EQ(4U, getTransactionCount());
     EXPECT_TRUE(transactionManager.cleaner.isRunning());
     EXPECT_EQ("", TestLog::get());
     transactionManager.cleaner.stop();
     tabletManager.deleteTablet(42, 0, 1);
 
-    // Cleaner will run.
+    // Cleaner will run; shards are visited in order, so <42, 2> (shard 40)
+    // comes first and <42, 1> (shard 43) comes last.
     transactionManager.cleaner.handleTimerEvent();
 
-    EXPECT_EQ(2U, transactionManager.transactions.size());
-    EXPECT_EQ(2U, transactionManager.transactionIds.size());
+    EXPECT_EQ(2U, getTransactionCount());
     EXPECT_TRUE(transactionManager.cleaner.isRunning());
     EXPECT_EQ(
-            "~TransactionRecord: TransactionRecord <42, 1> destroyed | "
             "handleTimerEvent: Cleaning disabled for TxId: <42, 2> | "
-            "~TransactionRecord: TransactionRecord <43, 1> destroyed",
+            "~TransactionRecord: TransactionRecord <43, 1> destroyed | "
+            "~TransactionRecord: TransactionRecord <42, 1> destroyed",
             TestLog::get());
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
         TransactionId txId(42, 2);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager.getTransaction(txId, lock) != NULL);
     }
     {
-        TransactionManager::Lock lock(transactionManager.mutex);
         TransactionId txId(42, 3);
+        TransactionManager::Lock lock(
+                transactionManager.getTransactionShard(txId).mutex);
         EXPECT_TRUE(transactionManager.getTransaction(txId, lock) != NULL);
     }
 
@@ -918,8 +960,9 @@ TEST_F(TransactionManagerTest, TransactionRegistryCleaner_handleTimerEvent) {
 }
 
 TEST_F(TransactionManagerTest, PreparedItem_constructor_destructor) {
-    TransactionManager::Lock lock(transactionManager.mutex);
     TransactionId txId(42, 1);
+    TransactionManager::Lock lock(
+            transactionManager.getTransactionShard(txId).mutex);
     TransactionManager::TransactionRecord* transaction =
             transactionManager.getOrAddTransaction(txId, lock);
 
@@ -936,30 +979,46 @@ TEST_F(TransactionManagerTest, PreparedItem_constructor_destructor) {
     EXPECT_EQ(0, transaction->preparedOpCount);
 }
 
+TEST_F(TransactionManagerTest, getItemShard) {
+    // Consecutive rpcIds from a single client spread over different shards.
+    size_t numShards = TransactionManager::NUM_SHARDS;
+    std::set<TransactionManager::ItemShard*> shards;
+    for (uint64_t rpcId = 1; rpcId <= numShards; rpcId++)
+        shards.insert(&transactionManager.getItemShard(7, rpcId));
+    EXPECT_EQ(numShards, shards.size());
+    EXPECT_EQ(&transactionManager.getItemShard(7, 1),
+              &transactionManager.getItemShard(7, 1));
+}
+
 TEST_F(TransactionManagerTest, getTransaction) {
-    TransactionManager::Lock lock(transactionManager.mutex);
     TransactionId txId(42, 1);
+    TransactionManager::Lock lock(
+            transactionManager.getTransactionShard(txId).mutex);
     EXPECT_TRUE(transactionManager.getTransaction(txId, lock) == NULL);
     TransactionManager::TransactionRecord* transaction =
             new TransactionManager::TransactionRecord(&transactionManager,
                                                           txId,
                                                           lock);
-    transactionManager.transactions[txId] = transaction;
+    transactionManager.getTransactionShard(txId).transactions[txId] =
+            transaction;
     EXPECT_TRUE(transactionManager.getTransaction(txId, lock) == transaction);
 }
 
 TEST_F(TransactionManagerTest, getOrAddTransaction) {
-    TransactionManager::Lock lock(transactionManager.mutex);
     TransactionId txId(42, 1);
+    TransactionManager::Lock lock(
+            transactionManager.getTransactionShard(txId).mutex);
     EXPECT_TRUE(transactionManager.getTransaction(txId, lock) == NULL);
     TransactionManager::TransactionRecord* transaction =
             transactionManager.getOrAddTransaction(txId, lock);
+    TransactionManager::TransactionShard& shard =
+            transactionManager.getTransactionShard(txId);
     TransactionManager::TransactionRegistry::iterator it =
-            transactionManager.transactions.find(txId);
-    EXPECT_TRUE(it != transactionManager.transactions.end());
+            shard.transactions.find(txId);
+    EXPECT_TRUE(it != shard.transactions.end());
     EXPECT_TRUE(it->second = transaction);
     EXPECT_TRUE(transactionManager.getTransaction(txId, lock) == transaction);
-    EXPECT_TRUE(transactionManager.transactionIds.back() == txId);
+    EXPECT_TRUE(shard.transactionIds.back() == txId);
 }
 
 } // namespace RAMCloud
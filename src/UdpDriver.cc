@@ -16,6 +16,7 @@
 #include <errno.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -27,6 +28,12 @@
 #include "ServiceLocator.h"
 #include "TimeTrace.h"
 
+// Older C libraries don't define the socket option for UDP generic
+// segmentation offload (added in Linux 4.18).
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
 namespace RAMCloud {
 
 /**
@@ -66,6 +73,9 @@ UdpDriver::UdpDriver(Context* context,
     , bandwidthGbps(10)                   // Default bandwidth = 10 gbs
     , queueEstimator(0)
     , maxTransmitQueueSize(0)
+    , batchTransmits(false)
+    , useGso(false)
+    , txBatch()
     , readerThread()
     , readerThreadExit(false)
 {
@@ -74,6 +84,9 @@ UdpDriver::UdpDriver(Context* context,
         try {
             bandwidthGbps = localServiceLocator->getOption<int>("gbs");
         } catch (ServiceLocator::NoSuchKeyException& e) {}
+        batchTransmits =
+                localServiceLocator->getOption<int>("batch", 0) != 0;
+        useGso = localServiceLocator->getOption<int>("gso", 0) != 0;
     }
     queueEstimator.setBandwidth(1000*bandwidthGbps);
     maxTransmitQueueSize = (uint32_t) (static_cast<double>(bandwidthGbps)
@@ -119,6 +132,17 @@ UdpDriver::UdpDriver(Context* context,
         LOG(NOTICE, "UdpDriver using port %d", NTOHS(address.sin_port));
     }
 
+    if (useGso) {
+        // Find out whether the kernel supports GSO for UDP.
+        int segmentSize = 0;
+        if (sys->setsockopt(fd, SOL_UDP, UDP_SEGMENT, &segmentSize,
+                sizeof(segmentSize)) != 0) {
+            LOG(WARNING, "UdpDriver can't use GSO (%s); sending packets "
+                    "individually", strerror(errno));
+            useGso = false;
+        }
+    }
+
     socketFd = fd;
 
     readerThread.construct(readerThreadMain, this);
@@ -232,6 +256,26 @@ UdpDriver::sendPacket(const Address *addr,
                            (payload ? payload->size() : 0);
     assert(totalLength <= MAX_PAYLOAD_SIZE);
 
+    if (txBatch.active) {
+        // Copy the packet so it can be sent with the rest of the batch.
+        if (txBatch.count == TransmitBatch::MAX_PACKETS) {
+            sendBatch();
+        }
+        TransmitBatch::Packet* packet = &txBatch.packets[txBatch.count];
+        packet->address = static_cast<const IpAddress*>(addr)->address;
+        memcpy(packet->data, header, headerLen);
+        char* dst = packet->data + headerLen;
+        while (payload && !payload->isDone()) {
+            memcpy(dst, payload->getData(), payload->getLength());
+            dst += payload->getLength();
+            payload->next();
+        }
+        txBatch.iovecs[txBatch.count].iov_base = packet->data;
+        txBatch.iovecs[txBatch.count].iov_len = totalLength;
+        txBatch.count++;
+        return;
+    }
+
     // one for header, the rest for payload
     uint32_t iovecs = 1 + (payload ? payload->getNumberChunks() : 0);
 
@@ -265,6 +309,91 @@ UdpDriver::sendPacket(const Address *addr,
     assert(static_cast<size_t>(r) == totalLength);
 }
 
+// See docs in Driver class.
+void
+UdpDriver::startTransmitBatch()
+{
+    txBatch.active = batchTransmits;
+}
+
+// See docs in Driver class.
+void
+UdpDriver::flushTransmitBatch()
+{
+    if (txBatch.count > 0) {
+        sendBatch();
+    }
+    txBatch.active = false;
+}
+
+/**
+ * Pass all of the packets in txBatch to the kernel, then empty it.
+ */
+void
+UdpDriver::sendBatch()
+{
+    // Each iteration of this loop fills in one message header, which
+    // covers one packet or (with GSO) several consecutive packets to the
+    // same destination. GSO splits a message into segments of the size of
+    // its first packet, so all packets but the last must have that size.
+    int messages = 0;
+    uint64_t now = Cycles::rdtsc();
+    for (int i = 0; i < txBatch.count; ) {
+        int first = i;
+        size_t segmentSize = txBatch.iovecs[first].iov_len;
+        size_t bytes = segmentSize;
+        const sockaddr_in* dest = reinterpret_cast<const sockaddr_in*>(
+                &txBatch.packets[first].address);
+        queueEstimator.packetQueued(downCast<uint32_t>(segmentSize), now);
+        for (i++; useGso && i < txBatch.count; i++) {
+            const sockaddr_in* next = reinterpret_cast<const sockaddr_in*>(
+                    &txBatch.packets[i].address);
+            size_t length = txBatch.iovecs[i].iov_len;
+            if (next->sin_addr.s_addr != dest->sin_addr.s_addr ||
+                    next->sin_port != dest->sin_port ||
+                    txBatch.iovecs[i-1].iov_len != segmentSize ||
+                    length > segmentSize ||
+                    bytes + length > MAX_GSO_BYTES) {
+                break;
+            }
+            bytes += length;
+            queueEstimator.packetQueued(downCast<uint32_t>(length), now);
+        }
+
+        struct msghdr* msg = &txBatch.messageHeaders[messages].msg_hdr;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_name = &txBatch.packets[first].address;
+        msg->msg_namelen = sizeof(txBatch.packets[first].address);
+        msg->msg_iov = &txBatch.iovecs[first];
+        msg->msg_iovlen = i - first;
+        if (i - first > 1) {
+            msg->msg_control = txBatch.control[messages];
+            msg->msg_controllen = sizeof(txBatch.control[messages]);
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            *reinterpret_cast<uint16_t*>(CMSG_DATA(cmsg)) =
+                    downCast<uint16_t>(segmentSize);
+        }
+        messages++;
+    }
+    txBatch.count = 0;
+
+    int sent = 0;
+    while (sent < messages) {
+        int r = sys->sendmmsg(socketFd, &txBatch.messageHeaders[sent],
+                messages - sent, 0);
+        if (r == -1) {
+            // Skip the message that couldn't be sent.
+            LOG(WARNING, "UdpDriver error sending to socket: %s",
+                    strerror(errno));
+            r = 1;
+        }
+        sent += r;
+    }
+}
+
 /**
  * Notify the reader thread that it should exit. Don't actually wait for the
  * thread to return here, though.
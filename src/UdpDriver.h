@@ -53,6 +53,8 @@ class UdpDriver : public Driver {
                             uint32_t headerLen,
                             Buffer::Iterator *payload);
     virtual string getServiceLocator();
+    virtual void startTransmitBatch();
+    virtual void flushTransmitBatch();
 
     virtual Address* newAddress(const ServiceLocator* serviceLocator) {
         return new IpAddress(serviceLocator);
@@ -120,6 +122,65 @@ class UdpDriver : public Driver {
         }
     };
 
+    /**
+     * Holds packets passed to sendPacket between calls to startTransmitBatch
+     * and flushTransmitBatch, so that they can be passed to the kernel
+     * with a single sendmmsg call.
+     */
+    struct TransmitBatch {
+        /// Maximum number of packets that can be held at once; if more are
+        /// sent, the batch is flushed early. This is also the kernel's limit
+        /// on the number of segments in a single GSO send.
+        static const int MAX_PACKETS = 64;
+
+        /// A copy of a packet passed to sendPacket (callers may free the
+        /// original data as soon as sendPacket returns).
+        struct Packet {
+            /// Where to send the packet.
+            sockaddr address;
+
+            /// Header followed by payload.
+            char data[MAX_PAYLOAD_SIZE];
+        };
+
+        /// True means we are between calls to startTransmitBatch and
+        /// flushTransmitBatch, so sendPacket should queue packets here.
+        bool active;
+
+        /// Number of valid entries in packets and iovecs.
+        int count;
+
+        /// Entries in this array correspond to those in packets; the kernel
+        /// gathers packet data from them.
+        struct iovec iovecs[MAX_PACKETS];
+
+        /// Arguments to the sendmmsg kernel call; each entry describes
+        /// either one packet or, with GSO, several consecutive packets to
+        /// the same destination.
+        struct mmsghdr messageHeaders[MAX_PACKETS];
+
+        /// Control message storage for the UDP_SEGMENT option of each entry
+        /// in messageHeaders.
+        char control[MAX_PACKETS][CMSG_SPACE(sizeof(uint16_t))];
+
+        /// Storage for the packets themselves.
+        Packet packets[MAX_PACKETS];
+
+        TransmitBatch()
+            : active(false)
+            , count(0)
+            , iovecs()
+            , messageHeaders()
+            , control()
+            , packets()
+        {}
+    };
+
+    /// Largest total payload the kernel accepts in one GSO send.
+    static const uint32_t MAX_GSO_BYTES = 65507;
+
+    void sendBatch();
+
     /// Shared RAMCloud information.
     Context* context;
 
@@ -163,6 +224,25 @@ class UdpDriver : public Driver {
     /// at any given time.
     uint32_t maxTransmitQueueSize;
 
+    /// True means packets sent between startTransmitBatch and
+    /// flushTransmitBatch are passed to the kernel with one sendmmsg call;
+    /// false means each packet is sent immediately with sendmsg. Set with
+    /// the "batch" option in the service locator (default: 0). Off by
+    /// default because each batched packet must be copied, which adds
+    /// latency to small RPCs; it pays off for bursts of large messages.
+    bool batchTransmits;
+
+    /// True means consecutive packets in a batch that go to the same
+    /// destination are passed to the kernel as one message with UDP
+    /// generic segmentation offload (UDP_SEGMENT), so the kernel only
+    /// traverses the network stack once for them. Set with the "gso"
+    /// option in the service locator (default: 0); ignored if the kernel
+    /// doesn't support it.
+    bool useGso;
+
+    /// Packets held for the current transmit batch.
+    TransmitBatch txBatch;
+
     /// The following thread runs in the background to wait for kernel calls
     /// that receive packets.
     Tub<std::thread> readerThread;
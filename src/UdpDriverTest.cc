@@ -129,6 +129,24 @@ TEST_F(UdpDriverTest, constructor_gbsOption) {
     EXPECT_EQ(2800u, driver2.maxTransmitQueueSize);
     Cycles::mockCyclesPerSec = 0;
 }
+TEST_F(UdpDriverTest, constructor_batchAndGsoOptions) {
+    EXPECT_FALSE(client.batchTransmits);
+    EXPECT_FALSE(client.useGso);
+
+    ServiceLocator locator("basic+udp:host=localhost,port=8101,batch=1,gso=1");
+    UdpDriver driver(&context, &locator);
+    EXPECT_TRUE(driver.batchTransmits);
+    EXPECT_TRUE(driver.useGso);
+}
+TEST_F(UdpDriverTest, constructor_gsoNotSupported) {
+    sys->setsockoptErrno = ENOPROTOOPT;
+    ServiceLocator locator("basic+udp:host=localhost,port=8101,gso=1");
+    UdpDriver driver(&context, &locator);
+    EXPECT_FALSE(driver.useGso);
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "UdpDriver: UdpDriver can't use GSO (Protocol not available); "
+            "sending packets individually"));
+}
 TEST_F(UdpDriverTest, constructor_errorInSocketCall) {
     sys->socketErrno = EPERM;
     try {
@@ -295,6 +313,118 @@ TEST_F(UdpDriverTest, sendPacket_errorInSend) {
             "Operation not permitted", TestLog::get());
 }
 
+TEST_F(UdpDriverTest, startTransmitBatch) {
+    client.batchTransmits = true;
+    client.startTransmitBatch();
+    EXPECT_TRUE(client.txBatch.active);
+    client.flushTransmitBatch();
+    client.batchTransmits = false;
+    client.startTransmitBatch();
+    EXPECT_FALSE(client.txBatch.active);
+    sendMessage(&client, &serverAddress, "header:", "xyzzy");
+    EXPECT_EQ(0, client.txBatch.count);
+    EXPECT_EQ("header:xyzzy", receivePackets(&server));
+}
+
+TEST_F(UdpDriverTest, sendPacket_batched) {
+    client.batchTransmits = true;
+    client.startTransmitBatch();
+    {
+        // The packet must be copied: the caller's data goes away.
+        string payload("0123456789");
+        sendMessage(&client, &serverAddress, "p1:", payload.c_str());
+    }
+    sendMessage(&client, &serverAddress, "p2:", "abc");
+    EXPECT_EQ(2, client.txBatch.count);
+    EXPECT_EQ(13U, client.txBatch.iovecs[0].iov_len);
+    std::vector<Driver::Received> receivedPackets;
+    usleep(1000);
+    server.receivePackets(5, &receivedPackets);
+    EXPECT_EQ(0U, receivedPackets.size());
+    client.flushTransmitBatch();
+    EXPECT_FALSE(client.txBatch.active);
+    EXPECT_EQ(0, client.txBatch.count);
+    string received = receivePackets(&server);
+    if (received == "p1:0123456789") {
+        received += ", " + receivePackets(&server);
+    }
+    EXPECT_EQ("p1:0123456789, p2:abc", received);
+}
+
+TEST_F(UdpDriverTest, sendPacket_batchFull) {
+    client.batchTransmits = true;
+    client.startTransmitBatch();
+    for (int i = 0; i < UdpDriver::TransmitBatch::MAX_PACKETS; i++) {
+        client.sendPacket(&serverAddress, "x", 1, NULL);
+    }
+    EXPECT_EQ(static_cast<int>(UdpDriver::TransmitBatch::MAX_PACKETS),
+              client.txBatch.count);
+    client.sendPacket(&serverAddress, "y", 1, NULL);
+    EXPECT_EQ(1, client.txBatch.count);
+    client.flushTransmitBatch();
+}
+
+TEST_F(UdpDriverTest, sendBatch_noGso) {
+    client.batchTransmits = true;
+    client.startTransmitBatch();
+    client.sendPacket(&serverAddress, "packet1", 7, NULL);
+    client.sendPacket(&serverAddress, "packet2", 7, NULL);
+    client.sendBatch();
+    EXPECT_EQ(1U, client.txBatch.messageHeaders[1].msg_hdr.msg_iovlen);
+    EXPECT_EQ(7U, client.txBatch.messageHeaders[1].msg_len);
+    client.flushTransmitBatch();
+}
+
+TEST_F(UdpDriverTest, sendBatch_gso) {
+    client.batchTransmits = true;
+    client.useGso = true;
+    IpAddress otherAddress(serverAddress);
+    reinterpret_cast<sockaddr_in*>(&otherAddress.address)->sin_port =
+            HTONS(8101);
+    client.startTransmitBatch();
+    client.sendPacket(&serverAddress, "packet1", 7, NULL);
+    client.sendPacket(&serverAddress, "packet2", 7, NULL);
+    client.sendPacket(&serverAddress, "p3", 2, NULL);
+
+    // Starts a new message: previous packet was short.
+    client.sendPacket(&serverAddress, "p4", 2, NULL);
+
+    // Starts a new message: different destination.
+    client.sendPacket(&otherAddress, "p5", 2, NULL);
+    client.sendBatch();
+    EXPECT_EQ(3U, client.txBatch.messageHeaders[0].msg_hdr.msg_iovlen);
+    EXPECT_EQ(1U, client.txBatch.messageHeaders[1].msg_hdr.msg_iovlen);
+    EXPECT_EQ(1U, client.txBatch.messageHeaders[2].msg_hdr.msg_iovlen);
+    EXPECT_EQ(16U, client.txBatch.messageHeaders[0].msg_len);
+    client.flushTransmitBatch();
+
+    // The kernel splits the first message back into separate packets.
+    string received;
+    string expected("packet1, packet2, p3, p4");
+    for (int i = 0; i < 4 && received.size() < expected.size(); i++) {
+        if (!received.empty()) {
+            received += ", ";
+        }
+        received += receivePackets(&server);
+    }
+    EXPECT_EQ(expected, received);
+}
+
+TEST_F(UdpDriverTest, sendBatch_errorInSend) {
+    client.batchTransmits = true;
+    client.startTransmitBatch();
+    client.sendPacket(&serverAddress, "packet1", 7, NULL);
+    client.sendPacket(&serverAddress, "packet2", 7, NULL);
+    sys->sendmmsgErrno = EPERM;
+    client.sendBatch();
+    EXPECT_EQ("sendBatch: UdpDriver error sending to socket: "
+            "Operation not permitted | "
+            "sendBatch: UdpDriver error sending to socket: "
+            "Operation not permitted", TestLog::get());
+    sys->sendmmsgErrno = 0;
+    client.flushTransmitBatch();
+}
+
 TEST_F(UdpDriverTest, stopReaderThread_basics) {
     client.stopReaderThread();
     TestUtil::waitForLog();
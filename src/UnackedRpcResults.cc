@@ -162,8 +162,7 @@ UnackedRpcResults::UnackedRpcResults(Context* context,
                                      AbstractLog::ReferenceFreer* freer,
                                      ClientLeaseValidator* leaseValidator,
                                      TabletManager* tabletManager)
-    : clients(20)
-    , mutex()
+    : shards()
     , default_rpclist_size(50)
     , context(context)
     , leaseValidator(leaseValidator)
@@ -178,9 +177,13 @@ UnackedRpcResults::UnackedRpcResults(Context* context,
  */
 UnackedRpcResults::~UnackedRpcResults()
 {
-    for (ClientMap::iterator it = clients.begin(); it != clients.end(); ++it) {
-        Client* client = it->second;
-        delete client;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        ClientMap& clients = shards[i].clients;
+        for (ClientMap::iterator it = clients.begin(); it != clients.end();
+                ++it) {
+            Client* client = it->second;
+            delete client;
+        }
     }
 }
 
@@ -239,12 +242,11 @@ UnackedRpcResults::checkDuplicate(WireFormat::ClientLease clientLease,
                                   uint64_t ackId,
                                   void** resultPtrOut)
 {
-    Lock lock(mutex);
+    uint64_t clientId = clientLease.leaseId;
+    Lock lock(getShard(clientId).mutex);
     *resultPtrOut = NULL;
     bool isDuplicate = false;
 
-    uint64_t clientId = clientLease.leaseId;
-
     Client* client = getOrInitClientRecord(clientId, lock);
 
     // Update lease with more up-to-date information if available to avoid
@@ -321,7 +323,7 @@ UnackedRpcResults::shouldRecover(uint64_t clientId,
                                  uint64_t ackId,
                                  LogEntryType entryType)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getOrInitClientRecord(clientId, lock);
     if (client->maxAckId < ackId)
         client->processAck(ackId, freer);
@@ -358,7 +360,7 @@ UnackedRpcResults::recordCompletion(uint64_t clientId,
                                       void* result,
                                       bool ignoreIfAcked)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
     if (ignoreIfAcked && client == NULL) {
         return;
@@ -381,7 +383,7 @@ UnackedRpcResults::recordCompletion(uint64_t clientId,
 
 /**
  * Recover a record of an RPC from RpcResult log entry.
- * It may insert a new clientId to #clients. (Protected with concurrent GC.)
+ * It may insert a new clientId into its Shard. (Protected with concurrent GC.)
  * The leaseExpiration is not provided and fetched from coordinator lazily while
  * servicing an RPC from same client or during GC of cleanByTimeout().
  *
@@ -400,7 +402,7 @@ UnackedRpcResults::recoverRecord(uint64_t clientId,
                                  uint64_t ackId,
                                  void* result)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getOrInitClientRecord(clientId, lock);
 
     //1. Handle Ack.
@@ -432,7 +434,7 @@ UnackedRpcResults::recoverRecord(uint64_t clientId,
 void
 UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
 
     if (client == NULL) {
@@ -463,7 +465,7 @@ UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
 bool
 UnackedRpcResults::isRpcAcked(uint64_t clientId, uint64_t rpcId)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
     if (client == NULL) {
         return true;
@@ -486,7 +488,7 @@ UnackedRpcResults::SingleClientProtector::SingleClientProtector(
     : unackedRpcResults(unackedRpcResults)
     , clientId(clientId)
 {
-    Lock lock(unackedRpcResults->mutex);
+    Lock lock(unackedRpcResults->getShard(clientId).mutex);
     // Make a new client record if it doesn't exist.
     Client* client = unackedRpcResults->getOrInitClientRecord(clientId, lock);
     ++client->doNotRemove;
@@ -498,7 +500,7 @@ UnackedRpcResults::SingleClientProtector::SingleClientProtector(
  */
 UnackedRpcResults::SingleClientProtector::~SingleClientProtector()
 {
-    Lock lock(unackedRpcResults->mutex);
+    Lock lock(unackedRpcResults->getShard(clientId).mutex);
     Client* client = unackedRpcResults->getClientRecord(clientId, lock);
     assert(client != NULL);
     --client->doNotRemove;
@@ -506,6 +508,9 @@ UnackedRpcResults::SingleClientProtector::~SingleClientProtector()
 
 /**
  * Clean up stale clients who haven't communicated long.
+ * Each call examines at most Cleaner::maxIterPerPeriod clients, resuming
+ * where the previous call left off, and holds the lock of only one shard at
+ * a time.
  * Should not concurrently run this function in several threads.
  * Serialized by Cleaner inherited from WorkerTimer.
  */
@@ -513,21 +518,22 @@ void
 UnackedRpcResults::cleanByTimeout()
 {
     vector<ClientLease> victims;
-    {
-        Lock lock(mutex);
+    victims.reserve(Cleaner::maxIterPerPeriod / 10);
 
-        // Sweep table and pick candidates.
-        victims.reserve(Cleaner::maxIterPerPeriod / 10);
+    // Sweep shards and pick candidates.
+    int checked = 0;
+    while (checked < Cleaner::maxIterPerPeriod) {
+        Shard& shard = shards[cleaner.nextShardToCheck];
+        Lock lock(shard.mutex);
 
         ClientMap::iterator it;
         if (cleaner.nextClientToCheck) {
-            it = clients.find(cleaner.nextClientToCheck);
+            it = shard.clients.find(cleaner.nextClientToCheck);
         } else {
-            it = clients.begin();
+            it = shard.clients.begin();
         }
-        for (int i = 0; i < Cleaner::maxIterPerPeriod && it != clients.end();
-                        //&& victims.size() < Cleaner::maxCheckPerPeriod;
-             ++i, ++it) {
+        for (; checked < Cleaner::maxIterPerPeriod &&
+                it != shard.clients.end(); ++checked, ++it) {
             Client* client = it->second;
 
             ClientLease lease = {it->first,
@@ -537,28 +543,37 @@ UnackedRpcResults::cleanByTimeout()
                 victims.push_back(lease);
             }
         }
-        if (it == clients.end()) {
-            cleaner.nextClientToCheck = 0;
-        } else {
+        if (it != shard.clients.end()) {
             cleaner.nextClientToCheck = it->first;
+            break;
+        }
+        cleaner.nextClientToCheck = 0;
+        cleaner.nextShardToCheck = (cleaner.nextShardToCheck + 1) %
+                NUM_SHARDS;
+        if (cleaner.nextShardToCheck == 0) {
+            // Swept every shard; start from the beginning next time.
+            break;
         }
     }
 
     // Check with coordinator whether the lease is expired.
     // And erase entry if the lease is expired.
     for (uint32_t i = 0; i < victims.size(); ++i) {
-        Lock lock(mutex);
+        uint64_t clientId = victims[i].leaseId;
+        Shard& shard = getShard(clientId);
+        Lock lock(shard.mutex);
+        Client* client = getClientRecord(clientId, lock);
+        assert(client != NULL);
         // Do not clean if this client record is protected
-        if (clients[victims[i].leaseId]->doNotRemove)
+        if (client->doNotRemove)
             continue;
         // Do not clean if there are RPCs still in progress for this client.
-        if (clients[victims[i].leaseId]->numRpcsInProgress)
+        if (client->numRpcsInProgress)
             continue;
 
         ClientLease lease = victims[i];
         if (leaseValidator->validate(lease, &lease)) {
-            clients[victims[i].leaseId]->leaseExpiration =
-                                            ClusterTime(lease.leaseExpiration);
+            client->leaseExpiration = ClusterTime(lease.leaseExpiration);
         } else {
             TabletManager::Protector tp(tabletManager);
             if (tp.notReadyTabletExists()) {
@@ -572,10 +587,11 @@ UnackedRpcResults::cleanByTimeout()
             }
             // After preventing the start of tablet migration or recovery,
             // check SingleClientProtector once more before deletion.
-            if (clients[victims[i].leaseId]->doNotRemove)
+            if (client->doNotRemove)
                 continue;
 
-            clients.erase(victims[i].leaseId);
+            shard.clients.erase(clientId);
+            delete client;
         }
     }
 }
@@ -587,6 +603,7 @@ UnackedRpcResults::cleanByTimeout()
 bool
 UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
     Client* client;
+    ClientMap& clients = getShard(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it == clients.end()) {
         return false;
@@ -610,6 +627,7 @@ UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
 UnackedRpcResults::Cleaner::Cleaner(UnackedRpcResults* unackedRpcResults)
     : WorkerTimer(unackedRpcResults->context->dispatch)
     , unackedRpcResults(unackedRpcResults)
+    , nextShardToCheck(0)
     , nextClientToCheck(0)
 {
 }
@@ -741,20 +759,50 @@ UnackedRpcResults::Client::resizeRpcs(int newLen) {
     len = newLen;
 }
 
+/**
+ * Return the shard that holds (or will hold) a given client's record.
+ *
+ * \param clientId
+ *      The id of the client.
+ */
+UnackedRpcResults::Shard&
+UnackedRpcResults::getShard(uint64_t clientId)
+{
+    // Lease ids are handed out sequentially by the coordinator, so the
+    // low-order bits spread clients evenly over the shards.
+    return shards[clientId & (NUM_SHARDS - 1)];
+}
+
+/**
+ * Returns the total number of client records in all of the shards.  Walks
+ * all of the shards, so it is intended for testing.
+ */
+size_t
+UnackedRpcResults::getClientCount()
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        Lock lock(shards[i].mutex);
+        count += shards[i].clients.size();
+    }
+    return count;
+}
+
 /**
  * Return a pointer to the requested client record if it exists.
  *
  * \param clientId
  *      The id of the client whose record should be returned.
  * \param lock
- *      Used to ensure that caller has acquired UnackedRpcResults::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the Shard
+ *      for clientId.  Not actually used by the method.
  * \return
  *      Pointer to the client record if one exists; NULL otherwise.
  */
 UnackedRpcResults::Client*
 UnackedRpcResults::getClientRecord(uint64_t clientId, Lock& lock)
 {
+    ClientMap& clients = getShard(clientId).clients;
     Client* client = NULL;
     ClientMap::iterator it = clients.find(clientId);
     if (it != clients.end()) {
@@ -770,14 +818,15 @@ UnackedRpcResults::getClientRecord(uint64_t clientId, Lock& lock)
  * \param clientId
  *      The id of the client whose record should be returned.
  * \param lock
- *      Used to ensure that caller has acquired UnackedRpcResults::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the Shard
+ *      for clientId.  Not actually used by the method.
  * \return
  *      Pointer to the existing or newly inserted client record.
  */
 UnackedRpcResults::Client*
 UnackedRpcResults::getOrInitClientRecord(uint64_t clientId, Lock& lock)
 {
+    ClientMap& clients = getShard(clientId).clients;
     Client* client = NULL;
     ClientMap::iterator it = clients.find(clientId);
     if (it != clients.end()) {
@@ -124,8 +124,8 @@ class UnackedRpcResults {
     /**
      * The Cleaner periodically wakes up to clean up records of clients with
      * expired leases in unackedRpcResults.
-     * Cleaner blocks the access to unackedRpcResults, so we limit the number
-     * of clients we clean each time.
+     * Cleaner blocks the access to the shard it is examining, so we limit the
+     * number of clients we clean each time.
      */
     class Cleaner : public WorkerTimer {
       public:
@@ -135,7 +135,11 @@ class UnackedRpcResults {
         /// The pointer to unackedRpcResults which will be cleaned.
         UnackedRpcResults* unackedRpcResults;
 
-        /// Starting point of next round of cleaning.
+        /// Shard in which the next round of cleaning starts.
+        uint32_t nextShardToCheck;
+
+        /// Starting point of next round of cleaning within nextShardToCheck;
+        /// 0 means the beginning of the shard.
         uint64_t nextClientToCheck;
 
         /// The maximum number of clients we check for liveness.
@@ -246,13 +250,31 @@ class UnackedRpcResults {
      * Clients are dynamically allocated and must be freed explicitly.
      */
     typedef std::unordered_map<uint64_t, Client*> ClientMap;
-    ClientMap clients;
 
     /**
-     * Monitor-style lock. Any operation on internal data structure should
-     * hold this lock.
+     * Number of shards into which client records are divided.  Must be a
+     * power of 2; a client's shard is given by the low-order bits of its id.
+     */
+    static const uint32_t NUM_SHARDS = 64;
+
+    /**
+     * One shard of the client records.  Linearizable RPCs from clients in
+     * different shards can be checked and recorded concurrently.
      */
-    std::mutex mutex;
+    struct Shard {
+        Shard() : mutex(), clients(), pad() {}
+
+        /// Monitor-style lock. Any operation on #clients, or on a Client
+        /// in it, should hold this lock.
+        std::mutex mutex;
+
+        /// Records of the clients whose ids map to this shard.
+        ClientMap clients;
+
+        /// Keeps neighboring shards' locks on different cache lines.
+        char pad[CACHE_LINE_SIZE];
+    };
+    Shard shards[NUM_SHARDS];
     typedef std::lock_guard<std::mutex> Lock;
 
     /**
@@ -286,6 +308,8 @@ class UnackedRpcResults {
     TabletManager* tabletManager;
 
     // Helper methods
+    Shard& getShard(uint64_t clientId);
+    size_t getClientCount();
     Client* getClientRecord(uint64_t clientId, Lock& lock);
     Client* getOrInitClientRecord(uint64_t clientId, Lock& lock);
 
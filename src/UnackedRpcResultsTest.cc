@@ -102,6 +102,19 @@ class UnackedRpcResultsTest : public ::testing::Test {
         results.recordCompletion(1, 10, reinterpret_cast<void*>(1010), &freer);
     }
 
+    /// Returns the record for a given client in results, or NULL if there
+    /// is none.
+    UnackedRpcResults::Client*
+    getClient(uint64_t clientId)
+    {
+        UnackedRpcResults::ClientMap& clients =
+                results.getShard(clientId).clients;
+        UnackedRpcResults::ClientMap::iterator it = clients.find(clientId);
+        if (it == clients.end())
+            return NULL;
+        return it->second;
+    }
+
     DISALLOW_COPY_AND_ASSIGN(UnackedRpcResultsTest);
 };
 
@@ -119,11 +132,11 @@ TEST_F(UnackedRpcResultsTest, checkDuplicate_basic) {
                  StaleRpcException);
 
     //3. Fast-path new RPC (rpcId > maxRpcId == true).
-    EXPECT_EQ(10UL, results.clients[1]->maxRpcId);
+    EXPECT_EQ(10UL, getClient(1)->maxRpcId);
     EXPECT_FALSE(results.checkDuplicate(clientLease, 11, 6, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
-    EXPECT_EQ(11UL, results.clients[1]->maxRpcId);
-    EXPECT_EQ(6UL, results.clients[1]->maxAckId);
+    EXPECT_EQ(11UL, getClient(1)->maxRpcId);
+    EXPECT_EQ(6UL, getClient(1)->maxAckId);
 
     EXPECT_TRUE(results.checkDuplicate(clientLease, 11, 6, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
@@ -131,12 +144,12 @@ TEST_F(UnackedRpcResultsTest, checkDuplicate_basic) {
     //4. Duplicate RPC.
     EXPECT_TRUE(results.checkDuplicate(clientLease, 10, 6, &result));
     EXPECT_EQ(1010UL, (uint64_t)result);
-    EXPECT_EQ(6UL, results.clients[1]->maxAckId);
+    EXPECT_EQ(6UL, getClient(1)->maxAckId);
 
     //5. Inside the window and new RPC.
     EXPECT_FALSE(results.checkDuplicate(clientLease, 9, 7, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
-    EXPECT_EQ(7UL, results.clients[1]->maxAckId);
+    EXPECT_EQ(7UL, getClient(1)->maxAckId);
 
     EXPECT_TRUE(results.checkDuplicate(clientLease, 9, 7, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
@@ -179,12 +192,10 @@ TEST_F(UnackedRpcResultsTest, shouldRecover) {
     //Auto client insertion
     EXPECT_TRUE(results.shouldRecover(2, 4, 2, LOG_ENTRY_TYPE_RPCRESULT));
     // ^ ClientId = 2 inserted.
-    std::unordered_map<uint64_t, UnackedRpcResults::Client*>::iterator it;
-    it = results.clients.find(2);
-    EXPECT_NE(it, results.clients.end());
+    UnackedRpcResults::Client* client = getClient(2);
+    ASSERT_TRUE(client != NULL);
 
     //Ack update
-    UnackedRpcResults::Client* client = it->second;
     EXPECT_EQ(2UL, client->maxAckId);
 }
 
@@ -217,12 +228,12 @@ TEST_F(UnackedRpcResultsTest, recordCompletion) {
     results.recordCompletion(1, 4, reinterpret_cast<void*>(1012), true);
     results.recordCompletion(10, 1, reinterpret_cast<void*>(1012), true);
 
-    EXPECT_EQ(16UL, results.clients[1]->maxRpcId);
-    EXPECT_EQ(50, results.clients[1]->len);
+    EXPECT_EQ(16UL, getClient(1)->maxRpcId);
+    EXPECT_EQ(50, getClient(1)->len);
 
     //Resized Client keeps the original data.
     results.checkDuplicate(clientLease, 17, 5, &result);
-    EXPECT_EQ(50, results.clients[1]->len);
+    EXPECT_EQ(50, getClient(1)->len);
     for (int i = 12; i <= 16; ++i) {
         EXPECT_TRUE(results.checkDuplicate(clientLease, i, 5, &result));
         EXPECT_EQ((uint64_t)(i + 1000), (uint64_t)result);
@@ -258,38 +269,35 @@ TEST_F(UnackedRpcResultsTest, recoverRecord) {
     void* result;
     uint64_t leaseId = 10;
 
-    UnackedRpcResults::ClientMap::iterator it = results.clients.find(leaseId);
-    EXPECT_TRUE(it == results.clients.end());
+    EXPECT_TRUE(getClient(leaseId) == NULL);
 
     // New Record w/ rpcId or ackId updates.
 
     results.recoverRecord(leaseId, 20, 10, &result);
 
-    it = results.clients.find(leaseId);
-    EXPECT_FALSE(it == results.clients.end());
-    EXPECT_EQ(10U, it->second->maxAckId);
-    EXPECT_EQ(20U, it->second->maxRpcId);
-    EXPECT_TRUE(it->second->hasRecord(20));
+    UnackedRpcResults::Client* client = getClient(leaseId);
+    ASSERT_TRUE(client != NULL);
+    EXPECT_EQ(10U, client->maxAckId);
+    EXPECT_EQ(20U, client->maxRpcId);
+    EXPECT_TRUE(client->hasRecord(20));
 
     // New Record w/o rpcId or ackId updates.
-    EXPECT_FALSE(it->second->hasRecord(15));
+    EXPECT_FALSE(client->hasRecord(15));
 
     results.recoverRecord(leaseId, 15, 5, &result);
 
-    it = results.clients.find(leaseId);
-    EXPECT_FALSE(it == results.clients.end());
-    EXPECT_EQ(10U, it->second->maxAckId);
-    EXPECT_EQ(20U, it->second->maxRpcId);
-    EXPECT_TRUE(it->second->hasRecord(15));
+    EXPECT_EQ(client, getClient(leaseId));
+    EXPECT_EQ(10U, client->maxAckId);
+    EXPECT_EQ(20U, client->maxRpcId);
+    EXPECT_TRUE(client->hasRecord(15));
 
     // Unnecessary record.
-    EXPECT_FALSE(it->second->hasRecord(5));
+    EXPECT_FALSE(client->hasRecord(5));
 
     results.recoverRecord(leaseId, 5, 1, &result);
 
-    it = results.clients.find(leaseId);
-    EXPECT_FALSE(it == results.clients.end());
-    EXPECT_FALSE(it->second->hasRecord(5));
+    EXPECT_EQ(client, getClient(leaseId));
+    EXPECT_FALSE(client->hasRecord(5));
 
     // Duplicate record.
 //    TestLog::reset();
@@ -369,14 +377,14 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_basic) {
     void* result;
     ClientLease clientLease = {0, 0, 0};
     results.cleanByTimeout();
-    EXPECT_EQ(1U, results.clients.size());
+    EXPECT_EQ(1U, results.getClientCount());
     clientLease = {2, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     clientLease = {3, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
 
     results.cleanByTimeout();
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.getClientCount());
 
     TestLog::Enable _;
     TestLog::reset();
@@ -388,12 +396,12 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_basic) {
     service->clusterClock.updateClock(ClusterTime(2));
 
     results.cleanByTimeout();
-    EXPECT_EQ(2U, results.clients.size());
+    EXPECT_EQ(2U, results.getClientCount());
 
     //Complete in progress rpcs and try cleanup again.
     results.recordCompletion(3, 10, &result);
     results.cleanByTimeout();
-    EXPECT_EQ(1U, results.clients.size());
+    EXPECT_EQ(1U, results.getClientCount());
 
     EXPECT_EQ(ClusterTime(2U), service->clusterClock.getTime());
 
@@ -405,9 +413,9 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_basic) {
     clientLease = {realLease.leaseId, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     results.recordCompletion(realLease.leaseId, 10, &result);
-    EXPECT_EQ(2U, results.clients.size());
+    EXPECT_EQ(2U, results.getClientCount());
     results.cleanByTimeout();
-    EXPECT_EQ(2U, results.clients.size());
+    EXPECT_EQ(2U, results.getClientCount());
 }
 
 TEST_F(UnackedRpcResultsTest, cleanByTimeout_client_doNotRemove) {
@@ -420,7 +428,7 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_client_doNotRemove) {
     clientLease = {3, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     results.recordCompletion(3, 10, &result);
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.getClientCount());
 
     service->clusterClock.updateClock(ClusterTime(2));
 
@@ -428,13 +436,13 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_client_doNotRemove) {
         // With prevent client 2 from being cleaned.
         UnackedRpcResults::SingleClientProtector _(&results, 2);
         results.cleanByTimeout();
-        EXPECT_EQ(1U, results.clients.size());
-        EXPECT_TRUE(results.clients.find(2) != results.clients.end());
+        EXPECT_EQ(1U, results.getClientCount());
+        EXPECT_TRUE(getClient(2) != NULL);
     }
 
     // Without the KeepClientRecord object, everything should be cleaned.
     results.cleanByTimeout();
-    EXPECT_EQ(0U, results.clients.size());
+    EXPECT_EQ(0U, results.getClientCount());
 }
 
 TEST_F(UnackedRpcResultsTest, cleanByTimeout_TabletIsLoadingState) {
@@ -447,33 +455,56 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_TabletIsLoadingState) {
     clientLease = {3, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     results.recordCompletion(3, 10, &result);
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.getClientCount());
 
     service->clusterClock.updateClock(ClusterTime(2));
 
     // With a NOT_READY tablet, nothing should be cleaned.
     tabletManager.addTablet(0, 10, 20, TabletManager::NOT_READY);
     results.cleanByTimeout();
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.getClientCount());
 
     // After deleting NOT_READY tablet, everything should be cleaned.
     tabletManager.deleteTablet(0, 10, 20);
     results.cleanByTimeout();
-    EXPECT_EQ(0U, results.clients.size());
+    EXPECT_EQ(0U, results.getClientCount());
+}
+
+TEST_F(UnackedRpcResultsTest, cleanByTimeout_resumesAtNextShard) {
+    void* result;
+    ClientLease clientLease = {2, 1, 0};
+    results.checkDuplicate(clientLease, 10, 5, &result);
+    results.recordCompletion(2, 10, &result);
+    EXPECT_EQ(2U, results.getClientCount());
+    EXPECT_NE(&results.getShard(1), &results.getShard(2));
+
+    service->clusterClock.updateClock(ClusterTime(2));
+
+    // Client 1 is in an earlier shard than where this pass starts, so only
+    // client 2 is cleaned; the next pass starts over at the first shard.
+    results.cleaner.nextShardToCheck = 2;
+    results.cleanByTimeout();
+    EXPECT_EQ(1U, results.getClientCount());
+    EXPECT_TRUE(getClient(1) != NULL);
+    EXPECT_EQ(0U, results.cleaner.nextShardToCheck);
+    EXPECT_EQ(0U, results.cleaner.nextClientToCheck);
+
+    results.cleanByTimeout();
+    EXPECT_EQ(0U, results.getClientCount());
 }
 
 TEST_F(UnackedRpcResultsTest, hasRecord) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = getClient(1);
     EXPECT_TRUE(client->hasRecord(10));
 }
 
 TEST_F(UnackedRpcResultsTest, result) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = getClient(1);
     EXPECT_EQ(1010UL, (uint64_t)client->result(10));
 }
 
 TEST_F(UnackedRpcResultsTest, recordNewRpc) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = getClient(1);
     client->recordNewRpc(11);
     EXPECT_TRUE(client->hasRecord(11));
 
@@ -492,7 +523,7 @@ TEST_F(UnackedRpcResultsTest, recordNewRpc) {
 }
 
 TEST_F(UnackedRpcResultsTest, recordNewRpc_jumResizeTest) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = getClient(1);
     uint64_t rpcId1 = 11;
     client->recordNewRpc(rpcId1);
     EXPECT_TRUE(client->hasRecord(rpcId1));
@@ -532,7 +563,7 @@ TEST_F(UnackedRpcResultsTest, resetRecord) {
 }
 
 TEST_F(UnackedRpcResultsTest, updateResult) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = getClient(1);
     EXPECT_EQ(1010UL, (uint64_t)client->result(10));
     client->updateResult(10, reinterpret_cast<void*>(1099));
     EXPECT_EQ(1099UL, (uint64_t)client->result(10));
@@ -544,19 +575,19 @@ TEST_F(UnackedRpcResultsTest, updateResult) {
 }
 
 TEST_F(UnackedRpcResultsTest, getClientRecord) {
-    UnackedRpcResults::Lock lock(results.mutex);
+    UnackedRpcResults::Lock lock(results.getShard(42).mutex);
 
     EXPECT_TRUE(results.getClientRecord(42, lock) == NULL);
 
     UnackedRpcResults::Client* client =
             new UnackedRpcResults::Client(results.default_rpclist_size);
-    results.clients[42] = client;
+    results.getShard(42).clients[42] = client;
 
     EXPECT_TRUE(results.getClientRecord(42, lock) == client);
 }
 
 TEST_F(UnackedRpcResultsTest, getOrInitClientRecord) {
-    UnackedRpcResults::Lock lock(results.mutex);
+    UnackedRpcResults::Lock lock(results.getShard(42).mutex);
 
     EXPECT_TRUE(results.getClientRecord(42, lock) == NULL);
 
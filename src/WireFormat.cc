@@ -122,6 +122,9 @@ opcodeSymbol(uint32_t opcode)
         case TX_REQUEST_ABORT:             return "TX_REQUEST_ABORT";
         case TX_HINT_FAILED:               return "TX_HINT_FAILED";
         case ECHO:                         return "ECHO";
+        case INSERT_INDEX_ENTRIES:         return "INSERT_INDEX_ENTRIES";
+        case BUILD_INDEX:                  return "BUILD_INDEX";
+        case RELAY_SERVER_LIST:            return "RELAY_SERVER_LIST";
         case ILLEGAL_RPC_TYPE:             return "ILLEGAL_RPC_TYPE";
     }
 
@@ -130,7 +130,10 @@ enum Opcode {
     TX_REQUEST_ABORT            = 78,
     TX_HINT_FAILED              = 79,
     ECHO                        = 80,
-    ILLEGAL_RPC_TYPE            = 81, // 1 + the highest legitimate Opcode
+    INSERT_INDEX_ENTRIES        = 81,
+    BUILD_INDEX                 = 82,
+    RELAY_SERVER_LIST           = 83,
+    ILLEGAL_RPC_TYPE            = 84, // 1 + the highest legitimate Opcode
 };
 
 /**
@@ -152,6 +155,7 @@ enum ControlOp {
     LOG_MESSAGE                 = 1010,
     RESET_METRICS               = 1011,
     QUIESCE                     = 1012,
+    SET_GROUP_COMMIT_WINDOW     = 1013,
 };
 
 /**
@@ -447,6 +451,43 @@ struct BackupWrite {
     } __attribute__((packed));
 };
 
+/**
+ * Used by a client to ask a master to create index entries for the existing
+ * objects in one of its tablets. The master sends the entries to the index
+ * servers in bulk (see InsertIndexEntries). A large tablet takes several
+ * RPCs, each of which scans part of the master's hash table.
+ */
+struct BuildIndex {
+    static const Opcode opcode = BUILD_INDEX;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;           // Id of the table whose objects should
+                                    // be indexed.
+        uint8_t indexId;            // Id of the index to build.
+        uint64_t keyHash;           // Any key hash in the tablet to index.
+        uint64_t nextBucket;        // Hash table bucket at which to resume
+                                    // indexing the tablet; from the
+                                    // previous response, or 0.
+        uint64_t numBuckets;        // Size of the hash table to which
+                                    // nextBucket refers; from the previous
+                                    // response, or 0 to start the tablet.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t numObjects;        // Number of objects found by this RPC
+                                    // that had a key for the index.
+        uint64_t nextKeyHash;       // keyHash for the next RPC: a key hash
+                                    // in the same tablet if numBuckets is
+                                    // nonzero, else the first key hash
+                                    // after the tablet (0 if the tablet
+                                    // ended the table).
+        uint64_t nextBucket;        // nextBucket for the next RPC.
+        uint64_t numBuckets;        // numBuckets for the next RPC; 0 means
+                                    // the tablet has been indexed.
+    } __attribute__((packed));
+};
+
 struct CoordSplitAndMigrateIndexlet {
     static const Opcode opcode = COORD_SPLIT_AND_MIGRATE_INDEXLET;
     static const ServiceType service = COORDINATOR_SERVICE;
@@ -945,6 +986,38 @@ struct InsertIndexEntry {
     } __attribute__((packed));
 };
 
+/**
+ * Used by a master to ask an index server to insert many index entries at
+ * once, as when building an index over existing objects.
+ */
+struct InsertIndexEntries {
+    static const Opcode opcode = INSERT_INDEX_ENTRIES;
+    static const ServiceType service = MASTER_SERVICE;
+
+    /// Precedes each entry's index key in the request.
+    struct Entry {
+        uint64_t primaryKeyHash;    // Hash of the primary key of the object
+                                    // the entry points to.
+        uint16_t indexKeyLength;    // Length of the index key in bytes.
+    } __attribute__((packed));
+
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;           // Id of the table containing the objects
+                                    // the entries point to.
+        uint8_t indexId;            // Id of the index for the entries.
+        uint32_t numEntries;        // Number of entries that follow.
+        // In buffer: numEntries Entry headers, each followed by the bytes
+        // of its index key. Entries are sorted by index key.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t numInserted;       // Number of entries, from the start of
+                                    // the request, that were inserted. The
+                                    // rest belong to other indexlets.
+    } __attribute__((packed));
+};
+
 /**
  * Used by backups to determine if a particular replica is still needed
  * by a master.  This is only used in the case the backup has crashed, and
@@ -1402,6 +1475,43 @@ struct RecoveryMasterFinished {
     } __attribute__((packed));
 };
 
+/**
+ * Used by the coordinator to send server list updates to one server along
+ * with a list of other servers that need the same updates; the recipient
+ * applies the updates and forwards them to each of those servers with an
+ * UPDATE_SERVER_LIST RPC.
+ */
+struct RelayServerList {
+    static const Opcode opcode = RELAY_SERVER_LIST;
+    static const ServiceType service = ADMIN_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint32_t relayCount;          // Number of servers to which the
+                                      // recipient must forward the updates.
+                                      // Their ServerIds (8 bytes each) form
+                                      // the last part of the request.
+
+        // Immediately following this header are one or more
+        // UpdateServerList::Request::Part objects, each followed by a
+        // serialized ProtoBuf::ServerList, just as in UpdateServerList.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t currentVersion;      // The server list version number of the
+                                      // RPC recipient, after processing this
+                                      // request.
+        // Immediately following this header is one RelayResult for each
+        // of the request's relayCount servers, in the same order.
+    } __attribute__((packed));
+    struct RelayResult {
+        uint64_t serverId;            // One of the servers the request
+                                      // asked to forward the updates to.
+        uint64_t currentVersion;      // That server's server list version
+                                      // after processing the updates; 0
+                                      // means they couldn't be delivered.
+    } __attribute__((packed));
+};
+
 struct Remove {
     static const Opcode opcode = REMOVE;
     static const ServiceType service = MASTER_SERVICE;
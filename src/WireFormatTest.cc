@@ -59,7 +59,7 @@ TEST_F(WireFormatTest, opcodeSymbol_integer) {
             WireFormat::ILLEGAL_RPC_TYPE));
 
     // Test out-of-range values.
-    EXPECT_STREQ("unknown(82)", WireFormat::opcodeSymbol(
+    EXPECT_STREQ("unknown(85)", WireFormat::opcodeSymbol(
             WireFormat::ILLEGAL_RPC_TYPE+1));
 
     // Make sure the next-to-last value is defined (this will fail if
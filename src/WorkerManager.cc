@@ -19,6 +19,7 @@
 #include "CycleCounter.h"
 #include "Fence.h"
 #include "Initialize.h"
+#include "Log.h"
 #include "LogProtector.h"
 #include "PerfStats.h"
 #include "RawMetrics.h"
@@ -72,6 +73,7 @@ Syscall* WorkerManager::sys = &defaultSyscall;
 // time it takes to wake up the thread once it has gone to sleep (as of
 // September 2011 this time appears to be as much as 50 microseconds).
 int WorkerManager::pollMicros = 10000;
+__thread bool WorkerManager::runningInline = false;
 // The following constant is used to signal a worker thread that
 // it should exit.
 #define WORKER_EXIT reinterpret_cast<Transport::ServerRpc*>(1)
@@ -86,8 +88,18 @@ int WorkerManager::pollMicros = 10000;
  *      threads doesn't exceed this value. However, in order to prevent
  *      deadlocks, it may occasionally be necessary to go beyond this
  *      limit.
+ * \param numStealingCores
+ *      If nonzero, this many additional threads are created to execute
+ *      stealable RPCs (see isStealable()) directly from per-thread queues,
+ *      balancing load by stealing from one another, instead of handing
+ *      each such RPC to a worker thread. 0 means all RPCs go through the
+ *      worker threads.
+ * \param inlineRpcs
+ *      True means that inline-safe RPCs (see isInlineSafe()) are executed
+ *      directly in the dispatch thread when it isn't backlogged.
  */
-WorkerManager::WorkerManager(Context* context, uint32_t maxCores)
+WorkerManager::WorkerManager(Context* context, uint32_t maxCores,
+                             uint32_t numStealingCores, bool inlineRpcs)
     : Dispatch::Poller(context->dispatch, "WorkerManager")
     , context(context)
     , levels()
@@ -95,6 +107,15 @@ WorkerManager::WorkerManager(Context* context, uint32_t maxCores)
     , idleThreads()
     , maxCores(maxCores)
     , rpcsWaiting(0)
+    , stealingCores()
+    , nextStealingCore(0)
+    , stealingRpcsOutstanding(0)
+    , completedRpcs()
+    , completedLock("WorkerManager::completedLock")
+    , stealingExit(0)
+    , inlineRpcs(inlineRpcs)
+    , lastInlineTime(0)
+    , inlineWorker(new Worker(context))
     , testingSaveRpcs(0)
     , testRpcs()
 {
@@ -115,6 +136,14 @@ WorkerManager::WorkerManager(Context* context, uint32_t maxCores)
         worker->thread.construct(workerMain, worker);
         idleThreads.push_back(worker);
     }
+
+    for (uint32_t i = 0; i < numStealingCores; i++) {
+        StealingCore* core = new StealingCore();
+        core->worker = new Worker(context);
+        stealingCores.push_back(core);
+    }
+    for (uint32_t i = 0; i < numStealingCores; i++)
+        stealingCores[i]->thread.construct(stealingCoreMain, this, i);
 }
 
 /**
@@ -125,13 +154,25 @@ WorkerManager::~WorkerManager()
 {
     Dispatch* dispatch = context->dispatch;
     assert(dispatch->isDispatchThread());
-    while (!busyThreads.empty()) {
+    while (!busyThreads.empty() || stealingRpcsOutstanding > 0) {
         dispatch->poll();
     }
     foreach (Worker* worker, idleThreads) {
         worker->exit();
         delete worker;
     }
+    stealingExit.store(1);
+    foreach (StealingCore* core, stealingCores) {
+        if (core->sleeping.exchange(0) != 0)
+            sys->futexWake(reinterpret_cast<int*>(&core->sleeping), 1);
+        if (core->thread)
+            core->thread->join();
+    }
+    foreach (StealingCore* core, stealingCores) {
+        delete core->worker;
+        delete core;
+    }
+    delete inlineWorker;
 }
 
 /**
@@ -172,6 +213,47 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
         rpc->sendReply();
         return;
     }
+
+    // Short requests may be executed right here, if the dispatch thread
+    // has nothing else waiting. If the RPC turns out to need replication,
+    // it goes to a worker after all.
+    if (inlineRpcs && isInlineSafe(header, &rpc->requestPayload)) {
+        if ((rpcsWaiting == 0) &&
+                (context->dispatch->currentTime != lastInlineTime)) {
+            lastInlineTime = context->dispatch->currentTime;
+            if (executeInline(rpc, WireFormat::Opcode(header->opcode))) {
+                PerfStats::threadStats.inlineRpcs++;
+                rpc->sendReply();
+                return;
+            }
+        }
+        PerfStats::threadStats.handedOffRpcs++;
+    }
+
+    // Stealable RPCs bypass the worker threads (and the per-level limits
+    // below) entirely: queue the request for the next stealing thread.
+    if (!stealingCores.empty() &&
+            isStealable(WireFormat::Opcode(header->opcode))) {
+        StealingCore* core = stealingCores[nextStealingCore];
+        nextStealingCore = (nextStealingCore + 1) %
+                downCast<uint32_t>(stealingCores.size());
+        {
+            SpinLock::Guard _(core->lock);
+            core->queue.push_back(rpc);
+            core->queueLength++;
+        }
+        stealingRpcsOutstanding++;
+        if (core->sleeping.exchange(0) != 0) {
+            if (sys->futexWake(reinterpret_cast<int*>(&core->sleeping), 1)
+                    == -1) {
+                LOG(ERROR, "futexWake failed in WorkerManager::handleRpc: %s",
+                        strerror(errno));
+            }
+        }
+        timeTrace("RPC queued for stealing thread");
+        return;
+    }
+
     int level = RpcLevel::getLevel(WireFormat::Opcode(header->opcode));
     timeTrace("handleRpc processing opcode %d", header->opcode);
 #ifdef LOG_RPCS
@@ -202,18 +284,6 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
         }
     }
 
-    // Temporary code to test how much faster things would be without threads.
-#if 0
-    if (((header->opcode == WireFormat::ECHO) ||
-            (header->opcode == WireFormat::READ)) &&
-            (header->service == WireFormat::MASTER_SERVICE)) {
-        Service::Rpc serviceRpc(NULL, &rpc->requestPayload, &rpc->replyPayload);
-        Service::handleRpc(context, &serviceRpc);
-        rpc->sendReply();
-        return;
-    }
-#endif
-
     levels[level].requestsRunning++;
 
     // Hand off the RPC to a worker thread.
@@ -236,7 +306,126 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
 bool
 WorkerManager::idle()
 {
-    return busyThreads.empty();
+    return busyThreads.empty() && (stealingRpcsOutstanding == 0);
+}
+
+/**
+ * Execute an RPC in the dispatch thread (see #inlineRpcs). On return, the
+ * reply is ready to send, unless the RPC had to be abandoned.
+ *
+ * \param rpc
+ *      RPC to execute; its request has an inline-safe opcode.
+ * \param opcode
+ *      The RPC's opcode.
+ * \return
+ *      True if the RPC completed. False means that it needed to wait for
+ *      log replication, which can't be done in the dispatch thread; its
+ *      partial reply and read statistics have been discarded and it must
+ *      be handed to a worker.
+ */
+bool
+WorkerManager::executeInline(Transport::ServerRpc* rpc,
+                             WireFormat::Opcode opcode)
+{
+    // Like an RPC on a worker, an inline RPC may hold references into the
+    // log, which must not be freed under it.
+    rpc->epoch = LogProtector::getCurrentEpoch();
+    inlineWorker->opcode = opcode;
+    inlineWorker->rpc = rpc;
+    inlineWorker->state.store(Worker::WORKING);
+
+    // A worker will count the reads again if the RPC has to be handed off.
+    uint64_t readCount = PerfStats::threadStats.readCount;
+    uint64_t readObjectBytes = PerfStats::threadStats.readObjectBytes;
+    uint64_t readKeyBytes = PerfStats::threadStats.readKeyBytes;
+
+    bool completed = true;
+    runningInline = true;
+    try {
+        Service::Rpc serviceRpc(inlineWorker, &rpc->requestPayload,
+                &rpc->replyPayload);
+        Service::handleRpc(context, &serviceRpc);
+    } catch (LogSyncDisallowedException& e) {
+        rpc->replyPayload.reset();
+        completed = false;
+    }
+    runningInline = false;
+
+    if (!completed) {
+        (&metrics->rpc.rpc0Count)[opcode]--;
+        PerfStats::threadStats.readCount = readCount;
+        PerfStats::threadStats.readObjectBytes = readObjectBytes;
+        PerfStats::threadStats.readKeyBytes = readKeyBytes;
+        context->services[WireFormat::MASTER_SERVICE]->abandonInlineRpc();
+    }
+
+    // The dispatch thread isn't serving an RPC once we return.
+    RpcLevel::setCurrentOpcode(RpcLevel::NO_RPC);
+    inlineWorker->rpc = NULL;
+    inlineWorker->state.store(Worker::POLLING);
+    return completed;
+}
+
+/**
+ * Returns true if an RPC is short enough, and safe, to execute directly in
+ * the dispatch thread: single-object reads, key hash reads, and MULTI_OP
+ * reads of at most MAX_INLINE_MULTI_READ objects. None of these invoke
+ * other RPCs, so running them inline can't affect RpcLevel deadlock
+ * avoidance. (A read that must wait for replication is handed to a worker
+ * after all; see executeInline().)
+ *
+ * \param header
+ *      Header of an incoming request.
+ * \param request
+ *      The complete request.
+ */
+bool
+WorkerManager::isInlineSafe(const WireFormat::RequestCommon* header,
+                            Buffer* request)
+{
+    if (header->service != WireFormat::MASTER_SERVICE)
+        return false;
+    switch (header->opcode) {
+        case WireFormat::READ:
+        case WireFormat::READ_KEYS_AND_VALUE:
+        case WireFormat::READ_HASHES:
+            return true;
+        case WireFormat::MULTI_OP: {
+            const WireFormat::MultiOp::Request* reqHdr =
+                    request->getStart<WireFormat::MultiOp::Request>();
+            return (reqHdr != NULL) &&
+                    (reqHdr->type == WireFormat::MultiOp::READ) &&
+                    (reqHdr->count <= MAX_INLINE_MULTI_READ);
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * Returns true if RPCs with the given opcode may be executed by stealing
+ * threads (see the constructor). These are the short, client-issued object
+ * operations. No RPC handler invokes any of them, so a stealing thread can
+ * only ever wait for RPCs that are executed by worker threads, which keep
+ * their per-level reservations; this preserves the deadlock avoidance
+ * provided by RpcLevel.
+ *
+ * \param opcode
+ *      Opcode of an incoming RPC.
+ */
+bool
+WorkerManager::isStealable(WireFormat::Opcode opcode)
+{
+    switch (opcode) {
+        case WireFormat::READ:
+        case WireFormat::READ_KEYS_AND_VALUE:
+        case WireFormat::WRITE:
+        case WireFormat::REMOVE:
+        case WireFormat::INCREMENT:
+            return true;
+        default:
+            return false;
+    }
 }
 
 /**
@@ -248,6 +437,20 @@ WorkerManager::poll()
 {
     int foundWork = 0;
 
+    // Send replies for RPCs completed by stealing threads.
+    if (stealingRpcsOutstanding > 0) {
+        std::vector<Transport::ServerRpc*> completed;
+        {
+            SpinLock::Guard _(completedLock);
+            completed.swap(completedRpcs);
+        }
+        foreach (Transport::ServerRpc* rpc, completed) {
+            rpc->sendReply();
+            stealingRpcsOutstanding--;
+            foundWork = 1;
+        }
+    }
+
     // Each iteration of the following loop checks the status of one active
     // worker. The order of iteration is crucial, since it allows us to
     // remove a worker from busyThreads in the middle of the loop without
@@ -457,6 +660,114 @@ WorkerManager::workerMain(Worker* worker)
     }
 }
 
+/**
+ * Return the next RPC that a stealing thread should execute: the oldest
+ * request in its own queue or, if that is empty, the oldest request in the
+ * first nonempty queue of the other stealing threads (starting with its
+ * neighbour).
+ *
+ * \param index
+ *      Index in #stealingCores of the calling thread.
+ * \return
+ *      The RPC, or NULL if all of the queues are empty.
+ */
+Transport::ServerRpc*
+WorkerManager::nextStealableRpc(uint32_t index)
+{
+    uint32_t numCores = downCast<uint32_t>(stealingCores.size());
+    for (uint32_t i = 0; i < numCores; i++) {
+        StealingCore* core = stealingCores[(index + i) % numCores];
+        if (core->queueLength.load() == 0)
+            continue;
+        SpinLock::Guard _(core->lock);
+        if (core->queue.empty())
+            continue;
+        Transport::ServerRpc* rpc = core->queue.front();
+        core->queue.pop_front();
+        core->queueLength--;
+        if (i != 0)
+            PerfStats::threadStats.stolenRpcs++;
+        return rpc;
+    }
+    return NULL;
+}
+
+/**
+ * This is the top-level method for stealing threads. It repeatedly takes
+ * an RPC from its own queue (or steals one from another thread's queue),
+ * executes it, and passes it back to the dispatch thread to send the
+ * reply. If no work arrives for a while it goes to sleep until the
+ * dispatch thread queues a new request for it.
+ *
+ * \param manager
+ *      The WorkerManager that owns the thread.
+ * \param index
+ *      Index of the thread's StealingCore in manager->stealingCores.
+ */
+void
+WorkerManager::stealingCoreMain(WorkerManager* manager, uint32_t index)
+{
+    StealingCore* core = manager->stealingCores[index];
+    Worker* worker = core->worker;
+    worker->threadId = ThreadId::get();
+    PerfStats::registerStats(&PerfStats::threadStats);
+    uint64_t pollCycles = Cycles::fromNanoseconds(1000*pollMicros);
+
+    // Cycles::rdtsc time when this thread last finished an RPC (or woke
+    // up); it goes to sleep once it has been idle for pollMicros.
+    uint64_t lastWork = Cycles::rdtsc();
+
+    while (manager->stealingExit.load() == 0) {
+        Transport::ServerRpc* rpc = manager->nextStealableRpc(index);
+        if (rpc == NULL) {
+            if (Cycles::rdtsc() < lastWork + pollCycles)
+                continue;
+
+            // Go to sleep. Set the flag before checking the queues a last
+            // time, so the dispatch thread can't queue a request between
+            // the check and the wait without seeing the flag.
+            core->sleeping.exchange(1);
+            rpc = manager->nextStealableRpc(index);
+            if (rpc == NULL && manager->stealingExit.load() == 0) {
+                if (sys->futexWait(reinterpret_cast<int*>(&core->sleeping), 1)
+                        == -1 && errno != EWOULDBLOCK && errno != EINTR) {
+                    LOG(ERROR, "futexWait failed in "
+                            "WorkerManager::stealingCoreMain: %s",
+                            strerror(errno));
+                }
+            }
+            core->sleeping.store(0);
+            lastWork = Cycles::rdtsc();
+            if (rpc == NULL)
+                continue;
+        }
+
+        uint64_t start = Cycles::rdtsc();
+        const WireFormat::RequestCommon* header =
+                rpc->requestPayload.getStart<WireFormat::RequestCommon>();
+        worker->opcode = WireFormat::Opcode(header->opcode);
+        worker->rpc = rpc;
+        worker->state.store(Worker::WORKING);
+        rpc->epoch = LogProtector::getCurrentEpoch();
+        Service::Rpc serviceRpc(worker, &rpc->requestPayload,
+                &rpc->replyPayload);
+        Service::handleRpc(worker->context, &serviceRpc);
+
+        // If the handler called sendReply early, the reply still waits
+        // until the handler returns; the dispatch thread sends it.
+        worker->rpc = NULL;
+        worker->state.store(Worker::POLLING);
+        Fence::leave();
+        {
+            SpinLock::Guard _(manager->completedLock);
+            manager->completedRpcs.push_back(rpc);
+        }
+
+        lastWork = Cycles::rdtsc();
+        PerfStats::threadStats.workerActiveCycles += (lastWork - start);
+    }
+}
+
 /**
  * Force this worker's thread to exit (and don't return until it has exited).
  * This method is only used during testing and WorkerManager destruction.
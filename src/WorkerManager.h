@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_WORKERMANAGER_H
 #define RAMCLOUD_WORKERMANAGER_H
 
+#include <deque>
 #include <queue>
 
 #include "Dispatch.h"
@@ -25,6 +26,7 @@
 #include "ThreadId.h"
 #include "TimeTrace.h"
 #include "PerfStats.h"
+#include "SpinLock.h"
 
 namespace RAMCloud {
 
@@ -36,17 +38,29 @@ namespace RAMCloud {
  */
 class WorkerManager : Dispatch::Poller {
   public:
-    explicit WorkerManager(Context* context, uint32_t maxCores = 3);
+    explicit WorkerManager(Context* context, uint32_t maxCores = 3,
+                           uint32_t numStealingCores = 0,
+                           bool inlineRpcs = false);
     ~WorkerManager();
 
     void exitWorker();
     void handleRpc(Transport::ServerRpc* rpc);
     bool idle();
     static void init();
+    static bool isInlineSafe(const WireFormat::RequestCommon* header,
+                             Buffer* request);
+    static bool isStealable(WireFormat::Opcode opcode);
     int poll();
     void setServerId(ServerId serverId);
     Transport::ServerRpc* waitForRpc(double timeoutSeconds);
 
+    /// True while the current thread is executing an RPC inline in the
+    /// dispatch thread (see executeInline()). Replication is driven by the
+    /// dispatch thread, so such an RPC can't wait for it: Log::syncTo()
+    /// throws LogSyncDisallowedException instead if any replication is
+    /// actually needed, and the RPC is handed to a worker.
+    static __thread bool runningInline;
+
   PROTECTED:
   static inline void timeTrace(const char* format,
         uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0,
@@ -97,6 +111,97 @@ class WorkerManager : Dispatch::Poller {
     // Total number of RPCs (across all Levels) in waitingRpcs queues.
     int rpcsWaiting;
 
+    /**
+     * Describes one of the threads that run stealable RPCs (see
+     * isStealable()) when the WorkerManager is constructed with
+     * numStealingCores > 0. Each thread has its own queue of incoming
+     * RPCs, which the dispatch thread fills in round-robin order; a thread
+     * whose queue is empty takes work from the other threads' queues
+     * before it goes idle. The dispatch thread still receives every
+     * request and sends every reply; only execution is spread out.
+     */
+    class StealingCore {
+      public:
+        StealingCore()
+            : worker(NULL)
+            , thread()
+            , lock("WorkerManager::StealingCore::lock")
+            , queue()
+            , queueLength(0)
+            , sleeping(0)
+        {}
+
+        /// Passed to Service::handleRpc as the worker executing each RPC
+        /// (owned by the WorkerManager); its own thread is not used.
+        Worker* worker;
+
+        /// Thread that executes RPCs for this core; see
+        /// stealingCoreMain().
+        Tub<std::thread> thread;
+
+        /// Protects #queue, which may be accessed by the dispatch thread
+        /// and by any of the stealing threads.
+        SpinLock lock;
+
+        /// Requests waiting to be serviced, oldest first.
+        std::deque<Transport::ServerRpc*> queue;
+
+        /// Number of entries in #queue; lets idle threads check for work
+        /// without acquiring #lock.
+        Atomic<int> queueLength;
+
+        /// Nonzero means the thread has gone to sleep (or is about to)
+        /// waiting for new work, so the dispatch thread must wake it with
+        /// futexWake after queueing a request.
+        Atomic<int> sleeping;
+
+        DISALLOW_COPY_AND_ASSIGN(StealingCore);
+    };
+
+    // One entry for each stealing thread; empty means stealable RPCs are
+    // handed to worker threads like any other RPC.
+    std::vector<StealingCore*> stealingCores;
+
+    // Index in #stealingCores of the queue that receives the next
+    // stealable RPC.
+    uint32_t nextStealingCore;
+
+    // Stealable RPCs given to #stealingCores whose replies haven't been
+    // sent yet. Accessed only by the dispatch thread.
+    int stealingRpcsOutstanding;
+
+    // RPCs finished by stealing threads; the dispatch thread sends their
+    // replies in poll(). Protected by #completedLock.
+    std::vector<Transport::ServerRpc*> completedRpcs;
+    SpinLock completedLock;
+
+    // Set to nonzero to tell stealing threads to exit.
+    Atomic<int> stealingExit;
+
+    Transport::ServerRpc* nextStealableRpc(uint32_t index);
+    static void stealingCoreMain(WorkerManager* manager, uint32_t index);
+
+    // True means inline-safe RPCs (see isInlineSafe()) are executed
+    // directly in the dispatch thread, rather than handed to a worker,
+    // whenever the dispatch thread isn't backlogged.
+    bool inlineRpcs;
+
+    // Value of Dispatch::currentTime when an RPC was last executed inline.
+    // At most one RPC is executed inline per pass through the dispatch
+    // loop: if a second one arrives in the same pass, requests are
+    // arriving faster than the dispatch thread alone can serve them, so it
+    // goes to a worker.
+    uint64_t lastInlineTime;
+
+    // Passed to Service::handleRpc as the worker for RPCs executed inline;
+    // its thread is not used.
+    Worker* inlineWorker;
+
+    /// Largest number of objects in a MULTI_OP read that is executed inline.
+    static const uint32_t MAX_INLINE_MULTI_READ = 4;
+
+    bool executeInline(Transport::ServerRpc* rpc, WireFormat::Opcode opcode);
+
     // Nonzero means save incoming RPCs rather than executing them.
     // Intended for use in unit tests only.
     int testingSaveRpcs;
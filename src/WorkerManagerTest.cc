@@ -15,6 +15,7 @@
 
 #include "TestUtil.h"
 #include "Common.h"
+#include "Log.h"
 #include "MockService.h"
 #include "MockSyscall.h"
 #include "MockTransport.h"
@@ -200,6 +201,179 @@ TEST_F(WorkerManagerTest, handleRpc_handoffToWorker) {
     EXPECT_EQ(5U, manager->idleThreads.size());
 }
 
+TEST_F(WorkerManagerTest, handleRpc_stealingCores) {
+    manager.destroy();
+    manager.construct(&context, 2, 2);
+    EXPECT_EQ(2U, manager->stealingCores.size());
+
+    // READ (opcode 13) goes to a stealing thread.
+    MockTransport::MockServerRpc* rpc = new MockTransport::MockServerRpc(
+            &transport, "0x1000d 3 4");
+    manager->handleRpc(rpc);
+    EXPECT_EQ(1U, manager->nextStealingCore);
+    EXPECT_FALSE(manager->idle());
+    for (int i = 0; i < 1000; i++) {
+        context.dispatch->poll();
+        if (!transport.outputLog.empty())
+            break;
+        usleep(1000);
+    }
+    EXPECT_EQ("rpc: 0x1000d 3 4", service.log);
+    EXPECT_EQ("serverReply: 0x1000e 4 5", transport.outputLog);
+    EXPECT_TRUE(manager->idle());
+    EXPECT_EQ(4U, manager->idleThreads.size());
+}
+
+TEST_F(WorkerManagerTest, handleRpc_inline) {
+    manager.destroy();
+    manager.construct(&context, 2, 0, true);
+    context.services[WireFormat::MASTER_SERVICE] = &service;
+    context.dispatch->currentTime = 100;
+    uint8_t levels[WireFormat::ILLEGAL_RPC_TYPE] = {0};
+    RpcLevel::levelsPtr = levels;
+    uint64_t inlined = PerfStats::threadStats.inlineRpcs;
+    uint64_t handedOff = PerfStats::threadStats.handedOffRpcs;
+
+    // READ (opcode 13) on the master service runs right here.
+    MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
+            &transport, "0xd 3 4");
+    manager->handleRpc(rpc1);
+    EXPECT_EQ("rpc: 13 3 4", service.log);
+    EXPECT_EQ("serverReply: 14 4 5", transport.outputLog);
+    EXPECT_EQ(inlined + 1, PerfStats::threadStats.inlineRpcs);
+    EXPECT_EQ(0U, manager->busyThreads.size());
+    EXPECT_TRUE(manager->inlineWorker->rpc == NULL);
+
+    // A second one in the same dispatch pass goes to a worker.
+    MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
+            &transport, "0xd 5 6");
+    manager->handleRpc(rpc2);
+    EXPECT_EQ(1U, manager->busyThreads.size());
+    EXPECT_EQ(inlined + 1, PerfStats::threadStats.inlineRpcs);
+    EXPECT_EQ(handedOff + 1, PerfStats::threadStats.handedOffRpcs);
+    waitUntilDone(1);
+    manager->poll();
+
+    // RPCs that can't run inline aren't counted as handed off.
+    MockTransport::MockServerRpc* rpc3 = new MockTransport::MockServerRpc(
+            &transport, "0xe 5 6");
+    manager->handleRpc(rpc3);
+    EXPECT_EQ(handedOff + 1, PerfStats::threadStats.handedOffRpcs);
+    waitUntilDone(1);
+    manager->poll();
+    context.services[WireFormat::MASTER_SERVICE] = NULL;
+}
+
+// Service that needs a log sync, as a read of unreplicated data would.
+class SyncingService : public MockService {
+  public:
+    SyncingService()
+        : MockService(), inlineAttempts(0), inlineEpoch(0), abandoned(0) {}
+    virtual void dispatch(WireFormat::Opcode opcode, Rpc* rpc)
+    {
+        if (WorkerManager::runningInline) {
+            inlineAttempts++;
+            inlineEpoch = rpc->worker->rpc->epoch;
+            PerfStats::threadStats.readCount++;
+            rpc->replyPayload->emplaceAppend<int32_t>(99);
+            throw LogSyncDisallowedException(HERE);
+        }
+        MockService::dispatch(opcode, rpc);
+    }
+    virtual void abandonInlineRpc()
+    {
+        abandoned++;
+    }
+    int inlineAttempts;
+    uint64_t inlineEpoch;
+    int abandoned;
+    DISALLOW_COPY_AND_ASSIGN(SyncingService);
+};
+
+TEST_F(WorkerManagerTest, handleRpc_inlineFallback) {
+    SyncingService syncingService;
+    manager.destroy();
+    manager.construct(&context, 2, 0, true);
+    context.services[WireFormat::MASTER_SERVICE] = &syncingService;
+    context.dispatch->currentTime = 100;
+    uint8_t levels[WireFormat::ILLEGAL_RPC_TYPE] = {0};
+    RpcLevel::levelsPtr = levels;
+    uint64_t inlined = PerfStats::threadStats.inlineRpcs;
+    uint64_t readCount = PerfStats::threadStats.readCount;
+
+    MockTransport::MockServerRpc* rpc = new MockTransport::MockServerRpc(
+            &transport, "0xd 3 4");
+    manager->handleRpc(rpc);
+    EXPECT_EQ(1, syncingService.inlineAttempts);
+    EXPECT_NE(0U, syncingService.inlineEpoch);
+    EXPECT_EQ(1, syncingService.abandoned);
+    EXPECT_EQ(readCount, PerfStats::threadStats.readCount);
+    EXPECT_EQ(inlined, PerfStats::threadStats.inlineRpcs);
+    EXPECT_FALSE(WorkerManager::runningInline);
+    EXPECT_EQ(1U, manager->busyThreads.size());
+    waitUntilDone(1);
+    manager->poll();
+    EXPECT_EQ("rpc: 13 3 4", syncingService.log);
+    EXPECT_EQ("serverReply: 14 4 5", transport.outputLog);
+    manager.destroy();
+    context.services[WireFormat::MASTER_SERVICE] = NULL;
+}
+
+TEST_F(WorkerManagerTest, isInlineSafe) {
+    Buffer request;
+    WireFormat::MultiOp::Request* multi =
+            request.emplaceAppend<WireFormat::MultiOp::Request>();
+    multi->common.opcode = WireFormat::MULTI_OP;
+    multi->common.service = WireFormat::MASTER_SERVICE;
+    multi->type = WireFormat::MultiOp::READ;
+    multi->count = WorkerManager::MAX_INLINE_MULTI_READ;
+    EXPECT_TRUE(WorkerManager::isInlineSafe(&multi->common, &request));
+    multi->count++;
+    EXPECT_FALSE(WorkerManager::isInlineSafe(&multi->common, &request));
+    multi->count = 1;
+    multi->type = WireFormat::MultiOp::WRITE;
+    EXPECT_FALSE(WorkerManager::isInlineSafe(&multi->common, &request));
+
+    multi->common.opcode = WireFormat::READ;
+    EXPECT_TRUE(WorkerManager::isInlineSafe(&multi->common, &request));
+    multi->common.opcode = WireFormat::WRITE;
+    EXPECT_FALSE(WorkerManager::isInlineSafe(&multi->common, &request));
+    multi->common.opcode = WireFormat::READ;
+    multi->common.service = WireFormat::BACKUP_SERVICE;
+    EXPECT_FALSE(WorkerManager::isInlineSafe(&multi->common, &request));
+}
+
+TEST_F(WorkerManagerTest, isStealable) {
+    EXPECT_TRUE(WorkerManager::isStealable(WireFormat::READ));
+    EXPECT_TRUE(WorkerManager::isStealable(WireFormat::WRITE));
+    EXPECT_FALSE(WorkerManager::isStealable(WireFormat::BACKUP_WRITE));
+    EXPECT_FALSE(WorkerManager::isStealable(WireFormat::MULTI_OP));
+}
+
+TEST_F(WorkerManagerTest, nextStealableRpc) {
+    // Stealing cores without threads, so the queues can be examined.
+    WorkerManager::StealingCore core0, core1;
+    manager->stealingCores.push_back(&core0);
+    manager->stealingCores.push_back(&core1);
+    MockTransport::MockServerRpc rpc1(&transport, "0x1000d 1");
+    MockTransport::MockServerRpc rpc2(&transport, "0x1000d 2");
+    core0.queue.push_back(&rpc1);
+    core0.queueLength++;
+    core1.queue.push_back(&rpc2);
+    core1.queueLength++;
+
+    uint64_t stolen = PerfStats::threadStats.stolenRpcs;
+    EXPECT_EQ(&rpc2, manager->nextStealableRpc(1));
+    EXPECT_EQ(stolen, PerfStats::threadStats.stolenRpcs);
+
+    // Core 1's queue is empty, so it steals from core 0.
+    EXPECT_EQ(&rpc1, manager->nextStealableRpc(1));
+    EXPECT_EQ(stolen + 1, PerfStats::threadStats.stolenRpcs);
+    EXPECT_EQ(0, core0.queueLength.load());
+    EXPECT_TRUE(manager->nextStealableRpc(0) == NULL);
+    manager->stealingCores.clear();
+}
+
 TEST_F(WorkerManagerTest, idle) {
     EXPECT_TRUE(manager->idle());
     // Start one RPC.
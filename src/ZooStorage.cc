@@ -315,6 +315,58 @@ ZooStorage::set(Hint flavor, const char* name, const char* value,
     setInternal(lock, flavor, getFullName(name), value, valueLength);
 }
 
+/**
+ * Write several objects using a single ZooKeeper multi-op, so that they
+ * are all written atomically with one round trip to the server. If the
+ * multi-op fails (e.g., because a hint was incorrect or a parent node
+ * doesn't exist), it has no effect; in that case the objects are written
+ * one at a time with setInternal, which knows how to handle those
+ * situations.
+ *
+ * \param writes
+ *      Describes the objects to write.
+ */
+void
+ZooStorage::setMulti(const vector<Write>& writes)
+{
+    Lock lock(mutex);
+    if (lostLeadership) {
+        throw LostLeadershipException(HERE);
+    }
+    if (writes.empty()) {
+        return;
+    }
+    vector<string> names;
+    foreach (const Write& write, writes) {
+        names.emplace_back(getFullName(write.name.c_str()));
+    }
+    vector<zoo_op_t> ops(writes.size());
+    vector<zoo_op_result_t> results(writes.size());
+    for (size_t i = 0; i < writes.size(); i++) {
+        const Write& write = writes[i];
+        int length = downCast<int>(write.value.size());
+        if (write.flavor == Hint::CREATE) {
+            zoo_create_op_init(&ops[i], names[i].c_str(), write.value.data(),
+                    length, &ZOO_OPEN_ACL_UNSAFE, 0, NULL, 0);
+        } else {
+            zoo_set_op_init(&ops[i], names[i].c_str(), write.value.data(),
+                    length, -1, NULL);
+        }
+    }
+    int status = zoo_multi(zoo, downCast<int>(ops.size()), &ops[0],
+            &results[0]);
+    if (status == ZOK) {
+        return;
+    }
+    RAMCLOUD_LOG(DEBUG, "Multi-op write of %lu objects failed (%s); "
+            "writing them individually", writes.size(), zerror(status));
+    for (size_t i = 0; i < writes.size(); i++) {
+        setInternal(lock, writes[i].flavor, names[i].c_str(),
+                writes[i].value.data(),
+                downCast<int>(writes[i].value.size()));
+    }
+}
+
 /**
  * This method does most of the work of the "set" method. It is separated
  * so that it can be invoked by both "set" and "createParent" (createParent
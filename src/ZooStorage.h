@@ -40,6 +40,7 @@ class ZooStorage: public ExternalStorage {
     virtual void remove(const char* name);
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1);
+    virtual void setMulti(const vector<Write>& writes);
 
   PRIVATE:
     /**
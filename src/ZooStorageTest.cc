@@ -300,6 +300,43 @@ TEST_F(ZooStorageTest, set_lostLeadership) {
     EXPECT_THROW(zoo->set(ExternalStorage::Hint::CREATE, "/test", "value1"),
                 ExternalStorage::LostLeadershipException);
 }
+TEST_F(ZooStorageTest, setMulti_success) {
+    Buffer value;
+    zoo->set(ExternalStorage::Hint::CREATE, "/test/var1", "value1");
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::Hint::UPDATE, "/test/var1",
+            "value2", 6);
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var2",
+            "value3", 6);
+    TestLog::reset();
+    zoo->setMulti(writes);
+    EXPECT_TRUE(zoo->get("/test/var1", &value));
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    EXPECT_TRUE(zoo->get("/test/var2", &value));
+    EXPECT_EQ("value3", TestUtil::toString(&value));
+    EXPECT_EQ("", TestLog::get());
+}
+TEST_F(ZooStorageTest, setMulti_fallBackToIndividualWrites) {
+    Buffer value;
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::Hint::UPDATE, "/test/var1",
+            "value1", 6);
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var2",
+            "value2", 6);
+    zoo->setMulti(writes);
+    EXPECT_TRUE(zoo->get("/test/var1", &value));
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_TRUE(zoo->get("/test/var2", &value));
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "setMulti: Multi-op write of 2 objects failed"));
+}
+TEST_F(ZooStorageTest, setMulti_lostLeadership) {
+    zoo->lostLeadership = true;
+    vector<ExternalStorage::Write> writes;
+    EXPECT_THROW(zoo->setMulti(writes),
+                ExternalStorage::LostLeadershipException);
+}
 TEST_F(ZooStorageTest, setInternal_createSucess) {
     Buffer value;
     zoo->set(ExternalStorage::Hint::CREATE, "/test", "value1");
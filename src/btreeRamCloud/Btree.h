@@ -29,6 +29,9 @@
 #define _BTREE_H_
 
 #include <assert.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 #include "Buffer.h"
 #include "Object.h"
@@ -196,6 +199,27 @@ PUBLIC:
     /// A value of false will result in linear searching instead.
     static const bool useBinarySearch = true;
 
+    /// Stored in place of the level of a prefix-compressed leaf when it is
+    /// written to the log (see Node::prefixLength), so that the two leaf
+    /// formats can't be confused. No tree is this deep.
+    static const uint16_t COMPRESSED_LEAF_LEVEL = 0xffff;
+
+    /// The maximum number of decoded inner nodes kept in #innerNodeCache.
+    /// Inner nodes are roughly 1/leafslotmax of all nodes, so this covers
+    /// the upper levels of all but very large trees.
+    static const uint32_t maxCachedInnerNodes = 4096;
+
+    /// The maximum number of changes to a leaf that are logged as deltas
+    /// (see LeafDelta) since its last full image. The next change logs the
+    /// whole leaf again, which bounds the number of extra objects read to
+    /// reconstruct a leaf.
+    static const uint16_t maxLeafDeltas = 4;
+
+    /// bulkInsert() flushes the nodes it has written to the log whenever
+    /// it has this many, so that a large bulk insert doesn't need one huge
+    /// atomic append.
+    static const uint32_t maxBulkNodesPerFlush = 1000;
+
     /**
      * A small struct containing basic statistics about the B+ tree.
      */
@@ -209,6 +233,19 @@ PUBLIC:
         /// Number of inner nodes in the B+ tree
         uint64_t innernodes;
 
+        /// Total number of entries in all of the leaves written to the log.
+        uint64_t leafEntriesWritten;
+
+        /// Total bytes of all of the leaves written to the log.
+        uint64_t leafBytesWritten;
+
+        /// Total bytes omitted from the leaves written to the log by
+        /// storing their keys' shared prefix only once.
+        uint64_t prefixBytesSaved;
+
+        /// Number of leaf changes logged as deltas instead of full images.
+        uint64_t leafDeltasWritten;
+
         /// Base B+ tree parameter: The number of key/data slots in each leaf
         static const uint16_t leafslots = leafslotmax;
 
@@ -218,7 +255,11 @@ PUBLIC:
         inline tree_stats()
             : itemcount(0),
               leaves(0),
-              innernodes(0)
+              innernodes(0),
+              leafEntriesWritten(0),
+              leafBytesWritten(0),
+              prefixBytesSaved(0),
+              leafDeltasWritten(0)
         {}
 
         /// Return the total number of nodes
@@ -230,6 +271,14 @@ PUBLIC:
         inline double avgfill_leaves() const {
             return static_cast<double>((itemcount) / (leaves * leafslots));
         }
+
+        /// Return the average number of logged leaf bytes per entry
+        inline double avgLeafBytesPerEntry() const {
+            if (leafEntriesWritten == 0)
+                return 0;
+            return static_cast<double>(leafBytesWritten) /
+                    static_cast<double>(leafEntriesWritten);
+        }
     };
 
 PRIVATE:
@@ -277,6 +326,39 @@ PRIVATE:
     /// considered read-only since any modifications will trash the logBuffer.
     std::map<NodeId, uint32_t> cache;
 
+    /// Decoded copies of inner nodes, indexed by NodeId, so that descending
+    /// the tree doesn't require an ObjectManager lookup for every level.
+    /// Each Buffer holds one node laid out as by serializeAppendToBuffer().
+    /// Only flushed versions of nodes are cached: nodes modified by the
+    /// current operation are dropped, and their new images are added by
+    /// flush().
+    mutable std::unordered_map<NodeId, Buffer*> innerNodeCache;
+
+    /// Nodes written or freed by the current operation, along with the new
+    /// image of each inner node written (NULL otherwise). flush() moves the
+    /// images into #innerNodeCache.
+    std::vector<std::pair<NodeId, Buffer*>> pendingNodes;
+
+    /// Buffers evicted from #innerNodeCache during the current operation.
+    /// Nodes read earlier in the operation may still refer to their keys,
+    /// so they aren't deleted until flush().
+    mutable std::vector<Buffer*> retiredCacheBuffers;
+
+    /// Number of deltas (see LeafDelta) logged for each leaf since its last
+    /// full image. A node that isn't listed hasn't been accessed since the
+    /// tree was created (e.g. on a recovery master), so its deltas, if any,
+    /// are found by probing the backing table.
+    mutable std::unordered_map<NodeId, uint16_t> leafDeltaCounts;
+
+    /// Changes to #leafDeltaCounts made by the current operation. They are
+    /// applied by flush(), so that nodes read before then still reflect
+    /// what is in the log.
+    std::unordered_map<NodeId, uint16_t> pendingLeafDeltaCounts;
+
+    /// True means leaves are written to the log prefix-compressed (see
+    /// Node::prefixLength). Either form can always be read.
+    bool compressLeaves;
+
     DISALLOW_COPY_AND_ASSIGN(IndexBtree);
 
 PRIVATE:
@@ -382,6 +464,17 @@ PRIVATE:
         /// only.
         uint32_t keyStorageUsed;
 
+        /// Nonzero only in a prefix-compressed leaf (see
+        /// LeafNode::serializeCompressedAppendToBuffer()): the number of
+        /// leading bytes shared by every key, which are stored once at the
+        /// start of the key storage. keys[i].keyLength is still the full
+        /// length of each key, but keys[i].relOffset refers to the rest of
+        /// the key that follows the prefix. This field occupies what used to
+        /// be padding, so uncompressed nodes are laid out in the log exactly
+        /// as before; compressed leaves are tagged with COMPRESSED_LEAF_LEVEL
+        /// in the log.
+        uint16_t prefixLength;
+
         /// Secondary key to primary key hash mappings stored within the node
         KeyInfo keys[IndexBtree::innerslotmax];
 
@@ -406,6 +499,7 @@ PRIVATE:
           , level(level)
           , slotuse(0)
           , keyStorageUsed(0)
+          , prefixLength(0)
         {}
 
         virtual ~Node() {}
@@ -415,7 +509,9 @@ PRIVATE:
          *
          * The entry returned will remain valid as long as the node is not
          * destructed. An optional Buffer can be passed in to retain
-         * the contents of the entry beyond destruction.
+         * the contents of the entry beyond destruction. The keys of a
+         * prefix-compressed leaf aren't stored whole, so the key returned is
+         * assembled in keyOutBuffer, or else at the end of keyBuffer.
          *
          * \param index
          *      Index within range [0, slotuse) to access in the node
@@ -434,6 +530,14 @@ PRIVATE:
 
           uint32_t start = keysBeginOffset + keys[index].relOffset;
           uint16_t keyLength = keys[index].keyLength;
+          if (prefixLength != 0) {
+            Buffer *out = (keyOutBuffer != NULL) ? keyOutBuffer : keyBuffer;
+            uint8_t *key = static_cast<uint8_t*>(out->alloc(keyLength));
+            keyBuffer->copy(keysBeginOffset, prefixLength, key);
+            keyBuffer->copy(start, keyLength - prefixLength,
+                    key + prefixLength);
+            return BtreeEntry(key, keyLength, keys[index].pkHash);
+          }
           void *key = keyBuffer->getRange(start, keyLength);
 
           // If provided, copy key to buffer
@@ -467,6 +571,7 @@ PRIVATE:
         setAt(uint16_t index, BtreeEntry entry)
         {
             assert(index <= Node::slotuse);
+            expandKeys();
 
             if (index < Node::slotuse) {
                 int32_t keyLengthDiff = entry.keyLength - keys[index].keyLength;
@@ -537,6 +642,7 @@ PRIVATE:
         pop_back(uint16_t n = 1)
         {
             assert(Node::slotuse >= n);
+            expandKeys();
 
             // Do a virtual copy instead of just decrementing buffer size so
             // any other node's references to the old data will still be valid
@@ -546,6 +652,36 @@ PRIVATE:
             slotuse = uint16_t(slotuse - n);
         }
 
+        /**
+         * Rebuilds the complete keys of a prefix-compressed leaf at the end
+         * of keyBuffer, so that the node can be modified. Leaves that were
+         * read in compressed form are only searched in place until then.
+         * Does nothing if the node isn't compressed.
+         */
+        void
+        expandKeys()
+        {
+            if (prefixLength == 0)
+                return;
+
+            uint32_t fullBytes = keyStorageUsed - prefixLength +
+                    slotuse * prefixLength;
+            uint8_t *dst = static_cast<uint8_t*>(keyBuffer->alloc(fullBytes));
+            uint32_t out = 0;
+            for (uint16_t i = 0; i < slotuse; i++) {
+                keyBuffer->copy(keysBeginOffset, prefixLength, dst + out);
+                keyBuffer->copy(keysBeginOffset + keys[i].relOffset,
+                        keys[i].keyLength - prefixLength,
+                        dst + out + prefixLength);
+                keys[i].relOffset = out;
+                out += keys[i].keyLength;
+            }
+
+            keyStorageUsed = fullBytes;
+            keysBeginOffset = keyBuffer->size() - fullBytes;
+            prefixLength = 0;
+        }
+
         /**
          * Internal function to serialize the data in the base Node class
          * to a preallocated region within a buffer. This abstraction is
@@ -751,6 +887,7 @@ PRIVATE:
         insertAtEntryOnly(uint16_t index, BtreeEntry entry)
         {
             assert(index <= Node::slotuse);
+            expandKeys();
 
             // If the slot existed, shift everything to the right by 1 entry
             if (index < Node::slotuse) {
@@ -796,6 +933,7 @@ PRIVATE:
         eraseAtEntryOnly(uint16_t index)
         {
             assert(index <= Node::slotuse);
+            expandKeys();
 
             uint32_t keyLength = keys[index].keyLength;
             uint32_t firstHalfSize = keys[index].relOffset;
@@ -836,6 +974,8 @@ PRIVATE:
         {
             assert(numEntries + dest->slotuse <= IndexBtree::innerslotmax);
             assert (numEntries <= slotuse);
+            expandKeys();
+            dest->expandKeys();
 
             uint16_t splitPoint = uint16_t(slotuse - numEntries);
             uint32_t bytesToMove = keyStorageUsed - keys[splitPoint].relOffset;
@@ -887,6 +1027,8 @@ PRIVATE:
         {
             assert(numEntries + dest->slotuse <= IndexBtree::innerslotmax);
             assert(numEntries <= slotuse);
+            expandKeys();
+            dest->expandKeys();
 
             uint32_t bytesToMove = keys[numEntries - 1].endRelOffset();
             // Re-append to make sure keys are logically contiguous
@@ -1237,6 +1379,51 @@ PRIVATE:
             return back;
         }
 
+        /**
+         * Moves just enough children from the back of this inner node to the
+         * front of its right sibling that the sibling no longer underflows.
+         * Unlike balanceWithRight(), this leaves this node with at least
+         * mininnerslots entries even when the sibling starts out with none,
+         * provided this node is full. Used after a bulk append, where the
+         * new nodes on the right edge of the tree may be nearly empty.
+         *
+         * \param right
+         *      right inner node sibling to fill; must have fewer than
+         *      mininnerslots entries
+         *
+         * \param inbetween
+         *      BtreeEntry that separates the two nodes in their parent
+         *
+         * \return
+         *      this inner node's last entry removed during the move; the
+         *      parent should use it to separate the two nodes.
+         */
+        inline BtreeEntry
+        fillRightSibling(InnerNode *right, BtreeEntry inbetween)
+        {
+            uint16_t childrenToMove = uint16_t(mininnerslots - right->slotuse);
+            assert(slotuse >= mininnerslots + childrenToMove);
+
+            right->Node::insertAtEntryOnly(0, inbetween);
+            memmove(&right->child[childrenToMove], &right->child[0],
+                    sizeof(NodeId)*(right->slotuse));
+            memmove(&right->child[0], &child[slotuse - childrenToMove + 1],
+                    sizeof(NodeId)*(childrenToMove));
+            if (childrenToMove > 1) {
+                Node::moveBackEntriesToFrontOf(right,
+                        uint16_t(childrenToMove - 1));
+            }
+
+            BtreeEntry back = Node::back();
+            rightMostLeafKeyIsInfinite = false;
+            rightMostLeafKey.keyLength = back.keyLength;
+            rightMostLeafKey.pkHash = back.pKHash;
+            rightMostLeafKey.relOffset =
+                    keysBeginOffset + keys[slotuse - 1].relOffset;
+            Node::pop_back();
+            return back;
+        }
+
         /**
          * Moves all entries in this inner node to the front of the right
          * inner node.
@@ -1378,6 +1565,13 @@ PRIVATE:
     /// identical to the base class with the exception of having
     /// leaf pointers to form a doubly linked list. Note that the
     /// responsibility of managing the linked list falls under IndexBtree.
+    ///
+    /// When written to the log, a leaf may be prefix-compressed (see
+    /// serializeCompressedAppendToBuffer()): the prefix shared by all of its
+    /// keys is stored once, followed by the remainder of each key. A leaf
+    /// read in that form stays compressed in memory; searches compare keys
+    /// in place (see findEntryInCompressedLeaf()) and the keys are only
+    /// rebuilt if the leaf is modified (see Node::expandKeys()).
     struct LeafNode : public Node
     {
         /// Double linked list pointers
@@ -1482,6 +1676,76 @@ PRIVATE:
             slotuse = 0;
         }
 
+        /**
+         * Returns the number of leading bytes shared by all of the keys in
+         * the node; 0 if it has fewer than two keys.
+         */
+        uint16_t
+        sharedPrefixLength() const {
+            if (slotuse < 2)
+                return 0;
+            BtreeEntry first = getAt(0);
+            const char* firstKey = static_cast<const char*>(first.key);
+            uint16_t length = first.keyLength;
+            for (uint16_t i = 1; i < slotuse && length > 0; i++) {
+                BtreeEntry entry = getAt(i);
+                const char* key = static_cast<const char*>(entry.key);
+                if (entry.keyLength < length)
+                    length = entry.keyLength;
+                uint16_t j = 0;
+                while (j < length && key[j] == firstKey[j])
+                    j++;
+                length = j;
+            }
+            return length;
+        }
+
+        /**
+         * Like serializeAppendToBuffer(), but stores the prefix shared by
+         * all of the node's keys only once (see Node::prefixLength). A leaf
+         * that is already compressed is copied as is.
+         *
+         * \param toBuffer
+         *      The buffer to copy to.
+         *
+         * \return
+         *      A pointer to the copied node.
+         */
+        LeafNode*
+        serializeCompressedAppendToBuffer(Buffer *toBuffer) const
+        {
+            uint16_t prefix = (prefixLength == 0) ? sharedPrefixLength() : 0;
+            if (prefix == 0) {
+                return static_cast<LeafNode*>(
+                        Node::serializeAppendToBuffer(toBuffer));
+            }
+
+            uint32_t suffixBytes = keyStorageUsed - slotuse * prefix;
+            uint32_t startOffset = toBuffer->size();
+            uint8_t *ptr = static_cast<uint8_t*>(toBuffer->alloc(
+                    sizeof32(LeafNode) + prefix + suffixBytes));
+            memmove(ptr, this, sizeof(LeafNode));
+            LeafNode *n = reinterpret_cast<LeafNode*>(ptr);
+
+            uint8_t *keysDst = ptr + sizeof(LeafNode);
+            keyBuffer->copy(keysBeginOffset + keys[0].relOffset, prefix,
+                    keysDst);
+            uint32_t offset = prefix;
+            for (uint16_t i = 0; i < slotuse; i++) {
+                uint32_t suffixLength = keys[i].keyLength - prefix;
+                keyBuffer->copy(keysBeginOffset + keys[i].relOffset + prefix,
+                        suffixLength, keysDst + offset);
+                n->keys[i].relOffset = offset;
+                offset += suffixLength;
+            }
+
+            n->keyBuffer = toBuffer;
+            n->keysBeginOffset = startOffset + sizeof32(LeafNode);
+            n->keyStorageUsed = prefix + suffixBytes;
+            n->prefixLength = prefix;
+            return n;
+        }
+
         /**
          * Returns the total byte length of the Node (metadata + keys)
          */
@@ -1490,6 +1754,17 @@ PRIVATE:
             return uint32_t(sizeof(LeafNode) + keyStorageUsed);
         }
 
+        /**
+         * Returns what serializedLength() would be if the node's keys
+         * weren't prefix-compressed.
+         */
+        uint32_t
+        uncompressedLength() const {
+            if (prefixLength == 0)
+                return serializedLength();
+            return serializedLength() + (slotuse - 1) * prefixLength;
+        }
+
         /**
          * Returns a string representation of the node, useful for debugging
          *
@@ -1540,7 +1815,9 @@ PUBLIC:
      */
     explicit inline IndexBtree(uint64_t tableId, ObjectManager *objMgr)
         : m_stats(), treeTableId(tableId), objMgr(objMgr), nextNodeId(ROOT_ID),
-          m_rootId(ROOT_ID), logBuffer(), numEntries(0), cache()
+          m_rootId(ROOT_ID), logBuffer(), numEntries(0), cache(),
+          innerNodeCache(), pendingNodes(), retiredCacheBuffers(),
+          leafDeltaCounts(), pendingLeafDeltaCounts(), compressLeaves(false)
     { }
 
     /**
@@ -1563,13 +1840,39 @@ PUBLIC:
                           uint64_t nextNodeId)
     : m_stats(), treeTableId(tableId), objMgr(objMgr),
         nextNodeId(nextNodeId), m_rootId(ROOT_ID),  logBuffer(),
-        numEntries(0), cache()
+        numEntries(0), cache(), innerNodeCache(), pendingNodes(),
+        retiredCacheBuffers(), leafDeltaCounts(), pendingLeafDeltaCounts(),
+        compressLeaves(false)
     { }
 
-    inline ~IndexBtree() { }
+    inline ~IndexBtree() {
+        clearNodeCache();
+        releaseRetiredCacheBuffers();
+        for (size_t i = 0; i < pendingNodes.size(); i++)
+            delete pendingNodes[i].second;
+    }
 
   PUBLIC:
 
+    /// Returns the tableId of the table that stores this tree's nodes.
+    uint64_t
+    getTreeTableId() const {
+        return treeTableId;
+    }
+
+    /// Selects whether leaves are written prefix-compressed; by default they
+    /// aren't. Leaves in either form can be read regardless.
+    void
+    setLeafCompression(bool enabled) {
+        compressLeaves = enabled;
+    }
+
+    /// Returns statistics about the tree; see tree_stats.
+    const tree_stats&
+    getStats() const {
+        return m_stats;
+    }
+
     /// Returns the NodeId that will be assigned to the next new node written.
     /// The value will be equal to ROOT_ID when the tree is empty.
     NodeId
@@ -1583,6 +1886,11 @@ PUBLIC:
     void
     setNextNodeId(NodeId newNodeId) {
         nextNodeId = newNodeId;
+
+        // Nodes may have been written to the backing table from elsewhere
+        // (e.g. by migration), so cached copies can't be trusted.
+        clearNodeCache();
+        leafDeltaCounts.clear();
     }
 
     /**
@@ -1622,6 +1930,54 @@ PUBLIC:
                 inner->getRightMostLeafKey(), compareEntry);
     }
 
+    /**
+     * Check whether an object in a tree's backing table is a node, rather
+     * than a delta logged for a leaf (see LeafDelta).
+     *
+     * \param keyLength
+     *      Length of the object's primary key.
+     */
+    static bool
+    isNodeKey(KeyLength keyLength) {
+        return keyLength == sizeof(NodeId);
+    }
+
+    /**
+     * Write every leaf that has deltas (see LeafDelta) in full, so that the
+     * current contents of each leaf are in a single object. This is needed
+     * before migrating part of the tree, since migration decides which
+     * objects to send one at a time, by looking at their contents.
+     */
+    void
+    foldLeafDeltas() {
+        if (nextNodeId <= ROOT_ID)
+            return;
+
+        Buffer buffer;
+        NodeId leafId = m_rootId;
+        Node *n = readNode(leafId, &buffer);
+        while (!n->isLeaf()) {
+            leafId = static_cast<const InnerNode*>(n)->getChildAt(0);
+            buffer.reset();
+            n = readNode(leafId, &buffer);
+        }
+
+        while (true) {
+            LeafNode *leaf = static_cast<LeafNode*>(n);
+            if (getLeafDeltaCount(leafId) != 0)
+                writeNode(leaf, leafId);
+            if (numEntries >= maxBulkNodesPerFlush)
+                flush();
+
+            leafId = leaf->nextleaf;
+            if (leafId == INVALID_NODEID)
+                break;
+            buffer.reset();
+            n = readNode(leafId, &buffer);
+        }
+        flush();
+    }
+
     PUBLIC:
     /**
      * Fast Destruction of the B+ Tree
@@ -1638,6 +1994,12 @@ PUBLIC:
             nextNodeId = ROOT_ID;
             m_stats = tree_stats();
             cache.clear();
+            clearNodeCache();
+
+            // NodeIds will be reused, and the deltas of the old nodes are
+            // still in the backing table; they're found by probing and
+            // removed when each id is next written.
+            leafDeltaCounts.clear();
         }
     }
 
@@ -1943,6 +2305,53 @@ PUBLIC:
         m_stats.itemcount++;
     }
 
+    /**
+     * Inserts many entries at once, as when building an index over existing
+     * objects. The entries are sorted first. Those that sort after every
+     * entry already in the tree (all of them, if the tree is empty) are
+     * appended along the right edge of the tree, which builds it bottom-up:
+     * each new node is filled completely and written to the log once,
+     * rather than once per entry as with insert(). The remaining entries
+     * are inserted one at a time, except for those already in the tree,
+     * which are skipped: a batch built from a scan of existing objects may
+     * include objects that were also indexed as they were written, or that
+     * an earlier batch covered.
+     *
+     * \param entries
+     *      Entries to insert. Reordered by this method, and exact duplicates
+     *      are removed. The keys they refer to must remain valid until this
+     *      method returns.
+     */
+    void
+    bulkInsert(std::vector<BtreeEntry>* entries) {
+        std::sort(entries->begin(), entries->end(), key_less_static);
+        entries->erase(std::unique(entries->begin(), entries->end()),
+                entries->end());
+        if (entries->empty())
+            return;
+
+        std::vector<BtreeEntry>::iterator appendStart = entries->begin();
+        if (nextNodeId != ROOT_ID) {
+            // Find the largest entry in the tree.
+            Buffer buffer;
+            Node *n = readNode(m_rootId, &buffer);
+            while (!n->isLeaf()) {
+                const InnerNode *inner = static_cast<const InnerNode*>(n);
+                n = readNode(inner->getChildAt(inner->slotuse), &buffer);
+            }
+            appendStart = std::upper_bound(entries->begin(), entries->end(),
+                    n->back(), key_less_static);
+        }
+
+        for (std::vector<BtreeEntry>::iterator it = entries->begin();
+                it != appendStart; it++) {
+            if (count(*it) == 0)
+                insert(*it);
+        }
+        appendSorted(appendStart, entries->end());
+        if (selfverify) verify();
+    }
+
     /**
      * Erases one Entry in the B+ tree
      *
@@ -2045,6 +2454,11 @@ PRIVATE:
     inline uint16_t
     findEntryGE(const Node *n, BtreeEntry entry) const
     {
+        if (n->prefixLength != 0) {
+            return findEntryInCompressedLeaf(static_cast<const LeafNode*>(n),
+                    entry, false);
+        }
+
         if ( useBinarySearch ) {
             if (n->slotuse == 0)
                 return 0;
@@ -2092,6 +2506,11 @@ PRIVATE:
     inline uint16_t
     findEntryGreater(const Node *n, const BtreeEntry entry) const
     {
+        if (n->prefixLength != 0) {
+            return findEntryInCompressedLeaf(static_cast<const LeafNode*>(n),
+                    entry, true);
+        }
+
         if ( useBinarySearch ) {
             if (n->slotuse == 0)
                 return 0;
@@ -2122,8 +2541,116 @@ PRIVATE:
         }
     }
 
+    /**
+     * Implements findEntryGE() and findEntryGreater() for a prefix-compressed
+     * leaf without rebuilding its keys: the entry is compared with the
+     * shared prefix once, and then with the rest of each key where it lies
+     * in the leaf's buffer.
+     *
+     * \param leaf
+     *      Leaf to search within; its prefixLength must be nonzero.
+     *
+     * \param entry
+     *      BtreeEntry to compare against
+     *
+     * \param greater
+     *      True means find the first entry greater than the one passed in,
+     *      false the first entry greater than or equal to it.
+     *
+     * \return
+     *      Index within the leaf
+     */
+    inline uint16_t
+    findEntryInCompressedLeaf(const LeafNode *leaf, BtreeEntry entry,
+            bool greater) const
+    {
+        // IndexKey::keyCompare() puts an empty key after all others when
+        // it's the second argument and before them otherwise; match what
+        // findEntryGE() and findEntryGreater() do with full keys.
+        if (entry.keyLength == 0)
+            return greater ? 0 : leaf->slotuse;
+
+        uint16_t prefixLength = leaf->prefixLength;
+        const uint8_t *key = static_cast<const uint8_t*>(entry.key);
+        uint16_t common = std::min(prefixLength, entry.keyLength);
+        int cmp = memcmp(leaf->keyBuffer->getRange(leaf->keysBeginOffset,
+                common), key, common);
+        if (cmp < 0)
+            return leaf->slotuse;
+        if (cmp > 0 || entry.keyLength < prefixLength)
+            return 0;
+
+        const uint8_t *rest = key + prefixLength;
+        uint16_t restLength = uint16_t(entry.keyLength - prefixLength);
+        uint16_t lo = 0, hi = leaf->slotuse;
+        while (lo < hi) {
+            uint16_t mid = uint16_t((lo + hi) >> 1);
+            const Node::KeyInfo &info = leaf->keys[mid];
+            uint16_t suffixLength = uint16_t(info.keyLength - prefixLength);
+            common = std::min(suffixLength, restLength);
+            cmp = 0;
+            if (common > 0) {
+                cmp = memcmp(leaf->keyBuffer->getRange(
+                        leaf->keysBeginOffset + info.relOffset, common),
+                        rest, common);
+            }
+            if (cmp == 0)
+                cmp = suffixLength - restLength;
+            if (cmp == 0 && info.pkHash != entry.pKHash)
+                cmp = (info.pkHash < entry.pKHash) ? -1 : 1;
+
+            if (cmp > 0 || (cmp == 0 && !greater)) {
+                hi = mid; // key < mid, or key <= mid
+            } else {
+                lo = uint16_t(mid + 1);
+            }
+        }
+        return lo;
+    }
+
     // *** Helper functions to allow using RamCloud objects for B+ tree nodes
 
+    /**
+     * A change to a single entry of a leaf, logged in place of a full image
+     * of the leaf (see writeLeafChange()). Deltas are objects in the backing
+     * table like the nodes themselves, so recovery replays them like any
+     * other object; readNode() applies a leaf's deltas, in order, to its
+     * last full image. The object's key is a LeafDeltaKey, and its value is
+     * this header followed by the secondary key of an inserted entry.
+     */
+    struct LeafDelta {
+        enum Type : uint8_t {
+            INSERT = 1,
+            ERASE = 2,
+        };
+
+        /// Whether an entry was inserted or erased.
+        uint8_t type;
+
+        /// Index of the entry within the leaf: after the change for an
+        /// insert, before it for an erase.
+        uint16_t slot;
+
+        /// Length of the secondary key that follows (0 for an erase).
+        uint16_t keyLength;
+
+        /// Primary key hash of the entry inserted (0 for an erase).
+        uint64_t pkHash;
+    } __attribute__((packed));
+
+    /**
+     * The key of a LeafDelta object. It begins with the leaf's NodeId, so
+     * it is distinguished from a node's key only by its length.
+     */
+    struct LeafDeltaKey {
+        /// The leaf that was changed.
+        NodeId nodeId;
+
+        /// Position of the delta among those logged since the leaf's last
+        /// full image, starting at 1.
+        uint64_t seq;
+    } __attribute__((packed));
+
     /**
      * Removes a particular node by nodeId in the Btree's backing table.
      * This will not remove any children (in the case of a inner node) or fix
@@ -2143,6 +2670,15 @@ PRIVATE:
         Status status = objMgr->writeTombstone(key, &logBuffer);
         assert(status == STATUS_OK);
         numEntries++;
+        freeLeafDeltas(nodeId);
+        dropCachedNode(nodeId);
+        for (size_t i = 0; i < pendingNodes.size(); i++) {
+            if (pendingNodes[i].first == nodeId) {
+                delete pendingNodes[i].second;
+                pendingNodes[i].second = NULL;
+            }
+        }
+        pendingNodes.emplace_back(nodeId, static_cast<Buffer*>(NULL));
         if (nodeId == m_rootId)
             nextNodeId = ROOT_ID;
     }
@@ -2164,8 +2700,28 @@ PRIVATE:
      */
     inline Node*
     readNode(NodeId nodeId, Buffer* outBuffer) const {
-        // Read from objMaster
         uint32_t sizeBeforeRead = outBuffer->size();
+
+        // Inner nodes are usually available already decoded. Copy the
+        // metadata, since the caller may modify it, but refer to the keys.
+        auto cached = innerNodeCache.find(nodeId);
+        if (cached != innerNodeCache.end()) {
+            Buffer* image = cached->second;
+            uint32_t nodeSize = sizeof32(InnerNode);
+            Node *ptr = static_cast<Node*>(outBuffer->alloc(nodeSize));
+            memcpy(ptr, image->getRange(0, nodeSize), nodeSize);
+            if (image->size() > nodeSize) {
+                outBuffer->appendExternal(image, nodeSize,
+                        image->size() - nodeSize);
+            }
+            ptr->reinitFromRead(outBuffer, sizeBeforeRead);
+            PerfStats::threadStats.btreeNodeReads++;
+            PerfStats::threadStats.btreeNodeCacheHits++;
+            PerfStats::threadStats.btreeBytesRead += (ptr->serializedLength());
+            return ptr;
+        }
+
+        // Read from objMaster
         Key key(treeTableId, &nodeId, sizeof(NodeId));
         Status status = objMgr->readObject(key, outBuffer, NULL, NULL, true);
         if (status != STATUS_OK) {
@@ -2173,31 +2729,288 @@ PRIVATE:
             return NULL;
         }
 
+        Node *ptr = findNodeMetadata(outBuffer, sizeBeforeRead);
+
+        RAMCLOUD_LOG(DEBUG, "Read object from log, nodeId = %lu, size = %d",
+                     nodeId, ptr->serializedLength());
+
+        ptr->reinitFromRead(outBuffer, sizeBeforeRead);
+        PerfStats::threadStats.btreeNodeReads++;
+        PerfStats::threadStats.btreeBytesRead += (ptr->serializedLength());
+        if (ptr->isLeaf())
+            applyLeafDeltas(nodeId, static_cast<LeafNode*>(ptr));
+
+        // Cache inner nodes, unless the version just read is about to be
+        // replaced by the current operation. Nothing is evicted here: the
+        // caller may still hold nodes read from the victim, and a lookup
+        // has no flush() at which to release it.
+        if (ptr->isinnernode() &&
+                (innerNodeCache.size() < maxCachedInnerNodes)) {
+            bool pending = false;
+            for (size_t i = 0; i < pendingNodes.size(); i++)
+                pending |= (pendingNodes[i].first == nodeId);
+            if (!pending) {
+                Buffer* image = new Buffer();
+                ptr->serializeAppendToBuffer(image);
+                cacheNode(nodeId, image);
+            }
+        }
+        return ptr;
+    }
+
+    /**
+     * Bring a leaf just read from the log up to date by applying the deltas
+     * logged for it since its last full image (see LeafDelta).
+     *
+     * \param nodeId
+     *      Id of the leaf.
+     * \param leaf
+     *      The leaf's last full image, as read from the log.
+     */
+    void
+    applyLeafDeltas(NodeId nodeId, LeafNode *leaf) const {
+        auto known = leafDeltaCounts.find(nodeId);
+        uint16_t count = 0;
+        while (known == leafDeltaCounts.end() || count < known->second) {
+            LeafDeltaKey deltaKey = {nodeId, count + 1U};
+            Key key(treeTableId, &deltaKey, sizeof(LeafDeltaKey));
+            Buffer value;
+            Status status = objMgr->readObject(key, &value, NULL, NULL, true);
+            if (status != STATUS_OK) {
+                // The end of the deltas of a leaf not seen before.
+                assert(known == leafDeltaCounts.end());
+                break;
+            }
+
+            const LeafDelta *delta = value.getStart<LeafDelta>();
+            if (delta->type == LeafDelta::INSERT) {
+                const void *secondaryKey = value.getRange(
+                        sizeof32(LeafDelta), delta->keyLength);
+                leaf->insertAt(delta->slot, BtreeEntry(secondaryKey,
+                        delta->keyLength, delta->pkHash));
+            } else {
+                leaf->eraseAt(delta->slot);
+            }
+            PerfStats::threadStats.btreeBytesRead += value.size();
+            count++;
+        }
+
+        if (known == leafDeltaCounts.end())
+            leafDeltaCounts[nodeId] = count;
+    }
+
+    /**
+     * Return the number of deltas logged for a node since its last full
+     * image, including changes made by the current operation.
+     *
+     * \param nodeId
+     *      Id of the node.
+     */
+    uint16_t
+    getLeafDeltaCount(NodeId nodeId) const {
+        auto pending = pendingLeafDeltaCounts.find(nodeId);
+        if (pending != pendingLeafDeltaCounts.end())
+            return pending->second;
+
+        auto known = leafDeltaCounts.find(nodeId);
+        if (known != leafDeltaCounts.end())
+            return known->second;
+
+        // Not seen before; look for deltas in the backing table.
+        uint16_t count = 0;
+        while (true) {
+            LeafDeltaKey deltaKey = {nodeId, count + 1U};
+            Key key(treeTableId, &deltaKey, sizeof(LeafDeltaKey));
+            Buffer value;
+            if (objMgr->readObject(key, &value, NULL, NULL, true) != STATUS_OK)
+                break;
+            count++;
+        }
+        leafDeltaCounts[nodeId] = count;
+        return count;
+    }
+
+    /**
+     * Prepare tombstones for all of the deltas logged for a node, which is
+     * about to be written in full or freed. As with freeNode(), the
+     * tombstones are only persisted by flush().
+     *
+     * \param nodeId
+     *      Id of the node.
+     */
+    void
+    freeLeafDeltas(NodeId nodeId) {
+        uint16_t count = getLeafDeltaCount(nodeId);
+        for (uint16_t seq = 1; seq <= count; seq++) {
+            LeafDeltaKey deltaKey = {nodeId, seq};
+            Key key(treeTableId, &deltaKey, sizeof(LeafDeltaKey));
+            Status status = objMgr->writeTombstone(key, &logBuffer);
+            assert(status == STATUS_OK);
+            numEntries++;
+        }
+        if (count != 0)
+            pendingLeafDeltaCounts[nodeId] = 0;
+    }
+
+    /**
+     * Log the insertion or erasure of a single entry in a leaf. Only the
+     * change is logged, as a LeafDelta, unless the leaf already has
+     * #maxLeafDeltas of them; in that case the whole leaf is written, which
+     * replaces its deltas.
+     *
+     * \param leaf
+     *      The leaf, with the change already made.
+     * \param nodeId
+     *      Id of the leaf.
+     * \param type
+     *      Whether an entry was inserted or erased.
+     * \param slot
+     *      Index of the entry within the leaf: after the change for an
+     *      insert, before it for an erase.
+     * \param entry
+     *      The entry inserted; unused for an erase.
+     */
+    void
+    writeLeafChange(const LeafNode *leaf, NodeId nodeId,
+                    LeafDelta::Type type, uint16_t slot,
+                    BtreeEntry entry = BtreeEntry()) {
+        uint16_t count = getLeafDeltaCount(nodeId);
+        if (count >= maxLeafDeltas) {
+            writeNode(leaf, nodeId);
+            return;
+        }
+
+        uint16_t keyLength = (type == LeafDelta::INSERT) ? entry.keyLength : 0;
+        uint32_t valueLength = sizeof32(LeafDelta) + keyLength;
+        Buffer buffer;
+        LeafDelta *delta = static_cast<LeafDelta*>(buffer.alloc(valueLength));
+        delta->type = type;
+        delta->slot = slot;
+        delta->keyLength = keyLength;
+        delta->pkHash = (type == LeafDelta::INSERT) ? entry.pKHash : 0;
+        if (keyLength != 0)
+            memcpy(delta + 1, entry.key, keyLength);
+
+        LeafDeltaKey deltaKey = {nodeId, count + 1U};
+        Key key(treeTableId, &deltaKey, sizeof(LeafDeltaKey));
+        Object object(key, delta, valueLength, 1, 0, buffer);
+        bool tombstoneAdded = false;
+        uint32_t offset = 0;
+        Status status = objMgr->prepareForLog(object, &logBuffer, &offset,
+                                              &tombstoneAdded);
+        assert(status == STATUS_OK);
+        numEntries += tombstoneAdded ? 2 : 1;
+        pendingLeafDeltaCounts[nodeId] = uint16_t(count + 1);
+
+        m_stats.leafDeltasWritten++;
+        PerfStats::threadStats.btreeLeafDeltaWrites++;
+        PerfStats::threadStats.btreeBytesWritten += valueLength;
+    }
+
+    /**
+     * Add a decoded node to #innerNodeCache, evicting another node if the
+     * cache is full.
+     *
+     * \param nodeId
+     *      Id of the node to cache; must not be in the cache already.
+     * \param image
+     *      Buffer holding only the node, as written by
+     *      serializeAppendToBuffer(). The cache takes ownership of it.
+     */
+    void
+    cacheNode(NodeId nodeId, Buffer* image) const {
+        if (innerNodeCache.size() >= maxCachedInnerNodes) {
+            auto victim = innerNodeCache.begin();
+            retiredCacheBuffers.push_back(victim->second);
+            innerNodeCache.erase(victim);
+        }
+        innerNodeCache[nodeId] = image;
+    }
+
+    /**
+     * Remove a node from #innerNodeCache, if present. The node's Buffer is
+     * kept until the next flush(), so that copies of the node read earlier
+     * in the current operation remain valid.
+     *
+     * \param nodeId
+     *      Id of the node to remove.
+     */
+    void
+    dropCachedNode(NodeId nodeId) const {
+        auto it = innerNodeCache.find(nodeId);
+        if (it != innerNodeCache.end()) {
+            retiredCacheBuffers.push_back(it->second);
+            innerNodeCache.erase(it);
+        }
+    }
+
+    /**
+     * Remove all nodes from #innerNodeCache (see dropCachedNode()).
+     */
+    void
+    clearNodeCache() const {
+        for (auto it = innerNodeCache.begin(); it != innerNodeCache.end();
+                it++) {
+            retiredCacheBuffers.push_back(it->second);
+        }
+        innerNodeCache.clear();
+    }
+
+    /**
+     * Delete the Buffers evicted from #innerNodeCache. This must only be
+     * invoked between operations.
+     */
+    void
+    releaseRetiredCacheBuffers() const {
+        for (size_t i = 0; i < retiredCacheBuffers.size(); i++)
+            delete retiredCacheBuffers[i];
+        retiredCacheBuffers.clear();
+    }
+
+    /**
+     * Locate the metadata of a node serialized in a buffer and make it
+     * contiguous in memory. A private copy of the metadata is made if it
+     * must be changed: the level of a prefix-compressed leaf is stored as
+     * COMPRESSED_LEAF_LEVEL in the log and must be reset, and
+     * Node::prefixLength must be zeroed in uncompressed nodes logged
+     * before it existed, when it was padding. Leaves are always copied,
+     * since a leaf may be changed without being logged again in full (see
+     * writeLeafChange()), and its image in the log must stay intact.
+     *
+     * \param buffer
+     *      Buffer holding the serialized node.
+     *
+     * \param offset
+     *      Where the node is within the buffer.
+     *
+     * \return
+     *      A pointer to the node's metadata, which must still be
+     *      reinitialized with reinitFromRead().
+     */
+    static Node*
+    findNodeMetadata(Buffer* buffer, uint32_t offset) {
         // The trickiness here is that an inner node has more metadata
         // than the other nodes types. Hence, we first read it back as a Node
         // object, which is contains enough metadata to determine its real type.
         // Then read it out in full.
         Node *ptr;
-        uint32_t peekSize = outBuffer->peek(sizeBeforeRead, ((void**)&ptr));
+        uint32_t peekSize = buffer->peek(offset, ((void**)&ptr));
         if (peekSize < sizeof(Node)) {
-            ptr = static_cast<Node*>(outBuffer->getRange(sizeBeforeRead,
-                    sizeof(Node)));
+            ptr = static_cast<Node*>(buffer->getRange(offset, sizeof(Node)));
         }
 
-        uint32_t nodeSize =
-                (ptr->isLeaf() ? sizeof32(LeafNode) : sizeof32(InnerNode));
-
-        if (peekSize < nodeSize) {
-            ptr = static_cast<Node*>(outBuffer->alloc(nodeSize));
-            memmove(ptr, outBuffer->getRange(sizeBeforeRead, nodeSize), nodeSize);
+        bool compressed = (ptr->level == COMPRESSED_LEAF_LEVEL);
+        bool leaf = (ptr->isLeaf() || compressed);
+        uint32_t nodeSize = leaf ? sizeof32(LeafNode) : sizeof32(InnerNode);
+        if (peekSize < nodeSize || leaf || ptr->prefixLength != 0) {
+            ptr = static_cast<Node*>(buffer->alloc(nodeSize));
+            memmove(ptr, buffer->getRange(offset, nodeSize), nodeSize);
         }
 
-        RAMCLOUD_LOG(DEBUG, "Read object from log, nodeId = %lu, size = %d",
-                     nodeId, ptr->serializedLength());
-
-        ptr->reinitFromRead(outBuffer, sizeBeforeRead);
-        PerfStats::threadStats.btreeNodeReads++;
-        PerfStats::threadStats.btreeBytesRead += (ptr->serializedLength());
+        if (compressed)
+            ptr->level = 0;
+        else
+            ptr->prefixLength = 0;
         return ptr;
     }
 
@@ -2215,26 +3028,7 @@ PRIVATE:
      */
     static Node*
     readNodeFromObjectValue(Buffer* nodeObjectValue) {
-        // The trickiness here is that an inner node has more metadata
-        // than the other nodes types. Hence, we first read it back as a Node
-        // object, which is contains enough metadata to determine its real type.
-        // Then read it out in full.
-        Node *ptr;
-        uint32_t peekSize = nodeObjectValue->peek(0, ((void**)&ptr));
-        if (peekSize < sizeof(Node)) {
-            ptr = static_cast<Node*>(
-                    nodeObjectValue->getRange(0, sizeof(Node)));
-        }
-
-        uint32_t nodeSize =
-                (ptr->isLeaf() ? sizeof32(LeafNode) : sizeof32(InnerNode));
-
-        if (peekSize < nodeSize) {
-            ptr = static_cast<Node*>(nodeObjectValue->alloc(nodeSize));
-            memmove(ptr, nodeObjectValue->getRange(0, nodeSize),
-                    nodeSize);
-        }
-
+        Node *ptr = findNodeMetadata(nodeObjectValue, 0);
         ptr->reinitFromRead(nodeObjectValue, 0);
         return ptr;
     }
@@ -2243,6 +3037,9 @@ PRIVATE:
      * Write a B+ tree node as a RamCloud object. After the call returns,
      * it is safe to modify or destroy the tree node passed in.
      *
+     * This logs a complete image of the node, replacing any deltas logged
+     * for it (see writeLeafChange()).
+     *
      * \param node
      *      This points to the tree node to be written
      *
@@ -2260,14 +3057,35 @@ PRIVATE:
       if (nodeId == INVALID_NODEID)
         nodeId = nextNodeId++;
 
+      freeLeafDeltas(nodeId);
+
       Buffer buffer;
       Key key(treeTableId, &nodeId, sizeof(NodeId));
       RAMCLOUD_LOG(DEBUG, "Writing key(nodeId) is %lu, size of node = %d",
                      nodeId, node->serializedLength());
 
-      Node *serializedNode = node->serializeAppendToBuffer(&buffer);
+      // If enabled, leaves are logged with their keys' shared prefix stored
+      // only once. A leaf that is still compressed from an earlier write is
+      // logged as is either way.
+      Node *serializedNode;
+      if (node->isLeaf()) {
+          const LeafNode *leaf = static_cast<const LeafNode*>(node);
+          if (compressLeaves)
+              serializedNode = leaf->serializeCompressedAppendToBuffer(&buffer);
+          else
+              serializedNode = leaf->serializeAppendToBuffer(&buffer);
+          if (serializedNode->prefixLength != 0)
+              serializedNode->level = COMPRESSED_LEAF_LEVEL;
+          m_stats.leafEntriesWritten += leaf->slotuse;
+          m_stats.leafBytesWritten += serializedNode->serializedLength();
+          m_stats.prefixBytesSaved += leaf->uncompressedLength() -
+                  serializedNode->serializedLength();
+      } else {
+          serializedNode = node->serializeAppendToBuffer(&buffer);
+      }
+      uint32_t serializedLength = serializedNode->serializedLength();
       serializedNode->keyBuffer = NULL; // Helps catch errors in case a person reads a node back incorrectly.
-      Object object(key, serializedNode, node->serializedLength(), 1, 0, buffer);
+      Object object(key, serializedNode, serializedLength, 1, 0, buffer);
 
       // here size is the size of the object's value. ObjectManager
       // will construct an object around this.
@@ -2278,13 +3096,29 @@ PRIVATE:
 
       cache[nodeId] = nodeOffset;
 
+      // The new version of an inner node replaces the cached one once the
+      // operation is flushed.
+      dropCachedNode(nodeId);
+      Buffer* image = NULL;
+      if (node->isinnernode()) {
+          image = new Buffer();
+          node->serializeAppendToBuffer(image);
+      }
+      for (size_t i = 0; i < pendingNodes.size(); i++) {
+          if (pendingNodes[i].first == nodeId) {
+              delete pendingNodes[i].second;
+              pendingNodes[i].second = NULL;
+          }
+      }
+      pendingNodes.emplace_back(nodeId, image);
+
       if (tombstoneAdded)
           numEntries+= 2;
       else
           numEntries++;
 
       PerfStats::threadStats.btreeNodeWrites++;
-      PerfStats::threadStats.btreeBytesWritten += node->serializedLength();
+      PerfStats::threadStats.btreeBytesWritten += serializedLength;
 
       assert(status == STATUS_OK);
       return nodeId;
@@ -2321,6 +3155,20 @@ PRIVATE:
         bool status = objMgr->flushEntriesToLog(&logBuffer, numEntries);
         assert(status == true);
         cache.clear();
+
+        for (auto it = pendingLeafDeltaCounts.begin();
+                it != pendingLeafDeltaCounts.end(); it++) {
+            leafDeltaCounts[it->first] = it->second;
+        }
+        pendingLeafDeltaCounts.clear();
+
+        for (size_t i = 0; i < pendingNodes.size(); i++) {
+            dropCachedNode(pendingNodes[i].first);
+            if (pendingNodes[i].second != NULL)
+                cacheNode(pendingNodes[i].first, pendingNodes[i].second);
+        }
+        pendingNodes.clear();
+        releaseRetiredCacheBuffers();
     }
 
 PRIVATE:
@@ -2516,6 +3364,187 @@ PRIVATE:
         }
     };
 
+    /**
+     * A node on the right edge of the tree (the path from the root to the
+     * last leaf), held in memory by appendSorted() while entries are
+     * appended to it.
+     */
+    struct EdgeNode {
+        explicit EdgeNode(NodeId id)
+            : buffer()
+            , node(NULL)
+            , id(id)
+        {}
+
+        /// Holds the node and its keys.
+        Buffer buffer;
+
+        /// The node itself, which lives in #buffer.
+        Node *node;
+
+        /// NodeId the node will be written to.
+        NodeId id;
+
+        DISALLOW_COPY_AND_ASSIGN(EdgeNode);
+    };
+
+    /**
+     * Appends a sorted run of entries to the tree, all of which must be
+     * greater than any entry already in the tree. Each entry goes into the
+     * last leaf; when that leaf is full it is written out and a new, empty
+     * leaf is started to its right, and likewise up the tree. Nodes are
+     * thus written once, full, rather than being split. Afterwards, any new
+     * nodes on the right edge that have too few entries take some from
+     * their (full) left siblings.
+     *
+     * \param first
+     *      First entry to append.
+     * \param last
+     *      Entry after the last one to append.
+     */
+    void
+    appendSorted(std::vector<BtreeEntry>::const_iterator first,
+                 std::vector<BtreeEntry>::const_iterator last) {
+        if (first == last)
+            return;
+
+        // edge[0] is the last leaf and edge.back() is the root.
+        std::vector<EdgeNode*> edge;
+        if (nextNodeId == ROOT_ID) {
+            EdgeNode *root = new EdgeNode(ROOT_ID);
+            root->node = root->buffer.emplaceAppend<LeafNode>(&root->buffer);
+            edge.push_back(root);
+            nextNodeId = ROOT_ID + 1;
+            m_stats.leaves = 1;
+        } else {
+            NodeId id = m_rootId;
+            while (true) {
+                // Take a private copy of each node, since cached images
+                // may be released by the flushes below.
+                Buffer buffer;
+                EdgeNode *e = new EdgeNode(id);
+                e->node = readNode(id, &buffer)->serializeAppendToBuffer(
+                        &e->buffer);
+                edge.insert(edge.begin(), e);
+                if (e->node->isLeaf())
+                    break;
+                const InnerNode *inner = static_cast<const InnerNode*>(e->node);
+                id = inner->getChildAt(inner->slotuse);
+            }
+        }
+
+        for (; first != last; first++) {
+            if (edge[0]->node->isfull()) {
+                Buffer lastBuffer;
+                closeEdgeNode(&edge, 0, edge[0]->node->back(&lastBuffer));
+                if (numEntries >= maxBulkNodesPerFlush)
+                    flush();
+            }
+            LeafNode *leaf = static_cast<LeafNode*>(edge[0]->node);
+            leaf->insertAt(leaf->slotuse, *first);
+            m_stats.itemcount++;
+        }
+
+        // The left siblings must be readable from the log.
+        flush();
+
+        // Working down from the top ensures each underflowing node's parent
+        // has at least one other child by the time the node is fixed.
+        for (size_t level = edge.size() - 1; level-- > 0; ) {
+            Node *node = edge[level]->node;
+            if (!node->isunderflow())
+                continue;
+
+            InnerNode *parent = static_cast<InnerNode*>(edge[level + 1]->node);
+            assert(parent->slotuse >= 1);
+            uint16_t leftSlot = uint16_t(parent->slotuse - 1);
+            NodeId leftId = parent->getChildAt(leftSlot);
+            Buffer leftBuffer;
+            Node *left = readNode(leftId, &leftBuffer);
+
+            BtreeEntry newLastKey;
+            if (node->isLeaf()) {
+                newLastKey = static_cast<LeafNode*>(left)->balanceWithRight(
+                        static_cast<LeafNode*>(node));
+            } else {
+                newLastKey = static_cast<InnerNode*>(left)->fillRightSibling(
+                        static_cast<InnerNode*>(node),
+                        parent->getAt(leftSlot));
+            }
+            PerfStats::threadStats.btreeRebalances++;
+            parent->setAt(leftSlot, newLastKey);
+            writeNode(left, leftId);
+        }
+
+        for (size_t level = 0; level < edge.size(); level++) {
+            writeNode(edge[level]->node, edge[level]->id);
+            delete edge[level];
+        }
+        flush();
+    }
+
+    /**
+     * Used by appendSorted() when a node on the right edge of the tree is
+     * full: writes the node out and replaces it on the edge with a new,
+     * empty right sibling. The parent is closed in the same way if it has
+     * no room for the new child, and the tree grows a level if the root
+     * is full.
+     *
+     * \param edge
+     *      The right edge of the tree, starting with the last leaf.
+     * \param level
+     *      Index in \a edge of the full node.
+     * \param last
+     *      The largest entry in the subtree under the full node.
+     */
+    void
+    closeEdgeNode(std::vector<EdgeNode*>* edge, size_t level, BtreeEntry last)
+    {
+        EdgeNode *full = (*edge)[level];
+        uint16_t nodeLevel = full->node->level;
+
+        if (level + 1 == edge->size()) {
+            // Root is full: move it to a new NodeId under a new root.
+            full->id = nextNodeId++;
+            EdgeNode *root = new EdgeNode(ROOT_ID);
+            InnerNode *newRoot = root->buffer.emplaceAppend<InnerNode>(
+                    &root->buffer, uint16_t(nodeLevel + 1));
+            newRoot->child[0] = full->id;
+            root->node = newRoot;
+            edge->push_back(root);
+            m_stats.innernodes++;
+        }
+
+        EdgeNode *sibling = new EdgeNode(nextNodeId++);
+        if (full->node->isLeaf()) {
+            LeafNode *leaf = static_cast<LeafNode*>(full->node);
+            LeafNode *newLeaf =
+                    sibling->buffer.emplaceAppend<LeafNode>(&sibling->buffer);
+            leaf->nextleaf = sibling->id;
+            newLeaf->prevleaf = full->id;
+            sibling->node = newLeaf;
+            m_stats.leaves++;
+        } else {
+            static_cast<InnerNode*>(full->node)->setRightMostLeafKey(last);
+            sibling->node = sibling->buffer.emplaceAppend<InnerNode>(
+                    &sibling->buffer, nodeLevel);
+            m_stats.innernodes++;
+        }
+
+        InnerNode *parent = static_cast<InnerNode*>((*edge)[level + 1]->node);
+        if (parent->isfull()) {
+            closeEdgeNode(edge, level + 1, last);
+            parent = static_cast<InnerNode*>((*edge)[level + 1]->node);
+            parent->child[0] = sibling->id;
+        } else {
+            parent->insertAt(parent->slotuse, last, full->id, sibling->id);
+        }
+
+        writeNode(full->node, full->id);
+        delete full;
+        (*edge)[level] = sibling;
+    }
+
     /**
      * Descends down a subtree to insert an entry into the B+ tree correctly.
      * Any Node overflows are handled along the way by splitting the node
@@ -2628,7 +3657,8 @@ PRIVATE:
 
         if (!leaf->isfull()) {
           leaf->insertAt(insertIndex, entry);
-          writeNode(leaf, currentId);
+          writeLeafChange(leaf, currentId, LeafDelta::INSERT, insertIndex,
+                          entry);
           updateInfo->clear();
 
           return;
@@ -2779,6 +3809,9 @@ PRIVATE:
 
         if (node->isunderflow() && !(currentId == m_rootId && node->slotuse >= 1)) {
             handleUnderflowAndWrite(node, currentId, parent, parentSlot, info);
+        } else if (node->isLeaf()) {
+            writeLeafChange(static_cast<LeafNode*>(node), currentId,
+                            LeafDelta::ERASE, slot);
         } else if (dirty) {
             writeNode(node, currentId);
         }
@@ -2833,11 +3866,17 @@ PRIVATE:
             if (it == cache.end()) {
                 newRoot = readNode(childId, &buffer);
             } else {
-                newRoot = static_cast<Node*>(
+                // Decode a reference to the child's serialized copy, since
+                // decoding may append to the buffer (see LeafNode).
+                Node *image = static_cast<Node*>(
                                 logBuffer.getRange(it->second, sizeof(Node)));
-
-                // Readjust buffer
-                newRoot->reinitFromRead(&logBuffer, it->second);
+                uint32_t nodeSize = (image->isLeaf() ? sizeof32(LeafNode)
+                                                     : sizeof32(InnerNode));
+                image = static_cast<Node*>(
+                                logBuffer.getRange(it->second, nodeSize));
+                buffer.appendExternal(&logBuffer, it->second,
+                                      image->serializedLength());
+                newRoot = readNodeFromObjectValue(&buffer);
             }
 
             writeNode(newRoot, m_rootId);
@@ -260,7 +260,7 @@ static void checkNodeEquals(const IndexBtree::LeafNode *orig,
                             const IndexBtree::LeafNode *cpy) {
   EXPECT_EQ(orig->level, cpy->level);
   EXPECT_EQ(orig->slotuse, cpy->slotuse);
-  EXPECT_EQ(orig->keyStorageUsed, cpy->keyStorageUsed);
+  EXPECT_EQ(orig->uncompressedLength(), cpy->uncompressedLength());
 
   for (uint16_t i = 0; i < orig->slotuse; i++) {
     BtreeEntry origEntry = orig->getAt(i);
@@ -973,6 +973,170 @@ TEST_F(BtreeTest, writeReadFreeNode) {
   EXPECT_TRUE(NULL == bt.readNode(1000, &buffer_out));
 }
 
+TEST_F(BtreeTest, LeafNode_sharedPrefixLength) {
+    Buffer buffer;
+    IndexBtree::LeafNode *n =
+            buffer.emplaceAppend<IndexBtree::LeafNode>(&buffer);
+    EXPECT_EQ(0U, n->sharedPrefixLength());
+    n->insertAt(0, {"tenant7:user1", 1});
+    EXPECT_EQ(0U, n->sharedPrefixLength());
+    n->insertAt(1, {"tenant7:user2", 2});
+    EXPECT_EQ(12U, n->sharedPrefixLength());
+    n->insertAt(2, {"tenant7:user22", 3});
+    EXPECT_EQ(12U, n->sharedPrefixLength());
+    n->insertAt(0, {"tenant7", 4});
+    EXPECT_EQ(7U, n->sharedPrefixLength());
+    n->insertAt(0, {"other", 5});
+    EXPECT_EQ(0U, n->sharedPrefixLength());
+}
+
+TEST_F(BtreeTest, LeafNode_serializeCompressedAppendToBuffer) {
+    Buffer buffer, out;
+    IndexBtree::LeafNode *n =
+            buffer.emplaceAppend<IndexBtree::LeafNode>(&buffer);
+    n->prevleaf = 7;
+    n->nextleaf = 9;
+    n->insertAt(0, {"http://example.com/a", 1});
+    n->insertAt(1, {"http://example.com/bb", 2});
+    n->insertAt(2, {"http://example.com/ccc", 3});
+
+    out.alloc(10); // Just to give us an offset.
+    IndexBtree::LeafNode *compressed =
+            n->serializeCompressedAppendToBuffer(&out);
+    EXPECT_EQ(19U, compressed->prefixLength);
+    EXPECT_EQ(25U, compressed->keyStorageUsed);
+    EXPECT_EQ(n->serializedLength() - 38, compressed->serializedLength());
+    EXPECT_EQ(n->serializedLength(), compressed->uncompressedLength());
+    EXPECT_EQ(compressed->serializedLength() + 10, out.size());
+    EXPECT_EQ(7U, compressed->prevleaf);
+    EXPECT_EQ(9U, compressed->nextleaf);
+    checkNodeEquals(n, compressed);
+
+    // A compressed leaf is copied as is.
+    Buffer out2;
+    IndexBtree::LeafNode *copy =
+            compressed->serializeCompressedAppendToBuffer(&out2);
+    EXPECT_EQ(19U, copy->prefixLength);
+    checkNodeEquals(n, copy);
+
+    // Modifying the leaf rebuilds its keys.
+    compressed->eraseAt(1);
+    EXPECT_EQ(0U, compressed->prefixLength);
+    EXPECT_EQ(42U, compressed->keyStorageUsed);
+    n->eraseAt(1);
+    checkNodeEquals(n, compressed);
+
+    // Nothing to share.
+    n->insertAt(0, {"ftp", 4});
+    out.reset();
+    compressed = n->serializeCompressedAppendToBuffer(&out);
+    EXPECT_EQ(0U, compressed->prefixLength);
+    EXPECT_EQ(n->serializedLength(), compressed->serializedLength());
+}
+
+TEST_F(BtreeTest, writeReadCompressedLeaf) {
+    PerfStats start = PerfStats::threadStats;
+    PerfStats& now = PerfStats::threadStats;
+    IndexBtree bt(tableId, &objectManager);
+    bt.setLeafCompression(true);
+    Buffer buffer_in, buffer_out, value;
+    IndexBtree::LeafNode *n =
+            buffer_in.emplaceAppend<IndexBtree::LeafNode>(&buffer_in);
+    n->insertAt(0, {"tenant42:user1:ts100", 1});
+    n->insertAt(1, {"tenant42:user1:ts200", 2});
+    n->insertAt(2, {"tenant42:user2:ts100", 3});
+
+    bt.writeNode(n, 1000);
+    bt.flush();
+    EXPECT_EQ(n->serializedLength() - 2 * 13,
+            now.btreeBytesWritten - start.btreeBytesWritten);
+    EXPECT_EQ(26U, bt.getStats().prefixBytesSaved);
+    EXPECT_EQ(3U, bt.getStats().leafEntriesWritten);
+
+    // The log image is tagged; the copy read back is a leaf that is still
+    // compressed.
+    NodeId nodeId = 1000;
+    Key nodeKey(tableId, &nodeId, sizeof(NodeId));
+    ASSERT_EQ(STATUS_OK,
+            objectManager.readObject(nodeKey, &value, NULL, NULL, true));
+    EXPECT_EQ(static_cast<uint16_t>(IndexBtree::COMPRESSED_LEAF_LEVEL),
+            value.getStart<IndexBtree::LeafNode>()->level);
+    IndexBtree::LeafNode *rn = static_cast<IndexBtree::LeafNode*>(
+            bt.readNode(1000, &buffer_out));
+    EXPECT_TRUE(rn->isLeaf());
+    EXPECT_EQ(13U, rn->prefixLength);
+    checkNodeEquals(n, rn);
+    EXPECT_EQ(1U, bt.findEntryGE(rn, {"tenant42:user1:ts150", 0}));
+    EXPECT_EQ(13U, rn->prefixLength);
+
+    // Decoding from an object's value works the same way.
+    IndexBtree::Node *vn = IndexBtree::readNodeFromObjectValue(&value);
+    EXPECT_EQ(0U, vn->level);
+    checkNodeEquals(n, static_cast<IndexBtree::LeafNode*>(vn));
+
+    // Uncompressed leaves are laid out as they always were.
+    bt.setLeafCompression(false);
+    bt.writeNode(n, 1001);
+    bt.flush();
+    nodeId = 1001;
+    Key nodeKey2(tableId, &nodeId, sizeof(NodeId));
+    value.reset();
+    ASSERT_EQ(STATUS_OK,
+            objectManager.readObject(nodeKey2, &value, NULL, NULL, true));
+    EXPECT_EQ(sizeof32(IndexBtree::LeafNode) + 60U, value.size());
+    EXPECT_EQ(0U, value.getStart<IndexBtree::LeafNode>()->level);
+    buffer_out.reset();
+    rn = static_cast<IndexBtree::LeafNode*>(bt.readNode(1001, &buffer_out));
+    EXPECT_EQ(0U, rn->prefixLength);
+    checkNodeEquals(n, rn);
+}
+
+TEST_F(BtreeTest, readNodeFromObjectValue_oldPadding) {
+    // Before Node::prefixLength existed its bytes were padding, so logged
+    // nodes may have anything there.
+    Buffer buffer, value;
+    IndexBtree::LeafNode *n =
+            buffer.emplaceAppend<IndexBtree::LeafNode>(&buffer);
+    fillNodeSorted(n);
+    IndexBtree::Node *image = n->serializeAppendToBuffer(&value);
+    image->prefixLength = 0xabcd;
+
+    IndexBtree::Node *rn = IndexBtree::readNodeFromObjectValue(&value);
+    EXPECT_EQ(0U, rn->prefixLength);
+    checkNodeEquals(n, static_cast<IndexBtree::LeafNode*>(rn));
+}
+
+TEST_F(BtreeTest, findEntryInCompressedLeaf) {
+    IndexBtree bt(tableId, &objectManager);
+    Buffer buffer, out;
+    IndexBtree::LeafNode *n =
+            buffer.emplaceAppend<IndexBtree::LeafNode>(&buffer);
+    n->insertAt(0, {"user:ab", 1});
+    n->insertAt(1, {"user:b", 2});
+    n->insertAt(2, {"user:b", 5});
+    n->insertAt(3, {"user:bcd", 3});
+    n->insertAt(4, {"user:c", 4});
+    IndexBtree::LeafNode *compressed =
+            n->serializeCompressedAppendToBuffer(&out);
+    ASSERT_EQ(5U, compressed->prefixLength);
+
+    BtreeEntry probes[] = {
+        {"", 0}, {"a", 0}, {"user", 0}, {"user:", 0}, {"user:a", 0},
+        {"user:ab", 1}, {"user:ab", 2}, {"user:b", 0}, {"user:b", 2},
+        {"user:b", 3}, {"user:b", 5}, {"user:b", 6}, {"user:bc", 0},
+        {"user:c", 4}, {"user:d", 0}, {"users", 0}, {"v", 0},
+    };
+    for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+        string key(static_cast<const char*>(probes[i].key),
+                probes[i].keyLength);
+        EXPECT_EQ(bt.findEntryGE(n, probes[i]),
+                bt.findEntryGE(compressed, probes[i])) << key;
+        EXPECT_EQ(bt.findEntryGreater(n, probes[i]),
+                bt.findEntryGreater(compressed, probes[i])) << key;
+    }
+    EXPECT_EQ(5U, compressed->prefixLength);
+}
+
 TEST_F (BtreeTest, writeReadInnerNode) {
     BtreeEntry eTest = {"Testing", 123};
     BtreeEntry e0 = {"zero", 0};
@@ -2090,9 +2254,10 @@ TEST_F(BtreeTest, perfStats_endToEnd) {
     EXPECT_EQ(1U, now.btreeNodeWrites - start.btreeNodeWrites);
     EXPECT_EQ(0U, now.btreeNodeReads - start.btreeNodeReads);
 
-    // Insert another!
+    // Insert another! Only the change to the leaf is logged.
     bt.insert(entries[1]);
-    EXPECT_EQ(2U, now.btreeNodeWrites - start.btreeNodeWrites);
+    EXPECT_EQ(1U, now.btreeNodeWrites - start.btreeNodeWrites);
+    EXPECT_EQ(1U, now.btreeLeafDeltaWrites - start.btreeLeafDeltaWrites);
     EXPECT_EQ(1U, now.btreeNodeReads - start.btreeNodeReads);
 
     // Insert up till the last one
@@ -2143,6 +2308,330 @@ TEST_F(BtreeTest, perfStats_endToEnd) {
     EXPECT_EQ(0U, now.btreeRebalances - start.btreeRebalances);
 }
 
+TEST_F(BtreeTest, innerNodeCache) {
+    PerfStats start = PerfStats::threadStats;
+    PerfStats& now = PerfStats::threadStats;
+    uint16_t slots = IndexBtree::innerslotmax;
+    uint32_t numEntries = static_cast<uint32_t>(slots*slots);
+    IndexBtree bt(tableId, &objectManager);
+
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, numEntries, entryKeys, entries, 6);
+    for (uint32_t i = 0; i < numEntries; i++)
+        bt.insert(entries[i]);
+    EXPECT_EQ("", bt.verify());
+    EXPECT_LT(0U, bt.innerNodeCache.size());
+    EXPECT_EQ(1U, bt.innerNodeCache.count(ROOT_ID));
+    EXPECT_EQ(0U, bt.pendingNodes.size());
+    EXPECT_EQ(0U, bt.retiredCacheBuffers.size());
+
+    // Lookups find the root (and any other inner nodes) in the cache.
+    start = now;
+    EXPECT_TRUE(bt.exists(entries[numEntries/2]));
+    EXPECT_LT(0U, now.btreeNodeCacheHits - start.btreeNodeCacheHits);
+    EXPECT_EQ(now.btreeNodeReads - start.btreeNodeReads - 1,
+            now.btreeNodeCacheHits - start.btreeNodeCacheHits);
+
+    // An inner node written but not yet flushed still reads back as the
+    // old version, and isn't cached.
+    Buffer buffer, buffer2;
+    IndexBtree::InnerNode *root = static_cast<IndexBtree::InnerNode*>(
+            bt.readNode(ROOT_ID, &buffer));
+    uint16_t rootSlots = root->slotuse;
+    root->eraseAt(0);
+    bt.writeNode(root, ROOT_ID);
+    EXPECT_EQ(0U, bt.innerNodeCache.count(ROOT_ID));
+    EXPECT_EQ(rootSlots, bt.readNode(ROOT_ID, &buffer2)->slotuse);
+    EXPECT_EQ(0U, bt.innerNodeCache.count(ROOT_ID));
+    bt.flush();
+    EXPECT_EQ(1U, bt.innerNodeCache.count(ROOT_ID));
+    start = now;
+    EXPECT_EQ(rootSlots - 1, bt.readNode(ROOT_ID, &buffer2)->slotuse);
+    EXPECT_EQ(1U, now.btreeNodeCacheHits - start.btreeNodeCacheHits);
+
+    bt.clear_fast();
+    EXPECT_EQ(0U, bt.innerNodeCache.size());
+}
+
+TEST_F(BtreeTest, innerNodeCache_insertErase) {
+    uint16_t slots = IndexBtree::innerslotmax;
+    uint32_t numEntries = static_cast<uint32_t>(slots*slots*slots);
+    IndexBtree bt(tableId, &objectManager);
+
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, numEntries, entryKeys, entries, 6);
+    for (uint32_t i = 0; i < numEntries; i++)
+        bt.insert(entries[i]);
+
+    // Erasing merges and rebalances inner nodes; the cached copies must
+    // track every change.
+    for (uint32_t i = 0; i < numEntries; i += 2) {
+        EXPECT_TRUE(bt.erase(entries[i]));
+        ASSERT_EQ("", bt.verify());
+    }
+    for (uint32_t i = 0; i < numEntries; i++)
+        EXPECT_EQ((i % 2) == 1, bt.exists(entries[i]));
+}
+
+TEST_F(BtreeTest, writeLeafChange) {
+    PerfStats start = PerfStats::threadStats;
+    PerfStats& now = PerfStats::threadStats;
+    uint16_t maxDeltas = IndexBtree::maxLeafDeltas;
+    IndexBtree bt(tableId, &objectManager);
+
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, maxDeltas + 1, entryKeys, entries, 2);
+    for (uint16_t i = 0; i <= maxDeltas; i++)
+        bt.insert(entries[i]);
+    EXPECT_EQ(maxDeltas, bt.getStats().leafDeltasWritten);
+    EXPECT_EQ(1U, now.btreeNodeWrites - start.btreeNodeWrites);
+    EXPECT_EQ(maxDeltas,
+            now.btreeLeafDeltaWrites - start.btreeLeafDeltaWrites);
+    EXPECT_EQ(maxDeltas, bt.leafDeltaCounts[ROOT_ID]);
+
+    // Only the first insert is in the leaf's image; the rest are deltas,
+    // which reads apply.
+    NodeId nodeId = ROOT_ID;
+    Key nodeKey(tableId, &nodeId, sizeof(NodeId));
+    Buffer value;
+    ASSERT_EQ(STATUS_OK,
+            objectManager.readObject(nodeKey, &value, NULL, NULL, true));
+    EXPECT_EQ(1U, IndexBtree::readNodeFromObjectValue(&value)->slotuse);
+    IndexBtree::LeafDeltaKey deltaKey = {ROOT_ID, maxDeltas};
+    Key key(tableId, &deltaKey, sizeof(deltaKey));
+    EXPECT_FALSE(IndexBtree::isNodeKey(key.getStringKeyLength()));
+    value.reset();
+    EXPECT_EQ(STATUS_OK,
+            objectManager.readObject(key, &value, NULL, NULL, true));
+    for (uint16_t i = 0; i <= maxDeltas; i++)
+        EXPECT_TRUE(bt.exists(entries[i]));
+
+    // Past the limit, the whole leaf is written and the deltas deleted.
+    EXPECT_TRUE(bt.erase(entries[0]));
+    EXPECT_EQ(maxDeltas, bt.getStats().leafDeltasWritten);
+    EXPECT_EQ(0U, bt.leafDeltaCounts[ROOT_ID]);
+    value.reset();
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            objectManager.readObject(key, &value, NULL, NULL, true));
+    value.reset();
+    ASSERT_EQ(STATUS_OK,
+            objectManager.readObject(nodeKey, &value, NULL, NULL, true));
+    EXPECT_EQ(maxDeltas,
+            IndexBtree::readNodeFromObjectValue(&value)->slotuse);
+
+    // Erases are logged as deltas too.
+    EXPECT_TRUE(bt.erase(entries[1]));
+    EXPECT_EQ(maxDeltas + 1U, bt.getStats().leafDeltasWritten);
+    EXPECT_FALSE(bt.exists(entries[1]));
+    EXPECT_TRUE(bt.exists(entries[2]));
+    EXPECT_EQ("", bt.verify());
+}
+
+TEST_F(BtreeTest, applyLeafDeltas_newTree) {
+    IndexBtree bt(tableId, &objectManager);
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, 4, entryKeys, entries, 2);
+    bt.insert(entries[2]);
+    bt.insert(entries[0]);
+    bt.insert(entries[1]);
+    EXPECT_TRUE(bt.erase(entries[2]));
+    EXPECT_EQ(3U, bt.leafDeltaCounts[ROOT_ID]);
+
+    // A tree created over the same backing table, as on a recovery master,
+    // finds the deltas by probing.
+    IndexBtree recovered(tableId, &objectManager, bt.getNextNodeId());
+    EXPECT_EQ(0U, recovered.leafDeltaCounts.size());
+    EXPECT_TRUE(recovered.exists(entries[0]));
+    EXPECT_TRUE(recovered.exists(entries[1]));
+    EXPECT_FALSE(recovered.exists(entries[2]));
+    EXPECT_EQ(3U, recovered.leafDeltaCounts[ROOT_ID]);
+
+    recovered.insert(entries[3]);
+    EXPECT_EQ(4U, recovered.leafDeltaCounts[ROOT_ID]);
+    EXPECT_EQ("", recovered.verify());
+}
+
+TEST_F(BtreeTest, freeLeafDeltas_clearFast) {
+    IndexBtree bt(tableId, &objectManager);
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, 3, entryKeys, entries, 2);
+    bt.insert(entries[0]);
+    bt.insert(entries[1]);
+    EXPECT_EQ(1U, bt.leafDeltaCounts[ROOT_ID]);
+
+    // The old root's delta is still in the backing table; it must not be
+    // applied to the new root.
+    bt.clear_fast();
+    EXPECT_EQ(0U, bt.leafDeltaCounts.size());
+    bt.insert(entries[2]);
+    EXPECT_EQ(0U, bt.leafDeltaCounts[ROOT_ID]);
+    IndexBtree::LeafDeltaKey deltaKey = {ROOT_ID, 1};
+    Key key(tableId, &deltaKey, sizeof(deltaKey));
+    Buffer value;
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            objectManager.readObject(key, &value, NULL, NULL, true));
+    EXPECT_FALSE(bt.exists(entries[1]));
+    EXPECT_TRUE(bt.exists(entries[2]));
+    EXPECT_EQ(1U, bt.size());
+}
+
+TEST_F(BtreeTest, foldLeafDeltas) {
+    uint16_t slots = IndexBtree::innerslotmax;
+    uint32_t numEntries = static_cast<uint32_t>(slots*slots);
+    IndexBtree bt(tableId, &objectManager);
+    bt.foldLeafDeltas();
+
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, numEntries, entryKeys, entries, 6);
+    for (uint32_t i = 0; i < numEntries; i++)
+        bt.insert(entries[(i * 7) % numEntries]);
+
+    std::vector<NodeId> changedLeaves;
+    for (auto it = bt.leafDeltaCounts.begin();
+            it != bt.leafDeltaCounts.end(); it++) {
+        if (it->second != 0)
+            changedLeaves.push_back(it->first);
+    }
+    EXPECT_LT(0U, changedLeaves.size());
+
+    bt.foldLeafDeltas();
+    for (size_t i = 0; i < changedLeaves.size(); i++) {
+        EXPECT_EQ(0U, bt.leafDeltaCounts[changedLeaves[i]]);
+        IndexBtree::LeafDeltaKey deltaKey = {changedLeaves[i], 1};
+        Key key(tableId, &deltaKey, sizeof(deltaKey));
+        Buffer value;
+        EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+                objectManager.readObject(key, &value, NULL, NULL, true));
+    }
+    EXPECT_EQ("", bt.verify());
+    for (uint32_t i = 0; i < numEntries; i++)
+        EXPECT_TRUE(bt.exists(entries[i]));
+}
+
+TEST_F(BtreeTest, bulkInsert_emptyTree) {
+    uint32_t slots = IndexBtree::innerslotmax;
+    uint32_t sizes[] = {1, slots, slots + 1, slots*(slots + 1) + 1,
+                        slots*slots*slots + 3};
+    PerfStats start = PerfStats::threadStats;
+    PerfStats& now = PerfStats::threadStats;
+
+    foreach (uint32_t numEntries, sizes) {
+        IndexBtree bt(tableId, &objectManager);
+        std::vector<std::string> entryKeys;
+        std::vector<BtreeEntry> entries;
+        generateKeysInRange(0, numEntries, entryKeys, entries, 6);
+        std::vector<BtreeEntry> shuffled(entries);
+        std::random_shuffle(shuffled.begin(), shuffled.end());
+        shuffled.push_back(entries[0]);
+
+        start = now;
+        bt.bulkInsert(&shuffled);
+        ASSERT_EQ("", bt.verify()) << numEntries << " entries";
+        EXPECT_EQ(numEntries, bt.size());
+
+        // Each node is written about once, instead of once per entry.
+        EXPECT_GE(bt.m_stats.nodes() + 2*slots,
+                  now.btreeNodeWrites - start.btreeNodeWrites);
+
+        IndexBtree::iterator it = bt.begin();
+        for (uint32_t i = 0; i < numEntries; i++) {
+            ASSERT_EQ(entries[i], *it);
+            it++;
+        }
+        EXPECT_EQ(bt.end(), it);
+        for (uint32_t i = 0; i < numEntries; i++)
+            EXPECT_TRUE(bt.exists(entries[i]));
+    }
+}
+
+TEST_F(BtreeTest, bulkInsert_nonEmptyTree) {
+    uint32_t slots = IndexBtree::innerslotmax;
+    uint32_t numEntries = slots*slots*slots;
+    IndexBtree bt(tableId, &objectManager);
+    std::vector<std::string> entryKeys;
+    std::vector<BtreeEntry> entries;
+    generateKeysInRange(0, numEntries, entryKeys, entries, 6);
+
+    // Interleaved with existing entries, then appended in several batches.
+    for (uint32_t i = 0; i < numEntries/4; i += 2)
+        bt.insert(entries[i]);
+    std::vector<BtreeEntry> batch;
+    for (uint32_t i = 1; i < numEntries/4; i += 2)
+        batch.push_back(entries[i]);
+    for (uint32_t i = numEntries/4; i < numEntries/2; i++)
+        batch.push_back(entries[i]);
+    // Entries already in the tree are skipped.
+    batch.push_back(entries[0]);
+    batch.push_back(entries[numEntries/4 - 2]);
+    bt.bulkInsert(&batch);
+    ASSERT_EQ("", bt.verify());
+
+    for (uint32_t first = numEntries/2; first < numEntries; first += 7) {
+        batch.clear();
+        for (uint32_t i = first; i < std::min(first + 7, numEntries); i++)
+            batch.push_back(entries[i]);
+        bt.bulkInsert(&batch);
+        ASSERT_EQ("", bt.verify());
+    }
+    EXPECT_EQ(numEntries, bt.size());
+
+    IndexBtree::iterator it = bt.begin();
+    for (uint32_t i = 0; i < numEntries; i++) {
+        ASSERT_EQ(entries[i], *it);
+        it++;
+    }
+
+    // The tree still supports the usual operations.
+    for (uint32_t i = 0; i < numEntries; i += 3) {
+        EXPECT_TRUE(bt.erase(entries[i]));
+        ASSERT_EQ("", bt.verify());
+    }
+    for (uint32_t i = 0; i < numEntries; i++)
+        EXPECT_EQ((i % 3) != 0, bt.exists(entries[i]));
+}
+
+TEST_F(BtreeTest, InnerNode_fillRightSibling) {
+    Buffer buffer;
+    IndexBtree::InnerNode *left =
+            buffer.emplaceAppend<IndexBtree::InnerNode>(&buffer, 1);
+    IndexBtree::InnerNode *right =
+            buffer.emplaceAppend<IndexBtree::InnerNode>(&buffer, 1);
+    std::vector<std::string> keys;
+    std::vector<BtreeEntry> entries;
+    uint16_t slots = IndexBtree::innerslotmax;
+    generateKeysInRange(0, slots + 2, keys, entries, 3);
+
+    for (uint16_t i = 0; i < slots; i++)
+        left->insertAt(i, entries[i], i);
+    left->child[slots] = slots;
+    left->setRightMostLeafKey(entries[slots]);
+    right->child[0] = slots + 1;
+
+    BtreeEntry newLast = left->fillRightSibling(right, entries[slots]);
+    uint16_t half = IndexBtree::mininnerslots;
+    EXPECT_EQ(entries[slots - half], newLast);
+    EXPECT_EQ(slots - half, left->slotuse);
+    EXPECT_EQ(half, right->slotuse);
+    EXPECT_FALSE(left->rightMostLeafKeyIsInfinite);
+    EXPECT_EQ(entries[slots - half], left->getRightMostLeafKey());
+    for (uint16_t i = 0; i < left->slotuse; i++) {
+        EXPECT_EQ(entries[i], left->getAt(i));
+        EXPECT_EQ(i, left->getChildAt(i));
+    }
+    EXPECT_EQ(slots - half, left->getChildAt(left->slotuse));
+    for (uint16_t i = 0; i < right->slotuse; i++) {
+        EXPECT_EQ(entries[slots - half + 1 + i], right->getAt(i));
+        EXPECT_EQ(slots - half + 1 + i, right->getChildAt(i));
+    }
+    EXPECT_EQ(slots + 1, right->getChildAt(right->slotuse));
+}
+
 void resetNode_underflowHelper(IndexBtree::Node *n, uint16_t numEntries) {
     n->slotuse = 0;
     n->keyStorageUsed = 0;
@@ -1,4 +1,4 @@
-/* Copyright (c) 2010 Stanford University
+/* Copyright (c) 2010-2015 Stanford University
  *
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -16,90 +16,124 @@
 /**
  * \file
  * Benchmark for Crc32C, a Nehalem instruction implementation of CRC32
- * with the Castagnoli polynomial.
+ * with the Castagnoli polynomial. Compares the slicing-by-8 software
+ * implementation, the serial crc32 instruction loop, and the 3-way
+ * interleaved loop that Crc32C::update() uses for buffers of at least
+ * Crc32C::INTERLEAVE_THRESHOLD bytes, as well as the cost of
+ * Crc32C::combine().
  */
 
 // RAMCloud pragma [CPPLINT=0]
 
 #include <Common.h>
-#include <BenchUtil.h>
+#include <Cycles.h>
 #include "Crc32C.h"
-#include <boost/crc.hpp>
 
 using namespace RAMCloud;
 
+/// Signature shared by all of the implementations being compared.
+typedef uint32_t (*Crc32CFunction)(uint32_t crc, const void* buffer,
+                                   uint64_t bytes);
+
 /**
- * Adapter for boost's CRC library.
- * This thing is ~80MB/sec awful.
+ * Return the average number of nanoseconds \a function takes to checksum
+ * \a bytes bytes of \a array.
+ *
+ * \param function
+ *      Implementation to measure.
+ * \param array
+ *      Data to checksum.
+ * \param bytes
+ *      Number of bytes of \a array to checksum.
+ * \param[out] crc
+ *      Checksum computed by \a function, so that the results of the
+ *      different implementations can be compared.
  */
-class BoostCrc32C {
-  public:
-    typedef uint32_t ResultType;
-    BoostCrc32C() : crc() {}
-    BoostCrc32C& update(const void* buffer, uint32_t bytes) {
-        crc.process_bytes(buffer, bytes);
-        return *this;
-    }
-    ResultType getResult() {
-        return crc();
-    }
-  private:
-    boost::crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true> crc;
-};
+static double
+measure(Crc32CFunction function, const uint8_t* array, uint64_t bytes,
+        uint32_t* crc)
+{
+    // Do more runs for smaller inputs.
+    uint64_t runs = std::max(uint64_t(10), (64 * 1024 * 1024) / bytes);
+    runs = std::min(runs, uint64_t(100000));
 
-#if BOOST_CRC32C
-typedef BoostCrc32C Checksum;
-#else
-typedef Crc32C Checksum;
-#endif
+    uint64_t start = Cycles::rdtsc();
+    for (uint64_t i = 0; i < runs; i++)
+        *crc = ~function(~0U, array, bytes);
+    uint64_t total = Cycles::rdtsc() - start;
+    return static_cast<double>(Cycles::toNanoseconds(total)) /
+           static_cast<double>(runs);
+}
 
 static void
-measure(int bytes, bool print = true)
+printResult(uint64_t bytes, double nsec)
+{
+    printf(" %8.1f ns %7.0f MB/s |", nsec,
+           static_cast<double>(bytes) / nsec * 1e9 / (1024 * 1024));
+}
+
+int
+main()
 {
-    uint8_t *array = reinterpret_cast<uint8_t *>(xmalloc(bytes)); 
-    Checksum crc;
+    Cycles::init();
 
-    // randomize input
-    for (int i = 0; i < bytes; i++)
-        array[i] = generateRandom();
+    const uint64_t maxBytes = 16 * 1024 * 1024;
+    uint8_t* array = new uint8_t[maxBytes];
+    for (uint64_t i = 0; i < maxBytes; i++)
+        array[i] = static_cast<uint8_t>(generateRandom());
 
-    // do more runs for smaller inputs
-    int runs = 1;
-    if (bytes < 4096)
-        runs = 100;
+    struct {
+        const char* name;
+        Crc32CFunction function;
+        bool needsHardware;
+    } implementations[] = {
+        { "software", softwareCrc32C, false },
+        { "serial", intelCrc32C, true },
+        { "interleaved", intelCrc32CInterleaved, true },
+    };
 
-    // run the test. be sure method call isn't removed by the compiler.
-    uint64_t total = 0;
-    for (int i = 0; i < runs; i++) {
-        uint64_t before = rdtsc();
-        crc.update(array, bytes);
-        total += (rdtsc() - before);
-    }
-    total /= runs;
+    printf("%10s |", "bytes");
+    foreach (auto& impl, implementations)
+        printf(" %-26s |", impl.name);
+    printf("\n");
 
-    if (print) {
-        uint64_t nsec = RAMCloud::cyclesToNanoseconds(total);
-        printf("%10d bytes: %10llu ticks    %10llu nsec    %3llu nsec/byte   "
-            "%7llu MB/sec    crc32c 0x%08x\n",
-            bytes,
-            total,
-            nsec,
-            nsec / bytes,
-            (uint64_t)(1.0e9 / ((float)nsec / bytes) / (1024*1024)),
-            crc.getResult());
+    uint32_t crc;
+    measure(softwareCrc32C, array, 4096, &crc);      // warm up
+    for (uint64_t bytes = 64; bytes <= maxBytes; bytes *= 2) {
+        printf("%10lu |", bytes);
+        uint32_t expected = 0;
+        bool first = true;
+        foreach (auto& impl, implementations) {
+            if (impl.needsHardware && !Crc32C::hardwareAvailable()) {
+                printf(" %-26s |", "n/a");
+                continue;
+            }
+            printResult(bytes, measure(impl.function, array, bytes, &crc));
+            if (first)
+                expected = crc;
+            else if (crc != expected)
+                printf(" MISMATCH: 0x%08x != 0x%08x", crc, expected);
+            first = false;
+        }
+        printf("\n");
     }
 
-    free(array);
-}
-
-int
-main()
-{
-    measure(4096, false);   // warm up
-    for (int i = 1; i < 128; i++)
-        measure(i);
-    for (int i = 128; i <= (16 * 1024 * 1024); i *= 2)
-        measure(i);
+    // Crc32C::combine() cost is logarithmic in the length of the second
+    // piece; it lets independently computed pieces be stitched together.
+    printf("\n%10s | combine\n", "bytes");
+    uint32_t crcA = Crc32C().update(array, 1024).getResult();
+    for (uint64_t bytes = 64; bytes <= maxBytes; bytes *= 16) {
+        int runs = 100000;
+        uint32_t result = 0;
+        uint64_t start = Cycles::rdtsc();
+        for (int i = 0; i < runs; i++)
+            result += Crc32C::combine(crcA + i, crcA, bytes);
+        uint64_t total = Cycles::rdtsc() - start;
+        printf("%10lu | %6.1f ns (0x%08x)\n", bytes,
+               static_cast<double>(Cycles::toNanoseconds(total)) / runs,
+               result);
+    }
 
+    delete[] array;
     return 0;
 }